@@ -7,7 +7,9 @@
 
 #import <OmniFoundation/OFObject.h>
 
-@class /* Foundation */ NSMutableDictionary, NSMutableSet, NSLock;
+#include <pthread.h>
+
+@class /* Foundation */ NSMutableDictionary, NSMutableSet;
 @class /* OmniFoundation */ OFMultiValueDictionary, OFScheduledEvent;
 @class /* OWF */ OWStaticArc;
 
@@ -15,10 +17,15 @@
 
 @interface OWMemoryCache : OFObject <OWCacheArcProvider, OWCacheContentProvider>
 {
-    NSLock *lock;
+    // Lookups take this for reading; anything that changes the rows, the indexes, or an entry's flags takes it for writing.
+    pthread_rwlock_t lock;
 
     // Memory cache is organized by subject.
     NSMutableDictionary *arcsBySubject;
+
+    // Secondary indexes from source and object content to the cache entries mentioning them, so that non-subject lookups don't have to scan every row.
+    OFMultiValueDictionary *entriesBySource;
+    OFMultiValueDictionary *entriesByObject;
     NSMutableSet *knownOtherContent;
     
     // Cache arcs and content soon get migrated over to the persistent cache (if it exists).
@@ -21,12 +21,16 @@
 
 RCS_ID("$Id$");
 
+@class OWMemoryCacheEntry;
+
 @interface OWMemoryCache (Private)
 
 - (void)_scanArcsForSubject:(OWContent *)anEntry giving:(NSMutableArray *)arcsOut;
 - (void)_scanArcsFor:(OWContent *)anEntry relation:(OWCacheArcRelationship)aRelation giving:(NSMutableArray *)arcsOut;
 
 - (id)_keyForSubject:(OWContent *)subject;
+- (void)_lockedIndexEntry:(OWMemoryCacheEntry *)entry;
+- (void)_lockedUnindexEntry:(OWMemoryCacheEntry *)entry;
 - (void)_scheduleExpireBeforeDate:(NSDate *)deadline;
 - (void)_expire;
 - (void)_flushCache:(NSNotification *)note;
@@ -56,7 +60,7 @@ RCS_ID("$Id$");
 - (OWStaticArc *)arc;
 - (void)touch;
 - (void)invalidate;
-- (void)substituteArc:(OWStaticArc *)anArc;
+- (OWMemoryCacheEntry *)substituteArc:(OWStaticArc *)anArc;
 
 @end
 
@@ -88,6 +92,7 @@ RCS_ID("$Id$");
 
 - (void)touch;
 {
+    // Lookups touch entries while holding the cache lock only for reading, so several threads may store here at once. They are all storing "now", and a lost update only shortens the entry's life by a moment.
     lastUsed = [NSDate timeIntervalSinceReferenceDate];
 }
 
@@ -102,12 +107,12 @@ RCS_ID("$Id$");
     //NSLog(@"%@: %@", [self shortDescription], m);
 }
 
-- (void)substituteArc:(OWStaticArc *)anArc;
+- (OWMemoryCacheEntry *)substituteArc:(OWStaticArc *)anArc;
 {
     OWMemoryCacheEntry *newEntry;
     
     if (anArc == arc)
-        return;
+        return nil;
 
     newEntry = [[OWMemoryCacheEntry alloc] initWithArc:anArc];
     if (flags.superseded)
@@ -120,6 +125,8 @@ RCS_ID("$Id$");
     next = newEntry;
 
     flags.shouldRemove = YES;
+
+    return newEntry;
 }
 
 @end
@@ -132,8 +139,10 @@ RCS_ID("$Id$");
     if (!(self = [super init]))
         return nil;
 
-    lock = [[NSLock alloc] init];
+    pthread_rwlock_init(&lock, NULL);
     arcsBySubject = CFBridgingRelease(CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &OFNSObjectDictionaryKeyCallbacks, &OFNSObjectDictionaryValueCallbacks));
+    entriesBySource = [[OFMultiValueDictionary alloc] initWithKeyCallBacks:&OFNSObjectDictionaryKeyCallbacks];
+    entriesByObject = [[OFMultiValueDictionary alloc] initWithKeyCallBacks:&OFNSObjectDictionaryKeyCallbacks];
     knownOtherContent = [[NSMutableSet alloc] init];
     [OWContentCacheGroup addContentCacheObserver:self];
 
@@ -143,6 +152,7 @@ RCS_ID("$Id$");
 - (void)dealloc;
 {
     [OWContentCacheGroup removeContentCacheObserver:self];
+    pthread_rwlock_destroy(&lock);
 }
 
 // API
@@ -167,9 +177,9 @@ RCS_ID("$Id$");
 
 - (NSArray *)allArcs;
 {
-    [lock lock];
+    pthread_rwlock_rdlock(&lock);
     NSArray *arcs = [[NSArray alloc] initWithArray:[[arcsBySubject allValues] arrayByPerformingSelector:@selector(arc)]];
-    [lock unlock];
+    pthread_rwlock_unlock(&lock);
     
     return arcs;
 }
@@ -188,7 +198,7 @@ RCS_ID("$Id$");
         ([cacheControl isEqual:OWCacheArcReload] || [cacheControl isEqual:OWCacheArcRevalidate]))
         return nil;
 
-    [lock lock];
+    pthread_rwlock_rdlock(&lock);
     
     result = [[NSMutableArray alloc] init];
     if (relation & (~OWCacheArcSubject))
@@ -203,7 +213,7 @@ RCS_ID("$Id$");
         result = nil;
     }
 
-    [lock unlock];
+    pthread_rwlock_unlock(&lock);
 
     [result reverse];
     
@@ -225,7 +235,7 @@ RCS_ID("$Id$");
 #ifdef DEBUG_kc0
     NSLog(@"-[%@ %s], anArc=%@", OBShortObjectDescription(self), _cmd, OBShortObjectDescription(anArc));
 #endif
-    [lock lock];
+    pthread_rwlock_wrlock(&lock);
     
     //... validate cacheability? TODO
 
@@ -254,12 +264,13 @@ RCS_ID("$Id$");
         OBASSERT(newEntry->next == nil);
     }
     [newEntry touch];
+    [self _lockedIndexEntry:newEntry];
 
     [knownOtherContent addObject:[anArc object]];
     if ([anArc source] != nil)
         [knownOtherContent addObject:[anArc source]];
 
-    [lock unlock];
+    pthread_rwlock_unlock(&lock);
 
     // Now check for duplicate/superseded arcs while the cache lock is not held. (We will need the global lock though.)
     if (priorArcs != nil && [priorArcs count] > 0) {
@@ -283,10 +294,10 @@ RCS_ID("$Id$");
         // Set the superseded flags.
         arcCount = [priorArcs count];
         if (arcCount > 0) {
-            [lock lock];
+            pthread_rwlock_wrlock(&lock);
             for (arcIndex = 0; arcIndex < arcCount; arcIndex++)
                 ((OWMemoryCacheEntry *)[priorArcs objectAtIndex:arcIndex])->flags.superseded = YES;
-            [lock unlock];
+            pthread_rwlock_unlock(&lock);
         }
     }
     priorArcs = nil;
@@ -305,7 +316,7 @@ RCS_ID("$Id$");
     if (someContent == nil || ![someContent isHashable])
         return nil;
 
-    [lock lock];
+    pthread_rwlock_rdlock(&lock);
     
     // search for equivalent content, return it
     
@@ -315,7 +326,7 @@ RCS_ID("$Id$");
     while (existingEntry != nil) {
         OWContent *existingContent = [[existingEntry arc] subject];
         if ([someContent isEqual:existingContent]) {
-            [lock unlock];
+            pthread_rwlock_unlock(&lock);
             return existingContent;
         }
         existingEntry = existingEntry->next;
@@ -323,14 +334,14 @@ RCS_ID("$Id$");
         
     OWContent *existingContent = [knownOtherContent member:someContent];
     if (existingContent != nil && existingContent != someContent) {
-        [lock unlock];
+        pthread_rwlock_unlock(&lock);
 #ifdef DEBUG_kc0
         NSLog(@"-[%@ %s]: Found equivalent existing content, returning it rather than the new content: %@",  OBShortObjectDescription(self), _cmd, someContent);
 #endif
         return existingContent;
     }
     
-    [lock unlock];
+    pthread_rwlock_unlock(&lock);
 
     return someContent;
 }
@@ -386,7 +397,7 @@ RCS_ID("$Id$");
 
     //NSLog(@"%@ invalidation note: %@", [self shortDescription], [noteInfo description]);
 
-    [lock lock];
+    pthread_rwlock_wrlock(&lock);
 
     BOOL scheduleExpiration = NO;
 
@@ -400,7 +411,7 @@ RCS_ID("$Id$");
         cursor = cursor->next;
     }
 
-    [lock unlock];
+    pthread_rwlock_unlock(&lock);
 
     if (scheduleExpiration)
         [self _scheduleExpireBeforeDate:[NSDate dateWithTimeIntervalSinceNow:5.0]];
@@ -421,6 +432,10 @@ RCS_ID("$Id$");
         [debugDictionary setObject:arcsBySubject forKey:@"arcsBySubject"];
     if (knownOtherContent != nil)
         [debugDictionary setObject:knownOtherContent forKey:@"knownOtherContent"];
+    if (entriesBySource != nil)
+        [debugDictionary setObject:[entriesBySource dictionary] forKey:@"entriesBySource"];
+    if (entriesByObject != nil)
+        [debugDictionary setObject:[entriesByObject dictionary] forKey:@"entriesByObject"];
     if (backingCache != nil)
         [debugDictionary setObject:OBShortObjectDescription(backingCache) forKey:@"backingCache"];
     if (expireEvent != nil)
@@ -447,32 +462,38 @@ RCS_ID("$Id$");
     }
 }
 
-- (void)_scanArcsFor:(OWContent *)anEntry relation:(OWCacheArcRelationship)lookForRelationship giving:(NSMutableArray *)matchedArcs
+static void _addLiveEntries(NSArray *entries, NSHashTable *alreadyMatched, NSMutableArray *matchedArcs)
 {
-    NSEnumerator *cacheRowEnumerator;
-    OWMemoryCacheEntry *cacheEntry;
-
-    // Must be called with the cache lock held.
+    for (OWMemoryCacheEntry *entry in entries) {
+        if (entry->flags.shouldRemove)
+            continue;
+        if (alreadyMatched != nil) {
+            if ([alreadyMatched containsObject:entry])
+                continue;
+            [alreadyMatched addObject:entry];
+        }
+        [matchedArcs addObject:entry];
+    }
+}
 
-    cacheRowEnumerator = [arcsBySubject objectEnumerator];
-    cacheEntry = nil;
+- (void)_scanArcsFor:(OWContent *)anEntry relation:(OWCacheArcRelationship)lookForRelationship giving:(NSMutableArray *)matchedArcs
+{
+    // Must be called with the cache lock held (reading is enough).
 
-    for(;;) {
-        if (cacheEntry != nil)
-            cacheEntry = cacheEntry->next;
-        if (cacheEntry == nil)
-            cacheEntry = [cacheRowEnumerator nextObject];
-        if (cacheEntry == nil)
-            break;
+    // An arc's subject is usually also its source, so when more than one relation is wanted the same entry can turn up in several places.
+    NSHashTable *alreadyMatched = nil;
+    if ((lookForRelationship & (lookForRelationship - 1)) != 0)
+        alreadyMatched = [[NSHashTable alloc] initWithOptions:NSPointerFunctionsObjectPointerPersonality capacity:0];
 
-        if (!cacheEntry->flags.shouldRemove) {
-            OWCacheArcRelationship arcMatches = [cacheEntry->arc relationsOfEntry:anEntry intern:NULL];
-            if (arcMatches & lookForRelationship) {
-                [cacheEntry touch];
-                [matchedArcs addObject:cacheEntry];
-            }
-        }
+    if (lookForRelationship & OWCacheArcSubject) {
+        NSMutableArray *subjectMatches = [[NSMutableArray alloc] init];
+        [self _scanArcsForSubject:anEntry giving:subjectMatches];
+        _addLiveEntries(subjectMatches, alreadyMatched, matchedArcs);
     }
+    if (lookForRelationship & OWCacheArcSource)
+        _addLiveEntries([entriesBySource arrayForKey:anEntry], alreadyMatched, matchedArcs);
+    if (lookForRelationship & OWCacheArcObject)
+        _addLiveEntries([entriesByObject arrayForKey:anEntry], alreadyMatched, matchedArcs);
 }
 
 - (id)_keyForSubject:(OWContent *)subject
@@ -485,6 +506,28 @@ RCS_ID("$Id$");
         return subject;
 }
 
+- (void)_lockedIndexEntry:(OWMemoryCacheEntry *)entry;
+{
+    OWContent *source = [entry->arc source];
+    OWContent *object = [entry->arc object];
+
+    if (source != nil)
+        [entriesBySource addObject:entry forKey:source];
+    if (object != nil)
+        [entriesByObject addObject:entry forKey:object];
+}
+
+- (void)_lockedUnindexEntry:(OWMemoryCacheEntry *)entry;
+{
+    OWContent *source = [entry->arc source];
+    OWContent *object = [entry->arc object];
+
+    if (source != nil)
+        [entriesBySource removeObjectIdenticalTo:entry forKey:source];
+    if (object != nil)
+        [entriesByObject removeObjectIdenticalTo:entry forKey:object];
+}
+
 - (void)_flushCache:(NSNotification *)note
 {
 #ifdef DEBUG_kc0
@@ -500,7 +543,7 @@ RCS_ID("$Id$");
 
 - (void)_scheduleExpireBeforeDate:(NSDate *)deadline;
 {
-    [lock lock];
+    pthread_rwlock_wrlock(&lock);
 
     if (expireEvent != nil && [[expireEvent date] compare:deadline] == NSOrderedDescending) {
         [self _lockedCancelCurrentExpireEvent];
@@ -511,12 +554,12 @@ RCS_ID("$Id$");
         [[OWContentCacheGroup scheduler] scheduleEvent:expireEvent];
     }	
 
-    [lock unlock];
+    pthread_rwlock_unlock(&lock);
 }	
 
 - (void)_expire;
 {
-    [lock lock];
+    pthread_rwlock_wrlock(&lock);
 
     expireEvent = nil;
 
@@ -574,7 +617,7 @@ RCS_ID("$Id$");
         }            
     }
 
-    [lock unlock];
+    pthread_rwlock_unlock(&lock);
 
     [OWPipeline lock];
     for (unsigned arcIndex = 0; arcIndex < [entriesToOffer count]; arcIndex ++) {
@@ -597,10 +640,12 @@ RCS_ID("$Id$");
                 arcsAccepted++;
 
                 if (storedArc != entry->arc && [storedArc isKindOfClass:[OWStaticArc class]]) {
-                    [lock lock];
+                    pthread_rwlock_wrlock(&lock);
                     [shouldPurge addObject:[entry->arc subject]];
-                    [entry substituteArc:storedArc];
-                    [lock unlock];
+                    OWMemoryCacheEntry *substitutedEntry = [entry substituteArc:storedArc];
+                    if (substitutedEntry != nil)
+                        [self _lockedIndexEntry:substitutedEntry];
+                    pthread_rwlock_unlock(&lock);
                 }
             }
         }
@@ -637,7 +682,7 @@ RCS_ID("$Id$");
     NSLog(@"-[%@ %s], touchedRows=%@", OBShortObjectDescription(self), _cmd, touchedRows);
 #endif
 
-    [lock lock];
+    pthread_rwlock_wrlock(&lock);
 #if defined(DEBUG_CacheTiming)
     NSTimeInterval began = [NSDate timeIntervalSinceReferenceDate];
 #endif
@@ -655,6 +700,7 @@ RCS_ID("$Id$");
 
             if (cursor->flags.shouldRemove) {
                 entriesRemoved++;
+                [self _lockedUnindexEntry:cursor];
                 
                 if (lastEntry == nil) {
                     cursor = cursor->next;
@@ -683,7 +729,7 @@ RCS_ID("$Id$");
     NSLog(@"-[%@ %s] took %.3f seconds. Removed %u entries in %u rows, removing %u rows.", [self shortDescription], _cmd, ([NSDate timeIntervalSinceReferenceDate] - began), entriesRemoved, rowsTouched, rowsEmptied);
 #endif
     
-    [lock unlock];
+    pthread_rwlock_unlock(&lock);
 }
 
 - (void)_lockedCancelCurrentExpireEvent;
@@ -697,26 +743,32 @@ RCS_ID("$Id$");
 
 - (void)_removeAllArcs;
 {
-    [lock lock];
+    pthread_rwlock_wrlock(&lock);
     
     [self _lockedCancelCurrentExpireEvent];
 
     // Clear out our instance variables inside the lock, but don't actually release their contents yet
     NSMutableDictionary *retainedArcsBySubject = arcsBySubject;
     NSMutableSet *retainedKnownOtherContent = knownOtherContent;
+    OFMultiValueDictionary *retainedEntriesBySource = entriesBySource;
+    OFMultiValueDictionary *retainedEntriesByObject = entriesByObject;
     arcsBySubject = CFBridgingRelease(CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &OFNSObjectDictionaryKeyCallbacks, &OFNSObjectDictionaryValueCallbacks));
     knownOtherContent = [[NSMutableSet alloc] init];
-    [lock unlock];
+    entriesBySource = [[OFMultiValueDictionary alloc] initWithKeyCallBacks:&OFNSObjectDictionaryKeyCallbacks];
+    entriesByObject = [[OFMultiValueDictionary alloc] initWithKeyCallBacks:&OFNSObjectDictionaryKeyCallbacks];
+    pthread_rwlock_unlock(&lock);
 
     // OK, now release those former instance variables
     retainedArcsBySubject = nil;
     retainedKnownOtherContent = nil;
+    retainedEntriesBySource = nil;
+    retainedEntriesByObject = nil;
 }
 
 - (void)_invalidateAllArcs;
 {
     NSMutableSet *purgeRows = [NSMutableSet set];
-    [lock lock];
+    pthread_rwlock_wrlock(&lock);
 
     NS_DURING {
         NSEnumerator *cacheRowEnumerator = [arcsBySubject keyEnumerator];
@@ -744,7 +796,7 @@ RCS_ID("$Id$");
 #endif
     } NS_ENDHANDLER;
 
-    [lock unlock];
+    pthread_rwlock_unlock(&lock);
 
     [self _purgeMarkedEntriesFromRows:purgeRows];
 }
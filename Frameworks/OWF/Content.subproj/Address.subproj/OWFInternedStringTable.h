@@ -0,0 +1,18 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <Foundation/NSString.h>
+
+/* A fixed-size table of strings that are handed out over and over, like URL schemes and host names, so that every URL naming the same one shares a single string. Neither lookups nor additions lock: each slot is filled at most once with a compare-and-swap, and entries are never removed, so a string returned from the table stays valid forever. Once the slots a string would go in are all taken, it is just returned uninterned. */
+
+typedef struct _OWFInternedStringTable OWFInternedStringTable;
+
+extern OWFInternedStringTable *OWFInternedStringTableCreate(NSUInteger capacity, BOOL lowercase);
+    // If lowercase is YES, strings are looked up without regard to ASCII case and the table hands back their lowercase form.
+
+extern NSString *OWFInternedStringForCharacters(OWFInternedStringTable *table, const unichar *characters, NSUInteger length);
+extern NSString *OWFInternedString(OWFInternedStringTable *table, NSString *string);
@@ -0,0 +1,133 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import "OWFInternedStringTable.h"
+
+#import <OmniBase/assertions.h>
+#import <OmniBase/rcsid.h>
+#import <stdatomic.h>
+
+RCS_ID("$Id$")
+
+typedef struct _OWFInternedStringTableEntry {
+    NSUInteger hash;
+    CFStringRef string;
+    NSUInteger length;
+    unichar characters[]; // Already lowercased if the table is
+} OWFInternedStringTableEntry;
+
+struct _OWFInternedStringTable {
+    BOOL lowercase;
+    NSUInteger slotMask;
+    _Atomic(OWFInternedStringTableEntry *) slots[];
+};
+
+enum {
+    OWFInternedStringTableMaximumProbes = 8,
+    OWFInternedStringTableMaximumLength = 255, // Longer strings are rarely repeated, and would pin too much memory
+};
+
+OWFInternedStringTable *OWFInternedStringTableCreate(NSUInteger capacity, BOOL lowercase)
+{
+    NSUInteger slotCount = 16;
+    while (slotCount < capacity)
+        slotCount <<= 1;
+
+    OWFInternedStringTable *table = calloc(1, sizeof(*table) + slotCount * sizeof(*table->slots));
+    table->lowercase = lowercase;
+    table->slotMask = slotCount - 1;
+    for (NSUInteger slotIndex = 0; slotIndex < slotCount; slotIndex++)
+        atomic_init(&table->slots[slotIndex], NULL);
+    return table;
+}
+
+static inline unichar _tableCharacter(const OWFInternedStringTable *table, unichar character)
+{
+    if (table->lowercase && character >= 'A' && character <= 'Z')
+        return character + ('a' - 'A');
+    return character;
+}
+
+static NSString *_newString(const OWFInternedStringTable *table, const unichar *characters, NSUInteger length)
+{
+    NSString *string = [[NSString alloc] initWithCharacters:characters length:length];
+    return table->lowercase ? [string lowercaseString] : string;
+}
+
+NSString *OWFInternedStringForCharacters(OWFInternedStringTable *table, const unichar *characters, NSUInteger length)
+{
+    OBPRECONDITION(table != NULL);
+
+    if (length > OWFInternedStringTableMaximumLength)
+        return _newString(table, characters, length);
+
+    // FNV-1a
+    NSUInteger hash = (NSUInteger)2166136261u;
+    for (NSUInteger characterIndex = 0; characterIndex < length; characterIndex++) {
+        unichar character = _tableCharacter(table, characters[characterIndex]);
+        if (table->lowercase && character >= 0x80)
+            return _newString(table, characters, length); // Only ASCII case is folded here; leave the rest to -lowercaseString
+        hash = (hash ^ character) * 16777619u;
+    }
+
+    OWFInternedStringTableEntry *newEntry = NULL;
+    for (NSUInteger probe = 0; probe < OWFInternedStringTableMaximumProbes; probe++) {
+        _Atomic(OWFInternedStringTableEntry *) *slot = &table->slots[(hash + probe) & table->slotMask];
+        OWFInternedStringTableEntry *entry = atomic_load_explicit(slot, memory_order_acquire);
+
+        if (entry == NULL) {
+            if (newEntry == NULL) {
+                newEntry = malloc(sizeof(*newEntry) + length * sizeof(unichar));
+                newEntry->hash = hash;
+                newEntry->length = length;
+                for (NSUInteger characterIndex = 0; characterIndex < length; characterIndex++)
+                    newEntry->characters[characterIndex] = _tableCharacter(table, characters[characterIndex]);
+                newEntry->string = CFStringCreateWithCharacters(kCFAllocatorDefault, newEntry->characters, length);
+            }
+            if (atomic_compare_exchange_strong_explicit(slot, &entry, newEntry, memory_order_acq_rel, memory_order_acquire))
+                return (__bridge NSString *)newEntry->string;
+            // Someone else filled this slot first; entry is now what they put there, which might be our string.
+        }
+
+        if (entry->hash == hash && entry->length == length) {
+            NSUInteger characterIndex;
+            for (characterIndex = 0; characterIndex < length; characterIndex++) {
+                if (entry->characters[characterIndex] != _tableCharacter(table, characters[characterIndex]))
+                    break;
+            }
+            if (characterIndex == length) {
+                if (newEntry != NULL) {
+                    CFRelease(newEntry->string);
+                    free(newEntry);
+                }
+                return (__bridge NSString *)entry->string;
+            }
+        }
+    }
+
+    // No room for it along its probe sequence.
+    if (newEntry != NULL) {
+        NSString *string = CFBridgingRelease(newEntry->string);
+        free(newEntry);
+        return string;
+    }
+    return _newString(table, characters, length);
+}
+
+NSString *OWFInternedString(OWFInternedStringTable *table, NSString *string)
+{
+    if (string == nil)
+        return nil;
+
+    NSUInteger length = [string length];
+    if (length > OWFInternedStringTableMaximumLength)
+        return table->lowercase ? [string lowercaseString] : [string copy];
+
+    unichar characters[OWFInternedStringTableMaximumLength];
+    [string getCharacters:characters range:NSMakeRange(0, length)];
+    return OWFInternedStringForCharacters(table, characters, length);
+}
@@ -12,6 +12,7 @@
 
 #import <CoreFoundation/CFString.h> // For CFStringEncoding
 #import <os/lock.h>
+#import <stdatomic.h>
 
 @interface OWURL : OFObject <NSCopying>
 {
@@ -28,6 +29,12 @@
     // Irregular scheme attribute
     NSString *schemeSpecificPart;
 
+    // A URL parsed from a string keeps that string and where each component lies in it, and only makes the component strings above the first time any of them is needed.
+    NSString *_parsedString;
+    NSRange _parsedComponentRanges[6];
+    os_unfair_lock _parsedComponentsLock;
+    atomic_bool _componentsAreMaterialized;
+
     // Derived attributes
     os_unfair_lock derivedAttributesLock;
     NSString *_cachedCompositeString;
@@ -17,10 +17,26 @@
 #import <OWF/OWContentType.h>
 #import <OWF/OWNetLocation.h>
 #import <OWF/OWHTMLToSGMLObjects.h>
-#import "OWFLowercaseStringCache.h"
+#import "OWFInternedStringTable.h"
 
 RCS_ID("$Id$")
 
+typedef enum {
+    OWURLNetLocationComponent,
+    OWURLPathComponent,
+    OWURLParamsComponent,
+    OWURLQueryComponent,
+    OWURLFragmentComponent,
+    OWURLSchemeSpecificPartComponent,
+    OWURLComponentCount
+} OWURLComponent;
+
+typedef struct {
+    NSUInteger start; // Past any leading whitespace
+    NSRange scheme;
+    NSRange components[OWURLComponentCount]; // A missing component has a location of NSNotFound; a present but empty one has a length of 0
+} OWURLParse;
+
 @interface OWURL (Private)
 + (void)controllerDidInitialize:(OFController *)controller;
 
@@ -31,7 +47,10 @@ RCS_ID("$Id$")
 - initWithLowercaseScheme:(NSString *)aScheme netLocation:(NSString *)aNetLocation path:(NSString *)aPath params:(NSString *)someParams query:(NSString *)aQuery fragment:(NSString *)aFragment;
 - initWithLowercaseScheme:(NSString *)aScheme schemeSpecificPart:(NSString *)aSchemeSpecificPart fragment:(NSString *)aFragment;
 - initWithScheme:(NSString *)aScheme schemeSpecificPart:(NSString *)aSchemeSpecificPart fragment:(NSString *)aFragment;
+- _initWithLowercaseScheme:(NSString *)aScheme parsedString:(NSString *)aString characters:(const unichar *)characters parse:(const OWURLParse *)parse;
 
+- (void)_materializeParsedComponents;
+- (OWURL *)_urlFromRelativeCharacters:(const unichar *)characters length:(NSUInteger)length ofString:(NSString *)aString;
 - (OWURL *)fakeRootURL;
 
 - (void)_locked_parseNetLocation;
@@ -47,20 +66,28 @@ RCS_ID("$Id$")
 
 static NSArray *fakeRootURLs = nil;
 static NSLock *fakeRootURLsLock;
-static OWFLowercaseStringCache lowercaseSchemeCache;
+static OWFInternedStringTable *schemeTable;
+static OWFInternedStringTable *netLocationTable;
 static NSArray *shortTopLevelDomains = nil;
 
 // These are carefully derived from RFC1808.
 // (http://www.w3.org/hypertext/WWW/Addressing/rfc1808.txt)
+//
+// Apart from the scheme, every component may contain any character but a few ASCII delimiters (which is a bit richer than the standard allows), so the parser only needs to classify ASCII characters. Scheme characters are letters, digits and "+-.", where letters include non-ASCII ones.
+
+enum {
+    OWURLSchemeCharacter = 1 << 0,
+    OWURLNetLocationDelimiter = 1 << 1,
+    OWURLPathDelimiter = 1 << 2,
+    OWURLParamDelimiter = 1 << 3,
+    OWURLQueryDelimiter = 1 << 4,
+    OWURLFragmentDelimiter = 1 << 5,
+    OWURLSchemeSpecificPartDelimiter = OWURLQueryDelimiter,
+};
+static uint8_t URLCharacterFlags[128];
+static CFCharacterSetRef LetterCharacterSet;
+static CFCharacterSetRef WhitespaceAndNewlineCharacterSet;
 
-static OFCharacterSet *SchemeDelimiterOFCharacterSet;
-static OFCharacterSet *NetLocationDelimiterOFCharacterSet;
-static OFCharacterSet *PathDelimiterOFCharacterSet;
-static OFCharacterSet *ParamDelimiterOFCharacterSet;
-static OFCharacterSet *QueryDelimiterOFCharacterSet;
-static OFCharacterSet *FragmentDelimiterOFCharacterSet;
-static OFCharacterSet *SchemeSpecificPartDelimiterOFCharacterSet;
-static OFCharacterSet *NonWhitespaceOFCharacterSet;
 static OFCharacterSet *TabsAndReturnsOFCharacterSet;
 static NSMutableDictionary *ContentTypeDictionary;
 static os_unfair_lock ContentTypeDictionaryLock = OS_UNFAIR_LOCK_INIT;
@@ -68,83 +95,38 @@ static NSMutableSet *SecureSchemes;
 static os_unfair_lock SecureSchemesLock = OS_UNFAIR_LOCK_INIT;
 static BOOL NetscapeCompatibleRelativeAddresses;
 
-static NSRegularExpression *backslashThenWhitespaceRegularExpression;
-static NSRegularExpression *newlinesAndSurroundingWhitespaceRegularExpression;
+static inline void _ensureComponents(OWURL *url)
+{
+    if (!atomic_load_explicit(&url->_componentsAreMaterialized, memory_order_acquire))
+        [url _materializeParsedComponents];
+}
 
-+ (void)initialize;
+static void _addCharacterFlag(const char *characters, uint8_t flag)
 {
-    OFCharacterSet *AlphaSet, *DigitSet, *ReservedSet;
-    OFCharacterSet *UnreservedSet, *UCharSet, *PCharSet;
-    OFCharacterSet *SchemeSet, *NetLocationSet, *PathSet;
-    OFCharacterSet *ParamSet, *QuerySet, *FragmentSet;
-    OFCharacterSet *SchemeSpecificPartSet;
+    for (; *characters != '\0'; characters++)
+        URLCharacterFlags[(unsigned char)*characters] |= flag;
+}
 
++ (void)initialize;
+{
     OBINITIALIZE;
 
-    OWFLowercaseStringCacheInit(&lowercaseSchemeCache);
-
-    AlphaSet = [[OFCharacterSet alloc] initWithCharacterSet:[NSCharacterSet letterCharacterSet]];
-    DigitSet = [[OFCharacterSet alloc] initWithString:@"0123456789"];
-    ReservedSet = [[OFCharacterSet alloc] initWithString:@";/?:@&="];
-
-    // This is a bit richer than the standard allows
-    UnreservedSet = [[OFCharacterSet alloc] initWithOFCharacterSet:ReservedSet];
-    [UnreservedSet invert];
-    [UnreservedSet removeCharactersInString:@"%#"];
-
-    UCharSet = [[OFCharacterSet alloc] init];
-    [UCharSet addCharactersFromOFCharacterSet:UnreservedSet];
-    [UCharSet addCharactersInString:@"%"]; // escapes
-
-    PCharSet = [[OFCharacterSet alloc] init];
-    [PCharSet addCharactersFromOFCharacterSet:UCharSet];
-    [PCharSet addCharactersInString:@":@&="];
-
-    SchemeSet = [[OFCharacterSet alloc] init];
-    [SchemeSet addCharactersFromOFCharacterSet:AlphaSet];
-    [SchemeSet addCharactersFromOFCharacterSet:DigitSet];
-    [SchemeSet addCharactersInString:@"+-."];
-
-    NetLocationSet = [[OFCharacterSet alloc] init];
-    [NetLocationSet addCharactersFromOFCharacterSet:PCharSet];
-    [NetLocationSet addCharactersInString:@";?"];
-    [NetLocationSet removeCharactersInString:@"\\"]; // stupid backslash paths found on some sites
-    [NetLocationSet removeCharactersInString:@"?"]; // Bug #6399: Support invalid URLs that include a question mark "?" immediately following the domain
-
-    PathSet = [[OFCharacterSet alloc] init];
-    [PathSet addCharactersFromOFCharacterSet:PCharSet];
-    [PathSet addCharactersInString:@"/"];
-
-    ParamSet = [[OFCharacterSet alloc] init];
-    [ParamSet addCharactersFromOFCharacterSet:PCharSet];
-    [ParamSet addCharactersInString:@"/"];
-    [ParamSet addCharactersInString:@";"];
-
-    QuerySet = [[OFCharacterSet alloc] init];
-    [QuerySet addCharactersFromOFCharacterSet:UCharSet];
-    [QuerySet addCharactersFromOFCharacterSet:ReservedSet];
+    schemeTable = OWFInternedStringTableCreate(256, YES);
+    netLocationTable = OWFInternedStringTableCreate(16384, NO);
 
+    _addCharacterFlag("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789+-.", OWURLSchemeCharacter);
+    // Backslash because of stupid backslash paths found on some sites; '?' for bug #6399: support invalid URLs that include a question mark "?" immediately following the domain
+    _addCharacterFlag("/#\\?", OWURLNetLocationDelimiter);
+    _addCharacterFlag(";?#", OWURLPathDelimiter);
+    _addCharacterFlag("?#", OWURLParamDelimiter);
+    _addCharacterFlag("#", OWURLQueryDelimiter);
 #ifdef PEDANTIC_URL_PARSING
-    FragmentSet = [QuerySet retain];
+    _addCharacterFlag("#", OWURLFragmentDelimiter);
 #else
     // The spec doesn't include '#' in the fragment set, but this change is required to parse <http://www.nick.com/flash_inits/ainit_container.swf?movie0=/flash_inits/multimedia/logo_atom.swf&movie0_url=#&clicked0=#&movie1=/flash_inits/multimedia/kca2004.swf&movie1_url=/all_nick/specials/kca_2004/&clicked1=/flash_inits/multimedia/click_all_nick.swf&movie2=/flash_inits/multimedia/e_collect2004_fop.swf&movie2_url=/home/mynick/&clicked2=/flash_inits/multimedia/click_games.swf&movie3=/flash_inits/multimedia/sb_bowling.swf&movie3_url=/games/game.jhtml?game-name=sb_bowling&clicked3=/flash_inits/multimedia/click_games.swf&movie4=/flash_inits/multimedia/fop_superwishgame.swf&movie4_url=/games/data/fairlyoddparents/fop_hero/playGame.jhtml&clicked4=/flash_inits/multimedia/click_games.swf&movie5=/flash_inits/multimedia/amanda_games.swf&movie5_url=/amandaplease/archive/index.jhtml&clicked5=/flash_inits/multimedia/click_all_nick.swf&path=&section=home&redval=205&greenval=255&blueval=0&isLoaded=1&>
-    FragmentSet = [[OFCharacterSet alloc] initWithOFCharacterSet:QuerySet];
-    [FragmentSet addCharactersInString:@"#"];
 #endif
-    SchemeSpecificPartSet = QuerySet;
-
-    // Now, get the OFCharacterSet *representations of all those character sets
-#define delimiterBitmapForSet(ofSet, set) { ofSet = [[OFCharacterSet alloc] initWithOFCharacterSet:set]; [ofSet invert]; }
-    delimiterBitmapForSet(SchemeDelimiterOFCharacterSet, SchemeSet);
-    delimiterBitmapForSet(NetLocationDelimiterOFCharacterSet, NetLocationSet);
-    delimiterBitmapForSet(PathDelimiterOFCharacterSet, PathSet);
-    delimiterBitmapForSet(ParamDelimiterOFCharacterSet, ParamSet);
-    delimiterBitmapForSet(QueryDelimiterOFCharacterSet, QuerySet);
-    delimiterBitmapForSet(FragmentDelimiterOFCharacterSet, FragmentSet);
-    delimiterBitmapForSet(SchemeSpecificPartDelimiterOFCharacterSet, SchemeSpecificPartSet);
-#undef delimiterBitmapForSet
-    NonWhitespaceOFCharacterSet = [[OFCharacterSet alloc] initWithCharacterSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
-    [NonWhitespaceOFCharacterSet invert];
+    LetterCharacterSet = CFCharacterSetGetPredefined(kCFCharacterSetLetter);
+    WhitespaceAndNewlineCharacterSet = CFCharacterSetGetPredefined(kCFCharacterSetWhitespaceAndNewline);
 
     TabsAndReturnsOFCharacterSet = [[OFCharacterSet alloc] initWithString:@"\t\r\n"];
 
@@ -152,12 +134,6 @@ static NSRegularExpression *newlinesAndSurroundingWhitespaceRegularExpression;
     SecureSchemes = [[NSMutableSet alloc] init];
 
     fakeRootURLsLock = [[NSLock alloc] init];
-    
-    backslashThenWhitespaceRegularExpression = [[NSRegularExpression alloc] initWithPattern:@"\\\\[ \n\r\t]+" options:0 error:NULL];
-    OBASSERT(backslashThenWhitespaceRegularExpression);
-    
-    newlinesAndSurroundingWhitespaceRegularExpression = [[NSRegularExpression alloc] initWithPattern:@"[ \t]*[\n\r][ \t]*" options:0 error:NULL];
-    OBASSERT(newlinesAndSurroundingWhitespaceRegularExpression);
 }
 
 OBDidLoad(^{
@@ -204,7 +180,7 @@ OBDidLoad(^{
 
 + (OWURL *)urlWithScheme:(NSString *)aScheme netLocation:(NSString *)aNetLocation path:(NSString *)aPath params:(NSString *)someParams query:(NSString *)aQuery fragment:(NSString *)aFragment;
 {
-    return [self urlWithLowercaseScheme:OWFLowercaseStringCacheGet(&lowercaseSchemeCache, aScheme) netLocation:aNetLocation path:aPath params:someParams query:aQuery fragment:aFragment];
+    return [self urlWithLowercaseScheme:OWFInternedString(schemeTable, aScheme) netLocation:aNetLocation path:aPath params:someParams query:aQuery fragment:aFragment];
 }
 
 + (OWURL *)urlWithScheme:(NSString *)aScheme netLocation:(NSString *)aNetLocation path:(NSString *)aPath params:(NSString *)someParams queryDictionary:(NSDictionary *)queryDictionary fragment:(NSString *)aFragment;
@@ -232,106 +208,219 @@ OBDidLoad(^{
 
 + (OWURL *)urlWithScheme:(NSString *)aScheme schemeSpecificPart:(NSString *)aSchemeSpecificPart fragment:(NSString *)aFragment;
 {
-    return [self urlWithLowercaseScheme:OWFLowercaseStringCacheGet(&lowercaseSchemeCache, aScheme) schemeSpecificPart:aSchemeSpecificPart fragment:aFragment];
+    return [self urlWithLowercaseScheme:OWFInternedString(schemeTable, aScheme) schemeSpecificPart:aSchemeSpecificPart fragment:aFragment];
 }
 
-+ (OWURL *)urlFromString:(NSString *)aString;
+// The parser makes one pass over the string's characters and only records where each component lies; the component strings are made later, if anyone asks for them.
+
+static const NSRange OWURLMissingRange = {NSNotFound, 0};
+
+static inline BOOL _isDelimiter(unichar character, uint8_t delimiterFlag)
 {
-    NSString *aScheme, *aNetLocation;
-    NSString *aPath, *someParams;
-    NSString *aQuery, *aFragment;
-    NSString *aSchemeSpecificPart;
+    return character < 128 && (URLCharacterFlags[character] & delimiterFlag) != 0;
+}
 
-    if (aString == nil || [aString length] == 0)
-	return nil;
+static inline unichar _peekCharacter(const unichar *characters, NSUInteger length, NSUInteger location)
+{
+    return location < length ? characters[location] : '\0';
+}
 
-    OFStringScanner *scanner = [[OFStringScanner alloc] initWithString:aString];
-    scannerScanUpToCharacterInOFCharacterSet(scanner, NonWhitespaceOFCharacterSet);
-    aScheme = [scanner readFullTokenWithDelimiterOFCharacterSet:SchemeDelimiterOFCharacterSet forceLowercase:YES];
-    if (aScheme == nil || [aScheme length] == 0 || scannerReadCharacter(scanner) != ':') {
-        return nil;
+static NSUInteger _skipWhitespace(const unichar *characters, NSUInteger length, NSUInteger location)
+{
+    while (location < length) {
+        unichar character = characters[location];
+        if (character < 128) {
+            if (character != ' ' && (character < '\t' || character > '\r'))
+                break;
+        } else if (!CFCharacterSetIsCharacterMember(WhitespaceAndNewlineCharacterSet, character))
+            break;
+        location++;
+    }
+    return location;
+}
+
+// Returns OWURLMissingRange if there are no characters before the next delimiter.
+static NSRange _scanToken(const unichar *characters, NSUInteger length, NSUInteger *location, uint8_t delimiterFlag)
+{
+    NSUInteger start = *location;
+    while (*location < length && !_isDelimiter(characters[*location], delimiterFlag))
+        (*location)++;
+    return *location == start ? OWURLMissingRange : NSMakeRange(start, *location - start);
+}
+
+static NSRange _scanTokenOrEmpty(const unichar *characters, NSUInteger length, NSUInteger *location, uint8_t delimiterFlag)
+{
+    NSUInteger start = *location;
+    while (*location < length && !_isDelimiter(characters[*location], delimiterFlag))
+        (*location)++;
+    return NSMakeRange(start, *location - start);
+}
+
+static BOOL _parseURLCharacters(const unichar *characters, NSUInteger length, OWURLParse *parse)
+{
+    NSRange *components = parse->components;
+    for (NSUInteger componentIndex = 0; componentIndex < OWURLComponentCount; componentIndex++)
+        components[componentIndex] = OWURLMissingRange;
+
+    NSUInteger location = _skipWhitespace(characters, length, 0);
+    parse->start = location;
+    while (location < length) {
+        unichar character = characters[location];
+        if (character < 128 ? (URLCharacterFlags[character] & OWURLSchemeCharacter) == 0 : !CFCharacterSetIsCharacterMember(LetterCharacterSet, character))
+            break;
+        location++;
     }
-    if (scannerPeekCharacter(scanner) == '/') {
+    parse->scheme = NSMakeRange(parse->start, location - parse->start);
+    if (parse->scheme.length == 0 || _peekCharacter(characters, length, location) != ':')
+        return NO;
+    location++;
+
+    if (_peekCharacter(characters, length, location) == '/') {
         // Scan net location or path
         BOOL pathPresent;
 
-        scannerSkipPeekedCharacter(scanner);
-        if (scannerPeekCharacter(scanner) == '/') {
+        location++;
+        if (_peekCharacter(characters, length, location) == '/') {
             // Scan net location
-            scannerSkipPeekedCharacter(scanner);
-            aNetLocation = [scanner readFullTokenWithDelimiterOFCharacterSet:NetLocationDelimiterOFCharacterSet forceLowercase:NO];
-            if (aNetLocation && [aNetLocation length] == 0)
-                aNetLocation = @"localhost";
-            pathPresent = scannerPeekCharacter(scanner) == '/' || scannerPeekCharacter(scanner) == '\\'; // some stupid sites use backslash as path delimeters
+            location++;
+            components[OWURLNetLocationComponent] = _scanToken(characters, length, &location, OWURLNetLocationDelimiter);
+            unichar character = _peekCharacter(characters, length, location);
+            pathPresent = character == '/' || character == '\\'; // some stupid sites use backslash as path delimeters
             if (pathPresent) {
                 // To be consistent with the non-netLocation case, skip the '/' here, too
-                scannerSkipPeekedCharacter(scanner);
+                location++;
             }
         } else {
-            aNetLocation = nil;
             pathPresent = YES;
         }
-        if (pathPresent) {
-            // Scan path
-            aPath = [scanner readFullTokenWithDelimiterOFCharacterSet:PathDelimiterOFCharacterSet forceLowercase:NO];
-        } else {
-            aPath = nil;
-        }
-    } else {
-        // No net location
-        aNetLocation = nil;
-        if (scannerPeekCharacter(scanner) == '~') {
-            // Scan path that starts with '~'
-            //
-            // I'm not sure this is actually a path URL, maybe URLs with this
-            // form should just drop through to schemeSpecificParams
-            aPath = [scanner readFullTokenWithDelimiterOFCharacterSet:PathDelimiterOFCharacterSet forceLowercase:NO];
-        } else {
-            // No path
-            aPath = nil;
-        }
+        if (pathPresent)
+            components[OWURLPathComponent] = _scanToken(characters, length, &location, OWURLPathDelimiter);
+    } else if (_peekCharacter(characters, length, location) == '~') {
+        // Scan path that starts with '~'
+        //
+        // I'm not sure this is actually a path URL, maybe URLs with this
+        // form should just drop through to schemeSpecificParams
+        components[OWURLPathComponent] = _scanToken(characters, length, &location, OWURLPathDelimiter);
     }
 
-    if (scannerPeekCharacter(scanner) == ';') {
-        // Scan params
-        scannerSkipPeekedCharacter(scanner);
-        someParams = [scanner readFullTokenWithDelimiterOFCharacterSet:ParamDelimiterOFCharacterSet forceLowercase:NO];
-        if (someParams == nil)
-            someParams = @"";
-    } else {
-        someParams = nil;
+    if (_peekCharacter(characters, length, location) == ';') {
+        location++;
+        components[OWURLParamsComponent] = _scanTokenOrEmpty(characters, length, &location, OWURLParamDelimiter);
     }
 
-    if (scannerPeekCharacter(scanner) == '?') {
-        // Scan query
-        scannerSkipPeekedCharacter(scanner);
-        aQuery = [scanner readFullTokenWithDelimiterOFCharacterSet:QueryDelimiterOFCharacterSet forceLowercase:NO];
-        if (aQuery == nil)
-            aQuery = @"";
-    } else {
-        aQuery = nil;
+    if (_peekCharacter(characters, length, location) == '?') {
+        location++;
+        components[OWURLQueryComponent] = _scanTokenOrEmpty(characters, length, &location, OWURLQueryDelimiter);
     }
 
-    if (aNetLocation == nil && aPath == nil && someParams == nil && aQuery == nil) {
-        // Scan scheme-specific part
-        aSchemeSpecificPart = [scanner readFullTokenWithDelimiterOFCharacterSet:SchemeSpecificPartDelimiterOFCharacterSet forceLowercase:NO];
-    } else {
-        aSchemeSpecificPart = nil;
+    if (components[OWURLNetLocationComponent].location == NSNotFound && components[OWURLPathComponent].location == NSNotFound && components[OWURLParamsComponent].location == NSNotFound && components[OWURLQueryComponent].location == NSNotFound)
+        components[OWURLSchemeSpecificPartComponent] = _scanToken(characters, length, &location, OWURLSchemeSpecificPartDelimiter);
+
+    if (_peekCharacter(characters, length, location) == '#') {
+        location++;
+        components[OWURLFragmentComponent] = _scanTokenOrEmpty(characters, length, &location, OWURLFragmentDelimiter);
     }
 
-    if (scannerPeekCharacter(scanner) == '#') {
-        // Scan fragment
-        scannerSkipPeekedCharacter(scanner);
-        aFragment = [scanner readFullTokenWithDelimiterOFCharacterSet:FragmentDelimiterOFCharacterSet forceLowercase:NO];
-        if (!aFragment)
-            aFragment = @"";
+    return YES;
+}
+
+static inline BOOL _expectCharacter(const unichar *characters, NSUInteger length, NSUInteger *cursor, unichar character)
+{
+    if (*cursor >= length || characters[*cursor] != character)
+        return NO;
+    (*cursor)++;
+    return YES;
+}
+
+static inline BOOL _expectComponent(NSUInteger *cursor, NSRange range)
+{
+    if (range.location != *cursor)
+        return NO;
+    *cursor += range.length;
+    return YES;
+}
+
+// Whether -_newURLStringWithEncodedHostname:NO would spell the parsed URL exactly as it was written (ignoring leading whitespace). Since the components all point into the string, that just means walking the composite string's layout and checking that each piece starts where the last one ended.
+static BOOL _parsedStringIsComposite(const unichar *characters, NSUInteger length, const OWURLParse *parse, BOOL isFileScheme)
+{
+    for (NSUInteger characterIndex = parse->scheme.location; characterIndex < NSMaxRange(parse->scheme); characterIndex++) {
+        unichar character = characters[characterIndex];
+        if ((character >= 'A' && character <= 'Z') || character >= 128)
+            return NO;
+    }
+
+    const NSRange *components = parse->components;
+    NSUInteger cursor = NSMaxRange(parse->scheme);
+    if (!_expectCharacter(characters, length, &cursor, ':'))
+        return NO;
+
+    if (components[OWURLSchemeSpecificPartComponent].location != NSNotFound) {
+        if (!_expectComponent(&cursor, components[OWURLSchemeSpecificPartComponent]))
+            return NO;
     } else {
-        aFragment = nil;
+        BOOL hasNetLocation = components[OWURLNetLocationComponent].location != NSNotFound;
+        BOOL hasPath = components[OWURLPathComponent].location != NSNotFound;
+        BOOL hasParams = components[OWURLParamsComponent].location != NSNotFound;
+
+        if (hasNetLocation || isFileScheme) {
+            if (!_expectCharacter(characters, length, &cursor, '/') || !_expectCharacter(characters, length, &cursor, '/'))
+                return NO;
+            if (hasNetLocation && !_expectComponent(&cursor, components[OWURLNetLocationComponent]))
+                return NO;
+        }
+        if (hasNetLocation || hasPath || hasParams) {
+            if (!_expectCharacter(characters, length, &cursor, '/'))
+                return NO;
+            if (hasPath && !_expectComponent(&cursor, components[OWURLPathComponent]))
+                return NO;
+            if (hasParams && (!_expectCharacter(characters, length, &cursor, ';') || !_expectComponent(&cursor, components[OWURLParamsComponent])))
+                return NO;
+        }
+        if (components[OWURLQueryComponent].location != NSNotFound && (!_expectCharacter(characters, length, &cursor, '?') || !_expectComponent(&cursor, components[OWURLQueryComponent])))
+            return NO;
     }
+    if (components[OWURLFragmentComponent].location != NSNotFound && (!_expectCharacter(characters, length, &cursor, '#') || !_expectComponent(&cursor, components[OWURLFragmentComponent])))
+        return NO;
 
-    if (aSchemeSpecificPart != nil)
-	return [self urlWithLowercaseScheme:aScheme schemeSpecificPart:aSchemeSpecificPart fragment:aFragment];
-    return [self urlWithLowercaseScheme:aScheme netLocation:aNetLocation path:aPath params:someParams query:aQuery fragment:aFragment];
+    return cursor == length;
+}
+
+// Returns the string's characters, either directly or copied into stackBuffer (if there's room) or into a newly allocated buffer that the caller has to free.
+static const unichar *_charactersOfString(NSString *string, NSUInteger length, unichar *stackBuffer, NSUInteger stackBufferLength, unichar **allocatedBuffer)
+{
+    *allocatedBuffer = NULL;
+    const unichar *characters = CFStringGetCharactersPtr((__bridge CFStringRef)string);
+    if (characters != NULL)
+        return characters;
+
+    unichar *buffer = stackBuffer;
+    if (length > stackBufferLength)
+        buffer = *allocatedBuffer = malloc(length * sizeof(unichar));
+    [string getCharacters:buffer range:NSMakeRange(0, length)];
+    return buffer;
+}
+
+#define OWURLStackBufferLength 512
+
++ (OWURL *)urlFromString:(NSString *)aString;
+{
+    NSUInteger length = [aString length];
+    if (length == 0)
+	return nil;
+
+    unichar stackBuffer[OWURLStackBufferLength], *allocatedBuffer;
+    const unichar *characters = _charactersOfString(aString, length, stackBuffer, OWURLStackBufferLength, &allocatedBuffer);
+
+    OWURL *url = nil;
+    OWURLParse parse;
+    if (_parseURLCharacters(characters, length, &parse)) {
+        NSString *aScheme = OWFInternedStringForCharacters(schemeTable, characters + parse.scheme.location, parse.scheme.length);
+        url = [[self alloc] _initWithLowercaseScheme:aScheme parsedString:aString characters:characters parse:&parse];
+    }
+
+    if (allocatedBuffer != NULL)
+        free(allocatedBuffer);
+    return url;
 }
 
 + (OWURL *)urlFromDirtyString:(NSString *)aString;
@@ -341,7 +430,30 @@ OBDidLoad(^{
 
 + (OWURL *)urlFromFilthyString:(NSString *)aString;
 {
-    aString = [aString stringByRemovingRegularExpression:backslashThenWhitespaceRegularExpression];
+    // Remove each backslash that is followed by whitespace, along with the whitespace.
+    NSUInteger length = [aString length];
+    if ([aString rangeOfString:@"\\"].length != 0) {
+        unichar stackBuffer[OWURLStackBufferLength], *allocatedBuffer;
+        const unichar *characters = _charactersOfString(aString, length, stackBuffer, OWURLStackBufferLength, &allocatedBuffer);
+        NSMutableString *cleanedString = [NSMutableString stringWithCapacity:length];
+        NSUInteger spanStart = 0, location = 0;
+        while (location < length) {
+            NSUInteger whitespaceEnd = location + 1;
+            if (characters[location] == '\\') {
+                while (whitespaceEnd < length && (characters[whitespaceEnd] == ' ' || characters[whitespaceEnd] == '\n' || characters[whitespaceEnd] == '\r' || characters[whitespaceEnd] == '\t'))
+                    whitespaceEnd++;
+            }
+            if (whitespaceEnd > location + 1) {
+                CFStringAppendCharacters((__bridge CFMutableStringRef)cleanedString, characters + spanStart, location - spanStart);
+                spanStart = location = whitespaceEnd;
+            } else
+                location++;
+        }
+        CFStringAppendCharacters((__bridge CFMutableStringRef)cleanedString, characters + spanStart, length - spanStart);
+        if (allocatedBuffer != NULL)
+            free(allocatedBuffer);
+        aString = cleanedString;
+    }
     
     return [self urlFromString:[self cleanURLString:aString]];
 }
@@ -357,10 +469,35 @@ OBDidLoad(^{
 
 + (NSString *)cleanURLString:(NSString *)aString;
 {
-    if (aString == nil || [aString length] == 0)
+    NSUInteger length = [aString length];
+    if (length == 0)
 	return nil;
 
-    aString = [[aString stringByRemovingRegularExpression:newlinesAndSurroundingWhitespaceRegularExpression] stringByRemovingSurroundingWhitespace];
+    // Remove newlines along with any spaces and tabs around them.
+    unichar stackBuffer[OWURLStackBufferLength], *allocatedBuffer;
+    const unichar *characters = _charactersOfString(aString, length, stackBuffer, OWURLStackBufferLength, &allocatedBuffer);
+    NSUInteger location = 0;
+    while (location < length && characters[location] != '\n' && characters[location] != '\r')
+        location++;
+    if (location < length) {
+        unichar *cleanedCharacters = malloc(length * sizeof(unichar));
+        NSUInteger cleanedLength = 0;
+        for (location = 0; location < length; location++) {
+            unichar character = characters[location];
+            if (character == '\n' || character == '\r') {
+                while (cleanedLength > 0 && (cleanedCharacters[cleanedLength - 1] == ' ' || cleanedCharacters[cleanedLength - 1] == '\t'))
+                    cleanedLength--;
+                while (location + 1 < length && (characters[location + 1] == ' ' || characters[location + 1] == '\t'))
+                    location++;
+            } else
+                cleanedCharacters[cleanedLength++] = character;
+        }
+        aString = [[NSString alloc] initWithCharactersNoCopy:cleanedCharacters length:cleanedLength freeWhenDone:YES];
+    }
+    if (allocatedBuffer != NULL)
+        free(allocatedBuffer);
+
+    aString = [aString stringByRemovingSurroundingWhitespace];
     if ([aString hasPrefix:@"<"]) {
 	aString = [aString substringFromIndex:1];
         if ([aString hasSuffix:@">"])
@@ -571,31 +708,37 @@ OBDidLoad(^{
 
 - (NSString *)netLocation;
 {
+    _ensureComponents(self);
     return netLocation;
 }
 
 - (NSString *)path;
 {
+    _ensureComponents(self);
     return path;
 }
 
 - (NSString *)params;
 {
+    _ensureComponents(self);
     return params;
 }
 
 - (NSString *)query;
 {
+    _ensureComponents(self);
     return query;
 }
 
 - (NSString *)fragment;
 {
+    _ensureComponents(self);
     return fragment;
 }
 
 - (NSString *)schemeSpecificPart;
 {
+    _ensureComponents(self);
     return schemeSpecificPart;
 }
 
@@ -612,6 +755,7 @@ OBDidLoad(^{
 
 - (NSString *)cacheKey;
 {
+    _ensureComponents(self);
     os_unfair_lock_lock(&derivedAttributesLock);
     if (_cacheKey == nil) {
         NSMutableString *key;
@@ -649,6 +793,7 @@ OBDidLoad(^{
 // This is possibly not the best name or this method.  Basically this is just the code from -compositeString except we don't append the path, params, query or fragment.  This is used in OmniWeb in the address completion code.
 - (NSString *)stringToNetLocation;
 {
+    _ensureComponents(self);
     NSMutableString *string = [NSMutableString stringWithString:scheme];
     [string appendString:@":"];
 
@@ -665,6 +810,7 @@ OBDidLoad(^{
 
 - (NSString *)fetchPath;
 {
+    _ensureComponents(self);
     if (schemeSpecificPart) {
         return schemeSpecificPart;
     } else {
@@ -702,6 +848,7 @@ OBDidLoad(^{
 
 - (NSString *)proxyFetchPath;
 {
+    _ensureComponents(self);
     // Yes, this ends up looking a lot like our -cacheKey, except we're calling -fetchPath so the NetscapeCompatibleRelativeAddresses preference will kick in (and we don't want it to kick in for our -cacheKey because it's relatively expensive and -cacheKey gets called a lot more).
 
     NSMutableString *proxyFetchPath = [[NSMutableString alloc] initWithString:scheme];
@@ -716,21 +863,25 @@ OBDidLoad(^{
 
 - (NSArray *)pathComponents;
 {
+    _ensureComponents(self);
     return [OWURL pathComponentsForPath:path];
 }
 
 - (NSString *)lastPathComponent;
 {
+    _ensureComponents(self);
     return [OWURL lastPathComponentForPath:path];
 }
 
 - (NSString *)stringByDeletingLastPathComponent;
 {
+    _ensureComponents(self);
     return [OWURL stringByDeletingLastPathComponentFromPath:path];
 }
 
 - (OWNetLocation *)parsedNetLocation;
 {
+    _ensureComponents(self);
     os_unfair_lock_lock(&derivedAttributesLock);
     if (_cachedParsedNetLocation == nil)
         [self _locked_parseNetLocation];
@@ -758,6 +909,7 @@ OBDidLoad(^{
 
 - (NSString *)shortDisplayString;
 {
+    _ensureComponents(self);
     os_unfair_lock_lock(&derivedAttributesLock);
     if (_cachedShortDisplayString == nil) {
         NSMutableString *shortDisplayString;
@@ -874,64 +1026,163 @@ OBDidLoad(^{
 
 //
 
-- (OWURL *)urlFromRelativeString:(NSString *)aString;
+static NSString *_stringForRange(NSString *string, NSRange range)
 {
-    OWURL *absoluteURL;
-    NSString *aNetLocation;
-    NSString *aPath, *someParams, *aQuery, *aFragment;
-    OFStringScanner *scanner;
+    if (range.location == NSNotFound)
+        return nil;
+    if (range.length == 0)
+        return @"";
+    return [string substringWithRange:range];
+}
 
-    absoluteURL = [OWURL urlFromString:aString];
-    if (absoluteURL) {
-        if (schemeSpecificPart) {
-            // If our scheme uses a non-uniform URL syntax, relative URLs are illegal
-            return absoluteURL;
+static NSString *_netLocationForRange(NSString *string, const unichar *characters, NSRange range)
+{
+    if (range.location == NSNotFound)
+        return nil;
+
+    // Plain host names (and ports) are shared between URLs; anything with a username or password in it isn't kept around.
+    for (NSUInteger characterIndex = range.location; characterIndex < NSMaxRange(range); characterIndex++) {
+        if (characters[characterIndex] == '@')
+            return [string substringWithRange:range];
+    }
+    return OWFInternedStringForCharacters(netLocationTable, characters + range.location, range.length);
+}
+
+// Whether any segment of the relative path is "." or "..".
+static BOOL _pathHasDotSegments(const unichar *characters, NSRange range)
+{
+    NSUInteger segmentStart = range.location;
+    for (NSUInteger location = range.location; location <= NSMaxRange(range); location++) {
+        if (location < NSMaxRange(range) && characters[location] != '/')
+            continue;
+        NSUInteger segmentLength = location - segmentStart;
+        if ((segmentLength == 1 || segmentLength == 2) && characters[segmentStart] == '.' && characters[location - 1] == '.')
+            return YES;
+        segmentStart = location + 1;
+    }
+    return NO;
+}
+
+static NSString *_pathByResolvingRelativePath(NSString *basePath, NSString *relativePath)
+{
+    NSMutableArray *pathElements;
+    NSUInteger preserveCount = 0, pathElementCount;
+    NSArray *relativePathArray;
+    NSUInteger relativePathIndex, relativePathCount;
+    BOOL lastElementWasDirectory = NO;
+
+    if (basePath == nil || [basePath length] == 0)
+        pathElements = [NSMutableArray arrayWithCapacity:1];
+    else
+        pathElements = [[OWURL pathComponentsForPath:basePath] mutableCopy];
+    pathElementCount = [pathElements count];
+    if (pathElementCount != 0) {
+        if ([[pathElements objectAtIndex:0] length] == 0)
+            preserveCount = 1;
+        if (pathElementCount > preserveCount)
+            [pathElements removeLastObject];
+    }
+    relativePathArray = [OWURL pathComponentsForPath:relativePath];
+    relativePathCount = [relativePathArray count];
+    for (relativePathIndex = 0; relativePathIndex < relativePathCount; relativePathIndex++) {
+        NSString *pathElement;
+
+        pathElement = [relativePathArray objectAtIndex:relativePathIndex];
+        if ([pathElement isEqualToString:@".."]) {
+            lastElementWasDirectory = YES;
+            if ([pathElements count] > preserveCount)
+                [pathElements removeLastObject];
+            else {
+                if (NetscapeCompatibleRelativeAddresses) {
+                    // Netscape doesn't preserve leading ..'s
+                } else {
+                    [pathElements addObject:pathElement];
+                    preserveCount++;
+                }
+            }
+        } else if ([pathElement isEqualToString:@"."]) {
+            lastElementWasDirectory = YES;
+        } else {
+            lastElementWasDirectory = NO;
+            [pathElements addObject:pathElement];
         }
+    }
+    if (lastElementWasDirectory && [[pathElements lastObject] length] != 0) {
+        [pathElements addObject:@""];
+    }
+    return [pathElements componentsJoinedByString:@"/"];
+}
+
+- (OWURL *)urlFromRelativeString:(NSString *)aString;
+{
+    _ensureComponents(self);
+
+    NSUInteger length = [aString length];
+    unichar stackBuffer[OWURLStackBufferLength], *allocatedBuffer;
+    const unichar *characters = _charactersOfString(aString, length, stackBuffer, OWURLStackBufferLength, &allocatedBuffer);
+
+    OWURL *resultURL = nil;
+    OWURLParse parse;
+    if (length != 0 && _parseURLCharacters(characters, length, &parse)) {
+        NSString *aScheme = OWFInternedStringForCharacters(schemeTable, characters + parse.scheme.location, parse.scheme.length);
+        OWURL *absoluteURL = [[OWURL alloc] _initWithLowercaseScheme:aScheme parsedString:aString characters:characters parse:&parse];
 
-        if (NetscapeCompatibleRelativeAddresses && [scheme isEqualToString:[absoluteURL scheme]] && ![absoluteURL netLocation]) {
+        if (!schemeSpecificPart && NetscapeCompatibleRelativeAddresses && [scheme isEqualToString:aScheme] && ![absoluteURL netLocation]) {
             NSString *otherFetchPath, *otherFragment;
 
             // For Netscape compatibility, treat "http:whatever" as a relative link to "whatever".
 
             otherFetchPath = [absoluteURL fetchPath];
             otherFragment = [absoluteURL fragment];
-            if (otherFragment)
-                aString = [NSString stringWithFormat:@"%@#%@", otherFetchPath, otherFragment];
-            else
-                aString = otherFetchPath;
-            absoluteURL = nil;
+            NSString *relativeString = otherFragment != nil ? [NSString stringWithFormat:@"%@#%@", otherFetchPath, otherFragment] : otherFetchPath;
+            NSUInteger relativeLength = [relativeString length];
+            if (relativeLength == 0) {
+                resultURL = self;
+            } else {
+                unichar relativeStackBuffer[OWURLStackBufferLength], *relativeAllocatedBuffer;
+                const unichar *relativeCharacters = _charactersOfString(relativeString, relativeLength, relativeStackBuffer, OWURLStackBufferLength, &relativeAllocatedBuffer);
+                resultURL = [self _urlFromRelativeCharacters:relativeCharacters length:relativeLength ofString:relativeString];
+                if (relativeAllocatedBuffer != NULL)
+                    free(relativeAllocatedBuffer);
+            }
         } else {
-            return absoluteURL;
+            // If our scheme uses a non-uniform URL syntax, relative URLs are illegal
+            resultURL = absoluteURL;
         }
+    } else if (length == 0) {
+        resultURL = self;
+    } else {
+        resultURL = [self _urlFromRelativeCharacters:characters length:length ofString:aString];
     }
 
-    if (aString == nil || [aString length] == 0)
-	return self;
+    if (allocatedBuffer != NULL)
+        free(allocatedBuffer);
+    return resultURL;
+}
 
+- (OWURL *)_urlFromRelativeCharacters:(const unichar *)characters length:(NSUInteger)length ofString:(NSString *)aString;
+{
     // Relative URLs default to the current location
-    aNetLocation = netLocation;
-    aPath = path;
-    someParams = params;
-    aQuery = query;
-    aFragment = fragment;
-
-    scanner = [[OFStringScanner alloc] initWithString:aString];
-    scannerScanUpToCharacterInOFCharacterSet(scanner, NonWhitespaceOFCharacterSet);
-    if (scannerPeekCharacter(scanner) == '/') {
+    NSString *aNetLocation = netLocation;
+    NSString *aPath = path;
+    NSString *someParams = params;
+    NSString *aQuery = query;
+    NSString *aFragment = fragment;
+
+    NSUInteger location = _skipWhitespace(characters, length, 0);
+    if (_peekCharacter(characters, length, location) == '/') {
         // Scan net location or absolute path
         BOOL absolutePathPresent;
 
-        scannerSkipPeekedCharacter(scanner);
-        if (scannerPeekCharacter(scanner) == '/') {
+        location++;
+        if (_peekCharacter(characters, length, location) == '/') {
             // Scan net location
-            scannerSkipPeekedCharacter(scanner);
-            aNetLocation = [scanner readFullTokenWithDelimiterOFCharacterSet:NetLocationDelimiterOFCharacterSet forceLowercase:NO];
-            if (aNetLocation != nil && [aNetLocation length] == 0)
-                aNetLocation = @"localhost";
-            absolutePathPresent = scannerPeekCharacter(scanner) == '/';
+            location++;
+            aNetLocation = _netLocationForRange(aString, characters, _scanToken(characters, length, &location, OWURLNetLocationDelimiter));
+            absolutePathPresent = _peekCharacter(characters, length, location) == '/';
             if (absolutePathPresent) {
                 // To be consistent with the non-netLocation case, skip the '/' here, too
-                scannerSkipPeekedCharacter(scanner);
+                location++;
             }
         } else {
             // That slash started a path, not a net location
@@ -941,7 +1192,7 @@ OBDidLoad(^{
             OWURL *fakeRootURL;
 
             // Scan path
-            aPath = [scanner readFullTokenWithDelimiterOFCharacterSet:PathDelimiterOFCharacterSet forceLowercase:NO];
+            aPath = _stringForRange(aString, _scanToken(characters, length, &location, OWURLPathDelimiter));
             fakeRootURL = [self fakeRootURL];
             if (fakeRootURL)
                 aPath = [[fakeRootURL urlFromRelativeString:aPath] path];
@@ -953,87 +1204,48 @@ OBDidLoad(^{
         someParams = nil;
         aQuery = nil;
         aFragment = nil;
-    } else if (scannerHasData(scanner) && !OFCharacterSetHasMember(PathDelimiterOFCharacterSet, scannerPeekCharacter(scanner))) {
+    } else if (location < length && !_isDelimiter(characters[location], OWURLPathDelimiter)) {
         // Scan relative path
-	NSMutableArray *pathElements;
-	NSUInteger preserveCount = 0, pathElementCount;
-	NSArray *relativePathArray;
-	NSUInteger relativePathIndex, relativePathCount;
-	BOOL lastElementWasDirectory = NO;
-
-        aPath = [scanner readFullTokenWithDelimiterOFCharacterSet:PathDelimiterOFCharacterSet forceLowercase:NO];
-
-        if (path == nil || [path length] == 0)
-	    pathElements = [NSMutableArray arrayWithCapacity:1];
-	else
-            pathElements = [[OWURL pathComponentsForPath:path] mutableCopy];
-	pathElementCount = [pathElements count];
-	if (pathElementCount != 0) {
-	    if ([[pathElements objectAtIndex:0] length] == 0)
-		preserveCount = 1;
-	    if (pathElementCount > preserveCount)
-		[pathElements removeLastObject];
-	}
-        relativePathArray = [OWURL pathComponentsForPath:aPath];
-	relativePathCount = [relativePathArray count];
-	for (relativePathIndex = 0; relativePathIndex < relativePathCount; relativePathIndex++) {
-	    NSString *pathElement;
-
-	    pathElement = [relativePathArray objectAtIndex:relativePathIndex];
-	    if ([pathElement isEqualToString:@".."]) {
-		lastElementWasDirectory = YES;
-		if ([pathElements count] > preserveCount)
-		    [pathElements removeLastObject];
-		else {
-		    if (NetscapeCompatibleRelativeAddresses) {
-			// Netscape doesn't preserve leading ..'s
-		    } else {
-			[pathElements addObject:pathElement];
-			preserveCount++;
-		    }
-		}
-	    } else if ([pathElement isEqualToString:@"."]) {
-		lastElementWasDirectory = YES;
-	    } else {
-		lastElementWasDirectory = NO;
-		[pathElements addObject:pathElement];
-	    }
-	}
-	if (lastElementWasDirectory && [[pathElements lastObject] length] != 0) {
-	    [pathElements addObject:@""];
-	}
-	aPath = [pathElements componentsJoinedByString:@"/"];
+        NSRange relativePathRange = _scanToken(characters, length, &location, OWURLPathDelimiter);
+
+        if (!_pathHasDotSegments(characters, relativePathRange)) {
+            // Without "." or ".." segments, resolving the path just replaces everything after the base path's last slash.
+            NSString *relativePath = [aString substringWithRange:relativePathRange];
+            NSRange lastSlashRange = path != nil ? [path rangeOfString:@"/" options:NSLiteralSearch | NSBackwardsSearch] : NSMakeRange(NSNotFound, 0);
+            if (lastSlashRange.length == 0)
+                aPath = relativePath;
+            else
+                aPath = [[path substringToIndex:NSMaxRange(lastSlashRange)] stringByAppendingString:relativePath];
+        } else {
+            aPath = _pathByResolvingRelativePath(path, [aString substringWithRange:relativePathRange]);
+        }
 
         // Reset remaining parameters
         someParams = nil;
         aQuery = nil;
         aFragment = nil;
     }
-    if (scannerPeekCharacter(scanner) == ';') {
+    if (_peekCharacter(characters, length, location) == ';') {
         // Scan params
-        scannerSkipPeekedCharacter(scanner);
-        someParams = [scanner readFullTokenWithDelimiterOFCharacterSet:ParamDelimiterOFCharacterSet forceLowercase:NO];
+        location++;
+        someParams = _stringForRange(aString, _scanToken(characters, length, &location, OWURLParamDelimiter));
 
         // Reset remaining parameters
         aQuery = nil;
         aFragment = nil;
     }
-    if (scannerPeekCharacter(scanner) == '?') {
+    if (_peekCharacter(characters, length, location) == '?') {
         // Scan query
-        scannerSkipPeekedCharacter(scanner);
-        aQuery = [scanner readFullTokenWithDelimiterOFCharacterSet:QueryDelimiterOFCharacterSet forceLowercase:NO];
-        if (aQuery == nil)
-            aQuery = @"";
+        location++;
+        aQuery = _stringForRange(aString, _scanTokenOrEmpty(characters, length, &location, OWURLQueryDelimiter));
 
         // Reset remaining parameters
         aFragment = nil;
     }
-    if (scannerPeekCharacter(scanner) == '#') {
+    if (_peekCharacter(characters, length, location) == '#') {
         // Scan fragment
-        scannerSkipPeekedCharacter(scanner);
-        aFragment = [scanner readFullTokenWithDelimiterOFCharacterSet:FragmentDelimiterOFCharacterSet forceLowercase:NO];
-        if (!aFragment)
-            aFragment = @"";
+        location++;
+        aFragment = _stringForRange(aString, _scanTokenOrEmpty(characters, length, &location, OWURLFragmentDelimiter));
     }
 
     return [OWURL urlWithLowercaseScheme:scheme netLocation:aNetLocation path:aPath params:someParams query:aQuery fragment:aFragment];
@@ -1041,11 +1253,13 @@ OBDidLoad(^{
 
 - (OWURL *)urlForPath:(NSString *)newPath;
 {
+    _ensureComponents(self);
     return [OWURL urlWithLowercaseScheme:scheme netLocation:netLocation path:newPath params:nil query:nil fragment:nil];
 }
 
 - (OWURL *)urlForQuery:(NSString *)newQuery;
 {
+    _ensureComponents(self);
 #warning Bring this MSIE compatibility preference (appending queries) out to the UI?
     /* Some forms pages depend on this behavior */
 #if 0
@@ -1058,6 +1272,7 @@ OBDidLoad(^{
 
 - (OWURL *)urlWithoutFragment;
 {
+    _ensureComponents(self);
     if (!fragment)
 	return self;
     return [OWURL urlWithLowercaseScheme:scheme netLocation:netLocation path:path params:params query:query fragment:nil];
@@ -1065,6 +1280,7 @@ OBDidLoad(^{
 
 - (OWURL *)urlWithFragment:(NSString *)newFragment
 {
+    _ensureComponents(self);
     if (newFragment == fragment ||
         [fragment isEqualToString:newFragment])
         return self;
@@ -1074,6 +1290,7 @@ OBDidLoad(^{
 
 - (OWURL *)urlWithoutUsernamePasswordOrFragment;
 {
+    _ensureComponents(self);
     OWNetLocation *parsedLocation = [self parsedNetLocation];
     if ([parsedLocation username] == nil && [parsedLocation password] == nil && fragment == nil)
         return self;
@@ -1083,6 +1300,7 @@ OBDidLoad(^{
 
 - (OWURL *) baseURL;
 {
+    _ensureComponents(self);
     BOOL hasTrailingSlash;
     NSString *basePath;
     
@@ -1110,6 +1328,8 @@ OBDidLoad(^{
 
 - (id)copyWithZone:(NSZone *)zone
 {
+    _ensureComponents(self);
+
     OWURL *newURL = [[[self class] allocWithZone:zone] init];
     
     newURL->scheme = [scheme copyWithZone:zone];
@@ -1119,6 +1339,8 @@ OBDidLoad(^{
     newURL->query = [query copyWithZone:zone];
     newURL->fragment = [fragment copyWithZone:zone];
     newURL->schemeSpecificPart = [schemeSpecificPart copyWithZone:zone];
+    newURL->_parsedComponentsLock = OS_UNFAIR_LOCK_INIT;
+    atomic_init(&newURL->_componentsAreMaterialized, true);
         
     return newURL;
 }
@@ -1127,6 +1349,7 @@ OBDidLoad(^{
 
 - (NSMutableDictionary *)debugDictionary;
 {
+    _ensureComponents(self);
     NSMutableDictionary *debugDictionary;
 
     debugDictionary = [super debugDictionary];
@@ -1190,9 +1413,53 @@ OBDidLoad(^{
     }
     scheme = aScheme;
     derivedAttributesLock = OS_UNFAIR_LOCK_INIT;
+    _parsedComponentsLock = OS_UNFAIR_LOCK_INIT;
+    atomic_init(&_componentsAreMaterialized, true);
     return self;
 }
 
+- _initWithLowercaseScheme:(NSString *)aScheme parsedString:(NSString *)aString characters:(const unichar *)characters parse:(const OWURLParse *)parse;
+{
+    if (!(self = [self _initWithLowercaseScheme:aScheme]))
+        return nil;
+
+    _parsedString = [aString copy];
+    for (NSUInteger componentIndex = 0; componentIndex < OWURLComponentCount; componentIndex++)
+        _parsedComponentRanges[componentIndex] = parse->components[componentIndex];
+    atomic_init(&_componentsAreMaterialized, false);
+
+    // Most URLs are written just the way we'd write them, in which case the string they came from already is their composite string.
+    if (_parsedStringIsComposite(characters, [_parsedString length], parse, [aScheme isEqualToString:@"file"]))
+        _cachedCompositeString = parse->start == 0 ? _parsedString : [_parsedString substringFromIndex:parse->start];
+
+    OBPOSTCONDITION(_cachedCompositeString == nil || [_cachedCompositeString isEqualToString:[self _newURLStringWithEncodedHostname:NO]]);
+    return self;
+}
+
+- (void)_materializeParsedComponents;
+{
+    os_unfair_lock_lock(&_parsedComponentsLock);
+    if (!atomic_load_explicit(&_componentsAreMaterialized, memory_order_relaxed)) {
+        if (_parsedString != nil) {
+            if (_parsedComponentRanges[OWURLNetLocationComponent].location != NSNotFound) {
+                unichar stackBuffer[OWURLStackBufferLength], *allocatedBuffer;
+                const unichar *characters = _charactersOfString(_parsedString, [_parsedString length], stackBuffer, OWURLStackBufferLength, &allocatedBuffer);
+                netLocation = _netLocationForRange(_parsedString, characters, _parsedComponentRanges[OWURLNetLocationComponent]);
+                if (allocatedBuffer != NULL)
+                    free(allocatedBuffer);
+            }
+            path = _stringForRange(_parsedString, _parsedComponentRanges[OWURLPathComponent]);
+            params = _stringForRange(_parsedString, _parsedComponentRanges[OWURLParamsComponent]);
+            query = _stringForRange(_parsedString, _parsedComponentRanges[OWURLQueryComponent]);
+            fragment = _stringForRange(_parsedString, _parsedComponentRanges[OWURLFragmentComponent]);
+            schemeSpecificPart = _stringForRange(_parsedString, _parsedComponentRanges[OWURLSchemeSpecificPartComponent]);
+            _parsedString = nil;
+        }
+        atomic_store_explicit(&_componentsAreMaterialized, true, memory_order_release);
+    }
+    os_unfair_lock_unlock(&_parsedComponentsLock);
+}
+
 - initWithLowercaseScheme:(NSString *)aScheme netLocation:(NSString *)aNetLocation path:(NSString *)aPath params:(NSString *)someParams query:(NSString *)aQuery fragment:(NSString *)aFragment;
 {
     if (!(self = [self _initWithLowercaseScheme:aScheme]))
@@ -1212,7 +1479,7 @@ OBDidLoad(^{
 
 - initWithScheme:(NSString *)aScheme netLocation:(NSString *)aNetLocation path:(NSString *)aPath params:(NSString *)someParams query:(NSString *)aQuery fragment:(NSString *)aFragment;
 {
-    return [self initWithLowercaseScheme:OWFLowercaseStringCacheGet(&lowercaseSchemeCache, aScheme) netLocation:aNetLocation path:aPath params:someParams query:aQuery fragment:aFragment];
+    return [self initWithLowercaseScheme:OWFInternedString(schemeTable, aScheme) netLocation:aNetLocation path:aPath params:someParams query:aQuery fragment:aFragment];
 }
 
 - initWithLowercaseScheme:(NSString *)aScheme schemeSpecificPart:(NSString *)aSchemeSpecificPart fragment:(NSString *)aFragment;
@@ -1228,7 +1495,7 @@ OBDidLoad(^{
 
 - initWithScheme:(NSString *)aScheme schemeSpecificPart:(NSString *)aSchemeSpecificPart fragment:(NSString *)aFragment;
 {
-    return [self initWithLowercaseScheme:OWFLowercaseStringCacheGet(&lowercaseSchemeCache, aScheme) schemeSpecificPart:aSchemeSpecificPart fragment:aFragment];
+    return [self initWithLowercaseScheme:OWFInternedString(schemeTable, aScheme) schemeSpecificPart:aSchemeSpecificPart fragment:aFragment];
 }
 
 - (OWURL *)fakeRootURL;
@@ -1261,6 +1528,7 @@ OBDidLoad(^{
 
 - (NSString *)_newURLStringWithEncodedHostname:(BOOL)shouldEncode;
 {
+    _ensureComponents(self);
     NSMutableString *compositeString;
     
     compositeString = [[NSMutableString alloc] initWithString:scheme];
@@ -24,6 +24,12 @@ typedef struct _OWDataStreamBufferDescriptor {
     struct _OWDataStreamBufferDescriptor * volatile next;
 } OWDataStreamBufferDescriptor;
 
+// A block and the offset it starts at. The block index is an array of these, and cursors keep one to remember the block they last read from, so that sequential reads don't need to look up their offset again.
+typedef struct {
+    NSUInteger blockStart;
+    OWDataStreamBufferDescriptor *block;
+} OWDataStreamBlockHint;
+
 enum OWStringEncodingProvenance {
         // these are ordered: later enums in this list can override earlier ones.
         OWStringEncodingProvenance_Default,             // Global default encoding
@@ -43,6 +49,12 @@ enum OWStringEncodingProvenance {
     pthread_cond_t lengthChangedCondition;
     
     OWDataStreamBufferDescriptor *_first, *_last;
+
+    // Start offset of every block ever allocated, in order, for binary searching by offset. Only the writer appends; readers see a consistent prefix because each entry is stored before the count is bumped, and arrays that get outgrown are kept (not freed) until dealloc since readers may still be looking at them.
+    OWDataStreamBlockHint * volatile _blockIndex;
+    volatile NSUInteger _blockIndexCount;
+    NSUInteger _blockIndexCapacity;
+    NSMutableArray *_retiredBlockIndexes;
     NSUInteger dataLength;      // total number of bytes in stream, if EOF reached or if known ahead of time
     NSUInteger readLength;      // total number of bytes written to stream (available for reading) so far
 
@@ -123,6 +135,13 @@ enum OWStringEncodingProvenance {
 
 @end
 
+@interface OWDataStream (CursorSupport)
+// Variants of the random access methods used by OWDataStreamConcreteCursor, which check (and update) the hint before searching the block index.
+- (BOOL)_getBytes:(void *)buffer range:(NSRange)range blockHint:(OWDataStreamBlockHint *)hint;
+- (NSData *)_dataWithRange:(NSRange)range blockHint:(OWDataStreamBlockHint *)hint;
+- (NSUInteger)_accessUnderlyingBuffer:(void **)returnedBufferPtr startingAtLocation:(NSUInteger)dataOffset blockHint:(OWDataStreamBlockHint *)hint;
+@end
+
 extern const NSUInteger OWDataStreamUnknownLength;
 extern NSString * const OWDataStreamNoLongerValidException;
 
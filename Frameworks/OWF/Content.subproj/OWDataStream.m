@@ -17,6 +17,7 @@
 #import <OWF/OWDataStreamCharacterProcessor.h>
 #import <OWF/OWDataStreamCursor.h>
 #import <OWF/OWParameterizedContentType.h>
+#import <OWF/OWProcessorScheduler.h>
 #import <OWF/OWUnknownDataStreamProcessor.h>
 
 #include <sys/mman.h>
@@ -62,26 +63,105 @@ static inline void _raiseIfInvalid(OWDataStream *self)
         _raiseNoLongerValidException();
 }
 
-static inline OWDataStreamBufferDescriptor *descriptorForBlockContainingOffset(OWDataStream *self, NSUInteger offset, NSUInteger *offsetWithinBlock)
+// Binary search of the block index. Returns the block containing offset (and where that block starts), or NULL if offset is past the data written so far.
+static OWDataStreamBufferDescriptor *lookUpBlockContainingOffset(OWDataStream *self, NSUInteger offset, NSUInteger *blockStartPtr)
 {
-    OWDataStreamBufferDescriptor *cursor;
-    NSUInteger cursorOffset = 0;
+    // Load the count before the array: the writer publishes a new array before bumping the count, so whichever array we see holds at least this many entries.
+    NSUInteger count = __atomic_load_n(&self->_blockIndexCount, __ATOMIC_ACQUIRE);
+    OWDataStreamBlockHint *entries = __atomic_load_n(&self->_blockIndex, __ATOMIC_ACQUIRE);
+    if (count == 0)
+        return NULL;
 
+    // Find the last block starting at or before offset.
+    NSUInteger low = 0, high = count;
+    while (high - low > 1) {
+        NSUInteger middle = low + (high - low) / 2;
+        if (entries[middle].blockStart <= offset)
+            low = middle;
+        else
+            high = middle;
+    }
+
+    OWDataStreamBlockHint entry = entries[low];
+    if (entry.blockStart > offset || offset - entry.blockStart >= entry.block->bufferUsed)
+        return NULL;
+
+    *blockStartPtr = entry.blockStart;
+    return entry.block;
+}
+
+static inline OWDataStreamBufferDescriptor *descriptorForBlockContainingOffset(OWDataStream *self, NSUInteger offset, NSUInteger *offsetWithinBlock, OWDataStreamBlockHint *hint)
+{
     _raiseIfInvalid(self);
-    cursor = self->_first;
-    while (cursor != NULL) {
-        OWDataStreamBufferDescriptor cursorBlock = *cursor;
-        
-        if (cursorOffset <= offset && (cursorOffset + cursorBlock.bufferUsed) > offset) {
-            *offsetWithinBlock = ( offset - cursorOffset );
-            return cursor;
+
+    // Cursors mostly read forward, so the block they last used or the one after it usually has what they want.
+    if (hint != NULL && hint->block != NULL && hint->blockStart <= offset) {
+        OWDataStreamBufferDescriptor *block = hint->block;
+        NSUInteger blockStart = hint->blockStart;
+        NSUInteger blockUsed = block->bufferUsed;
+        if (offset - blockStart < blockUsed) {
+            *offsetWithinBlock = offset - blockStart;
+            return block;
+        }
+
+        // Look at 'next' before trusting 'bufferUsed' to be final, as in -bufferedData.
+        OWDataStreamBufferDescriptor *nextBlock = block->next;
+        if (nextBlock != NULL) {
+            blockStart += block->bufferUsed;
+            if (offset >= blockStart && offset - blockStart < nextBlock->bufferUsed) {
+                hint->block = nextBlock;
+                hint->blockStart = blockStart;
+                *offsetWithinBlock = offset - blockStart;
+                return nextBlock;
+            }
         }
-        
-        cursor = cursorBlock.next;
-        cursorOffset += cursorBlock.bufferUsed;
     }
-    
-    return NULL;
+
+    NSUInteger blockStart = 0;
+    OWDataStreamBufferDescriptor *block = lookUpBlockContainingOffset(self, offset, &blockStart);
+    if (block == NULL)
+        return NULL;
+
+    if (hint != NULL) {
+        hint->block = block;
+        hint->blockStart = blockStart;
+    }
+    *offsetWithinBlock = offset - blockStart;
+    return block;
+}
+
+// Called on the writer's thread as each block is linked in. All earlier blocks are full at this point, so the new block starts where the previous one ends.
+static void appendToBlockIndex(OWDataStream *self, OWDataStreamBufferDescriptor *newBuffer)
+{
+    NSUInteger count = self->_blockIndexCount;
+    OWDataStreamBlockHint *entries = self->_blockIndex;
+
+    NSUInteger blockStart = 0;
+    if (count > 0) {
+        OWDataStreamBlockHint previous = entries[count - 1];
+        OBASSERT(previous.block->next == newBuffer);
+        blockStart = previous.blockStart + previous.block->bufferUsed;
+    }
+
+    if (count == self->_blockIndexCapacity) {
+        // Readers may still be searching the old array, so copy into a new one rather than reallocating in place, and keep the old one around until we are deallocated.
+        NSUInteger newCapacity = MAX(2 * self->_blockIndexCapacity, (NSUInteger)16);
+        OWDataStreamBlockHint *newEntries = malloc(newCapacity * sizeof(*newEntries));
+        if (count > 0)
+            memcpy(newEntries, entries, count * sizeof(*entries));
+        if (entries != NULL) {
+            if (self->_retiredBlockIndexes == nil)
+                self->_retiredBlockIndexes = [[NSMutableArray alloc] init];
+            [self->_retiredBlockIndexes addObject:[NSData dataWithBytesNoCopy:entries length:count * sizeof(*entries) freeWhenDone:YES]];
+        }
+        entries = newEntries;
+        self->_blockIndexCapacity = newCapacity;
+        __atomic_store_n(&self->_blockIndex, newEntries, __ATOMIC_RELEASE);
+    }
+
+    entries[count].blockStart = blockStart;
+    entries[count].block = newBuffer;
+    __atomic_store_n(&self->_blockIndexCount, count + 1, __ATOMIC_RELEASE);
 }
 
 static inline BOOL copyBuffersOut(OWDataStreamBufferDescriptor *dsBuffer, NSUInteger offsetIntoBlock, void *outBuffer, NSUInteger length)
@@ -138,6 +218,7 @@ static void allocateAnotherBuffer(OWDataStream *self, size_t bytesToAllocate)
         OBASSERT(!self->_first);
         self->_first = self->_last = newBuffer;
     }
+    appendToBlockIndex(self, newBuffer);
     
     OBPOSTCONDITION(self->_last != NULL);
     OBPOSTCONDITION(self->_last->bufferUsed < self->_last->bufferSize);
@@ -153,6 +234,14 @@ static void deallocateBuffer(OWDataStreamBufferDescriptor *oldBuffer)
     }
 }
 
+// Readers usually wait here for the network, so let the processor scheduler put another worker to use meanwhile.
+static inline void waitForLengthChange(pthread_cond_t *condition, pthread_mutex_t *mutex)
+{
+    OWProcessorSchedulerWillBlock();
+    pthread_cond_wait(condition, mutex);
+    OWProcessorSchedulerDidUnblock();
+}
+
 - initWithLength:(NSUInteger)newLength;
 {
     if (!(self = [super init]))
@@ -207,6 +296,10 @@ static void deallocateBuffer(OWDataStreamBufferDescriptor *oldBuffer)
     }
     _first = _last = NULL;
 
+    free(_blockIndex);
+    _blockIndex = NULL;
+    _blockIndexCount = 0;
+
     pthread_cond_destroy(&lengthChangedCondition);
     pthread_mutex_destroy(&lengthMutex);
 }
@@ -251,6 +344,11 @@ static void deallocateBuffer(OWDataStreamBufferDescriptor *oldBuffer)
 }
 
 - (NSUInteger)accessUnderlyingBuffer:(void **)returnedBufferPtr startingAtLocation:(NSUInteger)dataOffset;
+{
+    return [self _accessUnderlyingBuffer:returnedBufferPtr startingAtLocation:dataOffset blockHint:NULL];
+}
+
+- (NSUInteger)_accessUnderlyingBuffer:(void **)returnedBufferPtr startingAtLocation:(NSUInteger)dataOffset blockHint:(OWDataStreamBlockHint *)hint;
 {
     OWDataStreamBufferDescriptor *dsBuffer;
     NSUInteger remainingOffset;
@@ -259,7 +357,7 @@ static void deallocateBuffer(OWDataStreamBufferDescriptor *oldBuffer)
     if (readLength <= dataOffset)
         return 0;
     
-    dsBuffer = descriptorForBlockContainingOffset(self, dataOffset, &remainingOffset);
+    dsBuffer = descriptorForBlockContainingOffset(self, dataOffset, &remainingOffset, hint);
     if (dsBuffer) {
         *returnedBufferPtr = dsBuffer->buffer + remainingOffset;
         return dsBuffer->bufferUsed - remainingOffset;
@@ -273,7 +371,7 @@ static void deallocateBuffer(OWDataStreamBufferDescriptor *oldBuffer)
     if (![self knowsDataLength]) {
         pthread_mutex_lock(&lengthMutex);
         while (dataLength == OWDataStreamUnknownLength && !flags.hasThrownAwayData)
-            pthread_cond_wait(&lengthChangedCondition, &lengthMutex);
+            waitForLengthChange(&lengthChangedCondition, &lengthMutex);
         pthread_mutex_unlock(&lengthMutex);
     }
     return dataLength;
@@ -285,6 +383,11 @@ static void deallocateBuffer(OWDataStreamBufferDescriptor *oldBuffer)
 }
 
 - (BOOL)getBytes:(void *)buffer range:(NSRange)range;
+{
+    return [self _getBytes:buffer range:range blockHint:NULL];
+}
+
+- (BOOL)_getBytes:(void *)buffer range:(NSRange)range blockHint:(OWDataStreamBlockHint *)hint;
 {
     _raiseIfInvalid(self);
 
@@ -292,12 +395,17 @@ static void deallocateBuffer(OWDataStreamBufferDescriptor *oldBuffer)
         return NO;
 
     NSUInteger offsetIntoBlock = 0;
-    OWDataStreamBufferDescriptor *dsBuffer = descriptorForBlockContainingOffset(self, range.location, &offsetIntoBlock);
+    OWDataStreamBufferDescriptor *dsBuffer = descriptorForBlockContainingOffset(self, range.location, &offsetIntoBlock, hint);
     
     return copyBuffersOut(dsBuffer, offsetIntoBlock, buffer, range.length);
 }
 
 - (NSData *)dataWithRange:(NSRange)range;
+{
+    return [self _dataWithRange:range blockHint:NULL];
+}
+
+- (NSData *)_dataWithRange:(NSRange)range blockHint:(OWDataStreamBlockHint *)hint;
 {
     OWDataStreamBufferDescriptor *dsBuffer;
     NSUInteger offsetIntoBlock;
@@ -307,7 +415,7 @@ static void deallocateBuffer(OWDataStreamBufferDescriptor *oldBuffer)
     if (![self waitForBufferedDataLength:NSMaxRange(range)])
         return nil;
 
-    dsBuffer = descriptorForBlockContainingOffset(self, range.location, &offsetIntoBlock);
+    dsBuffer = descriptorForBlockContainingOffset(self, range.location, &offsetIntoBlock, hint);
     if (!dsBuffer)
         return nil;
 
@@ -337,7 +445,7 @@ static void deallocateBuffer(OWDataStreamBufferDescriptor *oldBuffer)
             pthread_mutex_unlock(&lengthMutex);
             return NO;
         }
-        pthread_cond_wait(&lengthChangedCondition, &lengthMutex);
+        waitForLengthChange(&lengthChangedCondition, &lengthMutex);
     }
     pthread_mutex_unlock(&lengthMutex);
     return YES;
@@ -353,7 +461,7 @@ static void deallocateBuffer(OWDataStreamBufferDescriptor *oldBuffer)
             pthread_mutex_unlock(&lengthMutex);
             return NO;
         }
-        pthread_cond_wait(&lengthChangedCondition, &lengthMutex);
+        waitForLengthChange(&lengthChangedCondition, &lengthMutex);
     }
     pthread_mutex_unlock(&lengthMutex);
     return YES;
@@ -669,7 +777,7 @@ static void deallocateBuffer(OWDataStreamBufferDescriptor *oldBuffer)
 {
     pthread_mutex_lock(&lengthMutex);
     while (!flags.endOfData)
-        pthread_cond_wait(&lengthChangedCondition, &lengthMutex);
+        waitForLengthChange(&lengthChangedCondition, &lengthMutex);
     pthread_mutex_unlock(&lengthMutex);
 }
 
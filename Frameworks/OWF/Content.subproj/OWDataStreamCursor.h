@@ -12,6 +12,7 @@
 
 #import <OmniFoundation/OFByte.h>
 #import <OmniFoundation/OFBundleRegistryTarget.h>
+#import <OWF/OWDataStream.h> // For OWDataStreamBlockHint
 
 typedef long OFByteOrder;
 
@@ -100,6 +101,7 @@ typedef long OFByteOrder;
 @interface OWDataStreamConcreteCursor : OWDataStreamCursor
 {
     OWDataStream *dataStream;
+    OWDataStreamBlockHint blockHint;
 }
 
 - initForDataStream:(OWDataStream *)aStream;
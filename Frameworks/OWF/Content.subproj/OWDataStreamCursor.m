@@ -543,7 +543,7 @@ static inline void _raiseIfAborted(OWDataStreamConcreteCursor *self)
 static inline void _getBytes(OWDataStreamConcreteCursor *self, void *buffer, NSUInteger count)
 {
     _raiseIfAborted(self);
-    if (![self->dataStream getBytes:buffer range:(NSRange){self->dataOffset, count}])
+    if (![self->dataStream _getBytes:buffer range:(NSRange){self->dataOffset, count} blockHint:&self->blockHint])
         [OWDataStreamCursor_UnderflowException raise];
     self->bitsLeft = 0;
 }
@@ -560,7 +560,7 @@ static inline NSData *_getData(OWDataStreamConcreteCursor *self, NSUInteger coun
     NSData *result;
 
     _raiseIfAborted(self);
-    if (!(result = [self->dataStream dataWithRange:(NSRange){self->dataOffset, count}]))
+    if (!(result = [self->dataStream _dataWithRange:(NSRange){self->dataOffset, count} blockHint:&self->blockHint]))
         [OWDataStreamCursor_UnderflowException raise];
     return result;
 }
@@ -573,7 +573,7 @@ static inline NSData *_getBufferedData(OWDataStreamConcreteCursor *self, BOOL in
     if (![self->dataStream waitForBufferedDataLength:(self->dataOffset + 1)])
         return nil;
     count = [self->dataStream bufferedDataLength] - self->dataOffset;
-    result = [self->dataStream dataWithRange:(NSRange){self->dataOffset, count}];
+    result = [self->dataStream _dataWithRange:(NSRange){self->dataOffset, count} blockHint:&self->blockHint];
     if (incrementOffset)
         self->dataOffset += count;
     return result;
@@ -670,11 +670,11 @@ static inline NSData *_getBufferedData(OWDataStreamConcreteCursor *self, BOOL in
     NSUInteger count;
 
     _raiseIfAborted(self);
-    count = [dataStream accessUnderlyingBuffer:returnedBufferPtr startingAtLocation:dataOffset];
+    count = [dataStream _accessUnderlyingBuffer:returnedBufferPtr startingAtLocation:dataOffset blockHint:&blockHint];
     if (count == 0) {
         if (![dataStream waitForBufferedDataLength:(dataOffset + 1)])
             return 0;
-        count = [dataStream accessUnderlyingBuffer:returnedBufferPtr startingAtLocation:dataOffset];
+        count = [dataStream _accessUnderlyingBuffer:returnedBufferPtr startingAtLocation:dataOffset blockHint:&blockHint];
     }
     return count;
 }
@@ -708,7 +708,7 @@ static inline NSData *_getBufferedData(OWDataStreamConcreteCursor *self, BOOL in
         return _getData(self, count);
     
     available = [self->dataStream bufferedDataLength] - self->dataOffset;
-    return [self->dataStream dataWithRange:(NSRange){self->dataOffset, MIN(available, count)}];
+    return [self->dataStream _dataWithRange:(NSRange){self->dataOffset, MIN(available, count)} blockHint:&self->blockHint];
 }
 
 - (OFByte)readByte;
@@ -12,6 +12,7 @@
 #import <OmniFoundation/OmniFoundation.h>
 
 #import <OWF/OWObjectStreamCursor.h>
+#import <OWF/OWProcessorScheduler.h>
 
 RCS_ID("$Id$")
 
@@ -109,7 +110,9 @@ enum {
         [objectsLock lock];
         while (index >= count && !endOfObjects) {
             [objectsLock unlockWithCondition:READERS_WAITING];
+            OWProcessorSchedulerWillBlock();
             [objectsLock lockWhenCondition:OBJECTS_AVAILABLE];
+            OWProcessorSchedulerDidUnblock();
         }
         [objectsLock unlockWithCondition:OBJECTS_AVAILABLE];
     }
@@ -146,7 +149,9 @@ enum {
         [objectsLock lock];
         while (anIndex >= count && !endOfObjects) {
             [objectsLock unlockWithCondition:READERS_WAITING];
+            OWProcessorSchedulerWillBlock();
             [objectsLock lockWhenCondition:OBJECTS_AVAILABLE];
+            OWProcessorSchedulerDidUnblock();
         }
         [objectsLock unlockWithCondition:OBJECTS_AVAILABLE];
     }
@@ -171,7 +176,9 @@ enum {
 
 - (void)waitForDataEnd;
 {
+    OWProcessorSchedulerWillBlock();
     [endOfDataLock lockWhenCondition: DATA_ENDED];
+    OWProcessorSchedulerDidUnblock();
     [endOfDataLock unlock];
 }
 
@@ -44,6 +44,7 @@
 #import <OWF/OWFileProcessor.h>
 #import <OWF/OWFilteredAddressCache.h>
 #import <OWF/OWHTMLToSGMLObjects.h>
+#import <OWF/OWHTTPEventEngine.h>
 #import <OWF/OWHTTPProcessor.h>
 #import <OWF/OWHTTPSession.h>
 #import <OWF/OWHTTPSessionQueue.h>
@@ -60,6 +61,7 @@
 #import <OWF/OWPipeline.h>
 #import <OWF/OWProcessor.h>
 #import <OWF/OWProcessorDescription.h>
+#import <OWF/OWProcessorScheduler.h>
 #import <OWF/OWProxyServer.h>
 #import <OWF/OWSGMLAppliedMethods.h>
 #import <OWF/OWSGMLAttribute.h>
@@ -6,6 +6,8 @@
 // <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
 
 #import <OmniFoundation/OFHTTPHeaderDictionary.h>
+#import <CoreFoundation/CFString.h>
+#import <os/lock.h>
 
 @class NSArray, NSCharacterSet, NSLock, NSMutableArray;
 @class OFDataCursor, OFMultiValueDictionary;
@@ -16,6 +18,13 @@
 {
     NSLock *parameterizedContentTypeLock;
     OWParameterizedContentType *parameterizedContentType;
+
+    // A header block read by -readRFC822HeaderBytes:length:encoding: that hasn't been moved into the dictionary yet
+    os_unfair_lock headerBlockLock;
+    NSData *headerBlock;
+    CFStringEncoding headerBlockEncoding;
+    struct _OWHeaderBlockEntry *headerBlockEntries;
+    NSUInteger headerBlockEntryCount;
 }
 
 - (void)parseRFC822Header:(NSString *)aHeader;
@@ -23,12 +32,17 @@
 - (void)readRFC822HeadersFromCursor:(OWDataStreamCursor *)aCursor;
 - (void)readRFC822HeadersFromScanner:(OWDataStreamScanner *)aScanner;
 - (void)readRFC822HeadersFromSocketStream:(ONSocketStream *)aSocketStream;
+- (void)readRFC822HeaderBytes:(const void *)bytes length:(NSUInteger)length encoding:(CFStringEncoding)encoding;
+    // Takes a block of header lines, such as OWHeaderBlockLength() finds, without making a string per line. Well-known header names come back as shared keys, and values are only made into strings when someone asks for them.
 
 - (OWParameterizedContentType *)parameterizedContentType;
 - (OWContentType *)contentEncoding;
 
 @end
 
+// Returns the length of the header block at the start of bytes, through the blank line (or "." line) that ends it. Lines may end in CRLF, LF, CR or CRCRLF, as with -[ONSocketStream readLine]. If the block isn't all there yet, sets *outComplete to NO and returns 0, unless atEndOfData is set, in which case whatever is there is the block.
+extern NSUInteger OWHeaderBlockLength(const void *bytes, NSUInteger length, BOOL atEndOfData, BOOL *outComplete);
+
 @interface OWHeaderDictionary (Debugging)
 + (void)setDebug:(BOOL)debugMode;
 @end
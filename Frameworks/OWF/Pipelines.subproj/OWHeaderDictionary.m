@@ -10,14 +10,306 @@
 #import <Foundation/Foundation.h>
 #import <OmniBase/OmniBase.h>
 #import <OmniFoundation/OmniFoundation.h>
+#import <OmniNetworking/ONSocketStream.h>
 
 #import <OWF/OWContentType.h>
-#import <OWF/OWDataStreamCharacterCursor.h>
+#import <OWF/OWDataStreamCursor.h>
 #import <OWF/OWParameterizedContentType.h>
 #import <OWF/OWUnknownDataStreamProcessor.h>
 
 RCS_ID("$Id$")
 
+typedef struct _OWHeaderBlockEntry {
+    const uint8_t *bytes;       // The header's line within the block, or foldedBytes
+    uint8_t *foldedBytes;       // The lines of a folded header joined together
+    NSUInteger keyLength;       // The key is everything before the first colon, as with -parseRFC822Header:
+    NSRange valueRange;         // Surrounding ASCII whitespace is already trimmed
+    BOOL valueNeedsTrimming;    // The value starts or ends with a non-ASCII byte, which might be whitespace in the block's encoding
+    BOOL ownsKey;
+    CFStringRef key;            // A well-known key we don't own, or made when first needed
+    CFStringRef value;          // Made when first needed
+} OWHeaderBlockEntry;
+
+typedef enum {
+    OWHeaderBlockFirstValue,
+    OWHeaderBlockLastValue,
+    OWHeaderBlockAllValues,
+} OWHeaderBlockLookup;
+
+#define OWHeaderKeyBufferSize (128)
+
+#define WELL_KNOWN_HEADER(name) { name, sizeof(name) - 1, @name }
+
+// Names that show up in nearly every response, so that their keys can be shared rather than made for each one.
+static const struct {
+    const char *name;
+    NSUInteger length;
+    __unsafe_unretained NSString *key;
+} WellKnownHeaders[] = {
+    WELL_KNOWN_HEADER("Accept-Ranges"),
+    WELL_KNOWN_HEADER("Access-Control-Allow-Origin"),
+    WELL_KNOWN_HEADER("Age"),
+    WELL_KNOWN_HEADER("Alt-Svc"),
+    WELL_KNOWN_HEADER("Cache-Control"),
+    WELL_KNOWN_HEADER("Connection"),
+    WELL_KNOWN_HEADER("Content-Disposition"),
+    WELL_KNOWN_HEADER("Content-Encoding"),
+    WELL_KNOWN_HEADER("Content-Language"),
+    WELL_KNOWN_HEADER("Content-Length"),
+    WELL_KNOWN_HEADER("Content-Location"),
+    WELL_KNOWN_HEADER("Content-Range"),
+    WELL_KNOWN_HEADER("Content-Type"),
+    WELL_KNOWN_HEADER("Date"),
+    WELL_KNOWN_HEADER("ETag"),
+    WELL_KNOWN_HEADER("Expires"),
+    WELL_KNOWN_HEADER("Keep-Alive"),
+    WELL_KNOWN_HEADER("Last-Modified"),
+    WELL_KNOWN_HEADER("Link"),
+    WELL_KNOWN_HEADER("Location"),
+    WELL_KNOWN_HEADER("Pragma"),
+    WELL_KNOWN_HEADER("Proxy-Authenticate"),
+    WELL_KNOWN_HEADER("Refresh"),
+    WELL_KNOWN_HEADER("Retry-After"),
+    WELL_KNOWN_HEADER("Server"),
+    WELL_KNOWN_HEADER("Set-Cookie"),
+    WELL_KNOWN_HEADER("Strict-Transport-Security"),
+    WELL_KNOWN_HEADER("Transfer-Encoding"),
+    WELL_KNOWN_HEADER("Vary"),
+    WELL_KNOWN_HEADER("Via"),
+    WELL_KNOWN_HEADER("WWW-Authenticate"),
+    WELL_KNOWN_HEADER("X-Content-Type-Options"),
+    WELL_KNOWN_HEADER("X-Frame-Options"),
+    WELL_KNOWN_HEADER("X-Powered-By"),
+};
+
+static inline uint8_t _asciiLowercase(uint8_t c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static BOOL _asciiCaseInsensitiveEqual(const uint8_t *bytes, const char *ascii, NSUInteger length)
+{
+    for (NSUInteger index = 0; index < length; index++) {
+        if (bytes[index] != (uint8_t)ascii[index] && _asciiLowercase(bytes[index]) != _asciiLowercase(ascii[index]))
+            return NO;
+    }
+    return YES;
+}
+
+static inline BOOL _isASCIIWhitespace(uint8_t c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static CFStringRef _wellKnownHeaderKey(const uint8_t *bytes, NSUInteger length)
+{
+    for (NSUInteger headerIndex = 0; headerIndex < sizeof(WellKnownHeaders) / sizeof(*WellKnownHeaders); headerIndex++) {
+        if (WellKnownHeaders[headerIndex].length == length && _asciiCaseInsensitiveEqual(bytes, WellKnownHeaders[headerIndex].name, length))
+            return (__bridge CFStringRef)WellKnownHeaders[headerIndex].key;
+    }
+    return NULL;
+}
+
+// Returns the length of the line terminator at bytes[index], 0 if there isn't one there, or NSNotFound if we can't tell without more data. Accepts the same terminators as -[ONSocketStream getLengthOfNextLine:], except that we don't wait to see whether an LF is followed by a CR.
+static NSUInteger _eolLength(const uint8_t *bytes, NSUInteger length, NSUInteger index, BOOL atEndOfData)
+{
+    switch (bytes[index]) {
+        case '\n':
+            return (index + 1 < length && bytes[index + 1] == '\r') ? 2 : 1;
+        case '\r':
+            if (index + 1 == length)
+                return atEndOfData ? 1 : NSNotFound;
+            if (bytes[index + 1] == '\n')
+                return 2;
+            if (bytes[index + 1] == '\r') {
+                // CRCRLF, which some servers send
+                if (index + 2 == length)
+                    return atEndOfData ? 1 : NSNotFound;
+                if (bytes[index + 2] == '\n')
+                    return 3;
+            }
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Finds the line starting at *ioOffset and moves *ioOffset past its terminator. Returns NO if there's no complete line there.
+static BOOL _nextLine(const uint8_t *bytes, NSUInteger length, BOOL atEndOfData, NSUInteger *ioOffset, NSUInteger *outLineLength)
+{
+    NSUInteger lineStart = *ioOffset;
+
+    for (NSUInteger index = lineStart; index < length; index++) {
+        if (bytes[index] != '\n' && bytes[index] != '\r')
+            continue;
+        NSUInteger eolLength = _eolLength(bytes, length, index, atEndOfData);
+        if (eolLength == NSNotFound)
+            return NO;
+        *outLineLength = index - lineStart;
+        *ioOffset = index + eolLength;
+        return YES;
+    }
+
+    if (!atEndOfData || lineStart == length)
+        return NO;
+    *outLineLength = length - lineStart;
+    *ioOffset = length;
+    return YES;
+}
+
+static inline BOOL _endsHeaderBlock(const uint8_t *line, NSUInteger lineLength)
+{
+    return lineLength == 0 || (lineLength == 1 && line[0] == '.');
+}
+
+NSUInteger OWHeaderBlockLength(const void *bytes, NSUInteger length, BOOL atEndOfData, BOOL *outComplete)
+{
+    const uint8_t *byteArray = bytes;
+    NSUInteger offset = 0;
+
+    for (;;) {
+        NSUInteger lineStart = offset, lineLength;
+        if (!_nextLine(byteArray, length, atEndOfData, &offset, &lineLength))
+            break;
+        if (_endsHeaderBlock(byteArray + lineStart, lineLength)) {
+            *outComplete = YES;
+            return offset;
+        }
+    }
+
+    *outComplete = atEndOfData;
+    return atEndOfData ? length : 0;
+}
+
+// Fills in an entry for one header, taking ownership of foldedBytes. Returns NO for a header with no colon, which is ignored as it is by -parseRFC822Header:.
+static BOOL _fillEntry(OWHeaderBlockEntry *entry, const uint8_t *bytes, NSUInteger length, uint8_t *foldedBytes)
+{
+    const uint8_t *colon = memchr(bytes, ':', length);
+    if (colon == NULL) {
+        free(foldedBytes);
+        return NO;
+    }
+
+    NSUInteger keyLength = colon - bytes;
+    NSUInteger valueStart = keyLength + 1, valueEnd = length;
+    while (valueStart < valueEnd && _isASCIIWhitespace(bytes[valueStart]))
+        valueStart++;
+    while (valueEnd > valueStart && _isASCIIWhitespace(bytes[valueEnd - 1]))
+        valueEnd--;
+
+    entry->bytes = bytes;
+    entry->foldedBytes = foldedBytes;
+    entry->keyLength = keyLength;
+    entry->valueRange = NSMakeRange(valueStart, valueEnd - valueStart);
+    entry->valueNeedsTrimming = valueEnd > valueStart && (bytes[valueStart] >= 0x80 || bytes[valueEnd - 1] >= 0x80);
+    entry->ownsKey = NO;
+    entry->key = _wellKnownHeaderKey(bytes, keyLength);
+    entry->value = NULL;
+    return YES;
+}
+
+// Splits a header block into entries, joining folded lines. Stops at the first blank or "." line.
+static OWHeaderBlockEntry *_copyEntries(NSData *block, NSUInteger *outEntryCount)
+{
+    const uint8_t *bytes = [block bytes];
+    NSUInteger length = [block length];
+    OWHeaderBlockEntry *entries = NULL;
+    NSUInteger entryCount = 0, entryCapacity = 0;
+    NSUInteger offset = 0, headerStart = 0, headerLength = 0;
+    BOOL haveHeader = NO;
+    uint8_t *foldedBytes = NULL;
+
+    for (;;) {
+        NSUInteger lineStart = offset, lineLength;
+        BOOL haveLine = _nextLine(bytes, length, YES, &offset, &lineLength);
+
+        if (haveLine && lineLength != 0 && (bytes[lineStart] == ' ' || bytes[lineStart] == '\t')) {
+            // A continuation of a folded header. One with nothing to continue is dropped.
+            if (!haveHeader)
+                continue;
+            if (foldedBytes == NULL) {
+                foldedBytes = malloc(headerLength + lineLength);
+                memcpy(foldedBytes, bytes + headerStart, headerLength);
+            } else {
+                foldedBytes = reallocf(foldedBytes, headerLength + lineLength);
+            }
+            memcpy(foldedBytes + headerLength, bytes + lineStart, lineLength);
+            headerLength += lineLength;
+            continue;
+        }
+
+        if (haveHeader) {
+            if (entryCount == entryCapacity) {
+                entryCapacity = MAX(16, 2 * entryCapacity);
+                entries = reallocf(entries, entryCapacity * sizeof(*entries));
+            }
+            if (_fillEntry(&entries[entryCount], foldedBytes != NULL ? foldedBytes : bytes + headerStart, headerLength, foldedBytes))
+                entryCount++;
+            foldedBytes = NULL;
+            haveHeader = NO;
+        }
+
+        if (!haveLine || _endsHeaderBlock(bytes + lineStart, lineLength))
+            break;
+
+        haveHeader = YES;
+        headerStart = lineStart;
+        headerLength = lineLength;
+    }
+
+    *outEntryCount = entryCount;
+    return entries;
+}
+
+static void _freeEntries(OWHeaderBlockEntry *entries, NSUInteger entryCount)
+{
+    for (NSUInteger entryIndex = 0; entryIndex < entryCount; entryIndex++) {
+        OWHeaderBlockEntry *entry = &entries[entryIndex];
+        if (entry->ownsKey)
+            CFRelease(entry->key);
+        if (entry->value != NULL)
+            CFRelease(entry->value);
+        free(entry->foldedBytes);
+    }
+    free(entries);
+}
+
+static CFStringRef _createString(const uint8_t *bytes, NSUInteger length, CFStringEncoding encoding)
+{
+    CFStringRef string = CFStringCreateWithBytes(kCFAllocatorDefault, bytes, length, encoding, false);
+    if (string == NULL) // Not valid in the block's encoding, but any bytes at all are valid Latin-1
+        string = CFStringCreateWithBytes(kCFAllocatorDefault, bytes, length, kCFStringEncodingISOLatin1, false);
+    return string;
+}
+
+static NSString *_entryKey(OWHeaderBlockEntry *entry, CFStringEncoding encoding)
+{
+    if (entry->key == NULL) {
+        entry->key = _createString(entry->bytes, entry->keyLength, encoding);
+        entry->ownsKey = YES;
+    }
+    return (__bridge NSString *)entry->key;
+}
+
+static NSString *_entryValue(OWHeaderBlockEntry *entry, CFStringEncoding encoding)
+{
+    if (entry->value == NULL) {
+        CFStringRef value = _createString(entry->bytes + entry->valueRange.location, entry->valueRange.length, encoding);
+        if (entry->valueNeedsTrimming) {
+            NSString *trimmedValue = [(__bridge NSString *)value stringByRemovingSurroundingWhitespace];
+            CFRelease(value);
+            value = CFBridgingRetain(trimmedValue);
+        }
+        entry->value = value;
+    }
+    return (__bridge NSString *)entry->value;
+}
+
+static inline BOOL _entryHasKey(const OWHeaderBlockEntry *entry, const char *key, NSUInteger keyLength)
+{
+    return entry->keyLength == keyLength && _asciiCaseInsensitiveEqual(entry->bytes, key, keyLength);
+}
+
 @implementation OWHeaderDictionary
 
 static BOOL debugHeaderDictionary = NO;
@@ -34,12 +326,67 @@ static BOOL debugHeaderDictionary = NO;
 
     parameterizedContentTypeLock = [[NSLock alloc] init];
     parameterizedContentType = nil;
+    headerBlockLock = OS_UNFAIR_LOCK_INIT;
 
     return self;
 }
 
+- (void)dealloc;
+{
+    _freeEntries(headerBlockEntries, headerBlockEntryCount);
+}
+
+- (NSArray <NSString *> *)stringArrayForKey:(NSString *)aKey;
+{
+    id values;
+    if ([self _getHeaderBlockValue:&values forKey:aKey lookup:OWHeaderBlockAllValues])
+        return values;
+    return [super stringArrayForKey:aKey];
+}
+
+- (NSString *)firstStringForKey:(NSString *)aKey;
+{
+    id value;
+    if ([self _getHeaderBlockValue:&value forKey:aKey lookup:OWHeaderBlockFirstValue])
+        return value;
+    return [super firstStringForKey:aKey];
+}
+
+- (NSString *)lastStringForKey:(NSString *)aKey;
+{
+    id value;
+    if ([self _getHeaderBlockValue:&value forKey:aKey lookup:OWHeaderBlockLastValue])
+        return value;
+    return [super lastStringForKey:aKey];
+}
+
+- (NSEnumerator *)keyEnumerator;
+{
+    [self _moveHeaderBlockIntoDictionary];
+    return [super keyEnumerator];
+}
+
+- (OFMultiValueDictionary *)dictionarySnapshot;
+{
+    [self _moveHeaderBlockIntoDictionary];
+    return [super dictionarySnapshot];
+}
+
+- (void)addStringsFromDictionary:(OFMultiValueDictionary *)source;
+{
+    [self _moveHeaderBlockIntoDictionary];
+    [super addStringsFromDictionary:source];
+}
+
+- (NSArray *)formatRFC822HeaderLines;
+{
+    [self _moveHeaderBlockIntoDictionary];
+    return [super formatRFC822HeaderLines];
+}
+
 - (void)addString:(NSString *)aString forKey:(NSString *)aKey;
 {
+    [self _moveHeaderBlockIntoDictionary];
     if (parameterizedContentType && [aKey compare:OFHTTPContentTypeHeaderKey options: NSCaseInsensitiveSearch] == NSOrderedSame) {
         [parameterizedContentTypeLock lock];
         parameterizedContentType = nil;
@@ -92,9 +439,23 @@ static BOOL debugHeaderDictionary = NO;
 
 - (void)readRFC822HeadersFromCursor:(OWDataStreamCursor *)aCursor;
 {
-    OWDataStreamCharacterCursor *characterCursor = [[OWDataStreamCharacterCursor alloc] initForDataCursor:aCursor encoding:kCFStringEncodingISOLatin1];
-    [self readRFC822HeadersFrom:characterCursor];
-    [characterCursor discardReadahead];
+    NSMutableData *block = [[NSMutableData alloc] init];
+    BOOL complete = NO;
+
+    while (!complete && ![aCursor isAtEOF]) {
+        void *buffer;
+        NSUInteger bufferLength = [aCursor readUnderlyingBuffer:&buffer];
+        [block appendBytes:buffer length:bufferLength];
+
+        NSUInteger blockLength = OWHeaderBlockLength([block bytes], [block length], NO, &complete);
+        if (complete) {
+            // Leave the cursor just past the block, as reading it a line at a time would have
+            [aCursor seekToOffset:(NSInteger)blockLength - (NSInteger)[block length] fromPosition:OWCursorSeekFromCurrent];
+            [block setLength:blockLength];
+        }
+    }
+
+    [self _readHeaderBlock:block encoding:kCFStringEncodingISOLatin1];
 }
 
 - (void)readRFC822HeadersFromScanner:(OWDataStreamScanner *)aScanner;
@@ -104,7 +465,37 @@ static BOOL debugHeaderDictionary = NO;
 
 - (void)readRFC822HeadersFromSocketStream:(ONSocketStream *)aSocketStream;
 {
-    [self readRFC822HeadersFrom:aSocketStream];
+    // The stream hands out whole lines, so gather them into one block, ending each with a plain LF so the block splits into the same lines the stream found.
+    NSMutableData *block = [[NSMutableData alloc] init];
+
+    for (;;) {
+        size_t eolLength;
+        size_t lineLength = [aSocketStream getLengthOfNextLine:&eolLength];
+        if (lineLength == 0) {
+            // Consume the EOF marker, as -readLine would have
+            [aSocketStream readLine];
+            break;
+        }
+
+        NSUInteger blockLength = [block length];
+        NSUInteger contentLength = lineLength - eolLength;
+        [block setLength:blockLength + lineLength + 1];
+        uint8_t *line = (uint8_t *)[block mutableBytes] + blockLength;
+        [aSocketStream readBytesOfLength:lineLength intoBuffer:line];
+        line[contentLength] = '\n';
+        [block setLength:blockLength + contentLength + 1];
+
+        if (_endsHeaderBlock(line, contentLength))
+            break;
+    }
+
+    [self _readHeaderBlock:block encoding:CFStringConvertNSStringEncodingToEncoding([aSocketStream stringEncoding])];
+}
+
+- (void)readRFC822HeaderBytes:(const void *)bytes length:(NSUInteger)length encoding:(CFStringEncoding)encoding;
+{
+    NSData *block = [[NSData alloc] initWithBytes:bytes length:length];
+    [self _readHeaderBlock:block encoding:encoding];
 }
 
 - (OWParameterizedContentType *)parameterizedContentType;
@@ -133,6 +524,8 @@ static BOOL debugHeaderDictionary = NO;
 
 - (NSMutableDictionary *)debugDictionary;
 {
+    [self _moveHeaderBlockIntoDictionary];
+
     NSMutableDictionary *dict = [super debugDictionary];
         
     if (parameterizedContentType)
@@ -143,6 +536,105 @@ static BOOL debugHeaderDictionary = NO;
 
 #pragma mark - Private
 
+- (void)_readHeaderBlock:(NSData *)block encoding:(CFStringEncoding)encoding;
+{
+    if (debugHeaderDictionary)
+        NSLog(@"%@", CFBridgingRelease(_createString([block bytes], [block length], encoding)));
+
+    NSUInteger entryCount;
+    OWHeaderBlockEntry *entries = _copyEntries(block, &entryCount);
+    if (entryCount == 0) {
+        free(entries);
+        return;
+    }
+
+    BOOL changesContentType = NO;
+    for (NSUInteger entryIndex = 0; entryIndex < entryCount && !changesContentType; entryIndex++)
+        changesContentType = _entryHasKey(&entries[entryIndex], "content-type", 12);
+    if (changesContentType && parameterizedContentType != nil) {
+        [parameterizedContentTypeLock lock];
+        parameterizedContentType = nil;
+        [parameterizedContentTypeLock unlock];
+    }
+
+    os_unfair_lock_lock(&headerBlockLock);
+    // Lookups only consult one place, so a block read into a dictionary that already has headers goes straight in with them.
+    [self _locked_moveHeaderBlockIntoDictionary];
+    BOOL wasEmpty = [[super keyEnumerator] nextObject] == nil;
+    headerBlock = block;
+    headerBlockEncoding = encoding;
+    headerBlockEntries = entries;
+    headerBlockEntryCount = entryCount;
+    if (!wasEmpty)
+        [self _locked_moveHeaderBlockIntoDictionary];
+    os_unfair_lock_unlock(&headerBlockLock);
+}
+
+// Answers a lookup from the header block, if there is one. Returns NO if the dictionary should be asked instead.
+- (BOOL)_getHeaderBlockValue:(id *)outValue forKey:(NSString *)aKey lookup:(OWHeaderBlockLookup)lookup;
+{
+    os_unfair_lock_lock(&headerBlockLock);
+    if (headerBlockEntries == NULL) {
+        os_unfair_lock_unlock(&headerBlockLock);
+        return NO;
+    }
+
+    char key[OWHeaderKeyBufferSize];
+    if (aKey == nil || !CFStringGetCString((__bridge CFStringRef)aKey, key, sizeof(key), kCFStringEncodingASCII)) {
+        // Not something we can compare with the raw bytes
+        [self _locked_moveHeaderBlockIntoDictionary];
+        os_unfair_lock_unlock(&headerBlockLock);
+        return NO;
+    }
+
+    NSUInteger keyLength = strlen(key);
+    NSMutableArray *values = nil;
+    NSString *value = nil;
+    if (lookup == OWHeaderBlockLastValue) {
+        for (NSUInteger entryIndex = headerBlockEntryCount; entryIndex-- > 0 && value == nil; ) {
+            if (_entryHasKey(&headerBlockEntries[entryIndex], key, keyLength))
+                value = _entryValue(&headerBlockEntries[entryIndex], headerBlockEncoding);
+        }
+    } else {
+        for (NSUInteger entryIndex = 0; entryIndex < headerBlockEntryCount; entryIndex++) {
+            if (!_entryHasKey(&headerBlockEntries[entryIndex], key, keyLength))
+                continue;
+            value = _entryValue(&headerBlockEntries[entryIndex], headerBlockEncoding);
+            if (lookup == OWHeaderBlockFirstValue)
+                break;
+            if (values == nil)
+                values = [NSMutableArray array];
+            [values addObject:value];
+        }
+    }
+    os_unfair_lock_unlock(&headerBlockLock);
+
+    *outValue = (lookup == OWHeaderBlockAllValues) ? values : value;
+    return YES;
+}
+
+- (void)_moveHeaderBlockIntoDictionary;
+{
+    os_unfair_lock_lock(&headerBlockLock);
+    [self _locked_moveHeaderBlockIntoDictionary];
+    os_unfair_lock_unlock(&headerBlockLock);
+}
+
+- (void)_locked_moveHeaderBlockIntoDictionary;
+{
+    if (headerBlockEntries == NULL)
+        return;
+
+    for (NSUInteger entryIndex = 0; entryIndex < headerBlockEntryCount; entryIndex++) {
+        OWHeaderBlockEntry *entry = &headerBlockEntries[entryIndex];
+        [super addString:_entryValue(entry, headerBlockEncoding) forKey:_entryKey(entry, headerBlockEncoding)];
+    }
+    _freeEntries(headerBlockEntries, headerBlockEntryCount);
+    headerBlockEntries = NULL;
+    headerBlockEntryCount = 0;
+    headerBlock = nil;
+}
+
 - (void)_locked_parseParameterizedContentType;
 {
     if (parameterizedContentType != nil)
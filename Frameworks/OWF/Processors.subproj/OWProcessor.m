@@ -20,6 +20,7 @@
 #import <OWF/OWObjectStream.h>
 #import <OWF/OWPipeline.h>
 #import <OWF/OWProcessorDescription.h>
+#import <OWF/OWProcessorScheduler.h>
 #import <OWF/OWURL.h>
 
 RCS_ID("$Id$")
@@ -165,7 +166,9 @@ static BOOL OWProcessorTimeLog = NO;
 	return;
     }
     [self setStatus:OWProcessorQueued];
-    if (aQueue != nil)
+    if (aQueue != nil && aQueue == [OWProcessor processorQueue])
+        [[OWProcessorScheduler processorScheduler] scheduleProcessor:self]; // Per-host and per-lane scheduling for the usual case
+    else if (aQueue != nil)
         [aQueue queueSelector:@selector(processInThread) forObject:self];
     else
         [self processInThread];
@@ -0,0 +1,59 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <Foundation/NSObject.h>
+#import <OmniFoundation/OFMessageQueuePriorityProtocol.h>
+
+@class NSDictionary, NSString;
+@class OWProcessor;
+
+typedef enum {
+    OWProcessorSchedulerInteractiveLane,    // Work for pipelines at OFMediumPriority or better, which someone is probably looking at
+    OWProcessorSchedulerBackgroundLane,     // Everything else: prefetching, processors without a pipeline, and so on
+    OWProcessorSchedulerLaneCount
+} OWProcessorSchedulerLane;
+
+// Runs processors for +[OWProcessor processorQueue]. Interactive work always goes ahead of background work, and background work can only use some of the workers, so a burst of prefetching can't leave nothing for the page being viewed. Within a lane, hosts take turns, so one site with a hundred images doesn't hold up the others. Scheduling groups are honored as OFMessageQueue honors them.
+// Workers that are waiting on I/O don't count against the worker count, so the scheduler starts more of them (up to a limit) while they wait, and lets the extras go once they're no longer needed.
+@interface OWProcessorScheduler : NSObject
+
++ (OWProcessorScheduler *)processorScheduler;
+    // The shared scheduler. It keeps OWProcessorThreadCount workers busy (12 by default) and will run up to OWProcessorMaximumThreadCount (four times that) while some are blocked.
+
+- (id)initWithWorkerCount:(NSUInteger)workerCount maximumWorkerCount:(NSUInteger)maximumWorkerCount;
+- (void)invalidate;
+    // Lets the workers exit once the work already scheduled is done.
+
+@property (nonatomic) NSUInteger backgroundWorkerLimit;
+    // How many workers background work may keep busy at once. Defaults to three quarters of the worker count.
+
+- (void)scheduleProcessor:(OWProcessor *)aProcessor;
+    // Calls -processInThread on a worker. The processor's lane and scheduling group come from its -messageQueueSchedulingInfo, and its host from its pipeline's source URL. Processors that use the network are treated as blocked for as long as they run.
+- (void)scheduleWorkForClassName:(NSString *)className host:(NSString *)host schedulingInfo:(OFMessageQueueSchedulingInfo)schedulingInfo blocksOnIO:(BOOL)blocksOnIO block:(void (^)(void))block;
+
+- (NSUInteger)workerCount;
+- (NSUInteger)blockedWorkerCount;
+
+// Statistics, by the class name work was scheduled under
+- (NSDictionary *)statisticsByClassName;
+- (void)resetStatistics;
+- (void)logStatistics;
+
+@end
+
+extern NSString * const OWProcessorSchedulerRunCountKey;           // NSNumber
+extern NSString * const OWProcessorSchedulerRunTimeKey;            // NSNumber, total seconds from start to finish
+extern NSString * const OWProcessorSchedulerMaximumRunTimeKey;     // NSNumber, seconds
+extern NSString * const OWProcessorSchedulerCPUTimeKey;            // NSNumber, total seconds of thread CPU time
+extern NSString * const OWProcessorSchedulerQueueDelayKey;         // NSNumber, total seconds from being scheduled to starting
+extern NSString * const OWProcessorSchedulerMaximumQueueDelayKey;  // NSNumber, seconds
+
+extern OWProcessorSchedulerLane OWProcessorSchedulerLaneForSchedulingInfo(OFMessageQueueSchedulingInfo schedulingInfo);
+
+// Code that may wait a while for I/O or for another thread calls these around the wait, so that the scheduler can start another worker in the meantime. They do nothing on threads that aren't scheduler workers, and may be nested.
+extern void OWProcessorSchedulerWillBlock(void);
+extern void OWProcessorSchedulerDidUnblock(void);
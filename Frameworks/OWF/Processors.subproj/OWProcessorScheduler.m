@@ -0,0 +1,517 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OWF/OWProcessorScheduler.h>
+
+#import <Foundation/Foundation.h>
+#import <OmniBase/OmniBase.h>
+#import <OmniFoundation/OmniFoundation.h>
+
+#import <OWF/OWContentCacheProtocols.h>
+#import <OWF/OWProcessor.h>
+#import <OWF/OWURL.h>
+
+#include <time.h>
+
+RCS_ID("$Id$")
+
+NSString * const OWProcessorSchedulerRunCountKey = @"runCount";
+NSString * const OWProcessorSchedulerRunTimeKey = @"runTime";
+NSString * const OWProcessorSchedulerMaximumRunTimeKey = @"maximumRunTime";
+NSString * const OWProcessorSchedulerCPUTimeKey = @"cpuTime";
+NSString * const OWProcessorSchedulerQueueDelayKey = @"queueDelay";
+NSString * const OWProcessorSchedulerMaximumQueueDelayKey = @"maximumQueueDelay";
+
+static const NSTimeInterval OWProcessorSchedulerIdleTimeout = 10.0; // How long a worker beyond the worker count waits for something to do before exiting
+
+@interface OWProcessorSchedulerJob : NSObject
+{
+@public
+    NSString *className;
+    NSString *host;
+    OFMessageQueueSchedulingInfo schedulingInfo;
+    OWProcessorSchedulerLane lane;
+    BOOL blocksOnIO;
+    CFAbsoluteTime scheduledTime;
+    void (^block)(void);
+}
+@end
+
+@implementation OWProcessorSchedulerJob
+@end
+
+// The waiting work in one lane, kept per host so that hosts can take turns.
+@interface OWProcessorSchedulerLaneQueue : NSObject
+{
+@public
+    NSMutableArray *hostOrder;          // Hosts with waiting work, in the order they'll next be served
+    NSMutableDictionary *jobsByHost;    // Host -> NSMutableArray of jobs, in priority order
+    NSUInteger waitingCount;
+    NSUInteger activeCount;             // Running and not blocked
+}
+- (void)addJob:(OWProcessorSchedulerJob *)job;
+- (OWProcessorSchedulerJob *)takeJobWithGroupCounts:(CFDictionaryRef)groupCounts;
+@end
+
+static BOOL _groupHasRoom(CFDictionaryRef groupCounts, OFMessageQueueSchedulingInfo schedulingInfo)
+{
+    // A group with no limit given (as from a bundle description without one) gets no limit, rather than never running.
+    if (schedulingInfo.group == NULL || schedulingInfo.maximumSimultaneousThreadsInGroup == 0)
+        return YES;
+    uintptr_t runningCount = (uintptr_t)CFDictionaryGetValue(groupCounts, schedulingInfo.group);
+    return runningCount < schedulingInfo.maximumSimultaneousThreadsInGroup;
+}
+
+@implementation OWProcessorSchedulerLaneQueue
+
+- init;
+{
+    if (!(self = [super init]))
+        return nil;
+
+    hostOrder = [[NSMutableArray alloc] init];
+    jobsByHost = [[NSMutableDictionary alloc] init];
+
+    return self;
+}
+
+- (void)addJob:(OWProcessorSchedulerJob *)job;
+{
+    NSMutableArray *jobs = [jobsByHost objectForKey:job->host];
+    if (jobs == nil) {
+        jobs = [[NSMutableArray alloc] init];
+        [jobsByHost setObject:jobs forKey:job->host];
+        [hostOrder addObject:job->host];
+    }
+
+    // After everything of the same or better priority, as OFMessageQueue does it
+    NSUInteger jobIndex = [jobs count];
+    while (jobIndex > 0 && ((OWProcessorSchedulerJob *)[jobs objectAtIndex:jobIndex - 1])->schedulingInfo.priority > job->schedulingInfo.priority)
+        jobIndex--;
+    [jobs insertObject:job atIndex:jobIndex];
+    waitingCount++;
+}
+
+- (OWProcessorSchedulerJob *)takeJobWithGroupCounts:(CFDictionaryRef)groupCounts;
+{
+    NSUInteger hostCount = [hostOrder count];
+    for (NSUInteger hostIndex = 0; hostIndex < hostCount; hostIndex++) {
+        NSString *host = [hostOrder objectAtIndex:hostIndex];
+        NSMutableArray *jobs = [jobsByHost objectForKey:host];
+        NSUInteger jobCount = [jobs count];
+
+        for (NSUInteger jobIndex = 0; jobIndex < jobCount; jobIndex++) {
+            OWProcessorSchedulerJob *job = [jobs objectAtIndex:jobIndex];
+            if (!_groupHasRoom(groupCounts, job->schedulingInfo))
+                continue;
+
+            [jobs removeObjectAtIndex:jobIndex];
+            waitingCount--;
+
+            // This host has had its turn
+            [hostOrder removeObjectAtIndex:hostIndex];
+            if ([jobs count] != 0)
+                [hostOrder addObject:host];
+            else
+                [jobsByHost removeObjectForKey:host];
+            return job;
+        }
+    }
+    return nil;
+}
+
+@end
+
+@interface OWProcessorSchedulerClassStatistics : NSObject
+{
+@public
+    NSUInteger runCount;
+    NSTimeInterval runTime, maximumRunTime;
+    NSTimeInterval cpuTime;
+    NSTimeInterval queueDelay, maximumQueueDelay;
+}
+@end
+
+@implementation OWProcessorSchedulerClassStatistics
+@end
+
+// What the current thread is doing, if it's a worker
+static _Thread_local struct {
+    __unsafe_unretained OWProcessorScheduler *scheduler;
+    OWProcessorSchedulerLane lane;
+    unsigned int blockDepth;
+} currentWorker;
+
+@interface OWProcessorScheduler ()
+- (void)_workerWillBlock;
+- (void)_workerDidUnblock;
+@end
+
+@implementation OWProcessorScheduler
+{
+    NSCondition *_condition;
+
+    // Protected by _condition
+    NSUInteger _targetWorkerCount;
+    NSUInteger _maximumWorkerCount;
+    NSUInteger _workerCount;
+    NSUInteger _startingWorkerCount;
+    NSUInteger _idleWorkerCount;
+    NSUInteger _blockedWorkerCount;
+    NSUInteger _backgroundWorkerLimit;
+    NSArray *_lanes;                    // OWProcessorSchedulerLaneQueue, indexed by lane
+    CFMutableDictionaryRef _groupCounts; // Scheduling group -> number of jobs running in it
+    BOOL _invalidated;
+
+    os_unfair_lock _statisticsLock;
+    NSMutableDictionary *_statisticsByClassName;
+}
+
++ (OWProcessorScheduler *)processorScheduler;
+{
+    static OWProcessorScheduler *processorScheduler = nil;
+    static dispatch_once_t onceToken;
+
+    dispatch_once(&onceToken, ^{
+        NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+        NSInteger threadCount = [defaults integerForKey:@"OWProcessorThreadCount"];
+        if (threadCount <= 0)
+            threadCount = 12;
+        NSInteger maximumThreadCount = [defaults integerForKey:@"OWProcessorMaximumThreadCount"];
+        if (maximumThreadCount < threadCount)
+            maximumThreadCount = 4 * threadCount;
+        processorScheduler = [[self alloc] initWithWorkerCount:threadCount maximumWorkerCount:maximumThreadCount];
+    });
+    return processorScheduler;
+}
+
+- init;
+{
+    OBRejectUnusedImplementation(self, _cmd);
+    return nil;
+}
+
+- (id)initWithWorkerCount:(NSUInteger)workerCount maximumWorkerCount:(NSUInteger)maximumWorkerCount;
+{
+    OBPRECONDITION(workerCount > 0);
+    OBPRECONDITION(maximumWorkerCount >= workerCount);
+
+    if (!(self = [super init]))
+        return nil;
+
+    _condition = [[NSCondition alloc] init];
+    _targetWorkerCount = workerCount;
+    _maximumWorkerCount = MAX(workerCount, maximumWorkerCount);
+    _backgroundWorkerLimit = MAX(1U, workerCount - workerCount / 4);
+    _lanes = @[[[OWProcessorSchedulerLaneQueue alloc] init], [[OWProcessorSchedulerLaneQueue alloc] init]];
+    _groupCounts = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, NULL, NULL);
+
+    _statisticsLock = OS_UNFAIR_LOCK_INIT;
+    _statisticsByClassName = [[NSMutableDictionary alloc] init];
+
+    return self;
+}
+
+- (void)dealloc;
+{
+    CFRelease(_groupCounts);
+}
+
+- (void)invalidate;
+{
+    [_condition lock];
+    _invalidated = YES;
+    [_condition broadcast];
+    [_condition unlock];
+}
+
+- (NSUInteger)backgroundWorkerLimit;
+{
+    [_condition lock];
+    NSUInteger limit = _backgroundWorkerLimit;
+    [_condition unlock];
+    return limit;
+}
+
+- (void)setBackgroundWorkerLimit:(NSUInteger)limit;
+{
+    [_condition lock];
+    _backgroundWorkerLimit = MAX(1U, limit);
+    [_condition broadcast];
+    [_condition unlock];
+}
+
+- (void)scheduleProcessor:(OWProcessor *)aProcessor;
+{
+    OWURL *sourceURL = [[aProcessor pipeline] contextObjectForKey:OWCacheArcSourceURLKey isDependency:NO];
+    Class processorClass = [aProcessor class];
+    [self scheduleWorkForClassName:NSStringFromClass(processorClass) host:[sourceURL hostname] schedulingInfo:[aProcessor messageQueueSchedulingInfo] blocksOnIO:[processorClass processorUsesNetwork] block:^{
+        [aProcessor processInThread];
+    }];
+}
+
+- (void)scheduleWorkForClassName:(NSString *)className host:(NSString *)host schedulingInfo:(OFMessageQueueSchedulingInfo)schedulingInfo blocksOnIO:(BOOL)blocksOnIO block:(void (^)(void))block;
+{
+    OBPRECONDITION(block != nil);
+
+    OWProcessorSchedulerJob *job = [[OWProcessorSchedulerJob alloc] init];
+    job->className = className != nil ? className : @"";
+    job->host = host != nil ? host : @"";
+    job->schedulingInfo = schedulingInfo;
+    job->lane = OWProcessorSchedulerLaneForSchedulingInfo(schedulingInfo);
+    job->blocksOnIO = blocksOnIO;
+    job->block = [block copy];
+    job->scheduledTime = CFAbsoluteTimeGetCurrent();
+
+    [_condition lock];
+    OBASSERT(!_invalidated);
+    [[_lanes objectAtIndex:job->lane] addJob:job];
+    [self _locked_startWorkerIfNeeded];
+    [_condition signal];
+    [_condition unlock];
+}
+
+- (NSUInteger)workerCount;
+{
+    [_condition lock];
+    NSUInteger count = _workerCount;
+    [_condition unlock];
+    return count;
+}
+
+- (NSUInteger)blockedWorkerCount;
+{
+    [_condition lock];
+    NSUInteger count = _blockedWorkerCount;
+    [_condition unlock];
+    return count;
+}
+
+#pragma mark - Statistics
+
+- (NSDictionary *)statisticsByClassName;
+{
+    NSMutableDictionary *result = [NSMutableDictionary dictionary];
+
+    os_unfair_lock_lock(&_statisticsLock);
+    [_statisticsByClassName enumerateKeysAndObjectsUsingBlock:^(NSString *className, OWProcessorSchedulerClassStatistics *statistics, BOOL *stop) {
+        [result setObject:@{
+            OWProcessorSchedulerRunCountKey: @(statistics->runCount),
+            OWProcessorSchedulerRunTimeKey: @(statistics->runTime),
+            OWProcessorSchedulerMaximumRunTimeKey: @(statistics->maximumRunTime),
+            OWProcessorSchedulerCPUTimeKey: @(statistics->cpuTime),
+            OWProcessorSchedulerQueueDelayKey: @(statistics->queueDelay),
+            OWProcessorSchedulerMaximumQueueDelayKey: @(statistics->maximumQueueDelay),
+        } forKey:className];
+    }];
+    os_unfair_lock_unlock(&_statisticsLock);
+
+    return result;
+}
+
+- (void)resetStatistics;
+{
+    os_unfair_lock_lock(&_statisticsLock);
+    [_statisticsByClassName removeAllObjects];
+    os_unfair_lock_unlock(&_statisticsLock);
+}
+
+- (void)logStatistics;
+{
+    NSDictionary *statisticsByClassName = [self statisticsByClassName];
+    NSArray *classNames = [[statisticsByClassName allKeys] sortedArrayUsingComparator:^NSComparisonResult(NSString *name1, NSString *name2) {
+        NSComparisonResult result = [[[statisticsByClassName objectForKey:name2] objectForKey:OWProcessorSchedulerRunTimeKey] compare:[[statisticsByClassName objectForKey:name1] objectForKey:OWProcessorSchedulerRunTimeKey]];
+        return result != NSOrderedSame ? result : [name1 compare:name2];
+    }];
+
+    NSLog(@"%@: %lu workers (%lu blocked)", OBShortObjectDescription(self), [self workerCount], [self blockedWorkerCount]);
+    for (NSString *className in classNames) {
+        NSDictionary *statistics = [statisticsByClassName objectForKey:className];
+        NSUInteger runCount = [[statistics objectForKey:OWProcessorSchedulerRunCountKey] unsignedIntegerValue];
+        NSLog(@"    %-32@ %6lu runs, %.3fs run (%.2fms max), %.3fs CPU, %.2fms average queue delay (%.2fms max)", className, runCount,
+              [[statistics objectForKey:OWProcessorSchedulerRunTimeKey] doubleValue],
+              [[statistics objectForKey:OWProcessorSchedulerMaximumRunTimeKey] doubleValue] * 1000.0,
+              [[statistics objectForKey:OWProcessorSchedulerCPUTimeKey] doubleValue],
+              runCount != 0 ? [[statistics objectForKey:OWProcessorSchedulerQueueDelayKey] doubleValue] * 1000.0 / runCount : 0.0,
+              [[statistics objectForKey:OWProcessorSchedulerMaximumQueueDelayKey] doubleValue] * 1000.0);
+    }
+}
+
+#pragma mark - Private
+
+- (NSUInteger)_locked_waitingCount;
+{
+    NSUInteger waitingCount = 0;
+    for (OWProcessorSchedulerLaneQueue *laneQueue in _lanes)
+        waitingCount += laneQueue->waitingCount;
+    return waitingCount;
+}
+
+- (void)_locked_startWorkerIfNeeded;
+{
+    // Workers that are starting up will take work as soon as they can, so count them as idle.
+    if (_idleWorkerCount + _startingWorkerCount >= [self _locked_waitingCount])
+        return;
+    if (_workerCount - _blockedWorkerCount >= _targetWorkerCount || _workerCount >= _maximumWorkerCount)
+        return;
+
+    _workerCount++;
+    _startingWorkerCount++;
+    NSThread *thread = [[NSThread alloc] initWithTarget:self selector:@selector(_workerMain) object:nil];
+    [thread setName:@"OWProcessorScheduler worker"];
+    [thread start];
+}
+
+- (OWProcessorSchedulerJob *)_locked_takeJob;
+{
+    OWProcessorSchedulerLaneQueue *interactiveQueue = [_lanes objectAtIndex:OWProcessorSchedulerInteractiveLane];
+    OWProcessorSchedulerJob *job = [interactiveQueue takeJobWithGroupCounts:_groupCounts];
+    if (job == nil) {
+        OWProcessorSchedulerLaneQueue *backgroundQueue = [_lanes objectAtIndex:OWProcessorSchedulerBackgroundLane];
+        if (backgroundQueue->activeCount < _backgroundWorkerLimit)
+            job = [backgroundQueue takeJobWithGroupCounts:_groupCounts];
+    }
+    if (job == nil)
+        return nil;
+
+    ((OWProcessorSchedulerLaneQueue *)[_lanes objectAtIndex:job->lane])->activeCount++;
+    if (job->schedulingInfo.group != NULL)
+        CFDictionarySetValue(_groupCounts, job->schedulingInfo.group, (const void *)((uintptr_t)CFDictionaryGetValue(_groupCounts, job->schedulingInfo.group) + 1));
+    return job;
+}
+
+- (void)_locked_finishJob:(OWProcessorSchedulerJob *)job;
+{
+    ((OWProcessorSchedulerLaneQueue *)[_lanes objectAtIndex:job->lane])->activeCount--;
+    if (job->schedulingInfo.group != NULL) {
+        uintptr_t runningCount = (uintptr_t)CFDictionaryGetValue(_groupCounts, job->schedulingInfo.group) - 1;
+        if (runningCount == 0)
+            CFDictionaryRemoveValue(_groupCounts, job->schedulingInfo.group);
+        else
+            CFDictionarySetValue(_groupCounts, job->schedulingInfo.group, (const void *)runningCount);
+    }
+
+    // Its group or lane may have been holding something else back
+    if (_idleWorkerCount != 0 && [self _locked_waitingCount] != 0)
+        [_condition signal];
+}
+
+- (void)_workerMain;
+{
+    currentWorker.scheduler = self;
+
+    [_condition lock];
+    _startingWorkerCount--;
+    for (;;) {
+        // Workers started while others were blocked go away once those are running again.
+        if (_workerCount - _blockedWorkerCount > _targetWorkerCount)
+            break;
+
+        OWProcessorSchedulerJob *job = [self _locked_takeJob];
+        if (job == nil) {
+            if (_invalidated)
+                break;
+            _idleWorkerCount++;
+            BOOL signaled = [_condition waitUntilDate:[NSDate dateWithTimeIntervalSinceNow:OWProcessorSchedulerIdleTimeout]];
+            _idleWorkerCount--;
+            if (!signaled && _workerCount > _targetWorkerCount)
+                break;
+            continue;
+        }
+        [_condition unlock];
+
+        [self _runJob:job];
+
+        [_condition lock];
+        [self _locked_finishJob:job];
+    }
+    _workerCount--;
+    [_condition unlock];
+
+    currentWorker.scheduler = nil;
+}
+
+- (void)_runJob:(OWProcessorSchedulerJob *)job;
+{
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    uint64_t cpuStart = clock_gettime_nsec_np(CLOCK_THREAD_CPUTIME_ID);
+
+    currentWorker.lane = job->lane;
+    if (job->blocksOnIO)
+        OWProcessorSchedulerWillBlock();
+    @try {
+        @autoreleasepool {
+            job->block();
+        }
+    } @catch (NSException *exc) {
+        NSLog(@"%@: %@: %@", job->className, [exc name], [exc reason]);
+    }
+    if (job->blocksOnIO)
+        OWProcessorSchedulerDidUnblock();
+    OBASSERT(currentWorker.blockDepth == 0);
+
+    NSTimeInterval cpuTime = (clock_gettime_nsec_np(CLOCK_THREAD_CPUTIME_ID) - cpuStart) / 1e9;
+    NSTimeInterval runTime = CFAbsoluteTimeGetCurrent() - startTime;
+    NSTimeInterval queueDelay = startTime - job->scheduledTime;
+
+    os_unfair_lock_lock(&_statisticsLock);
+    OWProcessorSchedulerClassStatistics *statistics = [_statisticsByClassName objectForKey:job->className];
+    if (statistics == nil) {
+        statistics = [[OWProcessorSchedulerClassStatistics alloc] init];
+        [_statisticsByClassName setObject:statistics forKey:job->className];
+    }
+    statistics->runCount++;
+    statistics->runTime += runTime;
+    statistics->maximumRunTime = MAX(statistics->maximumRunTime, runTime);
+    statistics->cpuTime += cpuTime;
+    statistics->queueDelay += queueDelay;
+    statistics->maximumQueueDelay = MAX(statistics->maximumQueueDelay, queueDelay);
+    os_unfair_lock_unlock(&_statisticsLock);
+}
+
+- (void)_workerWillBlock;
+{
+    [_condition lock];
+    _blockedWorkerCount++;
+    ((OWProcessorSchedulerLaneQueue *)[_lanes objectAtIndex:currentWorker.lane])->activeCount--;
+    [self _locked_startWorkerIfNeeded];
+    if (_idleWorkerCount != 0 && [self _locked_waitingCount] != 0)
+        [_condition signal];
+    [_condition unlock];
+}
+
+- (void)_workerDidUnblock;
+{
+    [_condition lock];
+    _blockedWorkerCount--;
+    ((OWProcessorSchedulerLaneQueue *)[_lanes objectAtIndex:currentWorker.lane])->activeCount++;
+    [_condition unlock];
+}
+
+@end
+
+OWProcessorSchedulerLane OWProcessorSchedulerLaneForSchedulingInfo(OFMessageQueueSchedulingInfo schedulingInfo)
+{
+    return schedulingInfo.priority <= OFMediumPriority ? OWProcessorSchedulerInteractiveLane : OWProcessorSchedulerBackgroundLane;
+}
+
+void OWProcessorSchedulerWillBlock(void)
+{
+    if (currentWorker.scheduler == nil)
+        return;
+    if (currentWorker.blockDepth++ == 0)
+        [currentWorker.scheduler _workerWillBlock];
+}
+
+void OWProcessorSchedulerDidUnblock(void)
+{
+    if (currentWorker.scheduler == nil)
+        return;
+    OBASSERT(currentWorker.blockDepth > 0);
+    if (--currentWorker.blockDepth == 0)
+        [currentWorker.scheduler _workerDidUnblock];
+}
@@ -23,7 +23,7 @@ extern NSString * const OWExpireCookiesAtEndOfSessionPreferenceKey;
 {
     NSString *_name;
     NSString *_nameDomain;
-    NSMutableArray *_cookiePaths;
+    NSArray *_cookiePaths; // Immutable, and replaced as a whole so lookups can read it without taking the domain lock
 }
 
 + (void)registerCookie:(OWCookie *)aCookie fromURL:(OWURL *)url siteURL:(OWURL *)siteURL;
@@ -32,7 +32,7 @@ static NSRecursiveLock *domainLock;
 static NSMutableDictionary *domainsByName;
 static OFScheduledEvent *saveEvent;
 
-static NSCharacterSet *endNameSet, *endNameValueSet, *endValueSet, *endDateSet, *endKeySet;
+static CFCharacterSetRef whitespaceAndNewlineSet;
 static NSTimeInterval distantPastInterval;
 
 static id classDelegate;
@@ -61,6 +61,154 @@ static inline void _locked_checkCookiesLoaded()
     }
 }
 
+/* Cookie lookups don't take domainLock. Domains are also kept in a trie keyed by their dot-separated labels, last label first ("www.example.com" is com -> example -> www, and ".example.com" is com -> example -> ""), so every domain that applies to a host lies along one path from the root. The trie is never changed in place: a change copies the nodes on the way down to it and publishes a new root, so a lookup works from whatever root was current when it started. A node's recently changed children are kept apart from the rest until there are enough of them to be worth merging, so adding a domain under a crowded node like "com" doesn't copy all its children every time. */
+
+@interface OWCookieDomainTrieNode : NSObject
+{
+@public
+    NSDictionary *_children; // label -> node
+    NSDictionary *_recentChildren; // label -> node, or NSNull for a removed child; these take precedence over _children
+    OWCookieDomain *_domain;
+}
+@end
+
+@implementation OWCookieDomainTrieNode
+@end
+
+static os_unfair_lock domainTrieLock = OS_UNFAIR_LOCK_INIT; // Only held to read or replace domainTrie
+static OWCookieDomainTrieNode *domainTrie; // nil until the cookies have been loaded
+static BOOL isLoadingCookies;
+
+static OWCookieDomainTrieNode *_currentDomainTrie(void)
+{
+    os_unfair_lock_lock(&domainTrieLock);
+    OWCookieDomainTrieNode *trie = domainTrie;
+    os_unfair_lock_unlock(&domainTrieLock);
+    return trie;
+}
+
+static void _locked_publishDomainTrie(OWCookieDomainTrieNode *trie)
+{
+    os_unfair_lock_lock(&domainTrieLock);
+    OWCookieDomainTrieNode *oldTrie = domainTrie;
+    domainTrie = trie;
+    os_unfair_lock_unlock(&domainTrieLock);
+    oldTrie = nil; // Released here, outside the lock
+}
+
+static inline OWCookieDomainTrieNode *_childNode(OWCookieDomainTrieNode *node, NSString *label)
+{
+    if (node == nil)
+        return nil;
+    id child = [node->_recentChildren objectForKey:label];
+    if (child == nil)
+        child = [node->_children objectForKey:label];
+    return child == [NSNull null] ? nil : child;
+}
+
+static inline OWCookieDomain *_nodeDomain(OWCookieDomainTrieNode *node)
+{
+    return node != nil ? node->_domain : nil;
+}
+
+static BOOL _nodeIsEmpty(OWCookieDomainTrieNode *node)
+{
+    if (node->_domain != nil)
+        return NO;
+    for (NSString *label in node->_recentChildren) {
+        if ([node->_recentChildren objectForKey:label] != [NSNull null])
+            return NO;
+    }
+    for (NSString *label in node->_children) {
+        if ([node->_recentChildren objectForKey:label] == nil)
+            return NO;
+    }
+    return YES;
+}
+
+// Returns nil rather than a node with neither a domain nor children, so that removing a domain also removes the nodes which only led to it.
+static OWCookieDomainTrieNode *_nodeWithDomain(OWCookieDomainTrieNode *node, NSArray *reversedLabels, NSUInteger labelIndex, OWCookieDomain *domain)
+{
+    OWCookieDomainTrieNode *newNode = [[OWCookieDomainTrieNode alloc] init];
+    if (node != nil) {
+        newNode->_children = node->_children;
+        newNode->_recentChildren = node->_recentChildren;
+        newNode->_domain = node->_domain;
+    }
+
+    if (labelIndex == [reversedLabels count]) {
+        newNode->_domain = domain;
+        return _nodeIsEmpty(newNode) ? nil : newNode;
+    }
+
+    NSString *label = [reversedLabels objectAtIndex:labelIndex];
+    OWCookieDomainTrieNode *oldChild = _childNode(node, label);
+    OWCookieDomainTrieNode *newChild = _nodeWithDomain(oldChild, reversedLabels, labelIndex + 1, domain);
+    if (oldChild == nil && newChild == nil)
+        return node; // Removing a domain that wasn't there
+
+    NSMutableDictionary *recentChildren = newNode->_recentChildren != nil ? [newNode->_recentChildren mutableCopy] : [[NSMutableDictionary alloc] init];
+    if (newChild != nil)
+        [recentChildren setObject:newChild forKey:label];
+    else if ([newNode->_children objectForKey:label] != nil)
+        [recentChildren setObject:[NSNull null] forKey:label]; // Hides the child until the recent children are merged
+    else
+        [recentChildren removeObjectForKey:label];
+    if ([recentChildren count] > MAX((NSUInteger)16, (NSUInteger)sqrt([newNode->_children count]))) {
+        NSMutableDictionary *children = newNode->_children != nil ? [newNode->_children mutableCopy] : [[NSMutableDictionary alloc] init];
+        [recentChildren enumerateKeysAndObjectsUsingBlock:^(NSString *childLabel, id child, BOOL *stop) {
+            if (child == [NSNull null])
+                [children removeObjectForKey:childLabel];
+            else
+                [children setObject:child forKey:childLabel];
+        }];
+        newNode->_children = [children copy];
+        newNode->_recentChildren = nil;
+    } else {
+        newNode->_recentChildren = [recentChildren copy];
+    }
+    return _nodeIsEmpty(newNode) ? nil : newNode;
+}
+
+static NSArray *_reversedLabels(NSString *domainName)
+{
+    return [[[domainName componentsSeparatedByString:@"."] reverseObjectEnumerator] allObjects];
+}
+
+static void _locked_setDomainInTrie(NSString *domainName, OWCookieDomain *domain)
+{
+    if (isLoadingCookies)
+        return; // The whole trie is built once loading finishes
+
+    OWCookieDomainTrieNode *trie = _nodeWithDomain(_currentDomainTrie(), _reversedLabels(domainName), 0, domain);
+    _locked_publishDomainTrie(trie != nil ? trie : [[OWCookieDomainTrieNode alloc] init]); // A nil trie would mean the cookies haven't been loaded
+}
+
+static void _locked_rebuildDomainTrie(void)
+{
+    // Built in place, since nothing else can see it until it's published.
+    OWCookieDomainTrieNode *root = [[OWCookieDomainTrieNode alloc] init];
+    root->_children = [[NSMutableDictionary alloc] init];
+    [domainsByName enumerateKeysAndObjectsUsingBlock:^(NSString *domainName, OWCookieDomain *domain, BOOL *stop) {
+        OWCookieDomainTrieNode *node = root;
+        for (NSString *label in _reversedLabels(domainName)) {
+            OWCookieDomainTrieNode *child = [node->_children objectForKey:label];
+            if (child == nil) {
+                child = [[OWCookieDomainTrieNode alloc] init];
+                child->_children = [[NSMutableDictionary alloc] init];
+                [(NSMutableDictionary *)node->_children setObject:child forKey:label];
+            }
+            node = child;
+        }
+        node->_domain = domain;
+    }];
+    _locked_publishDomainTrie(root);
+}
+
+@interface OWCookieDomain ()
+@property (atomic, copy) NSArray *cookiePathsSnapshot;
+@end
+
 @interface OWCookieDomain (PrivateAPI)
 + (void)saveCookies;
 + (NSString *)cookiePath:(NSString *)fileName;
@@ -69,9 +217,8 @@ static inline void _locked_checkCookiesLoaded()
 - (void)addCookie:(OWCookie *)cookie andNotify:(BOOL)shouldNotify;
 + (OWCookieDomain *)domainNamed:(NSString *)name andNotify:(BOOL)shouldNotify;
 - (OWCookiePath *)locked_pathNamed:(NSString *)pathName shouldCreate:(BOOL)shouldCreate;
-+ (NSArray *)searchDomainsForDomain:(NSString *)aDomain;
 + (OWCookie *)cookieFromHeaderValue:(NSString *)headerValue defaultDomain:(NSString *)defaultDomain defaultPath:(NSString *)defaultPath;
-- (void)locked_addApplicableCookies:(NSMutableArray *)cookies forPath:(NSString *)aPath urlIsSecure:(BOOL)secure includeRejected:(BOOL)includeRejected;
+- (void)addApplicableCookies:(NSMutableArray *)cookies forPath:(NSString *)aPath urlIsSecure:(BOOL)secure includeRejected:(BOOL)includeRejected;
 + (BOOL)locked_readOW5Cookies;
 - (id)initWithDomain:(NSString *)domain;
 @end
@@ -79,17 +226,15 @@ static inline void _locked_checkCookiesLoaded()
 
 @implementation OWCookieDomain
 
+// Writers serialize on domainLock and publish a new array; readers just take whatever array is current.
+@synthesize cookiePathsSnapshot = _cookiePaths;
+
 + (void)initialize;
 {
     OBINITIALIZE;
 
     domainLock = [[NSRecursiveLock alloc] init];
-    
-    endNameSet = [NSCharacterSet characterSetWithCharactersInString:@"=;, \t\r\n"];
-    endDateSet = [NSCharacterSet characterSetWithCharactersInString:@";\r\n"];
-    endNameValueSet = [NSCharacterSet characterSetWithCharactersInString:@";\r\n"];
-    endValueSet = [NSCharacterSet characterSetWithCharactersInString:@"; \t\r\n"];
-    endKeySet = [NSCharacterSet characterSetWithCharactersInString:@"=;, \t\r\n"];
+    whitespaceAndNewlineSet = CFCharacterSetGetPredefined(kCFCharacterSetWhitespaceAndNewline);
     
     distantPastInterval = [[NSDate distantPast] timeIntervalSinceReferenceDate];
 }
@@ -240,24 +385,42 @@ OBDidLoad(^{
     path = [@"/" stringByAppendingString:path];
 
     NSString *hostname = [[[url parsedNetLocation] hostname] lowercaseString];
-    NSArray *searchDomains = [self searchDomainsForDomain:hostname];
 
     if (OWCookiesDebug)
-        NSLog(@"COOKIES: url=%@ hostname=%@, path=%@ --> domains=%@", url, hostname, path, searchDomains);
+        NSLog(@"COOKIES: url=%@ hostname=%@, path=%@", url, hostname, path);
 
     NSMutableArray *cookies = [NSMutableArray array];
-    
-    [domainLock lock];
-    _locked_checkCookiesLoaded();
-    
-    NSUInteger domainIndex, domainCount = [searchDomains count];
-    for (domainIndex = 0; domainIndex < domainCount; domainIndex++) {
-        NSString *searchDomain = [searchDomains objectAtIndex:domainIndex];
-        OWCookieDomain *domain = [domainsByName objectForKey:searchDomain];
-        [domain locked_addApplicableCookies:cookies forPath:path urlIsSecure:[url isSecure] includeRejected:NO];
+
+    OWCookieDomainTrieNode *trie = _currentDomainTrie();
+    if (trie == nil) {
+        // Either the cookies haven't been loaded, or they're being loaded right now and we should wait for that.
+        [domainLock lock];
+        _locked_checkCookiesLoaded();
+        trie = _currentDomainTrie();
+        [domainLock unlock];
     }
-    
-    [domainLock unlock];
+
+    if (hostname == nil)
+        return cookies;
+
+    // The domains that apply to a host are, in order: ".host", "host", "host.local" for single-label hosts (Apple sets localhost cookie domains to "localhost.local"), and then ".suffix" for each shorter suffix of the host that is still long enough to be a registrable domain.
+    NSArray *labels = [hostname componentsSeparatedByString:@"."];
+    NSUInteger labelCount = [labels count];
+    NSUInteger minimumLabelCount = [OWURL minimumDomainComponentsForDomainComponents:labels];
+
+    // nodes[suffixLength] is the node for the last suffixLength labels of the host. The nodes are kept alive by trie.
+    __unsafe_unretained OWCookieDomainTrieNode *nodes[labelCount + 1];
+    nodes[0] = trie;
+    for (NSUInteger suffixLength = 1; suffixLength <= labelCount; suffixLength++)
+        nodes[suffixLength] = _childNode(nodes[suffixLength - 1], [labels objectAtIndex:labelCount - suffixLength]);
+
+    BOOL isSecure = [url isSecure];
+    [_nodeDomain(_childNode(nodes[labelCount], @"")) addApplicableCookies:cookies forPath:path urlIsSecure:isSecure includeRejected:NO];
+    [_nodeDomain(nodes[labelCount]) addApplicableCookies:cookies forPath:path urlIsSecure:isSecure includeRejected:NO];
+    if (labelCount == 1)
+        [_nodeDomain(_childNode(_childNode(trie, @"local"), [labels objectAtIndex:0])) addApplicableCookies:cookies forPath:path urlIsSecure:isSecure includeRejected:NO];
+    for (NSUInteger suffixLength = labelCount - 1; suffixLength >= minimumLabelCount && suffixLength > 0; suffixLength--)
+        [_nodeDomain(_childNode(nodes[suffixLength], @"")) addApplicableCookies:cookies forPath:path urlIsSecure:isSecure includeRejected:NO];
 
     if (OWCookiesDebug)
         NSLog(@"COOKIES: -cookiesForURL:%@ --> %@", [url shortDescription], [cookies description]);
@@ -401,6 +564,7 @@ OBDidLoad(^{
     _locked_checkCookiesLoaded();
     
     [domainsByName removeObjectForKey:[domain name]];
+    _locked_setDomainInTrie([domain name], nil);
     [self locked_didChange];
     
     [domainLock unlock];
@@ -448,11 +612,7 @@ OBDidLoad(^{
 
 - (NSArray *)paths;
 {
-    [domainLock lock];
-    NSArray *paths = [[NSArray alloc] initWithArray:_cookiePaths];
-    [domainLock unlock];
-    
-    return paths;
+    return self.cookiePathsSnapshot;
 }
 
 - (OWCookiePath *)pathNamed:(NSString *)pathName;
@@ -519,11 +679,10 @@ OBDidLoad(^{
     NSUInteger pathIndex, pathCount;
     
     cookies = [NSMutableArray array];
-    [domainLock lock];
-    pathCount = [_cookiePaths count];
+    NSArray *paths = self.cookiePathsSnapshot;
+    pathCount = [paths count];
     for (pathIndex = 0; pathIndex < pathCount; pathIndex++)
-        [[_cookiePaths objectAtIndex:pathIndex] addNonExpiredCookiesToArray:cookies usageIsSecure:YES includeRejected:YES];
-    [domainLock unlock];
+        [[paths objectAtIndex:pathIndex] addNonExpiredCookiesToArray:cookies usageIsSecure:YES includeRejected:YES];
     
     return cookies;
 }
@@ -559,11 +718,14 @@ OBDidLoad(^{
     domainsByName = [[NSMutableDictionary alloc] init];
     
     // Read the cookies
+    isLoadingCookies = YES;
     NS_DURING {
         [self locked_readOW5Cookies];
     } NS_HANDLER {
         NSLog(@"Exception raised while reading cookies: %@", localException);
     } NS_ENDHANDLER;
+    isLoadingCookies = NO;
+    _locked_rebuildDomainTrie();
     
     [domainLock unlock];
     
@@ -670,6 +832,7 @@ OBDidLoad(^{
     if (domain == nil) {
         domain = [[self alloc] initWithDomain:name];
         [domainsByName setObject:domain forKey:name];
+        _locked_setDomainInTrie(name, domain);
         if (shouldNotify)
             [self locked_didChange];
     }
@@ -703,7 +866,9 @@ OBDidLoad(^{
 
     if (shouldCreate) {
         path = [[OWCookiePath alloc] initWithPath:pathName];
-        [_cookiePaths insertObject:path inArraySortedUsingSelector:@selector(compare:)];
+        NSMutableArray *cookiePaths = [_cookiePaths mutableCopy];
+        [cookiePaths insertObject:path inArraySortedUsingSelector:@selector(compare:)];
+        self.cookiePathsSnapshot = cookiePaths;
     } else
         path = nil;
 
@@ -713,83 +878,132 @@ found:
     return path;
 }
 
-+ (NSArray *)searchDomainsForDomain:(NSString *)aDomain;
+// The Set-Cookie parser works straight on the header's characters. It behaves like an NSScanner that skips whitespace and newlines before each scan, which is what it used to be, but its stop characters are all ASCII so they're tested with a bit mask rather than an NSCharacterSet.
+
+typedef struct {
+    const unichar *characters;
+    NSUInteger length;
+    NSUInteger location;
+} OWSetCookieScanner;
+
+#define OWSetCookieCharacterBit(c) ((uint64_t)1 << (c))
+static const uint64_t OWSetCookieEndNameMask = OWSetCookieCharacterBit('=') | OWSetCookieCharacterBit(';') | OWSetCookieCharacterBit(',') | OWSetCookieCharacterBit(' ') | OWSetCookieCharacterBit('\t') | OWSetCookieCharacterBit('\r') | OWSetCookieCharacterBit('\n');
+static const uint64_t OWSetCookieEndNameValueMask = OWSetCookieCharacterBit(';') | OWSetCookieCharacterBit('\r') | OWSetCookieCharacterBit('\n');
+static const uint64_t OWSetCookieEndValueMask = OWSetCookieCharacterBit(';') | OWSetCookieCharacterBit(' ') | OWSetCookieCharacterBit('\t') | OWSetCookieCharacterBit('\r') | OWSetCookieCharacterBit('\n');
+static const uint64_t OWSetCookieEndKeyMask = OWSetCookieEndNameMask;
+static const uint64_t OWSetCookieEndDateMask = OWSetCookieEndNameValueMask;
+
+static inline BOOL _characterInMask(unichar character, uint64_t mask)
 {
-    if (aDomain == nil)
-        return nil;
+    return character < 64 && (mask & OWSetCookieCharacterBit(character)) != 0;
+}
 
-    NSMutableArray *domainComponents = [[aDomain componentsSeparatedByString:@"."] mutableCopy];
-    NSUInteger domainComponentCount = [domainComponents count];
-    NSUInteger minimumDomainComponents = [OWURL minimumDomainComponentsForDomainComponents:domainComponents];
-    NSMutableArray *searchDomains = [NSMutableArray arrayWithCapacity:domainComponentCount];
-    [searchDomains addObject:[@"." stringByAppendingString:aDomain]];
-    [searchDomains addObject:aDomain];
-    // Apple sets localhost cookie domains to "localhost.local"
-    if (domainComponentCount == 1)
-        [searchDomains addObject:[NSString stringWithFormat:@"%@.local", aDomain]];
-    if (domainComponentCount < minimumDomainComponents) {
-	return searchDomains;
+static inline void _skipWhitespace(OWSetCookieScanner *scanner)
+{
+    while (scanner->location < scanner->length) {
+        unichar character = scanner->characters[scanner->location];
+        if (character < 0x80) {
+            if (character != ' ' && (character < '\t' || character > '\r'))
+                return;
+        } else if (!CFCharacterSetIsCharacterMember(whitespaceAndNewlineSet, character))
+            return;
+        scanner->location++;
     }
-    domainComponentCount -= minimumDomainComponents;
-    while (domainComponentCount--) {
-	[domainComponents removeObjectAtIndex:0];
-	NSString *searchDomain = [domainComponents componentsJoinedByString:@"."];
-	[searchDomains addObject:[@"." stringByAppendingString:searchDomain]];
+}
+
+// Like -scanUpToCharactersFromSet:intoString:, this returns NO (and leaves *outRange alone) if it stops without scanning anything.
+static BOOL _scanUpToMask(OWSetCookieScanner *scanner, uint64_t mask, NSRange *outRange)
+{
+    _skipWhitespace(scanner);
+    NSUInteger start = scanner->location;
+    while (scanner->location < scanner->length && !_characterInMask(scanner->characters[scanner->location], mask))
+        scanner->location++;
+    if (scanner->location == start)
+        return NO;
+    *outRange = NSMakeRange(start, scanner->location - start);
+    return YES;
+}
+
+static void _scanMask(OWSetCookieScanner *scanner, uint64_t mask)
+{
+    _skipWhitespace(scanner);
+    while (scanner->location < scanner->length && _characterInMask(scanner->characters[scanner->location], mask))
+        scanner->location++;
+}
+
+static BOOL _scanCharacter(OWSetCookieScanner *scanner, unichar character)
+{
+    _skipWhitespace(scanner);
+    if (scanner->location >= scanner->length || scanner->characters[scanner->location] != character)
+        return NO;
+    scanner->location++;
+    return YES;
+}
+
+static inline NSString *_scannedString(OWSetCookieScanner *scanner, NSRange range)
+{
+    return [[NSString alloc] initWithCharacters:scanner->characters + range.location length:range.length];
+}
+
+// key must be lowercase ASCII.
+static BOOL _scannedKeyIsEqual(OWSetCookieScanner *scanner, NSRange range, const char *key)
+{
+    size_t keyLength = strlen(key);
+    if (range.length != keyLength)
+        return NO;
+    for (NSUInteger characterIndex = 0; characterIndex < keyLength; characterIndex++) {
+        unichar character = scanner->characters[range.location + characterIndex];
+        if (character >= 'A' && character <= 'Z')
+            character += 'a' - 'A';
+        if (character != (unichar)key[characterIndex])
+            return NO;
     }
-    return searchDomains;
+    return YES;
 }
 
-+ (OWCookie *)cookieFromHeaderValue:(NSString *)headerValue defaultDomain:(NSString *)defaultDomain defaultPath:(NSString *)defaultPath;
++ (OWCookie *)_cookieFromScanner:(OWSetCookieScanner *)scanner defaultDomain:(NSString *)defaultDomain defaultPath:(NSString *)defaultPath;
 {
-    NSScanner *scanner = [NSScanner scannerWithString:headerValue];
+    NSRange range;
 
     NSString *aName;
-    if (![scanner scanUpToCharactersFromSet:endNameSet intoString:&aName])
+    if (_scanUpToMask(scanner, OWSetCookieEndNameMask, &range))
+        aName = _scannedString(scanner, range);
+    else
         aName = [NSString string];
     
-    if (![scanner scanString:@"=" intoString:NULL])
+    if (!_scanCharacter(scanner, '='))
         return nil;
 
     // Scan the value if possible
     NSString *aValue;
-    if ([scanner scanUpToCharactersFromSet:endNameValueSet intoString:&aValue]) {
-        NSUInteger valueLength;
-        // Remove trailing whitespace
-        // This could be more efficient.  (Actually, this whole method could be more efficient:  we should rewrite it using OFStringScanner.)
-
-        valueLength = [aValue length];
-        do {
-            unichar character;
-            
-            character = [aValue characterAtIndex:valueLength - 1];
+    if (_scanUpToMask(scanner, OWSetCookieEndNameValueMask, &range)) {
+        // Remove trailing whitespace. The value can't start with whitespace, since that was skipped.
+        while (range.length > 0) {
+            unichar character = scanner->characters[NSMaxRange(range) - 1];
             if (character == ' ' || character == '\t')
-                valueLength--;
+                range.length--;
             else
                 break;
-        } while (valueLength > 0);
-        aValue = [aValue substringToIndex:valueLength];
+        }
+        aValue = _scannedString(scanner, range);
     } else {
         // If there are no characters, treat it as an empty string.
         aValue = [NSString string];
     }
 
-    [scanner scanCharactersFromSet:endKeySet intoString:NULL];
+    _scanMask(scanner, OWSetCookieEndKeyMask);
 
     NSDate *aDate = nil;
     NSString *aDomain = defaultDomain;
     NSString *aPath = defaultPath;
     BOOL isSecure = NO;
     
-    NSString *aKey;
-    while ([scanner scanUpToCharactersFromSet:endKeySet intoString:&aKey]) {
-        aKey = [aKey lowercaseString];
-        [scanner scanString:@"=" intoString:NULL];
-        if ([aKey isEqualToString:@"expires"]) {
-            NSString *dateString = nil;
-
-            [scanner scanUpToCharactersFromSet:endDateSet intoString:&dateString];
-            if (dateString) {
-                aDate = [NSDate dateWithHTTPDateString:dateString];
+    NSRange keyRange;
+    while (_scanUpToMask(scanner, OWSetCookieEndKeyMask, &keyRange)) {
+        _scanCharacter(scanner, '=');
+        if (_scannedKeyIsEqual(scanner, keyRange, "expires")) {
+            if (_scanUpToMask(scanner, OWSetCookieEndDateMask, &range)) {
+                aDate = [NSDate dateWithHTTPDateString:_scannedString(scanner, range)];
                 if (!aDate) {
                     NSCalendarDate *yearFromNowDate;
 
@@ -799,8 +1013,9 @@ found:
                     aDate = yearFromNowDate;
                 }
             }
-        } else if ([aKey isEqualToString:@"domain"]) {
-            [scanner scanUpToCharactersFromSet:endValueSet intoString:&aDomain];
+        } else if (_scannedKeyIsEqual(scanner, keyRange, "domain")) {
+            if (_scanUpToMask(scanner, OWSetCookieEndValueMask, &range))
+                aDomain = _scannedString(scanner, range);
             if (aDomain != nil) {
                 NSArray *domainComponents;
                 NSUInteger domainComponentCount;
@@ -824,23 +1039,39 @@ found:
                     aDomain = defaultDomain;
                 }
             }
-        } else if ([aKey isEqualToString:@"path"]) {
-            if (![scanner scanUpToCharactersFromSet:endValueSet intoString:&aPath]) {
+        } else if (_scannedKeyIsEqual(scanner, keyRange, "path")) {
+            if (_scanUpToMask(scanner, OWSetCookieEndValueMask, &range)) {
+                aPath = _scannedString(scanner, range);
+            } else {
                 // Some deranged people specify an empty string for the path. Assume they really meant "/" (not the default path, which is more limiting).
                 aPath = @"/";
             }
-        } else if ([aKey isEqualToString:@"secure"]) {
+        } else if (_scannedKeyIsEqual(scanner, keyRange, "secure")) {
             isSecure = YES;
         }
-        [scanner scanCharactersFromSet:endKeySet intoString:NULL];
+        _scanMask(scanner, OWSetCookieEndKeyMask);
     }
         
     return [[OWCookie alloc] initWithDomain:aDomain path:aPath name:aName value:aValue expirationDate:aDate secure:isSecure];
 }
 
-- (void)locked_addApplicableCookies:(NSMutableArray *)cookies forPath:(NSString *)aPath urlIsSecure:(BOOL)secure includeRejected:(BOOL)includeRejected;
++ (OWCookie *)cookieFromHeaderValue:(NSString *)headerValue defaultDomain:(NSString *)defaultDomain defaultPath:(NSString *)defaultPath;
+{
+    NSUInteger length = [headerValue length];
+    unichar stackCharacters[512];
+    unichar *characters = length <= sizeof(stackCharacters) / sizeof(*stackCharacters) ? stackCharacters : malloc(length * sizeof(*characters));
+    [headerValue getCharacters:characters range:NSMakeRange(0, length)];
+
+    OWCookie *cookie = [self _cookieFromScanner:&(OWSetCookieScanner){characters, length, 0} defaultDomain:defaultDomain defaultPath:defaultPath];
+
+    if (characters != stackCharacters)
+        free(characters);
+    return cookie;
+}
+
+- (void)addApplicableCookies:(NSMutableArray *)cookies forPath:(NSString *)aPath urlIsSecure:(BOOL)secure includeRejected:(BOOL)includeRejected;
 {
-    for (OWCookiePath *path in _cookiePaths) {
+    for (OWCookiePath *path in self.cookiePathsSnapshot) {
         if ([path appliesToPath:aPath]) {
             [path addNonExpiredCookiesToArray:cookies usageIsSecure:secure includeRejected:includeRejected];
         }
@@ -919,7 +1150,7 @@ static NSString *OWCookiesElementName = @"OmniWebCookies";
 
     _name = [domain copy];
     _nameDomain = [OWURL domainForHostname:_name];
-    _cookiePaths = [[NSMutableArray alloc] init];
+    _cookiePaths = [[NSArray alloc] init];
     
     return self;
 }
@@ -14,7 +14,7 @@
 @interface OWCookiePath : OFObject
 {
     NSString *_path;
-    NSMutableArray *_cookies;
+    NSArray *_cookies; // Immutable, and replaced as a whole so lookups can read it without taking the path lock
 }
 
 - initWithPath:(NSString *)aPath;
@@ -20,8 +20,15 @@ RCS_ID("$Id$")
 
 static NSLock *pathLock = nil;
 
+// Writers serialize on pathLock and publish a new array; readers just take whatever array is current, so a lookup never waits on the lock.
+@interface OWCookiePath ()
+@property (atomic, copy) NSArray *cookiesSnapshot;
+@end
+
 @implementation OWCookiePath
 
+@synthesize cookiesSnapshot = _cookies;
+
 + (void)initialize;
 {
     OBINITIALIZE;        
@@ -34,7 +41,7 @@ static NSLock *pathLock = nil;
         return nil;
 
     _path = [aPath copy];
-    _cookies = [[NSMutableArray alloc] init];
+    _cookies = [[NSArray alloc] init];
     
     return self;
 }
@@ -67,8 +74,11 @@ static NSLock *pathLock = nil;
     
     [pathLock lock];
     index = [_cookies indexOfObjectIdenticalTo:cookie];
-    if (index != NSNotFound)
-        [_cookies removeObjectAtIndex:index];
+    if (index != NSNotFound) {
+        NSMutableArray *cookies = [_cookies mutableCopy];
+        [cookies removeObjectAtIndex:index];
+        self.cookiesSnapshot = cookies;
+    }
     [pathLock unlock];
     
     if (index != NSNotFound)
@@ -77,11 +87,7 @@ static NSLock *pathLock = nil;
 
 - (NSArray *)cookies;
 {
-    [pathLock lock];
-    NSArray *cookies = [[NSArray alloc] initWithArray:_cookies];
-    [pathLock unlock];
-    
-    return cookies;
+    return self.cookiesSnapshot;
 }
 
 - (OWCookie *)cookieNamed:(NSString *)name;
@@ -89,18 +95,15 @@ static NSLock *pathLock = nil;
     OWCookie *cookie = nil;
     BOOL found = NO;
     
-    [pathLock lock];
-
-    NSUInteger cookieIndex = [_cookies count];
+    NSArray *cookies = self.cookiesSnapshot;
+    NSUInteger cookieIndex = [cookies count];
     while (cookieIndex--) {
-        cookie = [_cookies objectAtIndex:cookieIndex];
+        cookie = [cookies objectAtIndex:cookieIndex];
         if ([[cookie name] isEqualToString:name]) {
             found = YES;
             break;
         }
     }
-
-    [pathLock unlock];
     
     if (found)
         return cookie;
@@ -122,6 +125,7 @@ static NSLock *pathLock = nil;
     [pathLock lock];
     
     // If we have a cookie with the same name, replace it.
+    NSMutableArray *cookies = nil;
     NSUInteger cookieIndex = [_cookies count];
     while (cookieIndex--) {
         OWCookie *oldCookie = [_cookies objectAtIndex:cookieIndex];
@@ -150,15 +154,19 @@ static NSLock *pathLock = nil;
                 // the site that determined that status
                 [cookie setSite:[oldCookie site]];
             }
-            [_cookies replaceObjectAtIndex:cookieIndex withObject:cookie];
+            cookies = [_cookies mutableCopy];
+            [cookies replaceObjectAtIndex:cookieIndex withObject:cookie];
             needsAdding = NO;
             break;
         }
     }
     
     if (needsAdding) {
-        [_cookies addObject:cookie];
+        cookies = [_cookies mutableCopy];
+        [cookies addObject:cookie];
     }
+    if (cookies != nil)
+        self.cookiesSnapshot = cookies;
     
     [pathLock unlock];
     
@@ -172,9 +180,7 @@ static NSLock *pathLock = nil;
 
 - (void)addNonExpiredCookiesToArray:(NSMutableArray *)array usageIsSecure:(BOOL)secure includeRejected:(BOOL)includeRejected;
 {
-    [pathLock lock];
-    
-    for (OWCookie *cookie in _cookies) {
+    for (OWCookie *cookie in self.cookiesSnapshot) {
         if ([cookie isExpired])
             continue;
         if ([cookie secure] && !secure)
@@ -183,23 +189,17 @@ static NSLock *pathLock = nil;
             continue;
         [array addObject:cookie];
     }
-    
-    [pathLock unlock];
 }
 
 - (void)addCookiesToSaveToArray:(NSMutableArray *)array;
 {
-    [pathLock lock];
-
-    for (OWCookie *cookie in _cookies) {
+    for (OWCookie *cookie in self.cookiesSnapshot) {
         if ([cookie isExpired])
             continue;
         if ([cookie status] != OWCookieSavedStatus)
             continue;
         [array addObject:cookie];
     }
-
-    [pathLock unlock];
 }
 
 - (NSComparisonResult)compare:(id)otherObject;
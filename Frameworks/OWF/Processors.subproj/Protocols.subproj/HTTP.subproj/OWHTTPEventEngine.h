@@ -0,0 +1,86 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniFoundation/OFObject.h>
+#import <dispatch/dispatch.h>
+
+@class /* Foundation */ NSData, NSError;
+@class /* OmniNetworking */ ONHost;
+@class /* OWF */ OWDataStream, OWHeaderDictionary;
+@class OWHTTPEngineConnection, OWHTTPEngineResponse;
+
+/* An event-driven transport for plain HTTP/1.1. A few threads each run a kqueue (or, where there is no kqueue, epoll) loop over many non-blocking connections, so the number of open connections is no longer tied to the number of threads. Requests are written as soon as their socket is writable, which lets several be in flight on one connection, and responses are parsed incrementally as bytes arrive. Bodies are read straight into the OWDataStream the delegate hands back.
+
+The engine knows nothing about processors or caching: OWHTTPSession keeps doing all of that, one callback at a time on its own serial queue. */
+
+@protocol OWHTTPEngineConnectionDelegate
+
+// The status line and headers of the next response have arrived; interim 1xx responses never get this far. The connection stops reading until this returns. Return the stream the body should be appended to, or nil to read and discard it.
+- (OWDataStream *)engineConnection:(OWHTTPEngineConnection *)connection streamForResponse:(OWHTTPEngineResponse *)response;
+
+// Called on the engine thread, not the delegate queue, after each batch of body bytes is appended, so it must be quick.
+- (void)engineConnection:(OWHTTPEngineConnection *)connection response:(OWHTTPEngineResponse *)response didReadBodyBytes:(NSUInteger)totalBodyBytes;
+
+// The whole body, and any chunked trailer, has been read and the stream is ready to be ended.
+- (void)engineConnection:(OWHTTPEngineConnection *)connection didFinishResponse:(OWHTTPEngineResponse *)response;
+
+// The connection could not be made, failed, or was closed by the server. The response being read when that happened (if any) is passed along; its body is incomplete. Requests that had no response yet are the delegate's to retry.
+- (void)engineConnection:(OWHTTPEngineConnection *)connection didFailWithError:(NSError *)error duringResponse:(OWHTTPEngineResponse *)response;
+
+@end
+
+
+@interface OWHTTPEventEngine : OFObject
+
++ (OWHTTPEventEngine *)sharedEngine;
+    // Uses the OWHTTPEventEngineThreadCount default.
+
+- (instancetype)initWithThreadCount:(NSUInteger)threadCount;
+
+@property (nonatomic, readonly) NSUInteger threadCount;
+
+- (OWHTTPEngineConnection *)connectionToHost:(ONHost *)host port:(unsigned short)port delegate:(id <OWHTTPEngineConnectionDelegate>)delegate delegateQueue:(dispatch_queue_t)delegateQueue;
+    // Starts connecting right away. All delegate callbacks except -engineConnection:response:didReadBodyBytes: are made on delegateQueue, which should be serial.
+
+@end
+
+
+@interface OWHTTPEngineConnection : OFObject
+
+- (void)enqueueRequestData:(NSData *)requestData expectsBody:(BOOL)expectsBody context:(id)context;
+    // Requests are written in order and their responses are matched to them in order. The context comes back as the response's context. Pass NO for expectsBody for HEAD requests.
+
+@property (atomic, readonly, getter=isOpen) BOOL open;
+    // NO once the connection has failed, been closed by the server or been aborted.
+@property (atomic, readonly) BOOL didConnect;
+@property (atomic, readonly) NSUInteger outstandingRequestCount;
+    // Requests whose responses have not finished yet.
+
+- (void)abort;
+    // Closes the socket. The delegate gets -engineConnection:didFailWithError:duringResponse: with ECANCELED unless the connection had already closed.
+
+@end
+
+
+@interface OWHTTPEngineResponse : OFObject
+
+@property (nonatomic, readonly) id context;
+@property (nonatomic, readonly) float httpVersion;
+@property (nonatomic, readonly) NSInteger statusCode;
+@property (nonatomic, readonly) NSString *reasonPhrase;
+@property (nonatomic, readonly) OWHeaderDictionary *headers;
+@property (nonatomic, readonly) OWHeaderDictionary *trailers;
+    // Non-nil only for chunked bodies, once they finish.
+@property (nonatomic, readonly) BOOL isHTTP09;
+    // The server sent no status line at all; the whole stream up to EOF is the body.
+@property (nonatomic, readonly) BOOL isChunked;
+@property (nonatomic, readonly) unsigned long long bodyBytesRead;
+
+@property (atomic) NSUInteger precedingSkipLength;
+    // Set from -engineConnection:streamForResponse: to drop that many leading body bytes (used when resuming a partial fetch).
+
+@end
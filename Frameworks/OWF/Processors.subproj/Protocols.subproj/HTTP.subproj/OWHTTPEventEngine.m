@@ -0,0 +1,1107 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OWF/OWHTTPEventEngine.h>
+
+#import <Foundation/Foundation.h>
+#import <OmniBase/OmniBase.h>
+#import <OmniFoundation/OmniFoundation.h>
+#import <OmniNetworking/OmniNetworking.h>
+
+#import <OWF/OWDataStream.h>
+#import <OWF/OWHeaderDictionary.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#if defined(__APPLE__) || defined(__FreeBSD__)
+#include <sys/event.h>
+#define OW_HTTP_ENGINE_USE_KQUEUE 1
+#else
+#include <sys/epoll.h>
+#define OW_HTTP_ENGINE_USE_KQUEUE 0
+#endif
+
+RCS_ID("$Id$");
+
+#define ENGINE_EVENTS_PER_WAIT (128)
+#define ENGINE_READ_CHUNK_SIZE (32 * 1024) // Same as the blocking session's socket read buffer
+#define ENGINE_MAXIMUM_READ_PER_EVENT (256 * 1024) // So one fast connection can't starve the others on its thread
+#define ENGINE_MAXIMUM_HEAD_LENGTH (64 * 1024)
+
+#ifdef MSG_NOSIGNAL
+#define ENGINE_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define ENGINE_SEND_FLAGS 0
+#endif
+
+typedef enum {
+    OWHTTPEngineAwaitingStatusLine,
+    OWHTTPEngineReadingHeaders,
+    OWHTTPEngineAwaitingDelegate,
+    OWHTTPEngineReadingFixedBody,
+    OWHTTPEngineReadingChunkSize,
+    OWHTTPEngineReadingChunkData,
+    OWHTTPEngineReadingChunkEnd,
+    OWHTTPEngineReadingTrailers,
+    OWHTTPEngineReadingClosingBody,
+} OWHTTPEngineParseState;
+
+typedef enum {
+    OWHTTPEngineNoBody,
+    OWHTTPEngineFixedBody,
+    OWHTTPEngineChunkedBody,
+    OWHTTPEngineClosingBody,
+} OWHTTPEngineBodyMode;
+
+@interface OWHTTPEngineRequest : NSObject
+{
+@public
+    NSData *data;
+    id context;
+    BOOL expectsBody;
+}
+@end
+
+@implementation OWHTTPEngineRequest
+@end
+
+@interface OWHTTPEngineResponse ()
+- (instancetype)initWithContext:(id)context;
+@property (nonatomic, readwrite) float httpVersion;
+@property (nonatomic, readwrite) NSInteger statusCode;
+@property (nonatomic, readwrite) NSString *reasonPhrase;
+@property (nonatomic, readwrite) OWHeaderDictionary *trailers;
+@property (nonatomic, readwrite) BOOL isHTTP09;
+@property (nonatomic, readwrite) BOOL isChunked;
+@property (nonatomic, readwrite) unsigned long long bodyBytesRead;
+@end
+
+// One per engine thread. Everything a connection does to its socket happens on its loop's thread; other threads hand it work with -performBlock:.
+@interface OWHTTPEventLoop : NSObject
+- (instancetype)initWithIndex:(NSUInteger)loopIndex;
+@property (nonatomic, readonly) int pollFileDescriptor;
+- (void)performBlock:(void (^)(void))block;
+- (void)addConnection:(OWHTTPEngineConnection *)connection;
+- (void)removeConnection:(OWHTTPEngineConnection *)connection;
+@end
+
+@interface OWHTTPEngineConnection ()
+- (instancetype)initWithLoop:(OWHTTPEventLoop *)loop host:(ONHost *)host port:(unsigned short)port delegate:(id <OWHTTPEngineConnectionDelegate>)delegate delegateQueue:(dispatch_queue_t)delegateQueue;
+- (void)_loopStart;
+- (void)_loopHandleReadable;
+- (void)_loopHandleWritable;
+@property (atomic, readwrite, getter=isOpen) BOOL open;
+@property (atomic, readwrite) BOOL didConnect;
+@property (atomic, readwrite) NSUInteger outstandingRequestCount;
+@end
+
+@implementation OWHTTPEventEngine
+{
+    NSArray *_loops;
+    NSLock *_lock;
+    NSUInteger _nextLoopIndex;
+}
+
++ (OWHTTPEventEngine *)sharedEngine;
+{
+    static OWHTTPEventEngine *sharedEngine = nil;
+    static dispatch_once_t onceToken;
+
+    dispatch_once(&onceToken, ^{
+        NSInteger threadCount = [[NSUserDefaults standardUserDefaults] integerForKey:@"OWHTTPEventEngineThreadCount"];
+        sharedEngine = [[self alloc] initWithThreadCount:MAX(threadCount, 1)];
+    });
+    return sharedEngine;
+}
+
+- (instancetype)initWithThreadCount:(NSUInteger)threadCount;
+{
+    OBPRECONDITION(threadCount > 0);
+
+    if (!(self = [super init]))
+        return nil;
+
+    NSMutableArray *loops = [[NSMutableArray alloc] initWithCapacity:threadCount];
+    for (NSUInteger loopIndex = 0; loopIndex < threadCount; loopIndex++)
+        [loops addObject:[[OWHTTPEventLoop alloc] initWithIndex:loopIndex]];
+    _loops = [loops copy];
+    _lock = [[NSLock alloc] init];
+
+    return self;
+}
+
+- (NSUInteger)threadCount;
+{
+    return [_loops count];
+}
+
+- (OWHTTPEngineConnection *)connectionToHost:(ONHost *)host port:(unsigned short)port delegate:(id <OWHTTPEngineConnectionDelegate>)delegate delegateQueue:(dispatch_queue_t)delegateQueue;
+{
+    OBPRECONDITION(host != nil);
+    OBPRECONDITION(delegate != nil);
+    OBPRECONDITION(delegateQueue != nil);
+
+    [_lock lock];
+    OWHTTPEventLoop *loop = [_loops objectAtIndex:_nextLoopIndex];
+    _nextLoopIndex = (_nextLoopIndex + 1) % [_loops count];
+    [_lock unlock];
+
+    OWHTTPEngineConnection *connection = [[OWHTTPEngineConnection alloc] initWithLoop:loop host:host port:port delegate:delegate delegateQueue:delegateQueue];
+    [loop performBlock:^{
+        [connection _loopStart];
+    }];
+    return connection;
+}
+
+@end
+
+@implementation OWHTTPEventLoop
+{
+    int _pollFileDescriptor;
+    int _wakePipe[2];
+    NSLock *_commandLock;
+    NSMutableArray *_commands;
+    BOOL _wakePending;
+
+    // Only touched on the loop thread. The set keeps connections alive while the kernel holds raw pointers to them; removals wait until the current batch of events has been dispatched, since a later event in the batch may still point at a connection that closed earlier in it.
+    NSMutableSet *_connections;
+    NSMutableArray *_closedConnections;
+}
+
+- (instancetype)initWithIndex:(NSUInteger)loopIndex;
+{
+    if (!(self = [super init]))
+        return nil;
+
+    if (pipe(_wakePipe) == -1)
+        [NSException raise:NSGenericException posixErrorNumber:errno format:@"Unable to create wakeup pipe for HTTP engine: %s", strerror(errno)];
+    fcntl(_wakePipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(_wakePipe[1], F_SETFL, O_NONBLOCK);
+
+#if OW_HTTP_ENGINE_USE_KQUEUE
+    _pollFileDescriptor = kqueue();
+    if (_pollFileDescriptor == -1)
+        [NSException raise:NSGenericException posixErrorNumber:errno format:@"Unable to create kqueue for HTTP engine: %s", strerror(errno)];
+    struct kevent change;
+    EV_SET(&change, _wakePipe[0], EVFILT_READ, EV_ADD, 0, 0, NULL);
+    kevent(_pollFileDescriptor, &change, 1, NULL, 0, NULL);
+#else
+    _pollFileDescriptor = epoll_create1(EPOLL_CLOEXEC);
+    if (_pollFileDescriptor == -1)
+        [NSException raise:NSGenericException posixErrorNumber:errno format:@"Unable to create epoll instance for HTTP engine: %s", strerror(errno)];
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = NULL};
+    epoll_ctl(_pollFileDescriptor, EPOLL_CTL_ADD, _wakePipe[0], &event);
+#endif
+
+    _commandLock = [[NSLock alloc] init];
+    _commands = [[NSMutableArray alloc] init];
+    _connections = [[NSMutableSet alloc] init];
+    _closedConnections = [[NSMutableArray alloc] init];
+
+    NSThread *thread = [[NSThread alloc] initWithTarget:self selector:@selector(_run) object:nil];
+    [thread setName:[NSString stringWithFormat:@"OWHTTPEventEngine %lu", loopIndex]];
+    [thread start];
+
+    return self;
+}
+
+- (int)pollFileDescriptor;
+{
+    return _pollFileDescriptor;
+}
+
+- (void)performBlock:(void (^)(void))block;
+{
+    [_commandLock lock];
+    [_commands addObject:[block copy]];
+    BOOL shouldWake = !_wakePending;
+    _wakePending = YES;
+    [_commandLock unlock];
+
+    if (shouldWake) {
+        static const char wakeByte = 0;
+        while (write(_wakePipe[1], &wakeByte, 1) == -1 && errno == EINTR)
+            ;
+    }
+}
+
+- (void)addConnection:(OWHTTPEngineConnection *)connection;
+{
+    [_connections addObject:connection];
+}
+
+- (void)removeConnection:(OWHTTPEngineConnection *)connection;
+{
+    [_closedConnections addObject:connection];
+}
+
+#pragma mark - Private
+
+- (void)_runCommands;
+{
+    // Drain the pipe before taking the commands: a wakeup written after this point is for a command we haven't taken yet, so it must not be swallowed.
+    char drain[64];
+    while (read(_wakePipe[0], drain, sizeof(drain)) > 0)
+        ;
+
+    [_commandLock lock];
+    NSArray *commands = _commands;
+    _commands = [[NSMutableArray alloc] init];
+    _wakePending = NO;
+    [_commandLock unlock];
+
+    for (void (^command)(void) in commands)
+        command();
+}
+
+- (void)_run;
+{
+#if OW_HTTP_ENGINE_USE_KQUEUE
+    struct kevent events[ENGINE_EVENTS_PER_WAIT];
+#else
+    struct epoll_event events[ENGINE_EVENTS_PER_WAIT];
+#endif
+
+    while (YES) {
+        @autoreleasepool {
+#if OW_HTTP_ENGINE_USE_KQUEUE
+            int eventCount = kevent(_pollFileDescriptor, NULL, 0, events, ENGINE_EVENTS_PER_WAIT, NULL);
+#else
+            int eventCount = epoll_wait(_pollFileDescriptor, events, ENGINE_EVENTS_PER_WAIT, -1);
+#endif
+            if (eventCount == -1) {
+                if (errno != EINTR)
+                    NSLog(@"%@: waiting for events failed: %s", OBShortObjectDescription(self), strerror(errno));
+                continue;
+            }
+
+            for (int eventIndex = 0; eventIndex < eventCount; eventIndex++) {
+#if OW_HTTP_ENGINE_USE_KQUEUE
+                struct kevent *event = &events[eventIndex];
+                if (event->udata == NULL) {
+                    [self _runCommands];
+                    continue;
+                }
+                OWHTTPEngineConnection *connection = (__bridge OWHTTPEngineConnection *)event->udata;
+                if (event->filter == EVFILT_WRITE)
+                    [connection _loopHandleWritable];
+                else if (event->filter == EVFILT_READ)
+                    [connection _loopHandleReadable];
+#else
+                struct epoll_event *event = &events[eventIndex];
+                if (event->data.ptr == NULL) {
+                    [self _runCommands];
+                    continue;
+                }
+                OWHTTPEngineConnection *connection = (__bridge OWHTTPEngineConnection *)event->data.ptr;
+                if (event->events & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+                    [connection _loopHandleWritable];
+                if (event->events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+                    [connection _loopHandleReadable];
+#endif
+            }
+
+            for (OWHTTPEngineConnection *connection in _closedConnections)
+                [_connections removeObject:connection];
+            [_closedConnections removeAllObjects];
+        }
+    }
+}
+
+@end
+
+@implementation OWHTTPEngineConnection
+{
+    OWHTTPEventLoop *_loop;
+    __weak id <OWHTTPEngineConnectionDelegate> _delegate;
+    dispatch_queue_t _delegateQueue;
+
+    // Connecting
+    NSArray *_addresses;
+    NSUInteger _nextAddressIndex;
+    unsigned short _port;
+    int _lastErrorNumber;
+
+    // Everything below is only touched on the loop thread.
+    int _fileDescriptor;
+    BOOL _connecting;
+    BOOL _closed;
+    BOOL _registered;
+    BOOL _pollingRead;
+    BOOL _pollingWrite;
+    BOOL _readPaused;
+
+    NSMutableArray *_pendingRequests; // Sent or waiting to be sent, and not yet answered; the first is the one being read
+    NSMutableArray *_writeQueue;
+    NSUInteger _writeOffset;
+
+    NSMutableData *_readBuffer;
+    NSUInteger _readOffset;
+
+    OWHTTPEngineParseState _state;
+    OWHTTPEngineBodyMode _bodyMode;
+    OWHTTPEngineResponse *_response;
+    NSUInteger _headLength;
+    OWDataStream *_bodyStream;
+    unsigned long long _bodyBytesLeft;
+    NSUInteger _skipBytesLeft;
+    BOOL _sawChunk;
+}
+
+- (instancetype)initWithLoop:(OWHTTPEventLoop *)loop host:(ONHost *)host port:(unsigned short)port delegate:(id <OWHTTPEngineConnectionDelegate>)delegate delegateQueue:(dispatch_queue_t)delegateQueue;
+{
+    if (!(self = [super init]))
+        return nil;
+
+    _loop = loop;
+    _delegate = delegate;
+    _delegateQueue = delegateQueue;
+    _addresses = [[host addresses] copy];
+    _port = port;
+    _fileDescriptor = -1;
+    _pendingRequests = [[NSMutableArray alloc] init];
+    _writeQueue = [[NSMutableArray alloc] init];
+    _readBuffer = [[NSMutableData alloc] initWithCapacity:ENGINE_READ_CHUNK_SIZE];
+    _state = OWHTTPEngineAwaitingStatusLine;
+    self.open = YES;
+
+    return self;
+}
+
+- (void)enqueueRequestData:(NSData *)requestData expectsBody:(BOOL)expectsBody context:(id)context;
+{
+    OBPRECONDITION([requestData length] > 0);
+
+    OWHTTPEngineRequest *request = [[OWHTTPEngineRequest alloc] init];
+    request->data = [requestData copy];
+    request->context = context;
+    request->expectsBody = expectsBody;
+
+    [_loop performBlock:^{
+        if (_closed) {
+            // The server closed the connection before this request got here. Report it the same way as any other unanswered request.
+            [self _loopNotifyDelegateOfErrorNumber:ENOTCONN duringResponse:nil];
+            return;
+        }
+        [_pendingRequests addObject:request];
+        self.outstandingRequestCount = [_pendingRequests count];
+        [_writeQueue addObject:request->data];
+        if (!_connecting && _fileDescriptor != -1)
+            [self _loopFlushWrites];
+        [self _loopUpdateInterest];
+    }];
+}
+
+- (void)abort;
+{
+    [_loop performBlock:^{
+        [self _loopFailWithErrorNumber:ECANCELED];
+    }];
+}
+
+- (NSMutableDictionary *)debugDictionary;
+{
+    NSMutableDictionary *debugDictionary = [super debugDictionary];
+    [debugDictionary setObject:self.open ? @"YES" : @"NO" forKey:@"open"];
+    [debugDictionary setObject:[NSNumber numberWithUnsignedInteger:self.outstandingRequestCount] forKey:@"outstandingRequestCount"];
+    return debugDictionary;
+}
+
+#pragma mark - Connecting and closing (loop thread)
+
+- (void)_loopStart;
+{
+    [_loop addConnection:self];
+    [self _loopConnectToNextAddress];
+}
+
+static void _configureSocket(int fileDescriptor)
+{
+    int flags = fcntl(fileDescriptor, F_GETFL, 0);
+    fcntl(fileDescriptor, F_SETFL, flags | O_NONBLOCK);
+    fcntl(fileDescriptor, F_SETFD, FD_CLOEXEC);
+
+    int on = 1;
+    setsockopt(fileDescriptor, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+#ifdef SO_NOSIGPIPE
+    setsockopt(fileDescriptor, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+}
+
+- (void)_loopConnectToNextAddress;
+{
+    while (_nextAddressIndex < [_addresses count]) {
+        ONHostAddress *address = [_addresses objectAtIndex:_nextAddressIndex++];
+        struct sockaddr *socketAddress = [address mallocSockaddrWithPort:_port];
+        if (socketAddress == NULL)
+            continue;
+
+        int fileDescriptor = socket(socketAddress->sa_family, SOCK_STREAM, 0);
+        if (fileDescriptor == -1) {
+            _lastErrorNumber = errno;
+            free(socketAddress);
+            continue;
+        }
+        _configureSocket(fileDescriptor);
+
+        socklen_t socketAddressLength = (socketAddress->sa_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+        int result = connect(fileDescriptor, socketAddress, socketAddressLength);
+        int connectErrorNumber = errno;
+        free(socketAddress);
+
+        if (result == 0 || connectErrorNumber == EINPROGRESS) {
+            _fileDescriptor = fileDescriptor;
+            _connecting = (result != 0);
+            if (!_connecting)
+                self.didConnect = YES;
+            [self _loopUpdateInterest];
+            return;
+        }
+
+        _lastErrorNumber = connectErrorNumber;
+        close(fileDescriptor);
+    }
+
+    [self _loopFailWithErrorNumber:_lastErrorNumber != 0 ? _lastErrorNumber : EHOSTUNREACH];
+}
+
+- (void)_loopCloseSocket;
+{
+    if (_fileDescriptor == -1)
+        return;
+
+    // Closing the descriptor also drops it from the kqueue or epoll set.
+    close(_fileDescriptor);
+    _fileDescriptor = -1;
+    _registered = NO;
+    _pollingRead = NO;
+    _pollingWrite = NO;
+}
+
+- (void)_loopNotifyDelegateOfErrorNumber:(int)errorNumber duringResponse:(OWHTTPEngineResponse *)response;
+{
+    id <OWHTTPEngineConnectionDelegate> delegate = _delegate;
+    NSError *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errorNumber userInfo:nil];
+    dispatch_async(_delegateQueue, ^{
+        [delegate engineConnection:self didFailWithError:error duringResponse:response];
+    });
+}
+
+- (void)_loopFailWithErrorNumber:(int)errorNumber;
+{
+    if (_closed)
+        return;
+
+    OWHTTPEngineResponse *response = _response;
+
+    _closed = YES;
+    self.open = NO;
+    [self _loopCloseSocket];
+    [_loop removeConnection:self];
+
+    _response = nil;
+    _bodyStream = nil;
+    [_pendingRequests removeAllObjects];
+    self.outstandingRequestCount = 0;
+    [_writeQueue removeAllObjects];
+    _readBuffer = nil;
+
+    [self _loopNotifyDelegateOfErrorNumber:errorNumber duringResponse:response];
+}
+
+- (void)_loopUpdateInterest;
+{
+    if (_fileDescriptor == -1)
+        return;
+
+    BOOL wantsRead = !_connecting && !_readPaused;
+    BOOL wantsWrite = _connecting || [_writeQueue count] != 0;
+    if (_registered && wantsRead == _pollingRead && wantsWrite == _pollingWrite)
+        return;
+
+#if OW_HTTP_ENGINE_USE_KQUEUE
+    struct kevent changes[2];
+    int changeCount = 0;
+    if (!_registered || wantsRead != _pollingRead)
+        EV_SET(&changes[changeCount++], _fileDescriptor, EVFILT_READ, EV_ADD | (wantsRead ? EV_ENABLE : EV_DISABLE), 0, 0, (__bridge void *)self);
+    if (!_registered || wantsWrite != _pollingWrite)
+        EV_SET(&changes[changeCount++], _fileDescriptor, EVFILT_WRITE, EV_ADD | (wantsWrite ? EV_ENABLE : EV_DISABLE), 0, 0, (__bridge void *)self);
+    if (kevent([_loop pollFileDescriptor], changes, changeCount, NULL, 0, NULL) == -1) {
+        [self _loopFailWithErrorNumber:errno];
+        return;
+    }
+    _registered = YES;
+#else
+    // epoll always reports errors and hangups, even with an empty mask, so a paused connection is taken out of the set entirely rather than left to spin.
+    if (!wantsRead && !wantsWrite) {
+        if (_registered)
+            epoll_ctl([_loop pollFileDescriptor], EPOLL_CTL_DEL, _fileDescriptor, NULL);
+        _registered = NO;
+    } else {
+        struct epoll_event event = {.events = (wantsRead ? EPOLLIN : 0) | (wantsWrite ? EPOLLOUT : 0), .data.ptr = (__bridge void *)self};
+        if (epoll_ctl([_loop pollFileDescriptor], _registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, _fileDescriptor, &event) == -1) {
+            [self _loopFailWithErrorNumber:errno];
+            return;
+        }
+        _registered = YES;
+    }
+#endif
+
+    _pollingRead = wantsRead;
+    _pollingWrite = wantsWrite;
+}
+
+#pragma mark - Writing (loop thread)
+
+- (void)_loopHandleWritable;
+{
+    if (_fileDescriptor == -1)
+        return;
+
+    if (_connecting) {
+        int socketError = 0;
+        socklen_t socketErrorLength = sizeof(socketError);
+        if (getsockopt(_fileDescriptor, SOL_SOCKET, SO_ERROR, &socketError, &socketErrorLength) == -1)
+            socketError = errno;
+        if (socketError != 0) {
+            // Try the host's next address, if it has one.
+            _lastErrorNumber = socketError;
+            [self _loopCloseSocket];
+            [self _loopConnectToNextAddress];
+            return;
+        }
+        _connecting = NO;
+        self.didConnect = YES;
+    }
+
+    [self _loopFlushWrites];
+    [self _loopUpdateInterest];
+}
+
+- (void)_loopFlushWrites;
+{
+    while ([_writeQueue count] != 0) {
+        NSData *data = [_writeQueue objectAtIndex:0];
+        NSUInteger length = [data length];
+        ssize_t written = send(_fileDescriptor, (const uint8_t *)[data bytes] + _writeOffset, length - _writeOffset, ENGINE_SEND_FLAGS);
+        if (written == -1) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return;
+            [self _loopFailWithErrorNumber:errno];
+            return;
+        }
+        _writeOffset += written;
+        if (_writeOffset == length) {
+            [_writeQueue removeObjectAtIndex:0];
+            _writeOffset = 0;
+        }
+    }
+}
+
+#pragma mark - Reading (loop thread)
+
+- (BOOL)_loopCanReadDirectlyIntoStream;
+{
+    if (_bodyStream == nil || _skipBytesLeft != 0 || _readOffset != [_readBuffer length])
+        return NO;
+    return _state == OWHTTPEngineReadingFixedBody || _state == OWHTTPEngineReadingChunkData || _state == OWHTTPEngineReadingClosingBody;
+}
+
+- (void)_loopHandleReadable;
+{
+    NSUInteger readBudget = ENGINE_MAXIMUM_READ_PER_EVENT;
+
+    while (_fileDescriptor != -1 && !_readPaused && readBudget != 0) {
+        if ([self _loopCanReadDirectlyIntoStream]) {
+            // Nothing is buffered and we're in the middle of a body, so let the kernel copy straight into the data stream, as the blocking session does.
+            void *streamBuffer;
+            NSUInteger capacity = [_bodyStream appendToUnderlyingBuffer:&streamBuffer];
+            if (_state != OWHTTPEngineReadingClosingBody)
+                capacity = (NSUInteger)MIN((unsigned long long)capacity, _bodyBytesLeft);
+
+            ssize_t count = recv(_fileDescriptor, streamBuffer, capacity, 0);
+            if (count == -1) {
+                if (errno == EINTR)
+                    continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    [self _loopFailWithErrorNumber:errno];
+                return;
+            }
+            if (count == 0) {
+                [self _loopHandleEndOfFile];
+                return;
+            }
+
+            readBudget -= MIN(readBudget, (NSUInteger)count);
+            [_bodyStream wroteBytesToUnderlyingBuffer:count];
+            [self _loopDidDeliverBodyBytes:count];
+            if (_state != OWHTTPEngineReadingClosingBody) {
+                _bodyBytesLeft -= count;
+                if (_bodyBytesLeft == 0)
+                    [self _loopDidFinishBodySegment];
+            }
+            [self _loopParseBufferedBytes];
+            continue;
+        }
+
+        // Keep the consumed prefix from growing without bound.
+        NSUInteger bufferedLength = [_readBuffer length];
+        if (_readOffset != 0) {
+            uint8_t *bufferBytes = [_readBuffer mutableBytes];
+            memmove(bufferBytes, bufferBytes + _readOffset, bufferedLength - _readOffset);
+            bufferedLength -= _readOffset;
+            _readOffset = 0;
+        }
+        [_readBuffer setLength:bufferedLength + ENGINE_READ_CHUNK_SIZE];
+
+        ssize_t count = recv(_fileDescriptor, (uint8_t *)[_readBuffer mutableBytes] + bufferedLength, ENGINE_READ_CHUNK_SIZE, 0);
+        [_readBuffer setLength:bufferedLength + MAX(count, 0)];
+        if (count == -1) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                [self _loopFailWithErrorNumber:errno];
+            return;
+        }
+        if (count == 0) {
+            [self _loopParseBufferedBytes];
+            [self _loopHandleEndOfFile];
+            return;
+        }
+
+        readBudget -= MIN(readBudget, (NSUInteger)count);
+        [self _loopParseBufferedBytes];
+    }
+}
+
+- (void)_loopHandleEndOfFile;
+{
+    if (_fileDescriptor == -1)
+        return;
+
+    if (_state == OWHTTPEngineReadingClosingBody) {
+        // This is how close-delimited bodies end.
+        [self _loopFinishResponse];
+        return;
+    }
+
+    // Either the server dropped an idle keep-alive connection, or it went away in the middle of something.
+    [self _loopFailWithErrorNumber:ECONNRESET];
+}
+
+// Finds the next complete line in the buffer. *outLineLength excludes the line terminator; *outConsumedLength includes it.
+- (BOOL)_loopFindLineLength:(NSUInteger *)outLineLength consumedLength:(NSUInteger *)outConsumedLength;
+{
+    const uint8_t *bytes = (const uint8_t *)[_readBuffer bytes] + _readOffset;
+    NSUInteger available = [_readBuffer length] - _readOffset;
+
+    const uint8_t *newline = memchr(bytes, '\n', available);
+    if (newline == NULL) {
+        if (available > ENGINE_MAXIMUM_HEAD_LENGTH)
+            [self _loopFailWithErrorNumber:EMSGSIZE];
+        return NO;
+    }
+
+    NSUInteger lineLength = newline - bytes;
+    *outConsumedLength = lineLength + 1;
+    if (lineLength > 0 && bytes[lineLength - 1] == '\r')
+        lineLength--;
+    *outLineLength = lineLength;
+    return YES;
+}
+
+- (NSString *)_loopTakeLine;
+{
+    NSUInteger lineLength, consumedLength;
+    if (![self _loopFindLineLength:&lineLength consumedLength:&consumedLength])
+        return nil;
+
+    // Header text is Latin-1, as it is for ONSocketStream -readLine.
+    NSString *line = [[NSString alloc] initWithBytes:(const uint8_t *)[_readBuffer bytes] + _readOffset length:lineLength encoding:NSISOLatin1StringEncoding];
+    _readOffset += consumedLength;
+
+    _headLength += consumedLength;
+    if (_headLength > ENGINE_MAXIMUM_HEAD_LENGTH) {
+        [self _loopFailWithErrorNumber:EMSGSIZE];
+        return nil;
+    }
+    return line;
+}
+
+// Sets *outOverflowed if the digits don't fit in an NSUInteger, rather than quietly wrapping around to some other chunk size.
+static NSUInteger _hexValue(const uint8_t *bytes, NSUInteger length, BOOL *outSawDigit, BOOL *outOverflowed)
+{
+    NSUInteger result = 0;
+    BOOL sawDigit = NO;
+
+    *outOverflowed = NO;
+
+    for (NSUInteger index = 0; index < length; index++) {
+        uint8_t c = bytes[index];
+        NSUInteger digit;
+        if (c >= '0' && c <= '9')
+            digit = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            digit = c - 'A' + 10;
+        else
+            break;
+        if (result > (NSUIntegerMax >> 4))
+            *outOverflowed = YES;
+        result = result * 16 + digit;
+        sawDigit = YES;
+    }
+    *outSawDigit = sawDigit;
+    return result;
+}
+
+- (void)_loopParseBufferedBytes;
+{
+    while (_fileDescriptor != -1 && !_readPaused) {
+        const uint8_t *bytes = (const uint8_t *)[_readBuffer bytes] + _readOffset;
+        NSUInteger available = [_readBuffer length] - _readOffset;
+
+        switch (_state) {
+            case OWHTTPEngineAwaitingStatusLine: {
+                // Skip leading blank lines, which some servers send after a body whose length they miscounted (see -[OWHTTPSession readResponseForProcessor:]).
+                while (available != 0 && (*bytes == '\r' || *bytes == '\n')) {
+                    bytes++;
+                    available--;
+                    _readOffset++;
+                }
+                if (available == 0)
+                    return;
+                if ([_pendingRequests count] == 0) {
+                    // The server is talking out of turn.
+                    [self _loopFailWithErrorNumber:EPROTO];
+                    return;
+                }
+
+                OWHTTPEngineRequest *request = [_pendingRequests objectAtIndex:0];
+                _response = [[OWHTTPEngineResponse alloc] initWithContext:request->context];
+                _headLength = 0;
+
+                if (memcmp(bytes, "HTTP", MIN(available, 4)) != 0) {
+                    // HTTP/0.9: no status line or headers, and everything up to EOF is the body.
+                    _response.isHTTP09 = YES;
+                    _response.httpVersion = 0.9f;
+                    _bodyMode = OWHTTPEngineClosingBody;
+                    [self _loopAskDelegateForStream];
+                    break;
+                }
+
+                NSString *line = [self _loopTakeLine];
+                if (line == nil) {
+                    _response = nil;
+                    return;
+                }
+
+                NSScanner *scanner = [NSScanner scannerWithString:line];
+                float httpVersion = 0.0f;
+                int statusCode = 0;
+                NSString *reasonPhrase;
+                [scanner scanString:@"HTTP" intoString:NULL];
+                [scanner scanString:@"/" intoString:NULL];
+                [scanner scanFloat:&httpVersion];
+                [scanner scanInt:&statusCode];
+                if (![scanner scanUpToString:@"\n" intoString:&reasonPhrase])
+                    reasonPhrase = @"";
+                _response.httpVersion = httpVersion;
+                _response.statusCode = statusCode;
+                _response.reasonPhrase = reasonPhrase;
+                _state = OWHTTPEngineReadingHeaders;
+                break;
+            }
+
+            case OWHTTPEngineReadingHeaders:
+            case OWHTTPEngineReadingTrailers: {
+                // Wait for the whole block and hand it over in one piece, rather than making a string of each line.
+                BOOL complete;
+                NSUInteger blockLength = OWHeaderBlockLength(bytes, available, NO, &complete);
+                if (!complete) {
+                    if (_headLength + available > ENGINE_MAXIMUM_HEAD_LENGTH)
+                        [self _loopFailWithErrorNumber:EMSGSIZE];
+                    return;
+                }
+                _headLength += blockLength;
+                if (_headLength > ENGINE_MAXIMUM_HEAD_LENGTH) {
+                    [self _loopFailWithErrorNumber:EMSGSIZE];
+                    return;
+                }
+
+                // Header text is Latin-1, as it is for ONSocketStream -readLine.
+                OWHeaderDictionary *headers = (_state == OWHTTPEngineReadingHeaders) ? _response.headers : _response.trailers;
+                [headers readRFC822HeaderBytes:bytes length:blockLength encoding:kCFStringEncodingISOLatin1];
+                _readOffset += blockLength;
+
+                if (_state == OWHTTPEngineReadingTrailers)
+                    [self _loopFinishResponse];
+                else
+                    [self _loopDidReadHeaders];
+                break;
+            }
+
+            case OWHTTPEngineAwaitingDelegate:
+                return;
+
+            case OWHTTPEngineReadingFixedBody:
+            case OWHTTPEngineReadingChunkData: {
+                if (available == 0)
+                    return;
+                NSUInteger count = (NSUInteger)MIN((unsigned long long)available, _bodyBytesLeft);
+                [self _loopDeliverBodyBytes:bytes length:count];
+                _readOffset += count;
+                _bodyBytesLeft -= count;
+                if (_bodyBytesLeft == 0)
+                    [self _loopDidFinishBodySegment];
+                break;
+            }
+
+            case OWHTTPEngineReadingClosingBody:
+                if (available == 0)
+                    return;
+                [self _loopDeliverBodyBytes:bytes length:available];
+                _readOffset += available;
+                break;
+
+            case OWHTTPEngineReadingChunkSize: {
+                NSUInteger lineLength, consumedLength;
+                if (![self _loopFindLineLength:&lineLength consumedLength:&consumedLength])
+                    return;
+
+                BOOL sawDigit, overflowed;
+                NSUInteger chunkLength = _hexValue(bytes, lineLength, &sawDigit, &overflowed);
+                if (overflowed) {
+                    [self _loopFailWithErrorNumber:EMSGSIZE];
+                    return;
+                }
+                if (!_sawChunk && !sawDigit) {
+                    // Not actually chunked, whatever the headers said; read it as a closing body instead, starting with this line. (The blocking session does the same, for <http://www.msnbc.com/>.)
+                    _bodyMode = OWHTTPEngineClosingBody;
+                    _state = OWHTTPEngineReadingClosingBody;
+                    break;
+                }
+                _readOffset += consumedLength;
+                _sawChunk = YES;
+
+                if (chunkLength == 0) {
+                    _response.trailers = [[OWHeaderDictionary alloc] init];
+                    _headLength = 0;
+                    _state = OWHTTPEngineReadingTrailers;
+                } else {
+                    _bodyBytesLeft = chunkLength;
+                    _state = OWHTTPEngineReadingChunkData;
+                }
+                break;
+            }
+
+            case OWHTTPEngineReadingChunkEnd: {
+                NSUInteger lineLength, consumedLength;
+                if (![self _loopFindLineLength:&lineLength consumedLength:&consumedLength])
+                    return;
+                _readOffset += consumedLength;
+                _state = OWHTTPEngineReadingChunkSize;
+                break;
+            }
+        }
+    }
+}
+
+- (void)_loopDidReadHeaders;
+{
+    NSInteger statusCode = _response.statusCode;
+    if (statusCode >= 100 && statusCode < 200) {
+        // Interim response (100 Continue and friends): the real one follows.
+        _response = nil;
+        _state = OWHTTPEngineAwaitingStatusLine;
+        return;
+    }
+
+    OWHTTPEngineRequest *request = [_pendingRequests objectAtIndex:0];
+    OWHeaderDictionary *headers = _response.headers;
+    NSString *transferEncoding = [headers lastStringForKey:@"transfer-encoding"];
+    NSString *contentLengthString = [headers lastStringForKey:@"content-length"];
+
+    _bodyBytesLeft = 0;
+    if (!request->expectsBody || statusCode == 204 || statusCode == 304) {
+        _bodyMode = OWHTTPEngineNoBody;
+    } else if (transferEncoding != nil && [transferEncoding rangeOfString:@"chunked" options:NSCaseInsensitiveSearch].location != NSNotFound) {
+        _bodyMode = OWHTTPEngineChunkedBody;
+        _response.isChunked = YES;
+    } else if (contentLengthString != nil) {
+        long long contentLength = [contentLengthString longLongValue];
+        _bodyMode = contentLength > 0 ? OWHTTPEngineFixedBody : OWHTTPEngineNoBody;
+        _bodyBytesLeft = contentLength > 0 ? contentLength : 0;
+    } else {
+        _bodyMode = OWHTTPEngineClosingBody;
+    }
+
+    [self _loopAskDelegateForStream];
+}
+
+- (void)_loopAskDelegateForStream;
+{
+    // Stop reading while the delegate decides what to do with this response; whatever is already buffered stays put until it answers.
+    _state = OWHTTPEngineAwaitingDelegate;
+    _readPaused = YES;
+    [self _loopUpdateInterest];
+
+    OWHTTPEngineResponse *response = _response;
+    id <OWHTTPEngineConnectionDelegate> delegate = _delegate;
+    dispatch_async(_delegateQueue, ^{
+        OWDataStream *stream = [delegate engineConnection:self streamForResponse:response];
+        [_loop performBlock:^{
+            [self _loopResumeWithStream:stream forResponse:response];
+        }];
+    });
+}
+
+- (void)_loopResumeWithStream:(OWDataStream *)stream forResponse:(OWHTTPEngineResponse *)response;
+{
+    if (_closed || _response != response)
+        return; // Aborted while the delegate was thinking about it
+
+    _bodyStream = stream;
+    _skipBytesLeft = response.precedingSkipLength;
+    _sawChunk = NO;
+    _readPaused = NO;
+
+    switch (_bodyMode) {
+        case OWHTTPEngineNoBody:
+            [self _loopFinishResponse];
+            break;
+        case OWHTTPEngineFixedBody:
+            _state = OWHTTPEngineReadingFixedBody;
+            break;
+        case OWHTTPEngineChunkedBody:
+            _state = OWHTTPEngineReadingChunkSize;
+            break;
+        case OWHTTPEngineClosingBody:
+            _state = OWHTTPEngineReadingClosingBody;
+            break;
+    }
+
+    [self _loopParseBufferedBytes];
+    [self _loopUpdateInterest];
+}
+
+- (void)_loopDidDeliverBodyBytes:(NSUInteger)length;
+{
+    _response.bodyBytesRead += length;
+    [_delegate engineConnection:self response:_response didReadBodyBytes:(NSUInteger)_response.bodyBytesRead];
+}
+
+- (void)_loopDeliverBodyBytes:(const uint8_t *)bytes length:(NSUInteger)length;
+{
+    if (_skipBytesLeft != 0) {
+        NSUInteger skipLength = MIN(_skipBytesLeft, length);
+        bytes += skipLength;
+        length -= skipLength;
+        _skipBytesLeft -= skipLength;
+    }
+    if (length == 0)
+        return;
+
+    if (_bodyStream != nil) {
+        NSUInteger remaining = length;
+        while (remaining != 0) {
+            void *streamBuffer;
+            NSUInteger copyLength = MIN([_bodyStream appendToUnderlyingBuffer:&streamBuffer], remaining);
+            memcpy(streamBuffer, bytes, copyLength);
+            [_bodyStream wroteBytesToUnderlyingBuffer:copyLength];
+            bytes += copyLength;
+            remaining -= copyLength;
+        }
+    }
+    [self _loopDidDeliverBodyBytes:length];
+}
+
+- (void)_loopDidFinishBodySegment;
+{
+    if (_state == OWHTTPEngineReadingChunkData)
+        _state = OWHTTPEngineReadingChunkEnd;
+    else
+        [self _loopFinishResponse];
+}
+
+static BOOL _responseAllowsReuse(OWHTTPEngineResponse *response, OWHTTPEngineBodyMode bodyMode)
+{
+    if (response.isHTTP09 || bodyMode == OWHTTPEngineClosingBody)
+        return NO;
+
+    NSString *connectionHeader = [response.headers lastStringForKey:@"connection"];
+    if (connectionHeader != nil && [connectionHeader rangeOfString:@"close" options:NSCaseInsensitiveSearch].location != NSNotFound)
+        return NO;
+    if (response.httpVersion <= 1.0f)
+        return connectionHeader != nil && [connectionHeader rangeOfString:@"keep-alive" options:NSCaseInsensitiveSearch].location != NSNotFound;
+    return YES;
+}
+
+- (void)_loopFinishResponse;
+{
+    OWHTTPEngineResponse *response = _response;
+    BOOL allowsReuse = _responseAllowsReuse(response, _bodyMode);
+
+    [_pendingRequests removeObjectAtIndex:0];
+    self.outstandingRequestCount = [_pendingRequests count];
+    _response = nil;
+    _bodyStream = nil;
+    _state = OWHTTPEngineAwaitingStatusLine;
+
+    id <OWHTTPEngineConnectionDelegate> delegate = _delegate;
+    dispatch_async(_delegateQueue, ^{
+        [delegate engineConnection:self didFinishResponse:response];
+    });
+
+    if (!allowsReuse) {
+        // Anything still pipelined behind this response will never be answered on this connection.
+        [self _loopFailWithErrorNumber:ECONNRESET];
+    }
+}
+
+@end
+
+@implementation OWHTTPEngineResponse
+{
+    OWHeaderDictionary *_headers;
+}
+
+- (instancetype)initWithContext:(id)context;
+{
+    if (!(self = [super init]))
+        return nil;
+
+    _context = context;
+    _headers = [[OWHeaderDictionary alloc] init];
+    _reasonPhrase = @"";
+
+    return self;
+}
+
+- (OWHeaderDictionary *)headers;
+{
+    return _headers;
+}
+
+- (NSMutableDictionary *)debugDictionary;
+{
+    NSMutableDictionary *debugDictionary = [super debugDictionary];
+    [debugDictionary setObject:[NSNumber numberWithInteger:_statusCode] forKey:@"statusCode"];
+    [debugDictionary setObject:_headers forKey:@"headers"];
+    [debugDictionary setObject:[NSNumber numberWithUnsignedLongLong:_bodyBytesRead] forKey:@"bodyBytesRead"];
+    return debugDictionary;
+}
+
+@end
@@ -16,6 +16,7 @@
 @class OWPipeline, OWProcessor;
 @class OWHTTPProcessor;
 @class OWHTTPSessionQueue;
+@class OWHTTPEngineConnection, OWHTTPEngineResponse;
 @class OWDataStream;
 @class OWSitePreference;
 
@@ -27,6 +28,16 @@
     NSMutableArray *processorQueue;       // The processors whose requests we are currently handling (can be >1 for pipelined HTTP/1.1 requests)
     NSLock *processorQueueLock;
     ONSocketStream *socketStream;
+
+    // event engine (see OWHTTPEventEngine.h); used instead of socketStream when +usesEventEngine
+    dispatch_queue_t engineQueue;         // Serializes everything the session does in response to the engine
+    OWHTTPEngineConnection *engineConnection;
+    OWHTTPEngineResponse *engineResponse; // The response whose headers and body we're currently handling
+    OWDataStream *engineBodyStream;
+    struct {
+        unsigned int running:1;           // Between -runSession and telling the queue we're idle
+        unsigned int finishedProcessing:1;
+    } engineFlags;
     
     struct {
         unsigned int connectingViaProxyServer:1;
@@ -66,6 +77,8 @@
 + (void)readDefaults;
 + (Class)socketClass;
     // Must return a subclass of ONInternetSocket
++ (BOOL)usesEventEngine;
+    // YES if the OWHTTPUseEventEngine default is set and the session uses plain TCP sockets. Such sessions multiplex their connections on OWHTTPEventEngine's threads rather than blocking one thread per connection.
 + (int)defaultPort;
 + (NSArray *)browserIdentifierNames;
 + (NSDictionary *)browserIdentificationDictionaryForAddress:(OWAddress *)anAddress;
@@ -27,6 +27,7 @@
 #import <OWF/OWDataStreamCursor.h>
 #import <OWF/OWFileInfo.h>
 #import <OWF/OWHeaderDictionary.h>
+#import <OWF/OWHTTPEventEngine.h>
 #import <OWF/OWHTTPProcessor.h>
 #import <OWF/OWHTTPSessionQueue.h>
 #import <OWF/OWNetLocation.h>
@@ -83,6 +84,10 @@ RCS_ID("$Id$")
 
 @end
 
+@interface OWHTTPSession (EventEngine) <OWHTTPEngineConnectionDelegate>
+- (void)_continueEngineSession;
+@end
+
 @implementation OWHTTPSession
 
 NSString *OWCustomBrowserIdentity = @"OWCustomBrowserIdentity";
@@ -181,6 +186,12 @@ OBDidLoad(^{
     return [ONTCPSocket class];
 }
 
++ (BOOL)usesEventEngine;
+{
+    // Subclasses with their own socket class (the HTTPS plug-in) still need the blocking ONSocketStream path.
+    return [self socketClass] == [ONTCPSocket class] && [[NSUserDefaults standardUserDefaults] boolForKey:@"OWHTTPUseEventEngine"];
+}
+
 + (int)defaultPort;
 {
     return 80;
@@ -383,6 +394,8 @@ static NSComparisonResult acceptEncodingHeaderOrdering(id a, id b, void *ctxt)
     processorQueueLock = [[NSLock alloc] init];
     flags.pipeliningRequests = NO;
     failedRequests = 0;
+    if ([[self class] usesEventEngine])
+        engineQueue = dispatch_queue_create("com.omnigroup.OWF.OWHTTPSession.engine", DISPATCH_QUEUE_SERIAL);
 
     kludge.distrustContentType = [OWHTTPTrustServerContentType boolValue]? 0 : 1;
     kludge.forceTrueIdentityInUAHeader = 1;
@@ -397,6 +410,16 @@ static NSComparisonResult acceptEncodingHeaderOrdering(id a, id b, void *ctxt)
 
 - (void)runSession;
 {
+    if (engineQueue != NULL) {
+        // Nothing here blocks: requests go out on the engine's threads and the rest of the session is driven by its callbacks, so the calling thread is free as soon as this returns.
+        dispatch_async(engineQueue, ^{
+            OBASSERT(!engineFlags.running);
+            engineFlags.running = YES;
+            [self _continueEngineSession];
+        });
+        return;
+    }
+
     do {
         NSException *sessionException = nil;
 
@@ -485,6 +508,7 @@ static NSComparisonResult acceptEncodingHeaderOrdering(id a, id b, void *ctxt)
     if (abortedProcessorIndex == 0) {
         // The processor being aborted is at the head of the queue, possibly reading its response: drop the connection
         [(ONInternetSocket *)[socketStream socket] abortSocket];
+        [engineConnection abort];
     } else {
         // Do nothing. When the processor reaches the head of the queue, we will notice that its state is OWProcessorAborting and drop the connection. Meanwhile, we can continue to read responses for still-valid requests.
     }
@@ -913,7 +937,13 @@ static NSComparisonResult acceptEncodingHeaderOrdering(id a, id b, void *ctxt)
                 
             [aProcessor setStatusFormat:NSLocalizedStringFromTableInBundle(@"Requesting document from %@", @"OWF", [OWHTTPSession bundle], @"httpsession status"), [proxyLocation shortDisplayString]];
             
-            if (requestData) {
+            if (engineConnection != nil) {
+                // Latin-1, as ONSocket uses by default. The engine writes requests as soon as the socket will take them, so everything we've queued here is in flight at once.
+                NSMutableData *engineRequestData = [[requestString dataUsingEncoding:NSISOLatin1StringEncoding allowLossyConversion:YES] mutableCopy];
+                if (requestData)
+                    [engineRequestData appendData:requestData];
+                [engineConnection enqueueRequestData:engineRequestData expectsBody:![[anAddress methodString] isEqualToString:@"HEAD"] context:aProcessor];
+            } else if (requestData) {
                 if (OWHTTPDebug)
                     // TODO: Eliminate dependence on the default C string encoding, which might change to something which cannot express arbitrary sequences of bytes.
                     NSLog(@"Tx: %@", [NSString stringWithCString:[requestData bytes] encoding:NSASCIIStringEncoding]);
@@ -1426,9 +1456,10 @@ static void notifyCredentials(NSArray *credentials, BOOL success, OWHeaderDictio
 {
     NSString *line;
     NSScanner *scanner;
-    float httpVersion;
-    HTTPStatus httpStatus;
-    NSString *commentString;
+    BOOL isHTTP09;
+    float httpVersion = 0.0f;
+    HTTPStatus httpStatus = 0;
+    NSString *commentString = @"";
     OWAuthorizationRequest *authorizationRequest;
     NSArray *newCredentials, *oldCredentials;
 
@@ -1436,23 +1467,43 @@ static void notifyCredentials(NSArray *credentials, BOOL success, OWHeaderDictio
 
 beginReadResponse:    
     
-    line = [socketStream peekLine];
-    while (line != nil && [line isEqualToString:@""]) {
-        // Skipping past leading newlines in the response fixes a problem I was seeing talking to a SmallWebServer/2.0 (used in some bulletin boards like the one at Clan Fat, http://pub12.ezboard.com/bfat).  I think what might have happened is that they miscalculated their content length in an earlier request, and sent us an extra newline following the counted bytes.  The result was that every other request to the server would fail.
-        // Note:  if we're actually talking to an HTTP 0.9 server, it's possible we're losing blank lines at the beginning of the content they're sending us.  But since I haven't seen any HTTP 0.9 servers in a long, long time...
-        [socketStream readLine]; // Skip past the empty line
-        line = [socketStream peekLine]; // And peek at the next one
-    }
-    
-    if (line == nil) {
-        [NSException raise:@"No response" reason:NSLocalizedStringFromTableInBundle(@"The web server closed the connection without sending any response", @"OWF", [OWHTTPSession bundle], @"httpsession error - no response")];
+    if (engineResponse != nil) {
+        // The event engine has already parsed the status line, and skipped any interim 1xx responses.
+        isHTTP09 = [engineResponse isHTTP09];
+        httpVersion = [engineResponse httpVersion];
+        httpStatus = (HTTPStatus)[engineResponse statusCode];
+        commentString = [engineResponse reasonPhrase];
+        if (OWHTTPDebug)
+            NSLog(@"%@ Rx: HTTP/%.1f %d %@", [fetchURL scheme], httpVersion, httpStatus, commentString);
+    } else {
+        line = [socketStream peekLine];
+        while (line != nil && [line isEqualToString:@""]) {
+            // Skipping past leading newlines in the response fixes a problem I was seeing talking to a SmallWebServer/2.0 (used in some bulletin boards like the one at Clan Fat, http://pub12.ezboard.com/bfat).  I think what might have happened is that they miscalculated their content length in an earlier request, and sent us an extra newline following the counted bytes.  The result was that every other request to the server would fail.
+            // Note:  if we're actually talking to an HTTP 0.9 server, it's possible we're losing blank lines at the beginning of the content they're sending us.  But since I haven't seen any HTTP 0.9 servers in a long, long time...
+            [socketStream readLine]; // Skip past the empty line
+            line = [socketStream peekLine]; // And peek at the next one
+        }
+        
+        if (line == nil) {
+            [NSException raise:@"No response" reason:NSLocalizedStringFromTableInBundle(@"The web server closed the connection without sending any response", @"OWF", [OWHTTPSession bundle], @"httpsession error - no response")];
+        }
+        
+        if (OWHTTPDebug)
+            NSLog(@"%@ Rx: %@", [fetchURL scheme], line);
+        scanner = [NSScanner scannerWithString:line];
+
+        isHTTP09 = ![scanner scanString:@"HTTP" intoString:NULL];
+        if (!isHTTP09) {
+            [socketStream readLine]; // Skip past the line we're already parsing
+            [scanner scanString:@"/" intoString:NULL];
+            [scanner scanFloat:&httpVersion];
+            [scanner scanInt:(int *)&httpStatus];
+            if (![scanner scanUpToString:@"\n" intoString:&commentString])
+                commentString = @"";
+        }
     }
-    
-    if (OWHTTPDebug)
-        NSLog(@"%@ Rx: %@", [fetchURL scheme], line);
-    scanner = [NSScanner scannerWithString:line];
 
-    if (![scanner scanString:@"HTTP" intoString:NULL]) {
+    if (isHTTP09) {
         // 0.9 server:  good luck!
         NSLog(@"%@ is ancient, good luck!", [proxyLocation shortDisplayString]);
         [processor setStatusFormat:NSLocalizedStringFromTableInBundle(@"%@ is ancient, good luck!", @"OWF", [OWHTTPSession bundle], @"httpsession status for HTTP/0.9 servers"), [proxyLocation shortDisplayString]];
@@ -1462,19 +1513,12 @@ beginReadResponse:
         return YES;
     }
 
-    [socketStream readLine]; // Skip past the line we're already parsing
-    [scanner scanString:@"/" intoString:NULL];
-    [scanner scanFloat:&httpVersion];
     if (OWHTTPDebug)
         NSLog(@"Rx: %@", [fetchAddress addressString]);
     if (httpVersion > 1.0) {
         [queue setServerUnderstandsPipelinedRequests];
     }
 
-    [scanner scanInt:(int *)&httpStatus];
-    if (![scanner scanUpToString:@"\n" intoString:&commentString])
-        commentString = @"";
-
     [processor setHTTPStatusCode:httpStatus];
 
 processStatus:
@@ -1742,6 +1786,15 @@ processStatus:
     }
     
     [processor setStatusFormat:NSLocalizedStringFromTableInBundle(@"Reading document from %@", @"OWF", [OWHTTPSession bundle], @"httpsession status"), [proxyLocation shortDisplayString]];
+
+    if (engineResponse != nil) {
+        // The event engine reads the body into whatever stream we hand back from -engineConnection:streamForResponse:, and -engineConnection:didFinishResponse: ends it. As with the blocking readers, a chunked body's headers aren't complete until its trailer has been read.
+        engineBodyStream = interruptedDataStream;
+        [engineResponse setPrecedingSkipLength:interruptedDataStream != nil ? precedingSkipLength : 0];
+        if (![engineResponse isChunked])
+            [processor markEndOfHeaders];
+        return;
+    }
     
     @try {
 
@@ -1783,19 +1836,42 @@ processStatus:
     BOOL successResponse;
 
     [processor setStatusFormat:NSLocalizedStringFromTableInBundle(@"Awaiting document info from %@", @"OWF", [OWHTTPSession bundle], @"httpsession status"), [proxyLocation shortDisplayString]];
-    NSString *line = [socketStream peekLine];
-    while (line != nil && [line isEqualToString:@""]) {
-        // Skipping past leading newlines in the response fixes a problem I was seeing talking to a SmallWebServer/2.0 (used in some bulletin boards like the one at Clan Fat, http://pub12.ezboard.com/bfat).  I think what might have happened is that they miscalculated their content length in an earlier request, and sent us an extra newline following the counted bytes.  The result was that every other request to the server would fail.
-        // Note:  if we're actually talking to an HTTP 0.9 server, it's possible we're losing blank lines at the beginning of the content they're sending us.  But since I haven't seen any HTTP 0.9 servers in a long, long time...
-        [socketStream readLine]; // Skip past the empty line
-        line = [socketStream peekLine]; // And peek at the next one
+
+    BOOL isHTTP09;
+    float httpVersion = 0.0f;
+    HTTPStatus httpStatus = 0;
+    NSString *commentString = @"";
+    if (engineResponse != nil) {
+        // The event engine has already parsed the status line, and skipped any interim 1xx responses.
+        isHTTP09 = [engineResponse isHTTP09];
+        httpVersion = [engineResponse httpVersion];
+        httpStatus = (HTTPStatus)[engineResponse statusCode];
+        commentString = [engineResponse reasonPhrase];
+    } else {
+        NSString *line = [socketStream peekLine];
+        while (line != nil && [line isEqualToString:@""]) {
+            // Skipping past leading newlines in the response fixes a problem I was seeing talking to a SmallWebServer/2.0 (used in some bulletin boards like the one at Clan Fat, http://pub12.ezboard.com/bfat).  I think what might have happened is that they miscalculated their content length in an earlier request, and sent us an extra newline following the counted bytes.  The result was that every other request to the server would fail.
+            // Note:  if we're actually talking to an HTTP 0.9 server, it's possible we're losing blank lines at the beginning of the content they're sending us.  But since I haven't seen any HTTP 0.9 servers in a long, long time...
+            [socketStream readLine]; // Skip past the empty line
+            line = [socketStream peekLine]; // And peek at the next one
+        }
+        if (line == nil)
+            return NO;
+        if (OWHTTPDebug)
+            NSLog(@"%@ Rx: %@", [fetchURL scheme], line);
+        NSScanner *scanner = [NSScanner scannerWithString:line];
+        isHTTP09 = ![scanner scanString:@"HTTP" intoString:NULL];
+        if (!isHTTP09) {
+            [socketStream readLine]; // Skip past the line we're already parsing
+            [scanner scanString:@"/" intoString:NULL];
+            [scanner scanFloat:&httpVersion];
+            [scanner scanInt:(int *)&httpStatus];
+            if (![scanner scanUpToString:@"\n" intoString:&commentString])
+                commentString = @"";
+        }
     }
-    if (line == nil)
-        return NO;
-    if (OWHTTPDebug)
-        NSLog(@"%@ Rx: %@", [fetchURL scheme], line);
-    NSScanner *scanner = [NSScanner scannerWithString:line];
-    if (![scanner scanString:@"HTTP" intoString:NULL]) {
+
+    if (isHTTP09) {
         // 0.9 server, so can't determine timestamp
         OWFileInfo *stamp = [[OWFileInfo alloc] initWithLastChangeDate:nil];
         OWContent *resultContent = [[OWContent alloc] initWithContent:stamp];
@@ -1804,23 +1880,12 @@ processStatus:
         return YES;
     }
 
-    [socketStream readLine]; // Skip past the line we're already parsing
-    [scanner scanString:@"/" intoString:NULL];
-    float httpVersion;
-    [scanner scanFloat:&httpVersion];
     if (OWHTTPDebug)
         NSLog(@"Rx: %@", [fetchAddress addressString]);
     if (httpVersion > 1.0) {
         [queue setServerUnderstandsPipelinedRequests];
     }
 
-    HTTPStatus httpStatus;
-    [scanner scanInt:(int *)&httpStatus];
-
-    NSString *commentString;
-    if (![scanner scanUpToString:@"\n" intoString:&commentString])
-        commentString = @"";
-
 processStatus:
     switch (httpStatus) {
 
@@ -1955,7 +2020,10 @@ processStatus:
 
 - (void)readHeadersForProcessor:(OWHTTPProcessor *)processor;
 {
-    [headerDictionary readRFC822HeadersFromSocketStream:socketStream];
+    if (engineResponse != nil)
+        [headerDictionary addStringsFromDictionary:[[engineResponse headers] dictionarySnapshot]];
+    else
+        [headerDictionary readRFC822HeadersFromSocketStream:socketStream];
     if (OWHTTPDebug)
         NSLog(@"Rx Headers:\n%@", headerDictionary);
 
@@ -2156,6 +2224,11 @@ processStatus:
 - (void)_closeSocketStream;
 {
     socketStream = nil;
+
+    // Forget the connection before aborting it, so its failure callback is ignored.
+    OWHTTPEngineConnection *connection = engineConnection;
+    engineConnection = nil;
+    [connection abort];
 }
 
 // Exception handling
@@ -2172,3 +2245,268 @@ processStatus:
 }
 
 @end
+
+@implementation OWHTTPSession (EventEngine)
+
+// Everything in this category runs on engineQueue. It's the engine-driven counterpart of -runSession's loop: rather than blocking in -fetchForProcessor:, we send what we can and return, and pick up again as the engine's callbacks arrive.
+
+- (void)_connectEngine;
+{
+    NSBundle *myBundle = OMNI_BUNDLE;
+
+    OBPRECONDITION(engineConnection == nil);
+
+    requestsSentThisConnection = 0;
+
+    [self setStatusFormat:NSLocalizedStringFromTableInBundle(@"Finding %@", @"OWF", myBundle, @"http session status"), [proxyLocation shortDisplayString]];
+    NSString *port = [proxyLocation port];
+    ONHost *host = [ONHost hostForHostname:[proxyLocation hostname]];
+    [self setStatusFormat:NSLocalizedStringFromTableInBundle(@"Contacting %@", @"OWF", myBundle, @"http session status"), [proxyLocation shortDisplayString]];
+    flags.serverIsLocal = [host isLocalHost]?1:0;
+
+    engineConnection = [[OWHTTPEventEngine sharedEngine] connectionToHost:host port:port ? [port intValue] : [[self class] defaultPort] delegate:self delegateQueue:engineQueue];
+}
+
+- (void)_continueEngineSession;
+{
+    OBPRECONDITION(engineFlags.running);
+
+    while (YES) {
+        @autoreleasepool {
+            @try {
+                if (engineConnection != nil && ![engineConnection isOpen]) {
+                    // Whatever was in flight on the old connection goes back in the queue, as in -sendRequest.
+                    [self disconnectAndRequeueProcessors];
+                }
+                if (engineConnection == nil && [queue anyProcessor] != nil)
+                    [self _connectEngine];
+                if (engineConnection != nil)
+                    [self sendRequests];
+            } @catch (NSException *localException) {
+                [self _notifyProcessorsOfEngineSessionException:localException includingQueue:(requestsSentThisConnection == 0)];
+            }
+        }
+
+        [processorQueueLock lock];
+        BOOL waitingForResponses = ([processorQueue count] != 0);
+        [processorQueueLock unlock];
+        if (waitingForResponses)
+            return; // The engine calls back as responses arrive
+
+        if ([queue sessionIsIdle:self]) {
+            engineFlags.running = NO;
+            return;
+        }
+    }
+}
+
+- (void)_notifyProcessorsOfEngineSessionException:(NSException *)sessionException includingQueue:(BOOL)includingQueue;
+{
+    [processorQueueLock lock];
+    NSArray *processorQueueSnapshot = [[NSArray alloc] initWithArray:processorQueue];
+    [processorQueue removeAllObjects];
+    [processorQueueLock unlock];
+
+    OFForEachInArray(processorQueueSnapshot, OWHTTPProcessor *, aProcessor,
+                     [self notifyProcessor:aProcessor ofSessionException:sessionException]);
+    [self disconnectAndRequeueProcessors]; // Nothing left to requeue; this just drops the connection
+
+    if (includingQueue) {
+        // We never got as far as a response (the server is down or doesn't exist), so everything waiting for this server would fail the same way.
+        OWHTTPProcessor *aProcessor;
+        while ((aProcessor = [queue nextProcessor])) {
+            [self notifyProcessor:aProcessor ofSessionException:sessionException];
+        }
+    }
+}
+
+- (void)_clearEngineFetch;
+{
+    fetchAddress = nil;
+    fetchURL = nil;
+    headerDictionary = nil;
+    interruptedDataStream = nil;
+    engineResponse = nil;
+    engineBodyStream = nil;
+}
+
+// The tail of -fetchForProcessor: and -runSession's loop, for one response.
+- (void)_finishEngineFetchForProcessor:(OWHTTPProcessor *)aProcessor exception:(NSException *)sessionException;
+{
+    BOOL finishedProcessing = (sessionException != nil || engineFlags.finishedProcessing);
+
+    if (sessionException != nil) {
+        [self notifyProcessor:aProcessor ofSessionException:sessionException];
+    } else if (finishedProcessing) {
+        [aProcessor processEnd];
+        [aProcessor retire];
+    }
+
+    if (finishedProcessing) {
+        [processorQueueLock lock];
+        NSUInteger finishedProcessorIndex = [processorQueue indexOfObjectIdenticalTo:aProcessor];
+        if (finishedProcessorIndex != NSNotFound)
+            [processorQueue removeObjectAtIndex:finishedProcessorIndex];
+        [processorQueueLock unlock];
+    }
+
+    [self _clearEngineFetch];
+
+    // An unfinished processor wants to try again (new credentials, say); without pipelining, -runSession uses a new connection for each request. Either way the processors still queued on this connection go back to the session queue.
+    if (!finishedProcessing || !flags.pipeliningRequests)
+        [self disconnectAndRequeueProcessors];
+}
+
+// Mirrors -fetchForProcessor:'s handling of a connection that was dropped under a response. Returns the exception to give the processor, or nil if it should be retried.
+- (NSException *)_exceptionForDroppedEngineConnectionWithErrorNumber:(int)errorNumber;
+{
+    NSException *dropException = [NSException exceptionWithName:ONInternetSocketReadFailedExceptionName posixErrorNumber:errorNumber format:@"%s", strerror(errorNumber)];
+
+    if (errorNumber != ECONNRESET && errorNumber != ENOTCONN && errorNumber != EPIPE)
+        return dropException;
+
+    if (flags.pipeliningRequests) {
+        // This HTTP 1.1 connection was reset by the server. If we've been dropped without getting much data, try a traditional HTTP/1.0 connection instead.
+        if ([interruptedDataStream bufferedDataLength] < 1024)
+            [queue setServerCannotHandlePipelinedRequestsReliably];
+        failedRequests = 0;
+        return nil;
+    }
+
+    // Our HTTP/1.0 connection appears to have been dropped:  overloaded server, perhaps?  Let's retry a few times.
+    failedRequests++;
+    if (interruptedDataStream != nil || failedRequests > 3)
+        return dropException;
+    return nil;
+}
+
+#pragma mark - OWHTTPEngineConnectionDelegate
+
+- (OWDataStream *)engineConnection:(OWHTTPEngineConnection *)connection streamForResponse:(OWHTTPEngineResponse *)response;
+{
+    if (connection != engineConnection)
+        return nil;
+
+    OWHTTPProcessor *aProcessor = [response context];
+#ifdef OMNI_ASSERTIONS_ON
+    [processorQueueLock lock];
+    OBASSERT([processorQueue count] != 0 && [processorQueue objectAtIndex:0] == aProcessor);
+    [processorQueueLock unlock];
+#endif
+
+    if ([aProcessor status] != OWProcessorRunning) {
+        // As in -runSession: rather than read a response nobody wants, drop the connection and requeue everything pipelined on it. (Aborted processors get retired when they come back around.)
+        [self disconnectAndRequeueProcessors];
+        [self _continueEngineSession];
+        return nil;
+    }
+
+    [aProcessor processBegin];
+
+    engineResponse = response;
+    engineBodyStream = nil;
+    engineFlags.finishedProcessing = NO;
+    fetchAddress = [aProcessor sourceAddress];
+    fetchURL = [fetchAddress url];
+    headerDictionary = [[OWHeaderDictionary alloc] init];
+    interruptedDataStream = [aProcessor dataStream];
+
+    NSException *sessionException = nil;
+    @try {
+        if ([[fetchAddress methodString] isEqualToString:@"HEAD"])
+            engineFlags.finishedProcessing = [self readHeadForProcessor:aProcessor];
+        else
+            engineFlags.finishedProcessing = [self readResponseForProcessor:aProcessor];
+        failedRequests = 0;
+    } @catch (NSException *localException) {
+        sessionException = localException;
+    }
+
+    if (sessionException != nil) {
+        [aProcessor markEndOfHeaders];
+        [interruptedDataStream dataAbort];
+        [self _finishEngineFetchForProcessor:aProcessor exception:sessionException];
+        [self disconnectAndRequeueProcessors];
+        [self _continueEngineSession];
+        return nil;
+    }
+
+    return engineBodyStream;
+}
+
+- (void)engineConnection:(OWHTTPEngineConnection *)connection response:(OWHTTPEngineResponse *)response didReadBodyBytes:(NSUInteger)totalBodyBytes;
+{
+    // This is on the engine's thread, so leave the session alone and just report progress.
+    NSString *contentLengthString = [[response headers] lastStringForKey:@"content-length"];
+    [(OWHTTPProcessor *)[response context] processedBytes:totalBodyBytes ofBytes:contentLengthString != nil ? (NSUInteger)[contentLengthString longLongValue] : 0];
+}
+
+- (void)engineConnection:(OWHTTPEngineConnection *)connection didFinishResponse:(OWHTTPEngineResponse *)response;
+{
+    if (connection != engineConnection || response != engineResponse)
+        return;
+
+    OWHTTPProcessor *aProcessor = [response context];
+    if ([response isChunked]) {
+        if ([response trailers] != nil)
+            [aProcessor addHeaders:[response trailers]];
+        [aProcessor markEndOfHeaders];
+    }
+    [engineBodyStream dataEnd];
+
+    [self _finishEngineFetchForProcessor:aProcessor exception:nil];
+    [self _continueEngineSession];
+}
+
+- (void)engineConnection:(OWHTTPEngineConnection *)connection didFailWithError:(NSError *)error duringResponse:(OWHTTPEngineResponse *)response;
+{
+    if (connection != engineConnection)
+        return; // We already dropped this one on purpose
+
+    int errorNumber = (int)[error code];
+    if (OWHTTPDebug)
+        NSLog(@"%@: connection to %@ failed: %@", OBShortObjectDescription(self), [proxyLocation shortDisplayString], error);
+
+    if (![connection didConnect] && errorNumber != ECANCELED) {
+        NSException *connectException = [NSException exceptionWithName:ONInternetSocketConnectFailedExceptionName posixErrorNumber:errorNumber format:@"%@: %s", [proxyLocation shortDisplayString], strerror(errorNumber)];
+        [self _notifyProcessorsOfEngineSessionException:connectException includingQueue:YES];
+    } else if (response != nil && response == engineResponse) {
+        OWHTTPProcessor *aProcessor = [response context];
+        if ([aProcessor status] == OWProcessorAborting) {
+            // Same as -readBodyForProcessor:ignore: noticing the abort
+            [aProcessor markEndOfHeaders];
+            [engineBodyStream dataAbort];
+            engineFlags.finishedProcessing = YES;
+            [self _finishEngineFetchForProcessor:aProcessor exception:nil];
+        } else {
+            NSException *sessionException = [self _exceptionForDroppedEngineConnectionWithErrorNumber:errorNumber];
+            if (sessionException != nil) {
+                [aProcessor markEndOfHeaders];
+                [interruptedDataStream dataAbort];
+                [self _finishEngineFetchForProcessor:aProcessor exception:sessionException];
+            } else {
+                // Leave it at the head of the queue; it's requeued below with whatever data it has so far.
+                [self _clearEngineFetch];
+            }
+        }
+    } else if (errorNumber != ECANCELED) {
+        // Dropped between responses. That's fine on an idle connection, but requests in flight are another matter.
+        [processorQueueLock lock];
+        OWHTTPProcessor *headProcessor = [processorQueue count] != 0 ? [processorQueue objectAtIndex:0] : nil;
+        [processorQueueLock unlock];
+
+        if (headProcessor != nil) {
+            NSException *sessionException = [self _exceptionForDroppedEngineConnectionWithErrorNumber:errorNumber];
+            if (sessionException != nil) {
+                engineFlags.finishedProcessing = NO;
+                [self _finishEngineFetchForProcessor:headProcessor exception:sessionException];
+            }
+        }
+    }
+
+    [self disconnectAndRequeueProcessors];
+    if (engineFlags.running)
+        [self _continueEngineSession];
+}
+
+@end
@@ -35,6 +35,8 @@ RCS_ID("$Id$")
 @interface OWHTMLToSGMLObjects (Private)
 + (void)_decodeEntriesFromCharacterDictionary:(NSDictionary *)characterDictionary intoStringDictionary:(NSMutableDictionary *)stringDictionary;
 + (NSDictionary *)_invertEntitiesFromDictionary:(NSDictionary *)dictionary;
++ (void)_buildEntityTable;
++ (NSString *)_stringForCharacterReference:(UnicodeScalarValue)character;
 - (void)_initStreams;
 - (void)_objectStreamIsValid;
 - (void)_scanContent;
@@ -48,6 +50,7 @@ RCS_ID("$Id$")
 - (id <OWSGMLToken>)_readEntity;
 - (id <OWSGMLToken>)_readCharacterReference;
 - (id <OWSGMLToken>)_readEntityReference;
+- (id <OWSGMLToken>)_readEntityReferenceFromCharacters:(unichar *)name length:(NSUInteger)nameLength;
 - (unsigned int)_readNumber;
 - (unsigned int)_readHexNumber;
 - (void)_skipToEndOfTag;
@@ -86,6 +89,78 @@ static OFCharacterSet *InvertedNameOFCharacterSet;
 static OFCharacterSet *NameStartOFCharacterSet;
 static OFCharacterSet *TagEndOrNameStartOFCharacterSet;
 
+// Entity names are looked up directly in the scanner's buffer, without making a string of the name, through a perfect hash built from entities.plist at startup: the first hash picks a bucket, and each bucket has a seed for the second hash that was chosen so that no two names share a slot. So a lookup is two hashes and one comparison.
+
+typedef struct {
+    NSUInteger nameOffset; // Into entityNameCharacters
+    NSUInteger nameLength; // 0 for an empty slot
+    __unsafe_unretained NSString *basicValue; // Value when the name isn't followed by ';' (from basicStringEntityDictionary, which keeps it alive)
+    __unsafe_unretained NSString *extendedValue; // Value when it is (from extendedStringEntityDictionary)
+} OWHTMLEntity;
+
+static OWHTMLEntity *entityTable;
+static NSUInteger entityTableMask;
+static uint32_t *entityBucketSeeds;
+static NSUInteger entityBucketMask;
+static unichar *entityNameCharacters;
+static NSUInteger entityMaximumNameLength;
+
+// Character references below 256 are common enough (and the CP1252 fallback for 0x80-0x9f slow enough) that their strings are made once.
+static NSString *characterReferenceStrings[256];
+
+static inline uint32_t _entityHash(uint32_t seed, const unichar *characters, NSUInteger length)
+{
+    uint32_t hash = 2166136261u ^ (seed * 0x9e3779b9u);
+    for (NSUInteger characterIndex = 0; characterIndex < length; characterIndex++) {
+        hash ^= characters[characterIndex];
+        hash *= 16777619u;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    return hash;
+}
+
+static inline const OWHTMLEntity *_lookupEntity(const unichar *characters, NSUInteger length)
+{
+    if (length == 0 || length > entityMaximumNameLength)
+        return NULL;
+
+    uint32_t seed = entityBucketSeeds[_entityHash(0, characters, length) & entityBucketMask];
+    const OWHTMLEntity *entity = &entityTable[_entityHash(seed, characters, length) & entityTableMask];
+    if (entity->nameLength != length || memcmp(entityNameCharacters + entity->nameOffset, characters, length * sizeof(unichar)) != 0)
+        return NULL;
+    return entity;
+}
+
+// Returns the first '<' or '&' at or after location, or end if there isn't one. Four characters are tested at a time: xor-ing a word with the target in every 16-bit lane zeroes the lanes that match, and the usual zero-lane test finds those.
+static inline const unichar *_scanToMarkupCharacter(const unichar *location, const unichar *end)
+{
+    while (location < end && ((uintptr_t)location & (sizeof(uint64_t) - 1)) != 0) {
+        if (*location == '<' || *location == '&')
+            return location;
+        location++;
+    }
+
+    static const uint64_t ones = 0x0001000100010001ULL, highBits = 0x8000800080008000ULL;
+    static const uint64_t leftAngleBrackets = 0x003c003c003c003cULL, ampersands = 0x0026002600260026ULL;
+    while (end - location >= 4) {
+        uint64_t word;
+        memcpy(&word, location, sizeof(word)); // Aligned, so this is a single load
+        uint64_t bracketLanes = word ^ leftAngleBrackets, ampersandLanes = word ^ ampersands;
+        if ((((bracketLanes - ones) & ~bracketLanes) | ((ampersandLanes - ones) & ~ampersandLanes)) & highBits)
+            break;
+        location += 4;
+    }
+
+    while (location < end) {
+        if (*location == '<' || *location == '&')
+            return location;
+        location++;
+    }
+    return end;
+}
+
 + (void)initialize;
 {
     OBINITIALIZE;
@@ -138,6 +213,10 @@ static OFCharacterSet *TagEndOrNameStartOFCharacterSet;
     entityNameDictionary = [self _invertEntitiesFromDictionary:basicStringEntityDictionary];
     extendedStringEntityDictionary = [[NSMutableDictionary alloc] initWithDictionary:basicStringEntityDictionary];
     [self _decodeEntriesFromCharacterDictionary:[entityDictionary objectForKey:@"extendedCharacter"] intoStringDictionary:extendedStringEntityDictionary];
+    [self _buildEntityTable];
+
+    for (UnicodeScalarValue character = 0; character < 256; character++)
+        characterReferenceStrings[character] = [self _stringForCharacterReference:character];
     
     if (decoderDefaultsLock == nil)
         decoderDefaultsLock = [[NSLock alloc] init];
@@ -367,6 +446,122 @@ static BOOL OWHTMLToSGMLObjectsDebug = NO;
     return immutableResult;
 }
 
++ (void)_buildEntityTable;
+{
+    NSArray *names = [extendedStringEntityDictionary allKeys];
+    NSUInteger nameCount = [names count];
+
+    NSUInteger tableSize = 1;
+    while (tableSize < 2 * nameCount)
+        tableSize <<= 1;
+    NSUInteger bucketCount = MAX(tableSize / 4, (NSUInteger)1);
+
+    NSUInteger characterCount = 0;
+    for (NSString *name in names)
+        characterCount += [name length];
+
+    entityTable = calloc(tableSize, sizeof(*entityTable));
+    entityTableMask = tableSize - 1;
+    entityBucketSeeds = calloc(bucketCount, sizeof(*entityBucketSeeds));
+    entityBucketMask = bucketCount - 1;
+    entityNameCharacters = malloc(MAX(characterCount, (NSUInteger)1) * sizeof(unichar));
+    entityMaximumNameLength = 0;
+
+    // Gather each bucket's names; buckets are then placed largest first, since those are the hardest to fit.
+    NSUInteger *nameOffsets = malloc(MAX(nameCount, (NSUInteger)1) * sizeof(NSUInteger));
+    NSMutableArray *buckets = [[NSMutableArray alloc] initWithCapacity:bucketCount];
+    for (NSUInteger bucketIndex = 0; bucketIndex < bucketCount; bucketIndex++)
+        [buckets addObject:[NSMutableIndexSet indexSet]];
+
+    NSUInteger characterOffset = 0;
+    for (NSUInteger nameIndex = 0; nameIndex < nameCount; nameIndex++) {
+        NSString *name = [names objectAtIndex:nameIndex];
+        NSUInteger nameLength = [name length];
+        OBASSERT(nameLength > 0);
+        [name getCharacters:entityNameCharacters + characterOffset range:NSMakeRange(0, nameLength)];
+        nameOffsets[nameIndex] = characterOffset;
+        characterOffset += nameLength;
+        entityMaximumNameLength = MAX(entityMaximumNameLength, nameLength);
+
+        [[buckets objectAtIndex:_entityHash(0, entityNameCharacters + nameOffsets[nameIndex], nameLength) & entityBucketMask] addIndex:nameIndex];
+    }
+
+    NSMutableArray *bucketIndexes = [[NSMutableArray alloc] initWithCapacity:bucketCount];
+    for (NSUInteger bucketIndex = 0; bucketIndex < bucketCount; bucketIndex++)
+        [bucketIndexes addObject:[NSNumber numberWithUnsignedInteger:bucketIndex]];
+    [bucketIndexes sortUsingComparator:^NSComparisonResult(NSNumber *bucketNumber1, NSNumber *bucketNumber2) {
+        NSUInteger count1 = [[buckets objectAtIndex:[bucketNumber1 unsignedIntegerValue]] count];
+        NSUInteger count2 = [[buckets objectAtIndex:[bucketNumber2 unsignedIntegerValue]] count];
+        if (count1 != count2)
+            return count1 > count2 ? NSOrderedAscending : NSOrderedDescending;
+        return [bucketNumber1 compare:bucketNumber2];
+    }];
+
+    NSUInteger *slots = malloc(MAX(nameCount, (NSUInteger)1) * sizeof(NSUInteger));
+    for (NSNumber *bucketNumber in bucketIndexes) {
+        NSUInteger bucketIndex = [bucketNumber unsignedIntegerValue];
+        NSIndexSet *bucket = [buckets objectAtIndex:bucketIndex];
+        if ([bucket count] == 0)
+            break;
+
+        for (uint32_t seed = 1; ; seed++) {
+            __block BOOL fits = YES;
+            __block NSUInteger slotCount = 0;
+            [bucket enumerateIndexesUsingBlock:^(NSUInteger nameIndex, BOOL *stop) {
+                NSUInteger slot = _entityHash(seed, entityNameCharacters + nameOffsets[nameIndex], [[names objectAtIndex:nameIndex] length]) & entityTableMask;
+                BOOL taken = entityTable[slot].nameLength != 0;
+                for (NSUInteger slotIndex = 0; !taken && slotIndex < slotCount; slotIndex++)
+                    taken = (slots[slotIndex] == slot);
+                if (taken) {
+                    fits = NO;
+                    *stop = YES;
+                } else
+                    slots[slotCount++] = slot;
+            }];
+            if (!fits)
+                continue;
+
+            entityBucketSeeds[bucketIndex] = seed;
+            __block NSUInteger slotIndex = 0;
+            [bucket enumerateIndexesUsingBlock:^(NSUInteger nameIndex, BOOL *stop) {
+                NSString *name = [names objectAtIndex:nameIndex];
+                OWHTMLEntity *entity = &entityTable[slots[slotIndex++]];
+                entity->nameOffset = nameOffsets[nameIndex];
+                entity->nameLength = [name length];
+                entity->basicValue = [basicStringEntityDictionary objectForKey:name];
+                entity->extendedValue = [extendedStringEntityDictionary objectForKey:name];
+            }];
+            break;
+        }
+    }
+    free(slots);
+    free(nameOffsets);
+
+#ifdef OMNI_ASSERTIONS_ON
+    for (NSString *name in names) {
+        unichar characters[[name length]];
+        [name getCharacters:characters range:NSMakeRange(0, [name length])];
+        const OWHTMLEntity *entity = _lookupEntity(characters, [name length]);
+        OBASSERT(entity != NULL && entity->extendedValue == [extendedStringEntityDictionary objectForKey:name]);
+    }
+#endif
+}
+
++ (NSString *)_stringForCharacterReference:(UnicodeScalarValue)character;
+{
+    // WJS: 5/19/98 Even though the upper control characters aren't mapped in ISO Latin-1, they work in Netscape and Windows, so we check for that range explicitly and interpret them as WindowsCP1252 characters.
+    // WIML July2000: Change this to use the new functions in OmniFoundation
+    NSString *value = nil;
+    if (character > 0x7e && character < 0xa0) {
+        unsigned char byte = character & 0xff;
+        NSData *data = [[NSData alloc] initWithBytes:&byte length:1];
+        value = [NSString stringWithData:data encoding:NSWindowsCP1252StringEncoding];
+    }
+    if (value == nil)
+        value = [NSString stringWithCharacter:character];
+    return value;
+}
+
 - (void)_initStreams
 {
     OBPRECONDITION(!flags.haveAddedObjectStreamToPipeline);
@@ -628,6 +823,20 @@ static BOOL OWHTMLToSGMLObjectsDebug = NO;
     NSString *value;
     BOOL stillLooking = YES;
 
+    // Most values have no entities or line breaks in them and fit in the current buffer; those can be made in one go.
+    if (scannerHasData(scanner)) {
+        unichar *valueStart = scanner->scanLocation, *valueEnd = valueStart;
+        while (valueEnd < scanner->scanEnd && !OFCharacterSetHasMember(delimiterOFCharacterSet, *valueEnd))
+            valueEnd++;
+        if (valueEnd < scanner->scanEnd) {
+            unichar delimiter = *valueEnd;
+            if (delimiter != '&' && (newlinesAreDelimiters || (delimiter != '\r' && delimiter != '\n'))) {
+                scanner->scanLocation = valueEnd;
+                return [NSMutableString stringWithCharacters:valueStart length:valueEnd - valueStart];
+            }
+        }
+    }
+
     mergedValue = [NSMutableString string];
 
     while (stillLooking) {
@@ -826,16 +1035,11 @@ static BOOL OWHTMLToSGMLObjectsDebug = NO;
         character = [self _readHexNumber];
     }
 
-    // WJS: 5/19/98 Even though the upper control characters aren't mapped in ISO Latin-1, they work in Netscape and Windows, so we check for that range explicitly and interpret them as WindowsCP1252 characters.
-    // WIML July2000: Change this to use the new functions in OmniFoundation
-    NSString *value = nil;
-    if (character > 0x7e && character < 0xa0) {
-        unsigned char byte = character & 0xff;
-        NSData *data = [[NSData alloc] initWithBytes:&byte length:1];
-        value = [NSString stringWithData:data encoding:NSWindowsCP1252StringEncoding];
-    }
-    if (value == nil)
-        value = [NSString stringWithCharacter:character];
+    NSString *value;
+    if (character < 256)
+        value = characterReferenceStrings[character];
+    else
+        value = [[self class] _stringForCharacterReference:character];
 
     character = scannerPeekCharacter(scanner);
     if (character == ';' || (!flags.netscapeCompatibleNewlineAfterEntity && character == '\n'))
@@ -846,6 +1050,15 @@ static BOOL OWHTMLToSGMLObjectsDebug = NO;
 
 - (id <OWSGMLToken>)_readEntityReference;
 {
+    // Fast path: the name and the character after it are both in the scanner's current buffer, so we can look it up in place.
+    if (scannerHasData(scanner)) {
+        unichar *nameStart = scanner->scanLocation, *nameEnd = nameStart;
+        while (nameEnd < scanner->scanEnd && !OFCharacterSetHasMember(InvertedNameOFCharacterSet, *nameEnd))
+            nameEnd++;
+        if (nameEnd < scanner->scanEnd)
+            return [self _readEntityReferenceFromCharacters:nameStart length:nameEnd - nameStart];
+    }
+
     NSString *name = [scanner readFullTokenWithDelimiterOFCharacterSet:InvertedNameOFCharacterSet forceLowercase:NO];
     NSUInteger nameLength = name ? [name length] : 0;
     if (nameLength == 0)
@@ -877,6 +1090,39 @@ static BOOL OWHTMLToSGMLObjectsDebug = NO;
     }
 }
 
+- (id <OWSGMLToken>)_readEntityReferenceFromCharacters:(unichar *)name length:(NSUInteger)nameLength;
+{
+    // This mirrors the rest of -_readEntityReference, above.
+    if (nameLength == 0)
+        return @"&";
+
+    scanner->scanLocation = name + nameLength;
+    unichar terminatingCharacter = *scanner->scanLocation;
+    const OWHTMLEntity *entity = _lookupEntity(name, nameLength);
+    NSString *value = nil;
+    if (entity != NULL)
+        value = (terminatingCharacter == ';') ? entity->extendedValue : entity->basicValue;
+    if (value != nil) {
+        if (terminatingCharacter == ';' || (terminatingCharacter == '\n' && !flags.netscapeCompatibleNewlineAfterEntity))
+            scannerSkipPeekedCharacter(scanner);
+        return value;
+    } else {
+        if (flags.netscapeCompatibleNonterminatedEntities) {
+            for (NSUInteger tryLength = nameLength - 1; tryLength > 0; tryLength--) {
+                entity = _lookupEntity(name, tryLength);
+                if (entity != NULL && entity->basicValue != nil) {
+                    scanner->scanLocation = name + tryLength;
+                    return entity->basicValue;
+                }
+            }
+        }
+        NSMutableString *unknownEntity = [[NSMutableString alloc] initWithCapacity:nameLength + 1];
+        [unknownEntity appendString:@"&"];
+        CFStringAppendCharacters((CFMutableStringRef)unknownEntity, name, nameLength);
+        return unknownEntity;
+    }
+}
+
 - (unsigned int)_readNumber;
 {
     return [[scanner readFullTokenWithDelimiterOFCharacterSet:InvertedDigitOFCharacterSet forceLowercase:NO] intValue];
@@ -966,11 +1212,7 @@ static BOOL OWHTMLToSGMLObjectsDebug = NO;
         return nil;
 
     unichar *startLocation = scanLocation;
-    while (scanLocation < scanEnd) {
-        if (*scanLocation == '<' || *scanLocation == '&')
-            break;
-        scanLocation++;
-    }
+    scanLocation = (unichar *)_scanToMarkupCharacter(scanLocation, scanEnd);
 
     return [NSString stringWithCharacters:startLocation length:scanLocation - startLocation];
 }
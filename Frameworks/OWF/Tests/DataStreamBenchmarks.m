@@ -0,0 +1,104 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OWF/OWDataStream.h>
+#import <OWF/OWDataStreamCursor.h>
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#import <OmniBase/rcsid.h>
+
+RCS_ID("$Id$");
+
+// Times random and sequential reads from a large, many-block data stream. Results are logged rather than asserted since they depend on the machine.
+
+@interface DataStreamBenchmarks : XCTestCase
+@end
+
+@implementation DataStreamBenchmarks
+
+static const NSUInteger DataStreamBenchmarkLength = 256 * 1024 * 1024;
+static const NSUInteger DataStreamBenchmarkChunkLength = 16 * 1024;
+static const NSUInteger DataStreamBenchmarkProbeCount = 200000;
+
+static OWDataStream *_createFilledDataStream(void)
+{
+    OWDataStream *dataStream = [[OWDataStream alloc] init];
+    NSUInteger written = 0;
+    while (written < DataStreamBenchmarkLength) {
+        void *buffer;
+        NSUInteger count = MIN([dataStream appendToUnderlyingBuffer:&buffer], DataStreamBenchmarkChunkLength);
+        memset(buffer, (int)(written / DataStreamBenchmarkChunkLength), count);
+        [dataStream wroteBytesToUnderlyingBuffer:count];
+        written += count;
+    }
+    [dataStream dataEnd];
+    return dataStream;
+}
+
+static void _logReadTiming(NSString *pattern, NSUInteger operationCount, CFAbsoluteTime elapsed)
+{
+    NSLog(@"%@: %lu reads in %.3fs (%.0f ns/read)", pattern, operationCount, elapsed, operationCount ? elapsed * 1e9 / operationCount : 0.0);
+}
+
+- (void)testRandomDataWithRange;
+{
+    OWDataStream *dataStream = _createFilledDataStream();
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+    srandom(1);
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger probe = 0; probe < DataStreamBenchmarkProbeCount; probe++) {
+        NSUInteger location = random() % (DataStreamBenchmarkLength - 64);
+        [dataStream dataWithRange:NSMakeRange(location, 64)];
+        if (probe % 1000 == 0) {
+            [pool release];
+            pool = [[NSAutoreleasePool alloc] init];
+        }
+    }
+    _logReadTiming(@"random dataWithRange", DataStreamBenchmarkProbeCount, CFAbsoluteTimeGetCurrent() - start);
+
+    [pool release];
+    [dataStream release];
+}
+
+- (void)testRandomCursorSeek;
+{
+    OWDataStream *dataStream = _createFilledDataStream();
+    OWDataStreamCursor *cursor = [dataStream createCursor];
+    OFByte bytes[64];
+
+    srandom(1);
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger probe = 0; probe < DataStreamBenchmarkProbeCount; probe++) {
+        NSUInteger location = random() % (DataStreamBenchmarkLength - sizeof(bytes));
+        [cursor seekToOffset:location fromPosition:OWCursorSeekFromStart];
+        [cursor readBytes:sizeof(bytes) intoBuffer:bytes];
+    }
+    _logReadTiming(@"random cursor seek+read", DataStreamBenchmarkProbeCount, CFAbsoluteTimeGetCurrent() - start);
+
+    [cursor release];
+    [dataStream release];
+}
+
+- (void)testSequentialCursorRead;
+{
+    OWDataStream *dataStream = _createFilledDataStream();
+    OWDataStreamCursor *cursor = [dataStream createCursor];
+    OFByte bytes[256];
+    NSUInteger readCount = DataStreamBenchmarkLength / sizeof(bytes);
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger readIndex = 0; readIndex < readCount; readIndex++)
+        [cursor readBytes:sizeof(bytes) intoBuffer:bytes];
+    _logReadTiming(@"sequential cursor read", readCount, CFAbsoluteTimeGetCurrent() - start);
+
+    [cursor release];
+    [dataStream release];
+}
+
+@end
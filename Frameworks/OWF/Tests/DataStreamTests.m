@@ -286,6 +286,46 @@ static NSData *someData;
     dataStream = nil;
 }
 
+- (void)testRandomAccessAcrossBlocks
+{
+    NSUInteger length = [someData length];
+    const OFByte *expected = [someData bytes];
+
+    // Write through the underlying buffer a page at a time so the stream ends up with many blocks.
+    dataStream = [[OWDataStream alloc] init];
+    NSUInteger writePos = 0;
+    while (writePos < length) {
+        void *buffer;
+        NSUInteger count = MIN([dataStream appendToUnderlyingBuffer:&buffer], MIN(length - writePos, (NSUInteger)4096));
+        memcpy(buffer, expected + writePos, count);
+        [dataStream wroteBytesToUnderlyingBuffer:count];
+        writePos += count;
+    }
+    [dataStream dataEnd];
+
+    srandom(1);
+    for (unsigned int probe = 0; probe < 2000; probe++) {
+        NSUInteger location = random() % length;
+        NSUInteger rangeLength = MIN((NSUInteger)(random() % 10000), length - location);
+        NSData *data = [dataStream dataWithRange:NSMakeRange(location, rangeLength)];
+        XCTAssertNotNil(data);
+        XCTAssertTrue(memcmp([data bytes], expected + location, rangeLength) == 0, @"Mismatch at %lu+%lu", location, rangeLength);
+    }
+    XCTAssertNil([dataStream dataWithRange:NSMakeRange(length - 1, 2)]);
+
+    // A cursor seeking back and forth should see the same bytes as a fresh lookup.
+    OWDataStreamCursor *cursor = [dataStream createCursor];
+    for (unsigned int probe = 0; probe < 2000; probe++) {
+        NSUInteger location = (probe % 2) ? random() % length : MIN(length - 1, [cursor currentOffset]);
+        [cursor seekToOffset:location fromPosition:OWCursorSeekFromStart];
+        XCTAssertEqual([cursor readByte], expected[location]);
+    }
+    [cursor release];
+
+    [dataStream release];
+    dataStream = nil;
+}
+
 @end
 
 
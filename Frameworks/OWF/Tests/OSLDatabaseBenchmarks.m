@@ -0,0 +1,185 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniSQLite/OSLDatabaseController.h>
+#import <OmniSQLite/OSLPreparedStatement.h>
+
+#import <Foundation/Foundation.h>
+#import <OmniBase/OmniBase.h>
+#import <XCTest/XCTest.h>
+
+RCS_ID("$Id$");
+
+// Mixed read/write throughput for the SQLite index used by the disk cache: one writer inserting rows in small transactions while several readers do point lookups. Results are logged rather than asserted since they depend on the machine.
+
+@interface OSLDatabaseBenchmarks : XCTestCase
+{
+    NSString *databasePath;
+}
+@end
+
+@implementation OSLDatabaseBenchmarks
+
+static const NSUInteger OSLBenchmarkSeedRowCount = 10000;
+static const NSUInteger OSLBenchmarkWriteCount = 5000;
+static const NSUInteger OSLBenchmarkWriteBatchSize = 50;
+static const NSUInteger OSLBenchmarkReaderCount = 4;
+static const NSUInteger OSLBenchmarkReadsPerReader = 20000;
+
+- (void)setUp;
+{
+    [super setUp];
+    databasePath = [[NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"OSLDatabaseBenchmarks-%@.sqlite", [[NSProcessInfo processInfo] globallyUniqueString]]] retain];
+}
+
+- (void)tearDown;
+{
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    for (NSString *suffix in [NSArray arrayWithObjects:@"", @"-wal", @"-shm", @"-journal", nil])
+        [fileManager removeItemAtPath:[databasePath stringByAppendingString:suffix] error:NULL];
+    [databasePath release];
+    databasePath = nil;
+    [super tearDown];
+}
+
+- (OSLDatabaseController *)_seededDatabaseWithReadConnectionLimit:(NSUInteger)readConnectionLimit;
+{
+    NSError *error = nil;
+    OSLDatabaseController *database = [[[OSLDatabaseController alloc] initWithDatabasePath:databasePath readConnectionLimit:readConnectionLimit error:&error] autorelease];
+    XCTAssertNotNil(database, @"%@", error);
+    database.autoRetry = YES;
+
+    XCTAssertTrue([database executeSQL:@"create table if not exists Content (content_id integer primary key, valuehash integer, size integer, value blob);\n" withCallback:NULL context:NULL error:&error]);
+    XCTAssertTrue([database executeSQL:@"delete from Content;\n" withCallback:NULL context:NULL error:&error]);
+
+    NSData *value = [NSMutableData dataWithLength:256];
+    [database beginTransaction];
+    for (NSUInteger rowIndex = 0; rowIndex < OSLBenchmarkSeedRowCount; rowIndex++) {
+        OSLPreparedStatement *insert = [database cachedStatement:@"insert into Content values (?, ?, ?, ?);" error:&error];
+        [insert bindLongLongInt:rowIndex + 1];
+        [insert bindInt:(int)(rowIndex * 2654435761u)];
+        [insert bindInt:(int)[value length]];
+        [insert bindBlob:value];
+        [insert stepRow];
+    }
+    [database commitTransaction];
+
+    return database;
+}
+
+static void _lookUpRows(OSLDatabaseController *connection, NSUInteger readCount, unsigned int seed)
+{
+    for (NSUInteger readIndex = 0; readIndex < readCount; readIndex++) {
+        NSError *error = nil;
+        OSLPreparedStatement *select = [connection cachedStatement:@"select size, valuehash from Content where content_id = ?;" error:&error];
+        [select bindLongLongInt:(rand_r(&seed) % OSLBenchmarkSeedRowCount) + 1];
+        if ([select stepRow])
+            (void)[select intAtColumn:0];
+        [select reset];
+    }
+}
+
+- (void)_benchmarkMixedWorkloadWithReadConnectionLimit:(NSUInteger)readConnectionLimit;
+{
+    OSLDatabaseController *database = [self _seededDatabaseWithReadConnectionLimit:readConnectionLimit];
+
+    // Without a read pool every reader has to share the writer's connection, so serialize on a lock the way the disk cache does.
+    NSLock *sharedConnectionLock = [[[NSLock alloc] init] autorelease];
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+
+    dispatch_group_async(group, queue, ^{
+        NSData *value = [NSMutableData dataWithLength:256];
+        for (NSUInteger writeIndex = 0; writeIndex < OSLBenchmarkWriteCount; writeIndex += OSLBenchmarkWriteBatchSize) {
+            @autoreleasepool {
+                [sharedConnectionLock lock];
+                [database beginTransaction];
+                for (NSUInteger batchIndex = 0; batchIndex < OSLBenchmarkWriteBatchSize; batchIndex++) {
+                    OSLPreparedStatement *insert = [database cachedStatement:@"insert into Content values (?, ?, ?, ?);" error:NULL];
+                    [insert bindNull];
+                    [insert bindInt:(int)(writeIndex + batchIndex)];
+                    [insert bindInt:(int)[value length]];
+                    [insert bindBlob:value];
+                    [insert stepRow];
+                }
+                [database commitTransaction];
+                [sharedConnectionLock unlock];
+            }
+        }
+    });
+
+    for (NSUInteger readerIndex = 0; readerIndex < OSLBenchmarkReaderCount; readerIndex++) {
+        dispatch_group_async(group, queue, ^{
+            @autoreleasepool {
+                if (readConnectionLimit == 0) {
+                    // Take the lock per lookup so the writer can interleave, as it would in real use.
+                    for (NSUInteger readIndex = 0; readIndex < OSLBenchmarkReadsPerReader; readIndex++) {
+                        [sharedConnectionLock lock];
+                        _lookUpRows(database, 1, (unsigned int)(readerIndex * OSLBenchmarkReadsPerReader + readIndex));
+                        [sharedConnectionLock unlock];
+                    }
+                } else {
+                    NSError *error = nil;
+                    BOOL success = [database performReadWithBlock:^BOOL(OSLDatabaseController *connection, NSError **outError) {
+                        _lookUpRows(connection, OSLBenchmarkReadsPerReader, (unsigned int)readerIndex);
+                        return YES;
+                    } error:&error];
+                    XCTAssertTrue(success, @"%@", error);
+                }
+            }
+        });
+    }
+
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    dispatch_release(group);
+
+    CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+    NSUInteger operationCount = OSLBenchmarkWriteCount + OSLBenchmarkReaderCount * OSLBenchmarkReadsPerReader;
+    NSLog(@"%lu read connections: %lu writes + %lu reads in %.3fs (%.0f ops/s)", readConnectionLimit, OSLBenchmarkWriteCount, OSLBenchmarkReaderCount * OSLBenchmarkReadsPerReader, elapsed, operationCount / elapsed);
+}
+
+- (void)testMixedWorkloadOnSingleConnection;
+{
+    [self _benchmarkMixedWorkloadWithReadConnectionLimit:0];
+}
+
+- (void)testMixedWorkloadWithReadPool;
+{
+    [self _benchmarkMixedWorkloadWithReadConnectionLimit:OSLBenchmarkReaderCount];
+}
+
+- (void)testStatementCache;
+{
+    OSLDatabaseController *database = [self _seededDatabaseWithReadConnectionLimit:0];
+    NSString *sql = @"select size, valuehash from Content where content_id = ?;";
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger readIndex = 0; readIndex < OSLBenchmarkReadsPerReader; readIndex++) {
+        @autoreleasepool {
+            OSLPreparedStatement *select = [database prepareStatement:sql error:NULL];
+            [select bindLongLongInt:(readIndex % OSLBenchmarkSeedRowCount) + 1];
+            [select step];
+        }
+    }
+    CFAbsoluteTime uncached = CFAbsoluteTimeGetCurrent() - start;
+
+    start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger readIndex = 0; readIndex < OSLBenchmarkReadsPerReader; readIndex++) {
+        OSLPreparedStatement *select = [database cachedStatement:sql error:NULL];
+        [select bindLongLongInt:(readIndex % OSLBenchmarkSeedRowCount) + 1];
+        if ([select stepRow])
+            (void)[select intAtColumn:0];
+        [select reset];
+    }
+    CFAbsoluteTime cached = CFAbsoluteTimeGetCurrent() - start;
+
+    NSLog(@"%lu lookups: %.3fs prepared each time with dictionary rows, %.3fs cached with C-typed rows", OSLBenchmarkReadsPerReader, uncached, cached);
+}
+
+@end
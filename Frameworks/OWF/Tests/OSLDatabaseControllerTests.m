@@ -0,0 +1,132 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniSQLite/OSLDatabaseController.h>
+#import <OmniSQLite/OSLPreparedStatement.h>
+
+#import <Foundation/Foundation.h>
+#import <OmniBase/OmniBase.h>
+#import <XCTest/XCTest.h>
+
+RCS_ID("$Id$");
+
+// Tests OSLDatabaseController's statement cache.
+
+@interface OSLDatabaseControllerTests : XCTestCase
+{
+    NSString *databasePath;
+    OSLDatabaseController *database;
+}
+@end
+
+@implementation OSLDatabaseControllerTests
+
+- (void)setUp;
+{
+    [super setUp];
+    databasePath = [[NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"OSLDatabaseControllerTests-%@.sqlite", [[NSProcessInfo processInfo] globallyUniqueString]]] retain];
+
+    NSError *error = nil;
+    database = [[OSLDatabaseController alloc] initWithDatabasePath:databasePath error:&error];
+    XCTAssertNotNil(database, @"%@", error);
+    XCTAssertTrue([database executeSQL:@"create table Content (content_id integer primary key, size integer);\n" withCallback:NULL context:NULL error:&error], @"%@", error);
+    XCTAssertTrue([database executeSQL:@"insert into Content values (1, 100);\n" withCallback:NULL context:NULL error:&error], @"%@", error);
+}
+
+- (void)tearDown;
+{
+    [database release];
+    database = nil;
+
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    for (NSString *suffix in [NSArray arrayWithObjects:@"", @"-wal", @"-shm", @"-journal", nil])
+        [fileManager removeItemAtPath:[databasePath stringByAppendingString:suffix] error:NULL];
+    [databasePath release];
+    databasePath = nil;
+    [super tearDown];
+}
+
+static NSString * const SelectSizeSQL = @"select size from Content where content_id = ?;";
+
+// Asks for more other statements than the cache holds, which evicts everything that was in it
+- (void)_evictCachedStatements;
+{
+    for (NSUInteger statementIndex = 0; statementIndex <= [database statementCacheCapacity]; statementIndex++) {
+        NSError *error = nil;
+        OSLPreparedStatement *statement = [database cachedStatement:[NSString stringWithFormat:@"select %lu;", statementIndex] error:&error];
+        XCTAssertNotNil(statement, @"%@", error);
+    }
+}
+
+- (void)_assertStatementSelectsSize:(OSLPreparedStatement *)statement;
+{
+    [statement bindLongLongInt:1];
+    XCTAssertTrue([statement stepRow]);
+    XCTAssertEqual([statement intAtColumn:0], 100);
+    XCTAssertFalse([statement stepRow]);
+}
+
+- (void)testCachedStatementIsReused;
+{
+    NSError *error = nil;
+    OSLPreparedStatement *statement = [database cachedStatement:SelectSizeSQL error:&error];
+    XCTAssertNotNil(statement, @"%@", error);
+    [self _assertStatementSelectsSize:statement];
+
+    // Reset, with its bindings cleared
+    XCTAssertEqual([database cachedStatement:SelectSizeSQL error:NULL], statement);
+    XCTAssertFalse([statement stepRow]);
+}
+
+- (void)testStatementOutlivesEvictionAfterBeingPrepared;
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+    NSError *error = nil;
+    OSLPreparedStatement *statement = [database cachedStatement:SelectSizeSQL error:&error];
+    XCTAssertNotNil(statement, @"%@", error);
+    [self _evictCachedStatements];
+    [self _assertStatementSelectsSize:statement];
+
+    [pool release];
+}
+
+- (void)testStatementOutlivesEvictionAfterComingFromTheCache;
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    XCTAssertNotNil([database cachedStatement:SelectSizeSQL error:NULL]);
+    [pool release];
+
+    // Now only the cache holds the statement, until it hands it out again
+    pool = [[NSAutoreleasePool alloc] init];
+    NSError *error = nil;
+    OSLPreparedStatement *statement = [database cachedStatement:SelectSizeSQL error:&error];
+    XCTAssertNotNil(statement, @"%@", error);
+    [self _evictCachedStatements];
+    [self _assertStatementSelectsSize:statement];
+
+    // It's gone from the cache, so asking again prepares a new one
+    XCTAssertNotEqual([database cachedStatement:SelectSizeSQL error:NULL], statement);
+
+    [pool release];
+}
+
+- (void)testBusyStatementIsNotHandedOutAgain;
+{
+    OSLPreparedStatement *outer = [database cachedStatement:SelectSizeSQL error:NULL];
+    [outer bindLongLongInt:1];
+    XCTAssertTrue([outer stepRow]);
+
+    OSLPreparedStatement *inner = [database cachedStatement:SelectSizeSQL error:NULL];
+    XCTAssertNotEqual(inner, outer);
+    [self _assertStatementSelectsSize:inner];
+
+    XCTAssertEqual([outer intAtColumn:0], 100);
+    XCTAssertFalse([outer stepRow]);
+}
+
+@end
@@ -149,5 +149,92 @@ static inline void testDomain(NSString *urlString)
     testRelativeURL(@"http:");
 }
 
+- (void)testComponents
+{
+    // Components are only made from the parsed string when first asked for, so check each accessor on a fresh URL.
+#define Components(urlString, scheme_, netLocation_, path_, params_, query_, fragment_) do { \
+        XCTAssertEqualObjects([[OWURL urlFromString:urlString] scheme], scheme_); \
+        XCTAssertEqualObjects([[OWURL urlFromString:urlString] netLocation], netLocation_); \
+        XCTAssertEqualObjects([[OWURL urlFromString:urlString] path], path_); \
+        XCTAssertEqualObjects([[OWURL urlFromString:urlString] params], params_); \
+        XCTAssertEqualObjects([[OWURL urlFromString:urlString] query], query_); \
+        XCTAssertEqualObjects([[OWURL urlFromString:urlString] fragment], fragment_); \
+    } while (0)
+
+    Components(@"http://www.omnigroup.com/a/b;p?q#f", @"http", @"www.omnigroup.com", @"a/b", @"p", @"q", @"f");
+    Components(@"HTTP://user:pw@www.omnigroup.com:8080/", @"http", @"user:pw@www.omnigroup.com:8080", nil, nil, nil, nil);
+    Components(@"  http://www.omnigroup.com?q", @"http", @"www.omnigroup.com", nil, nil, @"q", nil);
+    Components(@"http://h/p;?#", @"http", @"h", @"p", @"", @"", @"");
+    Components(@"file:///tmp/x", @"file", nil, @"tmp/x", nil, nil, nil);
+
+    OWURL *url = [OWURL urlFromString:@"mailto:someone@example.com#x"];
+    XCTAssertEqualObjects([url schemeSpecificPart], @"someone@example.com");
+    XCTAssertEqualObjects([url fragment], @"x");
+    XCTAssertNil([url netLocation]);
+
+    XCTAssertNil([OWURL urlFromString:@"no scheme"]);
+    XCTAssertNil([OWURL urlFromString:@"http//missing.colon"]);
+}
+
+- (void)testCompositeString
+{
+    // Strings already in canonical form are kept as the composite string; the rest are rebuilt from their components.
+#define Composite(urlString, result) XCTAssertEqualObjects([[OWURL urlFromString:urlString] compositeString], result)
+
+    Composite(@"http://www.omnigroup.com/a/b;p?q#f", @"http://www.omnigroup.com/a/b;p?q#f");
+    Composite(@"http://h/p;?#", @"http://h/p;?#");
+    Composite(@"HTTP://www.omnigroup.com/", @"http://www.omnigroup.com/");
+    Composite(@"http://www.omnigroup.com", @"http://www.omnigroup.com/");
+    Composite(@"http://www.omnigroup.com?q", @"http://www.omnigroup.com/?q");
+    Composite(@"http:///path", @"http:/path");
+    Composite(@"file:", @"file://");
+    Composite(@"http://www.omnigroup.com\\path", @"http://www.omnigroup.com/path");
+
+    OWURL *url = [OWURL urlFromString:@"http://www.omnigroup.com/a?q"];
+    OWURL *copy = [[url copy] autorelease];
+    XCTAssertEqualObjects([copy compositeString], [url compositeString]);
+    XCTAssertEqualObjects([copy path], @"a");
+    XCTAssertEqual([url hash], [[OWURL urlFromString:@"http://www.omnigroup.com/a?q"] hash]);
+}
+
+- (void)testSharedHostnames
+{
+    OWURL *url1 = [OWURL urlFromString:@"http://www.omnigroup.com/one"];
+    OWURL *url2 = [OWURL urlFromString:@"http://www.omnigroup.com/two"];
+    XCTAssertEqual([url1 netLocation], [url2 netLocation]);
+    XCTAssertEqual([url1 scheme], [[OWURL urlFromString:@"HTTP://www.omnigroup.com/"] scheme]);
+}
+
+- (void)testResolvedRelativeURLs
+{
+    // Relative paths without "." or ".." segments are appended to the base directory directly; the others go through the general resolution.
+    OWURL *baseURL = [OWURL urlFromString:@"http://a/b/c/d;p?q#f"];
+#define Relative(relative, result) XCTAssertEqualObjects([[baseURL urlFromRelativeString:relative] compositeString], result)
+
+    Relative(@"g", @"http://a/b/c/g");
+    Relative(@"g/h", @"http://a/b/c/g/h");
+    Relative(@"g;x?y#s", @"http://a/b/c/g;x?y#s");
+    Relative(@"/g", @"http://a/g");
+    Relative(@"//g", @"http://g/");
+    Relative(@"./g", @"http://a/b/c/g");
+    Relative(@"../g", @"http://a/b/g");
+    Relative(@"../../g", @"http://a/g");
+    Relative(@"g/../h", @"http://a/b/c/h");
+    Relative(@"g:h", @"g:h");
+    Relative(@"ftp://x/y", @"ftp://x/y");
+
+    OWURL *rootURL = [OWURL urlFromString:@"http://a"];
+    XCTAssertEqualObjects([[rootURL urlFromRelativeString:@"g"] compositeString], @"http://a/g");
+}
+
+- (void)testCleaning
+{
+    XCTAssertEqualObjects([OWURL cleanURLString:@"  <URL:http://a/b\n    c/d>  "], @"http://a/bc/d");
+    XCTAssertEqualObjects([OWURL cleanURLString:@"http://a/b \r\n\tc"], @"http://a/bc");
+    XCTAssertEqualObjects([OWURL cleanURLString:@"<http://a/b>"], @"http://a/b");
+    XCTAssertEqualObjects([[OWURL urlFromFilthyString:@"http://a/b\\\n   c/d"] compositeString], @"http://a/bc/d");
+    XCTAssertEqualObjects([[OWURL urlFromFilthyString:@"http://a/b\\c"] compositeString], @"http://a/b\\c");
+}
+
 @end
 
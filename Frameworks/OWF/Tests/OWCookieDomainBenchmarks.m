@@ -0,0 +1,148 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OWF/OWCookie.h>
+#import <OWF/OWCookieDomain.h>
+#import <OWF/OWURL.h>
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#import <OmniBase/rcsid.h>
+
+RCS_ID("$Id$");
+
+// Times cookie lookups, Set-Cookie parsing and domain creation against cookie jars of various sizes. Each jar is written to a Cookies.xml in a temporary OWLibraryDirectory and loaded the way it is at launch. Results are logged rather than asserted since they depend on the machine.
+
+@interface OWCookieDomain (OWCookieDomainBenchmarks)
++ (void)_loadCookies;
++ (OWCookie *)cookieFromHeaderValue:(NSString *)headerValue defaultDomain:(NSString *)defaultDomain defaultPath:(NSString *)defaultPath;
+@end
+
+@interface OWCookieDomainBenchmarks : XCTestCase
+@end
+
+@implementation OWCookieDomainBenchmarks
+
+static const NSUInteger OWCookieDomainBenchmarkLookupCount = 100000;
+static const NSUInteger OWCookieDomainBenchmarkParseCount = 100000;
+static const NSUInteger OWCookieDomainBenchmarkCreateCount = 10000;
+
+static NSString *_domainName(NSUInteger domainIndex)
+{
+    // A mix of dotted and exact domains under a few top-level domains, so the trie has both wide and deep nodes.
+    static NSString * const topLevelDomains[] = {@"com", @"org", @"net", @"co.uk", @"de"};
+    NSString *topLevelDomain = topLevelDomains[domainIndex % (sizeof(topLevelDomains) / sizeof(*topLevelDomains))];
+    if (domainIndex % 3 == 0)
+        return [NSString stringWithFormat:@"www.site%lu.%@", domainIndex, topLevelDomain];
+    return [NSString stringWithFormat:@".site%lu.%@", domainIndex, topLevelDomain];
+}
+
+static void _writeCookieJar(NSString *directory, NSUInteger domainCount)
+{
+    NSMutableString *xml = [NSMutableString stringWithString:@"<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n<OmniWebCookies>\n"];
+    NSTimeInterval expires = [NSDate timeIntervalSinceReferenceDate] + 365 * 24 * 60 * 60;
+    for (NSUInteger domainIndex = 0; domainIndex < domainCount; domainIndex++) {
+        [xml appendFormat:@"<domain name=\"%@\">\n", _domainName(domainIndex)];
+        [xml appendFormat:@"<cookie name=\"session\" path=\"/\" value=\"%lu\" expires=\"%.0f\" receivedBySite=\"site%lu\"/>\n", domainIndex, expires, domainIndex];
+        [xml appendFormat:@"<cookie name=\"pref\" path=\"/account\" value=\"dark\" expires=\"%.0f\" receivedBySite=\"site%lu\"/>\n", expires, domainIndex];
+        [xml appendString:@"</domain>\n"];
+    }
+    [xml appendString:@"</OmniWebCookies>\n"];
+    [[xml dataUsingEncoding:NSUTF8StringEncoding] writeToFile:[directory stringByAppendingPathComponent:@"Cookies.xml"] atomically:NO];
+}
+
+- (void)_benchmarkJarWithDomainCount:(NSUInteger)domainCount;
+{
+    NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+    id oldLibraryDirectory = [[defaults objectForKey:@"OWLibraryDirectory"] retain];
+    NSString *directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"OWCookieDomainBenchmarks-%d", getpid()]];
+    [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:NULL];
+    _writeCookieJar(directory, domainCount);
+    [defaults setObject:directory forKey:@"OWLibraryDirectory"];
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    [OWCookieDomain _loadCookies];
+    CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+    NSLog(@"%lu domains: loaded in %.3fs", domainCount, elapsed);
+
+    // Half the lookups hit a domain in the jar (through its dotted parent for the "www." ones) and half miss.
+    NSMutableArray *urls = [[NSMutableArray alloc] init];
+    for (NSUInteger urlIndex = 0; urlIndex < 1000; urlIndex++) {
+        NSUInteger domainIndex = (urlIndex * 7919) % domainCount;
+        NSString *hostname = [_domainName(domainIndex) stringByTrimmingCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"."]];
+        if (urlIndex % 2 != 0)
+            hostname = [@"missing." stringByAppendingString:[hostname stringByReplacingOccurrencesOfString:@"site" withString:@"other"]];
+        else if (domainIndex % 3 != 0)
+            hostname = [@"a.b." stringByAppendingString:hostname];
+        [urls addObject:[OWURL urlFromString:[NSString stringWithFormat:@"http://%@/account/settings", hostname]]];
+    }
+
+    NSUInteger cookieCount = 0;
+    start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger lookupIndex = 0; lookupIndex < OWCookieDomainBenchmarkLookupCount; lookupIndex++) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        cookieCount += [[OWCookieDomain cookiesForURL:[urls objectAtIndex:lookupIndex % [urls count]]] count];
+        [pool release];
+    }
+    elapsed = CFAbsoluteTimeGetCurrent() - start;
+    NSLog(@"%lu domains: %lu lookups found %lu cookies in %.3fs (%.0f ns/lookup)", domainCount, OWCookieDomainBenchmarkLookupCount, cookieCount, elapsed, elapsed * 1e9 / OWCookieDomainBenchmarkLookupCount);
+
+    start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger createIndex = 0; createIndex < OWCookieDomainBenchmarkCreateCount; createIndex++) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        [OWCookieDomain domainNamed:[NSString stringWithFormat:@".new%lu.example.com", createIndex]];
+        [pool release];
+    }
+    elapsed = CFAbsoluteTimeGetCurrent() - start;
+    NSLog(@"%lu domains: created %lu more in %.3fs (%.1f us/domain)", domainCount, OWCookieDomainBenchmarkCreateCount, elapsed, elapsed * 1e6 / OWCookieDomainBenchmarkCreateCount);
+
+    [urls release];
+    if (oldLibraryDirectory != nil)
+        [defaults setObject:oldLibraryDirectory forKey:@"OWLibraryDirectory"];
+    else
+        [defaults removeObjectForKey:@"OWLibraryDirectory"];
+    [oldLibraryDirectory release];
+    [[NSFileManager defaultManager] removeItemAtPath:directory error:NULL];
+}
+
+- (void)testLookupsIn1000DomainJar;
+{
+    [self _benchmarkJarWithDomainCount:1000];
+}
+
+- (void)testLookupsIn10000DomainJar;
+{
+    [self _benchmarkJarWithDomainCount:10000];
+}
+
+- (void)testLookupsIn100000DomainJar;
+{
+    [self _benchmarkJarWithDomainCount:100000];
+}
+
+- (void)testSetCookieParsing;
+{
+    NSArray *headerValues = @[
+        @"SID=31d4d96e407aad42; Path=/; Secure; HttpOnly",
+        @"lang=en-US; Expires=Wed, 09 Jun 2027 10:18:14 GMT; Domain=.example.com; Path=/",
+        @"prefs = theme%3Ddark%26size%3D12 ; path=/account ; domain=www.example.com",
+        @"tracking=; expires=Thu, 01 Jan 1970 00:00:00 GMT",
+    ];
+
+    NSUInteger cookieCount = 0;
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger parseIndex = 0; parseIndex < OWCookieDomainBenchmarkParseCount; parseIndex++) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        if ([OWCookieDomain cookieFromHeaderValue:[headerValues objectAtIndex:parseIndex % [headerValues count]] defaultDomain:@"www.example.com" defaultPath:@"/account"] != nil)
+            cookieCount++;
+        [pool release];
+    }
+    CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+    NSLog(@"Parsed %lu Set-Cookie values into %lu cookies in %.3fs (%.0f ns/header)", OWCookieDomainBenchmarkParseCount, cookieCount, elapsed, elapsed * 1e9 / OWCookieDomainBenchmarkParseCount);
+}
+
+@end
@@ -0,0 +1,248 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OWF/OWCookie.h>
+#import <OWF/OWCookieDomain.h>
+#import <OWF/OWURL.h>
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#import <OmniBase/rcsid.h>
+
+RCS_ID("$Id$");
+
+// Tests Set-Cookie parsing, and which domains' cookies a lookup finds. The lookups run against an empty jar loaded from a temporary OWLibraryDirectory, which each test then fills in.
+
+@interface OWCookieDomain (OWCookieDomainTests)
++ (void)_loadCookies;
++ (OWCookie *)cookieFromHeaderValue:(NSString *)headerValue defaultDomain:(NSString *)defaultDomain defaultPath:(NSString *)defaultPath;
+@end
+
+@interface OWCookieDomainTests : XCTestCase
+{
+    NSString *libraryDirectory;
+    id oldLibraryDirectory;
+}
+@end
+
+@implementation OWCookieDomainTests
+
+- (void)setUp;
+{
+    NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+    oldLibraryDirectory = [[defaults objectForKey:@"OWLibraryDirectory"] retain];
+    libraryDirectory = [[NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"OWCookieDomainTests-%d", getpid()]] retain];
+    [[NSFileManager defaultManager] createDirectoryAtPath:libraryDirectory withIntermediateDirectories:YES attributes:nil error:NULL];
+    [defaults setObject:libraryDirectory forKey:@"OWLibraryDirectory"];
+
+    [OWCookieDomain _loadCookies];
+}
+
+- (void)tearDown;
+{
+    NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+    if (oldLibraryDirectory != nil)
+        [defaults setObject:oldLibraryDirectory forKey:@"OWLibraryDirectory"];
+    else
+        [defaults removeObjectForKey:@"OWLibraryDirectory"];
+    [oldLibraryDirectory release];
+    oldLibraryDirectory = nil;
+
+    [[NSFileManager defaultManager] removeItemAtPath:libraryDirectory error:NULL];
+    [libraryDirectory release];
+    libraryDirectory = nil;
+}
+
+static OWCookie *_parse(NSString *headerValue)
+{
+    return [OWCookieDomain cookieFromHeaderValue:headerValue defaultDomain:@"www.example.com" defaultPath:@"/account"];
+}
+
+// Adds a cookie named after its domain
+static void _addCookieForDomain(NSString *domainName)
+{
+    OWCookie *cookie = [[OWCookie alloc] initWithDomain:domainName path:@"/" name:domainName value:@"1" expirationDate:nil secure:NO];
+    [[OWCookieDomain domainNamed:domainName] addCookie:cookie];
+    [cookie release];
+}
+
+static NSArray *_cookieNamesForURLString(NSString *urlString)
+{
+    NSArray *cookies = [OWCookieDomain cookiesForURL:[OWURL urlFromString:urlString]];
+    return [[cookies valueForKey:@"name"] sortedArrayUsingSelector:@selector(compare:)];
+}
+
+#pragma mark - Set-Cookie parsing
+
+- (void)testNameAndValue;
+{
+    OWCookie *cookie = _parse(@"SID=31d4d96e407aad42");
+    XCTAssertEqualObjects([cookie name], @"SID");
+    XCTAssertEqualObjects([cookie value], @"31d4d96e407aad42");
+    XCTAssertEqualObjects([cookie domain], @"www.example.com");
+    XCTAssertEqualObjects([cookie path], @"/account");
+    XCTAssertNil([cookie expirationDate]);
+    XCTAssertFalse([cookie secure]);
+
+    // Whitespace around the name and value isn't part of them
+    cookie = _parse(@"  prefs = theme%3Ddark ; path=/");
+    XCTAssertEqualObjects([cookie name], @"prefs");
+    XCTAssertEqualObjects([cookie value], @"theme%3Ddark");
+
+    cookie = _parse(@"empty=; Path=/");
+    XCTAssertEqualObjects([cookie name], @"empty");
+    XCTAssertEqualObjects([cookie value], @"");
+
+    XCTAssertNil(_parse(@"no value at all"));
+}
+
+- (void)testQuotedValuesAreKeptAsIs;
+{
+    OWCookie *cookie = _parse(@"quoted=\"two words\"; Path=/");
+    XCTAssertEqualObjects([cookie value], @"\"two words\"");
+    XCTAssertEqualObjects([cookie path], @"/");
+
+    // A semicolon ends the value even inside quotes, as it always has
+    cookie = _parse(@"quoted=\"a;b\"");
+    XCTAssertEqualObjects([cookie value], @"\"a");
+}
+
+- (void)testDomainAttribute;
+{
+    XCTAssertEqualObjects([_parse(@"a=1; Domain=.example.com") domain], @".example.com");
+    XCTAssertEqualObjects([_parse(@"a=1; domain=example.com") domain], @".example.com", @"A parent domain gets its leading dot");
+    XCTAssertEqualObjects([_parse(@"a=1; DOMAIN=www.example.com") domain], @"www.example.com", @"The host itself stays exact");
+
+    // Sites can't set cookies for other sites, or for a whole top-level domain
+    XCTAssertEqualObjects([_parse(@"a=1; Domain=.other.com") domain], @"www.example.com");
+    XCTAssertEqualObjects([_parse(@"a=1; Domain=.com") domain], @"www.example.com");
+    XCTAssertEqualObjects([_parse(@"a=1; Domain=badexample.com") domain], @"www.example.com");
+}
+
+- (void)testPathAttribute;
+{
+    XCTAssertEqualObjects([_parse(@"a=1; Path=/account/settings") path], @"/account/settings");
+    XCTAssertEqualObjects([_parse(@"a=1; path=") path], @"/", @"An empty path means the whole site");
+    XCTAssertEqualObjects([_parse(@"a=1; secure") path], @"/account");
+}
+
+- (void)testExpiresAttribute;
+{
+    OWCookie *cookie = _parse(@"lang=en-US; Expires=Wed, 09 Jun 2027 10:18:14 GMT; Path=/");
+    XCTAssertEqualWithAccuracy([[cookie expirationDate] timeIntervalSince1970], 1812536294.0, 0.5);
+    XCTAssertEqualObjects([cookie path], @"/");
+
+    cookie = _parse(@"tracking=; expires=Thu, 01 Jan 1970 00:00:00 GMT");
+    XCTAssertTrue([cookie isExpired]);
+
+    // A date that can't be read keeps the cookie for a year rather than for the session
+    cookie = _parse(@"a=1; expires=whenever");
+    XCTAssertGreaterThan([[cookie expirationDate] timeIntervalSinceNow], 360.0 * 24 * 60 * 60);
+}
+
+- (void)testSecureAttribute;
+{
+    XCTAssertTrue([_parse(@"SID=1; Path=/; Secure; HttpOnly") secure]);
+    XCTAssertTrue([_parse(@"SID=1;secure") secure]);
+    XCTAssertFalse([_parse(@"SID=1; HttpOnly") secure]);
+    XCTAssertFalse([_parse(@"SID=secure") secure]);
+}
+
+#pragma mark - Lookups
+
+- (void)testLeadingDotDomainAppliesToTheHostAndBelow;
+{
+    _addCookieForDomain(@".example.com");
+
+    XCTAssertEqualObjects(_cookieNamesForURLString(@"http://example.com/"), @[@".example.com"]);
+    XCTAssertEqualObjects(_cookieNamesForURLString(@"http://www.example.com/"), @[@".example.com"]);
+    XCTAssertEqualObjects(_cookieNamesForURLString(@"http://a.b.example.com/"), @[@".example.com"]);
+    XCTAssertEqualObjects(_cookieNamesForURLString(@"http://WWW.Example.COM/"), @[@".example.com"]);
+}
+
+- (void)testExactDomainOnlyAppliesToItsHost;
+{
+    _addCookieForDomain(@"www.example.com");
+
+    XCTAssertEqualObjects(_cookieNamesForURLString(@"http://www.example.com/"), @[@"www.example.com"]);
+    XCTAssertEqualObjects(_cookieNamesForURLString(@"http://a.www.example.com/"), @[]);
+    XCTAssertEqualObjects(_cookieNamesForURLString(@"http://example.com/"), @[]);
+}
+
+- (void)testParentAndHostDomainsCombine;
+{
+    _addCookieForDomain(@".example.com");
+    _addCookieForDomain(@".www.example.com");
+    _addCookieForDomain(@"www.example.com");
+
+    NSArray *expected = @[@".example.com", @".www.example.com", @"www.example.com"];
+    XCTAssertEqualObjects(_cookieNamesForURLString(@"http://www.example.com/"), expected);
+    XCTAssertEqualObjects(_cookieNamesForURLString(@"http://a.www.example.com/"), (@[@".example.com", @".www.example.com"]));
+}
+
+- (void)testNoMatchOnASuffixThatIsntADomain;
+{
+    _addCookieForDomain(@".example.com");
+    _addCookieForDomain(@"example.com");
+
+    XCTAssertEqualObjects(_cookieNamesForURLString(@"http://badexample.com/"), @[]);
+    XCTAssertEqualObjects(_cookieNamesForURLString(@"http://www.badexample.com/"), @[]);
+    XCTAssertEqualObjects(_cookieNamesForURLString(@"http://example.com.evil.test/"), @[]);
+}
+
+- (void)testTopLevelDomainsDontApply;
+{
+    _addCookieForDomain(@".com");
+    _addCookieForDomain(@".co.uk");
+
+    XCTAssertEqualObjects(_cookieNamesForURLString(@"http://www.example.com/"), @[]);
+    XCTAssertEqualObjects(_cookieNamesForURLString(@"http://www.example.co.uk/"), @[]);
+}
+
+- (void)testDeletedDomainsAreGone;
+{
+    _addCookieForDomain(@".example.com");
+    _addCookieForDomain(@"www.example.com");
+    _addCookieForDomain(@".a.b.example.org");
+
+    [OWCookieDomain deleteDomain:[OWCookieDomain domainNamed:@".example.com"]];
+    XCTAssertEqualObjects(_cookieNamesForURLString(@"http://example.com/"), @[]);
+    XCTAssertEqualObjects(_cookieNamesForURLString(@"http://www.example.com/"), @[@"www.example.com"], @"Removing a domain leaves the ones below it");
+
+    // Removing the only domain down a long branch prunes the branch, and removing the last domain leaves an empty jar rather than an unloaded one
+    [OWCookieDomain deleteDomain:[OWCookieDomain domainNamed:@".a.b.example.org"]];
+    XCTAssertEqualObjects(_cookieNamesForURLString(@"http://x.a.b.example.org/"), @[]);
+    [OWCookieDomain deleteDomain:[OWCookieDomain domainNamed:@"www.example.com"]];
+    XCTAssertEqualObjects(_cookieNamesForURLString(@"http://www.example.com/"), @[]);
+
+    // And a deleted domain can come back
+    _addCookieForDomain(@".example.com");
+    XCTAssertEqualObjects(_cookieNamesForURLString(@"http://www.example.com/"), @[@".example.com"]);
+}
+
+- (void)testManyDeletionsUnderOneNode;
+{
+    // Enough siblings under "com" that the node's recent changes get merged along the way, with deletions among them
+    static const NSUInteger domainCount = 200;
+    NSUInteger domainIndex;
+
+    for (domainIndex = 0; domainIndex < domainCount; domainIndex++)
+        _addCookieForDomain([NSString stringWithFormat:@".site%lu.com", domainIndex]);
+    for (domainIndex = 0; domainIndex < domainCount; domainIndex += 2)
+        [OWCookieDomain deleteDomain:[OWCookieDomain domainNamed:[NSString stringWithFormat:@".site%lu.com", domainIndex]]];
+
+    for (domainIndex = 0; domainIndex < domainCount; domainIndex++) {
+        NSString *domainName = [NSString stringWithFormat:@".site%lu.com", domainIndex];
+        NSArray *names = _cookieNamesForURLString([NSString stringWithFormat:@"http://www%@/", domainName]);
+        if (domainIndex % 2 == 0)
+            XCTAssertEqualObjects(names, @[], @"%@ was deleted", domainName);
+        else
+            XCTAssertEqualObjects(names, @[domainName]);
+    }
+}
+
+@end
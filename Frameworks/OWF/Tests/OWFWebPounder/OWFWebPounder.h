@@ -7,9 +7,14 @@
 
 
 #import <OmniFoundation/OFObject.h>
+#import <CoreFoundation/CFDate.h>
 #import <OWF/OWTargetProtocol.h>
 
 @interface OWFWebPounder : OFObject <OWTarget>
+{
+    CFAbsoluteTime startTime;
+    BOOL receivedAnchors;
+}
 
 + (void)logStatus;
 + (void)flushCache;
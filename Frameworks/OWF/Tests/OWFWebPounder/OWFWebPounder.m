@@ -14,6 +14,8 @@
 
 #import "OWFWebPounder.h"
 #import "OWAnchorsProcessor.h"
+#import "OWFWebPounderSite.h"
+#import "OWFWebPounderStatistics.h"
 
 RCS_ID("$Id$")
 
@@ -28,6 +30,9 @@ RCS_ID("$Id$")
 static unsigned int activeCount = 0;
 static unsigned int startedCount = 0;
 
+// Set when benchmarking a generated site: each fetch takes a slot, and gives it back when its pipeline ends.
+static dispatch_semaphore_t pipelineSlots = NULL;
+
 @interface OWFWebPounderObserver : OFObject
 {
     OWAddress *listenAddress;
@@ -39,16 +44,24 @@ static unsigned int startedCount = 0;
 
 @end
 
+@interface OWFWebPounder (Benchmark)
++ (void)benchmarkSite:(OWFWebPounderSite *)site;
+@end
+
+static void _usage(const char *toolName)
+{
+    fprintf(stderr, "usage: %s [ url | delay ] ...\n", toolName);
+    fprintf(stderr, "       %s [-pages n] [-pageSize bytes] [-links n] [-chunked YES] [-slowEvery n] [-slowDelay seconds]\n", toolName);
+    fprintf(stderr, "           [-concurrency n] [-passes n] [-flushCacheBetweenPasses YES]\n");
+    fprintf(stderr, "With no URLs, fetches every page of a generated site served from the loopback interface, and reports throughput, latency, memory and processor CPU time for each pass over it.\n");
+    exit(1);
+}
+
 int main(int argc, char *argv[])
 {
     NSMutableArray *addressStrings;
     int argumentIndex;
     
-    if (argc < 2) {
-        fprintf(stderr, "usage: %s [ url | delay ] ...\n", argv[0]);
-        exit(1);
-    }
-
 #ifdef OMNIOBJECTMETER_ENABLED
     extern void OOMInit(void);
 
@@ -62,10 +75,17 @@ int main(int argc, char *argv[])
         [[OFController sharedController] startedRunning];
         [[OFScheduler dedicatedThreadScheduler] setInvokesEventsInMainThread:NO];
 
+        // Options are "-name value" pairs, which NSUserDefaults reads for us; anything else is a URL or a delay.
         addressStrings = [NSMutableArray array];
-        for (argumentIndex = 1; argumentIndex < argc; argumentIndex++)
-            [addressStrings addObject:[NSString stringWithCString:argv[argumentIndex]]];
-        
+        for (argumentIndex = 1; argumentIndex < argc; argumentIndex++) {
+            if (argv[argumentIndex][0] == '-') {
+                if (argumentIndex + 1 == argc)
+                    _usage(argv[0]);
+                argumentIndex++;
+            } else
+                [addressStrings addObject:[NSString stringWithUTF8String:argv[argumentIndex]]];
+        }
+
 /*
         messageQueue = [[OFMessageQueue alloc] init];
         [messageQueue startBackgroundProcessors:4];
@@ -77,9 +97,32 @@ int main(int argc, char *argv[])
         [OWHTTPSession setDebug:YES];
 */
 
-        [NSThread detachNewThreadSelector:@selector(logStatus) toTarget:[OWFWebPounder class] withObject:nil];
-        [NSThread detachNewThreadSelector:@selector(createFetchersForAddressStrings:) toTarget:[OWFWebPounder class] withObject:addressStrings];
-//        [NSThread detachNewThreadSelector:@selector(createObserversForAddressStrings:) toTarget:[OWFWebPounderObserver class] withObject:addressStrings];
+        if ([addressStrings count] == 0) {
+            NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+            OWFWebPounderSiteOptions options = [OWFWebPounderSite defaultOptions];
+            if ([defaults objectForKey:@"pages"] != nil)
+                options.pageCount = MAX([defaults integerForKey:@"pages"], 1);
+            if ([defaults objectForKey:@"pageSize"] != nil)
+                options.pageSize = [defaults integerForKey:@"pageSize"];
+            if ([defaults objectForKey:@"links"] != nil)
+                options.linksPerPage = [defaults integerForKey:@"links"];
+            options.chunked = [defaults boolForKey:@"chunked"];
+            if ([defaults objectForKey:@"slowEvery"] != nil)
+                options.slowPageInterval = [defaults integerForKey:@"slowEvery"];
+            if ([defaults objectForKey:@"slowDelay"] != nil)
+                options.slowPageDelay = [defaults doubleForKey:@"slowDelay"];
+
+            OWFWebPounderSite *site = [[OWFWebPounderSite alloc] initWithOptions:options];
+            if (site == nil)
+                exit(1);
+            [OWFWebPounderStatistics installProcessorTiming];
+            [NSThread detachNewThreadSelector:@selector(benchmarkSite:) toTarget:[OWFWebPounder class] withObject:site];
+            [site release];
+        } else {
+            [NSThread detachNewThreadSelector:@selector(logStatus) toTarget:[OWFWebPounder class] withObject:nil];
+            [NSThread detachNewThreadSelector:@selector(createFetchersForAddressStrings:) toTarget:[OWFWebPounder class] withObject:addressStrings];
+//            [NSThread detachNewThreadSelector:@selector(createObserversForAddressStrings:) toTarget:[OWFWebPounderObserver class] withObject:addressStrings];
+        }
     } OMNI_POOL_END;
     
     [[NSRunLoop currentRunLoop] runUntilDate:[NSDate distantFuture]];
@@ -160,24 +203,23 @@ static NSMutableDictionary *anchorStringsCache;
         OMNI_POOL_START {
             [[NSDate dateWithTimeIntervalSinceNow:1.0] sleepUntilDate];
 
-            unsigned int startedDelta, checkedDelta;
+            unsigned int started, checked;
 
             os_unfair_lock_lock(&statusLock);
             started = processorsStarted;
             checked = processorsChecked;
             os_unfair_lock_unlock(&statusLock);
 
-            OBASSERT(processorsStarted >= previousProcessorsStarted);
-            OBASSERT(processorsChecked >= previousProcessorsChecked);
+            OBASSERT(started >= previousProcessorsStarted);
+            OBASSERT(checked >= previousProcessorsChecked);
             printf("Processors started = %d (+%d), checked = %d (+%d)\n", started, started - previousProcessorsStarted, checked, checked - previousProcessorsChecked);
-            previousProcessorsStarted = processorsStarted;
-            previousProcessorsChecked = processorsChecked;
+            if (started == previousProcessorsStarted)
+                continueReportingStatus = NO;
+            previousProcessorsStarted = started;
+            previousProcessorsChecked = checked;
 
             [self flushCache];
 
-            if (processorsStarted == previousProcessorsStarted)
-                continueReportingStatus = NO;
-
         } OMNI_POOL_END;
     } while (continueReportingStatus);
 
@@ -215,6 +257,7 @@ static NSMutableDictionary *anchorStringsCache;
     if (!(self = [super init]))
         return nil;
 
+    startTime = CFAbsoluteTimeGetCurrent();
     [OWWebPipeline startPipelineWithAddress:[OWAddress addressForDirtyString:addressString] target:self];
 
     return self;
@@ -242,7 +285,9 @@ static NSMutableDictionary *anchorStringsCache;
         [allAnchorStrings addObject:[anchorAddress addressString]];
 
     [isa checkAnchorStrings:allAnchorStrings fromSource:[sourceAddress addressString]];
-    
+    [allAnchorStrings release];
+    receivedAnchors = YES;
+
     return OWTargetContentDisposition_ContentAccepted;
 }
 
@@ -265,13 +310,64 @@ static NSMutableDictionary *anchorStringsCache;
 #ifdef DEBUG_kc0
     NSLog(@"-[%@ %s]", OBShortObjectDescription(self), _cmd);
 #endif
+    [OWFWebPounderStatistics recordPageLatency:CFAbsoluteTimeGetCurrent() - startTime succeeded:receivedAnchors];
+    [OWFWebPounderStatistics sampleMemory];
     [OWPipeline invalidatePipelinesForTarget:self];
-    [[NSDate dateWithTimeIntervalSinceNow:0.01] sleepUntilDate];
+    if (pipelineSlots != NULL)
+        dispatch_semaphore_signal(pipelineSlots);
+    else
+        [[NSDate dateWithTimeIntervalSinceNow:0.01] sleepUntilDate];
     [self release];
 }
 
 @end
 
+@implementation OWFWebPounder (Benchmark)
+
++ (void)benchmarkSite:(OWFWebPounderSite *)site;
+{
+    NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+    NSInteger concurrency = [defaults objectForKey:@"concurrency"] != nil ? MAX([defaults integerForKey:@"concurrency"], 1) : ACTIVE_COUNT;
+    NSInteger passCount = [defaults objectForKey:@"passes"] != nil ? MAX([defaults integerForKey:@"passes"], 1) : 2;
+    BOOL flushCacheBetweenPasses = [defaults boolForKey:@"flushCacheBetweenPasses"];
+    NSUInteger pageCount = [site pageCount];
+
+    [site retain];
+    printf("Serving %s on port %u; %ld pipelines at a time\n", [[site optionsDescription] UTF8String], [site port], concurrency);
+    pipelineSlots = dispatch_semaphore_create(concurrency);
+
+    for (NSInteger passIndex = 0; passIndex < passCount; passIndex++) {
+        // The first pass starts from an empty cache; later ones reuse what it cached unless asked not to, which is what measures the cost of a cache hit.
+        BOOL coldCache = passIndex == 0 || flushCacheBetweenPasses;
+        if (coldCache)
+            [self flushCache];
+        [OWFWebPounderStatistics beginPass];
+
+        for (NSUInteger pageIndex = 0; pageIndex < pageCount; pageIndex++) {
+            OMNI_POOL_START {
+                dispatch_semaphore_wait(pipelineSlots, DISPATCH_TIME_FOREVER);
+                [self fetchAddressString:[site urlStringForPage:pageIndex]];
+            } OMNI_POOL_END;
+        }
+
+        // Wait for the stragglers by taking every slot back, then return them for the next pass.
+        for (NSInteger slotIndex = 0; slotIndex < concurrency; slotIndex++)
+            dispatch_semaphore_wait(pipelineSlots, DISPATCH_TIME_FOREVER);
+        for (NSInteger slotIndex = 0; slotIndex < concurrency; slotIndex++)
+            dispatch_semaphore_signal(pipelineSlots);
+
+        OMNI_POOL_START {
+            [OWFWebPounderStatistics logPassWithTitle:[NSString stringWithFormat:@"Pass %ld (%@ cache)", passIndex + 1, coldCache ? @"cold" : @"warm"]];
+        } OMNI_POOL_END;
+    }
+
+    [site stop];
+    [site release];
+    exit(0);
+}
+
+@end
+
 @interface OWFWebPounderObserver (Private)
 - (void)_pipelineFetchedNotification:(NSNotification *)notification;
 @end
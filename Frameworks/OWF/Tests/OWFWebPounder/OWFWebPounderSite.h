@@ -0,0 +1,43 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <Foundation/NSObject.h>
+#import <Foundation/NSDate.h>
+#import <dispatch/dispatch.h>
+
+@class NSArray, NSData, NSString;
+
+typedef struct {
+    NSUInteger pageCount;
+    NSUInteger pageSize;            // Approximate length of each page, links included
+    NSUInteger linksPerPage;
+    BOOL chunked;                   // Send bodies with Transfer-Encoding: chunked rather than Content-Length
+    NSUInteger slowPageInterval;    // Every slowPageInterval'th page waits slowPageDelay before its body is sent; 0 for none
+    NSTimeInterval slowPageDelay;
+} OWFWebPounderSiteOptions;
+
+// Serves a generated graph of HTML pages from the loopback interface. Each page links to linksPerPage others chosen deterministically, so every run sees the same site.
+@interface OWFWebPounderSite : NSObject
+{
+    OWFWebPounderSiteOptions options;
+    NSArray *pages;
+    int listenFileDescriptor;
+    unsigned short port;
+    dispatch_source_t acceptSource;
+}
+
++ (OWFWebPounderSiteOptions)defaultOptions;
+
+- (id)initWithOptions:(OWFWebPounderSiteOptions)someOptions;
+- (void)stop;
+
+- (unsigned short)port;
+- (NSUInteger)pageCount;
+- (NSString *)urlStringForPage:(NSUInteger)pageIndex;
+- (NSString *)optionsDescription;
+
+@end
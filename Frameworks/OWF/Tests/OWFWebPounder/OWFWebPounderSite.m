@@ -0,0 +1,273 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import "OWFWebPounderSite.h"
+
+#import <Foundation/Foundation.h>
+#import <OmniBase/OmniBase.h>
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+RCS_ID("$Id$")
+
+@implementation OWFWebPounderSite
+
++ (OWFWebPounderSiteOptions)defaultOptions;
+{
+    return (OWFWebPounderSiteOptions){
+        .pageCount = 500,
+        .pageSize = 16 * 1024,
+        .linksPerPage = 20,
+        .chunked = NO,
+        .slowPageInterval = 0,
+        .slowPageDelay = 0.25,
+    };
+}
+
+static NSData *_pageData(NSUInteger pageIndex, const OWFWebPounderSiteOptions *options)
+{
+    NSMutableString *page = [NSMutableString stringWithFormat:@"<html><head><title>Page %lu</title></head>\n<body>\n<h1>Page %lu</h1>\n", pageIndex, pageIndex];
+
+    // A linear congruential generator seeded by the page number, so the graph is the same from run to run without depending on random().
+    unsigned long long state = pageIndex * 2654435761ULL + 1;
+    for (NSUInteger linkIndex = 0; linkIndex < options->linksPerPage; linkIndex++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        NSUInteger targetIndex = (NSUInteger)((state >> 33) % options->pageCount);
+        [page appendFormat:@"<p><a href=\"/page/%lu.html\">Page %lu</a> ", targetIndex, targetIndex];
+        if (linkIndex % 4 == 0)
+            [page appendFormat:@"<a href=\"../page/%lu.html#top\">again</a>", targetIndex]; // Relative links with dot segments, so resolution takes its slow path too
+        [page appendString:@"</p>\n"];
+    }
+
+    static NSString * const filler = @"<p>Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut labore et dolore magna aliqua &amp; ut enim ad minim veniam.</p>\n";
+    while ([page length] < options->pageSize)
+        [page appendString:filler];
+    [page appendString:@"</body></html>\n"];
+
+    return [page dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+static BOOL _writeAll(int fileDescriptor, const void *bytes, size_t length)
+{
+    while (length != 0) {
+        ssize_t written = write(fileDescriptor, bytes, length);
+        if (written == -1) {
+            if (errno == EAGAIN) {
+                struct pollfd pollDescriptor = {.fd = fileDescriptor, .events = POLLOUT};
+                poll(&pollDescriptor, 1, -1);
+                continue;
+            }
+            if (errno == EINTR)
+                continue;
+            return NO;
+        }
+        bytes = (const uint8_t *)bytes + written;
+        length -= written;
+    }
+    return YES;
+}
+
+static BOOL _writeString(int fileDescriptor, NSString *string)
+{
+    NSData *data = [string dataUsingEncoding:NSASCIIStringEncoding];
+    return _writeAll(fileDescriptor, [data bytes], [data length]);
+}
+
+static NSUInteger _pageIndexForRequestLine(NSString *requestLine, NSUInteger pageCount)
+{
+    // "GET /page/123.html HTTP/1.1"
+    NSArray *words = [requestLine componentsSeparatedByString:@" "];
+    if ([words count] < 2)
+        return NSNotFound;
+    NSString *path = [words objectAtIndex:1];
+    if (![path hasPrefix:@"/page/"] || ![path hasSuffix:@".html"])
+        return NSNotFound;
+    NSString *number = [path substringWithRange:NSMakeRange(6, [path length] - 6 - 5)];
+    NSInteger pageIndex = [number integerValue];
+    if (pageIndex < 0 || (NSUInteger)pageIndex >= pageCount || ![[NSString stringWithFormat:@"%ld", pageIndex] isEqualToString:number])
+        return NSNotFound;
+    return pageIndex;
+}
+
+// Returns NO if the connection should be closed.
+static BOOL _respond(int fileDescriptor, NSString *requestHead, NSArray *pages, const OWFWebPounderSiteOptions *options)
+{
+    NSArray *lines = [requestHead componentsSeparatedByString:@"\r\n"];
+    NSString *requestLine = [lines objectAtIndex:0];
+    BOOL keepAlive = [requestLine hasSuffix:@"HTTP/1.1"];
+    for (NSString *line in lines) {
+        if ([line rangeOfString:@"Connection:" options:NSCaseInsensitiveSearch | NSAnchoredSearch].length != 0)
+            keepAlive = [line rangeOfString:@"close" options:NSCaseInsensitiveSearch].length == 0;
+    }
+
+    NSUInteger pageIndex = _pageIndexForRequestLine(requestLine, [pages count]);
+    if (pageIndex == NSNotFound) {
+        static NSString * const notFound = @"<html><body>Not found</body></html>\n";
+        return _writeString(fileDescriptor, [NSString stringWithFormat:@"HTTP/1.1 404 Not Found\r\nContent-Type: text/html\r\nContent-Length: %lu\r\n%@\r\n%@", [notFound length], keepAlive ? @"" : @"Connection: close\r\n", notFound]) && keepAlive;
+    }
+
+    NSData *page = [pages objectAtIndex:pageIndex];
+    NSString *lengthHeader = options->chunked ? @"Transfer-Encoding: chunked\r\n" : [NSString stringWithFormat:@"Content-Length: %lu\r\n", [page length]];
+    if (!_writeString(fileDescriptor, [NSString stringWithFormat:@"HTTP/1.1 200 OK\r\nContent-Type: text/html; charset=utf-8\r\nCache-Control: max-age=3600\r\n%@%@\r\n", lengthHeader, keepAlive ? @"" : @"Connection: close\r\n"]))
+        return NO;
+
+    // A slow page holds up its connection the way a slow origin server would, including any requests pipelined behind it.
+    if (options->slowPageInterval != 0 && pageIndex % options->slowPageInterval == 0)
+        usleep((useconds_t)(options->slowPageDelay * 1e6));
+
+    const uint8_t *bytes = [page bytes];
+    NSUInteger length = [page length];
+    if (!options->chunked)
+        return _writeAll(fileDescriptor, bytes, length) && keepAlive;
+
+    // Uneven chunks, so chunk boundaries land all over the place relative to the reader's buffers.
+    static const NSUInteger chunkLengths[] = {4096, 1000, 17, 8192, 333};
+    NSUInteger offset = 0, chunkIndex = 0;
+    while (offset < length) {
+        NSUInteger chunkLength = MIN(chunkLengths[chunkIndex++ % (sizeof(chunkLengths) / sizeof(*chunkLengths))], length - offset);
+        if (!_writeString(fileDescriptor, [NSString stringWithFormat:@"%lx\r\n", chunkLength]) || !_writeAll(fileDescriptor, bytes + offset, chunkLength) || !_writeAll(fileDescriptor, "\r\n", 2))
+            return NO;
+        offset += chunkLength;
+    }
+    return _writeAll(fileDescriptor, "0\r\n\r\n", 5) && keepAlive;
+}
+
+static void _serveConnection(int fileDescriptor, NSArray *pages, const OWFWebPounderSiteOptions *options)
+{
+    fcntl(fileDescriptor, F_SETFL, fcntl(fileDescriptor, F_GETFL, 0) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(fileDescriptor, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+    // Each connection gets its own serial queue so responses go out in request order, and a slow page only stalls its own connection.
+    dispatch_queue_t connectionQueue = dispatch_queue_create("com.omnigroup.OWFWebPounder.connection", DISPATCH_QUEUE_SERIAL);
+    dispatch_source_t readSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, fileDescriptor, 0, connectionQueue);
+    NSMutableData *requestBuffer = [[NSMutableData alloc] init];
+    [pages retain];
+
+    dispatch_source_set_event_handler(readSource, ^{
+        uint8_t buffer[16 * 1024];
+        ssize_t count = read(fileDescriptor, buffer, sizeof(buffer));
+        if (count == -1 && (errno == EAGAIN || errno == EINTR))
+            return;
+        if (count <= 0) {
+            dispatch_source_cancel(readSource);
+            return;
+        }
+        [requestBuffer appendBytes:buffer length:count];
+
+        OMNI_POOL_START {
+            NSRange terminatorRange;
+            while ((terminatorRange = [requestBuffer rangeOfData:[NSData dataWithBytes:"\r\n\r\n" length:4] options:0 range:NSMakeRange(0, [requestBuffer length])]).length != 0) {
+                NSString *requestHead = [[[NSString alloc] initWithBytes:[requestBuffer bytes] length:terminatorRange.location encoding:NSISOLatin1StringEncoding] autorelease];
+                [requestBuffer replaceBytesInRange:NSMakeRange(0, NSMaxRange(terminatorRange)) withBytes:NULL length:0];
+                if (!_respond(fileDescriptor, requestHead, pages, options)) {
+                    dispatch_source_cancel(readSource);
+                    break;
+                }
+            }
+        } OMNI_POOL_END;
+    });
+    dispatch_source_set_cancel_handler(readSource, ^{
+        close(fileDescriptor);
+        [requestBuffer release];
+        [pages release];
+        dispatch_release(readSource);
+    });
+    dispatch_resume(readSource);
+    dispatch_release(connectionQueue);
+}
+
+- (id)initWithOptions:(OWFWebPounderSiteOptions)someOptions;
+{
+    OBPRECONDITION(someOptions.pageCount > 0);
+
+    if (!(self = [super init]))
+        return nil;
+
+    options = someOptions;
+    NSMutableArray *generatedPages = [NSMutableArray arrayWithCapacity:options.pageCount];
+    for (NSUInteger pageIndex = 0; pageIndex < options.pageCount; pageIndex++)
+        [generatedPages addObject:_pageData(pageIndex, &options)];
+    pages = [generatedPages copy];
+
+    listenFileDescriptor = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(listenFileDescriptor, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in address = {.sin_family = AF_INET, .sin_port = 0, .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+    if (bind(listenFileDescriptor, (struct sockaddr *)&address, sizeof(address)) == -1 || listen(listenFileDescriptor, 1024) == -1) {
+        NSLog(@"Unable to listen on the loopback interface: %s", strerror(errno));
+        close(listenFileDescriptor);
+        [self release];
+        return nil;
+    }
+    socklen_t addressLength = sizeof(address);
+    getsockname(listenFileDescriptor, (struct sockaddr *)&address, &addressLength);
+    port = ntohs(address.sin_port);
+    fcntl(listenFileDescriptor, F_SETFL, fcntl(listenFileDescriptor, F_GETFL, 0) | O_NONBLOCK);
+
+    int listenDescriptor = listenFileDescriptor;
+    NSArray *sitePages = pages;
+    const OWFWebPounderSiteOptions *siteOptions = &options; // We outlive the accept source, which is cancelled in -stop
+    acceptSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, listenFileDescriptor, 0, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0));
+    dispatch_source_set_event_handler(acceptSource, ^{
+        int connectionDescriptor;
+        while ((connectionDescriptor = accept(listenDescriptor, NULL, NULL)) != -1)
+            _serveConnection(connectionDescriptor, sitePages, siteOptions);
+    });
+    dispatch_source_set_cancel_handler(acceptSource, ^{
+        close(listenDescriptor);
+    });
+    dispatch_resume(acceptSource);
+
+    return self;
+}
+
+- (void)dealloc;
+{
+    [self stop];
+    [pages release];
+    [super dealloc];
+}
+
+- (void)stop;
+{
+    if (acceptSource == NULL)
+        return;
+    dispatch_source_cancel(acceptSource);
+    dispatch_release(acceptSource);
+    acceptSource = NULL;
+}
+
+- (unsigned short)port;
+{
+    return port;
+}
+
+- (NSUInteger)pageCount;
+{
+    return options.pageCount;
+}
+
+- (NSString *)urlStringForPage:(NSUInteger)pageIndex;
+{
+    OBPRECONDITION(pageIndex < options.pageCount);
+    return [NSString stringWithFormat:@"http://127.0.0.1:%u/page/%lu.html", port, pageIndex];
+}
+
+- (NSString *)optionsDescription;
+{
+    NSString *slowDescription = options.slowPageInterval != 0 ? [NSString stringWithFormat:@", every %luth page %.0fms slow", options.slowPageInterval, options.slowPageDelay * 1000.0] : @"";
+    return [NSString stringWithFormat:@"%lu pages of %lu bytes, %lu links each, %@%@", options.pageCount, options.pageSize, options.linksPerPage, options.chunked ? @"chunked" : @"Content-Length", slowDescription];
+}
+
+@end
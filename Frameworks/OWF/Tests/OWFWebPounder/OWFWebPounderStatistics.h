@@ -0,0 +1,26 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <Foundation/NSObject.h>
+#import <Foundation/NSDate.h>
+
+@class NSString;
+
+// Collects what OWFWebPounder reports for each pass over a site: page latencies, the process's memory footprint high-water mark, and the thread CPU time spent in each processor class's -processInThread.
+@interface OWFWebPounderStatistics : NSObject
+
++ (void)installProcessorTiming;
+    // Call once every processor class has been loaded. Processors that do their work somewhere other than -processInThread, like an OWHTTPProcessor handed to the event engine, are only charged for what they do there.
+
++ (void)beginPass;
++ (void)recordPageLatency:(NSTimeInterval)latency succeeded:(BOOL)succeeded;
++ (void)sampleMemory;
++ (NSUInteger)pagesRecorded;
+
++ (void)logPassWithTitle:(NSString *)title;
+
+@end
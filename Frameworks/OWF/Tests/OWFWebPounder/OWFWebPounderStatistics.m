@@ -0,0 +1,215 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import "OWFWebPounderStatistics.h"
+
+#import <Foundation/Foundation.h>
+#import <OmniBase/OmniBase.h>
+#import <OWF/OWProcessor.h>
+
+#include <mach/mach.h>
+#include <objc/runtime.h>
+#include <sys/resource.h>
+#include <time.h>
+
+RCS_ID("$Id$")
+
+typedef struct {
+    uint64_t cpuNanoseconds;
+    NSUInteger runCount;
+} OWFWebPounderProcessorTime;
+
+static os_unfair_lock statisticsLock = OS_UNFAIR_LOCK_INIT;
+static CFAbsoluteTime passStartTime;
+static double *latencies;
+static NSUInteger latencyCount, latencyCapacity;
+static NSUInteger failedPageCount;
+static uint64_t footprintHighWater;
+static NSMutableDictionary *processorTimes; // class name -> NSValue of OWFWebPounderProcessorTime
+
+static _Thread_local unsigned int processorTimingDepth;
+
+static void _recordProcessorTime(NSString *className, uint64_t cpuNanoseconds)
+{
+    os_unfair_lock_lock(&statisticsLock);
+    OWFWebPounderProcessorTime processorTime = {0, 0};
+    [[processorTimes objectForKey:className] getValue:&processorTime];
+    processorTime.cpuNanoseconds += cpuNanoseconds;
+    processorTime.runCount++;
+    [processorTimes setObject:[NSValue valueWithBytes:&processorTime objCType:@encode(OWFWebPounderProcessorTime)] forKey:className];
+    os_unfair_lock_unlock(&statisticsLock);
+}
+
+static void _installTimingOnClass(Class processorClass)
+{
+    SEL selector = @selector(processInThread);
+    void (*originalImplementation)(id, SEL) = (typeof(originalImplementation))method_getImplementation(class_getInstanceMethod(processorClass, selector));
+    IMP timingImplementation = imp_implementationWithBlock(^(OWProcessor *processor) {
+        // Subclasses calling super would otherwise be counted twice.
+        if (processorTimingDepth++ != 0) {
+            @try {
+                originalImplementation(processor, selector);
+            } @finally {
+                processorTimingDepth--;
+            }
+            return;
+        }
+
+        NSString *className = NSStringFromClass([processor class]); // The processor may be gone once it has retired
+        uint64_t start = clock_gettime_nsec_np(CLOCK_THREAD_CPUTIME_ID);
+        @try {
+            originalImplementation(processor, selector);
+        } @finally {
+            processorTimingDepth--;
+            _recordProcessorTime(className, clock_gettime_nsec_np(CLOCK_THREAD_CPUTIME_ID) - start);
+        }
+    });
+    OBReplaceMethodImplementation(processorClass, selector, timingImplementation);
+}
+
+static BOOL _classImplementsSelector(Class aClass, SEL selector)
+{
+    unsigned int methodCount;
+    Method *methods = class_copyMethodList(aClass, &methodCount);
+    BOOL found = NO;
+    for (unsigned int methodIndex = 0; methodIndex < methodCount && !found; methodIndex++)
+        found = method_getName(methods[methodIndex]) == selector;
+    free(methods);
+    return found;
+}
+
+static uint64_t _currentFootprint(void)
+{
+    task_vm_info_data_t vmInfo;
+    mach_msg_type_number_t count = TASK_VM_INFO_COUNT;
+    if (task_info(mach_task_self(), TASK_VM_INFO, (task_info_t)&vmInfo, &count) != KERN_SUCCESS)
+        return 0;
+    return vmInfo.phys_footprint;
+}
+
+static double _percentile(const double *sortedValues, NSUInteger count, double fraction)
+{
+    if (count == 0)
+        return 0.0;
+    NSUInteger index = (NSUInteger)ceil(fraction * count);
+    return sortedValues[index == 0 ? 0 : MIN(index, count) - 1];
+}
+
+static int _compareDoubles(const void *a, const void *b)
+{
+    double first = *(const double *)a, second = *(const double *)b;
+    return first < second ? -1 : (first > second ? 1 : 0);
+}
+
+@implementation OWFWebPounderStatistics
+
++ (void)initialize;
+{
+    OBINITIALIZE;
+
+    processorTimes = [[NSMutableDictionary alloc] init];
+}
+
++ (void)installProcessorTiming;
+{
+    // Every class that has its own -processInThread gets wrapped, since most of the interesting ones override it without calling super.
+    unsigned int classCount;
+    Class *classes = objc_copyClassList(&classCount);
+    Class processorClass = [OWProcessor class];
+    for (unsigned int classIndex = 0; classIndex < classCount; classIndex++) {
+        Class aClass = classes[classIndex];
+        Class superclass = aClass;
+        while (superclass != Nil && superclass != processorClass)
+            superclass = class_getSuperclass(superclass);
+        if (superclass != Nil && _classImplementsSelector(aClass, @selector(processInThread)))
+            _installTimingOnClass(aClass);
+    }
+    free(classes);
+}
+
++ (void)beginPass;
+{
+    os_unfair_lock_lock(&statisticsLock);
+    passStartTime = CFAbsoluteTimeGetCurrent();
+    latencyCount = 0;
+    failedPageCount = 0;
+    footprintHighWater = 0;
+    [processorTimes removeAllObjects];
+    os_unfair_lock_unlock(&statisticsLock);
+
+    [self sampleMemory];
+}
+
++ (void)recordPageLatency:(NSTimeInterval)latency succeeded:(BOOL)succeeded;
+{
+    os_unfair_lock_lock(&statisticsLock);
+    if (latencyCount == latencyCapacity) {
+        latencyCapacity = MAX(1024, latencyCapacity * 2);
+        latencies = reallocf(latencies, latencyCapacity * sizeof(*latencies));
+    }
+    latencies[latencyCount++] = latency;
+    if (!succeeded)
+        failedPageCount++;
+    os_unfair_lock_unlock(&statisticsLock);
+}
+
++ (void)sampleMemory;
+{
+    uint64_t footprint = _currentFootprint();
+    os_unfair_lock_lock(&statisticsLock);
+    if (footprint > footprintHighWater)
+        footprintHighWater = footprint;
+    os_unfair_lock_unlock(&statisticsLock);
+}
+
++ (NSUInteger)pagesRecorded;
+{
+    os_unfair_lock_lock(&statisticsLock);
+    NSUInteger count = latencyCount;
+    os_unfair_lock_unlock(&statisticsLock);
+    return count;
+}
+
++ (void)logPassWithTitle:(NSString *)title;
+{
+    [self sampleMemory];
+
+    os_unfair_lock_lock(&statisticsLock);
+    CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - passStartTime;
+    NSUInteger pageCount = latencyCount, failedCount = failedPageCount;
+    double *sortedLatencies = malloc(MAX(pageCount, 1) * sizeof(*sortedLatencies));
+    memcpy(sortedLatencies, latencies, pageCount * sizeof(*sortedLatencies));
+    uint64_t highWater = footprintHighWater;
+    NSDictionary *passProcessorTimes = [[processorTimes copy] autorelease];
+    os_unfair_lock_unlock(&statisticsLock);
+
+    qsort(sortedLatencies, pageCount, sizeof(*sortedLatencies), _compareDoubles);
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf("%s: %lu pages (%lu failed) in %.3fs, %.1f pages/s\n", [title UTF8String], pageCount, failedCount, elapsed, elapsed > 0 ? pageCount / elapsed : 0.0);
+    printf("    latency p50 %.2fms, p99 %.2fms, max %.2fms\n", _percentile(sortedLatencies, pageCount, 0.50) * 1000.0, _percentile(sortedLatencies, pageCount, 0.99) * 1000.0, pageCount != 0 ? sortedLatencies[pageCount - 1] * 1000.0 : 0.0);
+    printf("    memory footprint high-water %.1f MB (maximum resident size so far %.1f MB)\n", highWater / (1024.0 * 1024.0), usage.ru_maxrss / (1024.0 * 1024.0));
+    free(sortedLatencies);
+
+    NSArray *classNames = [[passProcessorTimes allKeys] sortedArrayUsingComparator:^NSComparisonResult(NSString *name1, NSString *name2) {
+        OWFWebPounderProcessorTime time1, time2;
+        [[passProcessorTimes objectForKey:name1] getValue:&time1];
+        [[passProcessorTimes objectForKey:name2] getValue:&time2];
+        if (time1.cpuNanoseconds != time2.cpuNanoseconds)
+            return time1.cpuNanoseconds > time2.cpuNanoseconds ? NSOrderedAscending : NSOrderedDescending;
+        return [name1 compare:name2];
+    }];
+    for (NSString *className in classNames) {
+        OWFWebPounderProcessorTime processorTime;
+        [[passProcessorTimes objectForKey:className] getValue:&processorTime];
+        printf("    %-32s %8.3fs CPU in %6lu runs (%.3fms each)\n", [className UTF8String], processorTime.cpuNanoseconds / 1e9, processorTime.runCount, processorTime.cpuNanoseconds / 1e6 / processorTime.runCount);
+    }
+    fflush(stdout);
+}
+
+@end
@@ -0,0 +1,161 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OWF/OWContent.h>
+#import <OWF/OWContentType.h>
+#import <OWF/OWHTMLToSGMLObjects.h>
+#import <OWF/OWObjectStream.h>
+#import <OWF/OWSGMLDTD.h>
+#import <OWF/OWSGMLTagType.h>
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#import <OmniBase/rcsid.h>
+#import <OmniFoundation/OFMultiValueDictionary.h>
+
+RCS_ID("$Id$");
+
+// Times OWHTMLToSGMLObjects over a corpus of HTML pages. Set OWHTMLBenchmarkCorpusPath in the environment to a directory of saved .html files to use real pages; otherwise a generated corpus is used. Results are logged rather than asserted since they depend on the machine.
+
+@interface OWHTMLToSGMLObjectsBenchmarkProcessor : OWHTMLToSGMLObjects
+- (OWObjectStream *)objectStream;
+@end
+
+@implementation OWHTMLToSGMLObjectsBenchmarkProcessor
+- (OWObjectStream *)objectStream;
+{
+    return objectStream;
+}
+@end
+
+@interface OWHTMLToSGMLObjectsBenchmarks : XCTestCase
+@end
+
+@implementation OWHTMLToSGMLObjectsBenchmarks
+
+static const NSUInteger OWHTMLBenchmarkGeneratedPageCount = 200;
+static const NSUInteger OWHTMLBenchmarkGeneratedParagraphsPerPage = 200;
+static const NSUInteger OWHTMLBenchmarkPasses = 5;
+
++ (void)setUp;
+{
+    [super setUp];
+
+    OWContentType *html = [OWContentType contentTypeForString:@"text/html"];
+    OWSGMLDTD *dtd = [OWSGMLDTD dtdForSourceContentType:html];
+    if (dtd == nil)
+        dtd = [OWSGMLDTD registeredDTDForSourceContentType:html destinationContentType:[OWContentType contentTypeForString:@"ObjectStream/sgml"]];
+
+    // Enough of HTML for typical pages to come out as tags rather than skipped markup.
+    for (NSString *tagName in @[@"html", @"head", @"title", @"body", @"p", @"b", @"i", @"em", @"strong", @"br", @"hr", @"h1", @"h2", @"h3", @"ul", @"ol", @"li", @"table", @"tr", @"td", @"th", @"form", @"input"]) {
+        OWSGMLTagType *tagType = [dtd tagTypeNamed:tagName];
+        [tagType addAttributeNamed:@"id"];
+        [tagType addAttributeNamed:@"class"];
+        [tagType addAttributeNamed:@"style"];
+    }
+    for (NSString *tagName in @[@"a", @"link"]) {
+        OWSGMLTagType *tagType = [dtd tagTypeNamed:tagName];
+        [tagType addAttributeNamed:@"href"];
+        [tagType addAttributeNamed:@"rel"];
+        [tagType addAttributeNamed:@"title"];
+        [tagType addAttributeNamed:@"class"];
+    }
+    OWSGMLTagType *imageTagType = [dtd tagTypeNamed:@"img"];
+    [imageTagType addAttributeNamed:@"src"];
+    [imageTagType addAttributeNamed:@"alt"];
+    [imageTagType addAttributeNamed:@"width"];
+    [imageTagType addAttributeNamed:@"height"];
+    OWSGMLTagType *metaTagType = [dtd tagTypeNamed:@"meta"];
+    [metaTagType addAttributeNamed:@"name"];
+    [metaTagType addAttributeNamed:@"content"];
+    [[dtd tagTypeNamed:@"script"] setContentHandling:OWSGMLTagContentHandlingNonSGML];
+    [[dtd tagTypeNamed:@"style"] setContentHandling:OWSGMLTagContentHandlingNonSGML];
+}
+
+static NSArray *_generatedCorpus(void)
+{
+    NSMutableArray *pages = [NSMutableArray arrayWithCapacity:OWHTMLBenchmarkGeneratedPageCount];
+    srandom(1);
+    for (NSUInteger pageIndex = 0; pageIndex < OWHTMLBenchmarkGeneratedPageCount; pageIndex++) {
+        NSMutableString *page = [NSMutableString stringWithFormat:@"<!DOCTYPE HTML PUBLIC \"-//W3C//DTD HTML 4.01 Transitional//EN\">\n<html><head><title>Page %lu &mdash; Example</title>\n<meta name=description content=\"A generated page\">\n<link rel=stylesheet href=\"/style.css\">\n<style>p { margin: 0 } a:hover { color: red }</style>\n<script>var n = 0; if (n < 1 && n >= 0) { n++; }</script></head>\n<body class=\"page\">\n<!-- generated -->\n", pageIndex];
+        for (NSUInteger paragraphIndex = 0; paragraphIndex < OWHTMLBenchmarkGeneratedParagraphsPerPage; paragraphIndex++) {
+            switch (random() % 4) {
+                case 0:
+                    [page appendFormat:@"<p id=p%lu class=\"text body\">Lorem ipsum dolor sit amet, consectetur adipiscing elit &amp; sed do eiusmod tempor incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis nostrud exercitation ullamco laboris.</p>\n", paragraphIndex];
+                    break;
+                case 1:
+                    [page appendFormat:@"<ul><li><a href=\"/articles/%lu?ref=list&amp;page=%lu\" title=\"Article %lu\">Article %lu</a> &ndash; <em>caf&eacute;</em> &copy; 2026</li><li><a href=/other/%lu rel=nofollow>Other</a></li></ul>\n", paragraphIndex, pageIndex, paragraphIndex, paragraphIndex, paragraphIndex];
+                    break;
+                case 2:
+                    [page appendFormat:@"<table class=grid><tr><th>Name</th><th>Price</th></tr><tr><td>Widget %lu</td><td>&#36;%lu.99</td></tr><tr><td>Gadget&nbsp;%lu</td><td>&euro;%lu</td></tr></table>\n", paragraphIndex, paragraphIndex, paragraphIndex, paragraphIndex];
+                    break;
+                default:
+                    [page appendFormat:@"<p><img src=\"/images/%lu.png\" alt=\"Image %lu\" width=320 height=240><br>Caption with <b>bold</b> and <i>italic</i> text, &lt;code&gt; samples and a &quot;quote&quot;.</p>\n", paragraphIndex, paragraphIndex];
+                    break;
+            }
+        }
+        [page appendString:@"</body></html>\n"];
+        [pages addObject:[page dataUsingEncoding:NSUTF8StringEncoding]];
+    }
+    return pages;
+}
+
+static NSArray *_corpus(NSString **outDescription)
+{
+    NSString *corpusPath = [[[NSProcessInfo processInfo] environment] objectForKey:@"OWHTMLBenchmarkCorpusPath"];
+    if (corpusPath != nil) {
+        NSMutableArray *pages = [NSMutableArray array];
+        for (NSString *fileName in [[NSFileManager defaultManager] contentsOfDirectoryAtPath:corpusPath error:NULL]) {
+            if (![[fileName pathExtension] isEqualToString:@"html"] && ![[fileName pathExtension] isEqualToString:@"htm"])
+                continue;
+            NSData *page = [NSData dataWithContentsOfFile:[corpusPath stringByAppendingPathComponent:fileName]];
+            if (page != nil)
+                [pages addObject:page];
+        }
+        if ([pages count] > 0) {
+            *outDescription = corpusPath;
+            return pages;
+        }
+        NSLog(@"No .html files in %@; using the generated corpus", corpusPath);
+    }
+
+    *outDescription = @"generated corpus";
+    return _generatedCorpus();
+}
+
+- (void)testPagesPerSecond;
+{
+    NSString *corpusDescription = nil;
+    NSArray *corpus = _corpus(&corpusDescription);
+    unsigned long long byteCount = 0, tokenCount = 0;
+    OFMultiValueDictionary *headers = [[OFMultiValueDictionary alloc] init];
+    [headers addObject:@"text/html; charset=utf-8" forKey:OWContentTypeHeaderString];
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger pass = 0; pass < OWHTMLBenchmarkPasses; pass++) {
+        for (NSData *page in corpus) {
+            NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+            OWContent *content = [OWContent contentWithData:page headers:headers];
+            OWHTMLToSGMLObjectsBenchmarkProcessor *processor = [[OWHTMLToSGMLObjectsBenchmarkProcessor alloc] initWithContent:content context:nil];
+            [processor processBegin];
+            [processor process];
+            tokenCount += [[processor objectStream] objectCount];
+            byteCount += [page length];
+            [processor release];
+
+            [pool release];
+        }
+    }
+    CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+    [headers release];
+
+    NSUInteger pageCount = [corpus count] * OWHTMLBenchmarkPasses;
+    NSLog(@"%@: %lu pages, %llu tokens in %.3fs (%.0f pages/s, %.1f MB/s)", corpusDescription, pageCount, tokenCount, elapsed, elapsed > 0 ? pageCount / elapsed : 0.0, elapsed > 0 ? byteCount / elapsed / (1024.0 * 1024.0) : 0.0);
+}
+
+@end
@@ -0,0 +1,134 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OWF/OWContent.h>
+#import <OWF/OWContentType.h>
+#import <OWF/OWHTMLToSGMLObjects.h>
+#import <OWF/OWObjectStream.h>
+#import <OWF/OWSGMLDTD.h>
+#import <OWF/OWSGMLTag.h>
+#import <OWF/OWSGMLTagType.h>
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#import <OmniBase/rcsid.h>
+#import <OmniFoundation/OmniFoundation.h>
+
+RCS_ID("$Id$");
+
+// These pin down the tokens OWHTMLToSGMLObjects produces for the cases its fast paths special-case (entities, attribute values, and the scan for '<' and '&'), so the fast paths can't drift from the general ones.
+
+@interface OWHTMLToSGMLObjectsTestProcessor : OWHTMLToSGMLObjects
+- (OWObjectStream *)objectStream;
+@end
+
+@implementation OWHTMLToSGMLObjectsTestProcessor
+- (OWObjectStream *)objectStream;
+{
+    return objectStream;
+}
+@end
+
+@interface OWHTMLToSGMLObjectsTests : XCTestCase
+@end
+
+@implementation OWHTMLToSGMLObjectsTests
+
++ (void)setUp;
+{
+    [super setUp];
+
+    OWContentType *html = [OWContentType contentTypeForString:@"text/html"];
+    OWSGMLDTD *dtd = [OWSGMLDTD dtdForSourceContentType:html];
+    if (dtd == nil)
+        dtd = [OWSGMLDTD registeredDTDForSourceContentType:html destinationContentType:[OWContentType contentTypeForString:@"ObjectStream/sgml"]];
+
+    OWSGMLTagType *tagType = [dtd tagTypeNamed:@"p"];
+    [tagType addAttributeNamed:@"class"];
+    [tagType addAttributeNamed:@"title"];
+    tagType = [dtd tagTypeNamed:@"a"];
+    [tagType addAttributeNamed:@"href"];
+    [tagType addAttributeNamed:@"title"];
+    [tagType addAttributeNamed:@"rel"];
+    [dtd tagTypeNamed:@"b"];
+    [[dtd tagTypeNamed:@"script"] setContentHandling:OWSGMLTagContentHandlingNonSGML];
+}
+
+static NSString *_describeToken(id token)
+{
+    if (![token isKindOfClass:[OWSGMLTag class]])
+        return token;
+
+    OWSGMLTag *tag = token;
+    if ([tag tokenType] == OWSGMLTokenTypeEndTag)
+        return [NSString stringWithFormat:@"</%@>", [tag name]];
+
+    NSMutableString *description = [NSMutableString stringWithFormat:@"<%@", [tag name]];
+    for (NSString *attributeName in [[tag tagType] attributeNames]) {
+        NSString *value = [tag valueForAttribute:attributeName];
+        if (value != nil)
+            [description appendFormat:@" %@=%@", attributeName, value];
+    }
+    NSDictionary *extraAttributes = [tag extraAttributes];
+    for (NSString *attributeName in [[extraAttributes allKeys] sortedArrayUsingSelector:@selector(compare:)])
+        [description appendFormat:@" %@=%@", attributeName, [extraAttributes objectForKey:attributeName]];
+    [description appendString:@">"];
+    return description;
+}
+
+static NSArray *_tokensForHTML(NSString *html)
+{
+    OWContent *content = [OWContent contentWithString:html contentType:@"text/html; charset=utf-8" isSource:YES];
+    OWHTMLToSGMLObjectsTestProcessor *processor = [[OWHTMLToSGMLObjectsTestProcessor alloc] initWithContent:content context:nil];
+    [processor processBegin];
+    [processor process];
+
+    OWObjectStream *objectStream = [processor objectStream];
+    NSMutableArray *tokens = [NSMutableArray array];
+    for (NSUInteger tokenIndex = 0; ![objectStream isIndexPastEnd:tokenIndex]; tokenIndex++)
+        [tokens addObject:_describeToken([objectStream objectAtIndex:tokenIndex])];
+
+    [processor release];
+    return tokens;
+}
+
+- (void)testEntities;
+{
+    NSArray *expected = @[@"a", @"<", @"b", @"©", @" c", @"©", @"A", @"–", @"ƒ", @"&fnof", @" ", @"&bogus", @";", @"&{x};", @"&"];
+    XCTAssertEqualObjects(_tokensForHTML(@"a&lt;b&copy c&#169;&#x41;&#150;&fnof;&fnof &bogus;&{x};&"), expected);
+}
+
+- (void)testAttributeValues;
+{
+    NSArray *expected = @[@"<a href=x.html?a=1&b=2 title=line1\nline2 rel=nofollow data-x=y>", @"link", @"</a>", @"<p class=intro title=>", @"</p>"];
+    XCTAssertEqualObjects(_tokensForHTML(@"<a href=\"x.html?a=1&amp;b=2\" title='line1\nline2' rel=nofollow data-x=y>link</a><p class=intro title=\"\"></p>"), expected);
+}
+
+- (void)testNonSGMLContent;
+{
+    NSArray *expected = @[@"<script>", @"if (a", @"<", @"b ", @"&", @"&", @" c) x();", @"</script>"];
+    XCTAssertEqualObjects(_tokensForHTML(@"<script>if (a<b && c) x();</script>"), expected);
+}
+
+- (void)testMarkupCharacterAtEveryOffset;
+{
+    // The scan for '<' and '&' looks at four characters at a time, so move them through every position in a word. U+263C and U+3C26 share a byte with '<' and '&' but must not match.
+    for (NSUInteger offset = 0; offset < 24; offset++) {
+        NSString *text = [@"" stringByPaddingToLength:offset withString:@"x☼㰦" startingAtIndex:0];
+        NSArray *tokens = _tokensForHTML([NSString stringWithFormat:@"%@<b>%@&amp;", text, text]);
+        NSMutableArray *expected = [NSMutableArray array];
+        if (offset > 0)
+            [expected addObject:text];
+        [expected addObject:@"<b>"];
+        if (offset > 0)
+            [expected addObject:text];
+        [expected addObject:@"&"];
+        XCTAssertEqualObjects(tokens, expected, @"offset %lu", offset);
+    }
+}
+
+@end
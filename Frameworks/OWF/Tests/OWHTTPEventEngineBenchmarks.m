@@ -0,0 +1,430 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OWF/OWDataStream.h>
+#import <OWF/OWHeaderDictionary.h>
+#import <OWF/OWHTTPEventEngine.h>
+#import <OmniNetworking/OmniNetworking.h>
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#import <OmniBase/rcsid.h>
+
+#include <netinet/in.h>
+#include <stdatomic.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+RCS_ID("$Id$");
+
+// Runs many keep-alive connections against a canned HTTP server on the loopback interface: once through OWHTTPEventEngine, and once the way sessions work without it, with ONSocketStream blocking on a bounded pool of threads. Results are logged rather than asserted since they depend on the machine.
+
+static const NSUInteger OWHTTPEventEngineBenchmarkBodyLength = 8 * 1024;
+static const NSUInteger OWHTTPEventEngineBenchmarkRequestsPerConnection = 10;
+static const NSUInteger OWHTTPEventEngineBenchmarkBlockingThreadCount = 64;
+static const NSTimeInterval OWHTTPEventEngineBenchmarkTimeout = 300.0;
+
+#pragma mark - Canned server
+
+// Answers every request it sees with the same keep-alive response. It only counts header terminators, which is all the clients below ever send.
+@interface OWHTTPEventEngineBenchmarkServer : NSObject
+{
+    int listenFileDescriptor;
+    unsigned short port;
+    dispatch_source_t acceptSource;
+    NSData *responseData;
+}
+- (id)initWithBodyLength:(NSUInteger)bodyLength;
+- (unsigned short)port;
+- (void)stop;
+@end
+
+static void _writeAll(int fileDescriptor, const uint8_t *bytes, size_t length)
+{
+    while (length != 0) {
+        ssize_t written = write(fileDescriptor, bytes, length);
+        if (written == -1) {
+            if (errno == EAGAIN) {
+                struct pollfd pollDescriptor = {.fd = fileDescriptor, .events = POLLOUT};
+                poll(&pollDescriptor, 1, -1);
+                continue;
+            }
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        bytes += written;
+        length -= written;
+    }
+}
+
+static void _serveConnection(int fileDescriptor, NSData *responseData)
+{
+    fcntl(fileDescriptor, F_SETFL, fcntl(fileDescriptor, F_GETFL, 0) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(fileDescriptor, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+    dispatch_source_t readSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, fileDescriptor, 0, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0));
+    __block NSUInteger matchedTerminatorLength = 0;
+    dispatch_source_set_event_handler(readSource, ^{
+        uint8_t buffer[16 * 1024];
+        ssize_t count = read(fileDescriptor, buffer, sizeof(buffer));
+        if (count == -1 && (errno == EAGAIN || errno == EINTR))
+            return;
+        if (count <= 0) {
+            dispatch_source_cancel(readSource);
+            return;
+        }
+
+        static const char terminator[] = "\r\n\r\n";
+        for (ssize_t byteIndex = 0; byteIndex < count; byteIndex++) {
+            if (buffer[byteIndex] == terminator[matchedTerminatorLength])
+                matchedTerminatorLength++;
+            else
+                matchedTerminatorLength = (buffer[byteIndex] == '\r') ? 1 : 0;
+            if (matchedTerminatorLength == 4) {
+                matchedTerminatorLength = 0;
+                _writeAll(fileDescriptor, [responseData bytes], [responseData length]);
+            }
+        }
+    });
+    dispatch_source_set_cancel_handler(readSource, ^{
+        close(fileDescriptor);
+        dispatch_release(readSource);
+    });
+    dispatch_resume(readSource);
+}
+
+@implementation OWHTTPEventEngineBenchmarkServer
+
+- (id)initWithBodyLength:(NSUInteger)bodyLength;
+{
+    if (!(self = [super init]))
+        return nil;
+
+    NSMutableData *response = [NSMutableData dataWithData:[[NSString stringWithFormat:@"HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: %lu\r\n\r\n", bodyLength] dataUsingEncoding:NSASCIIStringEncoding]];
+    NSUInteger headLength = [response length];
+    [response setLength:headLength + bodyLength];
+    memset((uint8_t *)[response mutableBytes] + headLength, 'x', bodyLength);
+    responseData = [response copy];
+
+    listenFileDescriptor = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(listenFileDescriptor, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in address = {.sin_family = AF_INET, .sin_port = 0, .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+    bind(listenFileDescriptor, (struct sockaddr *)&address, sizeof(address));
+    listen(listenFileDescriptor, 4096); // The kernel clamps this to kern.ipc.somaxconn; connections past that just retry their SYN.
+    socklen_t addressLength = sizeof(address);
+    getsockname(listenFileDescriptor, (struct sockaddr *)&address, &addressLength);
+    port = ntohs(address.sin_port);
+    fcntl(listenFileDescriptor, F_SETFL, fcntl(listenFileDescriptor, F_GETFL, 0) | O_NONBLOCK);
+
+    int listenDescriptor = listenFileDescriptor;
+    NSData *cannedResponse = responseData;
+    acceptSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, listenFileDescriptor, 0, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0));
+    dispatch_source_set_event_handler(acceptSource, ^{
+        int connectionDescriptor;
+        while ((connectionDescriptor = accept(listenDescriptor, NULL, NULL)) != -1)
+            _serveConnection(connectionDescriptor, cannedResponse);
+    });
+    dispatch_source_set_cancel_handler(acceptSource, ^{
+        close(listenDescriptor);
+    });
+    dispatch_resume(acceptSource);
+
+    return self;
+}
+
+- (void)dealloc;
+{
+    [self stop];
+    [responseData release];
+    [super dealloc];
+}
+
+- (unsigned short)port;
+{
+    return port;
+}
+
+- (void)stop;
+{
+    if (acceptSource == NULL)
+        return;
+    dispatch_source_cancel(acceptSource);
+    dispatch_release(acceptSource);
+    acceptSource = NULL;
+}
+
+@end
+
+#pragma mark - Engine client
+
+@interface OWHTTPEventEngineBenchmarkConnectionState : NSObject
+{
+@public
+    OWHTTPEngineConnection *connection;
+    OWDataStream *dataStream;
+    NSUInteger requestsSent;
+    NSUInteger responsesFinished;
+    BOOL done;
+}
+@end
+
+@implementation OWHTTPEventEngineBenchmarkConnectionState
+- (void)dealloc;
+{
+    [connection release];
+    [dataStream release];
+    [super dealloc];
+}
+@end
+
+@interface OWHTTPEventEngineBenchmarkClient : NSObject <OWHTTPEngineConnectionDelegate>
+{
+@public
+    NSData *requestData;
+    dispatch_group_t group;
+    _Atomic(uint64_t) bodyBytesRead;
+    atomic_uint failureCount;
+}
+@end
+
+@implementation OWHTTPEventEngineBenchmarkClient
+
+- (void)dealloc;
+{
+    [requestData release];
+    if (group != NULL)
+        dispatch_release(group);
+    [super dealloc];
+}
+
+- (void)sendRequestOnState:(OWHTTPEventEngineBenchmarkConnectionState *)state;
+{
+    state->requestsSent++;
+    [state->connection enqueueRequestData:requestData expectsBody:YES context:state];
+}
+
+- (OWDataStream *)engineConnection:(OWHTTPEngineConnection *)connection streamForResponse:(OWHTTPEngineResponse *)response;
+{
+    OWHTTPEventEngineBenchmarkConnectionState *state = [response context];
+    [state->dataStream release];
+    state->dataStream = [[OWDataStream alloc] initWithLength:OWHTTPEventEngineBenchmarkBodyLength];
+    return state->dataStream;
+}
+
+- (void)engineConnection:(OWHTTPEngineConnection *)connection response:(OWHTTPEngineResponse *)response didReadBodyBytes:(NSUInteger)totalBodyBytes;
+{
+}
+
+- (void)engineConnection:(OWHTTPEngineConnection *)connection didFinishResponse:(OWHTTPEngineResponse *)response;
+{
+    OWHTTPEventEngineBenchmarkConnectionState *state = [response context];
+    [state->dataStream dataEnd];
+    atomic_fetch_add(&bodyBytesRead, [response bodyBytesRead]);
+
+    state->responsesFinished++;
+    if (state->requestsSent < OWHTTPEventEngineBenchmarkRequestsPerConnection)
+        [self sendRequestOnState:state];
+    else if (state->responsesFinished == OWHTTPEventEngineBenchmarkRequestsPerConnection && !state->done) {
+        state->done = YES;
+        dispatch_group_leave(group);
+    }
+}
+
+- (void)engineConnection:(OWHTTPEngineConnection *)connection didFailWithError:(NSError *)error duringResponse:(OWHTTPEngineResponse *)response;
+{
+    // The state isn't reachable from here if no response had started, so failures are only counted; the group wait times out instead.
+    atomic_fetch_add(&failureCount, 1);
+    NSLog(@"engine connection failed: %@", error);
+}
+
+@end
+
+#pragma mark - Benchmarks
+
+@interface OWHTTPEventEngineBenchmarks : XCTestCase
+@end
+
+@implementation OWHTTPEventEngineBenchmarks
+
+static OWHTTPEventEngine *benchmarkEngine = nil;
+
++ (void)setUp;
+{
+    [super setUp];
+
+    // Two descriptors per connection (ours and the server's), and the default soft limit is far too low for that.
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = MIN((rlim_t)16384, limit.rlim_max);
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    // Engine threads live for the life of the process, so every run shares one engine.
+    if (benchmarkEngine == nil)
+        benchmarkEngine = [[OWHTTPEventEngine alloc] initWithThreadCount:2];
+}
+
+static NSData *_requestData(void)
+{
+    return [@"GET /canned HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n\r\n" dataUsingEncoding:NSASCIIStringEncoding];
+}
+
+static void _logTiming(NSString *label, NSUInteger connectionCount, NSUInteger requestCount, unsigned long long byteCount, NSUInteger failureCount, CFAbsoluteTime elapsed)
+{
+    NSLog(@"%@, %lu connections: %lu requests in %.3fs (%.0f requests/s, %.1f MB/s), %lu failures", label, connectionCount, requestCount, elapsed, elapsed > 0 ? requestCount / elapsed : 0.0, elapsed > 0 ? byteCount / elapsed / (1024.0 * 1024.0) : 0.0, failureCount);
+}
+
+- (void)_benchmarkEngineWithConnectionCount:(NSUInteger)connectionCount pipelineDepth:(NSUInteger)pipelineDepth;
+{
+    OWHTTPEventEngineBenchmarkServer *server = [[OWHTTPEventEngineBenchmarkServer alloc] initWithBodyLength:OWHTTPEventEngineBenchmarkBodyLength];
+    ONHost *host = [ONHost hostForAddress:[ONHostAddress loopbackAddress]];
+
+    OWHTTPEventEngineBenchmarkClient *client = [[OWHTTPEventEngineBenchmarkClient alloc] init];
+    client->requestData = [_requestData() retain];
+    client->group = dispatch_group_create();
+
+    NSMutableArray *states = [[NSMutableArray alloc] initWithCapacity:connectionCount];
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger connectionIndex = 0; connectionIndex < connectionCount; connectionIndex++) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+        OWHTTPEventEngineBenchmarkConnectionState *state = [[OWHTTPEventEngineBenchmarkConnectionState alloc] init];
+        dispatch_queue_t delegateQueue = dispatch_queue_create("com.omnigroup.OWF.OWHTTPEventEngineBenchmarks", DISPATCH_QUEUE_SERIAL);
+        dispatch_group_enter(client->group);
+
+        // Enqueue on the delegate queue so the first requests can't race the callbacks for their responses.
+        dispatch_sync(delegateQueue, ^{
+            state->connection = [[benchmarkEngine connectionToHost:host port:[server port] delegate:client delegateQueue:delegateQueue] retain];
+            for (NSUInteger depth = 0; depth < pipelineDepth && state->requestsSent < OWHTTPEventEngineBenchmarkRequestsPerConnection; depth++)
+                [client sendRequestOnState:state];
+        });
+        dispatch_release(delegateQueue);
+        [states addObject:state];
+        [state release];
+
+        [pool release];
+    }
+
+    long timedOut = dispatch_group_wait(client->group, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(OWHTTPEventEngineBenchmarkTimeout * NSEC_PER_SEC)));
+    CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+    XCTAssertEqual(timedOut, 0L, @"Not every connection finished");
+
+    _logTiming([NSString stringWithFormat:@"engine (%lu threads, pipeline depth %lu)", [benchmarkEngine threadCount], pipelineDepth], connectionCount, connectionCount * OWHTTPEventEngineBenchmarkRequestsPerConnection, atomic_load(&client->bodyBytesRead), atomic_load(&client->failureCount), elapsed);
+
+    for (OWHTTPEventEngineBenchmarkConnectionState *state in states)
+        [state->connection abort];
+    [states release];
+    [client release];
+    [server stop];
+    [server release];
+}
+
+- (void)_benchmarkBlockingWithConnectionCount:(NSUInteger)connectionCount;
+{
+    OWHTTPEventEngineBenchmarkServer *server = [[OWHTTPEventEngineBenchmarkServer alloc] initWithBodyLength:OWHTTPEventEngineBenchmarkBodyLength];
+    unsigned short port = [server port];
+    NSData *requestData = _requestData();
+
+    // The threads are all done before this returns, so they can share these through pointers.
+    _Atomic(uint64_t) bodyBytesRead = 0;
+    atomic_uint failureCount = 0;
+    atomic_uint nextConnectionIndex = 0;
+    _Atomic(uint64_t) *bodyBytesReadPointer = &bodyBytesRead;
+    atomic_uint *failureCountPointer = &failureCount;
+    atomic_uint *nextConnectionIndexPointer = &nextConnectionIndex;
+    dispatch_group_t group = dispatch_group_create();
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger threadIndex = 0; threadIndex < OWHTTPEventEngineBenchmarkBlockingThreadCount; threadIndex++) {
+        dispatch_group_enter(group);
+        NSThread *thread = [[NSThread alloc] initWithBlock:^{
+            // Each thread works through connections one at a time, like a session tying up its thread for the life of a connection.
+            while (atomic_fetch_add(nextConnectionIndexPointer, 1) < connectionCount) {
+                NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+                @try {
+                    ONTCPSocket *socket = [ONTCPSocket tcpSocket];
+                    ONSocketStream *socketStream = [ONSocketStream streamWithSocket:socket];
+                    [socket connectToAddress:[ONHostAddress loopbackAddress] port:port];
+
+                    for (NSUInteger requestIndex = 0; requestIndex < OWHTTPEventEngineBenchmarkRequestsPerConnection; requestIndex++) {
+                        [socketStream writeData:requestData];
+                        (void)[socketStream readLine]; // Status line
+                        OWHeaderDictionary *headers = [[OWHeaderDictionary alloc] init];
+                        [headers readRFC822HeadersFromSocketStream:socketStream];
+                        NSUInteger bytesLeft = [[headers lastStringForKey:@"content-length"] intValue];
+                        [headers release];
+
+                        OWDataStream *dataStream = [[OWDataStream alloc] initWithLength:bytesLeft];
+                        while (bytesLeft != 0) {
+                            void *buffer;
+                            NSUInteger capacity = MIN([dataStream appendToUnderlyingBuffer:&buffer], bytesLeft);
+                            NSUInteger count = [socketStream readBytesWithMaxLength:capacity intoBuffer:buffer];
+                            if (count == 0)
+                                break;
+                            [dataStream wroteBytesToUnderlyingBuffer:count];
+                            bytesLeft -= count;
+                            atomic_fetch_add(bodyBytesReadPointer, count);
+                        }
+                        [dataStream dataEnd];
+                        [dataStream release];
+                    }
+                } @catch (NSException *exception) {
+                    atomic_fetch_add(failureCountPointer, 1);
+                }
+                [pool release];
+            }
+            dispatch_group_leave(group);
+        }];
+        [thread start];
+        [thread release];
+    }
+
+    // No timeout here: a stalled socket read fails on its own, and returning early would leave the threads writing through dangling pointers.
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+    dispatch_release(group);
+
+    _logTiming([NSString stringWithFormat:@"blocking (%lu threads)", OWHTTPEventEngineBenchmarkBlockingThreadCount], connectionCount, connectionCount * OWHTTPEventEngineBenchmarkRequestsPerConnection, atomic_load(&bodyBytesRead), atomic_load(&failureCount), elapsed);
+
+    [server stop];
+    [server release];
+}
+
+- (void)testEngine1kConnections;
+{
+    [self _benchmarkEngineWithConnectionCount:1000 pipelineDepth:1];
+}
+
+- (void)testEngine1kConnectionsPipelined;
+{
+    [self _benchmarkEngineWithConnectionCount:1000 pipelineDepth:4];
+}
+
+- (void)testEngine4kConnections;
+{
+    [self _benchmarkEngineWithConnectionCount:4000 pipelineDepth:1];
+}
+
+- (void)testBlocking1kConnections;
+{
+    [self _benchmarkBlockingWithConnectionCount:1000];
+}
+
+- (void)testBlocking4kConnections;
+{
+    [self _benchmarkBlockingWithConnectionCount:4000];
+}
+
+@end
@@ -0,0 +1,491 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OWF/OWDataStream.h>
+#import <OWF/OWHeaderDictionary.h>
+#import <OWF/OWHTTPEventEngine.h>
+#import <OmniNetworking/OmniNetworking.h>
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#import <OmniBase/rcsid.h>
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+RCS_ID("$Id$");
+
+// Tests OWHTTPEventEngine's response parser against a server on the loopback interface that sends canned responses in two writes. Each response is sent once for every place it can be split, so every parser state sees its input end at every possible byte. The server pauses between the writes so that the engine almost always reads the two parts separately.
+
+#ifdef MSG_NOSIGNAL
+#define TEST_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define TEST_SEND_FLAGS 0
+#endif
+
+static const useconds_t OWHTTPEventEngineTestSplitPause = 2000;
+static const NSTimeInterval OWHTTPEventEngineTestTimeout = 10.0;
+
+#pragma mark - Canned server
+
+@interface OWHTTPEventEngineTestServer : NSObject
+{
+    int listenFileDescriptor;
+    unsigned short port;
+}
+- (unsigned short)port;
+- (void)sendResponse:(NSData *)responseData splitAtOffset:(NSUInteger)splitOffset afterRequestCount:(NSUInteger)requestCount;
+    // Accepts the next connection, reads requestCount requests from it, sends the response in two parts and then closes its side.
+@end
+
+static void _sendAll(int fileDescriptor, const uint8_t *bytes, size_t length)
+{
+    while (length != 0) {
+        ssize_t written = send(fileDescriptor, bytes, length, TEST_SEND_FLAGS);
+        if (written == -1) {
+            if (errno == EINTR)
+                continue;
+            return; // The engine gave up on an oversized response
+        }
+        bytes += written;
+        length -= written;
+    }
+}
+
+@implementation OWHTTPEventEngineTestServer
+
+- (id)init;
+{
+    if (!(self = [super init]))
+        return nil;
+
+    listenFileDescriptor = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(listenFileDescriptor, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in address = {.sin_family = AF_INET, .sin_port = 0, .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+    bind(listenFileDescriptor, (struct sockaddr *)&address, sizeof(address));
+    listen(listenFileDescriptor, 16);
+    socklen_t addressLength = sizeof(address);
+    getsockname(listenFileDescriptor, (struct sockaddr *)&address, &addressLength);
+    port = ntohs(address.sin_port);
+
+    return self;
+}
+
+- (void)dealloc;
+{
+    close(listenFileDescriptor);
+    [super dealloc];
+}
+
+- (unsigned short)port;
+{
+    return port;
+}
+
+- (void)sendResponse:(NSData *)responseData splitAtOffset:(NSUInteger)splitOffset afterRequestCount:(NSUInteger)requestCount;
+{
+    int listenDescriptor = listenFileDescriptor;
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        struct pollfd pollDescriptor = {.fd = listenDescriptor, .events = POLLIN};
+        if (poll(&pollDescriptor, 1, (int)(OWHTTPEventEngineTestTimeout * 1000)) != 1)
+            return;
+        int fileDescriptor = accept(listenDescriptor, NULL, NULL);
+        if (fileDescriptor == -1)
+            return;
+
+        int on = 1;
+        setsockopt(fileDescriptor, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+#ifdef SO_NOSIGPIPE
+        setsockopt(fileDescriptor, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        struct timeval timeout = {.tv_sec = (time_t)OWHTTPEventEngineTestTimeout};
+        setsockopt(fileDescriptor, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        // The requests are all the same, and all we need from them is where each one ends
+        static const char terminator[] = "\r\n\r\n";
+        NSUInteger requestsRead = 0, matchedTerminatorLength = 0;
+        while (requestsRead < requestCount) {
+            uint8_t buffer[1024];
+            ssize_t count = recv(fileDescriptor, buffer, sizeof(buffer), 0);
+            if (count <= 0)
+                break;
+            for (ssize_t byteIndex = 0; byteIndex < count; byteIndex++) {
+                if (buffer[byteIndex] == terminator[matchedTerminatorLength])
+                    matchedTerminatorLength++;
+                else
+                    matchedTerminatorLength = (buffer[byteIndex] == '\r') ? 1 : 0;
+                if (matchedTerminatorLength == 4) {
+                    matchedTerminatorLength = 0;
+                    requestsRead++;
+                }
+            }
+        }
+
+        const uint8_t *bytes = [responseData bytes];
+        NSUInteger length = [responseData length];
+        _sendAll(fileDescriptor, bytes, splitOffset);
+        if (splitOffset != 0 && splitOffset != length)
+            usleep(OWHTTPEventEngineTestSplitPause);
+        _sendAll(fileDescriptor, bytes + splitOffset, length - splitOffset);
+        shutdown(fileDescriptor, SHUT_WR);
+
+        // Wait for the engine to close its end, so that it sees our end of file rather than a reset
+        uint8_t drain[1024];
+        while (recv(fileDescriptor, drain, sizeof(drain), 0) > 0)
+            ;
+        close(fileDescriptor);
+    });
+}
+
+@end
+
+#pragma mark - Recording delegate
+
+// Describes each delegate callback as a string, in order. The connection is done once it fails, which it always does once the server closes its side.
+@interface OWHTTPEventEngineTestRecorder : NSObject <OWHTTPEngineConnectionDelegate>
+{
+@public
+    NSMutableArray *events;
+    NSMutableArray *finishedResponses;
+    OWDataStream *bodyStream;
+    dispatch_semaphore_t failed;
+}
+@end
+
+static NSString *_errorName(NSInteger errorNumber)
+{
+    switch (errorNumber) {
+        case ECONNRESET:
+            return @"ECONNRESET";
+        case EMSGSIZE:
+            return @"EMSGSIZE";
+        case EPROTO:
+            return @"EPROTO";
+        case ECANCELED:
+            return @"ECANCELED";
+        default:
+            return [NSString stringWithFormat:@"errno %ld", errorNumber];
+    }
+}
+
+@implementation OWHTTPEventEngineTestRecorder
+
+- (id)init;
+{
+    if (!(self = [super init]))
+        return nil;
+
+    events = [[NSMutableArray alloc] init];
+    finishedResponses = [[NSMutableArray alloc] init];
+    failed = dispatch_semaphore_create(0);
+
+    return self;
+}
+
+- (void)dealloc;
+{
+    [events release];
+    [finishedResponses release];
+    [bodyStream release];
+    dispatch_release(failed);
+    [super dealloc];
+}
+
+- (OWDataStream *)engineConnection:(OWHTTPEngineConnection *)connection streamForResponse:(OWHTTPEngineResponse *)response;
+{
+    if ([response isHTTP09])
+        [events addObject:@"response HTTP/0.9"];
+    else
+        [events addObject:[NSString stringWithFormat:@"response %ld %@", [response statusCode], [response reasonPhrase]]];
+
+    [bodyStream release];
+    bodyStream = [[OWDataStream alloc] init];
+    return bodyStream;
+}
+
+- (void)engineConnection:(OWHTTPEngineConnection *)connection response:(OWHTTPEngineResponse *)response didReadBodyBytes:(NSUInteger)totalBodyBytes;
+{
+}
+
+- (void)engineConnection:(OWHTTPEngineConnection *)connection didFinishResponse:(OWHTTPEngineResponse *)response;
+{
+    [bodyStream dataEnd];
+    NSString *body = [[NSString alloc] initWithData:[bodyStream bufferedData] encoding:NSISOLatin1StringEncoding];
+    [events addObject:[NSString stringWithFormat:@"finish %ld \"%@\"", [response statusCode], body]];
+    [body release];
+
+    [finishedResponses addObject:response];
+    [bodyStream release];
+    bodyStream = nil;
+}
+
+- (void)engineConnection:(OWHTTPEngineConnection *)connection didFailWithError:(NSError *)error duringResponse:(OWHTTPEngineResponse *)response;
+{
+    if (response != nil)
+        [events addObject:[NSString stringWithFormat:@"fail %@ during %ld", _errorName([error code]), [response statusCode]]];
+    else
+        [events addObject:[NSString stringWithFormat:@"fail %@", _errorName([error code])]];
+    dispatch_semaphore_signal(failed);
+}
+
+@end
+
+#pragma mark - Tests
+
+@interface OWHTTPEventEngineTests : XCTestCase
+{
+    OWHTTPEventEngineTestServer *server;
+}
+@end
+
+@implementation OWHTTPEventEngineTests
+
+static OWHTTPEventEngine *testEngine = nil;
+
++ (void)setUp;
+{
+    [super setUp];
+
+    // Engine threads live for the life of the process, so every test shares one engine.
+    if (testEngine == nil)
+        testEngine = [[OWHTTPEventEngine alloc] initWithThreadCount:1];
+}
+
+- (void)setUp;
+{
+    server = [[OWHTTPEventEngineTestServer alloc] init];
+}
+
+- (void)tearDown;
+{
+    [server release];
+    server = nil;
+}
+
+static NSData *_data(NSString *string)
+{
+    return [string dataUsingEncoding:NSISOLatin1StringEncoding];
+}
+
+static NSString *_repeated(NSString *string, NSUInteger count)
+{
+    return [@"" stringByPaddingToLength:[string length] * count withString:string startingAtIndex:0];
+}
+
+// Makes one request for each flag (NO for a HEAD request) and records what happens to their responses, which the server sends in one go, split at splitOffset.
+- (NSArray *)_eventsForResponse:(NSData *)responseData splitAtOffset:(NSUInteger)splitOffset requestsExpectingBody:(NSArray *)expectsBodyFlags finishedResponses:(NSArray **)outFinishedResponses;
+{
+    NSData *requestData = _data(@"GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    ONHost *host = [ONHost hostForAddress:[ONHostAddress loopbackAddress]];
+    OWHTTPEventEngineTestRecorder *recorder = [[[OWHTTPEventEngineTestRecorder alloc] init] autorelease];
+    dispatch_queue_t delegateQueue = dispatch_queue_create("com.omnigroup.OWF.OWHTTPEventEngineTests", DISPATCH_QUEUE_SERIAL);
+
+    [server sendResponse:responseData splitAtOffset:splitOffset afterRequestCount:[expectsBodyFlags count]];
+
+    __block OWHTTPEngineConnection *connection = nil;
+    dispatch_sync(delegateQueue, ^{
+        connection = [[testEngine connectionToHost:host port:[server port] delegate:recorder delegateQueue:delegateQueue] retain];
+        for (NSNumber *expectsBody in expectsBodyFlags)
+            [connection enqueueRequestData:requestData expectsBody:[expectsBody boolValue] context:nil];
+    });
+
+    long timedOut = dispatch_semaphore_wait(recorder->failed, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(OWHTTPEventEngineTestTimeout * NSEC_PER_SEC)));
+    if (timedOut) {
+        [connection abort];
+        dispatch_semaphore_wait(recorder->failed, DISPATCH_TIME_FOREVER);
+    }
+    [connection release];
+
+    // The failure is the last callback, so this just waits for it to return
+    __block NSArray *events, *finishedResponses;
+    dispatch_sync(delegateQueue, ^{
+        events = [recorder->events copy];
+        finishedResponses = [recorder->finishedResponses copy];
+    });
+    dispatch_release(delegateQueue);
+    [events autorelease];
+    [finishedResponses autorelease];
+
+    if (outFinishedResponses != NULL)
+        *outFinishedResponses = finishedResponses;
+    return events;
+}
+
+- (void)_assertEvents:(NSArray *)expectedEvents forResponse:(NSString *)responseString requestsExpectingBody:(NSArray *)expectsBodyFlags splitOffsets:(NSArray *)splitOffsets;
+{
+    NSData *responseData = _data(responseString);
+    NSUInteger length = [responseData length];
+
+    if (splitOffsets == nil) {
+        NSMutableArray *everyOffset = [NSMutableArray array];
+        for (NSUInteger splitOffset = 1; splitOffset <= length; splitOffset++)
+            [everyOffset addObject:[NSNumber numberWithUnsignedInteger:splitOffset]];
+        splitOffsets = everyOffset;
+    }
+
+    for (NSNumber *splitOffset in splitOffsets) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        NSArray *events = [self _eventsForResponse:responseData splitAtOffset:[splitOffset unsignedIntegerValue] requestsExpectingBody:expectsBodyFlags finishedResponses:NULL];
+        XCTAssertEqualObjects(events, expectedEvents, @"Split at offset %@ of %lu", splitOffset, length);
+        [pool release];
+    }
+}
+
+- (void)_assertEvents:(NSArray *)expectedEvents forResponse:(NSString *)responseString;
+{
+    [self _assertEvents:expectedEvents forResponse:responseString requestsExpectingBody:@[@YES] splitOffsets:nil];
+}
+
+#pragma mark - Framing
+
+- (void)testContentLengthBody;
+{
+    [self _assertEvents:@[@"response 200 OK", @"finish 200 \"Hello world\"", @"fail ECONNRESET"]
+            forResponse:@"HTTP/1.1 200 OK\r\nContent-Length: 11\r\n\r\nHello world"];
+}
+
+- (void)testContentLengthEndsTheBody;
+{
+    // Whatever follows the body is the start of another response, and nothing asked for one
+    [self _assertEvents:@[@"response 200 OK", @"finish 200 \"Hello\"", @"fail EPROTO"]
+            forResponse:@"HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nHello world"];
+}
+
+- (void)testCloseDelimitedBody;
+{
+    // Without a length the body runs to the end of the connection, which can't be reused afterwards
+    [self _assertEvents:@[@"response 200 OK", @"finish 200 \"Hello world\"", @"fail ECONNRESET"]
+            forResponse:@"HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n\r\nHello world"];
+}
+
+- (void)testConnectionCloseDropsPipelinedRequests;
+{
+    [self _assertEvents:@[@"response 200 OK", @"finish 200 \"one\"", @"fail ECONNRESET"]
+            forResponse:@"HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 3\r\n\r\noneHTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\ntwo"
+  requestsExpectingBody:@[@YES, @YES] splitOffsets:nil];
+}
+
+- (void)testPipelinedResponses;
+{
+    [self _assertEvents:@[@"response 200 OK", @"finish 200 \"one\"", @"response 404 Not Found", @"finish 404 \"two\"", @"fail ECONNRESET"]
+            forResponse:@"HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\noneHTTP/1.1 404 Not Found\r\nContent-Length: 3\r\n\r\ntwo"
+  requestsExpectingBody:@[@YES, @YES] splitOffsets:nil];
+}
+
+- (void)testResponsesWithoutBodies;
+{
+    // A HEAD response's Content-Length describes the body a GET would have had; 204 and 304 responses never have one
+    [self _assertEvents:@[@"response 200 OK", @"finish 200 \"\"", @"response 204 No Content", @"finish 204 \"\"", @"response 304 Not Modified", @"finish 304 \"\"", @"fail ECONNRESET"]
+            forResponse:@"HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nHTTP/1.1 204 No Content\r\n\r\nHTTP/1.1 304 Not Modified\r\nContent-Length: 5\r\n\r\n"
+  requestsExpectingBody:@[@NO, @YES, @YES] splitOffsets:nil];
+}
+
+#pragma mark - Chunked bodies
+
+- (void)testChunkedBodyWithTrailers;
+{
+    NSData *responseData = _data(@"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nHello\r\n6;name=value\r\n world\r\n0\r\nX-Checksum: abc\r\nX-Other: def\r\n\r\n");
+    NSArray *expectedEvents = @[@"response 200 OK", @"finish 200 \"Hello world\"", @"fail ECONNRESET"];
+
+    for (NSUInteger splitOffset = 1; splitOffset <= [responseData length]; splitOffset++) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        NSArray *finishedResponses;
+        NSArray *events = [self _eventsForResponse:responseData splitAtOffset:splitOffset requestsExpectingBody:@[@YES] finishedResponses:&finishedResponses];
+        XCTAssertEqualObjects(events, expectedEvents, @"Split at offset %lu", splitOffset);
+
+        OWHTTPEngineResponse *response = [finishedResponses lastObject];
+        XCTAssertTrue([response isChunked]);
+        XCTAssertEqual([response bodyBytesRead], 11ULL);
+        XCTAssertEqualObjects([[response trailers] lastStringForKey:@"x-checksum"], @"abc", @"Split at offset %lu", splitOffset);
+        XCTAssertEqualObjects([[response trailers] lastStringForKey:@"x-other"], @"def", @"Split at offset %lu", splitOffset);
+        XCTAssertNil([[response headers] lastStringForKey:@"x-checksum"]);
+        [pool release];
+    }
+}
+
+- (void)testChunkedTakesPrecedenceOverContentLength;
+{
+    [self _assertEvents:@[@"response 200 OK", @"finish 200 \"0123456789\"", @"fail ECONNRESET"]
+            forResponse:@"HTTP/1.1 200 OK\r\nContent-Length: 2\r\nTransfer-Encoding: chunked\r\n\r\nA\r\n0123456789\r\n0\r\n\r\n"];
+}
+
+- (void)testChunkedHeaderWithoutChunks;
+{
+    // Some servers say chunked and then send a plain body, which is read up to the end of the connection instead
+    [self _assertEvents:@[@"response 200 OK", @"finish 200 \"<html>hi</html>\n\"", @"fail ECONNRESET"]
+            forResponse:@"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n<html>hi</html>\n"];
+}
+
+- (void)testOversizedChunkSize;
+{
+    // 2^64 doesn't fit, and mustn't wrap around to a small chunk
+    [self _assertEvents:@[@"response 200 OK", @"fail EMSGSIZE during 200"]
+            forResponse:@"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n10000000000000000\r\nHello\r\n0\r\n\r\n"];
+}
+
+- (void)testOversizedChunkSizeLine;
+{
+    NSString *response = [NSString stringWithFormat:@"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5;%@", _repeated(@"x", 70 * 1024)];
+    [self _assertEvents:@[@"response 200 OK", @"fail EMSGSIZE during 200"] forResponse:response requestsExpectingBody:@[@YES] splitOffsets:@[@1, @50, @([response length])]];
+}
+
+#pragma mark - Status lines and headers
+
+- (void)testInterimResponsesAreSkipped;
+{
+    [self _assertEvents:@[@"response 200 OK", @"finish 200 \"ok\"", @"fail ECONNRESET"]
+            forResponse:@"HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 103 Early Hints\r\nLink: </style.css>; rel=preload\r\n\r\nHTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok"];
+}
+
+- (void)testBlankLinesBeforeStatusLine;
+{
+    [self _assertEvents:@[@"response 200 OK", @"finish 200 \"ok\"", @"fail ECONNRESET"]
+            forResponse:@"\r\n\r\nHTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok"];
+}
+
+- (void)testStatusLineWithoutStatusCode;
+{
+    // Read as leniently as the blocking session reads it
+    [self _assertEvents:@[@"response 0 abc", @"finish 0 \"ok\"", @"fail ECONNRESET"]
+            forResponse:@"HTTP/1.1 abc\r\nContent-Length: 2\r\n\r\nok"];
+}
+
+- (void)testNoStatusLineIsHTTP09;
+{
+    // Starts with the same letter as a status line, so the engine has to wait for more to tell
+    [self _assertEvents:@[@"response HTTP/0.9", @"finish 0 \"Hello from 1991\n\"", @"fail ECONNRESET"]
+            forResponse:@"Hello from 1991\n"];
+}
+
+- (void)testOversizedStatusLine;
+{
+    NSString *response = [NSString stringWithFormat:@"HTTP/1.1 200 %@", _repeated(@"x", 70 * 1024)];
+    [self _assertEvents:@[@"fail EMSGSIZE during 0"] forResponse:response requestsExpectingBody:@[@YES] splitOffsets:@[@1, @13, @([response length])]];
+}
+
+- (void)testOversizedHeaders;
+{
+    NSString *response = [NSString stringWithFormat:@"HTTP/1.1 200 OK\r\nX-Padding: %@\r\n\r\nok", _repeated(@"a", 70 * 1024)];
+    [self _assertEvents:@[@"fail EMSGSIZE during 200"] forResponse:response requestsExpectingBody:@[@YES] splitOffsets:@[@1, @17, @30, @([response length])]];
+
+    // Many lines add up the same way
+    response = [NSString stringWithFormat:@"HTTP/1.1 200 OK\r\n%@\r\nok", _repeated(@"X-Padding: aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa\r\n", 2 * 1024)];
+    [self _assertEvents:@[@"fail EMSGSIZE during 200"] forResponse:response requestsExpectingBody:@[@YES] splitOffsets:@[@1, @17, @([response length])]];
+}
+
+- (void)testBareLinefeedLineEndings;
+{
+    [self _assertEvents:@[@"response 200 OK", @"finish 200 \"ok\"", @"fail ECONNRESET"]
+            forResponse:@"HTTP/1.1 200 OK\nContent-Length: 2\n\nok"];
+}
+
+@end
@@ -0,0 +1,156 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OWF/OWHeaderDictionary.h>
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#import <OmniBase/rcsid.h>
+
+RCS_ID("$Id$");
+
+// Times reading response header blocks like those recorded from a handful of real servers, asking each for the headers OWHTTPSession looks at on every response. Results are logged rather than asserted since they depend on the machine.
+
+@interface OWHeaderDictionaryBenchmarks : XCTestCase
+@end
+
+@implementation OWHeaderDictionaryBenchmarks
+
+static const NSUInteger OWHeaderDictionaryBenchmarkPasses = 20000;
+
+static const char * const RecordedHeaderBlocks[] = {
+    "Date: Mon, 05 Oct 2026 17:12:43 GMT\r\n"
+    "Server: Apache/2.4.58 (Unix)\r\n"
+    "Last-Modified: Tue, 29 Sep 2026 08:01:12 GMT\r\n"
+    "ETag: \"2d7a-5f3c9b1e8a4c0\"\r\n"
+    "Accept-Ranges: bytes\r\n"
+    "Content-Length: 11642\r\n"
+    "Cache-Control: max-age=600\r\n"
+    "Expires: Mon, 05 Oct 2026 17:22:43 GMT\r\n"
+    "Vary: Accept-Encoding,User-Agent\r\n"
+    "Keep-Alive: timeout=5, max=100\r\n"
+    "Connection: Keep-Alive\r\n"
+    "Content-Type: text/html; charset=UTF-8\r\n"
+    "\r\n",
+
+    "date: Mon, 05 Oct 2026 17:12:44 GMT\r\n"
+    "content-type: application/json; charset=utf-8\r\n"
+    "transfer-encoding: chunked\r\n"
+    "connection: keep-alive\r\n"
+    "set-cookie: session=8f14e45fceea167a5a36dedd4bea2543; Path=/; HttpOnly; Secure; SameSite=Lax\r\n"
+    "set-cookie: region=us-west; Path=/; Max-Age=31536000\r\n"
+    "x-request-id: 6c1f0d3a-43f2-4b1e-9a0e-0f3b2d4c5e6f\r\n"
+    "x-frame-options: SAMEORIGIN\r\n"
+    "x-content-type-options: nosniff\r\n"
+    "strict-transport-security: max-age=63072000; includeSubDomains; preload\r\n"
+    "cache-control: private, no-cache, no-store, must-revalidate\r\n"
+    "pragma: no-cache\r\n"
+    "vary: Accept-Encoding\r\n"
+    "content-encoding: gzip\r\n"
+    "\r\n",
+
+    "Server: nginx\r\n"
+    "Date: Mon, 05 Oct 2026 17:12:44 GMT\r\n"
+    "Content-Type: image/jpeg\r\n"
+    "Content-Length: 48213\r\n"
+    "Last-Modified: Fri, 14 Aug 2026 22:40:05 GMT\r\n"
+    "Connection: keep-alive\r\n"
+    "ETag: \"5f37127d-bc55\"\r\n"
+    "Expires: Thu, 05 Nov 2026 17:12:44 GMT\r\n"
+    "Cache-Control: max-age=2592000\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "Age: 3171\r\n"
+    "Via: 1.1 varnish\r\n"
+    "X-Cache: HIT, HIT\r\n"
+    "X-Served-By: cache-sjc10036-SJC, cache-pao17420-PAO\r\n"
+    "\r\n",
+
+    "Location: http://www.omnigroup.com/products/omniweb/\r\n"
+    "Content-Type: text/html;\r\n"
+    "\tcharset=iso-8859-1\r\n"
+    "Content-Length: 241\r\n"
+    "Date: Mon, 05 Oct 2026 17:12:45 GMT\r\n"
+    "Server: Microsoft-IIS/10.0\r\n"
+    "X-Powered-By: ASP.NET\r\n"
+    "P3P: CP=\"NOI DSP COR NID\"\r\n"
+    "\r\n",
+};
+
+static NSUInteger _headerCount(void)
+{
+    NSUInteger headerCount = 0;
+    for (NSUInteger blockIndex = 0; blockIndex < sizeof(RecordedHeaderBlocks) / sizeof(*RecordedHeaderBlocks); blockIndex++) {
+        OWHeaderDictionary *headers = [[OWHeaderDictionary alloc] init];
+        [headers readRFC822HeadersFromString:[NSString stringWithCString:RecordedHeaderBlocks[blockIndex] encoding:NSISOLatin1StringEncoding]];
+        for (NSString *key in [headers keyEnumerator])
+            headerCount += [[headers stringArrayForKey:key] count];
+        [headers release];
+    }
+    return headerCount;
+}
+
+static NSUInteger _lookUpCommonHeaders(OWHeaderDictionary *headers)
+{
+    NSUInteger found = 0;
+    found += [headers lastStringForKey:@"content-type"] != nil;
+    found += [headers lastStringForKey:@"content-length"] != nil;
+    found += [headers lastStringForKey:@"transfer-encoding"] != nil;
+    found += [headers lastStringForKey:@"connection"] != nil;
+    found += [headers lastStringForKey:@"content-encoding"] != nil;
+    found += [[headers stringArrayForKey:@"set-cookie"] count];
+    return found;
+}
+
+- (void)testLineAtATime;
+{
+    NSUInteger blockCount = sizeof(RecordedHeaderBlocks) / sizeof(*RecordedHeaderBlocks);
+    NSMutableArray *blockStrings = [NSMutableArray array];
+    for (NSUInteger blockIndex = 0; blockIndex < blockCount; blockIndex++)
+        [blockStrings addObject:[NSString stringWithCString:RecordedHeaderBlocks[blockIndex] encoding:NSISOLatin1StringEncoding]];
+    NSUInteger found = 0;
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger pass = 0; pass < OWHeaderDictionaryBenchmarkPasses; pass++) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        for (NSString *blockString in blockStrings) {
+            OWHeaderDictionary *headers = [[OWHeaderDictionary alloc] init];
+            [headers readRFC822HeadersFromString:blockString];
+            found += _lookUpCommonHeaders(headers);
+            [headers release];
+        }
+        [pool release];
+    }
+    CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+    NSUInteger headerCount = _headerCount() * OWHeaderDictionaryBenchmarkPasses;
+    NSLog(@"Read %lu headers a line at a time in %.3fs (%.0f headers/s, %lu found)", headerCount, elapsed, elapsed > 0 ? headerCount / elapsed : 0.0, found);
+}
+
+- (void)testHeaderBlocks;
+{
+    NSUInteger blockCount = sizeof(RecordedHeaderBlocks) / sizeof(*RecordedHeaderBlocks);
+    NSUInteger found = 0;
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger pass = 0; pass < OWHeaderDictionaryBenchmarkPasses; pass++) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        for (NSUInteger blockIndex = 0; blockIndex < blockCount; blockIndex++) {
+            const char *block = RecordedHeaderBlocks[blockIndex];
+            BOOL complete;
+            NSUInteger blockLength = OWHeaderBlockLength(block, strlen(block), NO, &complete);
+            OWHeaderDictionary *headers = [[OWHeaderDictionary alloc] init];
+            [headers readRFC822HeaderBytes:block length:blockLength encoding:kCFStringEncodingISOLatin1];
+            found += _lookUpCommonHeaders(headers);
+            [headers release];
+        }
+        [pool release];
+    }
+    CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+    NSUInteger headerCount = _headerCount() * OWHeaderDictionaryBenchmarkPasses;
+    NSLog(@"Read %lu headers as blocks in %.3fs (%.0f headers/s, %lu found)", headerCount, elapsed, elapsed > 0 ? headerCount / elapsed : 0.0, found);
+}
+
+@end
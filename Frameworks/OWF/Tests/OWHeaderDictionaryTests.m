@@ -6,6 +6,7 @@
 // <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
 
 #import <OWF/OWHeaderDictionary.h>
+#import <OWF/OWParameterizedContentType.h>
 
 #import <Foundation/Foundation.h>
 #import <OmniFoundation/OFMultiValueDictionary.h>
@@ -23,6 +24,13 @@ RCS_ID("$Id$");
 
 @implementation OWHeaderDictionaryTests
 
+static OWHeaderDictionary *_headersFromBlock(const char *block)
+{
+    OWHeaderDictionary *headers = [[[OWHeaderDictionary alloc] init] autorelease];
+    [headers readRFC822HeaderBytes:block length:strlen(block) encoding:kCFStringEncodingISOLatin1];
+    return headers;
+}
+
 - (void)testParameterizedValueParsing
 {
     NSEnumerator *ee;
@@ -122,6 +130,111 @@ RCS_ID("$Id$");
     XCTAssertTrue([s isAtEnd]);
 }
 
+- (void)testHeaderBlockLength
+{
+    BOOL complete;
+
+    XCTAssertEqual(OWHeaderBlockLength("A: b\r\nC: d\r\n\r\nbody", 18, NO, &complete), 14UL);
+    XCTAssertTrue(complete);
+    XCTAssertEqual(OWHeaderBlockLength("A: b\nC: d\n\nbody", 15, NO, &complete), 11UL);
+    XCTAssertTrue(complete);
+    XCTAssertEqual(OWHeaderBlockLength("A: b\r\r\n\r\r\nbody", 14, NO, &complete), 10UL);
+    XCTAssertTrue(complete);
+    XCTAssertEqual(OWHeaderBlockLength("A: b\rC: d\r\rbody", 15, NO, &complete), 11UL);
+    XCTAssertTrue(complete);
+    XCTAssertEqual(OWHeaderBlockLength("A: b\r\n.\r\nbody", 13, NO, &complete), 9UL);
+    XCTAssertTrue(complete);
+
+    // A CR at the end might be the start of a CRLF or CRCRLF.
+    XCTAssertEqual(OWHeaderBlockLength("A: b\r\n\r", 7, NO, &complete), 0UL);
+    XCTAssertFalse(complete);
+    XCTAssertEqual(OWHeaderBlockLength("A: b\r\n\r\r", 8, NO, &complete), 0UL);
+    XCTAssertFalse(complete);
+    XCTAssertEqual(OWHeaderBlockLength("A: b\r\nC: d", 10, NO, &complete), 0UL);
+    XCTAssertFalse(complete);
+    XCTAssertEqual(OWHeaderBlockLength("A: b\r\nC: d", 10, YES, &complete), 10UL);
+    XCTAssertTrue(complete);
+}
+
+- (void)testHeaderBlockParsing
+{
+    OWHeaderDictionary *headers = _headersFromBlock("Content-Type: text/html; charset=utf-8\r\n"
+                                                    "content-length:   1234  \r\n"
+                                                    "Set-Cookie: a=1\r\n"
+                                                    "X-Folded: one\r\n"
+                                                    "\ttwo\r\n"
+                                                    "  three\r\n"
+                                                    "No colon here\r\n"
+                                                    "SET-COOKIE: b=2\r\n"
+                                                    "X-Empty:\r\n"
+                                                    "\r\n"
+                                                    "Not: a header\r\n");
+
+    XCTAssertEqualObjects([headers lastStringForKey:@"Content-Type"], @"text/html; charset=utf-8");
+    XCTAssertEqualObjects([headers lastStringForKey:@"Content-Length"], @"1234");
+    XCTAssertEqualObjects([headers stringArrayForKey:@"set-cookie"], ([NSArray arrayWithObjects:@"a=1", @"b=2", nil]));
+    XCTAssertEqualObjects([headers firstStringForKey:@"Set-Cookie"], @"a=1");
+    XCTAssertEqualObjects([headers lastStringForKey:@"Set-Cookie"], @"b=2");
+    XCTAssertEqualObjects([headers lastStringForKey:@"x-folded"], @"one\ttwo  three");
+    XCTAssertEqualObjects([headers lastStringForKey:@"X-Empty"], @"");
+    XCTAssertNil([headers lastStringForKey:@"No colon here"]);
+    XCTAssertNil([headers lastStringForKey:@"Not"]);
+    XCTAssertNil([headers stringArrayForKey:@"Missing"]);
+    XCTAssertEqualObjects([[headers parameterizedContentType] objectForKey:@"charset"], @"utf-8");
+
+    // Everything moves into the dictionary once something needs to see all of it.
+    NSArray *keys = [[[headers keyEnumerator] allObjects] sortedArrayUsingSelector:@selector(caseInsensitiveCompare:)];
+    XCTAssertEqual([keys count], 5UL);
+    XCTAssertEqualObjects([headers stringArrayForKey:@"Set-Cookie"], ([NSArray arrayWithObjects:@"a=1", @"b=2", nil]));
+    XCTAssertEqualObjects([headers lastStringForKey:@"x-folded"], @"one\ttwo  three");
+}
+
+- (void)testHeaderBlockInternsWellKnownKeys
+{
+    OWHeaderDictionary *first = _headersFromBlock("content-type: text/plain\nX-Custom: 1\n\n");
+    OWHeaderDictionary *second = _headersFromBlock("CONTENT-TYPE: text/html\nX-Custom: 2\n\n");
+
+    NSString *firstKey = nil, *secondKey = nil;
+    for (NSString *key in [first keyEnumerator])
+        if ([key caseInsensitiveCompare:@"content-type"] == NSOrderedSame)
+            firstKey = key;
+    for (NSString *key in [second keyEnumerator])
+        if ([key caseInsensitiveCompare:@"content-type"] == NSOrderedSame)
+            secondKey = key;
+    XCTAssertEqualObjects(firstKey, @"Content-Type");
+    XCTAssertTrue(firstKey == secondKey);
+    XCTAssertEqualObjects([second lastStringForKey:@"x-custom"], @"2");
+}
+
+- (void)testHeaderBlockAddedToExistingHeaders
+{
+    OWHeaderDictionary *headers = [[[OWHeaderDictionary alloc] init] autorelease];
+    [headers addString:@"text/plain" forKey:@"Content-Type"];
+    XCTAssertEqualObjects([[headers parameterizedContentType] contentTypeString], @"text/plain");
+
+    const char *block = "Content-Type: text/html\r\nWarning: 110\r\n\r\n";
+    [headers readRFC822HeaderBytes:block length:strlen(block) encoding:kCFStringEncodingISOLatin1];
+    XCTAssertEqualObjects([headers stringArrayForKey:@"content-type"], ([NSArray arrayWithObjects:@"text/plain", @"text/html", nil]));
+    XCTAssertEqualObjects([[headers parameterizedContentType] contentTypeString], @"text/html");
+
+    block = "Warning: 199\r\n\r\n";
+    [headers readRFC822HeaderBytes:block length:strlen(block) encoding:kCFStringEncodingISOLatin1];
+    XCTAssertEqualObjects([headers stringArrayForKey:@"Warning"], ([NSArray arrayWithObjects:@"110", @"199", nil]));
+}
+
+- (void)testHeaderBlockEncoding
+{
+    // Latin-1 no-break spaces are trimmed like any other whitespace, and bytes that aren't valid in the stream's encoding fall back to Latin-1.
+    const char *block = "X-Latin: \xa0caf\xe9\xa0\r\nX-Bad: \xff\r\n\r\n";
+    OWHeaderDictionary *headers = [[[OWHeaderDictionary alloc] init] autorelease];
+    [headers readRFC822HeaderBytes:block length:strlen(block) encoding:kCFStringEncodingISOLatin1];
+    XCTAssertEqualObjects([headers lastStringForKey:@"X-Latin"], @"caf\u00e9");
+
+    headers = [[[OWHeaderDictionary alloc] init] autorelease];
+    [headers readRFC822HeaderBytes:block length:strlen(block) encoding:kCFStringEncodingUTF8];
+    XCTAssertEqualObjects([headers lastStringForKey:@"X-Bad"], @"\u00ff");
+}
+
 - (void)testHeaderSplitting
 {
     XCTAssertEqualObjects([OWHeaderDictionary splitHeaderValues:[NSArray array]], [NSArray array]);
@@ -0,0 +1,135 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OWF/OWAddress.h>
+#import <OWF/OWContent.h>
+#import <OWF/OWMemoryCache.h>
+#import <OWF/OWStaticArc.h>
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#import <OmniBase/rcsid.h>
+
+RCS_ID("$Id$");
+
+// Times subject, source and object lookups in a warm memory cache of various sizes, both from one thread and from several at once. Results are logged rather than asserted since they depend on the machine.
+
+@interface OWMemoryCacheBenchmarks : XCTestCase
+@end
+
+@implementation OWMemoryCacheBenchmarks
+
+static const NSUInteger OWMemoryCacheBenchmarkLookupCount = 10000;
+
+static OWContent *_subjectContent(NSUInteger arcIndex)
+{
+    return [OWContent contentWithAddress:[OWAddress addressForString:[NSString stringWithFormat:@"http://host%lu.example.com/page/%lu", arcIndex % 997, arcIndex]]];
+}
+
+static OWContent *_objectContent(NSUInteger arcIndex)
+{
+    return [OWContent contentWithString:[NSString stringWithFormat:@"result %lu", arcIndex] contentType:@"text/plain" isSource:NO];
+}
+
+static void _logLookupTiming(NSString *relation, NSUInteger arcCount, NSUInteger lookupCount, CFAbsoluteTime elapsed)
+{
+    NSLog(@"%lu arcs, %@ lookup: %lu lookups in %.3fs (%.1f us/lookup)", arcCount, relation, lookupCount, elapsed, lookupCount ? elapsed * 1e6 / lookupCount : 0.0);
+}
+
+- (void)_benchmarkCacheWithArcCount:(NSUInteger)arcCount;
+{
+    OWMemoryCache *cache = [[OWMemoryCache alloc] init];
+    NSMutableArray *subjects = [[NSMutableArray alloc] initWithCapacity:arcCount];
+    NSMutableArray *objects = [[NSMutableArray alloc] initWithCapacity:arcCount];
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger arcIndex = 0; arcIndex < arcCount; arcIndex++) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+        OWStaticArcInitialization *arcProperties = [[OWStaticArcInitialization alloc] init];
+        arcProperties.subject = arcProperties.source = [cache storeContent:_subjectContent(arcIndex)];
+        arcProperties.object = [cache storeContent:_objectContent(arcIndex)];
+        arcProperties.creationDate = [NSDate date];
+        arcProperties.arcType = OWCacheArcRetrievedContent;
+
+        OWStaticArc *arc = [[OWStaticArc alloc] initWithArcInitializationProperties:arcProperties];
+        [cache addArc:arc];
+        [subjects addObject:arcProperties.subject];
+        [objects addObject:arcProperties.object];
+        [arc release];
+        [arcProperties release];
+
+        [pool release];
+    }
+    NSLog(@"%lu arcs: filled cache in %.3fs", arcCount, CFAbsoluteTimeGetCurrent() - start);
+
+    static const struct {
+        OWCacheArcRelationship relation;
+        NSString *name;
+    } lookups[] = {
+        {OWCacheArcSubject, @"subject"},
+        {OWCacheArcSource, @"source"},
+        {OWCacheArcObject, @"object"},
+        {OWCacheArcAnyRelation, @"any"},
+    };
+
+    for (NSUInteger lookupIndex = 0; lookupIndex < sizeof(lookups) / sizeof(*lookups); lookupIndex++) {
+        NSArray *keys = (lookups[lookupIndex].relation == OWCacheArcObject) ? objects : subjects;
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+        srandom(1);
+        start = CFAbsoluteTimeGetCurrent();
+        for (NSUInteger probe = 0; probe < OWMemoryCacheBenchmarkLookupCount; probe++) {
+            OWContent *key = [keys objectAtIndex:random() % arcCount];
+            NSArray *arcs = [cache arcsWithRelation:lookups[lookupIndex].relation toEntry:key inPipeline:nil];
+            XCTAssertTrue([arcs count] > 0);
+        }
+        _logLookupTiming(lookups[lookupIndex].name, arcCount, OWMemoryCacheBenchmarkLookupCount, CFAbsoluteTimeGetCurrent() - start);
+
+        [pool release];
+    }
+
+    // Concurrent object lookups, as several pipelines planning at once would do.
+    NSUInteger threadCount = MAX([[NSProcessInfo processInfo] activeProcessorCount], (NSUInteger)2);
+    start = CFAbsoluteTimeGetCurrent();
+    dispatch_apply(threadCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t threadIndex) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        unsigned int seed = (unsigned int)threadIndex;
+        for (NSUInteger probe = 0; probe < OWMemoryCacheBenchmarkLookupCount; probe++) {
+            OWContent *key = [objects objectAtIndex:rand_r(&seed) % arcCount];
+            [cache arcsWithRelation:OWCacheArcObject toEntry:key inPipeline:nil];
+        }
+        [pool release];
+    });
+    _logLookupTiming([NSString stringWithFormat:@"object (%lu threads)", threadCount], arcCount, threadCount * OWMemoryCacheBenchmarkLookupCount, CFAbsoluteTimeGetCurrent() - start);
+
+    [subjects release];
+    [objects release];
+    [cache release];
+}
+
+- (void)testLookups1k;
+{
+    [self _benchmarkCacheWithArcCount:1000];
+}
+
+- (void)testLookups10k;
+{
+    [self _benchmarkCacheWithArcCount:10000];
+}
+
+- (void)testLookups100k;
+{
+    [self _benchmarkCacheWithArcCount:100000];
+}
+
+- (void)testLookups1M;
+{
+    [self _benchmarkCacheWithArcCount:1000000];
+}
+
+@end
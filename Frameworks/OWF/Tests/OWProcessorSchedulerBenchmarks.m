@@ -0,0 +1,123 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OWF/OWProcessorScheduler.h>
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#import <OmniBase/rcsid.h>
+
+RCS_ID("$Id$");
+
+// Times how processor-like work scales with the number of workers, both when every job is compute-bound and when some wait on "the network" as an OWHTTPProcessor would, with and without extra workers while they wait. Also measures how long interactive work waits behind a backlog of background work. Results are logged rather than asserted since they depend on the machine.
+
+@interface OWProcessorSchedulerBenchmarks : XCTestCase
+@end
+
+@implementation OWProcessorSchedulerBenchmarks
+
+static const NSUInteger OWProcessorSchedulerBenchmarkJobCount = 4000;
+static const NSUInteger OWProcessorSchedulerBenchmarkHostCount = 20;
+static const NSUInteger OWProcessorSchedulerBenchmarkSpinIterations = 20000;
+static const useconds_t OWProcessorSchedulerBenchmarkWaitMicroseconds = 2000;
+
+static volatile NSUInteger spinSink;
+
+static void _spin(void)
+{
+    NSUInteger value = 0;
+    for (NSUInteger iteration = 0; iteration < OWProcessorSchedulerBenchmarkSpinIterations; iteration++)
+        value = value * 31 + iteration;
+    spinSink = value;
+}
+
+static void _waitForNetwork(void)
+{
+    OWProcessorSchedulerWillBlock();
+    usleep(OWProcessorSchedulerBenchmarkWaitMicroseconds);
+    OWProcessorSchedulerDidUnblock();
+}
+
+// Every waitingFraction'th job waits on the network before spinning; 0 means none do.
+static void _runJobs(NSUInteger workerCount, NSUInteger maximumWorkerCount, NSUInteger waitingFraction, NSString *title)
+{
+    OWProcessorScheduler *scheduler = [[OWProcessorScheduler alloc] initWithWorkerCount:workerCount maximumWorkerCount:maximumWorkerCount];
+    dispatch_group_t group = dispatch_group_create();
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger jobIndex = 0; jobIndex < OWProcessorSchedulerBenchmarkJobCount; jobIndex++) {
+        BOOL waits = waitingFraction != 0 && jobIndex % waitingFraction == 0;
+        NSString *host = [NSString stringWithFormat:@"host%lu.example.com", jobIndex % OWProcessorSchedulerBenchmarkHostCount];
+        dispatch_group_enter(group);
+        [scheduler scheduleWorkForClassName:waits ? @"Fetch" : @"Parse" host:host schedulingInfo:OFMessageQueueSchedulingInfoDefault blocksOnIO:NO block:^{
+            if (waits)
+                _waitForNetwork();
+            _spin();
+            dispatch_group_leave(group);
+        }];
+    }
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+
+    NSDictionary *parseStatistics = [[scheduler statisticsByClassName] objectForKey:@"Parse"];
+    NSUInteger parseCount = [[parseStatistics objectForKey:OWProcessorSchedulerRunCountKey] unsignedIntegerValue];
+    NSLog(@"%@, %lu workers (up to %lu): %lu jobs in %.3fs (%.0f jobs/s), average queue delay %.2fms", title, workerCount, maximumWorkerCount, OWProcessorSchedulerBenchmarkJobCount, elapsed, elapsed > 0 ? OWProcessorSchedulerBenchmarkJobCount / elapsed : 0.0, parseCount != 0 ? [[parseStatistics objectForKey:OWProcessorSchedulerQueueDelayKey] doubleValue] * 1000.0 / parseCount : 0.0);
+
+    [scheduler invalidate];
+    [scheduler release];
+    dispatch_release(group);
+}
+
+static const NSUInteger WorkerCounts[] = {1, 2, 4, 8, 16};
+
+- (void)testComputeBoundScaling;
+{
+    for (NSUInteger countIndex = 0; countIndex < sizeof(WorkerCounts) / sizeof(*WorkerCounts); countIndex++)
+        _runJobs(WorkerCounts[countIndex], WorkerCounts[countIndex], 0, @"Compute-bound");
+}
+
+- (void)testWaitingScalingFixed;
+{
+    for (NSUInteger countIndex = 0; countIndex < sizeof(WorkerCounts) / sizeof(*WorkerCounts); countIndex++)
+        _runJobs(WorkerCounts[countIndex], WorkerCounts[countIndex], 4, @"One in four waiting, fixed workers");
+}
+
+- (void)testWaitingScalingElastic;
+{
+    for (NSUInteger countIndex = 0; countIndex < sizeof(WorkerCounts) / sizeof(*WorkerCounts); countIndex++)
+        _runJobs(WorkerCounts[countIndex], 4 * WorkerCounts[countIndex], 4, @"One in four waiting, elastic workers");
+}
+
+- (void)testInteractiveDelayUnderBackgroundLoad;
+{
+    OWProcessorScheduler *scheduler = [[OWProcessorScheduler alloc] initWithWorkerCount:4 maximumWorkerCount:4];
+    dispatch_group_t group = dispatch_group_create();
+    OFMessageQueueSchedulingInfo backgroundInfo = OFMessageQueueSchedulingInfoDefault;
+    backgroundInfo.priority = OFLowPriority;
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger jobIndex = 0; jobIndex < OWProcessorSchedulerBenchmarkJobCount; jobIndex++) {
+        // A page being viewed asks for something every so often while a big prefetch is underway.
+        BOOL interactive = jobIndex % 40 == 0;
+        dispatch_group_enter(group);
+        [scheduler scheduleWorkForClassName:interactive ? @"Interactive" : @"Background" host:interactive ? @"www.example.com" : @"prefetch.example.com" schedulingInfo:interactive ? OFMessageQueueSchedulingInfoDefault : backgroundInfo blocksOnIO:NO block:^{
+            _spin();
+            dispatch_group_leave(group);
+        }];
+    }
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+
+    NSLog(@"%lu jobs with background load in %.3fs", OWProcessorSchedulerBenchmarkJobCount, elapsed);
+    [scheduler logStatistics];
+
+    [scheduler invalidate];
+    [scheduler release];
+    dispatch_release(group);
+}
+
+@end
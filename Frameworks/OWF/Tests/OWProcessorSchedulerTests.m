@@ -0,0 +1,228 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OWF/OWProcessorScheduler.h>
+
+#import <Foundation/Foundation.h>
+#import <OmniBase/rcsid.h>
+#import <XCTest/XCTest.h>
+
+RCS_ID("$Id$");
+
+@interface OWProcessorSchedulerTests : XCTestCase
+{
+    OWProcessorScheduler *scheduler;
+    dispatch_group_t jobGroup;
+    NSMutableArray *runOrder;
+}
+@end
+
+static const OFMessageQueueSchedulingInfo InteractiveInfo = {.group = NULL, .priority = OFMediumPriority, .maximumSimultaneousThreadsInGroup = 255};
+static const OFMessageQueueSchedulingInfo BackgroundInfo = {.group = NULL, .priority = OFLowPriority, .maximumSimultaneousThreadsInGroup = 255};
+
+@implementation OWProcessorSchedulerTests
+
+- (void)tearDown;
+{
+    [scheduler invalidate];
+    [scheduler release];
+    scheduler = nil;
+    if (jobGroup != NULL) {
+        dispatch_release(jobGroup);
+        jobGroup = NULL;
+    }
+    [runOrder release];
+    runOrder = nil;
+
+    [super tearDown];
+}
+
+- (void)_setUpWithWorkerCount:(NSUInteger)workerCount maximumWorkerCount:(NSUInteger)maximumWorkerCount;
+{
+    scheduler = [[OWProcessorScheduler alloc] initWithWorkerCount:workerCount maximumWorkerCount:maximumWorkerCount];
+    jobGroup = dispatch_group_create();
+    runOrder = [[NSMutableArray alloc] init];
+}
+
+- (void)_schedule:(NSString *)name host:(NSString *)host info:(OFMessageQueueSchedulingInfo)info block:(void (^)(void))block;
+{
+    NSMutableArray *order = runOrder;
+    dispatch_group_t group = jobGroup;
+    dispatch_group_enter(group);
+    [scheduler scheduleWorkForClassName:@"Test" host:host schedulingInfo:info blocksOnIO:NO block:^{
+        @synchronized (order) {
+            [order addObject:name];
+        }
+        if (block != nil)
+            block();
+        dispatch_group_leave(group);
+    }];
+}
+
+// Occupies the only worker until the returned semaphore is signaled, so that everything scheduled meanwhile is queued together.
+- (dispatch_semaphore_t)_scheduleGate;
+{
+    dispatch_semaphore_t gate = dispatch_semaphore_create(0);
+    dispatch_semaphore_t started = dispatch_semaphore_create(0);
+    dispatch_group_enter(jobGroup);
+    dispatch_group_t group = jobGroup;
+    [scheduler scheduleWorkForClassName:@"Gate" host:@"gate" schedulingInfo:InteractiveInfo blocksOnIO:NO block:^{
+        dispatch_semaphore_signal(started);
+        dispatch_semaphore_wait(gate, DISPATCH_TIME_FOREVER);
+        dispatch_group_leave(group);
+    }];
+    dispatch_semaphore_wait(started, DISPATCH_TIME_FOREVER);
+    dispatch_release(started);
+    return [(id)gate autorelease];
+}
+
+- (BOOL)_waitForJobs;
+{
+    return dispatch_group_wait(jobGroup, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)) == 0;
+}
+
+- (void)testHostsTakeTurns;
+{
+    [self _setUpWithWorkerCount:1 maximumWorkerCount:1];
+    dispatch_semaphore_t gate = [self _scheduleGate];
+
+    [self _schedule:@"a1" host:@"a.example.com" info:InteractiveInfo block:nil];
+    [self _schedule:@"a2" host:@"a.example.com" info:InteractiveInfo block:nil];
+    [self _schedule:@"a3" host:@"a.example.com" info:InteractiveInfo block:nil];
+    [self _schedule:@"b1" host:@"b.example.com" info:InteractiveInfo block:nil];
+    [self _schedule:@"c1" host:@"c.example.com" info:InteractiveInfo block:nil];
+    [self _schedule:@"b2" host:@"b.example.com" info:InteractiveInfo block:nil];
+
+    dispatch_semaphore_signal(gate);
+    XCTAssertTrue([self _waitForJobs]);
+    XCTAssertEqualObjects(runOrder, (@[@"a1", @"b1", @"c1", @"a2", @"b2", @"a3"]));
+}
+
+- (void)testPriorityWithinHost;
+{
+    [self _setUpWithWorkerCount:1 maximumWorkerCount:1];
+    dispatch_semaphore_t gate = [self _scheduleGate];
+
+    OFMessageQueueSchedulingInfo urgentInfo = InteractiveInfo;
+    urgentInfo.priority = OFHighPriority;
+    [self _schedule:@"first" host:@"a.example.com" info:InteractiveInfo block:nil];
+    [self _schedule:@"second" host:@"a.example.com" info:InteractiveInfo block:nil];
+    [self _schedule:@"urgent" host:@"a.example.com" info:urgentInfo block:nil];
+
+    dispatch_semaphore_signal(gate);
+    XCTAssertTrue([self _waitForJobs]);
+    XCTAssertEqualObjects(runOrder, (@[@"urgent", @"first", @"second"]));
+}
+
+- (void)testInteractiveBeforeBackground;
+{
+    [self _setUpWithWorkerCount:1 maximumWorkerCount:1];
+    dispatch_semaphore_t gate = [self _scheduleGate];
+
+    [self _schedule:@"prefetch1" host:@"a.example.com" info:BackgroundInfo block:nil];
+    [self _schedule:@"prefetch2" host:@"b.example.com" info:BackgroundInfo block:nil];
+    [self _schedule:@"page" host:@"c.example.com" info:InteractiveInfo block:nil];
+
+    dispatch_semaphore_signal(gate);
+    XCTAssertTrue([self _waitForJobs]);
+    XCTAssertEqualObjects(runOrder, (@[@"page", @"prefetch1", @"prefetch2"]));
+}
+
+static void _runCounted(NSUInteger *runningCount, NSUInteger *maximumRunningCount, NSObject *lock)
+{
+    @synchronized (lock) {
+        (*runningCount)++;
+        *maximumRunningCount = MAX(*maximumRunningCount, *runningCount);
+    }
+    usleep(20000);
+    @synchronized (lock) {
+        (*runningCount)--;
+    }
+}
+
+- (void)testGroupLimit;
+{
+    [self _setUpWithWorkerCount:4 maximumWorkerCount:4];
+
+    static char group;
+    OFMessageQueueSchedulingInfo groupInfo = {.group = &group, .priority = OFMediumPriority, .maximumSimultaneousThreadsInGroup = 1};
+    __block NSUInteger runningCount = 0, maximumRunningCount = 0;
+    NSObject *lock = [[[NSObject alloc] init] autorelease];
+    for (NSUInteger jobIndex = 0; jobIndex < 8; jobIndex++)
+        [self _schedule:[NSString stringWithFormat:@"%lu", jobIndex] host:[NSString stringWithFormat:@"%lu.example.com", jobIndex] info:groupInfo block:^{
+            _runCounted(&runningCount, &maximumRunningCount, lock);
+        }];
+
+    XCTAssertTrue([self _waitForJobs]);
+    XCTAssertEqual(maximumRunningCount, 1UL);
+}
+
+- (void)testBackgroundWorkerLimit;
+{
+    [self _setUpWithWorkerCount:4 maximumWorkerCount:4];
+    [scheduler setBackgroundWorkerLimit:2];
+
+    __block NSUInteger runningCount = 0, maximumRunningCount = 0;
+    NSObject *lock = [[[NSObject alloc] init] autorelease];
+    for (NSUInteger jobIndex = 0; jobIndex < 12; jobIndex++)
+        [self _schedule:[NSString stringWithFormat:@"%lu", jobIndex] host:[NSString stringWithFormat:@"%lu.example.com", jobIndex] info:BackgroundInfo block:^{
+            _runCounted(&runningCount, &maximumRunningCount, lock);
+        }];
+
+    XCTAssertTrue([self _waitForJobs]);
+    XCTAssertEqual(maximumRunningCount, 2UL);
+}
+
+- (void)testBlockedWorkerIsReplaced;
+{
+    [self _setUpWithWorkerCount:1 maximumWorkerCount:2];
+
+    // With only one worker, the second job can only run if the scheduler notices the first is waiting.
+    dispatch_semaphore_t released = dispatch_semaphore_create(0);
+    [self _schedule:@"waiter" host:@"a.example.com" info:InteractiveInfo block:^{
+        OWProcessorSchedulerWillBlock();
+        dispatch_semaphore_wait(released, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC));
+        OWProcessorSchedulerDidUnblock();
+    }];
+    [self _schedule:@"releaser" host:@"b.example.com" info:InteractiveInfo block:^{
+        dispatch_semaphore_signal(released);
+    }];
+
+    XCTAssertTrue([self _waitForJobs]);
+    XCTAssertEqualObjects(runOrder, (@[@"waiter", @"releaser"]));
+    XCTAssertLessThanOrEqual([scheduler workerCount], 2UL);
+    XCTAssertEqual([scheduler blockedWorkerCount], 0UL);
+    dispatch_release(released);
+}
+
+- (void)testStatistics;
+{
+    [self _setUpWithWorkerCount:2 maximumWorkerCount:2];
+
+    for (NSUInteger jobIndex = 0; jobIndex < 3; jobIndex++)
+        [self _schedule:@"job" host:@"a.example.com" info:InteractiveInfo block:^{
+            usleep(1000);
+        }];
+    XCTAssertTrue([self _waitForJobs]);
+
+    NSDictionary *statistics = [[scheduler statisticsByClassName] objectForKey:@"Test"];
+    XCTAssertEqual([[statistics objectForKey:OWProcessorSchedulerRunCountKey] unsignedIntegerValue], 3UL);
+    XCTAssertGreaterThanOrEqual([[statistics objectForKey:OWProcessorSchedulerRunTimeKey] doubleValue], 0.003);
+    XCTAssertGreaterThanOrEqual([[statistics objectForKey:OWProcessorSchedulerMaximumRunTimeKey] doubleValue], 0.001);
+    XCTAssertNotNil([statistics objectForKey:OWProcessorSchedulerQueueDelayKey]);
+
+    [scheduler resetStatistics];
+    XCTAssertEqual([[scheduler statisticsByClassName] count], 0UL);
+}
+
+- (void)testLaneForSchedulingInfo;
+{
+    XCTAssertEqual(OWProcessorSchedulerLaneForSchedulingInfo(OFMessageQueueSchedulingInfoDefault), OWProcessorSchedulerInteractiveLane);
+    XCTAssertEqual(OWProcessorSchedulerLaneForSchedulingInfo(BackgroundInfo), OWProcessorSchedulerBackgroundLane);
+}
+
+@end
@@ -0,0 +1,120 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OWF/OWURL.h>
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#import <OmniBase/rcsid.h>
+
+RCS_ID("$Id$");
+
+// Times parsing URL strings, resolving relative links against a page, and the composite string and hash that caches key on. The URLs are spread over a few hundred hosts, like the links on a day's worth of pages. Results are logged rather than asserted since they depend on the machine.
+
+@interface OWURLBenchmarks : XCTestCase
+@end
+
+@implementation OWURLBenchmarks
+
+static const NSUInteger OWURLBenchmarkHostCount = 300;
+static const NSUInteger OWURLBenchmarkStringCount = 10000;
+static const NSUInteger OWURLBenchmarkPasses = 20;
+
+static NSArray *_urlStrings(void)
+{
+    NSMutableArray *urlStrings = [NSMutableArray arrayWithCapacity:OWURLBenchmarkStringCount];
+    for (NSUInteger stringIndex = 0; stringIndex < OWURLBenchmarkStringCount; stringIndex++) {
+        NSUInteger hostIndex = (stringIndex * 7919) % OWURLBenchmarkHostCount;
+        switch (stringIndex % 4) {
+            case 0:
+                [urlStrings addObject:[NSString stringWithFormat:@"http://www.site%lu.com/", hostIndex]];
+                break;
+            case 1:
+                [urlStrings addObject:[NSString stringWithFormat:@"http://www.site%lu.com/articles/%lu/index.html", hostIndex, stringIndex]];
+                break;
+            case 2:
+                [urlStrings addObject:[NSString stringWithFormat:@"https://cdn%lu.example.net/images/photo%lu.jpg?width=320&height=240", hostIndex % 8, stringIndex]];
+                break;
+            default:
+                [urlStrings addObject:[NSString stringWithFormat:@"http://search.site%lu.org/find;session=%lu?q=omni+web&page=2#results", hostIndex, stringIndex]];
+                break;
+        }
+    }
+    return urlStrings;
+}
+
+- (void)testParsing;
+{
+    NSArray *urlStrings = _urlStrings();
+    NSUInteger urlCount = 0;
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger pass = 0; pass < OWURLBenchmarkPasses; pass++) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        for (NSString *urlString in urlStrings) {
+            if ([OWURL urlFromString:urlString] != nil)
+                urlCount++;
+        }
+        [pool release];
+    }
+    CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+    NSLog(@"Parsed %lu URLs in %.3fs (%.0f URLs/s)", urlCount, elapsed, elapsed > 0 ? urlCount / elapsed : 0.0);
+
+    // Asking for a component makes all of them, so this is the cost of a URL whose parts are actually used.
+    urlCount = 0;
+    start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger pass = 0; pass < OWURLBenchmarkPasses; pass++) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        for (NSString *urlString in urlStrings) {
+            if ([[OWURL urlFromString:urlString] netLocation] != nil)
+                urlCount++;
+        }
+        [pool release];
+    }
+    elapsed = CFAbsoluteTimeGetCurrent() - start;
+    NSLog(@"Parsed %lu URLs into components in %.3fs (%.0f URLs/s)", urlCount, elapsed, elapsed > 0 ? urlCount / elapsed : 0.0);
+}
+
+- (void)testRelativeResolution;
+{
+    OWURL *baseURL = [OWURL urlFromString:@"http://www.omnigroup.com/products/omniweb/features/index.html?ref=home"];
+    NSArray *relativeStrings = @[@"tabs.html", @"images/shelf.png", @"../download/", @"/", @"/support/faq.html#browsing", @"?page=2", @"#top", @"//cdn.omnigroup.com/style.css", @"http://www.example.com/", @"./history.html", @"screenshots/2/large.png"];
+    NSUInteger urlCount = 0;
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger pass = 0; pass < OWURLBenchmarkPasses * 100; pass++) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        for (NSString *relativeString in relativeStrings) {
+            if ([baseURL urlFromRelativeString:relativeString] != nil)
+                urlCount++;
+        }
+        [pool release];
+    }
+    CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+    NSLog(@"Resolved %lu relative URLs in %.3fs (%.0f URLs/s)", urlCount, elapsed, elapsed > 0 ? urlCount / elapsed : 0.0);
+}
+
+- (void)testCompositeStringAndHash;
+{
+    NSArray *urlStrings = _urlStrings();
+    NSUInteger hash = 0, urlCount = 0;
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger pass = 0; pass < OWURLBenchmarkPasses; pass++) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        for (NSString *urlString in urlStrings) {
+            OWURL *url = [OWURL urlFromString:urlString];
+            hash ^= [url hash] ^ [[url compositeString] length];
+            urlCount++;
+        }
+        [pool release];
+    }
+    CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+    NSLog(@"Parsed and hashed %lu URLs in %.3fs (%.0f URLs/s, hash %lx)", urlCount, elapsed, elapsed > 0 ? urlCount / elapsed : 0.0, hash);
+}
+
+@end
@@ -0,0 +1,64 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <Foundation/NSObject.h>
+#import <Foundation/NSDate.h> // For NSTimeInterval
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class NSURL;
+
+typedef NS_ENUM(NSInteger, OBLogFileSinkDurability) {
+    /// Messages are written with write(2) once per batch. They survive the process crashing, but not the machine.
+    OBLogFileSinkDurabilityWrite,
+    /// Each batch is also fsync()ed.
+    OBLogFileSinkDurabilitySync,
+    /// Each batch is also flushed out of the drive's own cache, with F_FULLFSYNC where there is one.
+    OBLogFileSinkDurabilityFullSync,
+};
+
+/**
+ Appends log messages to files in a directory without making the logging thread wait for the disk.
+
+ Messages go into a fixed-size lock-free ring, along with the time they were logged, and a writer thread of the sink's own writes them out in batches on a file descriptor it keeps open. The timestamps are only formatted as they're written. If the ring fills up because the disk can't keep up, messages are dropped rather than blocking the threads logging them, and the file notes how many were lost. So are messages that arrive while no file can be opened; the note goes in the next file that can be.
+
+ Each file is named with the prefix and the time it was started, and the sink moves on to a new file once the current one reaches `maximumFileSize` or `maximumFileAge`.
+
+ The configuration properties are atomic, so they may be changed from any thread at any time, and take effect with the next batch. The sink has to be invalidated to stop its thread.
+ */
+@interface OBLogFileSink : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithDirectoryURL:(NSURL *)directoryURL fileNamePrefix:(NSString *)fileNamePrefix NS_DESIGNATED_INITIALIZER;
+
+@property (nonatomic, readonly) NSURL *directoryURL;
+@property (nonatomic, readonly) NSString *fileNamePrefix;
+
+/// The longest a message waits before it's written. Defaults to one second. Batches are written sooner when the ring starts to fill up.
+@property (atomic) NSTimeInterval flushInterval;
+/// Defaults to OBLogFileSinkDurabilitySync.
+@property (atomic) OBLogFileSinkDurability durability;
+/// Defaults to 8MB. Zero means no limit.
+@property (atomic) unsigned long long maximumFileSize;
+/// Defaults to one day. Zero means no limit.
+@property (atomic) NSTimeInterval maximumFileAge;
+
+/// Messages lost because the ring was full, the sink had been invalidated, or no log file could be opened to write them to.
+@property (nonatomic, readonly) NSUInteger droppedMessageCount;
+
+/// Queues a message to be written on a line of its own. Returns NO if it had to be dropped. Safe to call from any number of threads at once.
+- (BOOL)appendMessage:(NSString *)message;
+
+/// Waits until every message appended before this was called has been written, and made as durable as `durability` says.
+- (void)flush;
+
+/// Writes out what's queued, closes the file, and stops the writer thread. Messages appended after this are dropped.
+- (void)invalidate;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,432 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniBase/OBLogFileSink.h>
+
+#import <Foundation/Foundation.h>
+
+#import <OmniBase/assertions.h>
+#import <OmniBase/rcsid.h>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+RCS_ID("$Id$");
+
+#define RING_CAPACITY (4096)            // Must be a power of two
+#define SLOT_INLINE_LENGTH (224)        // Makes a slot 256 bytes. Longer messages are copied to the heap.
+#define WRITE_BUFFER_SIZE (64 * 1024)
+#define TIMESTAMP_LENGTH (31)           // "yyyy-mm-dd hh:mm:ss.mmm +0000: "
+#define OPEN_RETRY_INTERVAL (60)        // Seconds between attempts to open a log file after failing to
+
+typedef struct {
+    _Atomic(uint64_t) sequence;     // The ring position the slot is ready for: see -appendMessage: and -_writeQueuedMessages
+    uint64_t timestamp;             // Nanoseconds since 1970
+    uint32_t length;
+    char *heapBytes;                // For messages longer than SLOT_INLINE_LENGTH
+    char inlineBytes[SLOT_INLINE_LENGTH];
+} OBLogFileSinkSlot;
+
+// The producers' position and the writer's are kept on cache lines of their own, so that logging threads and the writer don't keep taking them away from each other
+typedef struct {
+    _Alignas(64) _Atomic(uint64_t) enqueuePosition;
+    _Alignas(64) uint64_t dequeuePosition;  // Only used by the writer thread
+    _Alignas(64) OBLogFileSinkSlot slots[RING_CAPACITY];
+} OBLogFileSinkRing;
+
+@implementation OBLogFileSink
+{
+    OBLogFileSinkRing *_ring;
+    _Atomic(NSUInteger) _droppedMessageCount;
+    atomic_bool _invalidated;
+    dispatch_semaphore_t _wakeup;
+
+    // Protected by _flushLock
+    pthread_mutex_t _flushLock;
+    pthread_cond_t _flushCondition;
+    uint64_t _writtenPosition;
+    uint64_t _flushPosition;    // As far as a -flush is waiting for
+    BOOL _writerFinished;
+
+    // Only used by the writer thread
+    int _fd;
+    unsigned long long _fileSize;
+    time_t _fileStartTime;
+    time_t _nextOpenTime;
+    char *_writeBuffer;
+    size_t _writeBufferLength;
+    time_t _formattedSecond;
+    char _formattedSecondString[20];    // "yyyy-mm-dd hh:mm:ss"
+    NSUInteger _reportedDroppedMessageCount;
+}
+
+- (instancetype)initWithDirectoryURL:(NSURL *)directoryURL fileNamePrefix:(NSString *)fileNamePrefix;
+{
+    OBPRECONDITION([directoryURL isFileURL]);
+    OBPRECONDITION([fileNamePrefix length] > 0);
+
+    self = [super init];
+    if (self == nil)
+        return nil;
+
+    _directoryURL = [directoryURL copy];
+    _fileNamePrefix = [fileNamePrefix copy];
+    _flushInterval = 1.0;
+    _durability = OBLogFileSinkDurabilitySync;
+    _maximumFileSize = 8 * 1024 * 1024;
+    _maximumFileAge = 24 * 60 * 60;
+
+    if (posix_memalign((void **)&_ring, 64, sizeof(*_ring)) != 0)
+        return nil;
+    atomic_init(&_ring->enqueuePosition, 0);
+    _ring->dequeuePosition = 0;
+    for (uint64_t slotIndex = 0; slotIndex < RING_CAPACITY; slotIndex++) {
+        atomic_init(&_ring->slots[slotIndex].sequence, slotIndex);
+        _ring->slots[slotIndex].heapBytes = NULL;
+    }
+
+    atomic_init(&_droppedMessageCount, 0);
+    atomic_init(&_invalidated, false);
+    _wakeup = dispatch_semaphore_create(0);
+    pthread_mutex_init(&_flushLock, NULL);
+    pthread_cond_init(&_flushCondition, NULL);
+
+    _fd = -1;
+    _formattedSecond = -1;
+    _writeBuffer = malloc(WRITE_BUFFER_SIZE);
+
+    NSThread *writerThread = [[NSThread alloc] initWithTarget:self selector:@selector(_writerThreadMain) object:nil];
+    writerThread.name = [NSString stringWithFormat:@"%@ log writer", fileNamePrefix];
+    writerThread.qualityOfService = NSQualityOfServiceUtility;
+    [writerThread start];
+
+    return self;
+}
+
+- (void)dealloc;
+{
+    OBPRECONDITION(_writerFinished, "The writer thread keeps the sink alive until it's invalidated");
+
+    for (uint64_t slotIndex = 0; slotIndex < RING_CAPACITY; slotIndex++)
+        free(_ring->slots[slotIndex].heapBytes);
+    free(_ring);
+    free(_writeBuffer);
+    pthread_mutex_destroy(&_flushLock);
+    pthread_cond_destroy(&_flushCondition);
+}
+
+- (NSUInteger)droppedMessageCount;
+{
+    return atomic_load_explicit(&_droppedMessageCount, memory_order_relaxed);
+}
+
+/*
+ The ring is a bounded multi-producer queue in the style of Dmitry Vyukov's. Each slot's sequence says which position it's ready for: a producer claims position p by advancing enqueuePosition when slot p's sequence is p, and publishes the message by setting the sequence to p + 1. The writer takes the message once it sees p + 1, and hands the slot on to position p + RING_CAPACITY. So producers never wait for each other or for the writer, and a slot which is still behind means the ring is full.
+ */
+- (BOOL)appendMessage:(NSString *)message;
+{
+    if (atomic_load_explicit(&_invalidated, memory_order_relaxed)) {
+        atomic_fetch_add_explicit(&_droppedMessageCount, 1, memory_order_relaxed);
+        return NO;
+    }
+
+    OBLogFileSinkRing *ring = _ring;
+    OBLogFileSinkSlot *slot;
+    uint64_t position = atomic_load_explicit(&ring->enqueuePosition, memory_order_relaxed);
+    while (YES) {
+        slot = &ring->slots[position & (RING_CAPACITY - 1)];
+        int64_t lag = (int64_t)(atomic_load_explicit(&slot->sequence, memory_order_acquire) - position);
+        if (lag == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->enqueuePosition, &position, position + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+            // Someone else got this position; the exchange reloaded the current one
+        } else if (lag < 0) {
+            atomic_fetch_add_explicit(&_droppedMessageCount, 1, memory_order_relaxed);
+            return NO;
+        } else {
+            position = atomic_load_explicit(&ring->enqueuePosition, memory_order_relaxed);
+        }
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    slot->timestamp = (uint64_t)now.tv_sec * NSEC_PER_SEC + (uint64_t)now.tv_nsec;
+
+    NSUInteger usedLength = 0;
+    NSRange remainingRange;
+    [message getBytes:slot->inlineBytes maxLength:SLOT_INLINE_LENGTH usedLength:&usedLength encoding:NSUTF8StringEncoding options:NSStringEncodingConversionAllowLossy range:NSMakeRange(0, [message length]) remainingRange:&remainingRange];
+    if (remainingRange.length > 0) {
+        NSData *data = [message dataUsingEncoding:NSUTF8StringEncoding allowLossyConversion:YES];
+        usedLength = MIN([data length], (NSUInteger)UINT32_MAX);
+        slot->heapBytes = malloc(usedLength);
+        memcpy(slot->heapBytes, [data bytes], usedLength);
+    }
+    slot->length = (uint32_t)usedLength;
+
+    atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+
+    // Rather than waking the writer for every message, wake it each time another quarter of the ring has been used
+    if (((position + 1) & (RING_CAPACITY / 4 - 1)) == 0)
+        dispatch_semaphore_signal(_wakeup);
+
+    return YES;
+}
+
+- (void)flush;
+{
+    uint64_t position = atomic_load(&_ring->enqueuePosition);
+
+    pthread_mutex_lock(&_flushLock);
+    if (_flushPosition < position)
+        _flushPosition = position;
+    pthread_mutex_unlock(&_flushLock);
+
+    dispatch_semaphore_signal(_wakeup);
+
+    pthread_mutex_lock(&_flushLock);
+    while (_writtenPosition < position && !_writerFinished)
+        pthread_cond_wait(&_flushCondition, &_flushLock);
+    pthread_mutex_unlock(&_flushLock);
+}
+
+- (void)invalidate;
+{
+    if (atomic_exchange(&_invalidated, true))
+        return;
+
+    dispatch_semaphore_signal(_wakeup);
+
+    pthread_mutex_lock(&_flushLock);
+    while (!_writerFinished)
+        pthread_cond_wait(&_flushCondition, &_flushLock);
+    pthread_mutex_unlock(&_flushLock);
+}
+
+#pragma mark - Private
+
+- (void)_writerThreadMain;
+{
+    while (YES) {
+        @autoreleasepool {
+            BOOL invalidated = atomic_load(&_invalidated);
+
+            if (!invalidated) {
+                // A flush may be waiting on a message that's been claimed but not filled in yet, so it gets another look soon
+                pthread_mutex_lock(&_flushLock);
+                BOOL flushWaiting = _flushPosition > _writtenPosition;
+                pthread_mutex_unlock(&_flushLock);
+
+                NSTimeInterval interval = flushWaiting ? 0.001 : self.flushInterval;
+                dispatch_semaphore_wait(_wakeup, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(interval * NSEC_PER_SEC)));
+            }
+
+            [self _writeQueuedMessages];
+
+            if (invalidated) {
+                // Messages appended just as we were invalidated may still be being filled in
+                if (_ring->dequeuePosition == atomic_load(&_ring->enqueuePosition))
+                    break;
+                usleep(100);
+            }
+        }
+    }
+
+    if (_fd >= 0) {
+        close(_fd);
+        _fd = -1;
+    }
+
+    pthread_mutex_lock(&_flushLock);
+    _writerFinished = YES;
+    pthread_cond_broadcast(&_flushCondition);
+    pthread_mutex_unlock(&_flushLock);
+}
+
+- (void)_writeQueuedMessages;
+{
+    OBLogFileSinkRing *ring = _ring;
+    uint64_t position = ring->dequeuePosition;
+    BOOL startedBatch = NO;
+
+    while (YES) {
+        OBLogFileSinkSlot *slot = &ring->slots[position & (RING_CAPACITY - 1)];
+        if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != position + 1)
+            break; // Not published yet
+
+        if (!startedBatch) {
+            [self _startBatch];
+            startedBatch = YES;
+        }
+        if (_fd >= 0)
+            [self _appendLineWithTimestamp:slot->timestamp bytes:slot->heapBytes != NULL ? slot->heapBytes : slot->inlineBytes length:slot->length];
+        else
+            atomic_fetch_add_explicit(&_droppedMessageCount, 1, memory_order_relaxed); // No file could be opened (see -_startBatch)
+
+        free(slot->heapBytes);
+        slot->heapBytes = NULL;
+        atomic_store_explicit(&slot->sequence, position + RING_CAPACITY, memory_order_release);
+        position++;
+    }
+    ring->dequeuePosition = position;
+
+    NSUInteger droppedMessageCount = atomic_load_explicit(&_droppedMessageCount, memory_order_relaxed);
+    if (droppedMessageCount != _reportedDroppedMessageCount) {
+        if (!startedBatch) {
+            [self _startBatch];
+            startedBatch = YES;
+        }
+
+        // Without a file, the note waits for the next one
+        if (_fd >= 0) {
+            char note[64];
+            int noteLength = snprintf(note, sizeof(note), "(%lu messages dropped)", (unsigned long)(droppedMessageCount - _reportedDroppedMessageCount));
+            struct timespec now;
+            clock_gettime(CLOCK_REALTIME, &now);
+
+            [self _appendLineWithTimestamp:(uint64_t)now.tv_sec * NSEC_PER_SEC + (uint64_t)now.tv_nsec bytes:note length:noteLength];
+            _reportedDroppedMessageCount = droppedMessageCount;
+        }
+    }
+
+    if (startedBatch) {
+        [self _writeBufferedLines];
+        [self _synchronize];
+    }
+
+    pthread_mutex_lock(&_flushLock);
+    _writtenPosition = position;
+    pthread_cond_broadcast(&_flushCondition);
+    pthread_mutex_unlock(&_flushLock);
+}
+
+// Moves on to a new file if the current one is full or old enough, or if there isn't one yet
+- (void)_startBatch;
+{
+    time_t now = time(NULL);
+    unsigned long long maximumFileSize = self.maximumFileSize;
+    NSTimeInterval maximumFileAge = self.maximumFileAge;
+
+    if (_fd >= 0 && ((maximumFileSize > 0 && _fileSize >= maximumFileSize) || (maximumFileAge > 0 && difftime(now, _fileStartTime) >= maximumFileAge))) {
+        close(_fd);
+        _fd = -1;
+    }
+    if (_fd >= 0 || now < _nextOpenTime)
+        return;
+
+    struct tm components;
+    char dateString[32];
+    gmtime_r(&now, &components);
+    strftime(dateString, sizeof(dateString), "%Y-%m-%d %H.%M.%S", &components);
+    NSString *baseName = [NSString stringWithFormat:@"%@ %s", _fileNamePrefix, dateString];
+
+    // Rotating more than once a second needs more than the time to keep the names apart
+    for (NSUInteger attempt = 1; _fd < 0; attempt++) {
+        NSString *fileName = attempt == 1 ? [baseName stringByAppendingString:@".log"] : [NSString stringWithFormat:@"%@ %lu.log", baseName, attempt];
+        NSURL *fileURL = [_directoryURL URLByAppendingPathComponent:fileName isDirectory:NO];
+        _fd = open([fileURL fileSystemRepresentation], O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0644);
+        if (_fd < 0 && (errno != EEXIST || attempt >= 100)) {
+            NSLog(@"Error opening log file \"%@\": %s", [fileURL path], strerror(errno));
+            _nextOpenTime = now + OPEN_RETRY_INTERVAL;
+            return;
+        }
+    }
+
+    _fileSize = 0;
+    _fileStartTime = now;
+}
+
+- (void)_appendLineWithTimestamp:(uint64_t)timestamp bytes:(const char *)bytes length:(size_t)length;
+{
+    if (_writeBufferLength + TIMESTAMP_LENGTH + length + 1 > WRITE_BUFFER_SIZE)
+        [self _writeBufferedLines];
+
+    // Only the seconds go through strftime(), once per second
+    char *line = _writeBuffer + _writeBufferLength;
+    time_t second = (time_t)(timestamp / NSEC_PER_SEC);
+    unsigned int milliseconds = (unsigned int)((timestamp % NSEC_PER_SEC) / NSEC_PER_MSEC);
+    if (second != _formattedSecond) {
+        struct tm components;
+        gmtime_r(&second, &components);
+        strftime(_formattedSecondString, sizeof(_formattedSecondString), "%Y-%m-%d %H:%M:%S", &components);
+        _formattedSecond = second;
+    }
+    memcpy(line, _formattedSecondString, 19);
+    line[19] = '.';
+    line[20] = (char)('0' + milliseconds / 100);
+    line[21] = (char)('0' + milliseconds / 10 % 10);
+    line[22] = (char)('0' + milliseconds % 10);
+    memcpy(line + 23, " +0000: ", 8);
+
+    if (TIMESTAMP_LENGTH + length + 1 > WRITE_BUFFER_SIZE) {
+        // Too big to buffer, so it goes straight out after its timestamp
+        struct iovec vectors[3] = {
+            { line, TIMESTAMP_LENGTH },
+            { (void *)bytes, length },
+            { "\n", 1 },
+        };
+        [self _writeVectors:vectors count:3];
+        return;
+    }
+
+    memcpy(line + TIMESTAMP_LENGTH, bytes, length);
+    line[TIMESTAMP_LENGTH + length] = '\n';
+    _writeBufferLength += TIMESTAMP_LENGTH + length + 1;
+}
+
+- (void)_writeBufferedLines;
+{
+    struct iovec vector = { _writeBuffer, _writeBufferLength };
+    [self _writeVectors:&vector count:1];
+    _writeBufferLength = 0;
+}
+
+- (void)_writeVectors:(struct iovec *)vectors count:(int)count;
+{
+    // Without a file nothing's been buffered: -_writeQueuedMessages counts the messages as dropped instead
+    while (count > 0 && _fd >= 0) {
+        ssize_t written = writev(_fd, vectors, count);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            NSLog(@"Error writing log file for %@: %s", _fileNamePrefix, strerror(errno));
+            return;
+        }
+
+        _fileSize += (unsigned long long)written;
+        while (count > 0 && (size_t)written >= vectors->iov_len) {
+            written -= vectors->iov_len;
+            vectors++;
+            count--;
+        }
+        if (count > 0) {
+            vectors->iov_base = (char *)vectors->iov_base + written;
+            vectors->iov_len -= (size_t)written;
+        }
+    }
+}
+
+- (void)_synchronize;
+{
+    OBLogFileSinkDurability durability = self.durability;
+    if (_fd < 0 || durability == OBLogFileSinkDurabilityWrite)
+        return;
+
+#ifdef F_FULLFSYNC
+    // Not every file system supports this, in which case fsync() is the best we can do
+    if (durability == OBLogFileSinkDurabilityFullSync && fcntl(_fd, F_FULLFSYNC) == 0)
+        return;
+#endif
+
+    if (fsync(_fd) != 0)
+        NSLog(@"Error synchronizing log file for %@: %s", _fileNamePrefix, strerror(errno));
+}
+
+@end
@@ -1,4 +1,4 @@
-// Copyright 2013-2020 Omni Development, Inc. All rights reserved.
+// Copyright 2013-2026 Omni Development, Inc. All rights reserved.
 //
 // This software may only be used and reproduced according to the
 // terms in the file OmniSourceLicense.html, which should be
@@ -9,6 +9,8 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+@class OBLogFileSink;
+
 typedef void(^OBLogFileHandler)(NSURL *url);
 
 /**
@@ -23,6 +25,8 @@ typedef void(^OBLogFileHandler)(NSURL *url);
 /// `name` accessor provided as backwards compatibility; cover for now preferred `key` property.
 @property (nonatomic, readonly) NSString *name;
 @property (nonatomic, readonly) BOOL shouldLogToFile;
+/// Writes the log files when `shouldLogToFile` is set, and may be configured to trade durability for speed. Log files are named with the key and the time they were started, and a new one is started each day.
+@property (nullable, nonatomic, readonly) OBLogFileSink *fileSink;
 
 /**
  Convenience provided as backwards compatible cover. Calls through to `-[OBLogger initWithSuiteName:key:shouldLogToFile:]` with an empty `suiteName` and uses `name` parameter for the `key`.
@@ -44,7 +48,7 @@ typedef void(^OBLogFileHandler)(NSURL *url);
 - (void)log:(NSString *)format arguments:(va_list)args;
 
 /**
- A convenience method for processing log files. The handler will be invoked with every current log file for this logger.
+ A convenience method for processing log files. The handler will be invoked with every current log file for this logger, after any messages still waiting to be written have been.
  */
 - (void)processLogFilesWithHandler:(OBLogFileHandler)handler;
 @end
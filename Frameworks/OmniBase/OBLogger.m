@@ -1,4 +1,4 @@
-// Copyright 2013-2021 Omni Development, Inc. All rights reserved.
+// Copyright 2013-2026 Omni Development, Inc. All rights reserved.
 //
 // This software may only be used and reproduced according to the
 // terms in the file OmniSourceLicense.html, which should be
@@ -12,6 +12,7 @@
 #import <OmniBase/assertions.h>
 #import <OmniBase/rcsid.h>
 #import <OmniBase/macros.h>
+#import <OmniBase/OBLogFileSink.h>
 
 RCS_ID("$Id$");
 
@@ -113,63 +114,8 @@ static void _RemoveLogFiles(NSString *loggerName, NSDate *olderThanDate)
 }
 #endif
 
-@interface NSString (OBLoggerExtensions)
-- (BOOL)appendToURL:(NSURL *)url atomically:(BOOL)atomically error:(NSError **)error;
-@end
-
-static void _setPOSIXError(NSError **error, NSString *description)
-{
-    if (error != NULL)
-        *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:@{NSLocalizedDescriptionKey:description}];
-}
-
-@implementation NSString (OBLoggerExtensions)
-- (BOOL)appendToURL:(NSURL *)url atomically:(BOOL)atomically error:(NSError **)error;
-{
-    if ([self length] > PIPE_BUF)
-        NSLog(@"Can't guarantee atomic writes of strings longer than %d. This string has length %ld", PIPE_BUF, [self length]);
-    
-    NSData *stringData = [self dataUsingEncoding:NSUTF8StringEncoding];
-    
-    const char *filePath = [[url path] UTF8String];
-    FILE *cFile = fopen(filePath, "a");
-    if (cFile == NULL) {
-        _setPOSIXError(error, @"error opening file");
-        return NO;
-    }
-
-    @try {
-        size_t bytesWritten = fwrite([stringData bytes], 1, [stringData length], cFile);
-        if (bytesWritten < [stringData length]) {
-            _setPOSIXError(error, @"error writing to file");
-            return NO;
-        }
-        
-        int syncSuccess = fsync(fileno(cFile));
-        if (syncSuccess != 0) {
-            _setPOSIXError(error, @"error synchronizing file");
-            return NO;
-        }
-    }
-    @finally {
-        int closeSuccess = fclose(cFile);
-        if (closeSuccess != 0) {
-            _setPOSIXError(error, @"error closing file");
-            return NO;
-        }
-        return YES;
-    }
-}
-@end
-
-@interface OBLogger ()
-@property (nonatomic, strong) NSDateFormatter *messageDateFormatter;
-@end
-
 @implementation OBLogger
 {
-    NSDateFormatter *_fileNameDateFormatter;
-    NSOperationQueue *_fileLoggingQueue;
     NSTimer *_logPurgeTimer;
 }
 
@@ -213,16 +159,13 @@ static void _setPOSIXError(NSError **error, NSString *description)
     _suiteName = [suiteName copy];
     _key = [key copy];
     
-    _messageDateFormatter = [[NSDateFormatter alloc] init];
-    [_messageDateFormatter setTimeZone:[NSTimeZone timeZoneWithAbbreviation:@"GMT"]];
-    [_messageDateFormatter setDateFormat:@"yyyy-MM-dd HH:mm:ss.mmm ZZZ"];
-    
-    _fileNameDateFormatter = [[NSDateFormatter alloc] init];
-    [_fileNameDateFormatter setTimeZone:[NSTimeZone timeZoneWithAbbreviation:@"GMT"]];
-    [_fileNameDateFormatter setDateFormat:@"yyyy-MM-dd"];
-    
-    _fileLoggingQueue = [[NSOperationQueue alloc] init];
-    _fileLoggingQueue.maxConcurrentOperationCount = 1;
+    if (_shouldLogToFile) {
+        NSURL *logFileFolder = _LogFileFolderForLoggerName(key);
+        if (logFileFolder != nil)
+            _fileSink = [[OBLogFileSink alloc] initWithDirectoryURL:logFileFolder fileNamePrefix:key];
+        else
+            NSLog(@"No log file folder for %@", key);
+    }
 
 #if REMOVE_OLD_LOG_FILES
     NSDate *purgeBeforeDate = [NSDate dateWithTimeIntervalSinceNow: - _oneWeekInSeconds];
@@ -238,6 +181,7 @@ static void _setPOSIXError(NSError **error, NSString *description)
 - (void)dealloc;
 {
     [_logPurgeTimer invalidate];
+    [_fileSink invalidate];
 }
 
 - (void)log:(NSString *)format arguments:(va_list)args;
@@ -246,34 +190,13 @@ static void _setPOSIXError(NSError **error, NSString *description)
     
     NSLog(@"%@: %@", self.key, message);
     
-    if (!self.shouldLogToFile)
-        return;
-
-    __weak OBLogger *weakSelf = self;
-    [_fileLoggingQueue addOperationWithBlock:^{
-        __strong OBLogger *strongSelf = weakSelf;
-        if (strongSelf == nil) {
-            return;
-        }
-
-        NSString *timeStamp = [strongSelf.messageDateFormatter stringFromDate:[NSDate date]];
-        NSString *timeStampedMessage = [[NSString alloc] initWithFormat:@"%@: %@\n", timeStamp, message];
-        
-        NSURL *logFileURL = [strongSelf _currentLogFile];
-        if (logFileURL == nil) {
-            NSLog(@"No log file URL for %@", strongSelf.key);
-            return;
-        }
-        
-        OB_AUTORELEASING NSError *error = nil;
-        if (![timeStampedMessage appendToURL:logFileURL atomically:YES error:&error]) {
-            NSLog(@"Error logging for %@: %@", strongSelf.key, error);
-        }
-    }];
+    // The sink timestamps the message and writes it out later on its own thread
+    [_fileSink appendMessage:message];
 }
 
 - (void)processLogFilesWithHandler:(OBLogFileHandler)handler;
 {
+    [_fileSink flush];
     _ProcessLogFiles(self.key, [NSDate distantFuture], handler);
 }
 
@@ -284,15 +207,6 @@ static void _setPOSIXError(NSError **error, NSString *description)
 
 #pragma mark - Private API
 
-- (NSURL *)_currentLogFile;
-{
-    NSString *dateString = [_fileNameDateFormatter stringFromDate:[NSDate date]];
-    NSString *logFileName = [NSString stringWithFormat:@"%@ %@%@", self.key, dateString, _logFileSuffix];
-    NSURL *logFileURL = [_LogFileFolderForLoggerName(self.name) URLByAppendingPathComponent:logFileName isDirectory:NO];
-    
-    return logFileURL;
-}
-
 #if REMOVE_OLD_LOG_FILES
 - (void)_purgeOldLogFiles:(NSTimer *)timer;
 {
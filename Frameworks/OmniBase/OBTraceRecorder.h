@@ -0,0 +1,79 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <Foundation/NSObjCRuntime.h>
+#import <CoreFoundation/CFBase.h>
+
+@class NSData;
+
+/*
+ A low-overhead recorder of timed events for hot code paths, to go along with OBBacktraceBuffer's record of rare ones.
+
+ Each thread records into a fixed-size ring of its own, so recording an event takes no locks and no atomic read-modify-write operations, and threads never contend with one another; once a thread's ring is full its oldest events are overwritten. Events are stamped with the CPU's timestamp counter (or the equivalent tick counter where there isn't one) and the work of converting that to time is left for when the trace is dumped. Names must be string constants, or otherwise outlive the trace, as with OBRecordBacktrace().
+
+ Nothing is recorded until OBTraceRecorderStart() is called, and until then each of the macros below costs a load and a branch. Defining OMNI_FORCE_TRACING_OFF compiles them out entirely.
+
+ OBTraceRecorderChromeTraceData() returns what's been recorded since OBTraceRecorderStart() in the Trace Event JSON format that chrome://tracing and Perfetto (ui.perfetto.dev) open, or nil if there isn't memory to copy the rings into.
+ */
+
+#if !defined(OMNI_FORCE_TRACING_OFF)
+#define OMNI_TRACING_ON
+#endif
+
+typedef CF_ENUM(uint32_t, OBTraceEventType) {
+    OBTraceEvent_Unused = 0,
+    OBTraceEvent_BeginSpan = 1,
+    OBTraceEvent_EndSpan = 2,
+    OBTraceEvent_Counter = 3,   /* The value is the counter's new value */
+    OBTraceEvent_Instant = 4,   /* The value is an optional context, as with OBRecordBacktraceWithContext() */
+};
+
+typedef CF_OPTIONS(uint32_t, OBTraceEventOptions) {
+    OBTraceEventOptionCaptureStack = 1 << 0,    /* Record the calling thread's stack with the event. This costs a backtrace(), so is best kept to instants and spans that aren't hot. */
+};
+
+extern void OBTraceRecorderStart(void);
+extern void OBTraceRecorderStop(void);
+extern NSData *OBTraceRecorderChromeTraceData(void);
+
+// Records an event for the calling thread whether or not the recorder is started. Use the macros below instead.
+extern void _OBTraceRecordEvent(OBTraceEventType type, const char *name, int64_t value, OBTraceEventOptions options);
+
+extern bool _OBTraceRecorderIsRecording;
+
+static inline __attribute__((always_inline)) void _OBTraceRecordEventIfRecording(OBTraceEventType type, const char *name, int64_t value, OBTraceEventOptions options) {
+    if (__builtin_expect(__atomic_load_n(&_OBTraceRecorderIsRecording, __ATOMIC_RELAXED), 0))
+        _OBTraceRecordEvent(type, name, value, options);
+}
+
+static inline void _OBTraceEndScope(const char **name) {
+    _OBTraceRecordEventIfRecording(OBTraceEvent_EndSpan, *name, 0, 0);
+}
+
+#ifdef OMNI_TRACING_ON
+    #define OBTraceBeginSpan(name) _OBTraceRecordEventIfRecording(OBTraceEvent_BeginSpan, (name), 0, 0)
+    #define OBTraceBeginSpanWithStack(name) _OBTraceRecordEventIfRecording(OBTraceEvent_BeginSpan, (name), 0, OBTraceEventOptionCaptureStack)
+    #define OBTraceEndSpan(name) _OBTraceRecordEventIfRecording(OBTraceEvent_EndSpan, (name), 0, 0)
+    #define OBTraceCounter(name, value) _OBTraceRecordEventIfRecording(OBTraceEvent_Counter, (name), (int64_t)(value), 0)
+    #define OBTraceInstant(name) _OBTraceRecordEventIfRecording(OBTraceEvent_Instant, (name), 0, 0)
+    #define OBTraceInstantWithContext(name, context) _OBTraceRecordEventIfRecording(OBTraceEvent_Instant, (name), (int64_t)(intptr_t)(context), 0)
+    #define OBTraceInstantWithStack(name) _OBTraceRecordEventIfRecording(OBTraceEvent_Instant, (name), 0, OBTraceEventOptionCaptureStack)
+
+    // Begins a span which ends when the enclosing scope does
+    #define OBTraceScope__(name, line) const char *_OBTraceScopeName_ ## line __attribute__((cleanup(_OBTraceEndScope), unused)) = (name); OBTraceBeginSpan(_OBTraceScopeName_ ## line)
+    #define OBTraceScope_(name, line) OBTraceScope__(name, line)
+    #define OBTraceScope(name) OBTraceScope_(name, __LINE__)
+#else
+    #define OBTraceBeginSpan(name) do {} while (0)
+    #define OBTraceBeginSpanWithStack(name) do {} while (0)
+    #define OBTraceEndSpan(name) do {} while (0)
+    #define OBTraceCounter(name, value) do {} while (0)
+    #define OBTraceInstant(name) do {} while (0)
+    #define OBTraceInstantWithContext(name, context) do {} while (0)
+    #define OBTraceInstantWithStack(name) do {} while (0)
+    #define OBTraceScope(name) do {} while (0)
+#endif
@@ -0,0 +1,385 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniBase/OBTraceRecorder.h>
+
+#import <Foundation/Foundation.h>
+
+#import <OmniBase/assertions.h>
+#import <OmniBase/rcsid.h>
+#include <dlfcn.h>
+#include <execinfo.h>  // For backtrace()
+#include <mach/mach_time.h>
+#include <os/lock.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__)
+#include <x86intrin.h>  // For __rdtsc()
+#endif
+
+RCS_ID("$Id$");
+
+#define OBTraceRecorderEventCount (16384)   /* Events retained per thread; must be a power of two */
+#define OBTraceRecorderStackCount (256)     /* Stacks retained per thread; must be a power of two */
+#define OBTraceRecorderStackDepth (32)      /* Max depth of stack to record per event */
+#define OBTraceRecorderSkippedFrameCount (2)    /* OBTraceCaptureStack() and _OBTraceRecordEvent() */
+#define OBTraceRecorderRetiredThreadCount (32)  /* Rings of exited threads kept for dumps before they're reused */
+
+struct OBTraceEvent {
+    uint64_t ticks;
+    const char *name;
+    int64_t value;
+    OBTraceEventType type;
+    uint32_t stackNumber;   /* One more than the position of the event's stack in its thread's stack ring, or 0 if it has none */
+};
+
+struct OBTraceStack {
+    void *frames[OBTraceRecorderStackDepth];
+};
+
+/*
+ Only the owning thread writes to a ring. It fills in the slot for an event and then advances eventPosition past it, so a dump reading from another thread can tell which slots might have been overwritten while it was copying them: anything older than a ring's length behind the position it sees afterwards, plus the two slots after that. The owner may be in the middle of writing the first, and since publishing a position only orders the stores before it, its stores into the next slot can be seen before the position that precedes them. The same goes for stackPosition and the stacks.
+ */
+struct OBTraceThreadBuffer {
+    _Atomic(uint64_t) eventPosition;
+    _Atomic(uint32_t) stackPosition;
+    _Atomic(struct OBTraceStack *) stacks;  /* Allocated the first time the thread captures a stack */
+
+    // Protected by ThreadBuffersLock
+    struct OBTraceThreadBuffer *next;
+    uint64_t threadID;
+    char threadName[64];
+    bool retired;
+
+    struct OBTraceEvent events[OBTraceRecorderEventCount];
+};
+
+bool _OBTraceRecorderIsRecording = false;
+
+static os_unfair_lock ThreadBuffersLock = OS_UNFAIR_LOCK_INIT;
+static struct OBTraceThreadBuffer *ThreadBuffers; /* Every ring, most recently registered first */
+static unsigned int RetiredThreadBufferCount;
+static uint64_t StartTicks;
+static uint64_t StartNanoseconds;
+
+static pthread_key_t ThreadBufferKey;   /* Only used to find out when a thread exits */
+static __thread struct OBTraceThreadBuffer *CurrentThreadBuffer;
+#define RetiredThreadBuffer ((struct OBTraceThreadBuffer *)1)  /* Once a thread has started exiting, it stops recording */
+
+static inline uint64_t OBTraceTicks(void)
+{
+#if defined(__x86_64__)
+    return __rdtsc();
+#else
+    // On arm64 this reads the system counter directly; there's no cycle counter available to user code
+    return mach_absolute_time();
+#endif
+}
+
+static void OBTraceRetireThreadBuffer(void *value)
+{
+    struct OBTraceThreadBuffer *buffer = value;
+
+    os_unfair_lock_lock(&ThreadBuffersLock);
+    buffer->retired = true;
+    RetiredThreadBufferCount++;
+    os_unfair_lock_unlock(&ThreadBuffersLock);
+
+    CurrentThreadBuffer = RetiredThreadBuffer;
+}
+
+static struct OBTraceThreadBuffer *OBTraceRegisterCurrentThread(void)
+{
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pthread_key_create(&ThreadBufferKey, OBTraceRetireThreadBuffer);
+    });
+
+    uint64_t threadID = 0;
+    char threadName[64] = "";
+    pthread_threadid_np(NULL, &threadID);
+    pthread_getname_np(pthread_self(), threadName, sizeof(threadName));
+    if (threadName[0] == '\0' && pthread_main_np())
+        strlcpy(threadName, "main", sizeof(threadName));
+
+    struct OBTraceThreadBuffer *buffer = NULL;
+
+    // Threads come and go, so once enough have exited, one of their rings is taken over: whichever was allocated longest ago, being last in the list. That's not necessarily the ring of the thread that exited first.
+    os_unfair_lock_lock(&ThreadBuffersLock);
+    if (RetiredThreadBufferCount > OBTraceRecorderRetiredThreadCount) {
+        for (struct OBTraceThreadBuffer *candidate = ThreadBuffers; candidate != NULL; candidate = candidate->next) {
+            if (candidate->retired)
+                buffer = candidate;
+        }
+        OBASSERT(buffer != NULL);
+        buffer->retired = false;
+        RetiredThreadBufferCount--;
+        atomic_store_explicit(&buffer->eventPosition, 0, memory_order_relaxed);
+        atomic_store_explicit(&buffer->stackPosition, 0, memory_order_relaxed);
+        buffer->threadID = threadID;
+        memcpy(buffer->threadName, threadName, sizeof(threadName));
+    }
+    os_unfair_lock_unlock(&ThreadBuffersLock);
+
+    if (buffer == NULL) {
+        buffer = calloc(1, sizeof(*buffer));
+        if (buffer == NULL) {
+            CurrentThreadBuffer = RetiredThreadBuffer;
+            return RetiredThreadBuffer;
+        }
+        buffer->threadID = threadID;
+        memcpy(buffer->threadName, threadName, sizeof(threadName));
+
+        os_unfair_lock_lock(&ThreadBuffersLock);
+        buffer->next = ThreadBuffers;
+        ThreadBuffers = buffer;
+        os_unfair_lock_unlock(&ThreadBuffersLock);
+    }
+
+    pthread_setspecific(ThreadBufferKey, buffer);
+    CurrentThreadBuffer = buffer;
+    return buffer;
+}
+
+static uint32_t __attribute__((noinline)) OBTraceCaptureStack(struct OBTraceThreadBuffer *buffer)
+{
+    struct OBTraceStack *stacks = atomic_load_explicit(&buffer->stacks, memory_order_relaxed);
+    if (stacks == NULL) {
+        stacks = calloc(OBTraceRecorderStackCount, sizeof(*stacks));
+        if (stacks == NULL)
+            return 0;
+        atomic_store_explicit(&buffer->stacks, stacks, memory_order_release);
+    }
+
+    uint32_t position = atomic_load_explicit(&buffer->stackPosition, memory_order_relaxed);
+    struct OBTraceStack *stack = &stacks[position & (OBTraceRecorderStackCount - 1)];
+    int got = backtrace(stack->frames, OBTraceRecorderStackDepth);
+    if (got < 0)
+        got = 0;
+    while (got < OBTraceRecorderStackDepth)
+        stack->frames[got++] = NULL;
+    atomic_store_explicit(&buffer->stackPosition, position + 1, memory_order_release);
+
+    return position + 1;
+}
+
+void _OBTraceRecordEvent(OBTraceEventType type, const char *name, int64_t value, OBTraceEventOptions options)
+{
+    // Taken before anything else, so that capturing the stack is counted in a span it begins rather than one it ends
+    uint64_t ticks = OBTraceTicks();
+
+    struct OBTraceThreadBuffer *buffer = CurrentThreadBuffer;
+    if (__builtin_expect(buffer == NULL, 0))
+        buffer = OBTraceRegisterCurrentThread();
+    if (__builtin_expect(buffer == RetiredThreadBuffer, 0))
+        return;
+
+    uint32_t stackNumber = 0;
+    if (options & OBTraceEventOptionCaptureStack)
+        stackNumber = OBTraceCaptureStack(buffer);
+
+    uint64_t position = atomic_load_explicit(&buffer->eventPosition, memory_order_relaxed);
+    struct OBTraceEvent *event = &buffer->events[position & (OBTraceRecorderEventCount - 1)];
+    event->ticks = ticks;
+    event->name = name;
+    event->value = value;
+    event->type = type;
+    event->stackNumber = stackNumber;
+    atomic_store_explicit(&buffer->eventPosition, position + 1, memory_order_release);
+}
+
+void OBTraceRecorderStart(void)
+{
+    os_unfair_lock_lock(&ThreadBuffersLock);
+    StartTicks = OBTraceTicks();
+    StartNanoseconds = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+    os_unfair_lock_unlock(&ThreadBuffersLock);
+
+    __atomic_store_n(&_OBTraceRecorderIsRecording, true, __ATOMIC_RELEASE);
+}
+
+void OBTraceRecorderStop(void)
+{
+    __atomic_store_n(&_OBTraceRecorderIsRecording, false, __ATOMIC_RELEASE);
+}
+
+#pragma mark - Chrome trace format
+
+static double OBTraceNanosecondsPerTick(uint64_t startTicks, uint64_t startNanoseconds)
+{
+#if defined(__x86_64__)
+    // The timestamp counter's rate isn't published, so it's measured against the system clock over the life of the trace, and at least a millisecond
+    uint64_t ticks, nanoseconds;
+    while (YES) {
+        ticks = OBTraceTicks();
+        nanoseconds = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+        if (nanoseconds - startNanoseconds >= NSEC_PER_MSEC)
+            break;
+        usleep(1000);
+    }
+    return (double)(nanoseconds - startNanoseconds) / (double)(ticks - startTicks);
+#else
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+    return (double)timebase.numer / (double)timebase.denom;
+#endif
+}
+
+static void OBTraceAppend(NSMutableData *data, const char *format, ...) __attribute__((format(printf, 2, 3)));
+static void OBTraceAppend(NSMutableData *data, const char *format, ...)
+{
+    char string[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(string, sizeof(string), format, args);
+    va_end(args);
+
+    OBASSERT(length >= 0 && (size_t)length < sizeof(string));
+    if (length > 0)
+        [data appendBytes:string length:MIN((size_t)length, sizeof(string) - 1)];
+}
+
+static void OBTraceAppendJSONString(NSMutableData *data, const char *string)
+{
+    [data appendBytes:"\"" length:1];
+    for (const char *run = string; *string != '\0'; run = string) {
+        while (*string != '\0' && *string != '"' && *string != '\\' && (unsigned char)*string >= 0x20)
+            string++;
+        if (string > run)
+            [data appendBytes:run length:string - run];
+        if (*string != '\0') {
+            OBTraceAppend(data, "\\u%04x", (unsigned char)*string);
+            string++;
+        }
+    }
+    [data appendBytes:"\"" length:1];
+}
+
+static void OBTraceAppendStack(NSMutableData *data, const struct OBTraceStack *stack)
+{
+    [data appendBytes:"\"stack\":[" length:9];
+    for (unsigned int frameIndex = OBTraceRecorderSkippedFrameCount; frameIndex < OBTraceRecorderStackDepth && stack->frames[frameIndex] != NULL; frameIndex++) {
+        if (frameIndex > OBTraceRecorderSkippedFrameCount)
+            [data appendBytes:"," length:1];
+
+        void *address = stack->frames[frameIndex];
+        Dl_info info;
+        char frame[256];
+        if (dladdr(address, &info) != 0 && info.dli_sname != NULL)
+            snprintf(frame, sizeof(frame), "%p %s + %lu", address, info.dli_sname, (unsigned long)((uintptr_t)address - (uintptr_t)info.dli_saddr));
+        else
+            snprintf(frame, sizeof(frame), "%p", address);
+        OBTraceAppendJSONString(data, frame);
+    }
+    [data appendBytes:"]" length:1];
+}
+
+NSData *OBTraceRecorderChromeTraceData(void)
+{
+    struct OBTraceEvent *events = malloc(sizeof(*events) * OBTraceRecorderEventCount);
+    struct OBTraceStack *stacks = malloc(sizeof(*stacks) * OBTraceRecorderStackCount);
+    if (events == NULL || stacks == NULL) {
+        free(events);
+        free(stacks);
+        return nil;
+    }
+
+    NSMutableData *data = [NSMutableData data];
+    OBTraceAppend(data, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    int pid = getpid();
+    BOOL first = YES;
+
+    // Rings are never freed and are only ever added at the head of the list, so the list can be walked from here without the lock
+    os_unfair_lock_lock(&ThreadBuffersLock);
+    struct OBTraceThreadBuffer *threadBuffers = ThreadBuffers;
+    uint64_t startTicks = StartTicks;
+    uint64_t startNanoseconds = StartNanoseconds;
+    os_unfair_lock_unlock(&ThreadBuffersLock);
+
+    double nanosecondsPerTick = startTicks != 0 ? OBTraceNanosecondsPerTick(startTicks, startNanoseconds) : 0;
+
+    for (struct OBTraceThreadBuffer *buffer = threadBuffers; buffer != NULL && startTicks != 0; buffer = buffer->next) {
+        // A ring can be taken over by a new thread at any time, so it's copied under the lock, but formatted (which means calling dladdr() for stacks) outside it
+        os_unfair_lock_lock(&ThreadBuffersLock);
+        uint64_t threadID = buffer->threadID;
+        char threadName[sizeof(buffer->threadName)];
+        memcpy(threadName, buffer->threadName, sizeof(threadName));
+
+        // Copy the events and stacks, then see which of them might have been overwritten while we did
+        uint64_t eventEnd = atomic_load_explicit(&buffer->eventPosition, memory_order_acquire);
+        uint64_t eventStart = eventEnd > OBTraceRecorderEventCount ? eventEnd - OBTraceRecorderEventCount : 0;
+        for (uint64_t position = eventStart; position < eventEnd; position++)
+            events[position - eventStart] = buffer->events[position & (OBTraceRecorderEventCount - 1)];
+
+        struct OBTraceStack *bufferStacks = atomic_load_explicit(&buffer->stacks, memory_order_acquire);
+        uint32_t stackEnd = atomic_load_explicit(&buffer->stackPosition, memory_order_acquire);
+        if (bufferStacks != NULL)
+            memcpy(stacks, bufferStacks, sizeof(*stacks) * OBTraceRecorderStackCount);
+
+        atomic_thread_fence(memory_order_acquire);
+        uint64_t eventPositionAfter = atomic_load_explicit(&buffer->eventPosition, memory_order_relaxed);
+        uint32_t stackPositionAfter = atomic_load_explicit(&buffer->stackPosition, memory_order_relaxed);
+        uint64_t firstValidEvent = eventPositionAfter + 2 > OBTraceRecorderEventCount ? eventPositionAfter + 2 - OBTraceRecorderEventCount : 0;
+        os_unfair_lock_unlock(&ThreadBuffersLock);
+
+        OBTraceAppend(data, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%llu,\"args\":{\"name\":", first ? "" : ",\n", pid, threadID);
+        OBTraceAppendJSONString(data, threadName);
+        OBTraceAppend(data, "}}");
+        first = NO;
+
+        for (uint64_t position = MAX(eventStart, firstValidEvent); position < eventEnd; position++) {
+            const struct OBTraceEvent *event = &events[position - eventStart];
+            if (event->ticks < startTicks)
+                continue;
+
+            static const char * const phases[] = {
+                [OBTraceEvent_BeginSpan] = "B",
+                [OBTraceEvent_EndSpan] = "E",
+                [OBTraceEvent_Counter] = "C",
+                [OBTraceEvent_Instant] = "i",
+            };
+            if (event->type == OBTraceEvent_Unused || event->type > OBTraceEvent_Instant) {
+                OBASSERT_NOT_REACHED("Unknown trace event type");
+                continue;
+            }
+
+            double microseconds = (double)(event->ticks - startTicks) * nanosecondsPerTick / 1000.0;
+            OBTraceAppend(data, ",\n{\"name\":");
+            OBTraceAppendJSONString(data, event->name != NULL ? event->name : "");
+            OBTraceAppend(data, ",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":%d,\"tid\":%llu", phases[event->type], microseconds, pid, threadID);
+            if (event->type == OBTraceEvent_Instant)
+                OBTraceAppend(data, ",\"s\":\"t\"");
+
+            // A stack is only trustworthy if it wasn't written after we started copying: see the comment on OBTraceThreadBuffer
+            uint32_t stackPosition = event->stackNumber - 1;
+            BOOL hasStack = event->stackNumber != 0 && bufferStacks != NULL && (int32_t)(stackEnd - stackPosition) > 0 && (int32_t)(stackPositionAfter + 2 - stackPosition) <= OBTraceRecorderStackCount;
+            BOOL hasValue = event->type == OBTraceEvent_Counter || (event->type == OBTraceEvent_Instant && event->value != 0);
+            if (hasStack || hasValue) {
+                OBTraceAppend(data, ",\"args\":{");
+                if (event->type == OBTraceEvent_Counter)
+                    OBTraceAppend(data, "\"value\":%lld", event->value);
+                else if (hasValue)
+                    OBTraceAppend(data, "\"context\":\"0x%llx\"", (unsigned long long)event->value);
+                if (hasStack) {
+                    if (hasValue)
+                        [data appendBytes:"," length:1];
+                    OBTraceAppendStack(data, &stacks[stackPosition & (OBTraceRecorderStackCount - 1)]);
+                }
+                OBTraceAppend(data, "}");
+            }
+            OBTraceAppend(data, "}");
+        }
+    }
+
+    free(events);
+    free(stacks);
+
+    OBTraceAppend(data, "\n]}\n");
+    return data;
+}
@@ -11,6 +11,7 @@
 #import <OmniBase/macros.h>
 #import <OmniBase/rcsid.h>
 #import <OmniBase/OBBacktraceBuffer.h>
+#import <OmniBase/OBTraceRecorder.h>
 
 #if !defined(TARGET_OS_WATCH) || !TARGET_OS_WATCH
 #import <OmniBase/OBBundle.h>
@@ -26,6 +27,7 @@
 #import <OmniBase/OBUtilities.h>
 #import <OmniBase/OBLog.h>
 #import <OmniBase/OBLogger.h>
+#import <OmniBase/OBLogFileSink.h>
 
 #if !defined(TARGET_OS_IPHONE) || !TARGET_OS_IPHONE
 #import <OmniBase/NSData-OBObjectCompatibility.h>
@@ -0,0 +1,120 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import "OBTestCase.h"
+
+#import <OmniBase/OBLogFileSink.h>
+
+#include <stdatomic.h>
+
+RCS_ID("$Id$")
+
+// Times many threads logging at once, through OBLogFileSink with each durability setting and then the way OBLogger used to write its files, opening, writing, fsync()ing and closing the file for every message on a serial queue. Results are logged rather than asserted since they depend on the machine.
+
+@interface OBLogFileSinkBenchmarks : OBTestCase
+@end
+
+@implementation OBLogFileSinkBenchmarks
+{
+    NSURL *_directoryURL;
+}
+
+static const NSUInteger OBLogFileSinkBenchmarkThreadCount = 16;
+static const NSUInteger OBLogFileSinkBenchmarkMessagesPerThread = 20000;
+static const NSUInteger OBLogFileSinkBenchmarkOldPathMessagesPerThread = 200; // Each message costs an fsync(), so this has to be far fewer
+
+static atomic_ulong writtenMessageCount;
+
+- (void)setUp;
+{
+    [super setUp];
+
+    _directoryURL = [[NSURL fileURLWithPath:NSTemporaryDirectory() isDirectory:YES] URLByAppendingPathComponent:[[NSUUID UUID] UUIDString] isDirectory:YES];
+    [[NSFileManager defaultManager] createDirectoryAtURL:_directoryURL withIntermediateDirectories:YES attributes:nil error:NULL];
+}
+
+- (void)tearDown;
+{
+    [[NSFileManager defaultManager] removeItemAtURL:_directoryURL error:NULL];
+    _directoryURL = nil;
+
+    [super tearDown];
+}
+
+// Runs the log block for every message from each thread, then the finish block, and reports the rate at which messages were logged and at which they reached the file.
+static void _timeLogging(NSString *title, NSUInteger messagesPerThread, void (^log)(NSString *message), void (^finish)(void))
+{
+    NSUInteger messageCount = OBLogFileSinkBenchmarkThreadCount * messagesPerThread;
+    double *logTimes = calloc(OBLogFileSinkBenchmarkThreadCount, sizeof(*logTimes));
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    dispatch_apply(OBLogFileSinkBenchmarkThreadCount, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t threadIndex) {
+        CFAbsoluteTime threadStart = CFAbsoluteTimeGetCurrent();
+        for (NSUInteger messageIndex = 0; messageIndex < messagesPerThread; messageIndex++) {
+            @autoreleasepool {
+                log([NSString stringWithFormat:@"thread %zu message %lu: something happened", threadIndex, messageIndex]);
+            }
+        }
+        logTimes[threadIndex] = CFAbsoluteTimeGetCurrent() - threadStart;
+    });
+    CFAbsoluteTime logged = CFAbsoluteTimeGetCurrent();
+    finish();
+    CFAbsoluteTime written = CFAbsoluteTimeGetCurrent();
+
+    double totalLogTime = 0;
+    for (NSUInteger threadIndex = 0; threadIndex < OBLogFileSinkBenchmarkThreadCount; threadIndex++)
+        totalLogTime += logTimes[threadIndex];
+
+    NSLog(@"%@: %lu messages from %lu threads, %.0f messages/s logged (%.2fus per call), %.0f messages/s written, %lu written", title, messageCount, OBLogFileSinkBenchmarkThreadCount,
+          messageCount / (logged - start), totalLogTime / messageCount * 1e6, messageCount / (written - start), atomic_load(&writtenMessageCount));
+
+    free(logTimes);
+}
+
+- (void)testConcurrentLogging;
+{
+    NSArray *durabilities = @[@(OBLogFileSinkDurabilityWrite), @(OBLogFileSinkDurabilitySync), @(OBLogFileSinkDurabilityFullSync)];
+    NSArray *durabilityNames = @[@"write", @"sync", @"full sync"];
+
+    for (NSUInteger durabilityIndex = 0; durabilityIndex < [durabilities count]; durabilityIndex++) {
+        OBLogFileSink *sink = [[OBLogFileSink alloc] initWithDirectoryURL:_directoryURL fileNamePrefix:[NSString stringWithFormat:@"Benchmark %lu", durabilityIndex]];
+        sink.durability = [durabilities[durabilityIndex] integerValue];
+
+        _timeLogging([NSString stringWithFormat:@"sink, %@", durabilityNames[durabilityIndex]], OBLogFileSinkBenchmarkMessagesPerThread, ^(NSString *message) {
+            [sink appendMessage:message];
+        }, ^{
+            [sink invalidate];
+            atomic_store(&writtenMessageCount, OBLogFileSinkBenchmarkThreadCount * OBLogFileSinkBenchmarkMessagesPerThread - sink.droppedMessageCount);
+        });
+    }
+
+    // What OBLogger used to do
+    NSOperationQueue *queue = [[NSOperationQueue alloc] init];
+    queue.maxConcurrentOperationCount = 1;
+    NSDateFormatter *dateFormatter = [[NSDateFormatter alloc] init];
+    [dateFormatter setTimeZone:[NSTimeZone timeZoneWithAbbreviation:@"GMT"]];
+    [dateFormatter setDateFormat:@"yyyy-MM-dd HH:mm:ss.SSS ZZZ"];
+    const char *path = [[[_directoryURL URLByAppendingPathComponent:@"Old path.log" isDirectory:NO] path] fileSystemRepresentation];
+    atomic_store(&writtenMessageCount, 0);
+
+    _timeLogging(@"open, write, fsync and close per message", OBLogFileSinkBenchmarkOldPathMessagesPerThread, ^(NSString *message) {
+        [queue addOperationWithBlock:^{
+            NSString *timeStampedMessage = [[NSString alloc] initWithFormat:@"%@: %@\n", [dateFormatter stringFromDate:[NSDate date]], message];
+            NSData *data = [timeStampedMessage dataUsingEncoding:NSUTF8StringEncoding];
+            FILE *file = fopen(path, "a");
+            if (file == NULL)
+                return;
+            if (fwrite([data bytes], 1, [data length], file) == [data length] && fsync(fileno(file)) == 0)
+                atomic_fetch_add(&writtenMessageCount, 1);
+            fclose(file);
+        }];
+    }, ^{
+        [queue waitUntilAllOperationsAreFinished];
+    });
+}
+
+@end
@@ -0,0 +1,200 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import "OBTestCase.h"
+
+#import <OmniBase/OBLogFileSink.h>
+
+RCS_ID("$Id$")
+
+@interface OBLogFileSinkTests : OBTestCase
+@end
+
+@implementation OBLogFileSinkTests
+{
+    NSURL *_directoryURL;
+}
+
+- (void)setUp;
+{
+    [super setUp];
+
+    _directoryURL = [[NSURL fileURLWithPath:NSTemporaryDirectory() isDirectory:YES] URLByAppendingPathComponent:[[NSUUID UUID] UUIDString] isDirectory:YES];
+    __autoreleasing NSError *error = nil;
+    XCTAssertTrue([[NSFileManager defaultManager] createDirectoryAtURL:_directoryURL withIntermediateDirectories:YES attributes:nil error:&error], @"%@", error);
+}
+
+- (void)tearDown;
+{
+    [[NSFileManager defaultManager] removeItemAtURL:_directoryURL error:NULL];
+    _directoryURL = nil;
+
+    [super tearDown];
+}
+
+// The messages from every file the sink wrote, oldest file first, without their timestamps
+- (NSArray *)_loggedMessages;
+{
+    NSArray *fileURLs = [[NSFileManager defaultManager] contentsOfDirectoryAtURL:_directoryURL includingPropertiesForKeys:nil options:0 error:NULL];
+    fileURLs = [fileURLs sortedArrayUsingComparator:^NSComparisonResult(NSURL *url1, NSURL *url2) {
+        // Files started in the same second are numbered: "Test <time>.log", "Test <time> 2.log", ...
+        return [[[url1 lastPathComponent] stringByDeletingPathExtension] localizedStandardCompare:[[url2 lastPathComponent] stringByDeletingPathExtension]];
+    }];
+
+    NSMutableArray *messages = [NSMutableArray array];
+    for (NSURL *fileURL in fileURLs) {
+        XCTAssertTrue([[fileURL lastPathComponent] hasPrefix:@"Test "]);
+        XCTAssertTrue([[fileURL lastPathComponent] hasSuffix:@".log"]);
+
+        NSString *contents = [NSString stringWithContentsOfURL:fileURL encoding:NSUTF8StringEncoding error:NULL];
+        XCTAssertTrue([contents hasSuffix:@"\n"]);
+        for (NSString *line in [contents componentsSeparatedByString:@"\n"]) {
+            if ([line length] == 0)
+                continue;
+            NSRange separatorRange = [line rangeOfString:@" +0000: "];
+            XCTAssertEqual(separatorRange.location, 23UL, @"Expected a timestamp on \"%@\"", line);
+            [messages addObject:[line substringFromIndex:NSMaxRange(separatorRange)]];
+        }
+    }
+    return messages;
+}
+
+- (void)testFlushWritesMessages;
+{
+    OBLogFileSink *sink = [[OBLogFileSink alloc] initWithDirectoryURL:_directoryURL fileNamePrefix:@"Test"];
+    sink.flushInterval = 60; // Only the flush should write anything
+
+    NSString *longMessage = [@"" stringByPaddingToLength:100000 withString:@"long message " startingAtIndex:0];
+    XCTAssertTrue([sink appendMessage:@"first"]);
+    XCTAssertTrue([sink appendMessage:@"café"]);
+    XCTAssertTrue([sink appendMessage:longMessage]);
+    XCTAssertTrue([sink appendMessage:@"last"]);
+    [sink flush];
+
+    NSArray *expected = @[@"first", @"café", longMessage, @"last"];
+    XCTAssertEqualObjects([self _loggedMessages], expected);
+
+    [sink invalidate];
+    XCTAssertFalse([sink appendMessage:@"too late"]);
+    XCTAssertEqualObjects([self _loggedMessages], expected);
+}
+
+- (void)testConcurrentProducersKeepTheirOrder;
+{
+    static const NSUInteger threadCount = 8;
+    static const NSUInteger messagesPerThread = 2000;
+
+    OBLogFileSink *sink = [[OBLogFileSink alloc] initWithDirectoryURL:_directoryURL fileNamePrefix:@"Test"];
+    sink.durability = OBLogFileSinkDurabilityWrite;
+
+    // Back off when the ring is full so that nothing is dropped; dropping is covered separately
+    dispatch_apply(threadCount, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t threadIndex) {
+        for (NSUInteger messageIndex = 0; messageIndex < messagesPerThread; messageIndex++) {
+            NSString *message = [NSString stringWithFormat:@"%zu %lu", threadIndex, messageIndex];
+            while (![sink appendMessage:message])
+                usleep(100);
+        }
+    });
+    [sink invalidate];
+
+    NSUInteger nextMessageIndex[threadCount] = {0};
+    NSArray *messages = [self _loggedMessages];
+    NSUInteger droppedCount = sink.droppedMessageCount;
+    NSUInteger noteCount = 0;
+    for (NSString *message in messages) {
+        if ([message hasSuffix:@"messages dropped)"]) {
+            noteCount++;
+            continue;
+        }
+        NSArray *components = [message componentsSeparatedByString:@" "];
+        NSUInteger threadIndex = (NSUInteger)[components[0] integerValue];
+        NSUInteger messageIndex = (NSUInteger)[components[1] integerValue];
+        if (threadIndex >= threadCount) {
+            XCTFail(@"Unexpected message \"%@\"", message);
+            continue;
+        }
+        XCTAssertEqual(messageIndex, nextMessageIndex[threadIndex], @"Messages from thread %lu are out of order", threadIndex);
+        nextMessageIndex[threadIndex] = messageIndex + 1;
+    }
+    for (NSUInteger threadIndex = 0; threadIndex < threadCount; threadIndex++)
+        XCTAssertEqual(nextMessageIndex[threadIndex], messagesPerThread);
+    XCTAssertEqual([messages count], threadCount * messagesPerThread + noteCount);
+    XCTAssertTrue(droppedCount == 0 || noteCount > 0);
+}
+
+- (void)testDroppedMessagesAreNoted;
+{
+    OBLogFileSink *sink = [[OBLogFileSink alloc] initWithDirectoryURL:_directoryURL fileNamePrefix:@"Test"];
+    sink.flushInterval = 60;
+
+    // While the writer waits for each batch to be synchronized, appending many times what the ring holds as fast as we can has to drop some
+    NSUInteger appendedCount = 0;
+    for (NSUInteger messageIndex = 0; messageIndex < 100000; messageIndex++) {
+        if ([sink appendMessage:@"message"])
+            appendedCount++;
+    }
+    [sink invalidate];
+
+    NSUInteger droppedCount = sink.droppedMessageCount;
+    XCTAssertGreaterThan(droppedCount, 0UL);
+    XCTAssertEqual(appendedCount + droppedCount, 100000UL);
+
+    NSUInteger writtenCount = 0, notedDroppedCount = 0;
+    for (NSString *message in [self _loggedMessages]) {
+        if ([message isEqualToString:@"message"])
+            writtenCount++;
+        else {
+            unsigned long count = 0;
+            XCTAssertEqual(sscanf([message UTF8String], "(%lu messages dropped)", &count), 1);
+            notedDroppedCount += count;
+        }
+    }
+    XCTAssertEqual(writtenCount, appendedCount);
+    XCTAssertEqual(notedDroppedCount, droppedCount);
+}
+
+- (void)testMessagesWithoutAFileAreCountedAsDropped;
+{
+    NSURL *missingDirectoryURL = [_directoryURL URLByAppendingPathComponent:@"missing" isDirectory:YES];
+    OBLogFileSink *sink = [[OBLogFileSink alloc] initWithDirectoryURL:missingDirectoryURL fileNamePrefix:@"Test"];
+
+    // The ring has room for these, but there's nowhere to write them
+    XCTAssertTrue([sink appendMessage:@"first"]);
+    XCTAssertTrue([sink appendMessage:@"second"]);
+    XCTAssertTrue([sink appendMessage:@"third"]);
+    [sink flush];
+    XCTAssertEqual(sink.droppedMessageCount, 3UL);
+
+    [sink invalidate];
+    XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:[missingDirectoryURL path]]);
+}
+
+- (void)testRotatesAtMaximumFileSize;
+{
+    OBLogFileSink *sink = [[OBLogFileSink alloc] initWithDirectoryURL:_directoryURL fileNamePrefix:@"Test"];
+    sink.maximumFileSize = 1024;
+    sink.durability = OBLogFileSinkDurabilityWrite;
+
+    // Files are checked at the start of each batch, so each flush can start a new one
+    NSMutableArray *expected = [NSMutableArray array];
+    NSString *message = [@"" stringByPaddingToLength:600 withString:@"x" startingAtIndex:0];
+    for (NSUInteger batchIndex = 0; batchIndex < 5; batchIndex++) {
+        NSString *batchMessage = [NSString stringWithFormat:@"%lu %@", batchIndex, message];
+        [sink appendMessage:batchMessage];
+        [sink appendMessage:batchMessage];
+        [expected addObject:batchMessage];
+        [expected addObject:batchMessage];
+        [sink flush];
+    }
+    [sink invalidate];
+
+    NSArray *fileURLs = [[NSFileManager defaultManager] contentsOfDirectoryAtURL:_directoryURL includingPropertiesForKeys:nil options:0 error:NULL];
+    XCTAssertEqual([fileURLs count], 5UL);
+    XCTAssertEqualObjects([self _loggedMessages], expected);
+}
+
+@end
@@ -0,0 +1,111 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import "OBTestCase.h"
+
+#import <OmniBase/OBTraceRecorder.h>
+
+RCS_ID("$Id$")
+
+// Times recording events from increasing numbers of threads at once: with the recorder stopped, recording spans and counters, capturing stacks, and for comparison OBRecordBacktrace(), whose threads all contend for one shared ring. Results are logged rather than asserted since they depend on the machine.
+
+#ifdef OMNI_TRACING_ON
+
+@interface OBTraceRecorderBenchmarks : OBTestCase
+@end
+
+@implementation OBTraceRecorderBenchmarks
+
+static const NSUInteger OBTraceRecorderBenchmarkThreadCounts[] = {1, 4, 16};
+static const NSUInteger OBTraceRecorderBenchmarkEventsPerThread = 1000000;
+static const NSUInteger OBTraceRecorderBenchmarkSlowEventsPerThread = 20000; // For the ones which take a backtrace
+
+- (void)tearDown;
+{
+    OBTraceRecorderStop();
+    [super tearDown];
+}
+
+// Runs the record block the given number of times on each thread, all starting together, and reports the average time per call on a thread
+static void _timeRecording(NSString *title, NSUInteger eventsPerThread, void (^record)(NSUInteger eventIndex))
+{
+    for (NSUInteger countIndex = 0; countIndex < sizeof(OBTraceRecorderBenchmarkThreadCounts) / sizeof(*OBTraceRecorderBenchmarkThreadCounts); countIndex++) {
+        NSUInteger threadCount = OBTraceRecorderBenchmarkThreadCounts[countIndex];
+        double *threadTimes = calloc(threadCount, sizeof(*threadTimes));
+        dispatch_group_t ready = dispatch_group_create();
+        dispatch_group_t finished = dispatch_group_create();
+        dispatch_semaphore_t go = dispatch_semaphore_create(0);
+
+        for (NSUInteger threadIndex = 0; threadIndex < threadCount; threadIndex++) {
+            dispatch_group_enter(ready);
+            dispatch_group_enter(finished);
+            [NSThread detachNewThreadWithBlock:^{
+                dispatch_group_leave(ready);
+                dispatch_semaphore_wait(go, DISPATCH_TIME_FOREVER);
+
+                CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+                for (NSUInteger eventIndex = 0; eventIndex < eventsPerThread; eventIndex++)
+                    record(eventIndex);
+                threadTimes[threadIndex] = CFAbsoluteTimeGetCurrent() - start;
+
+                dispatch_group_leave(finished);
+            }];
+        }
+        dispatch_group_wait(ready, DISPATCH_TIME_FOREVER);
+        for (NSUInteger threadIndex = 0; threadIndex < threadCount; threadIndex++)
+            dispatch_semaphore_signal(go);
+        dispatch_group_wait(finished, DISPATCH_TIME_FOREVER);
+
+        double totalTime = 0, slowestTime = 0;
+        for (NSUInteger threadIndex = 0; threadIndex < threadCount; threadIndex++) {
+            totalTime += threadTimes[threadIndex];
+            slowestTime = MAX(slowestTime, threadTimes[threadIndex]);
+        }
+        NSLog(@"%@, %lu threads: %.1fns per event, %.0f events/s overall", title, threadCount,
+              totalTime / (threadCount * eventsPerThread) * 1e9, (threadCount * eventsPerThread) / slowestTime);
+
+        free(threadTimes);
+    }
+}
+
+- (void)testEventCost;
+{
+    _timeRecording(@"stopped", OBTraceRecorderBenchmarkEventsPerThread, ^(NSUInteger eventIndex) {
+        OBTraceCounter("benchmark counter", eventIndex);
+    });
+
+    OBTraceRecorderStart();
+    _timeRecording(@"counter", OBTraceRecorderBenchmarkEventsPerThread, ^(NSUInteger eventIndex) {
+        OBTraceCounter("benchmark counter", eventIndex);
+    });
+    // Two events per call; the cost is reported per call
+    _timeRecording(@"span (begin and end)", OBTraceRecorderBenchmarkEventsPerThread, ^(NSUInteger eventIndex) {
+        OBTraceScope("benchmark span");
+    });
+    _timeRecording(@"instant with stack", OBTraceRecorderBenchmarkSlowEventsPerThread, ^(NSUInteger eventIndex) {
+        OBTraceInstantWithStack("benchmark instant");
+    });
+    OBTraceRecorderStop();
+
+    _timeRecording(@"OBRecordBacktrace", OBTraceRecorderBenchmarkSlowEventsPerThread, ^(NSUInteger eventIndex) {
+        OBRecordBacktrace("benchmark backtrace", OBBacktraceBuffer_Generic);
+    });
+
+    // Dumping isn't on anyone's hot path, but shouldn't take forever either
+    OBTraceRecorderStart();
+    _timeRecording(@"counter before dump", OBTraceRecorderBenchmarkEventsPerThread / 10, ^(NSUInteger eventIndex) {
+        OBTraceCounter("benchmark counter", eventIndex);
+    });
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    NSData *trace = OBTraceRecorderChromeTraceData();
+    NSLog(@"dump: %lu bytes in %.3fs", [trace length], CFAbsoluteTimeGetCurrent() - start);
+    OBTraceRecorderStop();
+}
+
+@end
+
+#endif
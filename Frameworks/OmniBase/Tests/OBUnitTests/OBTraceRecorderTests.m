@@ -0,0 +1,172 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import "OBTestCase.h"
+
+#import <OmniBase/OBTraceRecorder.h>
+
+RCS_ID("$Id$")
+
+#ifdef OMNI_TRACING_ON
+
+@interface OBTraceRecorderTests : OBTestCase
+@end
+
+@implementation OBTraceRecorderTests
+
+- (void)tearDown;
+{
+    OBTraceRecorderStop();
+    [super tearDown];
+}
+
+static NSArray *_tracedEvents(OBTraceRecorderTests *self)
+{
+    NSData *data = OBTraceRecorderChromeTraceData();
+    __autoreleasing NSError *error = nil;
+    NSDictionary *trace = [NSJSONSerialization JSONObjectWithData:data options:0 error:&error];
+    XCTAssertNotNil(trace, @"%@", error);
+    XCTAssertEqualObjects(trace[@"displayTimeUnit"], @"ns");
+    return trace[@"traceEvents"];
+}
+
+// The events with the given name, in the order each thread recorded them
+static NSArray *_eventsNamed(NSArray *events, NSString *name)
+{
+    NSMutableArray *matching = [NSMutableArray array];
+    for (NSDictionary *event in events) {
+        if ([event[@"name"] isEqualToString:name])
+            [matching addObject:event];
+    }
+    return matching;
+}
+
+static void _scopedWork(void)
+{
+    OBTraceScope("test scope");
+    OBTraceCounter("test counter", 42);
+    OBTraceInstantWithContext("test instant", (void *)0x1234);
+    OBTraceInstantWithStack("test stack");
+}
+
+- (void)testEventsAreRecordedInOrder;
+{
+    OBTraceInstant("before start");
+    OBTraceRecorderStart();
+    OBTraceBeginSpan("test span");
+    _scopedWork();
+    OBTraceEndSpan("test span");
+    OBTraceRecorderStop();
+    OBTraceInstant("after stop");
+
+    NSArray *events = _tracedEvents(self);
+    XCTAssertEqual([_eventsNamed(events, @"before start") count], 0UL);
+    XCTAssertEqual([_eventsNamed(events, @"after stop") count], 0UL);
+
+    NSArray *names = @[@"test span", @"test scope", @"test counter", @"test instant", @"test stack", @"test scope", @"test span"];
+    NSArray *phases = @[@"B", @"B", @"C", @"i", @"i", @"E", @"E"];
+    NSMutableArray *recorded = [NSMutableArray array];
+    for (NSDictionary *event in events) {
+        if ([names containsObject:event[@"name"]])
+            [recorded addObject:event];
+    }
+    XCTAssertEqualObjects([recorded valueForKey:@"name"], names);
+    XCTAssertEqualObjects([recorded valueForKey:@"ph"], phases);
+
+    double previousTimestamp = 0;
+    for (NSDictionary *event in recorded) {
+        XCTAssertEqualObjects(event[@"pid"], @(getpid()));
+        XCTAssertEqualObjects(event[@"tid"], recorded[0][@"tid"]);
+        XCTAssertGreaterThanOrEqual([event[@"ts"] doubleValue], previousTimestamp);
+        previousTimestamp = [event[@"ts"] doubleValue];
+    }
+
+    XCTAssertEqualObjects(recorded[2][@"args"][@"value"], @42);
+    XCTAssertEqualObjects(recorded[3][@"args"][@"context"], @"0x1234");
+    NSArray *stack = recorded[4][@"args"][@"stack"];
+    XCTAssertGreaterThan([stack count], 0UL);
+    for (NSString *frame in stack)
+        XCTAssertTrue([frame hasPrefix:@"0x"], @"Expected an address first in \"%@\"", frame);
+
+    // Each thread is named by a metadata event
+    NSUInteger threadNameCount = 0;
+    for (NSDictionary *event in _eventsNamed(events, @"thread_name")) {
+        XCTAssertEqualObjects(event[@"ph"], @"M");
+        if ([event[@"tid"] isEqual:recorded[0][@"tid"]])
+            threadNameCount++;
+    }
+    XCTAssertEqual(threadNameCount, 1UL);
+}
+
+- (void)testThreadsRecordSeparately;
+{
+    static const NSUInteger threadCount = 8;
+    static const NSUInteger spansPerThread = 1000;
+
+    OBTraceRecorderStart();
+    dispatch_group_t group = dispatch_group_create();
+    for (NSUInteger threadIndex = 0; threadIndex < threadCount; threadIndex++) {
+        dispatch_group_enter(group);
+        NSThread *thread = [[NSThread alloc] initWithBlock:^{
+            for (NSUInteger spanIndex = 0; spanIndex < spansPerThread; spanIndex++) {
+                OBTraceBeginSpan("thread span");
+                OBTraceCounter("thread counter", spanIndex);
+                OBTraceEndSpan("thread span");
+            }
+            dispatch_group_leave(group);
+        }];
+        thread.name = [NSString stringWithFormat:@"trace test %lu", threadIndex];
+        [thread start];
+    }
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    OBTraceRecorderStop();
+
+    NSArray *events = _tracedEvents(self);
+    NSMutableDictionary *countersByThread = [NSMutableDictionary dictionary];
+    for (NSDictionary *event in _eventsNamed(events, @"thread counter")) {
+        NSMutableArray *values = countersByThread[event[@"tid"]];
+        if (values == nil)
+            countersByThread[event[@"tid"]] = values = [NSMutableArray array];
+        [values addObject:event[@"args"][@"value"]];
+    }
+    XCTAssertEqual([countersByThread count], threadCount);
+    for (NSArray *values in [countersByThread allValues]) {
+        XCTAssertEqual([values count], spansPerThread);
+        for (NSUInteger spanIndex = 0; spanIndex < [values count]; spanIndex++)
+            XCTAssertEqualObjects(values[spanIndex], @(spanIndex));
+    }
+
+    NSMutableSet *threadNames = [NSMutableSet set];
+    for (NSDictionary *event in _eventsNamed(events, @"thread_name")) {
+        if (countersByThread[event[@"tid"]] != nil)
+            [threadNames addObject:event[@"args"][@"name"]];
+    }
+    XCTAssertEqual([threadNames count], threadCount);
+    XCTAssertTrue([threadNames containsObject:@"trace test 0"]);
+}
+
+- (void)testRingKeepsMostRecentEvents;
+{
+    // Far more than a thread's ring holds
+    static const NSUInteger eventCount = 100000;
+
+    OBTraceRecorderStart();
+    for (NSUInteger eventIndex = 0; eventIndex < eventCount; eventIndex++)
+        OBTraceCounter("overflow counter", eventIndex);
+    OBTraceRecorderStop();
+
+    NSArray *values = [[_eventsNamed(_tracedEvents(self), @"overflow counter") valueForKey:@"args"] valueForKey:@"value"];
+    XCTAssertGreaterThan([values count], 0UL);
+    XCTAssertLessThan([values count], eventCount);
+    XCTAssertEqualObjects([values lastObject], @(eventCount - 1));
+    for (NSUInteger valueIndex = 1; valueIndex < [values count]; valueIndex++)
+        XCTAssertEqual([values[valueIndex] unsignedIntegerValue], [values[valueIndex - 1] unsignedIntegerValue] + 1);
+}
+
+@end
+
+#endif
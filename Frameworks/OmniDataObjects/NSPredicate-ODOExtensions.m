@@ -10,6 +10,7 @@
 
 #import <OmniDataObjects/ODOEntity.h>
 #import <OmniDataObjects/ODOProperty.h>
+#import <OmniDataObjects/ODORelationship.h>
 
 #import "ODOObject-Accessors.h"
 
@@ -193,9 +194,6 @@ static inline ODOCompiledPredicate _CheckPredicate(ODOCompiledPredicate compiled
         });
     }
 
-#ifdef DEBUG
-    NSLog(@"🟪 Unable to compile predicate %@", self);
-#endif
     return CheckPredicate(^(id object){
         return [self evaluateWithObject:object];
     });
@@ -329,6 +327,10 @@ static inline ODOCompiledExpressionEvaluator _CheckExpression(ODOCompiledExpress
             if (!property) {
                 break;
             }
+            // Only stored values can be read directly; transient values may need calculating and to-many relationships may need fetching.
+            if ([property isTransient] || ([property isKindOfClass:[ODORelationship class]] && [(ODORelationship *)property isToMany])) {
+                break;
+            }
             return CheckExpression(^(id object){
                 return ODOObjectPrimitiveValueForProperty(object, property);
             });
@@ -343,12 +345,8 @@ static inline ODOCompiledExpressionEvaluator _CheckExpression(ODOCompiledExpress
             break;
     }
 
-#ifdef DEBUG
-    NSLog(@"🟪 Unable to compile expression %@", self);
-#endif
-
-    return [^(id object){
-        [self expressionValueWithObject:object context:nil];
+    return [^id(id object){
+        return [self expressionValueWithObject:object context:nil];
     } copy];
 }
 
@@ -361,7 +359,8 @@ static inline ODOCompiledExpressionEvaluator _CheckExpression(ODOCompiledExpress
 - (ODOCompiledPredicate)copyCompiledPredicateWithEntity:(id)entity;
 {
     // customSelector is only 'custom' if the operator is NSCustomSelectorPredicateOperatorType. Other
-    if (self.comparisonPredicateModifier != NSDirectPredicateModifier) {
+    // The blocks below compare with -isEqual: and -compare:, so case and diacritic insensitive comparisons are left to NSComparisonPredicate.
+    if (self.comparisonPredicateModifier != NSDirectPredicateModifier || self.options != 0) {
         return [super copyCompiledPredicateWithEntity:entity];
     }
 
@@ -371,9 +370,26 @@ static inline ODOCompiledExpressionEvaluator _CheckExpression(ODOCompiledExpress
     ODOCompiledExpressionEvaluator rightEvaluator = [self.rightExpression copyCompiledExpressionEvaluatorWithEntity:entity];
 
     switch (self.predicateOperatorType) {
+        // Ordered comparisons never match nil, matching NSComparisonPredicate.
         case NSLessThanPredicateOperatorType:
             return CheckPredicate(^BOOL(id object){
-                return [leftEvaluator(object) compare:rightEvaluator(object)] == NSOrderedAscending;
+                id lhs = leftEvaluator(object), rhs = rightEvaluator(object);
+                return lhs != nil && rhs != nil && [lhs compare:rhs] == NSOrderedAscending;
+            });
+        case NSLessThanOrEqualToPredicateOperatorType:
+            return CheckPredicate(^BOOL(id object){
+                id lhs = leftEvaluator(object), rhs = rightEvaluator(object);
+                return lhs != nil && rhs != nil && [lhs compare:rhs] != NSOrderedDescending;
+            });
+        case NSGreaterThanPredicateOperatorType:
+            return CheckPredicate(^BOOL(id object){
+                id lhs = leftEvaluator(object), rhs = rightEvaluator(object);
+                return lhs != nil && rhs != nil && [lhs compare:rhs] == NSOrderedDescending;
+            });
+        case NSGreaterThanOrEqualToPredicateOperatorType:
+            return CheckPredicate(^BOOL(id object){
+                id lhs = leftEvaluator(object), rhs = rightEvaluator(object);
+                return lhs != nil && rhs != nil && [lhs compare:rhs] != NSOrderedAscending;
             });
         case NSEqualToPredicateOperatorType:
             return CheckPredicate(^BOOL(id object){
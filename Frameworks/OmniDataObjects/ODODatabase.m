@@ -24,6 +24,7 @@
 #import "ODOSQLStatement.h"
 
 #import <sqlite3.h>
+#include <stdatomic.h>
 
 RCS_ID("$Id$")
 
@@ -33,22 +34,230 @@ NSString * const ODODatabaseMetadataTableName = @"ODOMetadata";
 NSString * const ODODatabaseMetadataKeyColumnName = @"key";
 NSString * const ODODatabaseMetadataPlistColumnName = @"value";
 
-static BOOL isPlainASCII(const unsigned char *str)
+#pragma mark - String folding
+
+// Case and diacritic folding of UTF-8 text, done directly on the bytes SQLite hands us. ASCII is folded inline; the rest of the BMP is folded through tables built lazily, one 256 code point page at a time for each option set, using CFStringFold. Each page stores the concatenated UTF-8 of its folded code points along with offsets into it, since folding can expand (ß -> ss) or, for combining marks when ignoring diacritics, remove a code point entirely. Code points outside the BMP and malformed sequences are passed through unchanged.
+
+#define ODOFoldOptionsMask (NSCaseInsensitivePredicateOption|NSDiacriticInsensitivePredicateOption)
+#define ODOFoldMaximumCodePointLength (16)
+
+typedef struct {
+    uint16_t offsets[257];
+    uint8_t bytes[];
+} ODOFoldPage;
+
+static _Atomic(ODOFoldPage *) ODOFoldPages[ODOFoldOptionsMask + 1][256];
+
+static ODOFoldPage *ODOFoldPageCreate(unsigned int pageIndex, NSComparisonPredicateOptions options)
 {
-    char c;
-    while ((c = *str)) {
-        if (c & 0x80)
-            return NO;
-        str++;
+    CFOptionFlags foldFlags = 0;
+    if (options & NSCaseInsensitivePredicateOption)
+        foldFlags |= kCFCompareCaseInsensitive;
+    if (options & NSDiacriticInsensitivePredicateOption)
+        foldFlags |= kCFCompareDiacriticInsensitive;
+
+    uint16_t offsets[257];
+    uint8_t bytes[256 * ODOFoldMaximumCodePointLength];
+    size_t length = 0;
+
+    CFMutableStringRef string = CFStringCreateMutable(kCFAllocatorDefault, 0);
+    for (unsigned int pageOffset = 0; pageOffset < 256; pageOffset++) {
+        UniChar character = (UniChar)((pageIndex << 8) | pageOffset);
+        offsets[pageOffset] = (uint16_t)length;
+
+        CFIndex foldedLength = 0;
+        if (!CFStringIsSurrogateHighCharacter(character) && !CFStringIsSurrogateLowCharacter(character)) {
+            CFStringReplaceAll(string, CFSTR(""));
+            CFStringAppendCharacters(string, &character, 1);
+            CFStringFold(string, foldFlags, NULL/*locale*/);
+
+            CFIndex usedLength = 0;
+            CFIndex convertedCount = CFStringGetBytes(string, CFRangeMake(0, CFStringGetLength(string)), kCFStringEncodingUTF8, 0/*lossByte*/, false, &bytes[length], ODOFoldMaximumCodePointLength, &usedLength);
+            if (convertedCount == CFStringGetLength(string))
+                foldedLength = usedLength;
+            else
+                foldedLength = -1; // Didn't fit; leave this one unfolded
+        } else
+            foldedLength = -1;
+
+        if (foldedLength < 0) {
+            // Encode the character itself
+            if (character < 0x80) {
+                bytes[length] = (uint8_t)character;
+                foldedLength = 1;
+            } else if (character < 0x800) {
+                bytes[length + 0] = (uint8_t)(0xC0 | (character >> 6));
+                bytes[length + 1] = (uint8_t)(0x80 | (character & 0x3F));
+                foldedLength = 2;
+            } else {
+                bytes[length + 0] = (uint8_t)(0xE0 | (character >> 12));
+                bytes[length + 1] = (uint8_t)(0x80 | ((character >> 6) & 0x3F));
+                bytes[length + 2] = (uint8_t)(0x80 | (character & 0x3F));
+                foldedLength = 3;
+            }
+        }
+        length += foldedLength;
     }
-    return YES;
+    offsets[256] = (uint16_t)length;
+    CFRelease(string);
+
+    ODOFoldPage *page = malloc(sizeof(*page) + length);
+    memcpy(page->offsets, offsets, sizeof(offsets));
+    memcpy(page->bytes, bytes, length);
+    return page;
+}
+
+static const ODOFoldPage *ODOFoldPageGet(unsigned int pageIndex, NSComparisonPredicateOptions options)
+{
+    _Atomic(ODOFoldPage *) *slot = &ODOFoldPages[options][pageIndex];
+    ODOFoldPage *page = atomic_load_explicit(slot, memory_order_acquire);
+    if (page != NULL)
+        return page;
+
+    ODOFoldPage *newPage = ODOFoldPageCreate(pageIndex, options);
+    ODOFoldPage *expected = NULL;
+    if (atomic_compare_exchange_strong_explicit(slot, &expected, newPage, memory_order_acq_rel, memory_order_acquire))
+        return newPage;
+
+    // Another thread built the same page first
+    free(newPage);
+    return expected;
+}
+
+typedef struct {
+    uint8_t *bytes;
+    size_t length;
+    size_t capacity;
+    uint8_t inlineStorage[512];
+} ODOFoldBuffer;
+
+static void ODOFoldBufferInit(ODOFoldBuffer *buffer)
+{
+    buffer->bytes = buffer->inlineStorage;
+    buffer->length = 0;
+    buffer->capacity = sizeof(buffer->inlineStorage);
+}
+
+static void ODOFoldBufferFree(ODOFoldBuffer *buffer)
+{
+    if (buffer->bytes != buffer->inlineStorage)
+        free(buffer->bytes);
+}
+
+static void ODOFoldBufferReserve(ODOFoldBuffer *buffer, size_t additionalLength)
+{
+    size_t requiredCapacity = buffer->length + additionalLength;
+    if (requiredCapacity <= buffer->capacity)
+        return;
+
+    size_t newCapacity = MAX(2 * buffer->capacity, requiredCapacity);
+    if (buffer->bytes == buffer->inlineStorage) {
+        buffer->bytes = malloc(newCapacity);
+        memcpy(buffer->bytes, buffer->inlineStorage, buffer->length);
+    } else
+        buffer->bytes = reallocf(buffer->bytes, newCapacity);
+    buffer->capacity = newCapacity;
 }
 
+// Appends the folded form of the given UTF-8 bytes, stopping early once at least stopLength bytes have been produced (for anchored matches that only need a prefix).
+static void ODOFoldUTF8(ODOFoldBuffer *buffer, const uint8_t *bytes, size_t length, NSComparisonPredicateOptions options, size_t stopLength)
+{
+    OBPRECONDITION((options & ~ODOFoldOptionsMask) == 0);
+    BOOL foldCase = (options & NSCaseInsensitivePredicateOption) != 0;
+
+    // The folded text is usually the same length as the input, so reserve that much up front and only check for room on the slow paths.
+    ODOFoldBufferReserve(buffer, MIN(length, stopLength));
+
+    const uint8_t *end = bytes + length;
+    while (bytes < end && buffer->length < stopLength) {
+        uint8_t lead = *bytes;
+
+        if (lead < 0x80) {
+            if (buffer->length == buffer->capacity)
+                ODOFoldBufferReserve(buffer, 1);
+            buffer->bytes[buffer->length++] = (foldCase && lead >= 'A' && lead <= 'Z') ? (uint8_t)(lead + ('a' - 'A')) : lead;
+            bytes++;
+            continue;
+        }
+
+        unichar character;
+        size_t sequenceLength;
+        if ((lead & 0xE0) == 0xC0 && bytes + 1 < end && (bytes[1] & 0xC0) == 0x80) {
+            character = (unichar)(((lead & 0x1F) << 6) | (bytes[1] & 0x3F));
+            sequenceLength = 2;
+        } else if ((lead & 0xF0) == 0xE0 && bytes + 2 < end && (bytes[1] & 0xC0) == 0x80 && (bytes[2] & 0xC0) == 0x80) {
+            character = (unichar)(((lead & 0x0F) << 12) | ((bytes[1] & 0x3F) << 6) | (bytes[2] & 0x3F));
+            sequenceLength = 3;
+        } else {
+            // Four byte sequences (outside the BMP) and malformed input are copied through a byte at a time.
+            ODOFoldBufferReserve(buffer, 1);
+            buffer->bytes[buffer->length++] = lead;
+            bytes++;
+            continue;
+        }
+
+        const ODOFoldPage *page = ODOFoldPageGet(character >> 8, options);
+        uint16_t foldedStart = page->offsets[character & 0xFF];
+        uint16_t foldedLength = page->offsets[(character & 0xFF) + 1] - foldedStart;
+
+        ODOFoldBufferReserve(buffer, foldedLength);
+        memcpy(buffer->bytes + buffer->length, page->bytes + foldedStart, foldedLength);
+        buffer->length += foldedLength;
+        bytes += sequenceLength;
+    }
+}
+
+// The folded constant side of a comparison, cached on the statement with sqlite3_set_auxdata so that it is only folded once per statement rather than once per row.
+typedef struct {
+    int options;
+    size_t length;
+    uint8_t bytes[];
+} ODOFoldedPattern;
+
+static const ODOFoldedPattern *ODOFoldedPatternForArgument(sqlite3_context *ctx, sqlite3_value *value, int argumentIndex, int options)
+{
+    ODOFoldedPattern *pattern = sqlite3_get_auxdata(ctx, argumentIndex);
+    if (pattern != NULL && pattern->options == options)
+        return pattern;
+
+    ODOFoldBuffer buffer;
+    ODOFoldBufferInit(&buffer);
+    ODOFoldUTF8(&buffer, sqlite3_value_text(value), sqlite3_value_bytes(value), options, SIZE_MAX);
+
+    pattern = malloc(sizeof(*pattern) + buffer.length);
+    pattern->options = options;
+    pattern->length = buffer.length;
+    memcpy(pattern->bytes, buffer.bytes, buffer.length);
+    ODOFoldBufferFree(&buffer);
+
+    // SQLite takes ownership, and may free it right away if the argument isn't constant; fetch it back to find out.
+    sqlite3_set_auxdata(ctx, argumentIndex, pattern, free);
+    ODOFoldedPattern *cached = sqlite3_get_auxdata(ctx, argumentIndex);
+    if (cached != NULL)
+        return cached;
+    return NULL;
+}
+
+#pragma mark - String comparison functions
+
 typedef enum {
     ODOComparisonPredicateContainsStartLocation,
     ODOComparisonPredicateContainsAnywhereLocation,
 } ODOComparisonPredicateContainsLocation;
 
+static BOOL ODOFoldedTextMatches(const uint8_t *text, size_t textLength, const uint8_t *pattern, size_t patternLength, ODOComparisonPredicateContainsLocation location)
+{
+    if (patternLength > textLength)
+        return NO;
+    if (location == ODOComparisonPredicateContainsStartLocation)
+        return memcmp(text, pattern, patternLength) == 0;
+
+    OBASSERT(location == ODOComparisonPredicateContainsAnywhereLocation);
+    if (patternLength == 0)
+        return YES;
+    return memmem(text, textLength, pattern, patternLength) != NULL;
+}
+
 static void ODOComparisonPredicateContainsStringGeneric(sqlite3_context *ctx, int nArgs, sqlite3_value **values, ODOComparisonPredicateContainsLocation location)
 {
     if (nArgs != 3) {
@@ -61,50 +270,47 @@ static void ODOComparisonPredicateContainsStringGeneric(sqlite3_context *ctx, in
         sqlite3_result_int(ctx, false);
         return;
     }
+    size_t lhsLength = sqlite3_value_bytes(values[0]);
 
-    const unsigned char *rhs = sqlite3_value_text(values[1]);
     int options = sqlite3_value_int(values[2]);
-    
-    // If the inputs are plain ASCII or we want to do an exact match, we can do this in terms of byte matching.
-    if (options == 0 || (isPlainASCII(lhs) && isPlainASCII(rhs))) {
-        const char *foundPointer = strcasestr((const char *)lhs, (const char *)rhs); // LHS starts-with/contains RHS
-        if (foundPointer == NULL) {
-            sqlite3_result_int(ctx, false);
-            return;
-        }
-        
-        if (location == ODOComparisonPredicateContainsAnywhereLocation) {
-            sqlite3_result_int(ctx, true);
-            return;
-        } else {
-            OBASSERT(location == ODOComparisonPredicateContainsStartLocation);
-            sqlite3_result_int(ctx, (const char *)foundPointer == (const char *)lhs);
-            return;
-        }
+    OBASSERT((options & ODOFoldOptionsMask) == options); // should be the only flags
+    options &= ODOFoldOptionsMask;
+
+    const unsigned char *rhs = sqlite3_value_text(values[1]);
+    if (rhs == NULL) {
+        sqlite3_result_int(ctx, false);
+        return;
     }
-    
-    // Need to do the hard case.
-    CFStringRef lhsString = CFStringCreateWithCStringNoCopy(kCFAllocatorDefault, (const char *)lhs, kCFStringEncodingUTF8, kCFAllocatorNull);
-    CFStringRef rhsString = CFStringCreateWithCStringNoCopy(kCFAllocatorDefault, (const char *)rhs, kCFStringEncodingUTF8, kCFAllocatorNull);
-    
-    // Diacritic/case insensitivity
-    CFOptionFlags cfOptions = 0;
-    if (options & NSCaseInsensitivePredicateOption)
-        cfOptions |= kCFCompareCaseInsensitive;
-    if (options & NSDiacriticInsensitivePredicateOption)
-        cfOptions |= kCFCompareDiacriticInsensitive;
-    OBASSERT((options & (NSCaseInsensitivePredicateOption|NSDiacriticInsensitivePredicateOption)) == options); // should be the only flags
-    
-    if (location == ODOComparisonPredicateContainsStartLocation)
-        cfOptions |= kCFCompareAnchored;
-    else
-        OBASSERT(location == ODOComparisonPredicateContainsAnywhereLocation);
 
-    CFRange foundRange = CFStringFind(lhsString, rhsString, cfOptions);
-    CFRelease(lhsString);
-    CFRelease(rhsString);
+    // Exact matches are plain byte comparisons.
+    if (options == 0) {
+        sqlite3_result_int(ctx, ODOFoldedTextMatches(lhs, lhsLength, rhs, sqlite3_value_bytes(values[1]), location));
+        return;
+    }
+
+    // The right hand side is almost always a bound constant, so fold it once and keep it on the statement. If it isn't constant, fold it for just this row.
+    ODOFoldBuffer rhsBuffer;
+    ODOFoldBufferInit(&rhsBuffer);
+    const uint8_t *patternBytes;
+    size_t patternLength;
+    const ODOFoldedPattern *pattern = ODOFoldedPatternForArgument(ctx, values[1], 1, options);
+    if (pattern != NULL) {
+        patternBytes = pattern->bytes;
+        patternLength = pattern->length;
+    } else {
+        ODOFoldUTF8(&rhsBuffer, rhs, sqlite3_value_bytes(values[1]), options, SIZE_MAX);
+        patternBytes = rhsBuffer.bytes;
+        patternLength = rhsBuffer.length;
+    }
+
+    ODOFoldBuffer lhsBuffer;
+    ODOFoldBufferInit(&lhsBuffer);
+    ODOFoldUTF8(&lhsBuffer, lhs, lhsLength, options, location == ODOComparisonPredicateContainsStartLocation ? patternLength : SIZE_MAX);
+
+    sqlite3_result_int(ctx, ODOFoldedTextMatches(lhsBuffer.bytes, lhsBuffer.length, patternBytes, patternLength, location));
 
-    sqlite3_result_int(ctx, foundRange.length > 0);
+    ODOFoldBufferFree(&lhsBuffer);
+    ODOFoldBufferFree(&rhsBuffer);
 }
 
 static void ODOComparisonPredicateStartsWithFunction(sqlite3_context *ctx, int nArgs, sqlite3_value **values)
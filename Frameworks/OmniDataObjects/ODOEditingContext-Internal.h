@@ -46,6 +46,10 @@ NS_ASSUME_NONNULL_BEGIN
     
     BOOL _avoidSettingSaveDates;
     NSDate *_saveDate;
+
+    NSUInteger _batchedFaultingDepth;
+    // Non-nil while inside -performWithBatchedFaulting:. Faults registered during the scope are collected here, by entity, so they can be fulfilled together.
+    NSMapTable <ODOEntity *, NSMutableArray <ODOObject *> *> *_pendingBatchFaultsByEntity;
 }
 
 - (void)_insertObject:(ODOObject *)object;
@@ -82,6 +86,7 @@ NSMutableSet * ODOEditingContextCreateRecentSet(ODOEditingContext *self) OB_HIDD
 void ODOUpdateResultSetForInMemoryChanges(ODOEditingContext *self, NSMutableArray *results, ODOEntity *entity, NSPredicate *predicate) OB_HIDDEN;
 
 void ODOFetchObjectFault(ODOEditingContext *self, ODOObject *object) OB_HIDDEN;
+BOOL ODOFetchObjectFaults(ODOEditingContext *self, ODOEntity *entity, NSArray <ODOObject *> *objects, NSError **outError) OB_HIDDEN;
 NSMutableSet * ODOFetchSetFault(ODOEditingContext *self, ODOObject *owner, ODORelationship *rel) OB_HIDDEN;
 NSMutableArray <__kindof ODOObject *> * _Nullable ODOFetchObjects(ODOEditingContext *self, ODOEntity *entity, NSPredicate *predicate, NSString *reason, NSError **outError) OB_HIDDEN;
 
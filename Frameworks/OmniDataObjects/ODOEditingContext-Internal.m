@@ -310,6 +310,18 @@ ODOObject * ODOEditingContextLookupObjectOrRegisterFaultForObjectID(ODOEditingCo
     [self _registerObject:object];
     [object release]; // we hold it
     
+    // Remember the fault so that if any fault of this entity gets fulfilled during the batching scope, this one is fetched along with it.
+    if (self->_pendingBatchFaultsByEntity != nil) {
+        ODOEntity *entity = [objectID entity];
+        NSMutableArray <ODOObject *> *pendingFaults = [self->_pendingBatchFaultsByEntity objectForKey:entity];
+        if (pendingFaults == nil) {
+            pendingFaults = [[NSMutableArray alloc] init];
+            [self->_pendingBatchFaultsByEntity setObject:pendingFaults forKey:entity];
+            [pendingFaults release];
+        }
+        [pendingFaults addObject:object];
+    }
+    
     return object;
 }
 
@@ -331,8 +343,9 @@ NSMutableSet * ODOEditingContextCreateRecentSet(ODOEditingContext *self)
 
 typedef struct {
     ODOEntity *entity;
-    NSPredicate *predicate;
+    ODOCompiledPredicate predicate;
     NSMutableArray *results;
+    CFSetRef resultSet;
 } InMemoryFetchContext;
 
 static void _addMatchingInserts(const void *value, void *context)
@@ -342,7 +355,7 @@ static void _addMatchingInserts(const void *value, void *context)
     
     if (ctx->entity != [object entity])
         return;
-    if (ctx->predicate && ![ctx->predicate evaluateWithObject:object])
+    if (ctx->predicate && !ctx->predicate(object))
         return;
     
     [ctx->results addObject:object];
@@ -353,14 +366,12 @@ static void _addMissingMatchingUpdates(const void *value, void *context)
     ODOObject *object = (ODOObject *)value;
     InMemoryFetchContext *ctx = context;
     
-    if (ctx->entity == [object entity] && [ctx->predicate evaluateWithObject:object]) {
-        // Might have previously matched since this is an update.  Inefficient if there are a ton of fetch results.
-        if ([ctx->results indexOfObjectIdenticalTo:object] == NSNotFound)
-            [ctx->results addObject:object];
-    }
+    // Might have previously matched since this is an update.
+    if (ctx->entity == [object entity] && !CFSetContainsValue(ctx->resultSet, object) && ctx->predicate(object))
+        [ctx->results addObject:object];
 }
 
-static void _updateResultSetForChanges(NSMutableArray *results, ODOEntity *entity, NSPredicate *predicate, NSSet * _Nullable inserted, NSSet * _Nullable updated, NSSet * _Nullable deleted)
+static void _updateResultSetForChanges(NSMutableArray *results, ODOEntity *entity, ODOCompiledPredicate _Nullable predicate, NSSet * _Nullable inserted, NSSet * _Nullable updated, NSSet * _Nullable deleted)
 {
     InMemoryFetchContext memCtx;
     memset(&memCtx, 0, sizeof(memCtx));
@@ -368,19 +379,30 @@ static void _updateResultSetForChanges(NSMutableArray *results, ODOEntity *entit
     memCtx.predicate = predicate;
     memCtx.results = results;
     
-    NSUInteger resultIndex, resultCount = [results count];
-    
-    if (updated) {
-        // Remove any objects that were fetched but have since been updated to no longer match the predicate
-        resultIndex = resultCount;
-        while (resultIndex--) { // loop reverse so we can modify the array as we go
+    // With no predicate, every updated object of the entity either was fetched or is a processed insert (handled on that pass), so there is nothing to do for updates.
+    if (updated && predicate) {
+        // Remove any objects that were fetched but have since been updated to no longer match the predicate. Collect the survivors in a pointer set so the check for newly matching updates below doesn't have to search the results array for each one.
+        NSUInteger resultIndex, resultCount = [results count];
+        CFMutableSetRef resultSet = CFSetCreateMutable(kCFAllocatorDefault, resultCount, &OFNonOwnedPointerSetCallbacks);
+        NSMutableIndexSet *nonMatchingIndexes = nil;
+        
+        for (resultIndex = 0; resultIndex < resultCount; resultIndex++) {
             ODOObject *object = [results objectAtIndex:resultIndex];
-            if ([updated member:object] && (predicate != nil && ![predicate evaluateWithObject:object]))
-                [results removeObjectAtIndex:resultIndex];
+            if ([updated member:object] && !predicate(object)) {
+                if (!nonMatchingIndexes)
+                    nonMatchingIndexes = [NSMutableIndexSet indexSet];
+                [nonMatchingIndexes addIndex:resultIndex];
+            } else
+                CFSetAddValue(resultSet, object);
         }
+        if (nonMatchingIndexes)
+            [results removeObjectsAtIndexes:nonMatchingIndexes];
         
         // Append any objects of the right entity that *didn't* match the predicate before, but do now.
-        CFSetApplyFunction((CFSetRef)updated, _addMissingMatchingUpdates, &memCtx); // Inefficient if there are lots of fetch results
+        memCtx.resultSet = resultSet;
+        CFSetApplyFunction((CFSetRef)updated, _addMissingMatchingUpdates, &memCtx);
+        memCtx.resultSet = NULL;
+        CFRelease(resultSet);
     }
     
     if (inserted) {
@@ -392,7 +414,7 @@ static void _updateResultSetForChanges(NSMutableArray *results, ODOEntity *entit
 #ifdef OMNI_ASSERTIONS_ON
     if (deleted) {
         // Remove any objects from the results that have been deleted in memory (don't need the entity check).
-        resultIndex = [results count];
+        NSUInteger resultIndex = [results count];
         while (resultIndex--) { // loop reverse so we can modify the array as we go
             ODOObject *object = [results objectAtIndex:resultIndex];
             OBASSERT([deleted member:object] == nil);
@@ -416,6 +438,11 @@ void ODOUpdateResultSetForInMemoryChanges(ODOEditingContext *self, NSMutableArra
     NSSet *recentUpdates = self->_recentlyUpdatedObjects;
     NSSet *recentDeletes = self->_recentlyDeletedObjects;
     
+    BOOL hasProcessedChanges = (processedInserts || processedUpdates || processedDeletes);
+    BOOL hasRecentChanges = (recentInserts || recentUpdates || recentDeletes);
+    if (!hasProcessedChanges && !hasRecentChanges)
+        return;
+    
     if (recentDeletes && ([processedInserts intersectsSet:recentDeletes] || [processedUpdates intersectsSet:recentDeletes])) {
         // We have to take some extra care in this case.  If we have deleted an object that is in the processed changes, we can't evaluate predicates on those objects.  We need to just delete them.  We could change _updateResultSetForChanges to check whether each object is deleted via -isDeleted, but instead we'll munge the sets here.
         
@@ -430,11 +457,16 @@ void ODOUpdateResultSetForInMemoryChanges(ODOEditingContext *self, NSMutableArra
         }
     }
     
-    if (processedInserts || processedUpdates || processedDeletes)
-        _updateResultSetForChanges(results, entity, predicate, processedInserts, processedUpdates, processedDeletes);
+    // Compile the predicate once for both passes. Simple comparisons against stored properties become direct reads of the object's storage rather than going through KVC for every changed object.
+    ODOCompiledPredicate compiledPredicate = predicate ? [predicate copyCompiledPredicateWithEntity:entity] : nil;
+    
+    if (hasProcessedChanges)
+        _updateResultSetForChanges(results, entity, compiledPredicate, processedInserts, processedUpdates, processedDeletes);
     
-    if (recentInserts || recentUpdates || recentDeletes)
-        _updateResultSetForChanges(results, entity, predicate, recentInserts, recentUpdates, recentDeletes);
+    if (hasRecentChanges)
+        _updateResultSetForChanges(results, entity, compiledPredicate, recentInserts, recentUpdates, recentDeletes);
+    
+    [compiledPredicate release];
 }
 
 static BOOL PrepareQueryByKey(ODOSQLStatement *query, sqlite3 *sqlite, id key, NSError **outError)
@@ -594,6 +626,65 @@ static BOOL FetchObjectFaultWithContext(ODOEditingContext *self, ODOObject *obje
     return YES;
 }
 
+static void PrefetchRelationshipsAndAwakeObjects(ODOEditingContext *self, ODOEntity *entity, NSArray <ODOObject *> *fetched);
+static BOOL PerformPrefetch(ODOEditingContext *self, ODOEntity *entity, NSArray <ODOObject *> *objects, NSError **outError);
+
+// Fetches any faults of the same entity as the given object that were collected by -performWithBatchedFaulting:, along with the object itself. Returns NO if there were no other faults pending, or if the batch fetch failed (in which case the caller should fall back to fetching the single object and reporting any error that way).
+static BOOL _fetchPendingBatchFaultsWithObject(ODOEditingContext *self, ODOObject *object)
+{
+    ODOEntity *entity = [object entity];
+    NSMutableArray <ODOObject *> *pendingFaults = [self->_pendingBatchFaultsByEntity objectForKey:entity];
+    if ([pendingFaults count] == 0)
+        return NO;
+    
+    // Take these out of the table before fetching, since awaking the fetched objects may create more faults.
+    [[pendingFaults retain] autorelease];
+    [self->_pendingBatchFaultsByEntity removeObjectForKey:entity];
+    
+    if ([pendingFaults indexOfObjectIdenticalTo:object] == NSNotFound)
+        [pendingFaults addObject:object];
+    
+    __autoreleasing NSError *error = nil;
+    if (!ODOFetchObjectFaults(self, entity, pendingFaults, &error)) {
+        [error log:@"Batch fault fetch failed"];
+        return NO;
+    }
+    return YES;
+}
+
+BOOL ODOFetchObjectFaults(ODOEditingContext *self, ODOEntity *entity, NSArray <ODOObject *> *objects, NSError **outError)
+{
+    OBPRECONDITION([self isKindOfClass:[ODOEditingContext class]]);
+    OBPRECONDITION(entity);
+    
+    if (self->_isResetting) {
+        OBASSERT(!self->_isResetting); // Shouldn't try to clear object faults at all while resetting
+        return YES;
+    }
+    
+    // Skip anything that has been fulfilled, deleted or is already part of a prefetch since being collected.
+    NSMutableArray <ODOObject *> *faults = [NSMutableArray arrayWithCapacity:[objects count]];
+    for (ODOObject *object in objects) {
+        OBASSERT([object entity] == entity);
+        OBASSERT([object editingContext] == self);
+        if (object->_flags.isFault && !object->_flags.invalid && !object->_flags.isScheduledForBatchFetch && ![object isDeleted])
+            [faults addObject:object];
+    }
+    if ([faults count] == 0)
+        return YES;
+    
+    if (!PerformPrefetch(self, entity, faults, outError))
+        return NO;
+    
+    // Objects that weren't found in the database stay faults and will report an error if they get accessed.
+    NSArray <ODOObject *> *fetched = [faults select:^BOOL(ODOObject *object) {
+        return !object->_flags.isFault;
+    }];
+    PrefetchRelationshipsAndAwakeObjects(self, entity, fetched);
+    
+    return YES;
+}
+
 // TODO: Test deleting an object and then resolving a to-one relationship to it that was previously still cached as just the primary key attribute.  The to-one should get nullified (or its owner cascaded).
 void ODOFetchObjectFault(ODOEditingContext *self, ODOObject *object)
 {
@@ -606,6 +697,9 @@ void ODOFetchObjectFault(ODOEditingContext *self, ODOObject *object)
     OBPRECONDITION(![object isUpdated]);
     OBPRECONDITION(![object isDeleted]);
     
+    if (self->_pendingBatchFaultsByEntity != nil && _fetchPendingBatchFaultsWithObject(self, object) && ![object isFault])
+        return;
+    
     if (ODOSQLDebugLogLevel > 0)
         ODOSQLStatementLogSQL(@"/* object fault %@ */ ", [object shortDescription]);
 
@@ -924,13 +1018,15 @@ static void PrefetchRelationshipsAndAwakeObjects(ODOEditingContext *self, ODOEnt
     }
 }
 
+// Each IN clause binds one constant per object, so keep the batches well inside SQLite's bound variable limit.
+static const NSUInteger ODOPrefetchBatchSize = 500;
+
 static BOOL PerformPrefetch(ODOEditingContext *self, ODOEntity *entity, NSArray <ODOObject *> *objects, NSError **outError)
 {
     OBINVARIANT([self _checkInvariants]);
     OBPRECONDITION(!self->_isResetting, "This is a sub-fetch where the caller should have already checked this");
 
     // TODO: Add a cached ODOSQLStatement that fetches a fixed number of objects (and if we have fewer, replicate one of the primary keys to fill the extra slots).
-    // TODO: Update this to send the list of objects to the background queue and invoke the batching there rather than dispatching to the background multiple times.
 
     __block ODORowFetchContext ctx;
     memset(&ctx, 0, sizeof(ctx));
@@ -947,15 +1043,25 @@ static BOOL PerformPrefetch(ODOEditingContext *self, ODOEntity *entity, NSArray
 
     ODODatabase *database = self->_database;
     if (ODOSQLDebugLogLevel > 0) {
-        ODOSQLStatementLogSQL(@"/* SQL batch fault: %@ */ ", entity.name);
+        ODOSQLStatementLogSQL(@"/* SQL batch fault: %@ (%ld objects) */ ", entity.name, [objects count]);
     }
 
-    NSPredicate *predicate = [NSPredicate predicateWithFormat:@"%K in %@", ctx.primaryKeyAttribute.name, objects];
-    ODOSQLStatement *query = [[ODOSQLStatement alloc] initSelectProperties:ctx.schemaProperties fromEntity:entity connection:database.connection predicate:predicate error:outError];
-    if (query == nil) {
-        OBASSERT_NOT_REACHED("Failed to build query: %@", outError != NULL ? (id)[*outError toPropertyList] : (id)@"Missing error");
-        OBINVARIANT([self _checkInvariants]);
-        return NO;
+    // Build all the chunked queries up front so that they can all be run in a single trip to the connection's queue.
+    NSUInteger objectCount = [objects count];
+    NSMutableArray <ODOSQLStatement *> *queries = [NSMutableArray arrayWithCapacity:(objectCount + ODOPrefetchBatchSize - 1) / ODOPrefetchBatchSize];
+    for (NSUInteger batchStart = 0; batchStart < objectCount; batchStart += ODOPrefetchBatchSize) {
+        NSArray <ODOObject *> *batch = [objects subarrayWithRange:NSMakeRange(batchStart, MIN(ODOPrefetchBatchSize, objectCount - batchStart))];
+        NSPredicate *predicate = [NSPredicate predicateWithFormat:@"%K in %@", ctx.primaryKeyAttribute.name, batch];
+        ODOSQLStatement *query = [[ODOSQLStatement alloc] initSelectProperties:ctx.schemaProperties fromEntity:entity connection:database.connection predicate:predicate error:outError];
+        if (query == nil) {
+            OBASSERT_NOT_REACHED("Failed to build query: %@", outError != NULL ? (id)[*outError toPropertyList] : (id)@"Missing error");
+            for (ODOSQLStatement *builtQuery in queries)
+                [builtQuery invalidate];
+            OBINVARIANT([self _checkInvariants]);
+            return NO;
+        }
+        [queries addObject:query];
+        [query release];
     }
 
     ODOSQLConnection *connection = database.connection;
@@ -965,12 +1071,16 @@ static BOOL PerformPrefetch(ODOEditingContext *self, ODOEntity *entity, NSArray
             memset(&callbacks, 0, sizeof(callbacks));
             callbacks.row = _fetchObjectCallback;
 
-            return ODOSQLStatementRun(sqlite, query, callbacks, &ctx, blockError);
+            for (ODOSQLStatement *query in queries) {
+                if (!ODOSQLStatementRun(sqlite, query, callbacks, &ctx, blockError))
+                    return NO;
+            }
+            return YES;
         }];
     });
 
-    [query invalidate];
-    [query release];
+    for (ODOSQLStatement *query in queries)
+        [query invalidate];
 
     if (!success) {
 #ifdef DEBUG
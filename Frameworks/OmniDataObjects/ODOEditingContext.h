@@ -65,6 +65,12 @@ NS_ASSUME_NONNULL_BEGIN
 /// Support for bulk fetching any uncleared to-many relationship faults in the source objects. All teh source objects must have the same entity as the source of the relationship. The fetched objects are returned (so, if a source object already had cleared its relationship, those objects will not be in the result).
 - (nullable NSArray <__kindof ODOObject *> *)fetchToManyRelationship:(ODORelationship *)relationship forSourceObjects:(NSSet <ODOObject *> *)sourceObjects error:(NSError **)outError;
 
+/// Fulfills any object faults in the given objects using as few queries as possible (batched by entity). Objects that are not faults are ignored.
+- (BOOL)fetchFaultsForObjects:(id <NSFastEnumeration>)objects error:(NSError **)outError;
+
+/// Runs the block, collecting the object faults created while it runs. When any one of them needs to be fulfilled, all the collected faults of the same entity are fetched along with it. This turns the N+1 queries of walking a to-one relationship across a collection into one query per entity. Scopes may be nested; faults are collected until the outermost one ends.
+- (void)performWithBatchedFaulting:(void (NS_NOESCAPE ^)(void))block;
+
 /// Debugging label for differentiating between multiple editing contexts.
 @property (nonatomic, copy) NSString *label;
 
@@ -106,6 +106,9 @@ NS_ASSUME_NONNULL_BEGIN
     [_recentlyUpdatedObjects release];
     [_recentlyDeletedObjects release];
     
+    OBASSERT(_batchedFaultingDepth == 0);
+    [_pendingBatchFaultsByEntity release];
+    
     [_label release];
     
     [super dealloc];
@@ -273,6 +276,9 @@ BOOL ODOEditingContextExecuteWithOwnership(ODOEditingContext *self, dispatch_que
         [_reinsertedObjects release];
         _reinsertedObjects = nil;
         
+        // Keep batching if we are inside a scope, but forget the faults that are about to be invalidated.
+        [_pendingBatchFaultsByEntity removeAllObjects];
+        
         _nonretainedLastRecentlyInsertedObject = nil;
 
         // get rid of database metadata changes
@@ -1547,6 +1553,54 @@ BOOL ODOEditingContextObjectIsInsertedNotConsideringDeletions(ODOEditingContext
     return fetchedObjects;
 }
 
+- (BOOL)fetchFaultsForObjects:(id <NSFastEnumeration>)objects error:(NSError **)outError;
+{
+    ODOEditingContextAssertOwnership(self);
+
+    NSMapTable <ODOEntity *, NSMutableArray <ODOObject *> *> *faultsByEntity = [NSMapTable strongToStrongObjectsMapTable];
+    for (ODOObject *object in objects) {
+        OBASSERT([object editingContext] == self);
+        if (![object isFault])
+            continue;
+
+        ODOEntity *entity = [object entity];
+        NSMutableArray <ODOObject *> *faults = [faultsByEntity objectForKey:entity];
+        if (faults == nil) {
+            faults = [NSMutableArray array];
+            [faultsByEntity setObject:faults forKey:entity];
+        }
+        [faults addObject:object];
+    }
+
+    for (ODOEntity *entity in faultsByEntity) {
+        if (!ODOFetchObjectFaults(self, entity, [faultsByEntity objectForKey:entity], outError))
+            return NO;
+    }
+    return YES;
+}
+
+- (void)performWithBatchedFaulting:(void (NS_NOESCAPE ^)(void))block;
+{
+    ODOEditingContextAssertOwnership(self);
+
+    if (_batchedFaultingDepth == 0) {
+        OBASSERT(_pendingBatchFaultsByEntity == nil);
+        _pendingBatchFaultsByEntity = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsStrongMemory|NSPointerFunctionsObjectPointerPersonality valueOptions:NSPointerFunctionsStrongMemory capacity:0];
+    }
+    _batchedFaultingDepth++;
+
+    @try {
+        block();
+    } @finally {
+        OBASSERT(_batchedFaultingDepth > 0);
+        _batchedFaultingDepth--;
+        if (_batchedFaultingDepth == 0) {
+            [_pendingBatchFaultsByEntity release];
+            _pendingBatchFaultsByEntity = nil;
+        }
+    }
+}
+
 - (ODOEditingContextFaultErrorRecovery)handleFaultFulfillmentError:(NSError *)error;
 {
     ODOEditingContextAssertOwnership(self);
@@ -1753,61 +1807,98 @@ static void _runLoopObserverCallBack(CFRunLoopObserverRef observer, CFRunLoopAct
 }
 
 typedef struct {
-    ODODatabase *database;
     NSSet *reinsertedObjects;
+    CFMutableDictionaryRef insertedObjectsByEntity;
+    CFMutableDictionaryRef updatedObjectsByEntity;
+} GroupInsertsApplierContext;
+
+static void _addObjectToEntityGroup(CFMutableDictionaryRef objectsByEntity, ODOObject *object)
+{
+    ODOEntity *entity = object.entity;
+    NSMutableArray *objects = (NSMutableArray *)CFDictionaryGetValue(objectsByEntity, entity);
+    if (objects == nil) {
+        objects = [[NSMutableArray alloc] init];
+        CFDictionarySetValue(objectsByEntity, entity, objects);
+        [objects release];
+    }
+    [objects addObject:object];
+}
+
+static void _groupByEntityApplier(const void *value, void *context)
+{
+    _addObjectToEntityGroup((CFMutableDictionaryRef)context, (ODOObject *)value);
+}
+
+static void _groupInsertsByEntityApplier(const void *value, void *context)
+{
+    ODOObject *object = (ODOObject *)value;
+    GroupInsertsApplierContext *ctx = context;
+    
+    // Reinserted objects still have their row in the database, so they get written as updates.
+    BOOL isReinsert = ([ctx->reinsertedObjects member:object] == object);
+    _addObjectToEntityGroup(isReinsert ? ctx->updatedObjectsByEntity : ctx->insertedObjectsByEntity, object);
+}
+
+static CFMutableDictionaryRef _createEntityGroups(void)
+{
+    // Entities are retained by the model, which outlives any save.
+    return CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &OFNonOwnedPointerDictionaryKeyCallbacks, &kCFTypeDictionaryValueCallBacks);
+}
+
+typedef enum {
+    WriteSQLInsert,
+    WriteSQLUpdate,
+    WriteSQLDelete,
+} WriteSQLOperation;
+
+typedef struct {
+    ODODatabase *database;
     sqlite3 *sqlite;
+    WriteSQLOperation operation;
     BOOL errorOccurred;
     NSError **outError;
 } WriteSQLApplierContext;
 
-static void _writeInsertApplier(const void *value, void *context)
+static void _writeEntityGroupApplier(const void *key, const void *value, void *context)
 {
-    ODOObject *object = (ODOObject *)value;
+    ODOEntity *entity = (ODOEntity *)key;
+    NSArray *objects = (NSArray *)value;
     WriteSQLApplierContext *ctx = context;
     
     if (ctx->errorOccurred) {
         return;
     }
     
-    BOOL isReinsert = ([ctx->reinsertedObjects member:object] == object);
-    
-    if (isReinsert) {
-        if (![object.entity _writeUpdate:ctx->sqlite database:ctx->database object:object error:ctx->outError]) {
-            ctx->errorOccurred = YES;
-        }
-    } else {
-        if (![object.entity _writeInsert:ctx->sqlite database:ctx->database object:object error:ctx->outError]) {
-            ctx->errorOccurred = YES;
-        }
+    BOOL success = NO;
+    switch (ctx->operation) {
+        case WriteSQLInsert:
+            success = [entity _writeInserts:ctx->sqlite database:ctx->database objects:objects error:ctx->outError];
+            break;
+        case WriteSQLUpdate:
+            success = [entity _writeUpdates:ctx->sqlite database:ctx->database objects:objects error:ctx->outError];
+            break;
+        case WriteSQLDelete:
+            success = [entity _writeDeletes:ctx->sqlite database:ctx->database objects:objects error:ctx->outError];
+            break;
     }
-}
-
-static void _writeUpdateApplier(const void *value, void *context)
-{
-    ODOObject *object = (ODOObject *)value;
-    WriteSQLApplierContext *ctx = context;
     
-    if (ctx->errorOccurred) {
-        return;
-    }
-
-    if (![object.entity _writeUpdate:ctx->sqlite database:ctx->database object:object error:ctx->outError]) {
+    if (!success) {
         ctx->errorOccurred = YES;
     }
 }
 
-static void _writeDeleteApplier(const void *value, void *context)
+static BOOL _writeEntityGroups(CFDictionaryRef objectsByEntity, WriteSQLOperation operation, ODODatabase *database, sqlite3 *sqlite, NSError **outError)
 {
-    ODOObject *object = (ODOObject *)value;
-    WriteSQLApplierContext *ctx = context;
+    WriteSQLApplierContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.database = database;
+    ctx.sqlite = sqlite;
+    ctx.operation = operation;
+    ctx.outError = outError;
     
-    if (ctx->errorOccurred) {
-        return;
-    }
-
-    if (![object.entity _writeDelete:ctx->sqlite database:ctx->database object:object error:ctx->outError]) {
-        ctx->errorOccurred = YES;
-    }
+    CFDictionaryApplyFunction(objectsByEntity, _writeEntityGroupApplier, &ctx);
+    
+    return !ctx.errorOccurred;
 }
 
 // Writes the changes, but doesn't clear them (the transaction may fail).
@@ -1821,39 +1912,35 @@ static void _writeDeleteApplier(const void *value, void *context)
     OBPRECONDITION([_database.connection checkExecutingOnDispatchQueue]);
     OBPRECONDITION([_database.connection checkIsManagedSQLite:sqlite]);
     
-    // For deletes, there might be a speed advantage to grouping by entity and then issuing a delete where pk in (...) but binding values wouldn't let us bind the set of values.  Maybe we could have a prepared statement for 'delete 10 things' and use that until we had < 10.  Or fill out the last N bindings in the statement with repeated PKs.  Also, angels on a pinhead.
-    WriteSQLApplierContext ctx;
-    memset(&ctx, 0, sizeof(ctx));
-    ctx.database = _database;
-    ctx.reinsertedObjects = _reinsertedObjects;
-    ctx.sqlite = sqlite;
-    ctx.outError = outError;
+    // Group the edits by entity so that each entity's cached statements get reused back-to-back and inserts/deletes can be issued as multi-row statements (see -[ODOEntity(ODO_SQL) _writeInserts:database:objects:error:]).
+    CFMutableDictionaryRef insertedObjectsByEntity = _createEntityGroups();
+    CFMutableDictionaryRef updatedObjectsByEntity = _createEntityGroups();
+    CFMutableDictionaryRef deletedObjectsByEntity = _createEntityGroups();
     
     if (_processedInsertedObjects != nil) {
-        CFSetApplyFunction((CFSetRef)_processedInsertedObjects, _writeInsertApplier, &ctx);
-    }
-    
-    if (ctx.errorOccurred) {
-        return NO;
+        GroupInsertsApplierContext ctx;
+        memset(&ctx, 0, sizeof(ctx));
+        ctx.reinsertedObjects = _reinsertedObjects;
+        ctx.insertedObjectsByEntity = insertedObjectsByEntity;
+        ctx.updatedObjectsByEntity = updatedObjectsByEntity;
+        CFSetApplyFunction((CFSetRef)_processedInsertedObjects, _groupInsertsByEntityApplier, &ctx);
     }
-    
     if (_processedUpdatedObjects != nil) {
-        CFSetApplyFunction((CFSetRef)_processedUpdatedObjects, _writeUpdateApplier, &ctx);
-    }
-    
-    if (ctx.errorOccurred) {
-        return NO;
+        CFSetApplyFunction((CFSetRef)_processedUpdatedObjects, _groupByEntityApplier, updatedObjectsByEntity);
     }
-
     if (_processedDeletedObjects != nil) {
-        CFSetApplyFunction((CFSetRef)_processedDeletedObjects, _writeDeleteApplier, &ctx);
+        CFSetApplyFunction((CFSetRef)_processedDeletedObjects, _groupByEntityApplier, deletedObjectsByEntity);
     }
     
-    if (ctx.errorOccurred) {
-        return NO;
-    }
-
-    return YES;
+    BOOL success = (_writeEntityGroups(insertedObjectsByEntity, WriteSQLInsert, _database, sqlite, outError) &&
+                    _writeEntityGroups(updatedObjectsByEntity, WriteSQLUpdate, _database, sqlite, outError) &&
+                    _writeEntityGroups(deletedObjectsByEntity, WriteSQLDelete, _database, sqlite, outError));
+    
+    CFRelease(insertedObjectsByEntity);
+    CFRelease(updatedObjectsByEntity);
+    CFRelease(deletedObjectsByEntity);
+    
+    return success;
 }
 
 static void _appendObjectID(const void *value, void *context)
@@ -53,6 +53,8 @@
     NSString *_updateStatementKey;
     NSString *_deleteStatementKey;
     NSString *_queryByPrimaryKeyStatementKey;
+    NSString *_batchInsertStatementKey;
+    NSString *_batchDeleteStatementKey;
     
     NSSet *_derivedPropertyNameSet;
     NSSet *_nonDateModifyingPropertyNameSet;
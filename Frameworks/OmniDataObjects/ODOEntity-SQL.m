@@ -18,6 +18,8 @@
 #import "ODODatabase-Internal.h"
 #import "ODOSQLStatement.h"
 
+#import <sqlite3.h>
+
 RCS_ID("$Id$")
 
 @implementation ODOEntity (ODO_SQL)
@@ -262,56 +264,144 @@ static BOOL _bindSchemaProperty(struct sqlite3 *sqlite, ODOSQLStatement *stateme
         return _bindPlainAttribute(sqlite, statement, object, zeroBasedPropertyIndex, (ODOAttribute *)prop, outError);
 }
 
-static BOOL _bindInsertSchemaProperties(struct sqlite3 *sqlite, ODOSQLStatement *statement, ODOObject *object, NSArray *schemaProperties, NSError **outError)
+// The bind offset is the zero-based index of the first column for this object; non-zero when writing the later rows of a multi-row insert.
+static BOOL _bindInsertSchemaProperties(struct sqlite3 *sqlite, ODOSQLStatement *statement, ODOObject *object, NSArray *schemaProperties, NSUInteger bindOffset, NSError **outError)
 {
     NSUInteger propertyIndex = [schemaProperties count];
     while (propertyIndex--) {
         ODOProperty *prop = [schemaProperties objectAtIndex:propertyIndex];
-        if (!_bindSchemaProperty(sqlite, statement, object, propertyIndex, prop, outError))
+        if (!_bindSchemaProperty(sqlite, statement, object, bindOffset + propertyIndex, prop, outError))
             return NO;
     }
     
     return YES;
 }
 
-- (BOOL)_writeInsert:(struct sqlite3 *)sqlite database:(ODODatabase *)database object:(ODOObject *)object error:(NSError **)outError;
+// Multi-row statements amortize the per-step overhead of SQLite across many rows. Past a few dozen rows the win flattens out while the SQL text (and the number of bindings) keeps growing, so we cap the batch size here.
+static const NSUInteger ODOSQLBatchedWriteRowLimit = 64;
+
+static NSUInteger _batchedWriteRowCount(struct sqlite3 *sqlite, NSUInteger bindingsPerRow)
 {
-    OBPRECONDITION(sqlite);
-    OBPRECONDITION(database);
-    OBPRECONDITION(object);
-    OBPRECONDITION([[object editingContext] database] == database);
+    OBPRECONDITION(bindingsPerRow > 0);
+    
+    int variableLimit = sqlite3_limit(sqlite, SQLITE_LIMIT_VARIABLE_NUMBER, -1);
+    OBASSERT(variableLimit > 0);
+    
+    return MIN((NSUInteger)variableLimit / bindingsPerRow, ODOSQLBatchedWriteRowLimit);
+}
 
-    ODOSQLStatement *insertStatement = [database _cachedStatementForKey:_insertStatementKey];
+static void _appendBindingPlaceholders(NSMutableString *sql, NSUInteger count)
+{
+    NSUInteger placeholderIndex;
+    for (placeholderIndex = 0; placeholderIndex < count; placeholderIndex++) {
+        if (placeholderIndex == 0)
+            [sql appendString:@"?"];
+        else
+            [sql appendString:@", ?"];
+    }
+}
+
+#ifdef OMNI_ASSERTIONS_ON
+static BOOL _checkForBatchChangedRows(struct sqlite3 *sqlite, ODOSQLStatement *statement, void *context, NSError **outError)
+{
+    // When deleting a batch by primary key, there should be exactly one row changed per key.
+    NSUInteger expectedChangeCount = *(NSUInteger *)context;
+    OBASSERT((NSUInteger)sqlite3_changes(sqlite) == expectedChangeCount);
+    return YES;
+}
+#endif
+
+- (ODOSQLStatement *)_insertStatementForKey:(NSString *)statementKey rowCount:(NSUInteger)rowCount sqlite:(struct sqlite3 *)sqlite database:(ODODatabase *)database error:(NSError **)outError;
+{
+    OBPRECONDITION(rowCount > 0);
+    
+    ODOSQLStatement *insertStatement = [database _cachedStatementForKey:statementKey];
     if (!insertStatement) {
-        NSMutableString *sql = [[NSMutableString alloc] initWithFormat:@"INSERT INTO %@ VALUES (", _name];
-        NSUInteger propertyIndex, propertyCount = [_schemaProperties count];
-        for (propertyIndex = 0; propertyIndex < propertyCount; propertyIndex++) {
-            if (propertyIndex == 0)
-                [sql appendString:@"?"];
+        NSMutableString *sql = [[NSMutableString alloc] initWithFormat:@"INSERT INTO %@ VALUES ", _name];
+        NSUInteger rowIndex, propertyCount = [_schemaProperties count];
+        for (rowIndex = 0; rowIndex < rowCount; rowIndex++) {
+            if (rowIndex == 0)
+                [sql appendString:@"("];
             else
-                [sql appendString:@", ?"];
+                [sql appendString:@", ("];
+            _appendBindingPlaceholders(sql, propertyCount);
+            [sql appendString:@")"];
         }
-        [sql appendString:@")"];
         
         insertStatement = [ODOSQLStatement preparedStatementWithConnection:database.connection SQLite:sqlite sql:sql error:outError];
         [sql release];
         if (!insertStatement) {
-            return NO;
+            return nil;
         }
         
-        [database _setCachedStatement:insertStatement forKey:_insertStatementKey];
+        [database _setCachedStatement:insertStatement forKey:statementKey];
         
         // clang scan-build will issue a use-after release warning below if we don't do this (since it doesn't know that -_setCachedStatement:forKey: will retain.  Really, this makes sense since the method might do anything, including rejecting the new statement for some reason.  So, look it up again.
-        insertStatement = [database _cachedStatementForKey:_insertStatementKey];
+        insertStatement = [database _cachedStatementForKey:statementKey];
     }
     
+    return insertStatement;
+}
+
+- (BOOL)_writeInsert:(struct sqlite3 *)sqlite database:(ODODatabase *)database object:(ODOObject *)object error:(NSError **)outError;
+{
+    OBPRECONDITION(sqlite);
+    OBPRECONDITION(database);
+    OBPRECONDITION(object);
+    OBPRECONDITION([[object editingContext] database] == database);
+
+    ODOSQLStatement *insertStatement = [self _insertStatementForKey:_insertStatementKey rowCount:1 sqlite:sqlite database:database error:outError];
+    if (!insertStatement)
+        return NO;
+    
     // Bind all the property values.
-    if (!_bindInsertSchemaProperties(sqlite, insertStatement, object, _schemaProperties, outError))
+    if (!_bindInsertSchemaProperties(sqlite, insertStatement, object, _schemaProperties, 0, outError))
         return NO;
     
     return ODOSQLStatementRunWithoutResults(sqlite, insertStatement, outError);
 }
 
+- (BOOL)_writeInserts:(struct sqlite3 *)sqlite database:(ODODatabase *)database objects:(NSArray <ODOObject *> *)objects error:(NSError **)outError;
+{
+    OBPRECONDITION(sqlite);
+    OBPRECONDITION(database);
+    
+    NSUInteger propertyCount = [_schemaProperties count];
+    NSUInteger batchRowCount = _batchedWriteRowCount(sqlite, propertyCount);
+    NSUInteger objectIndex = 0, objectCount = [objects count];
+    
+    if (batchRowCount > 1 && objectCount >= batchRowCount) {
+        ODOSQLStatement *batchStatement = [self _insertStatementForKey:_batchInsertStatementKey rowCount:batchRowCount sqlite:sqlite database:database error:outError];
+        if (!batchStatement)
+            return NO;
+        
+        while (objectCount - objectIndex >= batchRowCount) {
+            NSUInteger rowIndex;
+            for (rowIndex = 0; rowIndex < batchRowCount; rowIndex++) {
+                ODOObject *object = [objects objectAtIndex:objectIndex + rowIndex];
+                OBASSERT([object entity] == self);
+                OBASSERT([[object editingContext] database] == database);
+                
+                if (!_bindInsertSchemaProperties(sqlite, batchStatement, object, _schemaProperties, rowIndex * propertyCount, outError))
+                    return NO;
+            }
+            
+            if (!ODOSQLStatementRunWithoutResults(sqlite, batchStatement, outError))
+                return NO;
+            
+            objectIndex += batchRowCount;
+        }
+    }
+    
+    // Write any leftovers one at a time rather than preparing a statement for every possible remainder size.
+    for (; objectIndex < objectCount; objectIndex++) {
+        if (![self _writeInsert:sqlite database:database object:[objects objectAtIndex:objectIndex] error:outError])
+            return NO;
+    }
+    
+    return YES;
+}
+
 // All the _non_ primary key values get bound first and then the pk.
 static BOOL _bindUpdateSchemaProperties(struct sqlite3 *sqlite, ODOSQLStatement *statement, ODOObject *object, NSArray *schemaProperties, ODOAttribute *primaryKeyAttribute, NSError **outError)
 {
@@ -380,6 +470,18 @@ static BOOL _bindUpdateSchemaProperties(struct sqlite3 *sqlite, ODOSQLStatement
     return ODOSQLStatementRunWithoutResults(sqlite, updateStatement, outError);
 }
 
+// SQLite has no multi-row UPDATE, but writing all the updates for an entity back-to-back at least keeps reusing the one prepared statement.
+- (BOOL)_writeUpdates:(struct sqlite3 *)sqlite database:(ODODatabase *)database objects:(NSArray <ODOObject *> *)objects error:(NSError **)outError;
+{
+    for (ODOObject *object in objects) {
+        OBASSERT([object entity] == self);
+        if (![self _writeUpdate:sqlite database:database object:object error:outError])
+            return NO;
+    }
+    
+    return YES;
+}
+
 - (BOOL)_writeDelete:(struct sqlite3 *)sqlite database:(ODODatabase *)database object:(ODOObject *)object error:(NSError **)outError;
 {
     OBPRECONDITION(sqlite);
@@ -417,6 +519,66 @@ static BOOL _bindUpdateSchemaProperties(struct sqlite3 *sqlite, ODOSQLStatement
     return ODOSQLStatementRun(sqlite, statement, callbacks, NULL, outError);
 }
 
+- (BOOL)_writeDeletes:(struct sqlite3 *)sqlite database:(ODODatabase *)database objects:(NSArray <ODOObject *> *)objects error:(NSError **)outError;
+{
+    OBPRECONDITION(sqlite);
+    OBPRECONDITION(database);
+    
+    NSUInteger batchRowCount = _batchedWriteRowCount(sqlite, 1);
+    NSUInteger objectIndex = 0, objectCount = [objects count];
+    
+    if (batchRowCount > 1 && objectCount >= batchRowCount) {
+        ODOSQLStatement *statement = [database _cachedStatementForKey:_batchDeleteStatementKey];
+        if (!statement) {
+            NSMutableString *sql = [[NSMutableString alloc] initWithFormat:@"DELETE FROM %@ WHERE %@ IN (", _name, [_primaryKeyAttribute name]];
+            _appendBindingPlaceholders(sql, batchRowCount);
+            [sql appendString:@")"];
+            
+            statement = [ODOSQLStatement preparedStatementWithConnection:database.connection SQLite:sqlite sql:sql error:outError];
+            [sql release];
+            if (!statement) {
+                return NO;
+            }
+            
+            [database _setCachedStatement:statement forKey:_batchDeleteStatementKey];
+            
+            // As above, look it up again to make scan-build happy.
+            statement = [database _cachedStatementForKey:_batchDeleteStatementKey];
+        }
+        
+        ODOSQLStatementCallbacks callbacks;
+        memset(&callbacks, 0, sizeof(callbacks));
+        callbacks.row = ODOSQLStatementIgnoreUnexpectedRow;
+#ifdef OMNI_ASSERTIONS_ON
+        callbacks.atEnd = _checkForBatchChangedRows;
+#endif
+        
+        while (objectCount - objectIndex >= batchRowCount) {
+            NSUInteger rowIndex;
+            for (rowIndex = 0; rowIndex < batchRowCount; rowIndex++) {
+                ODOObject *object = [objects objectAtIndex:objectIndex + rowIndex];
+                OBASSERT([object entity] == self);
+                OBASSERT([[object editingContext] database] == database);
+                
+                if (!_bindPlainAttribute(sqlite, statement, object, rowIndex, _primaryKeyAttribute, outError))
+                    return NO;
+            }
+            
+            if (!ODOSQLStatementRun(sqlite, statement, callbacks, &batchRowCount, outError))
+                return NO;
+            
+            objectIndex += batchRowCount;
+        }
+    }
+    
+    for (; objectIndex < objectCount; objectIndex++) {
+        if (![self _writeDelete:sqlite database:database object:[objects objectAtIndex:objectIndex] error:outError])
+            return NO;
+    }
+    
+    return YES;
+}
+
 - (ODOSQLStatement *)_queryByProperty:(ODOProperty *)property statementKey:(NSString *)statementKey database:(ODODatabase *)database sqlite:(struct sqlite3 *)sqlite error:(NSError **)outError;
 {
     OBPRECONDITION(property);
@@ -49,6 +49,8 @@ RCS_ID("$Id$")
     [_updateStatementKey release];
     [_deleteStatementKey release];
     [_queryByPrimaryKeyStatementKey release];
+    [_batchInsertStatementKey release];
+    [_batchDeleteStatementKey release];
 
     [_derivedPropertyNameSet release];
     [_nonDateModifyingPropertyNameSet release];
@@ -346,6 +348,10 @@ extern ODOEntity *ODOEntityCreate(NSString *entityName, NSString *insertKey, NSS
     entity->_updateStatementKey = [updateKey copy];
     entity->_deleteStatementKey = [deleteKey copy];
     entity->_queryByPrimaryKeyStatementKey = [pkQueryKey copy];
+
+    // The multi-row statements aren't named in the generated model; derive their keys in the same style as the ones that are.
+    entity->_batchInsertStatementKey = [[NSString alloc] initWithFormat:@"BI:%@", entityName];
+    entity->_batchDeleteStatementKey = [[NSString alloc] initWithFormat:@"BD:%@", entityName];
     
     OBASSERT(instanceClassName);
     entity->_instanceClass = NSClassFromString(instanceClassName);
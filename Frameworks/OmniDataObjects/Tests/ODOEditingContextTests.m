@@ -58,4 +58,106 @@ static NSUInteger DidSaveBlockAssociatedObjectKey;
     XCTAssertFalse(isInserted);
 }
 
+- (void)testFetchMergesPendingChanges;
+{
+    MASTER(matchingSaved);
+    MASTER(nonMatchingSaved);
+    matchingSaved.name = @"b";
+    nonMatchingSaved.name = @"z";
+    
+    NSError *error = nil;
+    XCTAssertTrue([self save:&error]);
+    
+    // Move one saved object out of the predicate range and the other into it, and insert one of each that hasn't been saved.
+    matchingSaved.name = @"y";
+    nonMatchingSaved.name = @"c";
+    MASTER(matchingInserted);
+    MASTER(nonMatchingInserted);
+    matchingInserted.name = @"a";
+    nonMatchingInserted.name = @"x";
+    
+    ODOFetchRequest *fetch = [[ODOFetchRequest alloc] init];
+    fetch.entity = [ODOTestCaseModel() entityNamed:ODOTestCaseMasterEntityName];
+    fetch.predicate = ODOKeyPathCompareToValuePredicate(ODOTestCaseMasterName, NSLessThanOrEqualToPredicateOperatorType, @"m");
+    
+    // Once with the edits still pending and once after they've been processed.
+    for (NSUInteger pass = 0; pass < 2; pass++) {
+        NSArray *results = [_editingContext executeFetchRequest:fetch error:&error];
+        XCTAssertNotNil(results);
+        XCTAssertEqualObjects([NSSet setWithArray:results], ([NSSet setWithObjects:nonMatchingSaved, matchingInserted, nil]));
+        XCTAssertEqual([results count], 2UL);
+        
+        [_editingContext processPendingChanges];
+    }
+}
+
+- (void)testFetchMergesPendingChangesWithCaseInsensitivePredicate;
+{
+    MASTER(updated);
+    updated.name = @"x";
+    
+    NSError *error = nil;
+    XCTAssertTrue([self save:&error]);
+    
+    // None of these match the predicate exactly, so only a case insensitive comparison of the pending changes finds them.
+    updated.name = @"Alpha";
+    MASTER(matchingInserted);
+    MASTER(nonMatchingInserted);
+    matchingInserted.name = @"ALPHA";
+    nonMatchingInserted.name = @"beta";
+    
+    ODOFetchRequest *fetch = [[ODOFetchRequest alloc] init];
+    fetch.entity = [ODOTestCaseModel() entityNamed:ODOTestCaseMasterEntityName];
+    fetch.predicate = [NSPredicate predicateWithFormat:@"%K ==[c] %@", ODOTestCaseMasterName, @"alpha"];
+    
+    for (NSUInteger pass = 0; pass < 2; pass++) {
+        NSArray *results = [_editingContext executeFetchRequest:fetch error:&error];
+        XCTAssertNotNil(results);
+        XCTAssertEqualObjects([NSSet setWithArray:results], ([NSSet setWithObjects:updated, matchingInserted, nil]));
+        XCTAssertEqual([results count], 2UL);
+        
+        [_editingContext processPendingChanges];
+    }
+}
+
+- (void)testBatchedFaulting;
+{
+    const NSUInteger masterCount = 20;
+    NSError *error = nil;
+    
+    for (NSUInteger masterIndex = 0; masterIndex < masterCount; masterIndex++) {
+        ODOTestCaseMaster *master = _insertTestObject(_editingContext, [ODOTestCaseMaster class], ODOTestCaseMasterEntityName, [NSString stringWithFormat:@"m%lu", masterIndex]);
+        _insertDetail(_editingContext, [NSString stringWithFormat:@"d%lu", masterIndex], master);
+    }
+    XCTAssertTrue([self save:&error]);
+    [_editingContext reset];
+    
+    ODOFetchRequest *fetch = [[ODOFetchRequest alloc] init];
+    fetch.entity = [ODOTestCaseModel() entityNamed:ODOTestCaseDetailEntityName];
+    
+    [_editingContext performWithBatchedFaulting:^{
+        NSError *fetchError = nil;
+        NSArray <ODOTestCaseDetail *> *details = [_editingContext executeFetchRequest:fetch error:&fetchError];
+        XCTAssertEqual([details count], masterCount);
+        
+        NSArray <ODOTestCaseMaster *> *masters = [details arrayByPerformingBlock:^(ODOTestCaseDetail *detail){
+            return detail.master;
+        }];
+        XCTAssertTrue([masters allObjectsSatisfyPredicate:^BOOL(ODOTestCaseMaster *master){ return [master isFault]; }]);
+        
+        // Fulfilling any one of the faults should fulfill all the others of that entity.
+        XCTAssertNotNil([masters[0] name]);
+        XCTAssertFalse([masters anyObjectSatisfiesPredicate:^BOOL(ODOTestCaseMaster *master){ return [master isFault]; }]);
+    }];
+    
+    // Explicitly fetching a set of faults
+    [_editingContext reset];
+    NSArray <ODOTestCaseDetail *> *details = [_editingContext executeFetchRequest:fetch error:&error];
+    NSArray <ODOTestCaseMaster *> *masters = [details arrayByPerformingBlock:^(ODOTestCaseDetail *detail){
+        return detail.master;
+    }];
+    XCTAssertTrue([_editingContext fetchFaultsForObjects:masters error:&error]);
+    XCTAssertFalse([masters anyObjectSatisfiesPredicate:^BOOL(ODOTestCaseMaster *master){ return [master isFault]; }]);
+}
+
 @end
@@ -0,0 +1,79 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import "ODOTestCase.h"
+
+RCS_ID("$Id$");
+
+// Times the classic N+1 traversal of fetching details and then walking each one's to-one master, with and without batched faulting. Results are logged rather than asserted since they depend on the machine.
+
+@interface ODOFaultingBenchmarks : ODOTestCase
+@end
+
+@implementation ODOFaultingBenchmarks
+
+- (void)_insertMastersWithDetailCount:(NSUInteger)count;
+{
+    NSError *error = nil;
+
+    @autoreleasepool {
+        for (NSUInteger objectIndex = 0; objectIndex < count; objectIndex++) {
+            ODOTestCaseMaster *master = _insertTestObject(_editingContext, [ODOTestCaseMaster class], ODOTestCaseMasterEntityName, [NSString stringWithFormat:@"m%lu", objectIndex]);
+            master.name = [NSString stringWithFormat:@"master %lu", objectIndex];
+            _insertDetail(_editingContext, [NSString stringWithFormat:@"d%lu", objectIndex], master);
+        }
+    }
+    OBShouldNotError([self save:&error]);
+    [_editingContext reset];
+}
+
+- (CFAbsoluteTime)_timeTraversal;
+{
+    ODOFetchRequest *fetch = [[ODOFetchRequest alloc] init];
+    fetch.entity = [ODOTestCaseModel() entityNamed:ODOTestCaseDetailEntityName];
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    @autoreleasepool {
+        NSError *error = nil;
+        NSArray <ODOTestCaseDetail *> *details = [_editingContext executeFetchRequest:fetch error:&error];
+        XCTAssertNotNil(details);
+
+        for (ODOTestCaseDetail *detail in details) {
+            XCTAssertNotNil(detail.master.name);
+        }
+    }
+    CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+
+    [_editingContext reset];
+    return elapsed;
+}
+
+- (void)_benchmarkTraversalWithCount:(NSUInteger)count;
+{
+    [self _insertMastersWithDetailCount:count];
+
+    CFAbsoluteTime unbatched = [self _timeTraversal];
+
+    __block CFAbsoluteTime batched = 0;
+    [_editingContext performWithBatchedFaulting:^{
+        batched = [self _timeTraversal];
+    }];
+
+    NSLog(@"detail->master traversal of %lu objects: %.3fs unbatched, %.3fs batched (%.1fx)", count, unbatched, batched, batched > 0 ? unbatched / batched : 0.0);
+}
+
+- (void)testTraversal1k;
+{
+    [self _benchmarkTraversalWithCount:1000];
+}
+
+- (void)testTraversal10k;
+{
+    [self _benchmarkTraversalWithCount:10000];
+}
+
+@end
@@ -0,0 +1,85 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import "ODOTestCase.h"
+
+RCS_ID("$Id$");
+
+// Times fetches that have to be merged with varying numbers of pending (unsaved) changes. Results are logged rather than asserted since they depend on the machine.
+
+extern uint64_t dispatch_benchmark(size_t count, void (^block)(void));
+
+@interface ODOFetchBenchmarks : ODOTestCase
+@end
+
+@implementation ODOFetchBenchmarks
+
+static const NSUInteger ODOFetchBenchmarkSavedObjectCount = 1000;
+static const size_t ODOFetchBenchmarkIterations = 20;
+
+- (void)_benchmarkFetchWithPendingChangeCount:(NSUInteger)changeCount;
+{
+    NSError *error = nil;
+    NSMutableArray *savedMasters = [NSMutableArray array];
+
+    for (NSUInteger objectIndex = 0; objectIndex < ODOFetchBenchmarkSavedObjectCount; objectIndex++) {
+        ODOTestCaseMaster *master = _insertTestObject(_editingContext, [ODOTestCaseMaster class], ODOTestCaseMasterEntityName, [NSString stringWithFormat:@"saved%lu", objectIndex]);
+        master.name = [NSString stringWithFormat:@"%05lu", objectIndex];
+        [savedMasters addObject:master];
+    }
+    OBShouldNotError([self save:&error]);
+
+    // Half the pending changes are inserts and half are updates to saved objects (wrapping around if there are more updates than saved objects).
+    for (NSUInteger changeIndex = 0; changeIndex < changeCount; changeIndex++) {
+        if (changeIndex % 2 == 0) {
+            ODOTestCaseMaster *master = _insertTestObject(_editingContext, [ODOTestCaseMaster class], ODOTestCaseMasterEntityName, [NSString stringWithFormat:@"pending%lu", changeIndex]);
+            master.name = [NSString stringWithFormat:@"%05lu", changeIndex];
+        } else {
+            ODOTestCaseMaster *master = savedMasters[(changeIndex / 2) % ODOFetchBenchmarkSavedObjectCount];
+            master.name = [NSString stringWithFormat:@"%05lu", changeIndex];
+        }
+    }
+    [_editingContext processPendingChanges];
+
+    ODOFetchRequest *fetch = [[ODOFetchRequest alloc] init];
+    fetch.entity = [ODOTestCaseModel() entityNamed:ODOTestCaseMasterEntityName];
+    fetch.predicate = ODOKeyPathCompareToValuePredicate(ODOTestCaseMasterName, NSLessThanPredicateOperatorType, @"00500");
+
+    __block NSUInteger resultCount = 0;
+    uint64_t nanoseconds = dispatch_benchmark(ODOFetchBenchmarkIterations, ^{
+        @autoreleasepool {
+            NSError *fetchError = nil;
+            NSArray *results = [_editingContext executeFetchRequest:fetch error:&fetchError];
+            XCTAssertNotNil(results);
+            resultCount = [results count];
+        }
+    });
+
+    NSLog(@"fetch with %lu pending changes: %lu results in %.3fms", changeCount, resultCount, nanoseconds / 1e6);
+}
+
+- (void)testFetchWith0PendingChanges;
+{
+    [self _benchmarkFetchWithPendingChangeCount:0];
+}
+
+- (void)testFetchWith1kPendingChanges;
+{
+    [self _benchmarkFetchWithPendingChangeCount:1000];
+}
+
+- (void)testFetchWith10kPendingChanges;
+{
+    [self _benchmarkFetchWithPendingChangeCount:10000];
+}
+
+- (void)testFetchWith50kPendingChanges;
+{
+    [self _benchmarkFetchWithPendingChangeCount:50000];
+}
+
+@end
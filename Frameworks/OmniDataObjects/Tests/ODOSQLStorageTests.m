@@ -32,4 +32,59 @@ RCS_ID("$Id$");
     OBShouldNotError([_database disconnect:&error]);
 }
 
+- (NSArray *)_fetchAllObjectsOfEntityNamed:(NSString *)entityName;
+{
+    ODOFetchRequest *fetch = [[ODOFetchRequest alloc] init];
+    [fetch setEntity:[ODOTestCaseModel() entityNamed:entityName]];
+    
+    NSError *error = nil;
+    NSArray *results;
+    OBShouldNotError((results = [_editingContext executeFetchRequest:fetch error:&error]) != nil);
+    return results;
+}
+
+// Saves enough objects to span several multi-row statements plus a remainder that gets written row-by-row.
+- (void)testBatchedInsertUpdateAndDelete;
+{
+    const NSUInteger objectCount = 1000;
+    NSError *error = nil;
+    
+    for (NSUInteger objectIndex = 0; objectIndex < objectCount; objectIndex++) {
+        ODOTestCaseMaster *master = _insertTestObject(_editingContext, [ODOTestCaseMaster class], ODOTestCaseMasterEntityName, [NSString stringWithFormat:@"m%lu", objectIndex]);
+        master.name = [NSString stringWithFormat:@"name %lu", objectIndex];
+        _insertDetail(_editingContext, [NSString stringWithFormat:@"d%lu", objectIndex], master);
+    }
+    OBShouldNotError([self save:&error]);
+    [_editingContext reset];
+    
+    NSArray *masters = [self _fetchAllObjectsOfEntityNamed:ODOTestCaseMasterEntityName];
+    XCTAssertEqual([masters count], objectCount);
+    XCTAssertEqual([[self _fetchAllObjectsOfEntityNamed:ODOTestCaseDetailEntityName] count], objectCount);
+    
+    for (ODOTestCaseMaster *master in masters) {
+        NSString *expectedName = [@"name " stringByAppendingString:[master.objectID.primaryKey substringFromIndex:1]];
+        XCTAssertEqualObjects(master.name, expectedName);
+    }
+    
+    // Update every master and delete every other one (cascading to its detail).
+    NSUInteger deletedCount = 0;
+    for (ODOTestCaseMaster *master in masters) {
+        if (([[master.objectID.primaryKey substringFromIndex:1] integerValue] % 2) == 0) {
+            OBShouldNotError([_editingContext deleteObject:master error:&error]);
+            deletedCount++;
+        } else {
+            master.name = @"updated";
+        }
+    }
+    OBShouldNotError([self save:&error]);
+    [_editingContext reset];
+    
+    masters = [self _fetchAllObjectsOfEntityNamed:ODOTestCaseMasterEntityName];
+    XCTAssertEqual([masters count], objectCount - deletedCount);
+    XCTAssertEqual([[self _fetchAllObjectsOfEntityNamed:ODOTestCaseDetailEntityName] count], objectCount - deletedCount);
+    for (ODOTestCaseMaster *master in masters) {
+        XCTAssertEqualObjects(master.name, @"updated");
+    }
+}
+
 @end
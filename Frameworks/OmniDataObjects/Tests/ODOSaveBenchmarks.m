@@ -0,0 +1,83 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import "ODOTestCase.h"
+
+RCS_ID("$Id$");
+
+// Times saves of large numbers of inserts, updates and deletes, broken down by entity. Results are logged rather than asserted since they depend on the machine.
+
+@interface ODOSaveBenchmarks : ODOTestCase
+@end
+
+@implementation ODOSaveBenchmarks
+
+static void _logSaveTiming(NSString *phase, NSString *entityName, NSUInteger rowCount, CFAbsoluteTime elapsed)
+{
+    NSLog(@"%@ %@: %lu rows in %.3fs (%.0f rows/s)", phase, entityName, rowCount, elapsed, elapsed > 0 ? rowCount / elapsed : 0.0);
+}
+
+- (CFAbsoluteTime)_timeSave;
+{
+    [self closeUndoGroup];
+
+    NSError *error = nil;
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    OBShouldNotError([_editingContext saveWithDate:[NSDate date] error:&error]);
+    return CFAbsoluteTimeGetCurrent() - start;
+}
+
+- (void)_benchmarkSaveWithRowCount:(NSUInteger)rowCount;
+{
+    NSError *error = nil;
+    NSMutableArray *masters = [NSMutableArray arrayWithCapacity:rowCount];
+
+    @autoreleasepool {
+        for (NSUInteger rowIndex = 0; rowIndex < rowCount; rowIndex++) {
+            ODOTestCaseMaster *master = _insertTestObject(_editingContext, [ODOTestCaseMaster class], ODOTestCaseMasterEntityName, [NSString stringWithFormat:@"m%lu-%lu", rowCount, rowIndex]);
+            master.name = [NSString stringWithFormat:@"master %lu", rowIndex];
+            [masters addObject:master];
+        }
+    }
+    _logSaveTiming(@"insert", ODOTestCaseMasterEntityName, rowCount, [self _timeSave]);
+
+    @autoreleasepool {
+        NSUInteger rowIndex = 0;
+        for (ODOTestCaseMaster *master in masters) {
+            _insertDetail(_editingContext, [NSString stringWithFormat:@"d%lu-%lu", rowCount, rowIndex++], master);
+        }
+    }
+    _logSaveTiming(@"insert", ODOTestCaseDetailEntityName, rowCount, [self _timeSave]);
+
+    for (ODOTestCaseMaster *master in masters) {
+        master.name = @"updated";
+    }
+    _logSaveTiming(@"update", ODOTestCaseMasterEntityName, rowCount, [self _timeSave]);
+
+    // Deleting the masters cascades to the details, so this covers both entities.
+    for (ODOTestCaseMaster *master in masters) {
+        OBShouldNotError([_editingContext deleteObject:master error:&error]);
+    }
+    _logSaveTiming(@"delete", @"Master+Detail", 2 * rowCount, [self _timeSave]);
+}
+
+- (void)testSave1k;
+{
+    [self _benchmarkSaveWithRowCount:1000];
+}
+
+- (void)testSave10k;
+{
+    [self _benchmarkSaveWithRowCount:10000];
+}
+
+- (void)testSave100k;
+{
+    [self _benchmarkSaveWithRowCount:100000];
+}
+
+@end
@@ -0,0 +1,86 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import "ODOTestCase.h"
+
+RCS_ID("$Id$");
+
+// Times full-table CONTAINS/BEGINSWITH searches run by the SQLite string comparison functions, over ASCII and non-ASCII text. Results are logged rather than asserted since they depend on the machine.
+
+@interface ODOSearchBenchmarks : ODOTestCase
+@end
+
+@implementation ODOSearchBenchmarks
+
+static const NSUInteger ODOSearchBenchmarkRowCount = 50000;
+static const NSUInteger ODOSearchBenchmarkIterations = 5;
+
+- (void)_insertRowsWithNameFormat:(NSString *)nameFormat;
+{
+    NSError *error = nil;
+
+    @autoreleasepool {
+        for (NSUInteger rowIndex = 0; rowIndex < ODOSearchBenchmarkRowCount; rowIndex++) {
+            ODOTestCaseMaster *master = _insertTestObject(_editingContext, [ODOTestCaseMaster class], ODOTestCaseMasterEntityName, [NSString stringWithFormat:@"m%lu", rowIndex]);
+            master.name = [NSString stringWithFormat:nameFormat, rowIndex];
+        }
+    }
+    OBShouldNotError([self save:&error]);
+
+    // Search the database rather than registered objects
+    [_editingContext reset];
+}
+
+- (void)_timeSearchWithType:(NSPredicateOperatorType)type string:(NSString *)string options:(NSComparisonPredicateOptions)options label:(NSString *)label;
+{
+    ODOFetchRequest *fetch = [[ODOFetchRequest alloc] init];
+    fetch.entity = [ODOTestCaseModel() entityNamed:ODOTestCaseMasterEntityName];
+    fetch.predicate = [NSComparisonPredicate predicateWithLeftExpression:[NSExpression expressionForKeyPath:ODOTestCaseMasterName] rightExpression:[NSExpression expressionForConstantValue:string] modifier:NSDirectPredicateModifier type:type options:options];
+
+    NSUInteger resultCount = 0;
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger iteration = 0; iteration < ODOSearchBenchmarkIterations; iteration++) {
+        @autoreleasepool {
+            NSError *error = nil;
+            NSArray *results = [_editingContext executeFetchRequest:fetch error:&error];
+            XCTAssertNotNil(results);
+            resultCount = [results count];
+            [_editingContext reset];
+        }
+    }
+    CFAbsoluteTime elapsed = (CFAbsoluteTimeGetCurrent() - start) / ODOSearchBenchmarkIterations;
+
+    NSLog(@"%@: %lu of %lu rows matched in %.3fms (%.0f rows/s)", label, resultCount, ODOSearchBenchmarkRowCount, elapsed * 1e3, ODOSearchBenchmarkRowCount / elapsed);
+}
+
+- (void)testASCIISearch;
+{
+    [self _insertRowsWithNameFormat:@"Creme brulee recipe number %lu"];
+
+    [self _timeSearchWithType:NSContainsPredicateOperatorType string:@"number 4" options:0 label:@"ASCII contains"];
+    [self _timeSearchWithType:NSContainsPredicateOperatorType string:@"NUMBER 4" options:NSCaseInsensitivePredicateOption label:@"ASCII contains[c]"];
+    [self _timeSearchWithType:NSContainsPredicateOperatorType string:@"NUMBER 4" options:NSCaseInsensitivePredicateOption|NSDiacriticInsensitivePredicateOption label:@"ASCII contains[cd]"];
+    [self _timeSearchWithType:NSBeginsWithPredicateOperatorType string:@"CREME" options:NSCaseInsensitivePredicateOption|NSDiacriticInsensitivePredicateOption label:@"ASCII beginswith[cd]"];
+}
+
+- (void)testLatinSearch;
+{
+    [self _insertRowsWithNameFormat:@"Crème brûlée à la façon numéro %lu"];
+
+    [self _timeSearchWithType:NSContainsPredicateOperatorType string:@"NUMÉRO 4" options:NSCaseInsensitivePredicateOption label:@"Latin contains[c]"];
+    [self _timeSearchWithType:NSContainsPredicateOperatorType string:@"facon numero 4" options:NSCaseInsensitivePredicateOption|NSDiacriticInsensitivePredicateOption label:@"Latin contains[cd]"];
+    [self _timeSearchWithType:NSBeginsWithPredicateOperatorType string:@"creme" options:NSCaseInsensitivePredicateOption|NSDiacriticInsensitivePredicateOption label:@"Latin beginswith[cd]"];
+}
+
+- (void)testGreekAndCJKSearch;
+{
+    [self _insertRowsWithNameFormat:@"ΕΛΛΗΝΙΚΆ 日本語のテキスト %lu"];
+
+    [self _timeSearchWithType:NSContainsPredicateOperatorType string:@"ελληνικα 日本語のテキスト 4" options:NSCaseInsensitivePredicateOption|NSDiacriticInsensitivePredicateOption label:@"Greek/CJK contains[cd]"];
+}
+
+@end
@@ -17,7 +17,6 @@ OB_REQUIRE_ARC;
 @implementation ODOLikeTests
 
 // TODO: Test passing NULL
-// TODO: Test passing case/diacritical on both search and text
 // Contains and diacritical are only on 10.5 and iPhone, so doing tests of those here doesn't pan out.
 - (void)_setupWithStrings:(NSArray *)strings;
 {    
@@ -34,11 +33,16 @@ OB_REQUIRE_ARC;
 }
 
 - (NSArray *)_fetchWithType:(NSPredicateOperatorType)type string:(NSString *)string;
+{
+    return [self _fetchWithType:type string:string options:0];
+}
+
+- (NSArray *)_fetchWithType:(NSPredicateOperatorType)type string:(NSString *)string options:(NSComparisonPredicateOptions)options;
 {
     NSError *error = nil;
     ODOEntity *entity = [[_database model] entityNamed:ODOTestCaseMasterEntityName];
 
-    NSPredicate *predicate = ODOKeyPathCompareToValuePredicate(@"name", type, string);
+    NSPredicate *predicate = [NSComparisonPredicate predicateWithLeftExpression:[NSExpression expressionForKeyPath:@"name"] rightExpression:[NSExpression expressionForConstantValue:string] modifier:NSDirectPredicateModifier type:type options:options];
     ODOFetchRequest *fetch = [[ODOFetchRequest alloc] init];
     [fetch setEntity:entity];
     [fetch setPredicate:predicate];
@@ -75,4 +79,35 @@ OB_REQUIRE_ARC;
     XCTAssertEqualObjects([[foundObject objectID] primaryKey], @"spoon");
 }
 
+- (NSSet *)_primaryKeysFetchedWithType:(NSPredicateOperatorType)type string:(NSString *)string options:(NSComparisonPredicateOptions)options;
+{
+    NSMutableSet *primaryKeys = [NSMutableSet set];
+    for (ODOObject *object in [self _fetchWithType:type string:string options:options])
+        [primaryKeys addObject:[[object objectID] primaryKey]];
+    return primaryKeys;
+}
+
+- (void)testCaseAndDiacriticInsensitiveFetch;
+{
+    NSError *error = nil;
+    
+    [self _setupWithStrings:@[@"Cr\u00e8me br\u00fbl\u00e9e", @"CREME", @"cre\u0300me fra\u00eeche", @"spoon", @"\u0395\u03bb\u03bb\u03b7\u03bd\u03b9\u03ba\u03ac"]];
+    OBShouldNotError([_editingContext saveWithDate:[NSDate date] error:&error]);
+    
+    // Make sure we are matching in SQLite rather than against registered objects.
+    [_editingContext reset];
+    
+    NSSet *cremes = [NSSet setWithObjects:@"Cr\u00e8me br\u00fbl\u00e9e", @"CREME", @"cre\u0300me fra\u00eeche", nil];
+    XCTAssertEqualObjects([self _primaryKeysFetchedWithType:NSContainsPredicateOperatorType string:@"creme" options:NSCaseInsensitivePredicateOption|NSDiacriticInsensitivePredicateOption], cremes);
+    XCTAssertEqualObjects([self _primaryKeysFetchedWithType:NSBeginsWithPredicateOperatorType string:@"CR\u00c8ME" options:NSCaseInsensitivePredicateOption|NSDiacriticInsensitivePredicateOption], cremes);
+    XCTAssertEqualObjects([self _primaryKeysFetchedWithType:NSContainsPredicateOperatorType string:@"BR\u00dbL" options:NSCaseInsensitivePredicateOption], [NSSet setWithObject:@"Cr\u00e8me br\u00fbl\u00e9e"]);
+    XCTAssertEqualObjects([self _primaryKeysFetchedWithType:NSContainsPredicateOperatorType string:@"brul" options:NSCaseInsensitivePredicateOption], [NSSet set]);
+    XCTAssertEqualObjects([self _primaryKeysFetchedWithType:NSContainsPredicateOperatorType string:@"fraiche" options:NSDiacriticInsensitivePredicateOption], [NSSet setWithObject:@"cre\u0300me fra\u00eeche"]);
+    XCTAssertEqualObjects([self _primaryKeysFetchedWithType:NSContainsPredicateOperatorType string:@"\u03bb\u03b7\u03bd" options:NSCaseInsensitivePredicateOption], [NSSet setWithObject:@"\u0395\u03bb\u03bb\u03b7\u03bd\u03b9\u03ba\u03ac"]);
+    XCTAssertEqualObjects([self _primaryKeysFetchedWithType:NSBeginsWithPredicateOperatorType string:@"\u03b5\u03bb" options:NSCaseInsensitivePredicateOption], [NSSet setWithObject:@"\u0395\u03bb\u03bb\u03b7\u03bd\u03b9\u03ba\u03ac"]);
+    
+    // Exact matching is case sensitive.
+    XCTAssertEqualObjects([self _primaryKeysFetchedWithType:NSContainsPredicateOperatorType string:@"REME" options:0], [NSSet setWithObject:@"CREME"]);
+}
+
 @end
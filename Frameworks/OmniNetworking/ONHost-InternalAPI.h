@@ -16,5 +16,6 @@
 - (BOOL)isExpired;
 
 - (void)_lookupHostInfoUsingGetaddrinfo;
+- (void)_lookupHostInfoUsingCustomResolver;
 
 @end
@@ -12,6 +12,11 @@
 
 #import <Foundation/NSDate.h> // For NSTimeInterval
 
+@class ONHost, NSException;
+
+typedef void (^ONHostLookupHandler)(ONHost *host, NSException *exception);
+typedef NSArray *(^ONHostResolver)(NSString *hostname, NSTimeInterval *timeToLive);
+
 @interface ONHost : OBObject
 
 + (void)setResolverType:(NSString *)resolverType;
@@ -25,14 +30,25 @@
 /* Returns the local host's name, if available, or returns "localhost". */
 + (NSString *)localHostname;
 
+/* Lookups by name are cached, ignoring case. Failures are cached too, briefly (see +setNegativeTimeToLiveTimeInterval:), and answers are looked up again in the background shortly before they expire. If a lookup of the same name is already under way, this waits for it rather than starting another; otherwise it looks the name up on the calling thread. */
 + (ONHost *)hostForHostname:(NSString *)aHostname;
 + (ONHost *)hostForAddress:(ONHostAddress *)anAddress;
 
+/* Looks up a host by name without blocking, sharing the cache with +hostForHostname:, and calls the handler with the host or with the exception +hostForHostname: would have raised. The handler is called right away if the answer is cached, and otherwise on the thread that finishes the lookup, usually one of a small pool of resolver threads. */
++ (void)lookupHostname:(NSString *)aHostname completionHandler:(ONHostLookupHandler)handler;
++ (void)setMaximumConcurrentLookups:(NSUInteger)limit;
+    // The most resolver threads +lookupHostname:completionHandler: will use (4 by default).
+
 + (NSString *)IDNEncodedHostname:(NSString *)aHostname;
 + (NSString *)IDNDecodedHostname:(NSString *)anIDNHostname;
 
 + (void)flushCache;
 + (void)setDefaultTimeToLiveTimeInterval:(NSTimeInterval)newValue;
++ (void)setNegativeTimeToLiveTimeInterval:(NSTimeInterval)newValue;
+    // How long a failed lookup by name is remembered (5 seconds by default).
+
+/* Replaces getaddrinfo() for lookups by name, e.g. to test against names that resolve slowly or not at all. The resolver returns the host's addresses, an empty array if it has none, or nil if there is no such host, and may set *timeToLive to say how long the answer is good for. Pass nil to go back to getaddrinfo(). */
++ (void)setResolver:(ONHostResolver)resolver;
 
 /* Determines whether ONHost tries to look up 'AAAA' records as well as 'A' records. At the moment this has no effect on the actual lookup, but prevents non-IPv4 addresses from being returned by ONHost's -addresses method. */
 + (void)setOnlyResolvesIPv4Addresses:(BOOL)v4Only;
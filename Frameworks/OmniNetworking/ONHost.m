@@ -14,9 +14,12 @@
 
 #import "ONHost-InternalAPI.h"
 #import <OmniNetworking/ONHostAddress.h>
+#import <OmniNetworking/ONInterfaceMonitor.h>
 #import <OmniNetworking/ONPortAddress.h>
 #import <OmniNetworking/ONServiceEntry.h>
 
+#include <pthread.h>
+
 RCS_ID("$Id$")
 
 #ifndef MAX_HOSTNAME_LEN
@@ -27,6 +30,45 @@ RCS_ID("$Id$")
 #endif
 #endif
 
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t lookupFinished;
+    CFMutableDictionaryRef entries; // hostname -> ONHostNameCacheEntry
+} ONHostNameCacheStripe;
+
+/* An entry in the cache of lookups by name, protected by its stripe's lock (see +hostForHostname:) */
+@interface ONHostNameCacheEntry : NSObject
+{
+@public
+    Class hostClass;
+    NSString *hostname; // As we look it up
+    ONHostNameCacheStripe *stripe;
+
+    ONHost *host;
+    NSException *exception;
+    CFAbsoluteTime expirationTime;
+    CFAbsoluteTime refreshTime;
+
+    BOOL lookupInFlight;
+    BOOL refreshing; // The lookup in flight is a background refresh of an answer that's still good
+    BOOL flushed; // +flushCache came along while the lookup was in flight
+    NSMutableArray *handlers; // Waiting for the lookup in flight
+}
+@end
+
+@implementation ONHostNameCacheEntry
+
+- (void)dealloc;
+{
+    [hostname release];
+    [host release];
+    [exception release];
+    [handlers release];
+    [super dealloc];
+}
+
+@end
+
 @implementation ONHost
 {
     NSString *hostname;
@@ -46,11 +88,19 @@ static enum {
     /* getaddrinfo() is threadable and versatile, but triggers a bug in the name servers used by a couple of high-profile websites whose names I will not mention here. */
     Resolver_getaddrinfo,
     /* Or, of course, we could just not look stuff up at all. */
-    Resolver_none
+    Resolver_none,
+    /* Or ask a block (see +setResolver:) */
+    Resolver_custom
 } ONHostResolverAPI = Resolver_getaddrinfo;
 
+static NSTimeInterval ONHostNegativeTimeToLiveTimeInterval = 5.0; // Read by resolving threads, so accessed atomically
+
+static void initializeNameCache(void);
+static void flushNameCache(void);
+
 /* The following variables are all protected by ONHostLookupLock */
-static NSMutableDictionary *hostCache;
+static NSMutableDictionary *hostCache; // ONHostAddress -> ONHost
+static ONHostResolver customResolver;
 static NSString *domainName;
 static NSString *localHostname;
 static SCDynamicStoreRef systemConfigSession;
@@ -68,6 +118,7 @@ static void locked_disconnectFromSysConfig(void);
 
     ONHostLookupLock = [[NSRecursiveLock alloc] init];
     hostCache = [[NSMutableDictionary alloc] initWithCapacity:16];
+    initializeNameCache();
 
     localHostname = nil;
     domainName = nil;
@@ -76,6 +127,34 @@ static void locked_disconnectFromSysConfig(void);
     squatterAddresses = [[NSSet alloc] initWithObjects:
         [ONHostAddress addressWithIPv4UnsignedLong:0x405E6E0BUL],
         nil];
+
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(_interfacesDidChange:) name:ONInterfaceMonitorInterfacesDidChangeNotification object:nil];
+    [ONInterfaceMonitor sharedMonitor];
+}
+
+/* Only the cached lookups that an interface change could have affected are dropped: reverse lookups of the addresses that came or went, and our own names. Lookups by name only depend on the interfaces through getaddrinfo()'s AI_ADDRCONFIG, which decides whether to ask for IPv4 and IPv6 addresses according to which of them the host has, so they're kept unless that changed. */
++ (void)_interfacesDidChange:(NSNotification *)notification;
+{
+    NSDictionary *userInfo = [notification userInfo];
+
+    [ONHostLookupLock lock];
+    if (ONHostNameLookupDebug)
+        NSLog(@"<%@> Network interfaces changed: %@", [NSThread currentThread], userInfo);
+    for (NSString *key in @[ONInterfaceMonitorAddedAddressesKey, ONInterfaceMonitorRemovedAddressesKey]) {
+        for (ONHostAddress *address in [userInfo objectForKey:key]) {
+            // Only remove the ONHost entries, not the pending locks
+            if ([[hostCache objectForKey:address] isKindOfClass:self])
+                [hostCache removeObjectForKey:address];
+        }
+    }
+    [domainName release];
+    domainName = nil;
+    [localHostname release];
+    localHostname = nil;
+    [ONHostLookupLock unlock];
+
+    if ([[userInfo objectForKey:ONInterfaceMonitorConfiguredAddressFamiliesChangedKey] boolValue])
+        flushNameCache();
 }
 
 + (void)setDebug:(BOOL)newDebugSetting;
@@ -302,80 +381,379 @@ static void locked_disconnectFromSysConfig(void)
     return nil;
 }
 
-+ (ONHost *)hostForHostname:(NSString *)aHostname;
+#pragma mark - Looking up names
+
+/* Lookups by name go through a cache split into stripes, each with its own lock, so that threads looking up different names rarely contend. Names are compared ignoring ASCII case (as DNS does), so case variants of a name share an entry without costing a -lowercaseString apiece.
+   An entry holds an answer (a host, or the exception its lookup raised) until it expires, and notes whether a lookup of its name is in flight, so that later requests for the name wait for that answer rather than starting their own. Failures are remembered too, briefly, so that a burst of requests for a name that doesn't resolve doesn't wait out the resolver's timeout over and over. Answers are looked up again in the background a little before they expire, so that busy names don't stall when they do. */
+
+#define NAME_CACHE_STRIPE_COUNT 16
+#define NAME_CACHE_STRIPE_LIMIT 1024 // Once a stripe has this many entries, it's pruned...
+#define NAME_CACHE_PRUNED_COUNT 768 // ...to at most this many, so that a stripe full of live answers isn't scanned again on the next insert
+#define NAME_CACHE_REFRESH_FRACTION 0.8 // How far into an answer's life to look it up again
+
+static ONHostNameCacheStripe nameCacheStripes[NAME_CACHE_STRIPE_COUNT];
+
+/* Asynchronous lookups are queued for a small pool of resolver threads, which start as needed and then wait around for more work. */
+static pthread_mutex_t resolverQueueLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t resolverQueueCondition = PTHREAD_COND_INITIALIZER;
+static NSMutableArray *resolverQueue; // ONHostNameCacheEntries
+static NSUInteger resolverThreadCount, idleResolverThreadCount;
+static NSUInteger resolverThreadLimit = 4;
+
+static CFHashCode hostnameHash(const void *value)
 {
-    ONHost *host;
-    NSThread *currentThread = nil;
-    NSLock *pendingLock;
-    NSException *raisedException = nil;
+    CFStringRef string = (CFStringRef)value;
+    CFIndex characterIndex, length = CFStringGetLength(string);
+    CFStringInlineBuffer buffer;
+    CFHashCode hash = length;
+
+    CFStringInitInlineBuffer(string, &buffer, CFRangeMake(0, length));
+    for (characterIndex = 0; characterIndex < length; characterIndex++) {
+        UniChar character = CFStringGetCharacterFromInlineBuffer(&buffer, characterIndex);
+        if (character >= 'A' && character <= 'Z')
+            character += 'a' - 'A';
+        hash = hash * 31 + character;
+    }
+    return hash;
+}
 
-    if (!aHostname)
-	return nil;
+static Boolean hostnamesEqual(const void *value1, const void *value2)
+{
+    CFStringRef string1 = (CFStringRef)value1, string2 = (CFStringRef)value2;
+    CFIndex characterIndex, length = CFStringGetLength(string1);
+    CFStringInlineBuffer buffer1, buffer2;
+
+    if (CFStringGetLength(string2) != length)
+        return false;
+    CFStringInitInlineBuffer(string1, &buffer1, CFRangeMake(0, length));
+    CFStringInitInlineBuffer(string2, &buffer2, CFRangeMake(0, length));
+    for (characterIndex = 0; characterIndex < length; characterIndex++) {
+        UniChar character1 = CFStringGetCharacterFromInlineBuffer(&buffer1, characterIndex);
+        UniChar character2 = CFStringGetCharacterFromInlineBuffer(&buffer2, characterIndex);
+        if (character1 == character2)
+            continue;
+        if (character1 >= 'A' && character1 <= 'Z')
+            character1 += 'a' - 'A';
+        if (character2 >= 'A' && character2 <= 'Z')
+            character2 += 'a' - 'A';
+        if (character1 != character2)
+            return false;
+    }
+    return true;
+}
 
-    if (ONHostNameLookupDebug) {
-        currentThread = [NSThread currentThread];
-        NSLog(@"<%@> Starting name lookup for %@", currentThread, aHostname);
+// Hostnames are almost always ASCII, which the cache's own comparison handles. Anything else we fold the old way.
+static NSString *nameCacheKey(NSString *aHostname)
+{
+    return [aHostname canBeConvertedToEncoding:NSASCIIStringEncoding] ? aHostname : [aHostname lowercaseString];
+}
+
+static ONHostNameCacheStripe *nameCacheStripe(NSString *key)
+{
+    return &nameCacheStripes[hostnameHash(key) % NAME_CACHE_STRIPE_COUNT];
+}
+
+static void initializeNameCache(void)
+{
+    CFDictionaryKeyCallBacks keyCallbacks = kCFTypeDictionaryKeyCallBacks;
+    NSUInteger stripeIndex;
+
+    keyCallbacks.equal = hostnamesEqual;
+    keyCallbacks.hash = hostnameHash;
+    for (stripeIndex = 0; stripeIndex < NAME_CACHE_STRIPE_COUNT; stripeIndex++) {
+        pthread_mutex_init(&nameCacheStripes[stripeIndex].lock, NULL);
+        pthread_cond_init(&nameCacheStripes[stripeIndex].lookupFinished, NULL);
+        nameCacheStripes[stripeIndex].entries = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &keyCallbacks, &kCFTypeDictionaryValueCallBacks);
     }
-        
-    // First, check under the current capitalization of the address.  Since this is usually correct, this will avoid needlessly creating another string
-    pendingLock = nil;
-    host = [self _lockCache:hostCache toCheckForKey:aHostname pendingLock:&pendingLock];
-    if (host == nil) {
+    resolverQueue = [[NSMutableArray alloc] init];
+}
 
-        // Try the lowercase string
-        NSString *lowercaseHostname = [aHostname lowercaseString];
+// A cached exception may be raised on several threads at once, so each gets its own copy.
+static NSException *copyOfCachedException(NSException *exception)
+{
+    return [NSException exceptionWithName:[exception name] reason:[exception reason] userInfo:[exception userInfo]];
+}
 
-        if (lowercaseHostname != aHostname && ![aHostname isEqualToString:lowercaseHostname]) {
-            NSLock *oldPendingLock = pendingLock;
-            pendingLock = nil;
+// Clears out the stripe's expired entries and, if that doesn't leave it at NAME_CACHE_PRUNED_COUNT or fewer, the ones nearest to expiring. Entries with a lookup in flight have callers waiting on them, so they stay.
+static void locked_pruneNameCacheStripe(ONHostNameCacheStripe *stripe, CFAbsoluteTime now)
+{
+    NSUInteger entryCount = CFDictionaryGetCount(stripe->entries);
+    NSMutableArray *evictableEntries = [NSMutableArray arrayWithCapacity:entryCount];
+    NSUInteger evictionCount = 0, entryIndex;
+
+    for (NSString *key in (NSDictionary *)stripe->entries) {
+        ONHostNameCacheEntry *entry = (ONHostNameCacheEntry *)CFDictionaryGetValue(stripe->entries, key);
+        if (entry->lookupInFlight)
+            continue;
+        [evictableEntries addObject:entry];
+        if (entry->expirationTime <= now)
+            evictionCount++;
+    }
+    if (entryCount - evictionCount > NAME_CACHE_PRUNED_COUNT)
+        evictionCount = MIN(entryCount - NAME_CACHE_PRUNED_COUNT, [evictableEntries count]);
+
+    // Nearest to expiring first, which puts the expired entries ahead of the rest
+    [evictableEntries sortUsingComparator:^NSComparisonResult(ONHostNameCacheEntry *entry1, ONHostNameCacheEntry *entry2) {
+        if (entry1->expirationTime < entry2->expirationTime)
+            return NSOrderedAscending;
+        return entry1->expirationTime > entry2->expirationTime ? NSOrderedDescending : NSOrderedSame;
+    }];
+    for (entryIndex = 0; entryIndex < evictionCount; entryIndex++) {
+        ONHostNameCacheEntry *entry = [evictableEntries objectAtIndex:entryIndex];
+        CFDictionaryRemoveValue(stripe->entries, entry->hostname);
+    }
+}
 
-            host = [self _lockCache:hostCache toCheckForKey:lowercaseHostname pendingLock:&pendingLock];
+// Returns the stripe's entry for the name, making one if need be. If nobody is looking the name up and the entry's answer is missing, expired, or due for a refresh, marks a lookup as in flight and sets *outShouldLookUp; it's then up to the caller to resolve the entry or queue it.
+static ONHostNameCacheEntry *locked_nameCacheEntry(ONHostNameCacheStripe *stripe, Class hostClass, NSString *key, CFAbsoluteTime now, BOOL *outShouldLookUp)
+{
+    ONHostNameCacheEntry *entry = (ONHostNameCacheEntry *)CFDictionaryGetValue(stripe->entries, key);
+    BOOL refresh = NO;
+
+    *outShouldLookUp = NO;
+    if (entry == nil) {
+        if (CFDictionaryGetCount(stripe->entries) >= NAME_CACHE_STRIPE_LIMIT)
+            locked_pruneNameCacheStripe(stripe, now);
+        entry = [[ONHostNameCacheEntry alloc] init];
+        entry->hostClass = hostClass;
+        entry->hostname = [[key lowercaseString] copy];
+        entry->stripe = stripe;
+        key = [key copy];
+        CFDictionarySetValue(stripe->entries, key, entry);
+        [key release];
+        [entry release];
+    } else if (entry->lookupInFlight) {
+        // A refresh that the answer didn't outlast is now an ordinary lookup, for callers to wait on
+        if (entry->refreshing && entry->expirationTime <= now)
+            entry->refreshing = NO;
+        return entry;
+    } else if (entry->expirationTime > now) {
+        if (now < entry->refreshTime)
+            return entry;
+        // Still good, but due for a refresh
+        if (ONHostNameLookupDebug)
+            NSLog(@"<%@> Refreshing %@ in the background", [NSThread currentThread], entry->hostname);
+        refresh = YES;
+    }
 
-            [ONHostLookupLock lock];
-            [hostCache removeObjectForKey:aHostname];  // remove oldPendingLock from the hostCache
-            [oldPendingLock unlock];
-            [oldPendingLock release];
-            if (host)   // ... so that next time we won't need to call -lowercaseString ...
-                [hostCache setObject:host forKey:aHostname];
-            [ONHostLookupLock unlock];
+    entry->lookupInFlight = YES;
+    entry->refreshing = refresh;
+    *outShouldLookUp = YES;
+    return entry;
+}
 
-            aHostname = lowercaseHostname;
-        }
+static void enqueueNameCacheEntry(ONHostNameCacheEntry *entry)
+{
+    BOOL shouldStartThread = NO;
+
+    pthread_mutex_lock(&resolverQueueLock);
+    [resolverQueue addObject:entry];
+    if (idleResolverThreadCount > 0)
+        pthread_cond_signal(&resolverQueueCondition);
+    else if (resolverThreadCount < resolverThreadLimit) {
+        resolverThreadCount++;
+        shouldStartThread = YES;
     }
-    if (host != nil) {
-        OBASSERT(pendingLock == nil);
-        OBPOSTCONDITION([host isKindOfClass:[ONHost class]]);
-        return host;
+    pthread_mutex_unlock(&resolverQueueLock);
+
+    if (shouldStartThread)
+        [NSThread detachNewThreadSelector:@selector(_resolverThreadMain) toTarget:[ONHost class] withObject:nil];
+}
+
+// Takes the entry back off the resolver queue, if no resolver thread has started on it yet.
+static BOOL dequeueNameCacheEntry(ONHostNameCacheEntry *entry)
+{
+    BOOL wasQueued = NO;
+
+    pthread_mutex_lock(&resolverQueueLock);
+    NSUInteger queueIndex = [resolverQueue indexOfObjectIdenticalTo:entry];
+    if (queueIndex != NSNotFound) {
+        [resolverQueue removeObjectAtIndex:queueIndex];
+        wasQueued = YES;
     }
-    
-    // There were either no previous attempts to determine the address for this host name or they failed.  We will unlock the main lock while we process the request so that others can get at the cache and possibly start their own request.  If another thread asks for the same host that we are currently resolving, though, they will need to block.  We will put an lock in the cache under the inquiry name for this purpose.
-    OBASSERT(pendingLock != nil);
+    pthread_mutex_unlock(&resolverQueueLock);
+    return wasQueued;
+}
+
+static void resolveNameCacheEntry(ONHostNameCacheEntry *entry)
+{
+    ONHostNameCacheStripe *stripe = entry->stripe;
+    ONHost *newHost = nil;
+    NSException *lookupException = nil;
+
+    if (ONHostNameLookupDebug)
+        NSLog(@"<%@> Looking up %@", [NSThread currentThread], entry->hostname);
 
-    // Do the lookup.  If there is an error we need to remove the pendingLock, unlock it and then reraise so that other threads may try the lookup (we don't cache failures).
     NS_DURING {
-        host = [[self alloc] _initWithHostname:aHostname knownAddress:nil];
+        newHost = [[entry->hostClass alloc] _initWithHostname:entry->hostname knownAddress:nil];
     } NS_HANDLER {
-        OBASSERT(host == nil);
-        raisedException = localException;
+        OBASSERT(newHost == nil);
+        lookupException = localException;
     } NS_ENDHANDLER;
 
-    // Lock the cache again now that we have our result (or error)
-    [ONHostLookupLock lock];
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    pthread_mutex_lock(&stripe->lock);
+    if (newHost != nil) {
+        NSTimeInterval timeToLive = MAX([newHost->expirationDate timeIntervalSinceNow], 0.0);
+        [entry->host release];
+        entry->host = newHost;
+        [entry->exception release];
+        entry->exception = nil;
+        entry->expirationTime = now + timeToLive;
+        entry->refreshTime = now + NAME_CACHE_REFRESH_FRACTION * timeToLive;
+    } else if (entry->refreshing && entry->host != nil && entry->expirationTime > now) {
+        // Keep the answer we have until it expires
+        entry->refreshTime = entry->expirationTime;
+    } else {
+        NSTimeInterval negativeTimeToLive;
+        __atomic_load(&ONHostNegativeTimeToLiveTimeInterval, &negativeTimeToLive, __ATOMIC_RELAXED);
+        [entry->host release];
+        entry->host = nil;
+        [entry->exception release];
+        entry->exception = [lookupException retain];
+        entry->expirationTime = now + negativeTimeToLive;
+        entry->refreshTime = entry->expirationTime;
+    }
+    entry->lookupInFlight = NO;
+    entry->refreshing = NO;
+    if (entry->flushed) {
+        if (CFDictionaryGetValue(stripe->entries, entry->hostname) == entry)
+            CFDictionaryRemoveValue(stripe->entries, entry->hostname);
+        entry->flushed = NO;
+    }
+    NSArray *handlers = entry->handlers;
+    entry->handlers = nil;
+    ONHost *host = [[entry->host retain] autorelease];
+    NSException *exception = entry->exception;
+    pthread_cond_broadcast(&stripe->lookupFinished);
+    pthread_mutex_unlock(&stripe->lock);
+
+    for (ONHostLookupHandler handler in handlers)
+        handler(host, exception != nil ? copyOfCachedException(exception) : nil);
+    [handlers release];
+}
 
-    if (host)
-        [hostCache setObject:host forKey:aHostname];
-    else
-        [hostCache removeObjectForKey:aHostname];
++ (void)_resolverThreadMain;
+{
+    for (;;) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        ONHostNameCacheEntry *entry;
+
+        pthread_mutex_lock(&resolverQueueLock);
+        idleResolverThreadCount++;
+        while ([resolverQueue count] == 0)
+            pthread_cond_wait(&resolverQueueCondition, &resolverQueueLock);
+        idleResolverThreadCount--;
+        entry = [[resolverQueue objectAtIndex:0] retain];
+        [resolverQueue removeObjectAtIndex:0];
+        pthread_mutex_unlock(&resolverQueueLock);
+
+        resolveNameCacheEntry(entry);
+        [entry release];
+        [pool release];
+    }
+}
 
-    // Unlock the pending lock and the main lock
-    [pendingLock unlock];
-    [pendingLock release];
-    [ONHostLookupLock unlock];
++ (ONHost *)hostForHostname:(NSString *)aHostname;
+{
+    ONHostNameCacheStripe *stripe;
+    ONHostNameCacheEntry *entry;
+    ONHost *host;
+    NSException *exception;
+    BOOL shouldLookUp;
 
-    if (raisedException)
-        [raisedException raise];
+    if (!aHostname)
+	return nil;
+
+    if (ONHostNameLookupDebug)
+        NSLog(@"<%@> Starting name lookup for %@", [NSThread currentThread], aHostname);
+
+    NSString *key = nameCacheKey(aHostname);
+    stripe = nameCacheStripe(key);
+    pthread_mutex_lock(&stripe->lock);
+    entry = [[locked_nameCacheEntry(stripe, self, key, CFAbsoluteTimeGetCurrent(), &shouldLookUp) retain] autorelease];
+    if (entry->refreshing) {
+        // Answer from the cache, which is being refreshed in the background
+        if (shouldLookUp)
+            enqueueNameCacheEntry(entry);
+    } else if (shouldLookUp || (entry->lookupInFlight && dequeueNameCacheEntry(entry))) {
+        // Nobody else is working on this name yet, so we look it up ourselves rather than wait for a resolver thread
+        pthread_mutex_unlock(&stripe->lock);
+        resolveNameCacheEntry(entry);
+        pthread_mutex_lock(&stripe->lock);
+    } else if (entry->lookupInFlight) {
+        if (ONHostNameLookupDebug)
+            NSLog(@"<%@> Lookup already in progress for %@.  Waiting for it to finish...", [NSThread currentThread], aHostname);
+        while (entry->lookupInFlight)
+            pthread_cond_wait(&stripe->lookupFinished, &stripe->lock);
+    }
+    host = [[entry->host retain] autorelease];
+    exception = entry->exception;
+    pthread_mutex_unlock(&stripe->lock);
+
+    if (exception != nil)
+        [copyOfCachedException(exception) raise];
+
+    OBPOSTCONDITION([host isKindOfClass:[ONHost class]]);
+    return host;
+}
+
++ (void)lookupHostname:(NSString *)aHostname completionHandler:(ONHostLookupHandler)handler;
+{
+    ONHostNameCacheStripe *stripe;
+    ONHostNameCacheEntry *entry;
+    ONHost *host;
+    NSException *exception;
+    BOOL shouldLookUp;
+
+    OBPRECONDITION(aHostname != nil);
+    OBPRECONDITION(handler != nil);
+
+    NSString *key = nameCacheKey(aHostname);
+    stripe = nameCacheStripe(key);
+    pthread_mutex_lock(&stripe->lock);
+    entry = locked_nameCacheEntry(stripe, self, key, CFAbsoluteTimeGetCurrent(), &shouldLookUp);
+    if (shouldLookUp)
+        enqueueNameCacheEntry(entry);
+    if (entry->lookupInFlight && !entry->refreshing) {
+        if (entry->handlers == nil)
+            entry->handlers = [[NSMutableArray alloc] init];
+        handler = [handler copy];
+        [entry->handlers addObject:handler];
+        [handler release];
+        pthread_mutex_unlock(&stripe->lock);
+        return;
+    }
+    host = [[entry->host retain] autorelease];
+    exception = entry->exception;
+    pthread_mutex_unlock(&stripe->lock);
 
-    return [host autorelease];
+    handler(host, exception != nil ? copyOfCachedException(exception) : nil);
+}
+
++ (void)setMaximumConcurrentLookups:(NSUInteger)limit;
+{
+    OBPRECONDITION(limit > 0);
+
+    pthread_mutex_lock(&resolverQueueLock);
+    resolverThreadLimit = MAX(limit, 1U);
+    pthread_mutex_unlock(&resolverQueueLock);
+}
+
++ (void)setNegativeTimeToLiveTimeInterval:(NSTimeInterval)newValue;
+{
+    __atomic_store(&ONHostNegativeTimeToLiveTimeInterval, &newValue, __ATOMIC_RELAXED);
+    [self flushCache];
+}
+
++ (void)setResolver:(ONHostResolver)resolver;
+{
+    [ONHostLookupLock lock];
+    [customResolver release];
+    customResolver = [resolver copy];
+    ONHostResolverAPI = customResolver != nil ? Resolver_custom : Resolver_getaddrinfo;
+    [ONHostLookupLock unlock];
+    [self flushCache];
 }
 
 + (ONHost *)hostForAddress:(ONHostAddress *)anAddress;
@@ -537,6 +915,30 @@ static void locked_disconnectFromSysConfig(void)
         NSLog(@"+[ONHost flushCache]: Warning: %@", [localException reason]);
     } NS_ENDHANDLER;
     [ONHostLookupLock unlock];
+
+    flushNameCache();
+}
+
+// Entries with lookups in flight stay, so that their waiters still hear back, but their answers won't be used once they arrive
+static void flushNameCache(void)
+{
+    NSUInteger stripeIndex;
+    for (stripeIndex = 0; stripeIndex < NAME_CACHE_STRIPE_COUNT; stripeIndex++) {
+        ONHostNameCacheStripe *stripe = &nameCacheStripes[stripeIndex];
+        NSMutableArray *flushedKeys = [NSMutableArray array];
+
+        pthread_mutex_lock(&stripe->lock);
+        for (NSString *key in (NSDictionary *)stripe->entries) {
+            ONHostNameCacheEntry *entry = (ONHostNameCacheEntry *)CFDictionaryGetValue(stripe->entries, key);
+            if (entry->lookupInFlight)
+                entry->flushed = YES;
+            else
+                [flushedKeys addObject:key];
+        }
+        for (NSString *key in flushedKeys)
+            CFDictionaryRemoveValue(stripe->entries, key);
+        pthread_mutex_unlock(&stripe->lock);
+    }
 }
 
 + (void)setDefaultTimeToLiveTimeInterval:(NSTimeInterval)newValue;
@@ -606,14 +1008,16 @@ static void locked_disconnectFromSysConfig(void)
 
 - (void)flushFromHostCache;
 {
-    [ONHostLookupLock lock];
-    NS_DURING {
-        if ([hostCache objectForKey:hostname] == self)
-            [hostCache removeObjectForKey:hostname];
-    } NS_HANDLER {
-        NSLog(@"+[ONHost removeFromHostCache]: Warning: %@", [localException reason]);
-    } NS_ENDHANDLER;
-    [ONHostLookupLock unlock];
+    if (hostname == nil)
+        return;
+
+    NSString *key = nameCacheKey(hostname);
+    ONHostNameCacheStripe *stripe = nameCacheStripe(key);
+    pthread_mutex_lock(&stripe->lock);
+    ONHostNameCacheEntry *entry = (ONHostNameCacheEntry *)CFDictionaryGetValue(stripe->entries, key);
+    if (entry != nil && entry->host == self && !entry->lookupInFlight)
+        CFDictionaryRemoveValue(stripe->entries, key);
+    pthread_mutex_unlock(&stripe->lock);
 }
 
 // Looking up service addresses
@@ -805,6 +1209,9 @@ static void locked_disconnectFromSysConfig(void)
             case Resolver_getaddrinfo:
                 [self _lookupHostInfoUsingGetaddrinfo];
                 break;
+            case Resolver_custom:
+                [self _lookupHostInfoUsingCustomResolver];
+                break;
             default:
                 addresses = [[NSArray alloc] init];
                 break;
@@ -867,6 +1274,26 @@ static void locked_disconnectFromSysConfig(void)
     [addressBuf release];
 }
 
+- (void)_lookupHostInfoUsingCustomResolver;
+{
+    ONHostResolver resolver;
+    NSTimeInterval timeToLive = ONHostDefaultTimeToLiveTimeInterval;
+
+    OBPRECONDITION(addresses == nil);
+
+    [ONHostLookupLock lock];
+    resolver = [[customResolver retain] autorelease];
+    [ONHostLookupLock unlock];
+
+    NSArray *resolvedAddresses = resolver != nil ? resolver(hostname, &timeToLive) : nil;
+    if (resolvedAddresses == nil)
+        [[self class] _raiseExceptionForHostErrorNumber:HOST_NOT_FOUND hostname:hostname];
+    if ([resolvedAddresses count] == 0)
+        [[self class] _raiseExceptionForHostErrorNumber:NO_DATA hostname:hostname];
+    addresses = [resolvedAddresses copy];
+    expirationDate = [[NSDate alloc] initWithTimeIntervalSinceNow:timeToLive];
+}
+
 #pragma mark - Private
 
 // Punycode is defined in RFC 3492
@@ -14,6 +14,7 @@
 
 #import "ONHostAddress-Private.h"
 #import <OmniNetworking/ONInterface.h>
+#import "ONInterfaceMonitor-InternalAPI.h"
 #import <OmniNetworking/ONLinkLayerHostAddress.h>
 
 RCS_ID("$Id$")
@@ -232,6 +233,10 @@ static inline u_int32_t isCharNumeric(unsigned char ch) {
 
 - (BOOL)isLocalInterfaceAddress;
 {
+    ONInterfaceMonitor *monitor = [ONInterfaceMonitor _runningMonitor];
+    if (monitor != nil)
+        return [monitor interfaceWithAddress:self] != nil;
+
     NSArray *interfaces = [ONInterface interfaces];
     NSUInteger interfaceIndex = [interfaces count];
     while (interfaceIndex--) {
@@ -0,0 +1,17 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniNetworking/ONInterface.h>
+
+@class NSDictionary;
+
+@interface ONInterface ()
+
+// For ONInterfaceMonitor, which builds interfaces from its own table rather than from getifaddrs(). The netmasks and remote addresses are keyed by local address; remote addresses are destinations on point-to-point links and broadcast addresses otherwise. A maximumTransmissionUnit of 0 means it's asked for when needed.
+- (id)_initWithName:(NSString *)aName index:(unsigned int)anIndex flags:(unsigned int)someFlags interfaceType:(int)anInterfaceType maximumTransmissionUnit:(unsigned int)aMaximumTransmissionUnit addresses:(NSArray *)someAddresses netmasks:(NSDictionary *)someNetmasks remoteAddresses:(NSDictionary *)someRemoteAddresses;
+
+@end
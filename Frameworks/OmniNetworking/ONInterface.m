@@ -8,6 +8,8 @@
 #import <OmniNetworking/ONInterface.h>
 
 #import <OmniNetworking/ONHostAddress.h>
+#import "ONInterface-InternalAPI.h"
+#import "ONInterfaceMonitor-InternalAPI.h"
 
 #import <Foundation/Foundation.h>
 #import <OmniBase/OmniBase.h>
@@ -64,6 +66,15 @@ static const struct { int ift; ONInterfaceCategory cat; } interfaceClassificatio
     
 };
 
+static ONInterfaceCategory interfaceCategoryForType(int anInterfaceType)
+{
+    int catIndex = 0;
+    while(interfaceClassification[catIndex].ift != anInterfaceType &&
+          interfaceClassification[catIndex].ift != -1)
+        catIndex ++;
+    return interfaceClassification[catIndex].cat;
+}
+
 #define ONUnknownMTU (~(unsigned int)0)
 
 - (id)_initFromIfaddrs:(struct ifaddrs *)info
@@ -96,16 +107,10 @@ static const struct { int ift; ONInterfaceCategory cat; } interfaceClassificatio
         // Some link-layer interface information is stashed in the link address structure
         if (ifp->ifa_addr != NULL && ifp->ifa_addr->sa_family == AF_LINK) {
             struct sockaddr_dl *dlp = (struct sockaddr_dl *)(ifp->ifa_addr);
-            int catIndex;
 
             index = dlp->sdl_index;
             interfaceType = dlp->sdl_type;
-
-            catIndex = 0;
-            while(interfaceClassification[catIndex].ift != interfaceType &&
-                  interfaceClassification[catIndex].ift != -1)
-                catIndex ++;
-            interfaceCategory = interfaceClassification[catIndex].cat;
+            interfaceCategory = interfaceCategoryForType(interfaceType);
         }
 
         // Copy out the addresses from the ifaddrs structure. Note that the header actually defines ifa_dstaddr to be the same field as ifa_broadaddr right now, so there's really no chance that we're losing information by only retrieving one of them.
@@ -140,12 +145,42 @@ static const struct { int ift; ONInterfaceCategory cat; } interfaceClassificatio
     return self;
 }
 
+- (id)_initWithName:(NSString *)aName index:(unsigned int)anIndex flags:(unsigned int)someFlags interfaceType:(int)anInterfaceType maximumTransmissionUnit:(unsigned int)aMaximumTransmissionUnit addresses:(NSArray *)someAddresses netmasks:(NSDictionary *)someNetmasks remoteAddresses:(NSDictionary *)someRemoteAddresses;
+{
+    if (!(self = [super init]))
+        return nil;
+
+    name = [aName copy];
+    index = anIndex;
+    flags = someFlags;
+    interfaceType = anInterfaceType;
+    interfaceCategory = interfaceCategoryForType(anInterfaceType);
+    maximumTransmissionUnit = aMaximumTransmissionUnit;
+
+    interfaceAddresses = [someAddresses copy];
+    if ([someNetmasks count] > 0)
+        netmaskAddresses = [someNetmasks copy];
+    if ([someRemoteAddresses count] > 0) {
+        if (flags & IFF_POINTOPOINT)
+            destinationAddresses = [someRemoteAddresses copy];
+        else
+            broadcastAddresses = [someRemoteAddresses copy];
+    }
+
+    return self;
+}
+
 + (NSArray *)getInterfaces:(BOOL)rescan
 {
     int oserr;
     struct ifaddrs *ifs, *ifptr, *ifcursor;
     NSMutableArray *newInterfaces;
 
+    // A running monitor's table is always current, so there's never anything to rescan
+    ONInterfaceMonitor *monitor = [ONInterfaceMonitor _runningMonitor];
+    if (monitor != nil)
+        return [monitor interfaces];
+
     if (interfaces != nil) {
         if (rescan) {
             [interfaces release];
@@ -197,6 +232,16 @@ static const struct { int ift; ONInterfaceCategory cat; } interfaceClassificatio
     return [self getInterfaces:NO];
 }
 
+- (void)dealloc;
+{
+    [name release];
+    [interfaceAddresses release];
+    [destinationAddresses release];
+    [broadcastAddresses release];
+    [netmaskAddresses release];
+    [super dealloc];
+}
+
 - (NSString *)name;
 {
     return name;
@@ -0,0 +1,33 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniNetworking/ONInterfaceMonitor.h>
+
+@interface ONInterfaceMonitor ()
+
++ (ONInterfaceMonitor *)_runningMonitor;
+    // The shared monitor, starting it if need be. Returns nil if it couldn't start or has stopped listening, in which case callers should scan the interfaces themselves.
+
+// A monitor which doesn't listen to the system, and only changes when told to by the methods below. The unit tests use these to play the part of the kernel.
+- (id)_initWithoutSource;
+
+// Changes made between these are posted as one notification. They nest.
+- (void)_beginChanges;
+- (void)_endChanges;
+
+- (void)_setLinkWithIndex:(unsigned int)index name:(NSString *)name flags:(unsigned int)flags interfaceType:(int)interfaceType maximumTransmissionUnit:(unsigned int)maximumTransmissionUnit;
+- (void)_removeLinkWithIndex:(unsigned int)index;
+- (void)_addAddress:(ONHostAddress *)address netmask:(ONHostAddress *)netmask remoteAddress:(ONHostAddress *)remoteAddress toLinkWithIndex:(unsigned int)index;
+    // Adding an address that's already there updates its netmask and remote address.
+- (void)_removeAddress:(ONHostAddress *)address fromLinkWithIndex:(unsigned int)index;
+
+#if defined(__linux__)
+- (BOOL)_handleNetlinkMessages:(const void *)buffer length:(size_t)length;
+    // Applies a buffer of rtnetlink link and address messages as one batch. Returns YES if the buffer ends a dump.
+#endif
+
+@end
@@ -0,0 +1,32 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniBase/OBObject.h>
+
+@class NSArray;
+@class ONHostAddress, ONInterface;
+
+// Keeps a table of the network interfaces and their addresses up to date by listening to the kernel's routing socket (netlink on Linux, PF_ROUTE elsewhere), so that nobody has to rescan the interfaces to find out whether something changed.
+// The shared monitor starts itself the first time ONHost is used, or +[ONInterface interfaces] or -[ONHostAddress isLocalInterfaceAddress] is called. From then on those answer from its table, and ONHost drops only the cached lookups that a change could have affected instead of flushing everything.
+@interface ONInterfaceMonitor : OBObject
+
++ (ONInterfaceMonitor *)sharedMonitor;
+    // Starts monitoring the first time it's called, if nothing above has already. Returns nil if the system's routing socket can't be opened, in which case everything goes on scanning the interfaces as before.
+
+- (NSArray *)interfaces;
+    // ONInterfaces ordered by index. An interface which hasn't changed is represented by the same ONInterface object from one call to the next.
+- (ONInterface *)interfaceWithIndex:(int)index;
+- (ONInterface *)interfaceWithAddress:(ONHostAddress *)address;
+
+@end
+
+// Posted on the monitor's thread after each batch of changes to its table
+extern NSString * const ONInterfaceMonitorInterfacesDidChangeNotification;
+extern NSString * const ONInterfaceMonitorChangedInterfaceNamesKey;  // NSSet of the names of interfaces which appeared, went away, or changed
+extern NSString * const ONInterfaceMonitorAddedAddressesKey;         // NSSet of ONHostAddresses
+extern NSString * const ONInterfaceMonitorRemovedAddressesKey;       // NSSet of ONHostAddresses
+extern NSString * const ONInterfaceMonitorConfiguredAddressFamiliesChangedKey;  // NSNumber, YES if the host gained or lost its last IPv4 or IPv6 address other than loopback and link-local ones (which is what getaddrinfo()'s AI_ADDRCONFIG looks at)
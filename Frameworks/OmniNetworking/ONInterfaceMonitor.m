@@ -0,0 +1,845 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniNetworking/ONInterfaceMonitor.h>
+
+#import <Foundation/Foundation.h>
+#import <OmniBase/OmniBase.h>
+#import <OmniBase/system.h>
+
+#import <OmniNetworking/ONHostAddress.h>
+#import "ONHostAddress-Private.h"
+#import "ONInterface-InternalAPI.h"
+#import "ONInterfaceMonitor-InternalAPI.h"
+
+#include <pthread.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#define ON_MONITOR_USES_NETLINK 1
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if_arp.h>
+#else
+#define ON_MONITOR_USES_NETLINK 0
+#include <ifaddrs.h>
+#include <net/if_dl.h>
+#include <net/if_types.h>
+#include <net/route.h>
+#endif
+
+RCS_ID("$Id$")
+
+#define ROUTE_MESSAGE_BUFFER_SIZE (64 * 1024)
+#define ROUTE_SOCKET_BUFFER_SIZE (1024 * 1024)  // Enough to ride out a storm of changes without overrunning the socket, most of the time
+
+#if ON_MONITOR_USES_NETLINK && !defined(IFT_OTHER)
+// RFC1573 interface types, which ONInterface reports and Linux has no header for
+#define IFT_OTHER       0x1
+#define IFT_ETHER       0x6
+#define IFT_FDDI        0xf
+#define IFT_PPP         0x17
+#define IFT_LOOP        0x18
+#define IFT_SLIP        0x1c
+#define IFT_GIF         0x37
+#define IFT_IEEE1394    0x90
+#define IFT_STF         0xd7
+#endif
+
+NSString * const ONInterfaceMonitorInterfacesDidChangeNotification = @"ONInterfaceMonitorInterfacesDidChangeNotification";
+NSString * const ONInterfaceMonitorChangedInterfaceNamesKey = @"changedInterfaceNames";
+NSString * const ONInterfaceMonitorAddedAddressesKey = @"addedAddresses";
+NSString * const ONInterfaceMonitorRemovedAddressesKey = @"removedAddresses";
+NSString * const ONInterfaceMonitorConfiguredAddressFamiliesChangedKey = @"configuredAddressFamiliesChanged";
+
+// One interface in a monitor's table, protected by the monitor's lock
+@interface ONInterfaceMonitorLink : NSObject
+{
+@public
+    unsigned int index;
+    NSString *name;
+    unsigned int flags;
+    int interfaceType;
+    unsigned int maximumTransmissionUnit;
+    NSMutableArray *addresses;
+    NSMutableDictionary *netmasks;          // local address -> ONHostAddress
+    NSMutableDictionary *remoteAddresses;   // local address -> ONHostAddress
+    ONInterface *interface; // Made when asked for, and dropped whenever anything above changes
+}
+@end
+
+@implementation ONInterfaceMonitorLink
+
+- (id)init;
+{
+    if (!(self = [super init]))
+        return nil;
+
+    addresses = [[NSMutableArray alloc] init];
+    netmasks = [[NSMutableDictionary alloc] init];
+    remoteAddresses = [[NSMutableDictionary alloc] init];
+    return self;
+}
+
+- (void)dealloc;
+{
+    [name release];
+    [addresses release];
+    [netmasks release];
+    [remoteAddresses release];
+    [interface release];
+    [super dealloc];
+}
+
+- (ONInterface *)interface;
+{
+    if (interface == nil)
+        interface = [[ONInterface alloc] _initWithName:name index:index flags:flags interfaceType:interfaceType maximumTransmissionUnit:maximumTransmissionUnit addresses:addresses netmasks:netmasks remoteAddresses:remoteAddresses];
+    return interface;
+}
+
+@end
+
+@implementation ONInterfaceMonitor
+{
+    pthread_mutex_t lock;
+    NSMutableDictionary *links;         // NSNumber index -> ONInterfaceMonitorLink
+    NSMutableDictionary *addressLinks;  // ONHostAddress -> an ONInterfaceMonitorLink which has it
+    NSArray *interfaces;                // For -interfaces; nil when a link has changed since
+    NSUInteger configuredAddressCounts[2]; // See configuredAddressFamilyIndex()
+
+    // Changes since the outermost -_beginChanges
+    NSUInteger changeDepth;
+    unsigned int configuredFamiliesBeforeChanges;
+    NSMutableSet *changedInterfaceNames;
+    NSMutableSet *addedAddresses;
+    NSMutableSet *removedAddresses;
+    BOOL postsNotifications;
+
+    int routeSocket;
+}
+
+static ONInterfaceMonitor *sharedMonitor = nil;
+static ONInterfaceMonitor *runningMonitor = nil; // The shared monitor, until it stops listening
+
+static int openRouteSocket(void);
+
++ (ONInterfaceMonitor *)sharedMonitor;
+{
+    static dispatch_once_t onceToken;
+
+    dispatch_once(&onceToken, ^{
+        sharedMonitor = [[self alloc] _initWithSource];
+        __atomic_store_n(&runningMonitor, sharedMonitor, __ATOMIC_RELEASE);
+    });
+    return sharedMonitor;
+}
+
++ (ONInterfaceMonitor *)_runningMonitor;
+{
+    [self sharedMonitor];
+    return __atomic_load_n(&runningMonitor, __ATOMIC_ACQUIRE);
+}
+
+- (id)_initWithoutSource;
+{
+    if (!(self = [super init]))
+        return nil;
+
+    pthread_mutex_init(&lock, NULL);
+    links = [[NSMutableDictionary alloc] init];
+    addressLinks = [[NSMutableDictionary alloc] init];
+    changedInterfaceNames = [[NSMutableSet alloc] init];
+    addedAddresses = [[NSMutableSet alloc] init];
+    removedAddresses = [[NSMutableSet alloc] init];
+    postsNotifications = YES;
+    routeSocket = -1;
+    return self;
+}
+
+- (id)_initWithSource;
+{
+    if (!(self = [self _initWithoutSource]))
+        return nil;
+
+    @try {
+        // Start listening before reading the current table, so that nothing that happens in between is missed. Changes that the table already reflects are harmless to apply again.
+        routeSocket = openRouteSocket();
+        postsNotifications = NO;
+        [self _loadCurrentTable];
+        postsNotifications = YES;
+    } @catch (NSException *exception) {
+        NSLog(@"%@: Unable to monitor network interfaces: %@", [self class], [exception reason]);
+        [self release];
+        return nil;
+    }
+
+    [NSThread detachNewThreadSelector:@selector(_readRouteSocket) toTarget:self withObject:nil];
+    return self;
+}
+
+- (void)dealloc;
+{
+    if (routeSocket >= 0)
+        close(routeSocket);
+    [links release];
+    [addressLinks release];
+    [interfaces release];
+    [changedInterfaceNames release];
+    [addedAddresses release];
+    [removedAddresses release];
+    pthread_mutex_destroy(&lock);
+    [super dealloc];
+}
+
+- (NSArray *)interfaces;
+{
+    NSArray *result;
+
+    pthread_mutex_lock(&lock);
+    if (interfaces == nil) {
+        NSArray *indexes = [[links allKeys] sortedArrayUsingSelector:@selector(compare:)];
+        NSMutableArray *newInterfaces = [[NSMutableArray alloc] initWithCapacity:[indexes count]];
+        for (NSNumber *linkIndex in indexes)
+            [newInterfaces addObject:[[links objectForKey:linkIndex] interface]];
+        interfaces = [newInterfaces copy];
+        [newInterfaces release];
+    }
+    result = [interfaces retain];
+    pthread_mutex_unlock(&lock);
+
+    return [result autorelease];
+}
+
+- (ONInterface *)interfaceWithIndex:(int)index;
+{
+    ONInterface *result;
+
+    pthread_mutex_lock(&lock);
+    result = [[[links objectForKey:[NSNumber numberWithInt:index]] interface] retain];
+    pthread_mutex_unlock(&lock);
+
+    return [result autorelease];
+}
+
+- (ONInterface *)interfaceWithAddress:(ONHostAddress *)address;
+{
+    ONInterface *result;
+
+    pthread_mutex_lock(&lock);
+    result = [[[addressLinks objectForKey:address] interface] retain];
+    pthread_mutex_unlock(&lock);
+
+    return [result autorelease];
+}
+
+#pragma mark - Changing the table
+
+// Which of configuredAddressCounts an address counts toward, or -1. Like AI_ADDRCONFIG, this ignores loopback addresses, and IPv6 link-local ones.
+static int configuredAddressFamilyIndex(ONHostAddress *address)
+{
+    switch ([address addressFamily]) {
+        case AF_INET:
+            return ((const unsigned char *)[address _internetAddress])[0] != 127 ? 0 : -1;
+        case AF_INET6: {
+            const struct in6_addr *internetAddress = [address _internetAddress];
+            if (IN6_IS_ADDR_LOOPBACK(internetAddress) || IN6_IS_ADDR_LINKLOCAL(internetAddress))
+                return -1;
+            return 1;
+        }
+        default:
+            return -1;
+    }
+}
+
+static BOOL sameAddress(ONHostAddress *address, ONHostAddress *otherAddress)
+{
+    return address == otherAddress || [address isEqual:otherAddress];
+}
+
+- (unsigned int)_locked_configuredFamilies;
+{
+    return (configuredAddressCounts[0] > 0 ? 1 : 0) | (configuredAddressCounts[1] > 0 ? 2 : 0);
+}
+
+- (void)_beginChanges;
+{
+    pthread_mutex_lock(&lock);
+    if (changeDepth++ == 0)
+        configuredFamiliesBeforeChanges = [self _locked_configuredFamilies];
+    pthread_mutex_unlock(&lock);
+}
+
+- (void)_endChanges;
+{
+    NSDictionary *userInfo = nil;
+
+    pthread_mutex_lock(&lock);
+    OBASSERT(changeDepth > 0);
+    if (--changeDepth == 0) {
+        if (postsNotifications && ([changedInterfaceNames count] > 0 || [addedAddresses count] > 0 || [removedAddresses count] > 0)) {
+            BOOL configuredFamiliesChanged = [self _locked_configuredFamilies] != configuredFamiliesBeforeChanges;
+            userInfo = [NSDictionary dictionaryWithObjectsAndKeys:
+                        [[changedInterfaceNames copy] autorelease], ONInterfaceMonitorChangedInterfaceNamesKey,
+                        [[addedAddresses copy] autorelease], ONInterfaceMonitorAddedAddressesKey,
+                        [[removedAddresses copy] autorelease], ONInterfaceMonitorRemovedAddressesKey,
+                        [NSNumber numberWithBool:configuredFamiliesChanged], ONInterfaceMonitorConfiguredAddressFamiliesChangedKey,
+                        nil];
+        }
+        [changedInterfaceNames removeAllObjects];
+        [addedAddresses removeAllObjects];
+        [removedAddresses removeAllObjects];
+    }
+    pthread_mutex_unlock(&lock);
+
+    if (userInfo != nil)
+        [[NSNotificationCenter defaultCenter] postNotificationName:ONInterfaceMonitorInterfacesDidChangeNotification object:self userInfo:userInfo];
+}
+
+- (void)_locked_linkChanged:(ONInterfaceMonitorLink *)link;
+{
+    [changedInterfaceNames addObject:link->name];
+    [link->interface release];
+    link->interface = nil;
+    [interfaces release];
+    interfaces = nil;
+}
+
+- (void)_setLinkWithIndex:(unsigned int)index name:(NSString *)name flags:(unsigned int)flags interfaceType:(int)interfaceType maximumTransmissionUnit:(unsigned int)maximumTransmissionUnit;
+{
+    OBPRECONDITION(name != nil);
+
+    [self _beginChanges];
+    pthread_mutex_lock(&lock);
+
+    NSNumber *linkIndex = [NSNumber numberWithUnsignedInt:index];
+    ONInterfaceMonitorLink *link = [links objectForKey:linkIndex];
+    if (link == nil || ![link->name isEqualToString:name] || link->flags != flags || link->interfaceType != interfaceType || link->maximumTransmissionUnit != maximumTransmissionUnit) {
+        if (link == nil) {
+            link = [[ONInterfaceMonitorLink alloc] init];
+            link->index = index;
+            [links setObject:link forKey:linkIndex];
+            [link release];
+        } else {
+            // A renamed interface has changed under its old name too
+            [changedInterfaceNames addObject:link->name];
+        }
+
+        [link->name release];
+        link->name = [name copy];
+        link->flags = flags;
+        link->interfaceType = interfaceType;
+        link->maximumTransmissionUnit = maximumTransmissionUnit;
+        [self _locked_linkChanged:link];
+    }
+
+    pthread_mutex_unlock(&lock);
+    [self _endChanges];
+}
+
+- (void)_locked_removeAddress:(ONHostAddress *)address fromLink:(ONInterfaceMonitorLink *)link;
+{
+    NSUInteger addressIndex = [link->addresses indexOfObject:address];
+    if (addressIndex == NSNotFound)
+        return;
+
+    [address retain];
+    [link->addresses removeObjectAtIndex:addressIndex];
+    [link->netmasks removeObjectForKey:address];
+    [link->remoteAddresses removeObjectForKey:address];
+
+    int familyIndex = configuredAddressFamilyIndex(address);
+    if (familyIndex >= 0)
+        configuredAddressCounts[familyIndex]--;
+
+    if ([addressLinks objectForKey:address] == link) {
+        [addressLinks removeObjectForKey:address];
+        // The same address can be on more than one link (IPv6 link-local addresses often are)
+        for (ONInterfaceMonitorLink *otherLink in [links objectEnumerator]) {
+            if ([otherLink->addresses containsObject:address]) {
+                [addressLinks setObject:otherLink forKey:address];
+                break;
+            }
+        }
+    }
+
+    [removedAddresses addObject:address];
+    [self _locked_linkChanged:link];
+    [address release];
+}
+
+- (void)_removeLinkWithIndex:(unsigned int)index;
+{
+    [self _beginChanges];
+    pthread_mutex_lock(&lock);
+
+    NSNumber *linkIndex = [NSNumber numberWithUnsignedInt:index];
+    ONInterfaceMonitorLink *link = [[links objectForKey:linkIndex] retain];
+    if (link != nil) {
+        [links removeObjectForKey:linkIndex];
+        while ([link->addresses count] > 0)
+            [self _locked_removeAddress:[link->addresses lastObject] fromLink:link];
+        [self _locked_linkChanged:link];
+        [link release];
+    }
+
+    pthread_mutex_unlock(&lock);
+    [self _endChanges];
+}
+
+- (void)_addAddress:(ONHostAddress *)address netmask:(ONHostAddress *)netmask remoteAddress:(ONHostAddress *)remoteAddress toLinkWithIndex:(unsigned int)index;
+{
+    OBPRECONDITION(address != nil);
+
+    [self _beginChanges];
+    pthread_mutex_lock(&lock);
+
+    // There may be no such link if it went away with messages about its addresses still queued
+    ONInterfaceMonitorLink *link = [links objectForKey:[NSNumber numberWithUnsignedInt:index]];
+    if (link != nil && ![link->addresses containsObject:address]) {
+        [link->addresses addObject:address];
+        if (netmask != nil)
+            [link->netmasks setObject:netmask forKey:address];
+        if (remoteAddress != nil)
+            [link->remoteAddresses setObject:remoteAddress forKey:address];
+
+        int familyIndex = configuredAddressFamilyIndex(address);
+        if (familyIndex >= 0)
+            configuredAddressCounts[familyIndex]++;
+        if ([addressLinks objectForKey:address] == nil)
+            [addressLinks setObject:link forKey:address];
+
+        [addedAddresses addObject:address];
+        [self _locked_linkChanged:link];
+    } else if (link != nil && (!sameAddress(netmask, [link->netmasks objectForKey:address]) || !sameAddress(remoteAddress, [link->remoteAddresses objectForKey:address]))) {
+        if (netmask != nil)
+            [link->netmasks setObject:netmask forKey:address];
+        else
+            [link->netmasks removeObjectForKey:address];
+        if (remoteAddress != nil)
+            [link->remoteAddresses setObject:remoteAddress forKey:address];
+        else
+            [link->remoteAddresses removeObjectForKey:address];
+        [self _locked_linkChanged:link];
+    }
+
+    pthread_mutex_unlock(&lock);
+    [self _endChanges];
+}
+
+- (void)_removeAddress:(ONHostAddress *)address fromLinkWithIndex:(unsigned int)index;
+{
+    [self _beginChanges];
+    pthread_mutex_lock(&lock);
+
+    ONInterfaceMonitorLink *link = [links objectForKey:[NSNumber numberWithUnsignedInt:index]];
+    if (link != nil)
+        [self _locked_removeAddress:address fromLink:link];
+
+    pthread_mutex_unlock(&lock);
+    [self _endChanges];
+}
+
+// Makes our table match another one, as one batch of changes
+- (void)_synchronizeWithMonitor:(ONInterfaceMonitor *)scan;
+{
+    [self _beginChanges];
+
+    pthread_mutex_lock(&lock);
+    NSArray *indexes = [links allKeys];
+    pthread_mutex_unlock(&lock);
+    for (NSNumber *linkIndex in indexes) {
+        if ([scan->links objectForKey:linkIndex] == nil)
+            [self _removeLinkWithIndex:[linkIndex unsignedIntValue]];
+    }
+
+    for (ONInterfaceMonitorLink *scannedLink in [scan->links objectEnumerator]) {
+        [self _setLinkWithIndex:scannedLink->index name:scannedLink->name flags:scannedLink->flags interfaceType:scannedLink->interfaceType maximumTransmissionUnit:scannedLink->maximumTransmissionUnit];
+
+        pthread_mutex_lock(&lock);
+        ONInterfaceMonitorLink *link = [links objectForKey:[NSNumber numberWithUnsignedInt:scannedLink->index]];
+        NSArray *currentAddresses = [[link->addresses copy] autorelease];
+        pthread_mutex_unlock(&lock);
+
+        for (ONHostAddress *address in currentAddresses) {
+            if (![scannedLink->addresses containsObject:address])
+                [self _removeAddress:address fromLinkWithIndex:scannedLink->index];
+        }
+        for (ONHostAddress *address in scannedLink->addresses)
+            [self _addAddress:address netmask:[scannedLink->netmasks objectForKey:address] remoteAddress:[scannedLink->remoteAddresses objectForKey:address] toLinkWithIndex:scannedLink->index];
+    }
+
+    [self _endChanges];
+}
+
+#pragma mark - Listening to the system
+
+// Reads the whole table again and applies the differences, for when we can't be sure we've seen every change
+- (void)_resynchronize;
+{
+    ONInterfaceMonitor *scan = [[ONInterfaceMonitor alloc] _initWithoutSource];
+    scan->postsNotifications = NO;
+    @try {
+        [scan _loadCurrentTable];
+        [self _synchronizeWithMonitor:scan];
+    } @catch (NSException *exception) {
+        NSLog(@"%@: Unable to reread the network interfaces: %@", [self class], [exception reason]);
+    } @finally {
+        [scan release];
+    }
+}
+
+#if ON_MONITOR_USES_NETLINK
+
+static const struct { unsigned short hardwareType; int interfaceType; } hardwareTypes[] = {
+    { ARPHRD_ETHER,     IFT_ETHER },
+    { ARPHRD_LOOPBACK,  IFT_LOOP },
+    { ARPHRD_PPP,       IFT_PPP },
+    { ARPHRD_SLIP,      IFT_SLIP },
+    { ARPHRD_FDDI,      IFT_FDDI },
+    { ARPHRD_IEEE1394,  IFT_IEEE1394 },
+    { ARPHRD_TUNNEL,    IFT_GIF },
+    { ARPHRD_TUNNEL6,   IFT_GIF },
+    { ARPHRD_SIT,       IFT_STF },
+};
+
+static int interfaceTypeForHardwareType(unsigned short hardwareType)
+{
+    size_t typeIndex;
+
+    for (typeIndex = 0; typeIndex < sizeof(hardwareTypes) / sizeof(*hardwareTypes); typeIndex++) {
+        if (hardwareTypes[typeIndex].hardwareType == hardwareType)
+            return hardwareTypes[typeIndex].interfaceType;
+    }
+    return IFT_OTHER;
+}
+
+static ONHostAddress *netmaskAddress(int family, unsigned int prefixLength)
+{
+    unsigned char bytes[sizeof(struct in6_addr)];
+    size_t length = family == AF_INET ? sizeof(struct in_addr) : sizeof(struct in6_addr);
+    size_t byteIndex;
+
+    for (byteIndex = 0; byteIndex < length; byteIndex++) {
+        if (prefixLength >= 8) {
+            bytes[byteIndex] = 0xFF;
+            prefixLength -= 8;
+        } else {
+            bytes[byteIndex] = (unsigned char)(0xFF << (8 - prefixLength));
+            prefixLength = 0;
+        }
+    }
+    return [ONHostAddress hostAddressWithInternetAddress:bytes family:family];
+}
+
+static int openNetlinkSocket(unsigned int groups)
+{
+    struct sockaddr_nl address;
+    int fd;
+
+    fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0)
+        [NSException raise:NSGenericException posixErrorNumber:OMNI_ERRNO() format:@"Unable to open netlink socket: %s", strerror(OMNI_ERRNO())];
+
+    bzero(&address, sizeof(address));
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = groups;
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        int bindErrno = OMNI_ERRNO();
+        close(fd);
+        [NSException raise:NSGenericException posixErrorNumber:bindErrno format:@"Unable to bind netlink socket: %s", strerror(bindErrno)];
+    }
+    return fd;
+}
+
+static int openRouteSocket(void)
+{
+    int fd = openNetlinkSocket(RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR);
+    int bufferSize = ROUTE_SOCKET_BUFFER_SIZE;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+    return fd;
+}
+
+- (void)_handleLinkMessage:(const struct nlmsghdr *)header;
+{
+    const struct ifinfomsg *info = NLMSG_DATA(header);
+    const struct rtattr *attribute;
+    int attributesLength;
+    NSString *name = nil;
+    unsigned int maximumTransmissionUnit = 0;
+
+    if (header->nlmsg_len < NLMSG_LENGTH(sizeof(*info)))
+        return;
+
+    if (header->nlmsg_type == RTM_DELLINK) {
+        [self _removeLinkWithIndex:info->ifi_index];
+        return;
+    }
+
+    attributesLength = IFLA_PAYLOAD(header);
+    for (attribute = IFLA_RTA(info); RTA_OK(attribute, attributesLength); attribute = RTA_NEXT(attribute, attributesLength)) {
+        switch (attribute->rta_type) {
+            case IFLA_IFNAME:
+                name = [[[NSString alloc] initWithBytes:RTA_DATA(attribute) length:strnlen(RTA_DATA(attribute), RTA_PAYLOAD(attribute)) encoding:NSASCIIStringEncoding] autorelease];
+                break;
+            case IFLA_MTU:
+                if (RTA_PAYLOAD(attribute) >= sizeof(uint32_t))
+                    maximumTransmissionUnit = *(const uint32_t *)RTA_DATA(attribute);
+                break;
+        }
+    }
+
+    if (name != nil)
+        [self _setLinkWithIndex:info->ifi_index name:name flags:info->ifi_flags interfaceType:interfaceTypeForHardwareType(info->ifi_type) maximumTransmissionUnit:maximumTransmissionUnit];
+}
+
+- (void)_handleAddressMessage:(const struct nlmsghdr *)header;
+{
+    const struct ifaddrmsg *info = NLMSG_DATA(header);
+    const struct rtattr *attribute;
+    int attributesLength;
+    const void *localBytes = NULL, *addressBytes = NULL, *broadcastBytes = NULL;
+    size_t addressLength;
+    ONHostAddress *address, *remoteAddress = nil;
+
+    if (header->nlmsg_len < NLMSG_LENGTH(sizeof(*info)))
+        return;
+    if (info->ifa_family == AF_INET)
+        addressLength = sizeof(struct in_addr);
+    else if (info->ifa_family == AF_INET6)
+        addressLength = sizeof(struct in6_addr);
+    else
+        return;
+
+    attributesLength = IFA_PAYLOAD(header);
+    for (attribute = IFA_RTA(info); RTA_OK(attribute, attributesLength); attribute = RTA_NEXT(attribute, attributesLength)) {
+        if (RTA_PAYLOAD(attribute) < addressLength)
+            continue;
+        switch (attribute->rta_type) {
+            case IFA_LOCAL:     localBytes = RTA_DATA(attribute); break;
+            case IFA_ADDRESS:   addressBytes = RTA_DATA(attribute); break;
+            case IFA_BROADCAST: broadcastBytes = RTA_DATA(attribute); break;
+        }
+    }
+
+    // IFA_LOCAL is only there for point-to-point links, where IFA_ADDRESS is the other end
+    if (localBytes != NULL) {
+        address = [ONHostAddress hostAddressWithInternetAddress:localBytes family:info->ifa_family];
+        if (addressBytes != NULL && memcmp(localBytes, addressBytes, addressLength) != 0)
+            remoteAddress = [ONHostAddress hostAddressWithInternetAddress:addressBytes family:info->ifa_family];
+    } else if (addressBytes != NULL) {
+        address = [ONHostAddress hostAddressWithInternetAddress:addressBytes family:info->ifa_family];
+    } else {
+        return;
+    }
+    if (broadcastBytes != NULL)
+        remoteAddress = [ONHostAddress hostAddressWithInternetAddress:broadcastBytes family:info->ifa_family];
+
+    if (header->nlmsg_type == RTM_DELADDR)
+        [self _removeAddress:address fromLinkWithIndex:info->ifa_index];
+    else
+        [self _addAddress:address netmask:netmaskAddress(info->ifa_family, info->ifa_prefixlen) remoteAddress:remoteAddress toLinkWithIndex:info->ifa_index];
+}
+
+- (BOOL)_handleNetlinkMessages:(const void *)buffer length:(size_t)length;
+{
+    const struct nlmsghdr *header;
+    int remainingLength = (int)length;
+    BOOL done = NO;
+
+    [self _beginChanges];
+    for (header = buffer; !done && NLMSG_OK(header, remainingLength); header = NLMSG_NEXT(header, remainingLength)) {
+        switch (header->nlmsg_type) {
+            case NLMSG_DONE:
+                done = YES;
+                break;
+            case NLMSG_ERROR: {
+                // Only a dump request gets an answer, and this is the end of it
+                const struct nlmsgerr *error = NLMSG_DATA(header);
+                if (header->nlmsg_len >= NLMSG_LENGTH(sizeof(*error)) && error->error != 0)
+                    NSLog(@"%@: netlink request failed: %s", [self class], strerror(-error->error));
+                done = YES;
+                break;
+            }
+            case RTM_NEWLINK:
+            case RTM_DELLINK:
+                [self _handleLinkMessage:header];
+                break;
+            case RTM_NEWADDR:
+            case RTM_DELADDR:
+                [self _handleAddressMessage:header];
+                break;
+        }
+    }
+    [self _endChanges];
+
+    return done;
+}
+
+- (void)_dumpNetlinkTable:(int)requestType socket:(int)fd;
+{
+    struct {
+        struct nlmsghdr header;
+        struct rtgenmsg message;
+    } request;
+    char *buffer;
+    BOOL done;
+
+    bzero(&request, sizeof(request));
+    request.header.nlmsg_len = NLMSG_LENGTH(sizeof(request.message));
+    request.header.nlmsg_type = requestType;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.header.nlmsg_seq = 1;
+    request.message.rtgen_family = AF_UNSPEC;
+    if (send(fd, &request, request.header.nlmsg_len, 0) < 0)
+        [NSException raise:NSGenericException posixErrorNumber:OMNI_ERRNO() format:@"Unable to read network interfaces: send: %s", strerror(OMNI_ERRNO())];
+
+    buffer = malloc(ROUTE_MESSAGE_BUFFER_SIZE);
+    @try {
+        done = NO;
+        while (!done) {
+            ssize_t length = recv(fd, buffer, ROUTE_MESSAGE_BUFFER_SIZE, 0);
+            if (length < 0) {
+                if (OMNI_ERRNO() == EINTR)
+                    continue;
+                [NSException raise:NSGenericException posixErrorNumber:OMNI_ERRNO() format:@"Unable to read network interfaces: recv: %s", strerror(OMNI_ERRNO())];
+            }
+            done = length == 0 || [self _handleNetlinkMessages:buffer length:length];
+        }
+    } @finally {
+        free(buffer);
+    }
+}
+
+// The dump gets a socket of its own, so that its answers don't get mixed up with change messages
+- (void)_loadCurrentTable;
+{
+    int fd = openNetlinkSocket(0);
+    @try {
+        [self _dumpNetlinkTable:RTM_GETLINK socket:fd];
+        [self _dumpNetlinkTable:RTM_GETADDR socket:fd];
+    } @finally {
+        close(fd);
+    }
+}
+
+#else
+
+static int openRouteSocket(void)
+{
+    int fd = socket(PF_ROUTE, SOCK_RAW, AF_UNSPEC);
+    if (fd < 0)
+        [NSException raise:NSGenericException posixErrorNumber:OMNI_ERRNO() format:@"Unable to open routing socket: %s", strerror(OMNI_ERRNO())];
+
+    int bufferSize = ROUTE_SOCKET_BUFFER_SIZE;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+    return fd;
+}
+
+// The routing socket only tells us that something changed, not enough to update the table from, so we get the details from getifaddrs(). The link-layer entries give each interface's index and type, which the other entries refer back to by name.
+- (void)_loadCurrentTable;
+{
+    struct ifaddrs *ifs, *ifp;
+
+    ifs = NULL;
+    if (getifaddrs(&ifs) != 0)
+        [NSException raise:NSGenericException posixErrorNumber:OMNI_ERRNO() format:@"Unable to retrieve list of network interfaces: getifaddrs: %s", strerror(OMNI_ERRNO())];
+
+    @try {
+        NSMutableDictionary *indexesByName = [NSMutableDictionary dictionary];
+
+        for (ifp = ifs; ifp != NULL; ifp = ifp->ifa_next) {
+            if (ifp->ifa_addr == NULL || ifp->ifa_addr->sa_family != AF_LINK)
+                continue;
+
+            const struct sockaddr_dl *dlp = (const struct sockaddr_dl *)ifp->ifa_addr;
+            const struct if_data *data = ifp->ifa_data;
+            NSString *name = [[[NSString alloc] initWithBytes:ifp->ifa_name length:strlen(ifp->ifa_name) encoding:NSASCIIStringEncoding] autorelease];
+            [self _setLinkWithIndex:dlp->sdl_index name:name flags:ifp->ifa_flags interfaceType:dlp->sdl_type maximumTransmissionUnit:data != NULL ? data->ifi_mtu : 0];
+            [indexesByName setObject:[NSNumber numberWithUnsignedInt:dlp->sdl_index] forKey:name];
+        }
+
+        for (ifp = ifs; ifp != NULL; ifp = ifp->ifa_next) {
+            NSString *name = [[[NSString alloc] initWithBytes:ifp->ifa_name length:strlen(ifp->ifa_name) encoding:NSASCIIStringEncoding] autorelease];
+            NSNumber *linkIndex = [indexesByName objectForKey:name];
+            ONHostAddress *address = [ONHostAddress hostAddressWithSocketAddress:ifp->ifa_addr];
+            if (linkIndex == nil || address == nil)
+                continue;
+
+            ONHostAddress *netmask = [ONHostAddress hostAddressWithSocketAddress:ifp->ifa_netmask];
+            ONHostAddress *remoteAddress = [ONHostAddress hostAddressWithSocketAddress:(ifp->ifa_flags & IFF_POINTOPOINT) ? ifp->ifa_dstaddr : ifp->ifa_broadaddr];
+            [self _addAddress:address netmask:netmask remoteAddress:remoteAddress toLinkWithIndex:[linkIndex unsignedIntValue]];
+        }
+    } @finally {
+        freeifaddrs(ifs);
+    }
+}
+
+static BOOL isInterfaceMessage(const void *buffer, size_t length)
+{
+    size_t offset = 0;
+
+    while (offset + sizeof(struct rt_msghdr) <= length) {
+        const struct rt_msghdr *header = (const struct rt_msghdr *)((const char *)buffer + offset);
+        switch (header->rtm_type) {
+            case RTM_NEWADDR:
+            case RTM_DELADDR:
+            case RTM_IFINFO:
+#ifdef RTM_IFANNOUNCE
+            case RTM_IFANNOUNCE:
+#endif
+                return YES;
+        }
+        if (header->rtm_msglen == 0)
+            break;
+        offset += header->rtm_msglen;
+    }
+    return NO;
+}
+
+#endif
+
+- (void)_readRouteSocket;
+{
+    char *buffer = malloc(ROUTE_MESSAGE_BUFFER_SIZE);
+
+    while (YES) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        ssize_t length = recv(routeSocket, buffer, ROUTE_MESSAGE_BUFFER_SIZE, 0);
+
+        if (length > 0) {
+#if ON_MONITOR_USES_NETLINK
+            [self _handleNetlinkMessages:buffer length:length];
+#else
+            // Rescan once for everything that's queued up, rather than once per message
+            BOOL interfacesChanged = isInterfaceMessage(buffer, length);
+            while ((length = recv(routeSocket, buffer, ROUTE_MESSAGE_BUFFER_SIZE, MSG_DONTWAIT)) > 0)
+                interfacesChanged = interfacesChanged || isInterfaceMessage(buffer, length);
+            if (interfacesChanged)
+                [self _resynchronize];
+#endif
+        } else if (length < 0 && OMNI_ERRNO() == ENOBUFS) {
+            // The socket overflowed, so there are changes we'll never hear about
+            [self _resynchronize];
+        } else if (length == 0 || OMNI_ERRNO() != EINTR) {
+            NSLog(@"%@: Stopped monitoring network interfaces: recv: %s", [self class], length == 0 ? "end of file" : strerror(OMNI_ERRNO()));
+            // Our table won't be kept up to date any more, so nobody should rely on it
+            __atomic_store_n(&runningMonitor, nil, __ATOMIC_RELEASE);
+            [pool release];
+            break;
+        }
+
+        [pool release];
+    }
+
+    free(buffer);
+}
+
+@end
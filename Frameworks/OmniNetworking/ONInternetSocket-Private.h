@@ -41,6 +41,9 @@ typedef socklen_t ONSocketAddressLength;
 - (void)_locked_destroySocketFD;
     // Sets the socketFD to -1, as well as doing related cleanup. Must not raise.
 
+- (ONInternetSocket *)_connectionAttemptSocket;
+    // Returns a new, unconnected socket to race one address with when connecting to several. Subclasses that remember their own socket options should copy them to it, since the winner's descriptor is adopted as is.
+
 OB_HIDDEN extern BOOL ONSocketStateDebug;
 
 @end
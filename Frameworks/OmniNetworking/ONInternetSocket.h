@@ -79,8 +79,15 @@
 - (void)connectToAddress:(ONHostAddress *)hostAddress port:(unsigned short int)port;
 - (void)connectToAddressFromArray:(NSArray *)portAddresses;
     // This attempts to connect to one of a list of addresses, e.g. for a multi-homed host or for a service with multiple MX or SRV records. Most of the -connectTo... methods invoke -connectToAddressFromArray: to do the actual work.
+    // Addresses that connected quickly before are tried first and ones that failed recently are tried last, alternating between address families. A TCP socket that hasn't been set up yet doesn't wait for each address to fail before trying the next: it starts a new attempt every 250ms or so (sooner for addresses known to be fast) alongside the ones already in flight, and keeps whichever connects first.
+
+- (BOOL)startConnectingToPortAddress:(ONPortAddress *)portAddress;
+    // Starts connecting without waiting, putting the socket in non-blocking mode. Returns YES if the connection was made right away; otherwise, once the socket becomes writable (see ONSocketReactor), call -finishConnectingToPortAddress: to find out how it went. Raises the same exceptions as -connectToPortAddress: for failures it can see immediately.
+- (void)finishConnectingToPortAddress:(ONPortAddress *)portAddress;
+    // Completes a connection started by -startConnectingToPortAddress:, raising as -connectToPortAddress: would if it failed.
 
 - (void)setNonBlocking:(BOOL)shouldBeNonBlocking;
+- (BOOL)isNonBlocking;
 - (BOOL)waitForInputWithTimeout:(NSTimeInterval)timeout;
 
 - (void)setAllowsBroadcast:(BOOL)shouldAllowBroadcast;
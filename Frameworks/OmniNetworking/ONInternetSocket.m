@@ -18,12 +18,130 @@
 #import <OmniNetworking/ONInterface.h>
 #import <OmniNetworking/ONPortAddress.h>
 
+#include <poll.h>
+
 RCS_ID("$Id$")
 
 #ifdef OMNI_ASSERTIONS_ON
 static BOOL is_mutex_locked(pthread_mutex_t *m);
 #endif
 
+// Waits for the given events on one descriptor. Unlike select(), poll() doesn't care how large the descriptor is. Returns 1 if any of the events (or an error or hangup) happened, 0 on timeout, -1 on error.
+static int pollSocket(int fd, short events, int timeoutMilliseconds)
+{
+    struct pollfd pollDescriptor;
+    int returnValue;
+
+    pollDescriptor.fd = fd;
+    pollDescriptor.events = events;
+    pollDescriptor.revents = 0;
+    do {
+        returnValue = poll(&pollDescriptor, 1, timeoutMilliseconds);
+    } while (returnValue == -1 && OMNI_ERRNO() == EINTR);
+    return returnValue;
+}
+
+#pragma mark - Connection history
+
+// What we've learned about connecting to each address, so that -connectToAddressFromArray: tries the addresses that answered quickly before first, and the ones that just failed last.
+static pthread_mutex_t connectHistoryLock = PTHREAD_MUTEX_INITIALIZER;
+static NSMutableDictionary *connectRoundTripTimes; // ONPortAddress -> NSNumber (smoothed seconds)
+static NSMutableDictionary *connectFailureTimes; // ONPortAddress -> NSNumber (CFAbsoluteTime)
+
+#define CONNECT_HISTORY_LIMIT 1024
+#define CONNECT_FAILURE_MEMORY (10.0 * 60.0)
+#define CONNECT_ATTEMPT_DELAY 0.25
+#define CONNECT_ATTEMPT_DELAY_MINIMUM 0.1
+#define CONNECT_ATTEMPT_DELAY_MAXIMUM 2.0
+#define CONNECT_ABORT_CHECK_MILLISECONDS 250
+
+static void noteConnectSucceeded(ONPortAddress *portAddress, NSTimeInterval roundTripTime)
+{
+    pthread_mutex_lock(&connectHistoryLock);
+    if (connectRoundTripTimes == nil || [connectRoundTripTimes count] >= CONNECT_HISTORY_LIMIT) {
+        [connectRoundTripTimes release];
+        connectRoundTripTimes = [[NSMutableDictionary alloc] init];
+    }
+    NSNumber *previousTime = [connectRoundTripTimes objectForKey:portAddress];
+    if (previousTime != nil)
+        roundTripTime = 0.875 * [previousTime doubleValue] + 0.125 * roundTripTime; // As for TCP's own smoothed RTT
+    [connectRoundTripTimes setObject:[NSNumber numberWithDouble:roundTripTime] forKey:portAddress];
+    [connectFailureTimes removeObjectForKey:portAddress];
+    pthread_mutex_unlock(&connectHistoryLock);
+}
+
+static void noteConnectFailed(ONPortAddress *portAddress)
+{
+    pthread_mutex_lock(&connectHistoryLock);
+    if (connectFailureTimes == nil || [connectFailureTimes count] >= CONNECT_HISTORY_LIMIT) {
+        [connectFailureTimes release];
+        connectFailureTimes = [[NSMutableDictionary alloc] init];
+    }
+    [connectFailureTimes setObject:[NSNumber numberWithDouble:CFAbsoluteTimeGetCurrent()] forKey:portAddress];
+    [connectRoundTripTimes removeObjectForKey:portAddress];
+    pthread_mutex_unlock(&connectHistoryLock);
+}
+
+// RFC 8305 recommends waiting 250ms before starting the next attempt, or about twice the round trip time if we know it, within limits.
+static NSTimeInterval connectionAttemptDelay(ONPortAddress *portAddress)
+{
+    NSTimeInterval delay = CONNECT_ATTEMPT_DELAY;
+
+    pthread_mutex_lock(&connectHistoryLock);
+    NSNumber *roundTripTime = [connectRoundTripTimes objectForKey:portAddress];
+    if (roundTripTime != nil)
+        delay = MIN(MAX(2.0 * [roundTripTime doubleValue], CONNECT_ATTEMPT_DELAY_MINIMUM), CONNECT_ATTEMPT_DELAY_MAXIMUM);
+    pthread_mutex_unlock(&connectHistoryLock);
+    return delay;
+}
+
+// Addresses that connected before come first, fastest first, then the ones we know nothing about in the order given, then the ones that failed recently. Address families alternate (RFC 8305 section 4), starting with the family of the first address, so that a broken family costs at most one attempt delay.
+static NSArray *orderedConnectAddresses(NSArray *portAddresses)
+{
+    NSMutableArray *candidates = [NSMutableArray array];
+    NSMutableArray *unknownAddresses = [NSMutableArray array];
+    NSMutableArray *failedAddresses = [NSMutableArray array];
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+
+    pthread_mutex_lock(&connectHistoryLock);
+    for (ONPortAddress *portAddress in portAddresses) {
+        OBASSERT([portAddress isKindOfClass:[ONPortAddress class]]);
+        NSNumber *failureTime = [connectFailureTimes objectForKey:portAddress];
+        if (failureTime != nil && now - [failureTime doubleValue] < CONNECT_FAILURE_MEMORY)
+            [failedAddresses addObject:portAddress];
+        else if ([connectRoundTripTimes objectForKey:portAddress] != nil)
+            [candidates addObject:portAddress];
+        else
+            [unknownAddresses addObject:portAddress];
+    }
+    [candidates sortWithOptions:NSSortStable usingComparator:^NSComparisonResult(id address1, id address2) {
+        return [[connectRoundTripTimes objectForKey:address1] compare:[connectRoundTripTimes objectForKey:address2]];
+    }];
+    pthread_mutex_unlock(&connectHistoryLock);
+    [candidates addObjectsFromArray:unknownAddresses];
+
+    NSUInteger candidateCount = [candidates count];
+    if (candidateCount == 0)
+        return failedAddresses;
+
+    int firstFamily = [[candidates objectAtIndex:0] addressFamily];
+    NSMutableArray *firstFamilyAddresses = [NSMutableArray arrayWithCapacity:candidateCount];
+    NSMutableArray *otherAddresses = [NSMutableArray array];
+    for (ONPortAddress *portAddress in candidates)
+        [([portAddress addressFamily] == firstFamily ? firstFamilyAddresses : otherAddresses) addObject:portAddress];
+
+    NSMutableArray *orderedAddresses = [NSMutableArray arrayWithCapacity:[portAddresses count]];
+    NSUInteger firstIndex = 0, otherIndex = 0;
+    while (firstIndex < [firstFamilyAddresses count] || otherIndex < [otherAddresses count]) {
+        if (firstIndex < [firstFamilyAddresses count])
+            [orderedAddresses addObject:[firstFamilyAddresses objectAtIndex:firstIndex++]];
+        if (otherIndex < [otherAddresses count])
+            [orderedAddresses addObject:[otherAddresses objectAtIndex:otherIndex++]];
+    }
+    [orderedAddresses addObjectsFromArray:failedAddresses];
+    return orderedAddresses;
+}
+
 @implementation ONInternetSocket
 {
     /* protocol family of socket, if socketFD is not -1 */
@@ -367,71 +485,23 @@ static ONPortAddress *getEndpointAddress(ONInternetSocket *self, int (*getaddr)(
 
 - (void)connectToAddressFromArray:(NSArray *)portAddresses
 {
-    NSUInteger addressCount, addressIndex;
-    NSException *firstTemporaryException;
+    NSArray *orderedAddresses = orderedConnectAddresses(portAddresses);
 
-    firstTemporaryException = nil;
-    
-    addressCount = [portAddresses count];
-    for(addressIndex = 0; addressIndex < addressCount; addressIndex ++) {
-        ONPortAddress *anAddress = [portAddresses objectAtIndex:addressIndex];
-
-        OBASSERT([anAddress isKindOfClass:[ONPortAddress class]]);
-
-        NS_DURING {
-            [self connectToPortAddress:anAddress];
-        } NS_HANDLER {
-            if (![[localException name] isEqualToString:
-                ONInternetSocketConnectTemporarilyFailedExceptionName])
-                [localException raise];
-            if (!firstTemporaryException)
-                firstTemporaryException = localException;
-        } NS_ENDHANDLER;
-        
-        if (flags.connected)
-            return;
-    }
-
-    if (firstTemporaryException)
-        [firstTemporaryException raise];
+    // Racing takes a new socket per attempt, so we can't race if our own socket has already been set up or bound to a particular port. And only stream sockets wait for a handshake, so nothing else gains from it.
+    if ([orderedAddresses count] > 1 && [[self class] socketType] == SOCK_STREAM && socketFD == -1 && requestedLocalPort <= 0)
+        [self _raceToConnectToAddressFromArray:orderedAddresses];
     else
-        [[NSException exceptionWithName:ONInternetSocketConnectFailedExceptionName reason:NSLocalizedStringFromTableInBundle(@"Unable to connect: no IP addresses to connect to", @"OmniNetworking", [NSBundle bundleForClass:[ONInternetSocket class]], @"error") userInfo:nil] raise];
+        [self _connectToAddressFromArrayInOrder:orderedAddresses];
 }
 
 - (void)connectToPortAddress:(ONPortAddress *)portAddress;
 {
-    NSException *pendingException = nil;
     const struct sockaddr *socketAddress;
+    NSException *pendingException;
     BOOL connectSucceeded;
     
     socketAddress = [portAddress portAddress];
-    
-    OBPRECONDITION(!is_mutex_locked(&socketLock));
-    
-    pthread_mutex_lock(&socketLock);
-    
-    if (remoteAddress != nil) {
-        [remoteAddress release];
-        remoteAddress = nil;
-    }
-    if (remoteHost != nil) {
-        [remoteHost release];
-        remoteHost = nil;
-    }
-    
-    /* If we have a socket of the wrong family, get rid of it */
-    if (socketFD != -1 && [self addressFamily] != (socketAddress->sa_family))
-        [self _locked_destroySocketFD];
-    /* Create a socket of the appropriate protocol family */
-    if (socketFD == -1) {
-        NS_DURING {
-            [self _locked_createSocketFD:socketAddress->sa_family];
-        } NS_HANDLER {
-            pendingException = localException;
-        } NS_ENDHANDLER;
-    }
-        
-    pthread_mutex_unlock(&socketLock);
+    pendingException = [self _prepareToConnect:socketAddress];
     
     if (pendingException == nil) {
         errno = 0;
@@ -445,39 +515,51 @@ static ONPortAddress *getEndpointAddress(ONInternetSocket *self, int (*getaddr)(
             NSLog(@"%@: connect(%@) skipped due to pending exception (%@)", [self shortDescription], [portAddress description], [pendingException name]);
     }
     
-    if (connectSucceeded) {
+    if (connectSucceeded)
         flags.connected = YES;
-    } else {
-        pthread_mutex_lock(&socketLock);
-        
-        // Check to see if the user aborted the connect()
-        if (flags.userAbort)
-            pendingException = [NSException exceptionWithName:ONInternetSocketUserAbortExceptionName reason:NSLocalizedStringFromTableInBundle(@"Connect aborted", @"OmniNetworking", [NSBundle bundleForClass:[ONInternetSocket class]], @"error - user (or other event) canceled attempt to connect to remote host") userInfo:nil];
-        
-        [self _locked_destroySocketFD];
-        
-        if (pendingException == nil)
-            switch (OMNI_ERRNO()) {
-                case ETIMEDOUT:
-                case ECONNREFUSED:
-                case ENETDOWN:
-                case ENETUNREACH:
-                case EHOSTDOWN:
-                case EADDRNOTAVAIL:
-                case EAFNOSUPPORT:
-                case EHOSTUNREACH:
-                    pendingException = [NSException exceptionWithName:ONInternetSocketConnectTemporarilyFailedExceptionName posixErrorNumber:OMNI_ERRNO() format:NSLocalizedStringFromTableInBundle(@"Temporarily unable to connect to %@: %s", @"OmniNetworking", [NSBundle bundleForClass:[ONInternetSocket class]], @"error - one of ETIMEDOUT ECONNREFUSED ENETDOWN ENETUNREACH EHOSTDOWN or EHOSTUNREACH"), [portAddress description], strerror(OMNI_ERRNO())];
-                    break;
-                default:
-                    pendingException = [NSException exceptionWithName:ONInternetSocketConnectFailedExceptionName posixErrorNumber:OMNI_ERRNO() format:NSLocalizedStringFromTableInBundle(@"Unable to connect to %@: %s", @"OmniNetworking", [NSBundle bundleForClass:[ONInternetSocket class]], @"error - non-transient error when connecting to remote host"), portAddress, strerror(OMNI_ERRNO())];
-                    break;
-            };
-        
-        pthread_mutex_unlock(&socketLock);
-        if (ONSocketStateDebug)
-            NSLog(@"%@ %@: raising %@", [self shortDescription], NSStringFromSelector(_cmd), [pendingException name]);
-        [pendingException raise];
+    else
+        [self _raiseConnectFailureToPortAddress:portAddress pendingException:pendingException errorNumber:OMNI_ERRNO()];
+}
+
+- (BOOL)startConnectingToPortAddress:(ONPortAddress *)portAddress;
+{
+    const struct sockaddr *socketAddress;
+    NSException *pendingException;
+    
+    socketAddress = [portAddress portAddress];
+    pendingException = [self _prepareToConnect:socketAddress];
+    
+    if (pendingException == nil) {
+        if (!flags.nonBlocking)
+            [self setNonBlocking:YES];
+        if (connect(socketFD, socketAddress, socketAddress->sa_len) == 0) {
+            flags.connected = YES;
+            return YES;
+        }
+        if (OMNI_ERRNO() == EINPROGRESS)
+            return NO;
     }
+    
+    [self _raiseConnectFailureToPortAddress:portAddress pendingException:pendingException errorNumber:OMNI_ERRNO()];
+    return NO; // Not reached
+}
+
+- (void)finishConnectingToPortAddress:(ONPortAddress *)portAddress;
+{
+    int connectError = 0;
+    socklen_t connectErrorLength = sizeof(connectError);
+    
+    if (socketFD == -1)
+        connectError = flags.userAbort ? EINTR : ENOTCONN;
+    else if (getsockopt(socketFD, SOL_SOCKET, SO_ERROR, &connectError, &connectErrorLength) == -1)
+        connectError = OMNI_ERRNO();
+    if (ONSocketStateDebug)
+        NSLog(@"%@: finished connecting to %@ (error=%d)", [self shortDescription], [portAddress description], connectError);
+    
+    if (connectError == 0)
+        flags.connected = YES;
+    else
+        [self _raiseConnectFailureToPortAddress:portAddress pendingException:nil errorNumber:connectError];
 }
 
 - (void)connectToHost:(ONHost *)host serviceEntry:(ONServiceEntry *)service;
@@ -516,10 +598,13 @@ static ONPortAddress *getEndpointAddress(ONInternetSocket *self, int (*getaddr)(
     flags.nonBlocking = shouldBeNonBlocking? 1 : 0;
 }
 
+- (BOOL)isNonBlocking;
+{
+    return flags.nonBlocking ? YES : NO;
+}
+
 - (BOOL)waitForInputWithTimeout:(NSTimeInterval)timeout;
 {
-    struct timeval selectTimeout;
-    fd_set readfds;
     int returnValue;
 
     if (socketFD == -1) {
@@ -530,20 +615,14 @@ static ONPortAddress *getEndpointAddress(ONInternetSocket *self, int (*getaddr)(
     if (timeout < 0.0)
         timeout = 0.0;
     
-    double usec, isec;
-    usec = modf(timeout, &isec);
-    selectTimeout.tv_sec = (unsigned int)isec;
-    selectTimeout.tv_usec = (unsigned int)floor(1.0e6 * usec);
-    FD_ZERO(&readfds);
-    FD_SET(socketFD, &readfds);
-    returnValue = select(socketFD + 1, &readfds, NULL, NULL, &selectTimeout);
+    returnValue = pollSocket(socketFD, POLLIN, (int)MIN(ceil(timeout * 1000.0), (double)INT_MAX));
     switch (returnValue) {
         case -1:
-            [NSException raise:ONInternetSocketReadFailedExceptionName posixErrorNumber:OMNI_ERRNO() format:NSLocalizedStringFromTableInBundle(@"Error waiting for input: %s", @"OmniNetworking", [NSBundle bundleForClass:[ONInternetSocket class]], @"error return from select()"), strerror(OMNI_ERRNO())];
+            [NSException raise:ONInternetSocketReadFailedExceptionName posixErrorNumber:OMNI_ERRNO() format:NSLocalizedStringFromTableInBundle(@"Error waiting for input: %s", @"OmniNetworking", [NSBundle bundleForClass:[ONInternetSocket class]], @"error return from poll()"), strerror(OMNI_ERRNO())];
         case 0:
             return NO;
         default:
-            return FD_ISSET(socketFD, &readfds) != 0;
+            return YES;
     }
 }
 
@@ -580,35 +659,18 @@ static ONPortAddress *getEndpointAddress(ONInternetSocket *self, int (*getaddr)(
 
 - (BOOL)isWritable;
 {
-    fd_set writeSet;
-    struct timeval timeout;
-    int writability;
-    
     if (socketFD == -1)
         return NO;
     
-    timeout.tv_sec = 0;
-    timeout.tv_usec = 0;
-    FD_ZERO(&writeSet);
-    FD_SET(socketFD, &writeSet);
-    writability = select(socketFD + 1, NULL, &writeSet, NULL, &timeout);
-    
-    return (writability == 1);
+    return pollSocket(socketFD, POLLOUT, 0) == 1;
 }
 
 - (BOOL)isReadable;
 {
-    fd_set readSet;
-    struct timeval timeout;
-
     if (socketFD == -1)
         return NO;
 
-    timeout.tv_sec = 0;
-    timeout.tv_usec = 0;
-    FD_ZERO(&readSet);
-    FD_SET(socketFD, &readSet);
-    return select(socketFD + 1, &readSet, NULL, NULL, &timeout) == 1;
+    return pollSocket(socketFD, POLLIN, 0) == 1;
 }
 
 // ONSocket subclass
@@ -625,6 +687,271 @@ static ONPortAddress *getEndpointAddress(ONInternetSocket *self, int (*getaddr)(
     pthread_mutex_unlock(&socketLock);
 }
 
+#pragma mark - Private
+
+- (void)_connectToAddressFromArrayInOrder:(NSArray *)portAddresses;
+{
+    NSUInteger addressCount, addressIndex;
+    NSException *firstTemporaryException;
+
+    firstTemporaryException = nil;
+    
+    addressCount = [portAddresses count];
+    for(addressIndex = 0; addressIndex < addressCount; addressIndex ++) {
+        ONPortAddress *anAddress = [portAddresses objectAtIndex:addressIndex];
+        CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+
+        NS_DURING {
+            [self connectToPortAddress:anAddress];
+        } NS_HANDLER {
+            if (![[localException name] isEqualToString:
+                ONInternetSocketConnectTemporarilyFailedExceptionName])
+                [localException raise];
+            noteConnectFailed(anAddress);
+            if (!firstTemporaryException)
+                firstTemporaryException = localException;
+        } NS_ENDHANDLER;
+        
+        if (flags.connected) {
+            noteConnectSucceeded(anAddress, CFAbsoluteTimeGetCurrent() - startTime);
+            return;
+        }
+    }
+
+    if (firstTemporaryException)
+        [firstTemporaryException raise];
+    else
+        [[NSException exceptionWithName:ONInternetSocketConnectFailedExceptionName reason:NSLocalizedStringFromTableInBundle(@"Unable to connect: no IP addresses to connect to", @"OmniNetworking", [NSBundle bundleForClass:[ONInternetSocket class]], @"error") userInfo:nil] raise];
+}
+
+// Happy Eyeballs (RFC 8305): start connecting to the first address, and if that hasn't worked out after a short delay, start on the next one too without giving up on the first, and so on. The first attempt to connect wins, its descriptor becomes ours, and the others are abandoned. So a dead address costs a fraction of a second rather than a full connect timeout.
+- (void)_raceToConnectToAddressFromArray:(NSArray *)portAddresses;
+{
+    NSUInteger addressCount = [portAddresses count], nextAddressIndex = 0;
+    NSMutableArray *attempts = [NSMutableArray arrayWithCapacity:addressCount];
+    // These parallel the attempts in flight
+    struct pollfd *pollDescriptors = malloc(addressCount * sizeof(*pollDescriptors));
+    CFAbsoluteTime *attemptStartTimes = malloc(addressCount * sizeof(*attemptStartTimes));
+    ONPortAddress **attemptAddresses = malloc(addressCount * sizeof(*attemptAddresses));
+    NSUInteger attemptCount = 0;
+    CFAbsoluteTime nextAttemptTime = 0.0;
+    NSException *firstTemporaryException = nil, *fatalException = nil;
+    ONInternetSocket *winner = nil;
+    BOOL wasAborted = flags.userAbort ? YES : NO;
+
+    while (winner == nil && fatalException == nil) {
+        CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+
+        // -abortSocket can't interrupt attempts on sockets that aren't ours yet, so we check for it ourselves
+        if (flags.userAbort && !wasAborted) {
+            fatalException = [NSException exceptionWithName:ONInternetSocketUserAbortExceptionName reason:NSLocalizedStringFromTableInBundle(@"Connect aborted", @"OmniNetworking", [NSBundle bundleForClass:[ONInternetSocket class]], @"error - user (or other event) canceled attempt to connect to remote host") userInfo:nil];
+            break;
+        }
+
+        // Start the next attempt when it's due. An attempt failing makes the next one due right away (RFC 8305 section 5).
+        if (nextAddressIndex < addressCount && now >= nextAttemptTime) {
+            ONPortAddress *portAddress = [portAddresses objectAtIndex:nextAddressIndex++];
+            ONInternetSocket *attempt = [self _connectionAttemptSocket];
+            BOOL connected = NO;
+
+            NS_DURING {
+                connected = [attempt startConnectingToPortAddress:portAddress];
+            } NS_HANDLER {
+                if ([[localException name] isEqualToString:ONInternetSocketConnectTemporarilyFailedExceptionName]) {
+                    noteConnectFailed(portAddress);
+                    if (!firstTemporaryException)
+                        firstTemporaryException = localException;
+                } else
+                    fatalException = localException;
+                attempt = nil;
+            } NS_ENDHANDLER;
+
+            if (connected) {
+                noteConnectSucceeded(portAddress, CFAbsoluteTimeGetCurrent() - now);
+                winner = attempt;
+            } else if (attempt != nil) {
+                [attempts addObject:attempt];
+                pollDescriptors[attemptCount].fd = [attempt socketFD];
+                pollDescriptors[attemptCount].events = POLLOUT;
+                pollDescriptors[attemptCount].revents = 0;
+                attemptStartTimes[attemptCount] = now;
+                attemptAddresses[attemptCount] = portAddress;
+                attemptCount++;
+                nextAttemptTime = now + connectionAttemptDelay(portAddress);
+            } else
+                nextAttemptTime = now;
+            continue;
+        }
+
+        if (attemptCount == 0)
+            break; // Every address failed
+
+        int timeoutMilliseconds = CONNECT_ABORT_CHECK_MILLISECONDS;
+        if (nextAddressIndex < addressCount)
+            timeoutMilliseconds = MIN(timeoutMilliseconds, (int)ceil(MAX(nextAttemptTime - now, 0.0) * 1000.0));
+        int readyCount;
+        do {
+            readyCount = poll(pollDescriptors, (nfds_t)attemptCount, timeoutMilliseconds);
+        } while (readyCount == -1 && OMNI_ERRNO() == EINTR);
+        if (readyCount == -1) {
+            fatalException = [NSException exceptionWithName:ONInternetSocketConnectFailedExceptionName posixErrorNumber:OMNI_ERRNO() format:@"Unable to connect: %s", strerror(OMNI_ERRNO())];
+            break;
+        }
+
+        now = CFAbsoluteTimeGetCurrent();
+        NSUInteger attemptIndex = 0;
+        while (readyCount > 0 && attemptIndex < attemptCount && winner == nil && fatalException == nil) {
+            if (pollDescriptors[attemptIndex].revents == 0) {
+                attemptIndex++;
+                continue;
+            }
+            readyCount--;
+
+            ONInternetSocket *attempt = [attempts objectAtIndex:attemptIndex];
+            ONPortAddress *portAddress = attemptAddresses[attemptIndex];
+            NS_DURING {
+                [attempt finishConnectingToPortAddress:portAddress];
+                noteConnectSucceeded(portAddress, now - attemptStartTimes[attemptIndex]);
+                winner = attempt;
+            } NS_HANDLER {
+                if ([[localException name] isEqualToString:ONInternetSocketConnectTemporarilyFailedExceptionName]) {
+                    noteConnectFailed(portAddress);
+                    if (!firstTemporaryException)
+                        firstTemporaryException = localException;
+                } else
+                    fatalException = localException;
+            } NS_ENDHANDLER;
+
+            if (winner == nil) {
+                // Drop the failed attempt, and don't keep the next one waiting for it
+                nextAttemptTime = now;
+                [attempts removeObjectAtIndex:attemptIndex];
+                attemptCount--;
+                memmove(pollDescriptors + attemptIndex, pollDescriptors + attemptIndex + 1, (attemptCount - attemptIndex) * sizeof(*pollDescriptors));
+                memmove(attemptStartTimes + attemptIndex, attemptStartTimes + attemptIndex + 1, (attemptCount - attemptIndex) * sizeof(*attemptStartTimes));
+                memmove(attemptAddresses + attemptIndex, attemptAddresses + attemptIndex + 1, (attemptCount - attemptIndex) * sizeof(*attemptAddresses));
+            }
+        }
+    }
+
+    if (winner != nil)
+        [self _adoptConnectedSocket:winner];
+    for (ONInternetSocket *attempt in attempts)
+        if (attempt != winner)
+            [attempt abortSocket];
+
+    free(pollDescriptors);
+    free(attemptStartTimes);
+    free(attemptAddresses);
+
+    if (winner != nil)
+        return;
+    if (fatalException != nil)
+        [fatalException raise];
+    OBASSERT(firstTemporaryException != nil); // We only race two or more addresses
+    [firstTemporaryException raise];
+}
+
+// A socket to make one of the attempts in a race with, set up the way our own socket would have been
+- (ONInternetSocket *)_connectionAttemptSocket;
+{
+    ONInternetSocket *attempt = [[self class] socket];
+
+    attempt->requestedLocalPort = requestedLocalPort;
+    attempt->flags.allowAddressReuse = flags.allowAddressReuse;
+    attempt->flags.allowBroadcast = flags.allowBroadcast;
+    return attempt;
+}
+
+- (void)_adoptConnectedSocket:(ONInternetSocket *)attempt;
+{
+    pthread_mutex_lock(&socketLock);
+    OBASSERT(socketFD == -1);
+
+    pthread_mutex_lock(&attempt->socketLock);
+    socketFD = attempt->socketFD;
+    socketPF = attempt->socketPF;
+    attempt->socketFD = -1;
+    attempt->flags.connected = 0;
+    pthread_mutex_unlock(&attempt->socketLock);
+
+    flags.shouldNotCloseFD = 0;
+    flags.listening = 0;
+    flags.connected = 1;
+    // The attempt was made without blocking; leave the descriptor the way we were asked to
+    [self setNonBlocking:flags.nonBlocking ? YES : NO];
+
+    pthread_mutex_unlock(&socketLock);
+}
+
+// Forgets any cached remote address and makes sure there's a socket of the right family to connect with. Returns (rather than raises) any exception so that the caller can report it along with the connect failure.
+- (NSException *)_prepareToConnect:(const struct sockaddr *)socketAddress;
+{
+    NSException *pendingException = nil;
+
+    OBPRECONDITION(!is_mutex_locked(&socketLock));
+    
+    pthread_mutex_lock(&socketLock);
+    
+    if (remoteAddress != nil) {
+        [remoteAddress release];
+        remoteAddress = nil;
+    }
+    if (remoteHost != nil) {
+        [remoteHost release];
+        remoteHost = nil;
+    }
+    
+    /* If we have a socket of the wrong family, get rid of it */
+    if (socketFD != -1 && [self addressFamily] != (socketAddress->sa_family))
+        [self _locked_destroySocketFD];
+    /* Create a socket of the appropriate protocol family */
+    if (socketFD == -1) {
+        NS_DURING {
+            [self _locked_createSocketFD:socketAddress->sa_family];
+        } NS_HANDLER {
+            pendingException = localException;
+        } NS_ENDHANDLER;
+    }
+        
+    pthread_mutex_unlock(&socketLock);
+
+    return pendingException;
+}
+
+- (void)_raiseConnectFailureToPortAddress:(ONPortAddress *)portAddress pendingException:(NSException *)pendingException errorNumber:(int)errorNumber;
+{
+    pthread_mutex_lock(&socketLock);
+    
+    // Check to see if the user aborted the connect()
+    if (flags.userAbort)
+        pendingException = [NSException exceptionWithName:ONInternetSocketUserAbortExceptionName reason:NSLocalizedStringFromTableInBundle(@"Connect aborted", @"OmniNetworking", [NSBundle bundleForClass:[ONInternetSocket class]], @"error - user (or other event) canceled attempt to connect to remote host") userInfo:nil];
+    
+    [self _locked_destroySocketFD];
+    
+    if (pendingException == nil)
+        switch (errorNumber) {
+            case ETIMEDOUT:
+            case ECONNREFUSED:
+            case ENETDOWN:
+            case ENETUNREACH:
+            case EHOSTDOWN:
+            case EADDRNOTAVAIL:
+            case EAFNOSUPPORT:
+            case EHOSTUNREACH:
+                pendingException = [NSException exceptionWithName:ONInternetSocketConnectTemporarilyFailedExceptionName posixErrorNumber:errorNumber format:NSLocalizedStringFromTableInBundle(@"Temporarily unable to connect to %@: %s", @"OmniNetworking", [NSBundle bundleForClass:[ONInternetSocket class]], @"error - one of ETIMEDOUT ECONNREFUSED ENETDOWN ENETUNREACH EHOSTDOWN or EHOSTUNREACH"), [portAddress description], strerror(errorNumber)];
+                break;
+            default:
+                pendingException = [NSException exceptionWithName:ONInternetSocketConnectFailedExceptionName posixErrorNumber:errorNumber format:NSLocalizedStringFromTableInBundle(@"Unable to connect to %@: %s", @"OmniNetworking", [NSBundle bundleForClass:[ONInternetSocket class]], @"error - non-transient error when connecting to remote host"), portAddress, strerror(errorNumber)];
+                break;
+        };
+    
+    pthread_mutex_unlock(&socketLock);
+    if (ONSocketStateDebug)
+        NSLog(@"%@ %@: raising %@", [self shortDescription], NSStringFromSelector(_cmd), [pendingException name]);
+    [pendingException raise];
+}
+
 // Debugging
 
 - (NSMutableDictionary *)debugDictionary;
@@ -137,6 +137,25 @@ RCS_ID("$Id$")
     return [super writeBytes:byteCount fromBuffer:aBuffer toPortAddress:aPortAddress];
 }
 
+- (unsigned int)writeDatagrams:(const ONDatagram *)datagrams count:(unsigned int)count;
+{
+    for (unsigned int datagramIndex = 0; datagramIndex < count; datagramIndex++) {
+        const struct sockaddr_storage *address = &datagrams[datagramIndex].address;
+        BOOL isMulticast;
+
+        if (address->ss_family == AF_INET)
+            isMulticast = IN_MULTICAST(ntohl(((const struct sockaddr_in *)address)->sin_addr.s_addr));
+        else if (address->ss_family == AF_INET6)
+            isMulticast = IN6_IS_ADDR_MULTICAST(&(((const struct sockaddr_in6 *)address)->sin6_addr));
+        else
+            isMulticast = (address->ss_family == AF_UNSPEC); // Sent to the connected address, as -writeBytes:fromBuffer: would
+        if (!isMulticast)
+            [NSException raise:ONMulticastSocketNonMulticastAddress format:@"Cannot send datagram %u since its address is not a multicast address", datagramIndex];
+    }
+
+    return [super writeDatagrams:datagrams count:count];
+}
+
 #pragma mark - Private
 
 - _initWithSocketFD:(int)aSocketFD connected:(BOOL)isConnected
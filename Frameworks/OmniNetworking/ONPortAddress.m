@@ -153,6 +153,18 @@ RCS_ID("$Id$")
     return [self isEqualToSocketAddress:[(ONPortAddress *)otherObject portAddress]];
 }
 
+- (NSUInteger)hash;
+{
+    // Consistent with -isEqual:, which compares the whole sockaddr
+    NSUInteger hashValue = portAddress->sa_family;
+    const unsigned char *bytes = (const unsigned char *)portAddress;
+    unsigned int byteIndex;
+
+    for (byteIndex = 0; byteIndex < portAddress->sa_len; byteIndex++)
+        hashValue = hashValue * 31 + bytes[byteIndex];
+    return hashValue;
+}
+
 - (BOOL)isEqualToSocketAddress:(const struct sockaddr *)otherPortAddress
 {
     if (otherPortAddress->sa_family != portAddress->sa_family ||
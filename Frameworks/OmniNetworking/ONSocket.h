@@ -44,6 +44,7 @@
 
 - (NSStringEncoding)stringEncoding;
 - (void)setStringEncoding:(NSStringEncoding)aStringEncoding;
+- (int)readBufferSize;
 - (void)setReadBufferSize:(int)aSize;
 
 @end
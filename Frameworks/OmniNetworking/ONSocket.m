@@ -187,6 +187,11 @@ static unsigned int defaultReadBufferSize = 2048;
     stringEncoding = aStringEncoding;
 }
 
+- (int)readBufferSize;
+{
+    return readBufferSize;
+}
+
 - (void)setReadBufferSize:(int)aSize;
 {
     readBufferSize = aSize;
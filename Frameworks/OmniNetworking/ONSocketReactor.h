@@ -0,0 +1,49 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniBase/OBObject.h>
+
+#import <Foundation/NSDate.h> // For NSTimeInterval
+
+@class NSException;
+@class ONInternetSocket, ONPortAddress, ONTCPSocket;
+
+typedef enum {
+    ONSocketReactorReadable = 1 << 0,
+    ONSocketReactorWritable = 1 << 1,
+    ONSocketReactorTimedOut = 1 << 2,
+} ONSocketReactorEvents;
+
+typedef void (^ONSocketReactorHandler)(ONInternetSocket *socket, ONSocketReactorEvents events);
+
+// Watches many sockets at once with one thread blocked in epoll (on Linux) or kqueue (elsewhere), and calls back on a small pool of threads when they're ready, so that serving lots of connections doesn't take a thread apiece and isn't limited by FD_SETSIZE.
+// Each watch fires once: the handler is called exactly once, for readiness, a timeout, or not at all if the watch is cancelled, and the socket is then no longer watched until the handler (or anyone else) watches it again. So callbacks for one socket never overlap. As with any non-blocking I/O, a handler may occasionally be told a socket is ready when the read or write would still block; it should just watch the socket again.
+// The blocking socket API is unaffected, and works on sockets that a reactor isn't currently watching.
+@interface ONSocketReactor : OBObject
+
++ (ONSocketReactor *)sharedReactor;
+    // Calls back on as many threads as there are active processors.
+
+- initWithCallbackThreadCount:(NSUInteger)threadCount;
+- (void)invalidate;
+    // Stops the reactor's threads. Watches that haven't fired are dropped without calling their handlers.
+
+- (void)watchSocket:(ONInternetSocket *)socket forEvents:(ONSocketReactorEvents)events timeout:(NSTimeInterval)timeout handler:(ONSocketReactorHandler)handler;
+    // Puts the socket in non-blocking mode and calls the handler once it is readable or writable as requested, or with ONSocketReactorTimedOut if that takes longer than timeout (0 for no timeout). Timeouts are accurate to about 10ms. Watching a socket replaces any earlier watch on it, without calling the earlier handler.
+- (void)cancelWatchingSocket:(ONInternetSocket *)socket;
+    // The handler of a watch that hasn't fired yet won't be called. Cancel before closing a watched socket.
+
+// Conveniences built on the above
+- (void)acceptConnectionsOnSocket:(ONTCPSocket *)listeningSocket handler:(void (^)(ONTCPSocket *connection))handler;
+    // Calls the handler with each new connection until the reactor stops watching the listening socket (see -cancelWatchingSocket:). Raises the socket's listen backlog to the system maximum, since a reactor is for serving many clients at once.
+- (void)connectSocket:(ONInternetSocket *)socket toPortAddress:(ONPortAddress *)portAddress timeout:(NSTimeInterval)timeout completionHandler:(void (^)(NSException *exception))completionHandler;
+    // Connects without blocking, then calls the completion handler with nil, or with the exception -connectToPortAddress: would have raised. A timeout is reported as ONInternetSocketConnectTemporarilyFailedExceptionName with ETIMEDOUT.
+
+@end
+
+// Exceptions which may be raised by this class
+extern NSString * const ONSocketReactorFailedExceptionName;
@@ -0,0 +1,594 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniNetworking/ONSocketReactor.h>
+
+#import <Foundation/Foundation.h>
+#import <OmniBase/OmniBase.h>
+#import <OmniBase/system.h>
+
+#import <OmniNetworking/ONInternetSocket.h>
+#import <OmniNetworking/ONPortAddress.h>
+#import <OmniNetworking/ONTCPSocket.h>
+
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#define ON_REACTOR_USES_EPOLL 1
+#include <sys/epoll.h>
+#else
+#define ON_REACTOR_USES_EPOLL 0
+#include <sys/event.h>
+#endif
+
+RCS_ID("$Id$")
+
+#define TIMER_WHEEL_SLOT_COUNT (1024)
+#define TIMER_WHEEL_TICK (0.010)    // seconds per slot, so one turn of the wheel is about ten seconds
+#define EVENT_BATCH_SIZE (256)
+#define ACCEPT_RETRY_DELAY (0.1) // seconds to wait before accepting again when we're out of descriptors
+
+NSString * const ONSocketReactorFailedExceptionName = @"ONSocketReactorFailedExceptionName";
+
+// One watch on one socket
+@interface ONSocketReactorRegistration : NSObject
+{
+@public
+    ONInternetSocket *socket;
+    int fd;
+    ONSocketReactorEvents events;
+    ONSocketReactorHandler handler;
+    ONSocketReactorEvents firedEvents;
+
+    // Timer wheel slot links, when there's a timeout. Not retained; the registration table holds the reference.
+    BOOL hasTimer;
+    uint64_t expirationTick;
+    ONSocketReactorRegistration *timerNext, *timerPrevious;
+}
+@end
+
+@implementation ONSocketReactorRegistration
+
+- (void)dealloc;
+{
+    [socket release];
+    [handler release];
+    [super dealloc];
+}
+
+@end
+
+@implementation ONSocketReactor
+{
+    int pollFD;             // epoll or kqueue descriptor
+    int wakePipe[2];        // Written to when the poller needs to notice something, like a first timeout or -invalidate
+
+    pthread_mutex_t registrationLock;
+    ONSocketReactorRegistration **registrationsByFD;   // Retained; indexed by descriptor
+    int registrationCapacity;
+    ONSocketReactorRegistration *timerWheel[TIMER_WHEEL_SLOT_COUNT];
+    NSUInteger timerCount;
+    uint64_t currentTick;   // Slots up to and including this one have been expired
+    CFAbsoluteTime wheelStartTime;
+
+    pthread_mutex_t callbackLock;
+    pthread_cond_t callbackCondition;
+    NSMutableArray *pendingCallbacks;   // Registrations that have fired, oldest first
+
+    BOOL invalidated;       // Protected by both locks
+}
+
++ (ONSocketReactor *)sharedReactor;
+{
+    static ONSocketReactor *sharedReactor = nil;
+    static dispatch_once_t onceToken;
+
+    dispatch_once(&onceToken, ^{
+        sharedReactor = [[self alloc] initWithCallbackThreadCount:MAX(2U, [[NSProcessInfo processInfo] activeProcessorCount])];
+    });
+    return sharedReactor;
+}
+
+static void _raiseReactorFailure(NSString *what)
+{
+    [NSException raise:ONSocketReactorFailedExceptionName posixErrorNumber:OMNI_ERRNO() format:@"Unable to %@: %s", what, strerror(OMNI_ERRNO())];
+}
+
+- initWithCallbackThreadCount:(NSUInteger)threadCount;
+{
+    OBPRECONDITION(threadCount > 0);
+
+    if (!(self = [super init]))
+        return nil;
+
+    wakePipe[0] = wakePipe[1] = -1;
+#if ON_REACTOR_USES_EPOLL
+    pollFD = epoll_create1(EPOLL_CLOEXEC);
+#else
+    pollFD = kqueue();
+#endif
+    if (pollFD == -1 || pipe(wakePipe) == -1) {
+        [self release];
+        _raiseReactorFailure(@"create the socket reactor's event queue");
+    }
+    fcntl(wakePipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(wakePipe[1], F_SETFL, O_NONBLOCK);
+
+    // Unlike sockets, the wake pipe stays armed.
+#if ON_REACTOR_USES_EPOLL
+    struct epoll_event wakeEvent;
+    memset(&wakeEvent, 0, sizeof(wakeEvent));
+    wakeEvent.events = EPOLLIN;
+    wakeEvent.data.fd = wakePipe[0];
+    if (epoll_ctl(pollFD, EPOLL_CTL_ADD, wakePipe[0], &wakeEvent) == -1) {
+#else
+    struct kevent wakeEvent;
+    EV_SET(&wakeEvent, wakePipe[0], EVFILT_READ, EV_ADD, 0, 0, NULL);
+    if (kevent(pollFD, &wakeEvent, 1, NULL, 0, NULL) == -1) {
+#endif
+        [self release];
+        _raiseReactorFailure(@"watch the socket reactor's wake pipe");
+    }
+
+    pthread_mutex_init(&registrationLock, NULL);
+    pthread_mutex_init(&callbackLock, NULL);
+    pthread_cond_init(&callbackCondition, NULL);
+    pendingCallbacks = [[NSMutableArray alloc] init];
+    wheelStartTime = CFAbsoluteTimeGetCurrent();
+
+    NSThread *pollerThread = [[NSThread alloc] initWithTarget:self selector:@selector(_pollerThreadMain) object:nil];
+    [pollerThread setName:@"ONSocketReactor poller"];
+    [pollerThread start];
+    [pollerThread release];
+    for (NSUInteger threadIndex = 0; threadIndex < threadCount; threadIndex++) {
+        NSThread *callbackThread = [[NSThread alloc] initWithTarget:self selector:@selector(_callbackThreadMain) object:nil];
+        [callbackThread setName:@"ONSocketReactor callbacks"];
+        [callbackThread start];
+        [callbackThread release];
+    }
+
+    return self;
+}
+
+- (void)dealloc;
+{
+    // The threads retain us until -invalidate, so there's nothing registered by now.
+    for (int fd = 0; fd < registrationCapacity; fd++)
+        [registrationsByFD[fd] release];
+    free(registrationsByFD);
+    if (pollFD != -1)
+        close(pollFD);
+    if (wakePipe[0] != -1)
+        close(wakePipe[0]);
+    if (wakePipe[1] != -1)
+        close(wakePipe[1]);
+    [pendingCallbacks release];
+    pthread_mutex_destroy(&registrationLock);
+    pthread_mutex_destroy(&callbackLock);
+    pthread_cond_destroy(&callbackCondition);
+    [super dealloc];
+}
+
+- (void)invalidate;
+{
+    pthread_mutex_lock(&registrationLock);
+    pthread_mutex_lock(&callbackLock);
+    invalidated = YES;
+    pthread_cond_broadcast(&callbackCondition);
+    pthread_mutex_unlock(&callbackLock);
+    pthread_mutex_unlock(&registrationLock);
+
+    [self _wakePoller];
+}
+
+- (void)watchSocket:(ONInternetSocket *)socket forEvents:(ONSocketReactorEvents)events timeout:(NSTimeInterval)timeout handler:(ONSocketReactorHandler)handler;
+{
+    OBPRECONDITION((events & (ONSocketReactorReadable | ONSocketReactorWritable)) != 0);
+    OBPRECONDITION(handler != nil);
+
+    int fd = [socket socketFD];
+    if (fd == -1)
+        [NSException raise:ONInternetSocketNotConnectedExceptionName format:@"Attempted to watch a closed socket"];
+    if (![socket isNonBlocking])
+        [socket setNonBlocking:YES];
+
+    ONSocketReactorRegistration *registration = [[ONSocketReactorRegistration alloc] init];
+    registration->socket = [socket retain];
+    registration->fd = fd;
+    registration->events = events & (ONSocketReactorReadable | ONSocketReactorWritable);
+    registration->handler = [handler copy];
+
+    BOOL shouldWakePoller = NO;
+    pthread_mutex_lock(&registrationLock);
+
+    if (fd >= registrationCapacity) {
+        int newCapacity = MAX(fd + 1, MAX(64, 2 * registrationCapacity));
+        registrationsByFD = reallocf(registrationsByFD, newCapacity * sizeof(*registrationsByFD));
+        memset(registrationsByFD + registrationCapacity, 0, (newCapacity - registrationCapacity) * sizeof(*registrationsByFD));
+        registrationCapacity = newCapacity;
+    }
+    [self _locked_removeRegistration:registrationsByFD[fd]];
+    registrationsByFD[fd] = registration;
+    if (timeout > 0) {
+        shouldWakePoller = (timerCount == 0);
+        uint64_t expirationTick = (uint64_t)ceil((CFAbsoluteTimeGetCurrent() + timeout - wheelStartTime) / TIMER_WHEEL_TICK);
+        [self _locked_addTimer:registration expirationTick:MAX(expirationTick, currentTick + 1)];
+    }
+
+    // Armed while holding the lock so that the poller can't see the event before the registration is in place.
+    if (![self _locked_armDescriptor:fd events:registration->events]) {
+        int armErrno = OMNI_ERRNO();
+        [self _locked_removeRegistration:registration];
+        pthread_mutex_unlock(&registrationLock);
+        [NSException raise:ONSocketReactorFailedExceptionName posixErrorNumber:armErrno format:@"Unable to watch socket: %s", strerror(armErrno)];
+    }
+
+    pthread_mutex_unlock(&registrationLock);
+
+    if (shouldWakePoller)
+        [self _wakePoller];
+}
+
+- (void)cancelWatchingSocket:(ONInternetSocket *)socket;
+{
+    int fd = [socket socketFD];
+    if (fd == -1)
+        return;
+
+    pthread_mutex_lock(&registrationLock);
+    if (fd < registrationCapacity && registrationsByFD[fd] != nil && registrationsByFD[fd]->socket == socket) {
+        [self _locked_disarmDescriptor:fd];
+        [self _locked_removeRegistration:registrationsByFD[fd]];
+    }
+    pthread_mutex_unlock(&registrationLock);
+}
+
+- (void)acceptConnectionsOnSocket:(ONTCPSocket *)listeningSocket handler:(void (^)(ONTCPSocket *connection))handler;
+{
+    if (listen([listeningSocket socketFD], SOMAXCONN) == -1)
+        [NSException raise:ONTCPSocketListenFailedExceptionName posixErrorNumber:OMNI_ERRNO() format:@"Unable to listen on socket: %s", strerror(OMNI_ERRNO())];
+
+    [self _watchForConnectionsOnSocket:listeningSocket handler:[[handler copy] autorelease]];
+}
+
+- (void)connectSocket:(ONInternetSocket *)socket toPortAddress:(ONPortAddress *)portAddress timeout:(NSTimeInterval)timeout completionHandler:(void (^)(NSException *exception))completionHandler;
+{
+    void (^handler)(NSException *) = [[completionHandler copy] autorelease];
+    NSException *exception = nil;
+    BOOL connected = NO;
+
+    NS_DURING {
+        connected = [socket startConnectingToPortAddress:portAddress];
+    } NS_HANDLER {
+        exception = localException;
+    } NS_ENDHANDLER;
+
+    if (exception != nil || connected) {
+        [self _performCallbackForSocket:socket handler:^(ONInternetSocket *connectedSocket, ONSocketReactorEvents events) {
+            handler(exception);
+        }];
+        return;
+    }
+
+    [self watchSocket:socket forEvents:ONSocketReactorWritable timeout:timeout handler:^(ONInternetSocket *connectingSocket, ONSocketReactorEvents events) {
+        NSException *connectException = nil;
+
+        if (events & ONSocketReactorTimedOut) {
+            [connectingSocket abortSocket];
+            connectException = [NSException exceptionWithName:ONInternetSocketConnectTemporarilyFailedExceptionName posixErrorNumber:ETIMEDOUT format:@"Temporarily unable to connect to %@: %s", [portAddress description], strerror(ETIMEDOUT)];
+        } else {
+            NS_DURING {
+                [connectingSocket finishConnectingToPortAddress:portAddress];
+            } NS_HANDLER {
+                connectException = localException;
+            } NS_ENDHANDLER;
+        }
+        handler(connectException);
+    }];
+}
+
+#pragma mark - Private
+
+- (void)_wakePoller;
+{
+    char byte = 0;
+    (void)write(wakePipe[1], &byte, 1); // If the pipe is full, the poller is already going to wake up
+}
+
+- (BOOL)_locked_armDescriptor:(int)fd events:(ONSocketReactorEvents)events;
+{
+#if ON_REACTOR_USES_EPOLL
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLONESHOT | ((events & ONSocketReactorReadable) ? EPOLLIN : 0) | ((events & ONSocketReactorWritable) ? EPOLLOUT : 0);
+    event.data.fd = fd;
+    // Usually the descriptor is still in the set from its last watch, just disarmed.
+    if (epoll_ctl(pollFD, EPOLL_CTL_MOD, fd, &event) == 0)
+        return YES;
+    return OMNI_ERRNO() == ENOENT && epoll_ctl(pollFD, EPOLL_CTL_ADD, fd, &event) == 0;
+#else
+    struct kevent changes[2];
+    int changeCount = 0;
+    if (events & ONSocketReactorReadable)
+        EV_SET(&changes[changeCount++], fd, EVFILT_READ, EV_ADD | EV_ONESHOT, 0, 0, NULL);
+    if (events & ONSocketReactorWritable)
+        EV_SET(&changes[changeCount++], fd, EVFILT_WRITE, EV_ADD | EV_ONESHOT, 0, 0, NULL);
+    return kevent(pollFD, changes, changeCount, NULL, 0, NULL) != -1;
+#endif
+}
+
+- (void)_locked_disarmDescriptor:(int)fd;
+{
+    // Errors just mean there was nothing left to disarm.
+#if ON_REACTOR_USES_EPOLL
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    epoll_ctl(pollFD, EPOLL_CTL_DEL, fd, &event);
+#else
+    struct kevent changes[2];
+    EV_SET(&changes[0], fd, EVFILT_READ, EV_DELETE, 0, 0, NULL);
+    EV_SET(&changes[1], fd, EVFILT_WRITE, EV_DELETE, 0, 0, NULL);
+    kevent(pollFD, &changes[0], 1, NULL, 0, NULL);
+    kevent(pollFD, &changes[1], 1, NULL, 0, NULL);
+#endif
+}
+
+- (void)_locked_addTimer:(ONSocketReactorRegistration *)registration expirationTick:(uint64_t)expirationTick;
+{
+    ONSocketReactorRegistration **slot = &timerWheel[expirationTick % TIMER_WHEEL_SLOT_COUNT];
+
+    registration->hasTimer = YES;
+    registration->expirationTick = expirationTick;
+    registration->timerPrevious = nil;
+    registration->timerNext = *slot;
+    if (*slot != nil)
+        (*slot)->timerPrevious = registration;
+    *slot = registration;
+    timerCount++;
+}
+
+- (void)_locked_removeTimer:(ONSocketReactorRegistration *)registration;
+{
+    if (!registration->hasTimer)
+        return;
+
+    if (registration->timerPrevious != nil)
+        registration->timerPrevious->timerNext = registration->timerNext;
+    else
+        timerWheel[registration->expirationTick % TIMER_WHEEL_SLOT_COUNT] = registration->timerNext;
+    if (registration->timerNext != nil)
+        registration->timerNext->timerPrevious = registration->timerPrevious;
+    registration->timerNext = registration->timerPrevious = nil;
+    registration->hasTimer = NO;
+    timerCount--;
+}
+
+// Takes the registration out of the table and the timer wheel and releases it. Does nothing with nil.
+- (void)_locked_removeRegistration:(ONSocketReactorRegistration *)registration;
+{
+    if (registration == nil)
+        return;
+
+    OBASSERT(registrationsByFD[registration->fd] == registration);
+    [self _locked_removeTimer:registration];
+    registrationsByFD[registration->fd] = nil;
+    [registration release];
+}
+
+// Like -_locked_removeRegistration:, but hands back the registration (retained) for its callback.
+- (ONSocketReactorRegistration *)_locked_takeRegistrationForDescriptor:(int)fd;
+{
+    if (fd < 0 || fd >= registrationCapacity)
+        return nil;
+
+    ONSocketReactorRegistration *registration = registrationsByFD[fd];
+    if (registration == nil)
+        return nil;
+    [self _locked_removeTimer:registration];
+    registrationsByFD[fd] = nil;
+    return registration;
+}
+
+- (int)_locked_pollTimeoutMilliseconds;
+{
+    if (timerCount == 0)
+        return -1;
+
+    CFAbsoluteTime nextTickTime = wheelStartTime + (currentTick + 1) * TIMER_WHEEL_TICK;
+    return (int)MAX(0.0, ceil((nextTickTime - CFAbsoluteTimeGetCurrent()) * 1000.0));
+}
+
+// Moves registrations whose time is up into firedRegistrations.
+- (void)_locked_expireTimersInto:(NSMutableArray *)firedRegistrations;
+{
+    uint64_t nowTick = (uint64_t)floor((CFAbsoluteTimeGetCurrent() - wheelStartTime) / TIMER_WHEEL_TICK);
+    if (nowTick <= currentTick)
+        return;
+
+    if (timerCount != 0) {
+        // If we've fallen a whole turn behind, one look at every slot is enough.
+        uint64_t slotsToVisit = MIN(nowTick - currentTick, (uint64_t)TIMER_WHEEL_SLOT_COUNT);
+        for (uint64_t tick = currentTick + 1; tick <= currentTick + slotsToVisit; tick++) {
+            ONSocketReactorRegistration *registration = timerWheel[tick % TIMER_WHEEL_SLOT_COUNT];
+            while (registration != nil) {
+                ONSocketReactorRegistration *next = registration->timerNext;
+                if (registration->expirationTick <= nowTick) {
+                    [self _locked_disarmDescriptor:registration->fd];
+                    [self _locked_takeRegistrationForDescriptor:registration->fd];
+                    registration->firedEvents = ONSocketReactorTimedOut;
+                    [firedRegistrations addObject:registration];
+                    [registration release];
+                }
+                registration = next;
+            }
+        }
+    }
+    currentTick = nowTick;
+}
+
+- (void)_enqueueCallbacks:(NSArray *)registrations;
+{
+    NSUInteger count = [registrations count];
+    if (count == 0)
+        return;
+
+    pthread_mutex_lock(&callbackLock);
+    [pendingCallbacks addObjectsFromArray:registrations];
+    if (count == 1)
+        pthread_cond_signal(&callbackCondition);
+    else
+        pthread_cond_broadcast(&callbackCondition);
+    pthread_mutex_unlock(&callbackLock);
+}
+
+- (void)_performCallbackForSocket:(ONInternetSocket *)socket handler:(ONSocketReactorHandler)handler;
+{
+    ONSocketReactorRegistration *registration = [[ONSocketReactorRegistration alloc] init];
+    registration->socket = [socket retain];
+    registration->fd = -1;
+    registration->handler = [handler copy];
+    registration->firedEvents = ONSocketReactorWritable;
+    [self _enqueueCallbacks:[NSArray arrayWithObject:registration]];
+    [registration release];
+}
+
+- (void)_watchForConnectionsOnSocket:(ONTCPSocket *)listeningSocket handler:(void (^)(ONTCPSocket *connection))handler;
+{
+    [self watchSocket:listeningSocket forEvents:ONSocketReactorReadable timeout:0 handler:^(ONInternetSocket *socket, ONSocketReactorEvents events) {
+        ONTCPSocket *connection;
+        int acceptErrno = 0;
+
+        // Whatever goes wrong with one connection, keep listening for the next
+        NS_DURING {
+            while ((connection = [listeningSocket acceptAvailableConnectionOnNewSocket]) != nil)
+                handler(connection);
+        } NS_HANDLER {
+            NSLog(@"%@: exception accepting connections on %@: %@", [self shortDescription], [listeningSocket shortDescription], localException);
+            acceptErrno = [localException posixErrorNumber];
+        } NS_ENDHANDLER;
+
+        if (acceptErrno == EMFILE || acceptErrno == ENFILE) {
+            // The connection is still queued, so the listener would be readable again right away. Give other sockets a moment to close first: a listening socket never becomes writable, so this watch just times out (and can be cancelled meanwhile like any other).
+            [self watchSocket:listeningSocket forEvents:ONSocketReactorWritable timeout:ACCEPT_RETRY_DELAY handler:^(ONInternetSocket *retrySocket, ONSocketReactorEvents retryEvents) {
+                [self _watchForConnectionsOnSocket:listeningSocket handler:handler];
+            }];
+        } else
+            [self _watchForConnectionsOnSocket:listeningSocket handler:handler];
+    }];
+}
+
+- (void)_pollerThreadMain;
+{
+#if ON_REACTOR_USES_EPOLL
+    struct epoll_event events[EVENT_BATCH_SIZE];
+#else
+    struct kevent events[EVENT_BATCH_SIZE];
+#endif
+    NSMutableArray *firedRegistrations = [[NSMutableArray alloc] init];
+
+    for (;;) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+        pthread_mutex_lock(&registrationLock);
+        int timeoutMilliseconds = [self _locked_pollTimeoutMilliseconds];
+        pthread_mutex_unlock(&registrationLock);
+
+#if ON_REACTOR_USES_EPOLL
+        int eventCount = epoll_wait(pollFD, events, EVENT_BATCH_SIZE, timeoutMilliseconds);
+#else
+        struct timespec timeout = {timeoutMilliseconds / 1000, (timeoutMilliseconds % 1000) * 1000000L};
+        int eventCount = kevent(pollFD, NULL, 0, events, EVENT_BATCH_SIZE, timeoutMilliseconds < 0 ? NULL : &timeout);
+#endif
+        if (eventCount == -1) {
+            if (OMNI_ERRNO() != EINTR)
+                NSLog(@"%@: error waiting for events: %s", [self shortDescription], strerror(OMNI_ERRNO()));
+            eventCount = 0;
+        }
+
+        pthread_mutex_lock(&registrationLock);
+        if (invalidated) {
+            pthread_mutex_unlock(&registrationLock);
+            [pool release];
+            break;
+        }
+
+        for (int eventIndex = 0; eventIndex < eventCount; eventIndex++) {
+            ONSocketReactorEvents readyEvents = 0;
+#if ON_REACTOR_USES_EPOLL
+            int fd = events[eventIndex].data.fd;
+            uint32_t kernelEvents = events[eventIndex].events;
+            if (kernelEvents & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                readyEvents |= ONSocketReactorReadable;
+            if (kernelEvents & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+                readyEvents |= ONSocketReactorWritable;
+#else
+            int fd = (int)events[eventIndex].ident;
+            if (events[eventIndex].filter == EVFILT_READ)
+                readyEvents = ONSocketReactorReadable;
+            else if (events[eventIndex].filter == EVFILT_WRITE)
+                readyEvents = ONSocketReactorWritable;
+#endif
+            if (fd == wakePipe[0]) {
+                char drain[64];
+                while (read(wakePipe[0], drain, sizeof(drain)) > 0)
+                    ;
+                continue;
+            }
+
+            ONSocketReactorRegistration *registration = [self _locked_takeRegistrationForDescriptor:fd];
+            if (registration == nil)
+                continue; // Cancelled, or already fired from another filter in this batch
+#if !ON_REACTOR_USES_EPOLL
+            // The other filter, if there was one, is still armed.
+            if (registration->events == (ONSocketReactorReadable | ONSocketReactorWritable))
+                [self _locked_disarmDescriptor:fd];
+#endif
+            // Errors and hangups are reported as whatever was asked for, so that the handler's next read or write finds out about them.
+            registration->firedEvents = (readyEvents & registration->events) != 0 ? (readyEvents & registration->events) : registration->events;
+            [firedRegistrations addObject:registration];
+            [registration release];
+        }
+        [self _locked_expireTimersInto:firedRegistrations];
+
+        pthread_mutex_unlock(&registrationLock);
+
+        [self _enqueueCallbacks:firedRegistrations];
+        [firedRegistrations removeAllObjects];
+        [pool release];
+    }
+
+    [firedRegistrations release];
+}
+
+- (void)_callbackThreadMain;
+{
+    for (;;) {
+        pthread_mutex_lock(&callbackLock);
+        while ([pendingCallbacks count] == 0 && !invalidated)
+            pthread_cond_wait(&callbackCondition, &callbackLock);
+        if (invalidated) {
+            pthread_mutex_unlock(&callbackLock);
+            break;
+        }
+        ONSocketReactorRegistration *registration = [[pendingCallbacks objectAtIndex:0] retain];
+        [pendingCallbacks removeObjectAtIndex:0];
+        pthread_mutex_unlock(&callbackLock);
+
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        NS_DURING {
+            registration->handler(registration->socket, registration->firedEvents);
+        } NS_HANDLER {
+            NSLog(@"%@: exception from handler for %@: %@", [self shortDescription], [registration->socket shortDescription], localException);
+        } NS_ENDHANDLER;
+        [registration release];
+        [pool release];
+    }
+}
+
+@end
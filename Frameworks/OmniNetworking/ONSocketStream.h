@@ -50,6 +50,7 @@
 - (NSString *)readLineAndAdvance:(BOOL)shouldAdvance;  // Reads a line and interprets it as a string according to the current string encoding, returning the result. Does not include any trailing EOL characters. Returns nil at EOF.
 - (NSString *)readLine;  // equivalent to readLineAndAdvance:YES
 - (NSString *)peekLine;  // equivalent to readLineAndAdvance:NO
+- (const void *)readLineBytes:(size_t *)outLength;  // Like -readLine, but returns the line's bytes (without EOL) where they sit in the stream's read buffer instead of making a string of them. The bytes are only valid until the next read from the stream. Returns NULL at EOF.
 
 - (void)writeString:(NSString *)aString;
 - (void)writeFormat:(NSString *)aFormat, ... NS_FORMAT_FUNCTION(1,2);
@@ -22,7 +22,10 @@ RCS_ID("$Id$")
 {
     ONSocket *socket;
     
-    NSMutableData *readBuffer;
+    // Bytes read from the socket but not yet consumed are readBytes[readBufferStart..readBufferEnd). Consuming bytes just moves readBufferStart; the unconsumed bytes are moved back to the front only when there isn't room to read more after them.
+    char *readBytes;
+    size_t readBufferCapacity;
+    size_t readBufferStart, readBufferEnd;
     BOOL readBufferContainsEOF;
     
     // BOOL socketPushDisabled;
@@ -32,6 +35,25 @@ RCS_ID("$Id$")
     NSMutableArray *writeBuffer;        // array of NSDatas to write
 }
 
+#define ONSocketStreamMinimumReadSize (4096)
+
+static inline size_t _bufferedLength(ONSocketStream *self)
+{
+    return self->readBufferEnd - self->readBufferStart;
+}
+
+// Returns the offset of the first CR or LF in the given bytes, or length if there is none. The CR search is limited to the bytes before the first LF so that each byte is looked at no more than twice.
+static inline size_t _offsetOfEOLCharacter(const char *bytes, size_t length)
+{
+    const char *lf = memchr(bytes, '\n', length);
+    const char *cr = memchr(bytes, '\r', lf != NULL ? (size_t)(lf - bytes) : length);
+    if (cr != NULL)
+        return cr - bytes;
+    if (lf != NULL)
+        return lf - bytes;
+    return length;
+}
+
 + streamWithSocket:(ONSocket *)aSocket;
 {
     return [[[self alloc] initWithSocket:aSocket] autorelease];
@@ -50,7 +72,7 @@ RCS_ID("$Id$")
 - (void)dealloc;
 {
     [socket release];
-    [readBuffer release];
+    free(readBytes);
     [super dealloc];
 }
 
@@ -62,7 +84,7 @@ RCS_ID("$Id$")
 
 - (BOOL)isReadable;
 {
-    if ([readBuffer length])
+    if (_bufferedLength(self))
         return YES;
     else
         return [socket isReadable];
@@ -70,39 +92,41 @@ RCS_ID("$Id$")
 
 - (void)setReadBuffer:(NSMutableData *)aData;
 {
-    if ((NSData *)readBuffer == aData)
-	return;
-    [readBuffer release];
-    readBuffer = [aData retain];
+    size_t length = [aData length];
+
+    [self clearReadBuffer];
+    [self _makeRoomForLength:length];
+    [aData getBytes:readBytes length:length];
+    readBufferEnd = length;
     readBufferContainsEOF = NO;
 }
 
 - (void)clearReadBuffer;
 {
-    [readBuffer release];
-    readBuffer = [[NSMutableData alloc] init];
+    readBufferStart = readBufferEnd = 0;
 }
 
 - (void)advanceReadBufferBy:(NSUInteger)advanceAmount;
 {
-    NSData *oldReadBuffer;
-
-    oldReadBuffer = readBuffer;
-    readBuffer = [[NSMutableData alloc] initWithBytes:([readBuffer bytes] + advanceAmount) length:([oldReadBuffer length] - advanceAmount)];
-    [oldReadBuffer release];
+    OBPRECONDITION(advanceAmount <= _bufferedLength(self));
+    readBufferStart += advanceAmount;
+    if (readBufferStart == readBufferEnd)
+        readBufferStart = readBufferEnd = 0;
 }
 
 - (BOOL)readSocket;
 {
-    NSData *newData;
-    
-    newData = [socket readData];
-    if (!newData) {
+    size_t readSize = MAX((size_t)[socket readBufferSize], (size_t)ONSocketStreamMinimumReadSize);
+    size_t bytesRead;
+
+    [self _makeRoomForLength:readSize];
+    bytesRead = [socket readBytes:readSize intoBuffer:readBytes + readBufferEnd];
+    if (bytesRead == 0) {
         readBufferContainsEOF = YES;
 	return NO; // End Of File
     }
     readBufferContainsEOF = NO;
-    [readBuffer appendData:newData];
+    readBufferEnd += bytesRead;
     return YES;
 }
 
@@ -124,8 +148,8 @@ RCS_ID("$Id$")
     firstEOLByte = ~0u; // Never read; guarded by searchState==seenNothing
     searchState = seenNothing;
 
-    bytes = [readBuffer bytes];
-    bytesCount = [readBuffer length];
+    bytes = readBytes + readBufferStart;
+    bytesCount = _bufferedLength(self);
     do {
         // See if we need to get more data from the socket. 
         if (byteIndex >= bytesCount) {
@@ -133,23 +157,27 @@ RCS_ID("$Id$")
                 // We've reached EOF without finding an EOL that we're satisfied with. Return what we have.
                 if (eolBytes != NULL)
                     *eolBytes = (searchState == seenNothing) ? 0 : byteIndex - firstEOLByte;
-                return [readBuffer length];
+                return _bufferedLength(self);
             }
             
-            // Update our cached info
-            bytes = [readBuffer bytes];
-            bytesCount = [readBuffer length];
+            // Update our cached info (reading may have moved the buffered bytes)
+            bytes = readBytes + readBufferStart;
+            bytesCount = _bufferedLength(self);
         }
 
         OBINVARIANT( (searchState == seenNothing) ? firstEOLByte == ~0u : firstEOLByte != ~0u );
 
         switch (searchState) {
             case seenNothing:
-                // Look for EOL-like characters.
+                // Skip ahead to the next EOL-like character, if there is one in what we have so far.
+                byteIndex += _offsetOfEOLCharacter(bytes + byteIndex, bytesCount - byteIndex);
+                if (byteIndex == bytesCount)
+                    continue;
                 if (bytes[byteIndex] == '\n') {
                     searchState = seenLF;
                     firstEOLByte = byteIndex;
-                } else if(bytes[byteIndex] == '\r') {
+                } else {
+                    OBASSERT(bytes[byteIndex] == '\r');
                     searchState = seenCR;
                     firstEOLByte = byteIndex;
                 }
@@ -203,6 +231,30 @@ RCS_ID("$Id$")
     return byteIndex;
 }
 
+- (const void *)readLineBytes:(size_t *)outLength;
+{
+    size_t lineLength, eolLength;
+    const void *lineBytes;
+
+    lineLength = [self getLengthOfNextLine:&eolLength];
+    OBASSERT(eolLength <= lineLength);
+    OBASSERT(lineLength <= _bufferedLength(self));
+
+    if (lineLength == 0) {
+        // As in -readLineAndAdvance:, consume the EOF marker
+        OBASSERT(readBufferContainsEOF);
+        readBufferContainsEOF = NO;
+        *outLength = 0;
+        return NULL;
+    }
+
+    // Advancing doesn't touch the bytes, so they stay put until the next read refills the buffer.
+    lineBytes = readBytes + readBufferStart;
+    *outLength = lineLength - eolLength;
+    [self advanceReadBufferBy:lineLength];
+    return lineBytes;
+}
+
 - (NSString *)readLineAndAdvance:(BOOL)shouldAdvance;
 {
     size_t lineLength, eolLength;
@@ -212,7 +264,7 @@ RCS_ID("$Id$")
 
     lineLength = [self getLengthOfNextLine:&eolLength];
     OBASSERT(eolLength <= lineLength);
-    OBASSERT(lineLength <= [readBuffer length]);
+    OBASSERT(lineLength <= _bufferedLength(self));
 
     // At EOF, we'll see a zero-length line, since we treat EOF as a valid EOL character.
     if (lineLength == 0) {
@@ -225,10 +277,10 @@ RCS_ID("$Id$")
     }
 
     // We want to return a result that doesn't contain the EOL character(s).
-    // We use the CF interface here to create a string without copying the bytes an extra time.
+    // We use the CF interface here to create a string straight from the read buffer.
     cfEncoding = CFStringConvertNSStringEncodingToEncoding([self stringEncoding]);
     cfString = CFStringCreateWithBytes(kCFAllocatorDefault,
-                                       (void *)[readBuffer bytes],
+                                       (const UInt8 *)readBytes + readBufferStart,
                                        lineLength - eolLength,
                                        cfEncoding, 1);
     resultString = [(NSString *)cfString autorelease];
@@ -251,32 +303,25 @@ RCS_ID("$Id$")
 
 - (NSData *)readData;
 {
-    NSData *data;
-
-    if ([readBuffer length] == 0) {
+    if (_bufferedLength(self) == 0) {
 	if (![self readSocket])
 	    return nil;
     }
-    data = [[readBuffer retain] autorelease];
-    [self clearReadBuffer];
-    return data;
+    return [self _takeBufferedData];
 }
 
 - (NSData *)readDataWithMaxLength:(NSUInteger)length;
 {
     NSData *result;
 
-    if (![readBuffer length])
+    if (!_bufferedLength(self))
         if (![self readSocket])
             return nil;
     
-    if ([readBuffer length] <= length) {
-        result = [readBuffer retain];
-        [self clearReadBuffer];
-
-        return [result autorelease];
+    if (_bufferedLength(self) <= length) {
+        return [self _takeBufferedData];
     } else  {
-        result = [readBuffer subdataWithRange:NSMakeRange(0, length)];
+        result = [NSData dataWithBytes:readBytes + readBufferStart length:length];
         [self advanceReadBufferBy:length];
 
         return result;
@@ -288,13 +333,11 @@ RCS_ID("$Id$")
     NSData *result;
     NSUInteger readBufferLength;
 
-    readBufferLength = [readBuffer length];
+    readBufferLength = _bufferedLength(self);
     if (readBufferLength == length) {
-        result = [readBuffer retain];
-        [self clearReadBuffer];
-        return [result autorelease];
+        return [self _takeBufferedData];
     } else if (readBufferLength > length) {
-        result = [readBuffer subdataWithRange:NSMakeRange(0, length)];
+        result = [NSData dataWithBytes:readBytes + readBufferStart length:length];
         [self advanceReadBufferBy:length];
         return result;
     } else {
@@ -302,13 +345,15 @@ RCS_ID("$Id$")
         unsigned char *mutableBytes;
         size_t remainingByteCount;
 
-        mutableBuffer = [[NSMutableData alloc] initWithCapacity:length];
-        [mutableBuffer appendData:readBuffer];
-        [mutableBuffer setLength:length];
+        mutableBuffer = [[NSMutableData alloc] initWithLength:length];
+        mutableBytes = [mutableBuffer mutableBytes];
+        if (readBufferLength != 0)
+            memcpy(mutableBytes, readBytes + readBufferStart, readBufferLength);
 
         [self clearReadBuffer];
 
-        mutableBytes = [mutableBuffer mutableBytes] + readBufferLength;
+        // The rest goes straight from the socket into the result.
+        mutableBytes += readBufferLength;
         remainingByteCount = length - readBufferLength;
         while (remainingByteCount != 0) {
             size_t lengthRead = [socket readBytes:remainingByteCount intoBuffer:mutableBytes];
@@ -323,13 +368,10 @@ RCS_ID("$Id$")
 {
     size_t readBufferLength;
     
-    if ((readBufferLength = [readBuffer length]) != 0) {
+    if ((readBufferLength = _bufferedLength(self)) != 0) {
         length = MIN(readBufferLength, length);
-        [readBuffer getBytes:buffer length:length];
-        if (readBufferLength == length)
-            [self clearReadBuffer];
-        else
-            [self advanceReadBufferBy:length];
+        memcpy(buffer, readBytes + readBufferStart, length);
+        [self advanceReadBufferBy:length];
         return length;
     } else {
         return [socket readBytes:length intoBuffer:buffer];
@@ -349,7 +391,7 @@ RCS_ID("$Id$")
 {
     NSUInteger readBufferLength;
     
-    if ((readBufferLength = [readBuffer length]) != 0) {
+    if ((readBufferLength = _bufferedLength(self)) != 0) {
         if (length > readBufferLength) {
             [self clearReadBuffer];
             length -= readBufferLength;
@@ -465,14 +507,55 @@ RCS_ID("$Id$")
     debugDictionary = [super debugDictionary];
     if (socket)
 	[debugDictionary setObject:socket forKey:@"socket"];
-    if (readBuffer)
-	[debugDictionary setObject:readBuffer forKey:@"readBuffer"];
+    [debugDictionary setObject:[NSNumber numberWithUnsignedLong:_bufferedLength(self)] forKey:@"bufferedLength"];
 
     return debugDictionary;
 }
 
 #pragma mark - Private
 
+// Makes sure at least length bytes can be read in after the buffered ones, moving them to the front of the buffer or growing it as needed.
+- (void)_makeRoomForLength:(size_t)length;
+{
+    if (readBufferCapacity - readBufferEnd >= length)
+        return;
+
+    size_t bufferedLength = _bufferedLength(self);
+    if (readBufferStart != 0) {
+        memmove(readBytes, readBytes + readBufferStart, bufferedLength);
+        readBufferStart = 0;
+        readBufferEnd = bufferedLength;
+        if (readBufferCapacity - readBufferEnd >= length)
+            return;
+    }
+
+    // Leave room for one more read after this one, so that a line which is about to straddle the end of the buffer only gets moved once.
+    readBufferCapacity = MAX(2 * readBufferCapacity, bufferedLength + 2 * length);
+    readBytes = reallocf(readBytes, readBufferCapacity);
+    if (readBytes == NULL)
+        [NSException raise:NSMallocException format:@"Unable to allocate %lu bytes for socket read buffer", readBufferCapacity];
+}
+
+// Returns everything buffered. When the buffered bytes start at the front of the buffer, the buffer itself is handed to the result rather than copied, and a new one is allocated on the next read.
+- (NSData *)_takeBufferedData;
+{
+    size_t bufferedLength = _bufferedLength(self);
+    NSData *result;
+
+    if (readBufferStart == 0 && bufferedLength != 0) {
+        char *bytes = readBytes;
+        if (readBufferCapacity - bufferedLength >= ONSocketStreamMinimumReadSize)
+            bytes = reallocf(bytes, bufferedLength); // Don't hand out a mostly-empty buffer
+        result = [NSData dataWithBytesNoCopy:bytes length:bufferedLength freeWhenDone:YES];
+        readBytes = NULL;
+        readBufferCapacity = 0;
+    } else {
+        result = [NSData dataWithBytes:readBytes + readBufferStart length:bufferedLength];
+    }
+    [self clearReadBuffer];
+    return result;
+}
+
 // UIO_MAXIOV is documented in writev(2), but <sys/uio.h> only declares it if defined(KERNEL)
 #ifndef UIO_MAXIOV
 #define UIO_MAXIOV 512
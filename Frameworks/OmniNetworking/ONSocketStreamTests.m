@@ -191,5 +191,67 @@ static void *feedData(void *arg)
     [self testDataInAllPermutations:[NSData dataWithBytes:blankCRCRLFline length:strlen(blankCRCRLFline)] expectResults:lines];
 }
 
+- (void)testLineBytes
+{
+    const char *lineData = "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello";
+    ONSocketStream *readStream = [[ONSocketStream alloc] initWithSocket:[self socketProducingData:[NSData dataWithBytes:lineData length:strlen(lineData)] withDelays:YES]];
+    const char *lineBytes;
+    size_t lineLength;
+
+    lineBytes = [readStream readLineBytes:&lineLength];
+    XCTAssertTrue(lineBytes != NULL && lineLength == 15 && memcmp(lineBytes, "HTTP/1.1 200 OK", 15) == 0);
+    lineBytes = [readStream readLineBytes:&lineLength];
+    XCTAssertTrue(lineBytes != NULL && lineLength == 17 && memcmp(lineBytes, "Content-Length: 5", 17) == 0);
+    lineBytes = [readStream readLineBytes:&lineLength];
+    XCTAssertTrue(lineBytes != NULL && lineLength == 0);
+    lineBytes = [readStream readLineBytes:&lineLength];
+    XCTAssertTrue(lineBytes != NULL && lineLength == 5 && memcmp(lineBytes, "hello", 5) == 0);
+    XCTAssertTrue([readStream readLineBytes:&lineLength] == NULL);
+
+    [readStream release];
+    [self joinWriter];
+}
+
+// Lines and data interleaved, as in a chunked HTTP body, with the buffer refilled and compacted many times along the way.
+- (void)testMixedReads
+{
+    NSMutableData *buf = [NSMutableData data];
+    NSUInteger chunkCount = 2000;
+    for (NSUInteger chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++) {
+        NSUInteger chunkLength = 1 + (chunkIndex * 37) % 300;
+        [buf appendData:[[NSString stringWithFormat:@"%lx\r\n", chunkLength] dataUsingEncoding:NSASCIIStringEncoding]];
+        for (NSUInteger byteIndex = 0; byteIndex < chunkLength; byteIndex++) {
+            char byte = 'a' + (chunkIndex + byteIndex) % 26;
+            [buf appendBytes:&byte length:1];
+        }
+        [buf appendBytes:"\r\n" length:2];
+    }
+    [buf appendBytes:"0\r\n" length:3];
+
+    ONSocketStream *readStream = [[ONSocketStream alloc] initWithSocket:[self socketProducingData:buf withDelays:NO]];
+    for (NSUInteger chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++) {
+        NSUInteger chunkLength = 1 + (chunkIndex * 37) % 300;
+        NSString *sizeLine = [readStream readLine];
+        XCTAssertEqualObjects(sizeLine, ([NSString stringWithFormat:@"%lx", chunkLength]));
+
+        NSData *chunk;
+        if (chunkIndex % 2 == 0) {
+            chunk = [readStream readDataOfLength:chunkLength];
+        } else {
+            char bytes[300];
+            [readStream readBytesOfLength:chunkLength intoBuffer:bytes];
+            chunk = [NSData dataWithBytes:bytes length:chunkLength];
+        }
+        XCTAssertEqual([chunk length], chunkLength);
+        XCTAssertEqual(((const char *)[chunk bytes])[chunkLength - 1], (char)('a' + (chunkIndex + chunkLength - 1) % 26));
+        XCTAssertEqualObjects([readStream readLine], @"");
+    }
+    XCTAssertEqualObjects([readStream readLine], @"0");
+    XCTAssertNil([readStream readLine]);
+
+    [readStream release];
+    [self joinWriter];
+}
+
 @end
 
@@ -16,6 +16,18 @@
 
 - initWithTCPSocket:(ONSocket *)aSocket;
 
+// Each packet goes out as a length header and its bytes in a single gather write. Incoming bytes are read into a buffer in large chunks, so when packets arrive close together several of them are picked up per read.
+
+// Writes several packets with as few gather writes as possible. Returns the number of packets sent (or, for the last one, partly sent with the rest held back to go out ahead of the next write), which is less than packetCount only if the socket stopped taking bytes.
+- (unsigned int)writePackets:(const struct iovec *)packets count:(unsigned int)packetCount;
+
+// Waits for at least one packet, as -readBytes:intoBuffer: does, then returns up to maximumCount of the packets which have arrived without reading any further. The packets point into the receiver's read buffer and are only valid until the next read. Returns 0 at EOF. Raises ONTCPDatagramSocketPacketTooLargeExceptionName, leaving the packet unread, if the next one is longer than 16MB.
+- (unsigned int)readPackets:(struct iovec *)packets maximumCount:(unsigned int)maximumCount;
+
+// Write buffering. While buffering, written packets are queued and sent together once buffering is turned off (or once enough of them pile up). beginBuffering/endBuffering calls must be properly balanced.
+- (void)beginBuffering;
+- (void)endBuffering;
+
 @end
 
 // Exceptions which may be raised by this class
@@ -10,20 +10,41 @@
 #import <Foundation/Foundation.h>
 #import <OmniBase/OmniBase.h>
 #import <OmniNetworking/ONTCPSocket.h>
+#include <sys/uio.h>
 
 RCS_ID("$Id$")
 
 @implementation ONTCPDatagramSocket
 {
     ONSocket *socket;
-    void *writeRemainder;
-    size_t writeLength;
-    size_t writePosition;
-    void *readRemainder;
-    uint32_t readPacketLength;
-    size_t readLength;
+
+    // Bytes waiting to go out are writeQueue[writeQueueStart..writeQueueEnd): whole packets queued while buffering, or the rest of a packet the socket only took part of.
+    char *writeQueue;
+    size_t writeQueueCapacity;
+    size_t writeQueueStart, writeQueueEnd;
+    unsigned int writeBufferingCount;   // count of nested -beginBuffering / -endBuffering calls
+
+    // Bytes read from the socket but not yet returned as packets are readBuffer[readBufferStart..readBufferEnd).
+    char *readBuffer;
+    size_t readBufferCapacity;
+    size_t readBufferStart, readBufferEnd;
 }
 
+// Originally, packets were headed by sizeof(unsigned int) bytes; but that can vary.
+#define PKT_HDR_LEN 4
+
+#define ONTCPDatagramSocketMinimumReadSize (16384)
+#define ONTCPDatagramSocketMaximumReadPacketLength (16 * 1024 * 1024) // For -readPackets:maximumCount:, which has no caller's buffer to go by
+#define ONTCPDatagramSocketWriteQueueThreshold (65536) // Queued packets are sent once there are this many bytes of them, even while buffering
+
+// Batches up to this size are framed without going to the heap
+#define ONTCPDatagramSocketStackPacketCount (32)
+
+// UIO_MAXIOV is documented in writev(2), but <sys/uio.h> only declares it if defined(KERNEL)
+#ifndef UIO_MAXIOV
+#define UIO_MAXIOV 512
+#endif
+
 - initWithTCPSocket:(ONSocket *)aSocket;
 {
     if (!(self = [super init]))
@@ -37,143 +58,280 @@ RCS_ID("$Id$")
 - (void)dealloc;
 {
     [socket release];
+    free(writeQueue);
+    free(readBuffer);
     [super dealloc];
 }
 
 //
 
-// Originally, packets were headed by sizeof(unsigned int) bytes; but that can vary.
-#define PKT_HDR_LEN 4
-
 - (size_t)readBytes:(size_t)byteCount intoBuffer:(void *)aBuffer;
 {
-    // read the packet length - if the socket raises we already have all the state we need to continue later
-    if (readLength < PKT_HDR_LEN) {
-        while (readLength < PKT_HDR_LEN) {
-            size_t bytesRead;
+    size_t packetLength;
+    const char *packet = [self _readPacket:&packetLength maximumLength:byteCount];
+    if (packet == NULL)
+        return 0;
 
-            bytesRead = [socket readBytes:(PKT_HDR_LEN - readLength) intoBuffer:((void *)&readPacketLength) + readLength];
-            if (bytesRead == 0)
-                return 0;
-            readLength += bytesRead;
-        }
-        readPacketLength = OSSwapBigToHostInt32(readPacketLength);
-    }
+    memcpy(aBuffer, packet, packetLength);
+    readBufferStart += PKT_HDR_LEN + packetLength;
+    return packetLength;
+}
 
-    // check to see that the buffer is big enough for the packet
-    if (byteCount < readPacketLength)
-        [NSException raise:ONTCPDatagramSocketPacketTooLargeExceptionName format:@"Attempted to read a packet with a buffer that is too small"];
+- (size_t)writeBytes:(size_t)byteCount fromBuffer:(const void *)aBuffer;
+{
+    struct iovec packet;
 
-    // read the packet
-    size_t totalBytesRead = readLength - PKT_HDR_LEN;
-    size_t start = totalBytesRead;
-    @try {
-        while (totalBytesRead < readPacketLength) {
-            size_t bytesRead = [socket readBytes:(readPacketLength - totalBytesRead) intoBuffer:(aBuffer + totalBytesRead)];
-            if (bytesRead == 0)
-                return 0;
-            totalBytesRead += bytesRead;
-        }
-    } @catch (NSException *raisedException) {
-        // if we got a partial packet save it to try more later
-        if (totalBytesRead != start) {
-            if (!readRemainder)
-                readRemainder = malloc(readPacketLength);
-            memcpy(readRemainder + start, aBuffer + start, totalBytesRead - start);
-        }
-        readLength = totalBytesRead + PKT_HDR_LEN;
-        [raisedException raise];
+    packet.iov_base = (void *)aBuffer;
+    packet.iov_len = byteCount;
+    return [self writePackets:&packet count:1] != 0 ? byteCount : 0;
+}
+
+- (void)abortSocket;
+{
+    [socket abortSocket];
+}
+
+- (BOOL)isReadable;
+{
+    size_t packetLength;
+    return [self _bufferedPacket:&packetLength] != NULL || [socket isReadable];
+}
+
+- (BOOL)isWritable;
+{
+    return [socket isWritable];
+}
+
+- (unsigned int)writePackets:(const struct iovec *)packets count:(unsigned int)packetCount;
+{
+    unsigned int packetIndex;
+
+    for (packetIndex = 0; packetIndex < packetCount; packetIndex++) {
+        if (packets[packetIndex].iov_len > 0xFFFFFFFFU)
+            [NSException raise:ONTCPDatagramSocketPacketTooLargeExceptionName format:@"Attempted to write a packet that's longer than 2^32-1 bytes"];
     }
-    
-    // copy previously saved partial packet into the buffer
-    if (readRemainder) {
-        memcpy(aBuffer, readRemainder, readLength - PKT_HDR_LEN);
-        free(readRemainder);
+
+    if (writeBufferingCount == 0)
+        return [self _sendPackets:packets count:packetCount];
+
+    for (packetIndex = 0; packetIndex < packetCount; packetIndex++) {
+        uint32_t header = OSSwapHostToBigInt32((uint32_t)packets[packetIndex].iov_len);
+        [self _queueBytes:&header length:PKT_HDR_LEN];
+        [self _queueBytes:packets[packetIndex].iov_base length:packets[packetIndex].iov_len];
     }
-    readLength = 0;
-    return readPacketLength;
+    if (writeQueueEnd - writeQueueStart >= ONTCPDatagramSocketWriteQueueThreshold)
+        [self _sendPackets:NULL count:0];
+    return packetCount;
 }
 
-- (size_t)writeBytes:(size_t)byteCount fromBuffer:(const void *)aBuffer;
+- (unsigned int)readPackets:(struct iovec *)packets maximumCount:(unsigned int)maximumCount;
 {
-    size_t position, packetLength;
-    
-    // finish writing a previous packet - if this raises we'll continue with the old packet again later, and the one we are called with now is lost
-    if (writeRemainder) {
-        while (writePosition < writeLength) {
-            size_t bytesWritten;
+    unsigned int packetCount = 0;
+    size_t packetLength;
 
-            bytesWritten = [socket writeBytes:(writeLength - writePosition) fromBuffer:(writeRemainder + writePosition)];
-            if (bytesWritten == 0)
-                return 0;
-            writePosition += bytesWritten;
-        }
-        free(writeRemainder);
-    }
+    if (maximumCount == 0)
+        return 0;
 
-    if (byteCount > 0xFFFFFFFFU) {
-        [NSException raise:ONTCPDatagramSocketPacketTooLargeExceptionName format:@"Attempted to write a packet that's longer than 2^32-1 bytes"];
+    const char *packet = [self _readPacket:&packetLength maximumLength:ONTCPDatagramSocketMaximumReadPacketLength];
+    while (packet != NULL) {
+        packets[packetCount].iov_base = (void *)packet;
+        packets[packetCount].iov_len = packetLength;
+        readBufferStart += PKT_HDR_LEN + packetLength;
+        if (++packetCount == maximumCount)
+            break;
+        packet = [self _bufferedPacket:&packetLength];
     }
-    
-    // write the length of this packet
-    packetLength = OSSwapHostToBigInt32((uint32_t)byteCount);
-    position = 0;
-    NS_DURING {
-        while (position < PKT_HDR_LEN) {
-            size_t bytesWritten;
-
-            bytesWritten = [socket writeBytes:(PKT_HDR_LEN - position) fromBuffer:((void *)(&packetLength)) + position];
-            if (bytesWritten == 0)
-                NS_VALUERETURN(0, unsigned int);
-            position += bytesWritten;
-        }
-    } NS_HANDLER {
-        // didn't finish the length - if we wrote nothing just discard this packet, otherwise save it
-        if (position) {
-            writeRemainder = malloc(byteCount + PKT_HDR_LEN);
-            memcpy(writeRemainder, &packetLength, PKT_HDR_LEN);
-            memcpy(writeRemainder + PKT_HDR_LEN, aBuffer, byteCount);
-            writeLength = byteCount + PKT_HDR_LEN;
-            writePosition = position;
-        }
-        [localException raise];
-    } NS_ENDHANDLER;
+    return packetCount;
+}
+
+- (void)beginBuffering;
+{
+    writeBufferingCount++;
+}
 
-    // write the packet data itself
-    NS_DURING {
-        position = 0;
-        while (position < byteCount) {
-            size_t bytesWritten;
+- (void)endBuffering;
+{
+    if (writeBufferingCount == 0)
+        [NSException raise:NSInternalInconsistencyException format:@"-[%@ %@] called too many times", [self shortDescription], NSStringFromSelector(_cmd)];
 
-            bytesWritten = [socket writeBytes:(byteCount - position) fromBuffer:(aBuffer + position)];
-            if (bytesWritten == 0)
-                NS_VALUERETURN(0, unsigned int);
-            position += bytesWritten;
-        }        
-    } NS_HANDLER {
-        writeLength = byteCount - position;
-        writeRemainder = malloc(writeLength);
-        memcpy(writeRemainder, aBuffer + position, writeLength);
-        writePosition = 0;
-        [localException raise];
-    } NS_ENDHANDLER;
+    if (--writeBufferingCount == 0 && writeQueueEnd != writeQueueStart)
+        [self _sendPackets:NULL count:0];
+}
+
+#pragma mark - Private
 
-    return byteCount;
+// Returns the bytes of the next packet if all of it has been read, and NULL otherwise.
+- (const char *)_bufferedPacket:(size_t *)outLength;
+{
+    uint32_t packetLength;
+
+    if (readBufferEnd - readBufferStart < PKT_HDR_LEN)
+        return NULL;
+    memcpy(&packetLength, readBuffer + readBufferStart, PKT_HDR_LEN);
+    packetLength = OSSwapBigToHostInt32(packetLength);
+    if (readBufferEnd - readBufferStart - PKT_HDR_LEN < packetLength)
+        return NULL;
+    *outLength = packetLength;
+    return readBuffer + readBufferStart + PKT_HDR_LEN;
 }
 
-- (void)abortSocket;
+static void _raisePacketTooLarge(size_t packetLength, size_t maximumLength)
 {
-    [socket abortSocket];
+    [NSException raise:ONTCPDatagramSocketPacketTooLargeExceptionName format:@"Attempted to read a packet of %lu bytes with room for only %lu", packetLength, maximumLength];
 }
 
-- (BOOL)isReadable;
+// Reads until all of the next packet is in the buffer and returns its bytes, or NULL at EOF. A packet longer than maximumLength raises as soon as its header is in, before the buffer grows to hold it, and stays put for a later read with more room. If the socket raises, whatever was read stays buffered for next time.
+- (const char *)_readPacket:(size_t *)outLength maximumLength:(size_t)maximumLength;
 {
-    return [socket isReadable];
+    const char *packet;
+
+    while ((packet = [self _bufferedPacket:outLength]) == NULL) {
+        size_t bufferedLength = readBufferEnd - readBufferStart;
+        size_t neededLength = PKT_HDR_LEN;
+        if (bufferedLength >= PKT_HDR_LEN) {
+            uint32_t packetLength;
+            memcpy(&packetLength, readBuffer + readBufferStart, PKT_HDR_LEN);
+            packetLength = OSSwapBigToHostInt32(packetLength);
+            if (packetLength > maximumLength)
+                _raisePacketTooLarge(packetLength, maximumLength);
+            neededLength += packetLength;
+        }
+        [self _makeRoomForLength:MAX(neededLength - bufferedLength, (size_t)ONTCPDatagramSocketMinimumReadSize)];
+
+        size_t bytesRead = [socket readBytes:(readBufferCapacity - readBufferEnd) intoBuffer:(readBuffer + readBufferEnd)];
+        if (bytesRead == 0)
+            return NULL;
+        readBufferEnd += bytesRead;
+    }
+    if (*outLength > maximumLength)
+        _raisePacketTooLarge(*outLength, maximumLength);
+    return packet;
 }
 
-- (BOOL)isWritable;
+// Makes sure at least length bytes can be read in after the buffered ones, moving them to the front of the buffer or growing it as needed.
+- (void)_makeRoomForLength:(size_t)length;
 {
-    return [socket isWritable];
+    size_t bufferedLength = readBufferEnd - readBufferStart;
+
+    if (readBufferCapacity - readBufferEnd >= length)
+        return;
+
+    if (readBufferStart != 0) {
+        memmove(readBuffer, readBuffer + readBufferStart, bufferedLength);
+        readBufferStart = 0;
+        readBufferEnd = bufferedLength;
+        if (readBufferCapacity - readBufferEnd >= length)
+            return;
+    }
+
+    readBufferCapacity = MAX(2 * readBufferCapacity, bufferedLength + length);
+    readBuffer = reallocf(readBuffer, readBufferCapacity);
+    if (readBuffer == NULL)
+        [NSException raise:NSMallocException format:@"Unable to allocate %lu bytes for packet read buffer", readBufferCapacity];
+}
+
+- (void)_queueBytes:(const void *)bytes length:(size_t)length;
+{
+    size_t queuedLength = writeQueueEnd - writeQueueStart;
+
+    if (writeQueueCapacity - writeQueueEnd < length) {
+        if (writeQueueStart != 0) {
+            memmove(writeQueue, writeQueue + writeQueueStart, queuedLength);
+            writeQueueStart = 0;
+            writeQueueEnd = queuedLength;
+        }
+        if (writeQueueCapacity - writeQueueEnd < length) {
+            writeQueueCapacity = MAX(2 * writeQueueCapacity, queuedLength + length);
+            writeQueue = reallocf(writeQueue, writeQueueCapacity);
+            if (writeQueue == NULL)
+                [NSException raise:NSMallocException format:@"Unable to allocate %lu bytes for packet write queue", writeQueueCapacity];
+        }
+    }
+    memcpy(writeQueue + writeQueueEnd, bytes, length);
+    writeQueueEnd += length;
+}
+
+// Sends anything queued followed by the given packets, framed, in as few gather writes as possible. Queued bytes stay queued until they have been sent. If the socket stops taking bytes partway through one of the given packets, the rest of that packet is queued so the framing stays intact; packets which weren't started are dropped, as an unsent packet always has been. Returns the number of given packets which were sent or queued.
+- (unsigned int)_sendPackets:(const struct iovec *)packets count:(unsigned int)packetCount;
+{
+    uint32_t stackHeaders[ONTCPDatagramSocketStackPacketCount];
+    struct iovec stackVectors[1 + 2 * ONTCPDatagramSocketStackPacketCount];
+    uint32_t *headers = stackHeaders;
+    struct iovec *vectors = stackVectors;
+    unsigned int vectorCount = 0, vectorIndex = 0, packetIndex;
+    size_t queuedLength = writeQueueEnd - writeQueueStart;
+    size_t totalBytesWritten = 0;
+    NSException *raisedException = nil;
+
+    if (packetCount > ONTCPDatagramSocketStackPacketCount) {
+        headers = malloc(sizeof(*headers) * packetCount);
+        vectors = malloc(sizeof(*vectors) * (1 + 2 * (size_t)packetCount));
+    }
+
+    if (queuedLength != 0) {
+        vectors[vectorCount].iov_base = writeQueue + writeQueueStart;
+        vectors[vectorCount].iov_len = queuedLength;
+        vectorCount++;
+    }
+    for (packetIndex = 0; packetIndex < packetCount; packetIndex++) {
+        headers[packetIndex] = OSSwapHostToBigInt32((uint32_t)packets[packetIndex].iov_len);
+        vectors[vectorCount].iov_base = &headers[packetIndex];
+        vectors[vectorCount].iov_len = PKT_HDR_LEN;
+        vectorCount++;
+        vectors[vectorCount] = packets[packetIndex];
+        vectorCount++;
+    }
+
+    @try {
+        while (vectorIndex < vectorCount) {
+            size_t bytesWritten = [socket writeBuffers:(vectors + vectorIndex) count:MIN(vectorCount - vectorIndex, (unsigned int)UIO_MAXIOV)];
+            if (bytesWritten == 0)
+                break;
+            totalBytesWritten += bytesWritten;
+
+            // Step past whatever was written
+            while (vectorIndex < vectorCount && bytesWritten >= vectors[vectorIndex].iov_len) {
+                bytesWritten -= vectors[vectorIndex].iov_len;
+                vectorIndex++;
+            }
+            if (bytesWritten != 0) {
+                vectors[vectorIndex].iov_base += bytesWritten;
+                vectors[vectorIndex].iov_len -= bytesWritten;
+            }
+        }
+    } @catch (NSException *exception) {
+        raisedException = exception;
+    }
+
+    // Account for what went out: first the queue, then the given packets in order
+    size_t bytesFromQueue = MIN(totalBytesWritten, queuedLength);
+    writeQueueStart += bytesFromQueue;
+    if (writeQueueStart == writeQueueEnd)
+        writeQueueStart = writeQueueEnd = 0;
+
+    size_t bytesLeft = totalBytesWritten - bytesFromQueue;
+    for (packetIndex = 0; packetIndex < packetCount; packetIndex++) {
+        size_t frameLength = PKT_HDR_LEN + packets[packetIndex].iov_len;
+        if (bytesLeft < frameLength) {
+            if (bytesLeft != 0) {
+                if (bytesLeft < PKT_HDR_LEN)
+                    [self _queueBytes:((char *)&headers[packetIndex] + bytesLeft) length:(PKT_HDR_LEN - bytesLeft)];
+                size_t bodyOffset = bytesLeft > PKT_HDR_LEN ? bytesLeft - PKT_HDR_LEN : 0;
+                [self _queueBytes:((const char *)packets[packetIndex].iov_base + bodyOffset) length:(packets[packetIndex].iov_len - bodyOffset)];
+                packetIndex++;
+            }
+            break;
+        }
+        bytesLeft -= frameLength;
+    }
+
+    if (headers != stackHeaders) {
+        free(headers);
+        free(vectors);
+    }
+    if (raisedException != nil)
+        [raisedException raise];
+    return packetIndex;
 }
 
 @end
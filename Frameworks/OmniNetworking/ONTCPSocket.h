@@ -23,6 +23,19 @@
 - (void)acceptConnection;
 - (ONTCPSocket *)acceptConnectionOnNewSocket;
 
+// Non-blocking I/O. These are for sockets in non-blocking mode (see -setNonBlocking: and ONSocketReactor): where the blocking methods would raise ONTCPSocketWouldBlockExceptionName, these return NO instead. A read of zero bytes that returns YES means end of file.
+- (BOOL)readAvailableBytes:(size_t)byteCount intoBuffer:(void *)aBuffer bytesRead:(size_t *)outBytesRead;
+- (BOOL)writeAvailableBuffers:(const struct iovec *)buffers count:(unsigned int)num_iov bytesWritten:(size_t *)outBytesWritten;
+- (ONTCPSocket *)acceptAvailableConnectionOnNewSocket;
+    // Returns nil if no connection is waiting.
+
+// File transmission. These send length bytes of the open file starting at offset, after any header buffers, with sendfile() so the file's contents go from the file system to the socket without passing through this process. Files sendfile() can't handle are read and written instead. If the file turns out to be shorter than length, they stop at its end.
+- (off_t)sendFile:(int)fileDescriptor offset:(off_t)offset length:(off_t)length;
+- (off_t)sendHeaders:(const struct iovec *)headers count:(unsigned int)headerCount file:(int)fileDescriptor offset:(off_t)offset length:(off_t)length;
+    // Returns the number of bytes sent, headers included.
+- (BOOL)sendAvailableHeaders:(const struct iovec *)headers count:(unsigned int)headerCount file:(int)fileDescriptor offset:(off_t)offset length:(off_t)length bytesSent:(off_t *)outBytesSent;
+    // Sends as much as the socket will take right now. *outBytesSent counts header bytes first, then file bytes, and is set even when this returns NO, since the socket may fill up partway through; to continue, call again with the headers and file range advanced past what was sent.
+
 - (void)setUsesNagleDelay:(BOOL)nagle;
 // - (BOOL)usesNagleDelay;
 
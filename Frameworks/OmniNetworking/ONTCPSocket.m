@@ -10,6 +10,11 @@
 #import <sys/types.h>
 #import <errno.h>
 #import <netinet/tcp.h>
+#import <sys/socket.h>
+#import <sys/uio.h>
+#if defined(__linux__)
+#import <sys/sendfile.h>
+#endif
 
 #import <Foundation/NSDictionary.h>
 #import <Foundation/NSBundle.h> // for NSLocalized...() macros
@@ -164,6 +169,37 @@ static Class defaultTCPSocketClass = nil;
 // ONSocket subclass
 
 - (size_t)readBytes:(size_t)byteCount intoBuffer:(void *)aBuffer;
+{
+    size_t bytesRead;
+
+    if (![self readAvailableBytes:byteCount intoBuffer:aBuffer bytesRead:&bytesRead])
+        [[NSException exceptionWithName:ONTCPSocketWouldBlockExceptionName reason:NSLocalizedStringFromTableInBundle(@"Read aborted", @"OmniNetworking", THIS_BUNDLE, @"error: EAGAIN") userInfo:nil] raise];
+    return bytesRead;
+}
+
+- (size_t)writeBytes:(size_t)byteCount fromBuffer:(const void *)aBuffer;
+{
+    struct iovec io_vector;
+    
+    /* We have to cast away the 'const' here because the iovec type is used for both read and write and therefore don't have a const qualifier of their own. */
+    io_vector.iov_base = (void *)aBuffer;
+    io_vector.iov_len = byteCount;
+    
+    return [self writeBuffers:&io_vector count:1];
+}
+
+- (size_t)writeBuffers:(const struct iovec *)buffers count:(unsigned int)num_iov
+{
+    size_t bytesWritten;
+
+    if (![self writeAvailableBuffers:buffers count:num_iov bytesWritten:&bytesWritten])
+        [[NSException exceptionWithName:ONTCPSocketWouldBlockExceptionName reason:NSLocalizedStringFromTableInBundle(@"Write aborted", @"OmniNetworking", THIS_BUNDLE, @"error: EAGAIN") userInfo:nil] raise];
+    return bytesWritten;
+}
+
+// Non-blocking I/O
+
+- (BOOL)readAvailableBytes:(size_t)byteCount intoBuffer:(void *)aBuffer bytesRead:(size_t *)outBytesRead;
 {
     ssize_t bytesRead;
     int read_errno;
@@ -182,12 +218,14 @@ static Class defaultTCPSocketClass = nil;
                 [[NSException exceptionWithName:ONInternetSocketUserAbortExceptionName reason:NSLocalizedStringFromTableInBundle(@"Read aborted", @"OmniNetworking", THIS_BUNDLE, @"error: userAbort") userInfo:nil] raise];
             // Error reading socket
             read_errno = OMNI_ERRNO();
-            if (read_errno == EAGAIN)
-                [[NSException exceptionWithName:ONTCPSocketWouldBlockExceptionName reason:NSLocalizedStringFromTableInBundle(@"Read aborted", @"OmniNetworking", THIS_BUNDLE, @"error: EAGAIN") userInfo:nil] raise];
+            if (read_errno == EAGAIN) {
+                *outBytesRead = 0;
+                return NO;
+            }
             if (read_errno == EPIPE)
                 goto read_eof;
             [NSException raise:ONInternetSocketReadFailedExceptionName posixErrorNumber:read_errno format:NSLocalizedStringFromTableInBundle(@"Unable to read from socket: %s", @"OmniNetworking", THIS_BUNDLE, @"error"), strerror(OMNI_ERRNO())];
-            return 0; // Not reached
+            return NO; // Not reached
         case 0:
         read_eof:
             // Our peer closed the socket, resulting in an end-of-file.  Close it on this end.
@@ -197,35 +235,20 @@ static Class defaultTCPSocketClass = nil;
             pthread_mutex_lock(&socketLock);
             [self _locked_destroySocketFD];
             pthread_mutex_unlock(&socketLock);
-            return 0;
+            *outBytesRead = 0;
+            return YES;
         default:
             // Normal successful read
-            return bytesRead;
+            *outBytesRead = bytesRead;
+            return YES;
     }
 }
 
-- (size_t)writeBytes:(size_t)byteCount fromBuffer:(const void *)aBuffer;
-{
-    struct iovec io_vector;
-    
-    /* We have to cast away the 'const' here because the iovec type is used for both read and write and therefore don't have a const qualifier of their own. */
-    io_vector.iov_base = (void *)aBuffer;
-    io_vector.iov_len = byteCount;
-    
-    return [self writeBuffers:&io_vector count:1];
-}
-
-- (size_t)writeBuffers:(const struct iovec *)buffers count:(unsigned int)num_iov
+- (BOOL)writeAvailableBuffers:(const struct iovec *)buffers count:(unsigned int)num_iov bytesWritten:(size_t *)outBytesWritten;
 {
     ssize_t bytesWritten;
 
-    while (!flags.connected) {
-        if (!flags.listening) {
-            NSString *localizedErrorMsg = NSLocalizedStringFromTableInBundle(@"Attempted write to a non-connected socket", @"OmniNetworking", THIS_BUNDLE, "error - socket is unxepectedly closed, not connected, or not listening for connections");
-            [[NSException exceptionWithName:ONInternetSocketNotConnectedExceptionName reason:localizedErrorMsg userInfo:nil] raise];
-        } else
-            [self acceptConnection];
-    }
+    [self _waitForConnectionToWrite];
     
     if (num_iov == 1)
         bytesWritten = write(socketFD, buffers[0].iov_base, buffers[0].iov_len);
@@ -237,16 +260,211 @@ static Class defaultTCPSocketClass = nil;
     if (bytesWritten < 0) {
         if (flags.userAbort)
             [[NSException exceptionWithName:ONInternetSocketUserAbortExceptionName reason:NSLocalizedStringFromTableInBundle(@"Write aborted", @"OmniNetworking", THIS_BUNDLE, @"error: userAbort") userInfo:nil] raise];
-        if (OMNI_ERRNO() == EAGAIN)
-            [[NSException exceptionWithName:ONTCPSocketWouldBlockExceptionName reason:NSLocalizedStringFromTableInBundle(@"Write aborted", @"OmniNetworking", THIS_BUNDLE, @"error: EAGAIN") userInfo:nil] raise];
+        if (OMNI_ERRNO() == EAGAIN) {
+            *outBytesWritten = 0;
+            return NO;
+        }
         [NSException raise:ONInternetSocketWriteFailedExceptionName posixErrorNumber:OMNI_ERRNO() format:NSLocalizedStringFromTableInBundle(@"Unable to write to socket: %s", @"OmniNetworking", THIS_BUNDLE, @"error"), strerror(OMNI_ERRNO())];
     }
 
-    return bytesWritten;
+    *outBytesWritten = bytesWritten;
+    return YES;
+}
+
+- (ONTCPSocket *)acceptAvailableConnectionOnNewSocket;
+{
+    int newSocketFD;
+
+    do {
+	newSocketFD = accept(socketFD, NULL, NULL);
+    } while (newSocketFD == -1 && OMNI_ERRNO() == EINTR);
+
+    if (newSocketFD == -1) {
+        // ECONNABORTED means a client gave up while waiting in the queue; there may be others behind it.
+        if (OMNI_ERRNO() == EAGAIN || OMNI_ERRNO() == ECONNABORTED)
+            return nil;
+	[NSException raise:ONTCPSocketAcceptFailedExceptionName posixErrorNumber:OMNI_ERRNO() format:@"Socket accept failed: %s", strerror(OMNI_ERRNO())];
+    }
+    return (ONTCPSocket *)[[self class] socketWithConnectedFileDescriptor:newSocketFD shouldClose:YES];
+}
+
+// File transmission
+
+- (off_t)sendFile:(int)fileDescriptor offset:(off_t)offset length:(off_t)length;
+{
+    return [self sendHeaders:NULL count:0 file:fileDescriptor offset:offset length:length];
+}
+
+- (off_t)sendHeaders:(const struct iovec *)headers count:(unsigned int)headerCount file:(int)fileDescriptor offset:(off_t)offset length:(off_t)length;
+{
+    struct iovec remainingHeaders[MAX(headerCount, 1U)];
+    unsigned int headerIndex = 0;
+    off_t totalBytesSent = 0;
+
+    if (headerCount != 0)
+        memcpy(remainingHeaders, headers, sizeof(*headers) * headerCount);
+
+    for (;;) {
+        BOOL sendingHeaders = headerIndex < headerCount;
+        off_t bytesSent;
+
+        if (![self sendAvailableHeaders:(remainingHeaders + headerIndex) count:(headerCount - headerIndex) file:fileDescriptor offset:offset length:length bytesSent:&bytesSent])
+            [[NSException exceptionWithName:ONTCPSocketWouldBlockExceptionName reason:NSLocalizedStringFromTableInBundle(@"Write aborted", @"OmniNetworking", THIS_BUNDLE, @"error: EAGAIN") userInfo:nil] raise];
+        totalBytesSent += bytesSent;
+
+        // Step past whatever was sent
+        while (headerIndex < headerCount && (size_t)bytesSent >= remainingHeaders[headerIndex].iov_len) {
+            bytesSent -= remainingHeaders[headerIndex].iov_len;
+            headerIndex++;
+        }
+        if (headerIndex < headerCount) {
+            remainingHeaders[headerIndex].iov_base += bytesSent;
+            remainingHeaders[headerIndex].iov_len -= bytesSent;
+            continue;
+        }
+        if (bytesSent == 0 && !sendingHeaders)
+            break; // The file is shorter than we were told
+        offset += bytesSent;
+        length -= bytesSent;
+        if (length == 0)
+            break;
+    }
+
+    return totalBytesSent;
+}
+
+- (BOOL)sendAvailableHeaders:(const struct iovec *)headers count:(unsigned int)headerCount file:(int)fileDescriptor offset:(off_t)offset length:(off_t)length bytesSent:(off_t *)outBytesSent;
+{
+    size_t headerLength = 0;
+    unsigned int headerIndex;
+
+    [self _waitForConnectionToWrite];
+
+    for (headerIndex = 0; headerIndex < headerCount; headerIndex++)
+        headerLength += headers[headerIndex].iov_len;
+
+    if (length == 0) {
+        size_t bytesWritten;
+        BOOL wrote = [self writeAvailableBuffers:headers count:headerCount bytesWritten:&bytesWritten];
+        *outBytesSent = bytesWritten;
+        return wrote;
+    }
+
+    off_t bytesSent;
+    int sendErrno;
+
+    do {
+        bytesSent = 0;
+        sendErrno = 0;
+#if defined(__linux__)
+        // The headers go first, marked as having more to come so they can share packets with the start of the file.
+        if (headerLength != 0) {
+            struct msghdr message;
+
+            memset(&message, 0, sizeof(message));
+            message.msg_iov = (struct iovec *)headers;
+            message.msg_iovlen = headerCount;
+            ssize_t headerBytesSent = sendmsg(socketFD, &message, MSG_MORE);
+            if (headerBytesSent < 0)
+                sendErrno = OMNI_ERRNO();
+            else
+                bytesSent = headerBytesSent;
+        }
+        if (sendErrno == 0 && (size_t)bytesSent == headerLength) {
+            off_t fileOffset = offset;
+            ssize_t fileBytesSent = sendfile(socketFD, fileDescriptor, &fileOffset, (size_t)MIN(length, (off_t)0x7ffff000)); // The most Linux will send at once
+            if (fileBytesSent < 0)
+                sendErrno = OMNI_ERRNO();
+            else
+                bytesSent += fileBytesSent;
+        }
+        if (sendErrno == EINVAL || sendErrno == ENOSYS) {
+            if (bytesSent != 0) {
+                // Let the caller come back for the rest, which will then all go by copying
+                *outBytesSent = bytesSent;
+                return YES;
+            }
+            return [self _sendAvailableHeaders:headers count:headerCount byCopyingFile:fileDescriptor offset:offset length:length bytesSent:outBytesSent];
+        }
+#else
+        // sendfile() takes the headers along with the file and reports everything it sent, even when it fails partway through. The headers count against the length it's given, so that has to include them to send all of the file we were asked for.
+        struct sf_hdtr headersAndTrailers;
+        off_t sendLength = headerCount != 0 ? length + (off_t)headerLength : length;
+
+        memset(&headersAndTrailers, 0, sizeof(headersAndTrailers));
+        headersAndTrailers.headers = (struct iovec *)headers;
+        headersAndTrailers.hdr_cnt = headerCount;
+        if (sendfile(fileDescriptor, socketFD, offset, &sendLength, headerCount != 0 ? &headersAndTrailers : NULL, 0) < 0)
+            sendErrno = OMNI_ERRNO();
+        bytesSent = sendLength;
+        if (sendErrno == ENOTSUP || sendErrno == EOPNOTSUPP) {
+            OBASSERT(bytesSent == 0);
+            return [self _sendAvailableHeaders:headers count:headerCount byCopyingFile:fileDescriptor offset:offset length:length bytesSent:outBytesSent];
+        }
+#endif
+    } while (sendErrno == EINTR && bytesSent == 0);
+
+    *outBytesSent = bytesSent;
+    if (sendErrno == 0 || sendErrno == EINTR)
+        return YES;
+    if (flags.userAbort)
+        [[NSException exceptionWithName:ONInternetSocketUserAbortExceptionName reason:NSLocalizedStringFromTableInBundle(@"Write aborted", @"OmniNetworking", THIS_BUNDLE, @"error: userAbort") userInfo:nil] raise];
+    if (sendErrno == EAGAIN)
+        return NO;
+    [NSException raise:ONInternetSocketWriteFailedExceptionName posixErrorNumber:sendErrno format:NSLocalizedStringFromTableInBundle(@"Unable to write to socket: %s", @"OmniNetworking", THIS_BUNDLE, @"error"), strerror(sendErrno)];
+    return NO; // Not reached
 }
     
 #pragma mark - Private
 
+- (void)_waitForConnectionToWrite;
+{
+    while (!flags.connected) {
+        if (!flags.listening) {
+            NSString *localizedErrorMsg = NSLocalizedStringFromTableInBundle(@"Attempted write to a non-connected socket", @"OmniNetworking", THIS_BUNDLE, "error - socket is unxepectedly closed, not connected, or not listening for connections");
+            [[NSException exceptionWithName:ONInternetSocketNotConnectedExceptionName reason:localizedErrorMsg userInfo:nil] raise];
+        } else
+            [self acceptConnection];
+    }
+}
+
+#define ONTCPSocketFileCopySize (65536)
+
+// For files sendfile() won't take: reads a chunk of the file and writes it out behind the headers.
+- (BOOL)_sendAvailableHeaders:(const struct iovec *)headers count:(unsigned int)headerCount byCopyingFile:(int)fileDescriptor offset:(off_t)offset length:(off_t)length bytesSent:(off_t *)outBytesSent;
+{
+    struct iovec buffers[headerCount + 1];
+    void *chunk = malloc(ONTCPSocketFileCopySize);
+    ssize_t chunkLength;
+    size_t bytesWritten = 0;
+    BOOL wrote;
+
+    do {
+        chunkLength = pread(fileDescriptor, chunk, (size_t)MIN(length, (off_t)ONTCPSocketFileCopySize), offset);
+    } while (chunkLength < 0 && OMNI_ERRNO() == EINTR);
+    if (chunkLength < 0) {
+        int readErrno = OMNI_ERRNO();
+        free(chunk);
+        [NSException raise:ONInternetSocketWriteFailedExceptionName posixErrorNumber:readErrno format:NSLocalizedStringFromTableInBundle(@"Unable to read file to send: %s", @"OmniNetworking", THIS_BUNDLE, @"error"), strerror(readErrno)];
+    }
+
+    if (headerCount != 0)
+        memcpy(buffers, headers, sizeof(*headers) * headerCount);
+    buffers[headerCount].iov_base = chunk;
+    buffers[headerCount].iov_len = chunkLength;
+
+    NS_DURING {
+        wrote = [self writeAvailableBuffers:buffers count:headerCount + 1 bytesWritten:&bytesWritten];
+    } NS_HANDLER {
+        free(chunk);
+        [localException raise];
+    } NS_ENDHANDLER;
+
+    free(chunk);
+    *outBytesSent = bytesWritten;
+    return wrote;
+}
+
 - _initWithSocketFD:(int)aSocketFD connected:(BOOL)isConnected
 {
     if (!(self = [super _initWithSocketFD:aSocketFD connected:isConnected]))
@@ -289,6 +507,14 @@ static Class defaultTCPSocketClass = nil;
         [self setPushesWrites: tcpFlags.pushWrites];
 }
 
+- (ONInternetSocket *)_connectionAttemptSocket;
+{
+    ONTCPSocket *attempt = (ONTCPSocket *)[super _connectionAttemptSocket];
+
+    attempt->tcpFlags = tcpFlags;
+    return attempt;
+}
+
 - (NSMutableDictionary *)debugDictionary;
 {
     NSMutableDictionary *debugDictionary = [super debugDictionary];
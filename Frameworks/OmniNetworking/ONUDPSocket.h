@@ -7,10 +7,34 @@
 
 #import <OmniNetworking/ONInternetSocket.h>
 
+#include <sys/socket.h>
+#include <sys/uio.h>
+
 @class ONPortAddress;
 
+// One datagram in a batch read or write.
+typedef struct {
+    struct iovec buffer;                // The datagram's bytes. When reading, iov_len is how much room there is.
+    size_t length;                      // When reading, set to the number of bytes received.
+    struct sockaddr_storage address;    // When reading, set to the sender. When writing, where to send the datagram; AF_UNSPEC sends it to the connected address.
+    unsigned int segmentSize;           // When reading with coalesced datagrams, set to the size of each of the datagrams which were joined together into this one (the last may be shorter), or 0 if this is a single datagram.
+    BOOL truncated;                     // When reading, set if the datagram was longer than the buffer and the rest of it was discarded.
+} ONDatagram;
+
 @interface ONUDPSocket : ONInternetSocket
 
 - (size_t)writeBytes:(size_t)byteCount fromBuffer:(const void *)aBuffer toPortAddress:(ONPortAddress *)aPortAddress;
 
+- (unsigned int)readDatagrams:(ONDatagram *)datagrams maximumCount:(unsigned int)maximumCount;
+    // Waits for a datagram, then also takes any others that have already arrived, up to maximumCount, with a single recvmmsg() where the system has it. Returns the number of datagrams read. Unlike -readBytes:intoBuffer:, this leaves -remoteAddress alone; senders are only returned in the datagrams.
+
+- (unsigned int)writeDatagrams:(const ONDatagram *)datagrams count:(unsigned int)count;
+    // Sends the datagrams with a single sendmmsg() where the system has it. Returns the number sent, which may be less than count if the socket stopped taking them partway through; raises only if none could be sent.
+
+- (BOOL)setSendSegmentSize:(unsigned int)segmentSize;
+    // Has the system split each datagram written into datagrams of segmentSize bytes (UDP generic segmentation offload), so that a whole run of same-sized datagrams can be handed over in one buffer. 0 turns this off. Returns NO where the system doesn't support it.
+
+- (BOOL)setReceivesCoalescedDatagrams:(BOOL)shouldCoalesce;
+    // Lets the system join runs of datagrams from the same sender into one (UDP generic receive offload); see ONDatagram's segmentSize. Only -readDatagrams:maximumCount: reports where the joined datagrams begin, so other reads shouldn't be used while this is on. Returns NO where the system doesn't support it.
+
 @end
@@ -15,12 +15,104 @@
 #import <OmniNetworking/ONHost.h>
 #import <OmniNetworking/ONPortAddress.h>
 
+#if defined(__linux__)
+#define ON_UDP_USES_MMSG 1
+#include <netinet/udp.h>
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#else
+#define ON_UDP_USES_MMSG 0
+#endif
+
 RCS_ID("$Id$")
 
 
 #define THIS_BUNDLE [NSBundle bundleForClass:[ONUDPSocket class]]
 
+#if ON_UDP_USES_MMSG
+typedef struct mmsghdr ONUDPMessage;
+#define ON_UDP_CONTROL_SPACE CMSG_SPACE(sizeof(int)) // Room for a UDP_GRO segment size
+
+// Waits for the first message, then takes others only if they're already there.
+static int _receiveMessages(int fd, ONUDPMessage *messages, unsigned int count)
+{
+    return recvmmsg(fd, messages, count, MSG_WAITFORONE, NULL);
+}
+
+static int _sendMessages(int fd, ONUDPMessage *messages, unsigned int count)
+{
+    return sendmmsg(fd, messages, count, 0);
+}
+#else
+// The same layout as struct mmsghdr, so the code below is the same either way.
+typedef struct {
+    struct msghdr msg_hdr;
+    unsigned int msg_len;
+} ONUDPMessage;
+
+// Without recvmmsg(), this waits for the first message with recvmsg() and then takes others only if they're already there.
+static int _receiveMessages(int fd, ONUDPMessage *messages, unsigned int count)
+{
+    for (unsigned int messageIndex = 0; messageIndex < count; messageIndex++) {
+        ssize_t length = recvmsg(fd, &messages[messageIndex].msg_hdr, messageIndex == 0 ? 0 : MSG_DONTWAIT);
+        if (length < 0)
+            return messageIndex == 0 ? -1 : (int)messageIndex;
+        messages[messageIndex].msg_len = (unsigned int)length;
+    }
+    return (int)count;
+}
+
+// Without sendmmsg(), sends until one fails; the error is left for the next call to report.
+static int _sendMessages(int fd, ONUDPMessage *messages, unsigned int count)
+{
+    for (unsigned int messageIndex = 0; messageIndex < count; messageIndex++) {
+        ssize_t length = sendmsg(fd, &messages[messageIndex].msg_hdr, 0);
+        if (length < 0)
+            return messageIndex == 0 ? -1 : (int)messageIndex;
+        messages[messageIndex].msg_len = (unsigned int)length;
+    }
+    return (int)count;
+}
+#endif
+
+static socklen_t _socketAddressLength(const struct sockaddr_storage *address)
+{
+    switch (address->ss_family) {
+        case AF_INET:
+            return sizeof(struct sockaddr_in);
+        case AF_INET6:
+            return sizeof(struct sockaddr_in6);
+        default:
+            return sizeof(*address);
+    }
+}
+
 @implementation ONUDPSocket
+{
+    // Message headers for the batch calls, kept from one call to the next and grown as needed. Reading and writing have their own so that one thread can read while another writes.
+    ONUDPMessage *readMessages, *writeMessages;
+    unsigned int readMessageCapacity, writeMessageCapacity;
+#if ON_UDP_USES_MMSG
+    char *readControl;
+#endif
+
+    unsigned int sendSegmentSize;
+    BOOL receivesCoalescedDatagrams;
+}
+
+- (void)dealloc;
+{
+    free(readMessages);
+    free(writeMessages);
+#if ON_UDP_USES_MMSG
+    free(readControl);
+#endif
+    [super dealloc];
+}
 
 - (size_t)writeBytes:(size_t)byteCount fromBuffer:(const void *)aBuffer toPortAddress:(ONPortAddress *)aPortAddress;
 {
@@ -40,6 +132,146 @@ RCS_ID("$Id$")
 }
 
 
+- (unsigned int)readDatagrams:(ONDatagram *)datagrams maximumCount:(unsigned int)maximumCount;
+{
+    unsigned int datagramIndex;
+    int messageCount;
+
+    if (maximumCount == 0)
+        return 0;
+
+    if (readMessageCapacity < maximumCount) {
+        free(readMessages);
+        readMessages = malloc(sizeof(*readMessages) * maximumCount);
+#if ON_UDP_USES_MMSG
+        free(readControl);
+        readControl = malloc(ON_UDP_CONTROL_SPACE * maximumCount);
+#endif
+        readMessageCapacity = maximumCount;
+    }
+
+    for (datagramIndex = 0; datagramIndex < maximumCount; datagramIndex++) {
+        struct msghdr *header = &readMessages[datagramIndex].msg_hdr;
+
+        memset(header, 0, sizeof(*header));
+        header->msg_name = &datagrams[datagramIndex].address;
+        header->msg_namelen = sizeof(datagrams[datagramIndex].address);
+        header->msg_iov = &datagrams[datagramIndex].buffer;
+        header->msg_iovlen = 1;
+#if ON_UDP_USES_MMSG
+        if (receivesCoalescedDatagrams) {
+            header->msg_control = readControl + ON_UDP_CONTROL_SPACE * datagramIndex;
+            header->msg_controllen = ON_UDP_CONTROL_SPACE;
+        }
+#endif
+    }
+
+    messageCount = _receiveMessages(socketFD, readMessages, maximumCount);
+
+    if (flags.userAbort)
+        [[NSException exceptionWithName:ONInternetSocketUserAbortExceptionName reason:NSLocalizedStringFromTableInBundle(@"Read aborted", @"OmniNetworking", THIS_BUNDLE, @"error") userInfo:nil] raise];
+
+    if (messageCount < 0)
+	[NSException raise:ONInternetSocketReadFailedExceptionName posixErrorNumber:OMNI_ERRNO() format:NSLocalizedStringFromTableInBundle(@"Unable to read from socket: %s", @"OmniNetworking", THIS_BUNDLE, @"error"), strerror(OMNI_ERRNO())];
+
+    for (datagramIndex = 0; datagramIndex < (unsigned int)messageCount; datagramIndex++) {
+        const ONUDPMessage *message = &readMessages[datagramIndex];
+        ONDatagram *datagram = &datagrams[datagramIndex];
+
+        datagram->length = message->msg_len;
+        datagram->truncated = (message->msg_hdr.msg_flags & MSG_TRUNC) != 0;
+        datagram->segmentSize = 0;
+        if (message->msg_hdr.msg_namelen == 0)
+            datagram->address.ss_family = AF_UNSPEC;
+#if ON_UDP_USES_MMSG
+        if (receivesCoalescedDatagrams) {
+            for (struct cmsghdr *control = CMSG_FIRSTHDR(&message->msg_hdr); control != NULL; control = CMSG_NXTHDR((struct msghdr *)&message->msg_hdr, control)) {
+                if (control->cmsg_level == SOL_UDP && control->cmsg_type == UDP_GRO) {
+                    int segmentSize;
+                    memcpy(&segmentSize, CMSG_DATA(control), sizeof(segmentSize));
+                    if ((size_t)segmentSize < datagram->length)
+                        datagram->segmentSize = segmentSize;
+                }
+            }
+        }
+#endif
+    }
+
+    return messageCount;
+}
+
+- (unsigned int)writeDatagrams:(const ONDatagram *)datagrams count:(unsigned int)count;
+{
+    unsigned int datagramIndex;
+    int addressFamily = AF_UNSPEC;
+    int messageCount;
+
+    if (count == 0)
+        return 0;
+
+    for (datagramIndex = 0; datagramIndex < count; datagramIndex++) {
+        int datagramAddressFamily = datagrams[datagramIndex].address.ss_family;
+        if (datagramAddressFamily == AF_UNSPEC && !flags.connected) {
+            NSString *localizedErrorMsg = NSLocalizedStringFromTableInBundle(@"Attempted write to a non-connected socket", @"OmniNetworking", THIS_BUNDLE, @"error - socket is not connected");
+            [[NSException exceptionWithName:ONInternetSocketNotConnectedExceptionName reason:localizedErrorMsg userInfo:nil] raise];
+        }
+        if (addressFamily == AF_UNSPEC)
+            addressFamily = datagramAddressFamily;
+    }
+    [self ensureSocketFD:addressFamily];
+
+    if (writeMessageCapacity < count) {
+        free(writeMessages);
+        writeMessages = malloc(sizeof(*writeMessages) * count);
+        writeMessageCapacity = count;
+    }
+
+    for (datagramIndex = 0; datagramIndex < count; datagramIndex++) {
+        const ONDatagram *datagram = &datagrams[datagramIndex];
+        struct msghdr *header = &writeMessages[datagramIndex].msg_hdr;
+
+        /* We have to cast away the 'const' here because msghdr is used for both sending and receiving. */
+        memset(header, 0, sizeof(*header));
+        if (datagram->address.ss_family != AF_UNSPEC) {
+            header->msg_name = (void *)&datagram->address;
+            header->msg_namelen = _socketAddressLength(&datagram->address);
+        }
+        header->msg_iov = (struct iovec *)&datagram->buffer;
+        header->msg_iovlen = 1;
+    }
+
+    messageCount = _sendMessages(socketFD, writeMessages, count);
+    if (messageCount < 0)
+	[NSException raise:ONInternetSocketWriteFailedExceptionName posixErrorNumber:OMNI_ERRNO() format:NSLocalizedStringFromTableInBundle(@"Unable to write to socket: %s", @"OmniNetworking", THIS_BUNDLE, @"error"), strerror(OMNI_ERRNO())];
+    return messageCount;
+}
+
+- (BOOL)setSendSegmentSize:(unsigned int)segmentSize;
+{
+#if ON_UDP_USES_MMSG
+    sendSegmentSize = segmentSize;
+    if (socketFD == -1)
+        return YES;
+    int value = segmentSize;
+    return setsockopt(socketFD, SOL_UDP, UDP_SEGMENT, &value, sizeof(value)) == 0;
+#else
+    return segmentSize == 0;
+#endif
+}
+
+- (BOOL)setReceivesCoalescedDatagrams:(BOOL)shouldCoalesce;
+{
+#if ON_UDP_USES_MMSG
+    receivesCoalescedDatagrams = shouldCoalesce;
+    if (socketFD == -1)
+        return YES;
+    int value = shouldCoalesce ? 1 : 0;
+    return setsockopt(socketFD, SOL_UDP, UDP_GRO, &value, sizeof(value)) == 0;
+#else
+    return !shouldCoalesce;
+#endif
+}
+
 // ONSocket subclass
 
 - (size_t)readBytes:(size_t)byteCount intoBuffer:(void *)aBuffer;
@@ -124,4 +356,24 @@ RCS_ID("$Id$")
     return remoteAddress;
 }
 
+#pragma mark - Private
+
+- (void)_locked_createSocketFD:(int)af
+{
+    [super _locked_createSocketFD:af];
+
+#if ON_UDP_USES_MMSG
+    if (socketFD != -1) {
+        if (sendSegmentSize != 0) {
+            int value = sendSegmentSize;
+            setsockopt(socketFD, SOL_UDP, UDP_SEGMENT, &value, sizeof(value));
+        }
+        if (receivesCoalescedDatagrams) {
+            int value = 1;
+            setsockopt(socketFD, SOL_UDP, UDP_GRO, &value, sizeof(value));
+        }
+    }
+#endif
+}
+
 @end
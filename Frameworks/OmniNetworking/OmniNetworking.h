@@ -10,11 +10,13 @@
 #import <OmniNetworking/ONHostAddress.h>
 #import <OmniNetworking/ONInternetSocket.h>
 #import <OmniNetworking/ONInterface.h>
+#import <OmniNetworking/ONInterfaceMonitor.h>
 #import <OmniNetworking/ONLinkLayerHostAddress.h>
 #import <OmniNetworking/ONMulticastSocket.h>
 #import <OmniNetworking/ONPortAddress.h>
 #import <OmniNetworking/ONServiceEntry.h>
 #import <OmniNetworking/ONSocket.h>
+#import <OmniNetworking/ONSocketReactor.h>
 #import <OmniNetworking/ONSocketStream.h>
 #import <OmniNetworking/ONTCPSocket.h>
 #import <OmniNetworking/ONTCPDatagramSocket.h>
@@ -0,0 +1,141 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniNetworking/OmniNetworking.h>
+
+#import <Foundation/Foundation.h>
+#import <OmniBase/OmniBase.h>
+#import <XCTest/XCTest.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+RCS_ID("$Id$");
+
+// Times -connectToAddressFromArray: over loopback when the first address accepts, refuses, or is a blackhole, both on the first connection and once the connection history has something to say. Results are logged rather than asserted since they depend on the machine.
+
+@interface ONConnectRaceBenchmarks : XCTestCase
+{
+    NSMutableArray *keptSockets;
+}
+@end
+
+@implementation ONConnectRaceBenchmarks
+
+static const NSUInteger ONConnectRaceBenchmarkConnectionCount = 200;
+
+- (void)setUp;
+{
+    keptSockets = [[NSMutableArray alloc] init];
+}
+
+- (void)tearDown;
+{
+    [keptSockets makeObjectsPerformSelector:@selector(abortSocket)];
+    [keptSockets release];
+    keptSockets = nil;
+}
+
+static ONPortAddress *_loopbackPortAddress(unsigned short int port)
+{
+    return [[[ONPortAddress alloc] initWithHostAddress:[ONHostAddress loopbackAddress] portNumber:port] autorelease];
+}
+
+- (ONTCPSocket *)_listener;
+{
+    ONTCPSocket *listener = [ONTCPSocket tcpSocket];
+    [listener setAddressFamily:AF_INET];
+    [listener startListeningOnAnyLocalPort];
+    [keptSockets addObject:listener];
+    return listener;
+}
+
+- (ONPortAddress *)_acceptingAddress;
+{
+    // Accept on another thread so the backlog never fills up. A listener that loses every race sits waiting, which is harmless here.
+    ONTCPSocket *listener = [self _listener];
+    [listener retain];
+    [NSThread detachNewThreadWithBlock:^{
+        for (NSUInteger connectionIndex = 0; connectionIndex < ONConnectRaceBenchmarkConnectionCount; connectionIndex++) {
+            NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+            [listener acceptConnectionOnNewSocket];
+            [pool release];
+        }
+        [listener release];
+    }];
+    return _loopbackPortAddress([listener localAddressPort]);
+}
+
+- (ONPortAddress *)_refusingAddress;
+{
+    ONTCPSocket *listener = [ONTCPSocket tcpSocket];
+    [listener setAddressFamily:AF_INET];
+    [listener startListeningOnAnyLocalPort];
+    unsigned short int port = [listener localAddressPort];
+    [listener abortSocket];
+    return _loopbackPortAddress(port);
+}
+
+// A listener with a full accept queue, which makes the system drop new connection attempts as if nobody were there.
+- (ONPortAddress *)_blackholeAddress;
+{
+    ONTCPSocket *listener = [self _listener];
+    listen([listener socketFD], 0);
+
+    ONPortAddress *address = _loopbackPortAddress([listener localAddressPort]);
+    for (NSUInteger fillerIndex = 0; fillerIndex < 16; fillerIndex++) {
+        ONTCPSocket *filler = [ONTCPSocket tcpSocket];
+        if (![filler startConnectingToPortAddress:address]) {
+            struct pollfd pollDescriptor = {[filler socketFD], POLLOUT, 0};
+            if (poll(&pollDescriptor, 1, 200) != 1) {
+                [filler abortSocket];
+                break; // Full
+            }
+            [filler finishConnectingToPortAddress:address];
+        }
+        [keptSockets addObject:filler];
+    }
+    return address;
+}
+
+static int _compareDoubles(const void *a, const void *b)
+{
+    double first = *(const double *)a, second = *(const double *)b;
+    return first < second ? -1 : (first > second ? 1 : 0);
+}
+
+// The first connection has no history to go on, so it's reported separately from the rest.
+static void _timeConnections(NSString *title, NSArray *addresses)
+{
+    double times[ONConnectRaceBenchmarkConnectionCount];
+
+    for (NSUInteger connectionIndex = 0; connectionIndex < ONConnectRaceBenchmarkConnectionCount; connectionIndex++) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        ONTCPSocket *socket = [ONTCPSocket tcpSocket];
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        [socket connectToAddressFromArray:addresses];
+        times[connectionIndex] = CFAbsoluteTimeGetCurrent() - start;
+        [socket abortSocket];
+        [pool release];
+    }
+
+    double firstTime = times[0];
+    NSUInteger laterCount = ONConnectRaceBenchmarkConnectionCount - 1;
+    qsort(times + 1, laterCount, sizeof(*times), _compareDoubles);
+    NSLog(@"%@: first %.3fms, then p50 %.3fms, p99 %.3fms, max %.3fms", title, firstTime * 1000.0,
+          times[1 + laterCount / 2] * 1000.0, times[1 + (laterCount * 99) / 100] * 1000.0, times[laterCount] * 1000.0);
+}
+
+- (void)testConnectTimes;
+{
+    _timeConnections(@"accepting", @[[self _acceptingAddress]]);
+    _timeConnections(@"accepting, accepting", @[[self _acceptingAddress], [self _acceptingAddress]]);
+    _timeConnections(@"refused, accepting", @[[self _refusingAddress], [self _acceptingAddress]]);
+    _timeConnections(@"blackhole, accepting", @[[self _blackholeAddress], [self _acceptingAddress]]);
+    _timeConnections(@"blackhole, refused, accepting", @[[self _blackholeAddress], [self _refusingAddress], [self _acceptingAddress]]);
+}
+
+@end
@@ -0,0 +1,247 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniNetworking/OmniNetworking.h>
+
+#import <Foundation/Foundation.h>
+#import <OmniBase/OmniBase.h>
+#import <XCTest/XCTest.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+RCS_ID("$Id$");
+
+// Tests -connectToAddressFromArray: against local listeners that accept, refuse, blackhole, or only start accepting after a while.
+
+@interface ONConnectRaceTests : XCTestCase
+{
+    NSMutableArray *keptSockets;
+}
+@end
+
+@implementation ONConnectRaceTests
+
+- (void)setUp;
+{
+    keptSockets = [[NSMutableArray alloc] init];
+}
+
+- (void)tearDown;
+{
+    [keptSockets makeObjectsPerformSelector:@selector(abortSocket)];
+    [keptSockets release];
+    keptSockets = nil;
+}
+
+static ONPortAddress *_loopbackPortAddress(unsigned short int port)
+{
+    return [[[ONPortAddress alloc] initWithHostAddress:[ONHostAddress loopbackAddress] portNumber:port] autorelease];
+}
+
+- (ONPortAddress *)_acceptingAddress;
+{
+    ONTCPSocket *listener = [ONTCPSocket tcpSocket];
+    [listener setAddressFamily:AF_INET];
+    [listener startListeningOnAnyLocalPort];
+    [keptSockets addObject:listener];
+    return _loopbackPortAddress([listener localAddressPort]);
+}
+
+- (ONPortAddress *)_refusingAddress;
+{
+    ONTCPSocket *listener = [ONTCPSocket tcpSocket];
+    [listener setAddressFamily:AF_INET];
+    [listener startListeningOnAnyLocalPort];
+    unsigned short int port = [listener localAddressPort];
+    [listener abortSocket];
+    return _loopbackPortAddress(port);
+}
+
+// A listener with a full accept queue, which makes the system drop new connection attempts as if nobody were there.
+- (ONTCPSocket *)_blackholeListener;
+{
+    ONTCPSocket *listener = [ONTCPSocket tcpSocket];
+    [listener setAddressFamily:AF_INET];
+    [listener startListeningOnAnyLocalPort];
+    [keptSockets addObject:listener];
+    listen([listener socketFD], 0);
+
+    ONPortAddress *address = _loopbackPortAddress([listener localAddressPort]);
+    for (NSUInteger fillerIndex = 0; fillerIndex < 16; fillerIndex++) {
+        ONTCPSocket *filler = [ONTCPSocket tcpSocket];
+        if (![filler startConnectingToPortAddress:address]) {
+            struct pollfd pollDescriptor = {[filler socketFD], POLLOUT, 0};
+            if (poll(&pollDescriptor, 1, 200) != 1) {
+                [filler abortSocket];
+                break; // Full
+            }
+            [filler finishConnectingToPortAddress:address];
+        }
+        [keptSockets addObject:filler];
+    }
+    return listener;
+}
+
+- (ONPortAddress *)_blackholeAddress;
+{
+    return _loopbackPortAddress([[self _blackholeListener] localAddressPort]);
+}
+
+// Starts out as a blackhole, then starts accepting, after which the next retransmitted SYN gets through.
+- (ONPortAddress *)_delayedAddress:(NSTimeInterval)delay;
+{
+    ONTCPSocket *listener = [self _blackholeListener];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        // Make room, then leave the connection we're waiting for to be found in the queue
+        while ([listener isReadable])
+            [listener acceptConnectionOnNewSocket];
+    });
+    return _loopbackPortAddress([listener localAddressPort]);
+}
+
+- (ONTCPSocket *)_connect:(NSArray *)addresses elapsed:(NSTimeInterval *)outElapsed;
+{
+    ONTCPSocket *socket = [ONTCPSocket tcpSocket];
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    [socket connectToAddressFromArray:addresses];
+    *outElapsed = CFAbsoluteTimeGetCurrent() - start;
+    [keptSockets addObject:socket];
+    return socket;
+}
+
+- (void)testFirstAddressWins;
+{
+    ONPortAddress *good = [self _acceptingAddress], *other = [self _acceptingAddress];
+    NSTimeInterval elapsed;
+    ONTCPSocket *socket = [self _connect:@[good, other] elapsed:&elapsed];
+
+    XCTAssertTrue([socket isConnected]);
+    XCTAssertEqual([socket remoteAddressPort], [good portNumber]);
+    XCTAssertFalse([socket isNonBlocking]);
+}
+
+- (void)testRefusedAddressIsSkippedRightAway;
+{
+    ONPortAddress *refused = [self _refusingAddress], *good = [self _acceptingAddress];
+    NSTimeInterval elapsed;
+    ONTCPSocket *socket = [self _connect:@[refused, good] elapsed:&elapsed];
+
+    XCTAssertEqual([socket remoteAddressPort], [good portNumber]);
+    XCTAssertLessThan(elapsed, 0.2);
+}
+
+// An attempt failing while others are still in flight starts the next one right away rather than when it would have been due
+- (void)testRefusedAttemptStartsTheNextRightAway;
+{
+    ONPortAddress *blackhole = [self _blackholeAddress], *refused = [self _refusingAddress], *good = [self _acceptingAddress];
+    NSTimeInterval elapsed;
+    ONTCPSocket *socket = [self _connect:@[blackhole, refused, good] elapsed:&elapsed];
+
+    XCTAssertEqual([socket remoteAddressPort], [good portNumber]);
+    XCTAssertGreaterThanOrEqual(elapsed, 0.2); // One attempt delay for the blackhole
+    XCTAssertLessThan(elapsed, 0.45); // But not a second one for the refused address
+}
+
+- (void)testRefusedFirstAddressThenSlowAddress;
+{
+    ONPortAddress *refused = [self _refusingAddress], *delayed = [self _delayedAddress:0.1];
+    NSTimeInterval elapsed;
+    ONTCPSocket *socket = [self _connect:@[refused, delayed] elapsed:&elapsed];
+
+    XCTAssertTrue([socket isConnected]);
+    XCTAssertEqual([socket remoteAddressPort], [delayed portNumber]);
+    XCTAssertLessThan(elapsed, 10.0);
+}
+
+- (void)testBlackholeCostsOneAttemptDelay;
+{
+    ONPortAddress *blackhole = [self _blackholeAddress], *good = [self _acceptingAddress];
+    NSTimeInterval elapsed;
+    ONTCPSocket *socket = [self _connect:@[blackhole, good] elapsed:&elapsed];
+
+    XCTAssertEqual([socket remoteAddressPort], [good portNumber]);
+    XCTAssertGreaterThanOrEqual(elapsed, 0.2);
+    XCTAssertLessThan(elapsed, 1.0);
+
+    // Having connected to it, the good address now goes first
+    socket = [self _connect:@[blackhole, good] elapsed:&elapsed];
+    XCTAssertEqual([socket remoteAddressPort], [good portNumber]);
+    XCTAssertLessThan(elapsed, 0.2);
+}
+
+- (void)testSlowAddressStillWinsWhenNothingElseAnswers;
+{
+    ONPortAddress *delayed = [self _delayedAddress:0.1], *blackhole = [self _blackholeAddress];
+    NSTimeInterval elapsed;
+    ONTCPSocket *socket = [self _connect:@[delayed, blackhole] elapsed:&elapsed];
+
+    XCTAssertEqual([socket remoteAddressPort], [delayed portNumber]);
+    XCTAssertLessThan(elapsed, 10.0);
+}
+
+- (void)testAllRefused;
+{
+    NSArray *addresses = @[[self _refusingAddress], [self _refusingAddress]];
+    ONTCPSocket *socket = [ONTCPSocket tcpSocket];
+
+    XCTAssertThrowsSpecificNamed([socket connectToAddressFromArray:addresses], NSException, ONInternetSocketConnectTemporarilyFailedExceptionName);
+    XCTAssertFalse([socket isConnected]);
+    XCTAssertEqual([socket socketFD], -1);
+}
+
+- (void)testConnectedSocketCarriesData;
+{
+    ONTCPSocket *listener = [ONTCPSocket tcpSocket];
+    [listener setAddressFamily:AF_INET];
+    [listener startListeningOnAnyLocalPort];
+    [keptSockets addObject:listener];
+    NSTimeInterval elapsed;
+    ONTCPSocket *socket = [self _connect:@[[self _blackholeAddress], _loopbackPortAddress([listener localAddressPort])] elapsed:&elapsed];
+
+    ONTCPSocket *server = [listener acceptConnectionOnNewSocket];
+    [socket writeString:@"ping"];
+    char reply[4];
+    size_t replyLength = 0;
+    while (replyLength < sizeof(reply))
+        replyLength += [server readBytes:sizeof(reply) - replyLength intoBuffer:reply + replyLength];
+    XCTAssertTrue(memcmp(reply, "ping", 4) == 0);
+    XCTAssertEqualObjects([socket remoteAddress], _loopbackPortAddress([listener localAddressPort]));
+}
+
+- (BOOL)_isTCPOption:(int)option setOnSocket:(ONTCPSocket *)socket;
+{
+    int value = 0;
+    socklen_t valueLength = sizeof(value);
+    XCTAssertEqual(getsockopt([socket socketFD], IPPROTO_TCP, option, &value, &valueLength), 0);
+    return value != 0;
+}
+
+// Options set before connecting apply to whichever attempt wins, not just to a socket we'd have created ourselves
+- (void)testRacedConnectionKeepsTCPOptions;
+{
+    ONPortAddress *blackhole = [self _blackholeAddress], *good = [self _acceptingAddress];
+
+    ONTCPSocket *socket = [ONTCPSocket tcpSocket];
+    [socket setUsesNagleDelay:NO];
+    [socket setPushesWrites:NO];
+    [socket connectToAddressFromArray:@[blackhole, good]];
+    [keptSockets addObject:socket];
+
+    XCTAssertEqual([socket remoteAddressPort], [good portNumber]);
+    XCTAssertTrue([self _isTCPOption:TCP_NODELAY setOnSocket:socket]);
+    XCTAssertTrue([self _isTCPOption:TCP_NOPUSH setOnSocket:socket]);
+
+    socket = [ONTCPSocket tcpSocket];
+    [socket setUsesNagleDelay:YES];
+    [socket connectToAddressFromArray:@[[self _refusingAddress], [self _acceptingAddress]]];
+    [keptSockets addObject:socket];
+    XCTAssertFalse([self _isTCPOption:TCP_NODELAY setOnSocket:socket]);
+}
+
+@end
@@ -0,0 +1,129 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniNetworking/OmniNetworking.h>
+
+#import <Foundation/Foundation.h>
+#import <OmniBase/OmniBase.h>
+#import <XCTest/XCTest.h>
+#include <stdatomic.h>
+
+RCS_ID("$Id$");
+
+// Runs bursts of name lookups from many threads against a stub resolver that takes a while to answer and fails for some names, and reports lookups per second and how many queries actually reached the resolver. Results are logged rather than asserted since they depend on the machine.
+
+@interface ONHostLookupBenchmarks : XCTestCase
+@end
+
+@implementation ONHostLookupBenchmarks
+
+static const NSUInteger ONHostLookupBenchmarkThreadCount = 16;
+static const NSUInteger ONHostLookupBenchmarkLookupsPerThread = 20000;
+static const NSUInteger ONHostLookupBenchmarkNameCount = 500;
+static const NSUInteger ONHostLookupBenchmarkMissingNameInterval = 10; // Every tenth name doesn't exist
+static const NSTimeInterval ONHostLookupBenchmarkResolverLatency = 0.02;
+static const NSTimeInterval ONHostLookupBenchmarkMissingLatency = 0.5; // As if waiting out a timeout
+
+static atomic_uint resolverCallCount;
+static atomic_uint failureCount;
+
+- (void)setUp;
+{
+    atomic_store(&resolverCallCount, 0);
+    [ONHost setResolver:^NSArray *(NSString *hostname, NSTimeInterval *timeToLive) {
+        atomic_fetch_add(&resolverCallCount, 1);
+        if ([hostname hasPrefix:@"missing"]) {
+            usleep((useconds_t)(ONHostLookupBenchmarkMissingLatency * 1e6));
+            return nil;
+        }
+        usleep((useconds_t)(ONHostLookupBenchmarkResolverLatency * 1e6));
+        *timeToLive = 60.0;
+        return [NSArray arrayWithObject:[ONHostAddress hostAddressWithNumericString:@"192.0.2.1"]];
+    }];
+}
+
+- (void)tearDown;
+{
+    [ONHost setResolver:nil];
+}
+
+// Names come in a few capitalizations, as they do from URLs and headers.
+static NSArray *_hostnames(void)
+{
+    NSMutableArray *hostnames = [NSMutableArray array];
+    for (NSUInteger nameIndex = 0; nameIndex < ONHostLookupBenchmarkNameCount; nameIndex++) {
+        NSString *hostname;
+        if (nameIndex % ONHostLookupBenchmarkMissingNameInterval == 0)
+            hostname = [NSString stringWithFormat:@"missing%lu.example.test", nameIndex];
+        else
+            hostname = [NSString stringWithFormat:@"www%lu.example.test", nameIndex];
+        [hostnames addObject:hostname];
+        [hostnames addObject:[hostname uppercaseString]];
+        [hostnames addObject:[hostname capitalizedString]];
+    }
+    return hostnames;
+}
+
+static void _logRate(NSString *title, NSUInteger lookupCount, CFAbsoluteTime elapsed)
+{
+    NSLog(@"%@: %lu lookups in %.3fs, %.0f lookups/s, %u resolver queries", title, lookupCount, elapsed, elapsed > 0 ? lookupCount / elapsed : 0.0, atomic_load(&resolverCallCount));
+}
+
+- (void)testBlockingLookups;
+{
+    NSArray *hostnames = _hostnames();
+    NSUInteger hostnameCount = [hostnames count];
+    dispatch_group_t threads = dispatch_group_create();
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger threadIndex = 0; threadIndex < ONHostLookupBenchmarkThreadCount; threadIndex++) {
+        dispatch_group_enter(threads);
+        [NSThread detachNewThreadWithBlock:^{
+            for (NSUInteger lookupIndex = 0; lookupIndex < ONHostLookupBenchmarkLookupsPerThread; lookupIndex++) {
+                NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+                @try {
+                    [ONHost hostForHostname:[hostnames objectAtIndex:(threadIndex * 7919 + lookupIndex) % hostnameCount]];
+                } @catch (NSException *exception) {
+                    // Expected for the missing names
+                }
+                [pool release];
+            }
+            dispatch_group_leave(threads);
+        }];
+    }
+    dispatch_group_wait(threads, DISPATCH_TIME_FOREVER);
+    _logRate(@"+hostForHostname:", ONHostLookupBenchmarkThreadCount * ONHostLookupBenchmarkLookupsPerThread, CFAbsoluteTimeGetCurrent() - start);
+    dispatch_release(threads);
+}
+
+- (void)testAsynchronousLookups;
+{
+    NSArray *hostnames = _hostnames();
+    NSUInteger hostnameCount = [hostnames count];
+    NSUInteger lookupCount = ONHostLookupBenchmarkThreadCount * ONHostLookupBenchmarkLookupsPerThread;
+    dispatch_group_t lookups = dispatch_group_create();
+    atomic_store(&failureCount, 0);
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger lookupIndex = 0; lookupIndex < lookupCount; lookupIndex++) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        dispatch_group_enter(lookups);
+        [ONHost lookupHostname:[hostnames objectAtIndex:(lookupIndex * 7919) % hostnameCount] completionHandler:^(ONHost *host, NSException *exception) {
+            if (exception != nil)
+                atomic_fetch_add(&failureCount, 1);
+            dispatch_group_leave(lookups);
+        }];
+        [pool release];
+    }
+    CFAbsoluteTime issued = CFAbsoluteTimeGetCurrent() - start;
+    dispatch_group_wait(lookups, DISPATCH_TIME_FOREVER);
+    _logRate(@"+lookupHostname:completionHandler:", lookupCount, CFAbsoluteTimeGetCurrent() - start);
+    NSLog(@"    issued in %.3fs, %u failed", issued, atomic_load(&failureCount));
+    dispatch_release(lookups);
+}
+
+@end
@@ -0,0 +1,157 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniNetworking/OmniNetworking.h>
+
+#import <Foundation/Foundation.h>
+#import <OmniBase/OmniBase.h>
+#import <XCTest/XCTest.h>
+#include <stdatomic.h>
+
+RCS_ID("$Id$");
+
+// Tests the name cache and asynchronous lookups against a stub resolver.
+
+@interface ONHostLookupTests : XCTestCase
+@end
+
+@implementation ONHostLookupTests
+
+static atomic_uint resolverCallCount;
+
+// Names starting with "missing" don't exist; everything else resolves to 192.0.2.1 after the given delay.
+static void _useStubResolver(NSTimeInterval latency, NSTimeInterval timeToLive)
+{
+    atomic_store(&resolverCallCount, 0);
+    [ONHost setResolver:^NSArray *(NSString *hostname, NSTimeInterval *outTimeToLive) {
+        atomic_fetch_add(&resolverCallCount, 1);
+        if (latency > 0)
+            usleep((useconds_t)(latency * 1e6));
+        if ([hostname hasPrefix:@"missing"])
+            return nil;
+        *outTimeToLive = timeToLive;
+        return [NSArray arrayWithObject:[ONHostAddress hostAddressWithNumericString:@"192.0.2.1"]];
+    }];
+}
+
+- (void)tearDown;
+{
+    [ONHost setResolver:nil];
+    [ONHost setNegativeTimeToLiveTimeInterval:5.0];
+}
+
+- (void)testCaseVariantsShareAnEntry;
+{
+    _useStubResolver(0, 60.0);
+
+    ONHost *host = [ONHost hostForHostname:@"Www.Example.TEST"];
+    XCTAssertEqualObjects([host hostname], @"www.example.test");
+    XCTAssertEqual([ONHost hostForHostname:@"www.example.test"], host);
+    XCTAssertEqual([ONHost hostForHostname:@"WWW.EXAMPLE.TEST"], host);
+    XCTAssertEqual(atomic_load(&resolverCallCount), 1U);
+}
+
+- (void)testFailuresAreRememberedBriefly;
+{
+    _useStubResolver(0, 60.0);
+    [ONHost setNegativeTimeToLiveTimeInterval:0.2];
+
+    XCTAssertThrowsSpecificNamed([ONHost hostForHostname:@"missing.example.test"], NSException, ONHostNotFoundExceptionName);
+    XCTAssertThrowsSpecificNamed([ONHost hostForHostname:@"Missing.Example.Test"], NSException, ONHostNotFoundExceptionName);
+    XCTAssertEqual(atomic_load(&resolverCallCount), 1U);
+
+    usleep(300000);
+    XCTAssertThrowsSpecificNamed([ONHost hostForHostname:@"missing.example.test"], NSException, ONHostNotFoundExceptionName);
+    XCTAssertEqual(atomic_load(&resolverCallCount), 2U);
+}
+
+- (void)testCacheEvictsOldestAnswersWhenFull;
+{
+    _useStubResolver(0, 3600.0);
+
+    // Enough names to overfill every stripe of the cache twice over, none of which expire during the test
+    static const NSUInteger nameCount = 32768;
+    NSUInteger nameIndex;
+
+    for (nameIndex = 0; nameIndex < nameCount; nameIndex++) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        [ONHost hostForHostname:[NSString stringWithFormat:@"host%lu.example.test", nameIndex]];
+        [pool release];
+    }
+    XCTAssertEqual(atomic_load(&resolverCallCount), (unsigned int)nameCount);
+
+    // The most recent answer is still cached, but the first has made way for later ones
+    [ONHost hostForHostname:[NSString stringWithFormat:@"host%lu.example.test", nameCount - 1]];
+    XCTAssertEqual(atomic_load(&resolverCallCount), (unsigned int)nameCount);
+    [ONHost hostForHostname:@"host0.example.test"];
+    XCTAssertEqual(atomic_load(&resolverCallCount), (unsigned int)nameCount + 1);
+
+    [ONHost flushCache];
+}
+
+- (void)testConcurrentLookupsShareOneQuery;
+{
+    _useStubResolver(0.1, 60.0);
+
+    static const NSUInteger lookupCount = 20;
+    dispatch_group_t lookups = dispatch_group_create();
+    ONHost **hosts = calloc(lookupCount, sizeof(*hosts));
+    NSUInteger lookupIndex;
+
+    for (lookupIndex = 0; lookupIndex < lookupCount; lookupIndex++) {
+        NSUInteger thisIndex = lookupIndex;
+        dispatch_group_enter(lookups);
+        [ONHost lookupHostname:@"slow.example.test" completionHandler:^(ONHost *host, NSException *exception) {
+            hosts[thisIndex] = [host retain];
+            dispatch_group_leave(lookups);
+        }];
+    }
+    // A blocking lookup of the same name waits for the same answer
+    ONHost *blockingHost = [ONHost hostForHostname:@"slow.example.test"];
+
+    XCTAssertEqual(dispatch_group_wait(lookups, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0L);
+    XCTAssertEqual(atomic_load(&resolverCallCount), 1U);
+    for (lookupIndex = 0; lookupIndex < lookupCount; lookupIndex++) {
+        XCTAssertEqual(hosts[lookupIndex], blockingHost);
+        [hosts[lookupIndex] release];
+    }
+    free(hosts);
+    dispatch_release(lookups);
+}
+
+- (void)testAsynchronousFailure;
+{
+    _useStubResolver(0, 60.0);
+
+    dispatch_semaphore_t finished = dispatch_semaphore_create(0);
+    __block NSString *exceptionName = nil;
+    [ONHost lookupHostname:@"missing-async.example.test" completionHandler:^(ONHost *host, NSException *exception) {
+        exceptionName = [[exception name] copy];
+        dispatch_semaphore_signal(finished);
+    }];
+    XCTAssertEqual(dispatch_semaphore_wait(finished, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0L);
+    XCTAssertEqualObjects(exceptionName, ONHostNotFoundExceptionName);
+    [exceptionName release];
+    dispatch_release(finished);
+}
+
+- (void)testAnswersAreRefreshedBeforeTheyExpire;
+{
+    _useStubResolver(0, 0.5);
+
+    ONHost *host = [ONHost hostForHostname:@"refresh.example.test"];
+    usleep(450000); // Past the refresh point, but not expired
+
+    XCTAssertEqual([ONHost hostForHostname:@"refresh.example.test"], host);
+    usleep(100000);
+    XCTAssertEqual(atomic_load(&resolverCallCount), 2U);
+    ONHost *refreshedHost = [ONHost hostForHostname:@"refresh.example.test"];
+    XCTAssertNotEqual(refreshedHost, host);
+    XCTAssertEqual(atomic_load(&resolverCallCount), 2U);
+}
+
+@end
@@ -0,0 +1,170 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniNetworking/OmniNetworking.h>
+
+#import <Foundation/Foundation.h>
+#import <OmniBase/OmniBase.h>
+#import <XCTest/XCTest.h>
+#import "ONInterfaceMonitor-InternalAPI.h"
+#include <net/if.h>
+#include <stdatomic.h>
+
+RCS_ID("$Id$");
+
+// Times interface and name lookups from several threads while another thread adds and removes addresses as fast as it can, first with the monitor's incremental updates and then the way it used to be done, rescanning the interfaces and flushing ONHost's caches on every change. Results are logged rather than asserted since they depend on the machine.
+
+@interface ONInterfaceMonitorBenchmarks : XCTestCase
+@end
+
+@implementation ONInterfaceMonitorBenchmarks
+
+static const NSUInteger ONInterfaceMonitorBenchmarkLinkCount = 32;
+static const NSUInteger ONInterfaceMonitorBenchmarkAddressesPerLink = 4;
+static const NSUInteger ONInterfaceMonitorBenchmarkChangeCount = 5000;
+static const NSUInteger ONInterfaceMonitorBenchmarkLookupThreadCount = 4;
+static const NSUInteger ONInterfaceMonitorBenchmarkLookupsPerThread = 20000;
+static const NSUInteger ONInterfaceMonitorBenchmarkNameCount = 100;
+static const NSTimeInterval ONInterfaceMonitorBenchmarkResolverLatency = 0.001;
+
+static atomic_uint resolverCallCount;
+static atomic_bool lookingUp;
+
+- (void)setUp;
+{
+    atomic_store(&resolverCallCount, 0);
+    [ONHost setResolver:^NSArray *(NSString *hostname, NSTimeInterval *timeToLive) {
+        atomic_fetch_add(&resolverCallCount, 1);
+        usleep((useconds_t)(ONInterfaceMonitorBenchmarkResolverLatency * 1e6));
+        *timeToLive = 600.0;
+        return [NSArray arrayWithObject:[ONHostAddress hostAddressWithNumericString:@"203.0.113.5"]];
+    }];
+}
+
+- (void)tearDown;
+{
+    [ONHost setResolver:nil];
+}
+
+static ONHostAddress *_linkAddress(NSUInteger linkIndex, NSUInteger addressIndex)
+{
+    return [ONHostAddress hostAddressWithNumericString:[NSString stringWithFormat:@"10.%lu.%lu.1", linkIndex, addressIndex]];
+}
+
+static ONInterfaceMonitor *_populatedMonitor(void)
+{
+    ONInterfaceMonitor *monitor = [[[ONInterfaceMonitor alloc] _initWithoutSource] autorelease];
+
+    [monitor _beginChanges];
+    for (NSUInteger linkIndex = 1; linkIndex <= ONInterfaceMonitorBenchmarkLinkCount; linkIndex++) {
+        [monitor _setLinkWithIndex:(unsigned int)linkIndex name:[NSString stringWithFormat:@"en%lu", linkIndex] flags:IFF_UP | IFF_BROADCAST interfaceType:0x6 maximumTransmissionUnit:1500];
+        for (NSUInteger addressIndex = 0; addressIndex < ONInterfaceMonitorBenchmarkAddressesPerLink; addressIndex++)
+            [monitor _addAddress:_linkAddress(linkIndex, addressIndex) netmask:[ONHostAddress hostAddressWithNumericString:@"255.255.255.0"] remoteAddress:nil toLinkWithIndex:(unsigned int)linkIndex];
+    }
+    [monitor _endChanges];
+    return monitor;
+}
+
+static int _compareDoubles(const void *a, const void *b)
+{
+    double first = *(const double *)a, second = *(const double *)b;
+    return first < second ? -1 : (first > second ? 1 : 0);
+}
+
+// Each lookup asks which interface has an address, then looks up a name, as a connection being set up would. The change block runs on its own thread until the lookups are done or it has made ONInterfaceMonitorBenchmarkChangeCount changes.
+static void _timeLookupsDuringChanges(NSString *title, ONInterface *(^interfaceLookup)(ONHostAddress *address), void (^change)(NSUInteger changeIndex))
+{
+    NSUInteger lookupCount = ONInterfaceMonitorBenchmarkLookupThreadCount * ONInterfaceMonitorBenchmarkLookupsPerThread;
+    double *times = calloc(lookupCount, sizeof(*times));
+    __block NSUInteger changeCount = 0;
+    dispatch_group_t threads = dispatch_group_create();
+
+    for (NSUInteger nameIndex = 0; nameIndex < ONInterfaceMonitorBenchmarkNameCount; nameIndex++)
+        [ONHost hostForHostname:[NSString stringWithFormat:@"host%lu.example.test", nameIndex]];
+    atomic_store(&resolverCallCount, 0);
+    atomic_store(&lookingUp, YES);
+
+    dispatch_group_enter(threads);
+    [NSThread detachNewThreadWithBlock:^{
+        while (atomic_load(&lookingUp) && changeCount < ONInterfaceMonitorBenchmarkChangeCount) {
+            NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+            change(changeCount++);
+            [pool release];
+        }
+        dispatch_group_leave(threads);
+    }];
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    dispatch_group_t lookupThreads = dispatch_group_create();
+    for (NSUInteger threadIndex = 0; threadIndex < ONInterfaceMonitorBenchmarkLookupThreadCount; threadIndex++) {
+        dispatch_group_enter(lookupThreads);
+        [NSThread detachNewThreadWithBlock:^{
+            for (NSUInteger lookupIndex = 0; lookupIndex < ONInterfaceMonitorBenchmarkLookupsPerThread; lookupIndex++) {
+                NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+                NSUInteger linkIndex = 1 + (threadIndex * 7919 + lookupIndex) % ONInterfaceMonitorBenchmarkLinkCount;
+                CFAbsoluteTime lookupStart = CFAbsoluteTimeGetCurrent();
+                interfaceLookup(_linkAddress(linkIndex, ONInterfaceMonitorBenchmarkAddressesPerLink - 1));
+                [ONHost hostForHostname:[NSString stringWithFormat:@"host%lu.example.test", lookupIndex % ONInterfaceMonitorBenchmarkNameCount]];
+                times[threadIndex * ONInterfaceMonitorBenchmarkLookupsPerThread + lookupIndex] = CFAbsoluteTimeGetCurrent() - lookupStart;
+                [pool release];
+            }
+            dispatch_group_leave(lookupThreads);
+        }];
+    }
+    dispatch_group_wait(lookupThreads, DISPATCH_TIME_FOREVER);
+    CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+    atomic_store(&lookingUp, NO);
+    dispatch_group_wait(threads, DISPATCH_TIME_FOREVER);
+
+    qsort(times, lookupCount, sizeof(*times), _compareDoubles);
+    NSLog(@"%@: %lu lookups in %.3fs during %lu changes, p50 %.1fus, p99 %.1fus, max %.1fus, %u resolver queries", title, lookupCount, elapsed, changeCount,
+          times[lookupCount / 2] * 1e6, times[(lookupCount * 99) / 100] * 1e6, times[lookupCount - 1] * 1e6, atomic_load(&resolverCallCount));
+
+    free(times);
+    dispatch_release(lookupThreads);
+    dispatch_release(threads);
+}
+
+- (void)testLookupsDuringChangeStorm;
+{
+    // Only the addresses on the first link come and go; the lookups are for the last address of every link
+    ONInterfaceMonitor *monitor = _populatedMonitor();
+    _timeLookupsDuringChanges(@"incremental", ^ONInterface *(ONHostAddress *address) {
+        return [monitor interfaceWithAddress:address];
+    }, ^(NSUInteger changeIndex) {
+        ONHostAddress *address = _linkAddress(1, changeIndex % (ONInterfaceMonitorBenchmarkAddressesPerLink - 1));
+        if ((changeIndex / (ONInterfaceMonitorBenchmarkAddressesPerLink - 1)) % 2 == 0)
+            [monitor _removeAddress:address fromLinkWithIndex:1];
+        else
+            [monitor _addAddress:address netmask:nil remoteAddress:nil toLinkWithIndex:1];
+    });
+
+    // What a change used to cost: every change rescans the interfaces and throws away all of ONHost's cached lookups. The lookups scan the real interfaces, where the address won't be found, which is the same amount of work.
+    NSLock *interfacesLock = [[NSLock alloc] init];
+    __block NSArray *interfaces = [[ONInterface getInterfaces:YES] retain];
+    _timeLookupsDuringChanges(@"rescan and flush", ^ONInterface *(ONHostAddress *address) {
+        [interfacesLock lock];
+        NSArray *snapshot = [[interfaces retain] autorelease];
+        [interfacesLock unlock];
+        for (ONInterface *interface in snapshot) {
+            if ([[interface addresses] containsObject:address])
+                return interface;
+        }
+        return nil;
+    }, ^(NSUInteger changeIndex) {
+        NSArray *rescanned = [[ONInterface getInterfaces:YES] retain];
+        [interfacesLock lock];
+        [interfaces release];
+        interfaces = rescanned;
+        [interfacesLock unlock];
+        [ONHost flushCache];
+    });
+    [interfaces release];
+    [interfacesLock release];
+}
+
+@end
@@ -0,0 +1,297 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniNetworking/OmniNetworking.h>
+
+#import <Foundation/Foundation.h>
+#import <OmniBase/OmniBase.h>
+#import <XCTest/XCTest.h>
+#import "ONInterfaceMonitor-InternalAPI.h"
+#include <net/if.h>
+#include <stdatomic.h>
+
+#if defined(__linux__)
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if_arp.h>
+#endif
+
+RCS_ID("$Id$");
+
+// Tests the interface monitor's table and ONHost's cache invalidation, with the tests playing the part of the kernel.
+
+@interface ONInterfaceMonitorTests : XCTestCase
+{
+    ONInterfaceMonitor *monitor;
+    NSMutableArray *notifications;
+    id observer;
+}
+@end
+
+@implementation ONInterfaceMonitorTests
+
+static atomic_uint resolverCallCount;
+
+#define LOOPBACK_INDEX (1)
+#define ETHERNET_INDEX (2)
+#define WIRELESS_INDEX (3)
+
+static ONHostAddress *_address(NSString *string)
+{
+    return [ONHostAddress hostAddressWithNumericString:string];
+}
+
+- (void)setUp;
+{
+    monitor = [[ONInterfaceMonitor alloc] _initWithoutSource];
+    notifications = [[NSMutableArray alloc] init];
+    observer = [[[NSNotificationCenter defaultCenter] addObserverForName:ONInterfaceMonitorInterfacesDidChangeNotification object:monitor queue:nil usingBlock:^(NSNotification *notification) {
+        [notifications addObject:notification];
+    }] retain];
+
+    [monitor _beginChanges];
+    [monitor _setLinkWithIndex:LOOPBACK_INDEX name:@"lo0" flags:IFF_UP | IFF_LOOPBACK interfaceType:0x18 maximumTransmissionUnit:16384];
+    [monitor _addAddress:_address(@"127.0.0.1") netmask:_address(@"255.0.0.0") remoteAddress:nil toLinkWithIndex:LOOPBACK_INDEX];
+    [monitor _setLinkWithIndex:ETHERNET_INDEX name:@"en0" flags:IFF_UP | IFF_BROADCAST interfaceType:0x6 maximumTransmissionUnit:1500];
+    [monitor _setLinkWithIndex:WIRELESS_INDEX name:@"en1" flags:IFF_UP | IFF_BROADCAST interfaceType:0x6 maximumTransmissionUnit:1500];
+    [monitor _endChanges];
+    [notifications removeAllObjects];
+}
+
+- (void)tearDown;
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:observer];
+    [observer release];
+    observer = nil;
+    [notifications release];
+    notifications = nil;
+    [monitor release];
+    monitor = nil;
+    [ONHost setResolver:nil];
+}
+
+- (void)testSharedMonitorIsStartedWhenNeeded;
+{
+    // Nothing here starts the shared monitor explicitly; asking for the interfaces does
+    NSArray *interfaces = [ONInterface interfaces];
+    ONInterfaceMonitor *sharedMonitor = [ONInterfaceMonitor _runningMonitor];
+    if (sharedMonitor == nil) {
+        // Without a routing socket to listen to, everything goes on scanning the interfaces
+        XCTAssertNil([ONInterfaceMonitor sharedMonitor]);
+        XCTAssertGreaterThan([interfaces count], 0UL);
+        return;
+    }
+
+    XCTAssertEqual([ONInterfaceMonitor sharedMonitor], sharedMonitor);
+    XCTAssertNotEqual(sharedMonitor, monitor);
+    XCTAssertEqualObjects(interfaces, [sharedMonitor interfaces]);
+
+    // Every machine has a loopback address, which the shared monitor's table answers for
+    ONHostAddress *loopbackAddress = _address(@"127.0.0.1");
+    XCTAssertNotNil([sharedMonitor interfaceWithAddress:loopbackAddress]);
+    XCTAssertTrue([loopbackAddress isLocalInterfaceAddress]);
+    XCTAssertFalse([_address(@"192.0.2.200") isLocalInterfaceAddress]);
+}
+
+- (void)testTableFollowsChanges;
+{
+    [monitor _addAddress:_address(@"192.0.2.10") netmask:_address(@"255.255.255.0") remoteAddress:_address(@"192.0.2.255") toLinkWithIndex:ETHERNET_INDEX];
+
+    NSArray *interfaces = [monitor interfaces];
+    XCTAssertEqual([interfaces count], 3UL);
+    XCTAssertEqualObjects([[interfaces valueForKey:@"name"] componentsJoinedByString:@","], @"lo0,en0,en1");
+
+    ONInterface *ethernet = [monitor interfaceWithIndex:ETHERNET_INDEX];
+    XCTAssertEqualObjects([ethernet name], @"en0");
+    XCTAssertEqualObjects([ethernet addresses], @[_address(@"192.0.2.10")]);
+    XCTAssertEqualObjects([ethernet netmaskAddressForAddress:_address(@"192.0.2.10")], _address(@"255.255.255.0"));
+    XCTAssertEqualObjects([ethernet broadcastAddressForAddress:_address(@"192.0.2.10")], _address(@"192.0.2.255"));
+    XCTAssertEqual([ethernet interfaceCategory], ONEtherInterfaceCategory);
+    XCTAssertEqual([ethernet maximumTransmissionUnit], 1500U);
+    XCTAssertEqual([monitor interfaceWithAddress:_address(@"192.0.2.10")], ethernet);
+    XCTAssertEqual([[monitor interfaceWithIndex:LOOPBACK_INDEX] interfaceCategory], ONLoopbackInterfaceCategory);
+
+    [monitor _removeAddress:_address(@"192.0.2.10") fromLinkWithIndex:ETHERNET_INDEX];
+    XCTAssertNil([monitor interfaceWithAddress:_address(@"192.0.2.10")]);
+    XCTAssertEqualObjects([[monitor interfaceWithIndex:ETHERNET_INDEX] addresses], @[]);
+
+    [monitor _removeLinkWithIndex:WIRELESS_INDEX];
+    XCTAssertNil([monitor interfaceWithIndex:WIRELESS_INDEX]);
+    XCTAssertEqual([[monitor interfaces] count], 2UL);
+
+    // Addresses for a link that's already gone are ignored
+    [monitor _addAddress:_address(@"198.51.100.7") netmask:nil remoteAddress:nil toLinkWithIndex:WIRELESS_INDEX];
+    XCTAssertNil([monitor interfaceWithAddress:_address(@"198.51.100.7")]);
+}
+
+- (void)testUnchangedInterfacesKeepTheirIdentity;
+{
+    NSArray *before = [monitor interfaces];
+    [monitor _addAddress:_address(@"198.51.100.7") netmask:_address(@"255.255.255.0") remoteAddress:nil toLinkWithIndex:WIRELESS_INDEX];
+    NSArray *after = [monitor interfaces];
+
+    XCTAssertNotEqual(before, after);
+    XCTAssertEqual([before objectAtIndex:0], [after objectAtIndex:0]);
+    XCTAssertEqual([before objectAtIndex:1], [after objectAtIndex:1]);
+    XCTAssertNotEqual([before objectAtIndex:2], [after objectAtIndex:2]);
+
+    // Repeating what the table already says isn't a change
+    [monitor _setLinkWithIndex:WIRELESS_INDEX name:@"en1" flags:IFF_UP | IFF_BROADCAST interfaceType:0x6 maximumTransmissionUnit:1500];
+    [monitor _addAddress:_address(@"198.51.100.7") netmask:_address(@"255.255.255.0") remoteAddress:nil toLinkWithIndex:WIRELESS_INDEX];
+    XCTAssertEqual([monitor interfaces], after);
+    XCTAssertEqual([notifications count], 1UL);
+}
+
+- (void)testChangesArePostedInBatches;
+{
+    [monitor _beginChanges];
+    [monitor _addAddress:_address(@"192.0.2.10") netmask:nil remoteAddress:nil toLinkWithIndex:ETHERNET_INDEX];
+    [monitor _addAddress:_address(@"192.0.2.11") netmask:nil remoteAddress:nil toLinkWithIndex:ETHERNET_INDEX];
+    [monitor _setLinkWithIndex:WIRELESS_INDEX name:@"en1" flags:IFF_BROADCAST interfaceType:0x6 maximumTransmissionUnit:1500];
+    XCTAssertEqual([notifications count], 0UL);
+    [monitor _endChanges];
+
+    XCTAssertEqual([notifications count], 1UL);
+    NSDictionary *userInfo = [[notifications lastObject] userInfo];
+    XCTAssertEqualObjects([userInfo objectForKey:ONInterfaceMonitorChangedInterfaceNamesKey], ([NSSet setWithObjects:@"en0", @"en1", nil]));
+    XCTAssertEqualObjects([userInfo objectForKey:ONInterfaceMonitorAddedAddressesKey], ([NSSet setWithObjects:_address(@"192.0.2.10"), _address(@"192.0.2.11"), nil]));
+    XCTAssertEqualObjects([userInfo objectForKey:ONInterfaceMonitorRemovedAddressesKey], [NSSet set]);
+    XCTAssertTrue([[userInfo objectForKey:ONInterfaceMonitorConfiguredAddressFamiliesChangedKey] boolValue]);
+
+    // Removing a link takes its addresses with it
+    [monitor _removeLinkWithIndex:ETHERNET_INDEX];
+    userInfo = [[notifications lastObject] userInfo];
+    XCTAssertEqualObjects([userInfo objectForKey:ONInterfaceMonitorRemovedAddressesKey], ([NSSet setWithObjects:_address(@"192.0.2.10"), _address(@"192.0.2.11"), nil]));
+    XCTAssertTrue([[userInfo objectForKey:ONInterfaceMonitorConfiguredAddressFamiliesChangedKey] boolValue]);
+}
+
+- (void)testOnlyLosingOrGainingAnAddressFamilyFlushesTheNameCache;
+{
+    atomic_store(&resolverCallCount, 0);
+    [ONHost setResolver:^NSArray *(NSString *hostname, NSTimeInterval *timeToLive) {
+        atomic_fetch_add(&resolverCallCount, 1);
+        *timeToLive = 60.0;
+        return [NSArray arrayWithObject:_address(@"203.0.113.5")];
+    }];
+
+    [monitor _addAddress:_address(@"192.0.2.10") netmask:nil remoteAddress:nil toLinkWithIndex:ETHERNET_INDEX];
+    [ONHost hostForHostname:@"www.example.test"];
+    XCTAssertEqual(atomic_load(&resolverCallCount), 1U);
+
+    // Another IPv4 address, or an IPv6 link-local one, doesn't change what getaddrinfo() asks for
+    [monitor _addAddress:_address(@"198.51.100.7") netmask:nil remoteAddress:nil toLinkWithIndex:WIRELESS_INDEX];
+    [monitor _addAddress:_address(@"fe80::1") netmask:nil remoteAddress:nil toLinkWithIndex:ETHERNET_INDEX];
+    [monitor _removeAddress:_address(@"192.0.2.10") fromLinkWithIndex:ETHERNET_INDEX];
+    [ONHost hostForHostname:@"www.example.test"];
+    XCTAssertEqual(atomic_load(&resolverCallCount), 1U);
+    XCTAssertFalse([[[[notifications lastObject] userInfo] objectForKey:ONInterfaceMonitorConfiguredAddressFamiliesChangedKey] boolValue]);
+
+    // The first global IPv6 address does
+    [monitor _addAddress:_address(@"2001:db8::10") netmask:nil remoteAddress:nil toLinkWithIndex:ETHERNET_INDEX];
+    [ONHost hostForHostname:@"www.example.test"];
+    XCTAssertEqual(atomic_load(&resolverCallCount), 2U);
+
+    // As does losing the last IPv4 one
+    [monitor _removeLinkWithIndex:WIRELESS_INDEX];
+    [ONHost hostForHostname:@"www.example.test"];
+    XCTAssertEqual(atomic_load(&resolverCallCount), 3U);
+}
+
+#if defined(__linux__)
+
+static void _appendAttribute(NSMutableData *message, unsigned short type, const void *bytes, size_t length)
+{
+    struct rtattr attribute;
+    attribute.rta_len = RTA_LENGTH(length);
+    attribute.rta_type = type;
+    [message appendBytes:&attribute length:sizeof(attribute)];
+    [message appendBytes:bytes length:length];
+    [message increaseLengthBy:RTA_SPACE(length) - RTA_LENGTH(length)];
+}
+
+static NSMutableData *_beginMessage(unsigned short type, const void *header, size_t headerLength)
+{
+    struct nlmsghdr messageHeader;
+    bzero(&messageHeader, sizeof(messageHeader));
+    messageHeader.nlmsg_type = type;
+    NSMutableData *message = [NSMutableData dataWithBytes:&messageHeader length:sizeof(messageHeader)];
+    [message appendBytes:header length:headerLength];
+    [message increaseLengthBy:NLMSG_ALIGN(headerLength) - headerLength];
+    return message;
+}
+
+static void _endMessage(NSMutableData *buffer, NSMutableData *message)
+{
+    ((struct nlmsghdr *)[message mutableBytes])->nlmsg_len = (unsigned int)[message length];
+    [buffer appendData:message];
+    [buffer increaseLengthBy:NLMSG_ALIGN([message length]) - [message length]];
+}
+
+- (void)testNetlinkMessages;
+{
+    NSMutableData *buffer = [NSMutableData data];
+
+    struct ifinfomsg link;
+    bzero(&link, sizeof(link));
+    link.ifi_family = AF_UNSPEC;
+    link.ifi_type = ARPHRD_ETHER;
+    link.ifi_index = 7;
+    link.ifi_flags = IFF_UP | IFF_BROADCAST;
+    NSMutableData *message = _beginMessage(RTM_NEWLINK, &link, sizeof(link));
+    _appendAttribute(message, IFLA_IFNAME, "eth7", 5);
+    uint32_t mtu = 9000;
+    _appendAttribute(message, IFLA_MTU, &mtu, sizeof(mtu));
+    _endMessage(buffer, message);
+
+    struct ifaddrmsg address;
+    bzero(&address, sizeof(address));
+    address.ifa_family = AF_INET;
+    address.ifa_prefixlen = 20;
+    address.ifa_index = 7;
+    message = _beginMessage(RTM_NEWADDR, &address, sizeof(address));
+    unsigned char local[4] = {10, 1, 2, 3}, broadcast[4] = {10, 1, 15, 255};
+    _appendAttribute(message, IFA_ADDRESS, local, sizeof(local));
+    _appendAttribute(message, IFA_LOCAL, local, sizeof(local));
+    _appendAttribute(message, IFA_BROADCAST, broadcast, sizeof(broadcast));
+    _endMessage(buffer, message);
+
+    address.ifa_family = AF_INET6;
+    address.ifa_prefixlen = 64;
+    message = _beginMessage(RTM_NEWADDR, &address, sizeof(address));
+    unsigned char global[16] = {0x20, 0x01, 0x0d, 0xb8, [15] = 0x07};
+    _appendAttribute(message, IFA_ADDRESS, global, sizeof(global));
+    _endMessage(buffer, message);
+
+    XCTAssertFalse([monitor _handleNetlinkMessages:[buffer bytes] length:[buffer length]]);
+    XCTAssertEqual([notifications count], 1UL);
+
+    ONInterface *interface = [monitor interfaceWithIndex:7];
+    XCTAssertEqualObjects([interface name], @"eth7");
+    XCTAssertEqual([interface maximumTransmissionUnit], 9000U);
+    XCTAssertEqual([interface interfaceCategory], ONEtherInterfaceCategory);
+    XCTAssertTrue([interface isUp]);
+    XCTAssertEqualObjects([interface addresses], (@[_address(@"10.1.2.3"), _address(@"2001:db8::7")]));
+    XCTAssertEqualObjects([interface netmaskAddressForAddress:_address(@"10.1.2.3")], _address(@"255.255.240.0"));
+    XCTAssertEqualObjects([interface broadcastAddressForAddress:_address(@"10.1.2.3")], _address(@"10.1.15.255"));
+    XCTAssertEqualObjects([interface netmaskAddressForAddress:_address(@"2001:db8::7")], _address(@"ffff:ffff:ffff:ffff::"));
+
+    // Deleting the link, then the end of a dump
+    buffer = [NSMutableData data];
+    message = _beginMessage(RTM_DELLINK, &link, sizeof(link));
+    _endMessage(buffer, message);
+    int status = 0;
+    message = _beginMessage(NLMSG_DONE, &status, sizeof(status));
+    _endMessage(buffer, message);
+
+    XCTAssertTrue([monitor _handleNetlinkMessages:[buffer bytes] length:[buffer length]]);
+    XCTAssertNil([monitor interfaceWithIndex:7]);
+    XCTAssertNil([monitor interfaceWithAddress:_address(@"10.1.2.3")]);
+}
+
+#endif
+
+@end
@@ -0,0 +1,228 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniNetworking/OmniNetworking.h>
+
+#import <Foundation/Foundation.h>
+#import <OmniBase/OmniBase.h>
+#import <XCTest/XCTest.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+RCS_ID("$Id$");
+
+// Runs an echo server and many echo clients over loopback on one ONSocketReactor, with every connection open at once, and reports round trips per second and round-trip latency percentiles. Results are logged rather than asserted since they depend on the machine.
+
+@interface ONSocketReactorBenchmarks : XCTestCase
+@end
+
+static const NSUInteger ONSocketReactorBenchmarkConnectionCount = 10000;
+static const NSUInteger ONSocketReactorBenchmarkRoundTrips = 20;         // per connection
+static const NSUInteger ONSocketReactorBenchmarkMessageLength = 64;
+static const NSUInteger ONSocketReactorBenchmarkConnectsInFlight = 64;   // Stays within the listen backlog
+
+static double *latencies;
+static atomic_size_t latencyCount;
+static atomic_size_t finishedClientCount;
+static atomic_size_t failedConnectCount;
+static dispatch_semaphore_t allClientsFinished;
+static NSUInteger clientCount;
+
+@interface ONSocketReactorBenchmarkClient : NSObject
+{
+@public
+    ONSocketReactor *reactor;
+    ONTCPSocket *socket;
+    NSUInteger roundTripsLeft;
+    size_t bytesReceived;
+    CFAbsoluteTime sendTime;
+}
+- (void)sendMessage;
+@end
+
+static void _writeFully(ONTCPSocket *socket, const char *bytes, size_t length)
+{
+    while (length > 0) {
+        struct iovec vector = {(void *)bytes, length};
+        size_t bytesWritten;
+        if (![socket writeAvailableBuffers:&vector count:1 bytesWritten:&bytesWritten]) {
+            // Messages are small enough that this hardly ever happens on loopback.
+            sched_yield();
+            continue;
+        }
+        bytes += bytesWritten;
+        length -= bytesWritten;
+    }
+}
+
+@implementation ONSocketReactorBenchmarkClient
+
+- (void)dealloc;
+{
+    [socket release];
+    [reactor release];
+    [super dealloc];
+}
+
+- (void)sendMessage;
+{
+    char message[ONSocketReactorBenchmarkMessageLength];
+    memset(message, 'm', sizeof(message));
+
+    bytesReceived = 0;
+    sendTime = CFAbsoluteTimeGetCurrent();
+    _writeFully(socket, message, sizeof(message));
+    [self _watchForEcho];
+}
+
+- (void)_watchForEcho;
+{
+    [reactor watchSocket:socket forEvents:ONSocketReactorReadable timeout:0 handler:^(ONInternetSocket *readableSocket, ONSocketReactorEvents events) {
+        char buffer[ONSocketReactorBenchmarkMessageLength];
+        size_t bytesRead;
+
+        while (bytesReceived < ONSocketReactorBenchmarkMessageLength && [socket readAvailableBytes:ONSocketReactorBenchmarkMessageLength - bytesReceived intoBuffer:buffer bytesRead:&bytesRead] && bytesRead != 0)
+            bytesReceived += bytesRead;
+        if (bytesReceived < ONSocketReactorBenchmarkMessageLength) {
+            [self _watchForEcho];
+            return;
+        }
+
+        latencies[atomic_fetch_add(&latencyCount, 1)] = CFAbsoluteTimeGetCurrent() - sendTime;
+        if (--roundTripsLeft > 0)
+            [self sendMessage];
+        else {
+            [socket abortSocket];
+            if (atomic_fetch_add(&finishedClientCount, 1) + 1 == clientCount)
+                dispatch_semaphore_signal(allClientsFinished);
+        }
+    }];
+}
+
+@end
+
+@implementation ONSocketReactorBenchmarks
+
+static void _serveEcho(ONSocketReactor *reactor, ONTCPSocket *connection)
+{
+    [reactor watchSocket:connection forEvents:ONSocketReactorReadable timeout:0 handler:^(ONInternetSocket *socket, ONSocketReactorEvents events) {
+        char buffer[4096];
+        size_t bytesRead;
+
+        while ([connection readAvailableBytes:sizeof(buffer) intoBuffer:buffer bytesRead:&bytesRead]) {
+            if (bytesRead == 0)
+                return; // The client is done
+            _writeFully(connection, buffer, bytesRead);
+        }
+        _serveEcho(reactor, connection);
+    }];
+}
+
+static int _compareDoubles(const void *a, const void *b)
+{
+    double first = *(const double *)a, second = *(const double *)b;
+    return first < second ? -1 : (first > second ? 1 : 0);
+}
+
+static double _percentile(const double *sortedValues, size_t count, double fraction)
+{
+    if (count == 0)
+        return 0.0;
+    size_t index = (size_t)ceil(fraction * count);
+    return sortedValues[index == 0 ? 0 : MIN(index, count) - 1];
+}
+
+// Each connection takes a descriptor at both ends.
+static NSUInteger _affordableConnectionCount(NSUInteger wanted)
+{
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0)
+        return 100;
+    rlim_t needed = 2 * wanted + 64;
+    if (limit.rlim_cur < needed) {
+        limit.rlim_cur = MIN(needed, limit.rlim_max);
+        setrlimit(RLIMIT_NOFILE, &limit);
+        getrlimit(RLIMIT_NOFILE, &limit);
+    }
+    return MIN(wanted, (NSUInteger)((limit.rlim_cur - 64) / 2));
+}
+
+- (void)testEchoAtManyConnections;
+{
+    clientCount = _affordableConnectionCount(ONSocketReactorBenchmarkConnectionCount);
+    if (clientCount < ONSocketReactorBenchmarkConnectionCount)
+        NSLog(@"Descriptor limit allows only %lu connections", clientCount);
+
+    ONSocketReactor *reactor = [[ONSocketReactor alloc] initWithCallbackThreadCount:MAX(2U, [[NSProcessInfo processInfo] activeProcessorCount])];
+    ONTCPSocket *listener = [ONTCPSocket tcpSocket];
+    [listener setAddressFamily:AF_INET];
+    [listener startListeningOnAnyLocalPort];
+    [reactor acceptConnectionsOnSocket:listener handler:^(ONTCPSocket *connection) {
+        _serveEcho(reactor, connection);
+    }];
+    ONPortAddress *serverAddress = [[[ONPortAddress alloc] initWithHostAddress:[ONHostAddress loopbackAddress] portNumber:[listener localAddressPort]] autorelease];
+
+    // Connect everyone first, so that all the connections are open for the whole run.
+    NSMutableArray *clients = [NSMutableArray array];
+    dispatch_semaphore_t connectSlots = dispatch_semaphore_create(ONSocketReactorBenchmarkConnectsInFlight);
+    dispatch_group_t connecting = dispatch_group_create();
+    atomic_store(&failedConnectCount, 0);
+    CFAbsoluteTime connectStart = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger clientIndex = 0; clientIndex < clientCount; clientIndex++) {
+        ONSocketReactorBenchmarkClient *client = [[ONSocketReactorBenchmarkClient alloc] init];
+        client->reactor = [reactor retain];
+        client->socket = [[ONTCPSocket tcpSocket] retain];
+        client->roundTripsLeft = ONSocketReactorBenchmarkRoundTrips;
+        [clients addObject:client];
+        [client release];
+
+        dispatch_semaphore_wait(connectSlots, DISPATCH_TIME_FOREVER);
+        dispatch_group_enter(connecting);
+        [reactor connectSocket:client->socket toPortAddress:serverAddress timeout:30.0 completionHandler:^(NSException *exception) {
+            if (exception != nil)
+                atomic_fetch_add(&failedConnectCount, 1);
+            dispatch_semaphore_signal(connectSlots);
+            dispatch_group_leave(connecting);
+        }];
+    }
+    dispatch_group_wait(connecting, DISPATCH_TIME_FOREVER);
+    NSLog(@"Connected %lu clients in %.3fs (%lu failed)", clientCount, CFAbsoluteTimeGetCurrent() - connectStart, (NSUInteger)atomic_load(&failedConnectCount));
+    XCTAssertEqual(atomic_load(&failedConnectCount), (size_t)0);
+
+    latencies = malloc(clientCount * ONSocketReactorBenchmarkRoundTrips * sizeof(*latencies));
+    atomic_store(&latencyCount, 0);
+    atomic_store(&finishedClientCount, 0);
+    allClientsFinished = dispatch_semaphore_create(0);
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (ONSocketReactorBenchmarkClient *client in clients)
+        [client sendMessage];
+    BOOL finished = dispatch_semaphore_wait(allClientsFinished, dispatch_time(DISPATCH_TIME_NOW, 300 * NSEC_PER_SEC)) == 0;
+    CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+    XCTAssertTrue(finished);
+
+    size_t roundTripCount = atomic_load(&latencyCount);
+    qsort(latencies, roundTripCount, sizeof(*latencies), _compareDoubles);
+    NSLog(@"%lu connections: %lu round trips of %lu bytes in %.3fs, %.0f round trips/s, %.1f MB/s each way", clientCount, roundTripCount, ONSocketReactorBenchmarkMessageLength, elapsed, elapsed > 0 ? roundTripCount / elapsed : 0.0, elapsed > 0 ? roundTripCount * ONSocketReactorBenchmarkMessageLength / elapsed / (1024.0 * 1024.0) : 0.0);
+    NSLog(@"    latency p50 %.3fms, p90 %.3fms, p99 %.3fms, p99.9 %.3fms, max %.3fms",
+          _percentile(latencies, roundTripCount, 0.50) * 1000.0, _percentile(latencies, roundTripCount, 0.90) * 1000.0,
+          _percentile(latencies, roundTripCount, 0.99) * 1000.0, _percentile(latencies, roundTripCount, 0.999) * 1000.0,
+          roundTripCount != 0 ? latencies[roundTripCount - 1] * 1000.0 : 0.0);
+
+    [reactor cancelWatchingSocket:listener];
+    [reactor invalidate];
+    [reactor release];
+    free(latencies);
+    latencies = NULL;
+    dispatch_release(allClientsFinished);
+    dispatch_release(connecting);
+    dispatch_release(connectSlots);
+}
+
+@end
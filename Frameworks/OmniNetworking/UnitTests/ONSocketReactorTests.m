@@ -0,0 +1,168 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniNetworking/OmniNetworking.h>
+
+#import <Foundation/Foundation.h>
+#import <OmniBase/OmniBase.h>
+#import <XCTest/XCTest.h>
+#include <sys/socket.h>
+
+RCS_ID("$Id$");
+
+@interface ONSocketReactorTests : XCTestCase
+{
+    ONSocketReactor *reactor;
+}
+@end
+
+@implementation ONSocketReactorTests
+
+- (void)setUp;
+{
+    reactor = [[ONSocketReactor alloc] initWithCallbackThreadCount:2];
+}
+
+- (void)tearDown;
+{
+    [reactor invalidate];
+    [reactor release];
+    reactor = nil;
+}
+
+static ONTCPSocket *_loopbackListener(void)
+{
+    ONTCPSocket *listener = [ONTCPSocket tcpSocket];
+    [listener setAddressFamily:AF_INET];
+    [listener startListeningOnAnyLocalPort];
+    return listener;
+}
+
+static ONPortAddress *_loopbackPortAddress(unsigned short int port)
+{
+    return [[[ONPortAddress alloc] initWithHostAddress:[ONHostAddress loopbackAddress] portNumber:port] autorelease];
+}
+
+static BOOL _wait(dispatch_semaphore_t semaphore)
+{
+    return dispatch_semaphore_wait(semaphore, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)) == 0;
+}
+
+static void _echo(ONSocketReactor *reactor, ONTCPSocket *connection)
+{
+    [reactor watchSocket:connection forEvents:ONSocketReactorReadable timeout:0 handler:^(ONInternetSocket *socket, ONSocketReactorEvents events) {
+        char buffer[256];
+        size_t bytesRead;
+        while ([connection readAvailableBytes:sizeof(buffer) intoBuffer:buffer bytesRead:&bytesRead]) {
+            if (bytesRead == 0)
+                return;
+            struct iovec vector = {buffer, bytesRead};
+            size_t bytesWritten;
+            [connection writeAvailableBuffers:&vector count:1 bytesWritten:&bytesWritten];
+        }
+        _echo(reactor, connection);
+    }];
+}
+
+- (void)testAcceptConnectAndEcho;
+{
+    ONTCPSocket *listener = _loopbackListener();
+    [reactor acceptConnectionsOnSocket:listener handler:^(ONTCPSocket *connection) {
+        _echo(reactor, connection);
+    }];
+
+    ONTCPSocket *client = [ONTCPSocket tcpSocket];
+    dispatch_semaphore_t connected = dispatch_semaphore_create(0);
+    __block NSException *connectException = nil;
+    [reactor connectSocket:client toPortAddress:_loopbackPortAddress([listener localAddressPort]) timeout:5.0 completionHandler:^(NSException *exception) {
+        connectException = [exception retain];
+        dispatch_semaphore_signal(connected);
+    }];
+    XCTAssertTrue(_wait(connected));
+    XCTAssertNil(connectException);
+    XCTAssertTrue([client isConnected]);
+
+    // The blocking API still works once the reactor is done with the socket.
+    [client setNonBlocking:NO];
+    [client writeString:@"hello"];
+    char reply[5];
+    size_t replyLength = 0;
+    while (replyLength < sizeof(reply))
+        replyLength += [client readBytes:sizeof(reply) - replyLength intoBuffer:reply + replyLength];
+    XCTAssertTrue(memcmp(reply, "hello", 5) == 0);
+
+    [reactor cancelWatchingSocket:listener];
+    [connectException release];
+    dispatch_release(connected);
+}
+
+- (void)testReadableAndTimeout;
+{
+    ONTCPSocket *listener = _loopbackListener();
+    ONTCPSocket *client = [ONTCPSocket tcpSocket];
+    [client connectToPortAddress:_loopbackPortAddress([listener localAddressPort])];
+    ONTCPSocket *server = [listener acceptConnectionOnNewSocket];
+
+    dispatch_semaphore_t fired = dispatch_semaphore_create(0);
+    __block ONSocketReactorEvents firedEvents = 0;
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    [reactor watchSocket:server forEvents:ONSocketReactorReadable timeout:0.05 handler:^(ONInternetSocket *socket, ONSocketReactorEvents events) {
+        firedEvents = events;
+        dispatch_semaphore_signal(fired);
+    }];
+    XCTAssertTrue(_wait(fired));
+    XCTAssertEqual(firedEvents, ONSocketReactorTimedOut);
+    XCTAssertGreaterThanOrEqual(CFAbsoluteTimeGetCurrent() - start, 0.04);
+
+    [reactor watchSocket:server forEvents:ONSocketReactorReadable timeout:5.0 handler:^(ONInternetSocket *socket, ONSocketReactorEvents events) {
+        firedEvents = events;
+        dispatch_semaphore_signal(fired);
+    }];
+    [client writeString:@"x"];
+    XCTAssertTrue(_wait(fired));
+    XCTAssertEqual(firedEvents, ONSocketReactorReadable);
+
+    dispatch_release(fired);
+}
+
+- (void)testCancel;
+{
+    ONTCPSocket *listener = _loopbackListener();
+    ONTCPSocket *client = [ONTCPSocket tcpSocket];
+    [client connectToPortAddress:_loopbackPortAddress([listener localAddressPort])];
+    ONTCPSocket *server = [listener acceptConnectionOnNewSocket];
+
+    __block BOOL fired = NO;
+    [reactor watchSocket:server forEvents:ONSocketReactorReadable timeout:0.05 handler:^(ONInternetSocket *socket, ONSocketReactorEvents events) {
+        fired = YES;
+    }];
+    [reactor cancelWatchingSocket:server];
+    [client writeString:@"x"];
+    usleep(200000);
+    XCTAssertFalse(fired);
+}
+
+- (void)testConnectRefused;
+{
+    ONTCPSocket *listener = _loopbackListener();
+    unsigned short int port = [listener localAddressPort];
+    [listener abortSocket];
+
+    dispatch_semaphore_t finished = dispatch_semaphore_create(0);
+    __block NSString *exceptionName = nil;
+    [reactor connectSocket:[ONTCPSocket tcpSocket] toPortAddress:_loopbackPortAddress(port) timeout:5.0 completionHandler:^(NSException *exception) {
+        exceptionName = [[exception name] copy];
+        dispatch_semaphore_signal(finished);
+    }];
+    XCTAssertTrue(_wait(finished));
+    XCTAssertEqualObjects(exceptionName, ONInternetSocketConnectTemporarilyFailedExceptionName);
+
+    [exceptionName release];
+    dispatch_release(finished);
+}
+
+@end
@@ -0,0 +1,108 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniNetworking/OmniNetworking.h>
+
+#import <Foundation/Foundation.h>
+#import <OmniBase/OmniBase.h>
+#import <XCTest/XCTest.h>
+#include <sys/socket.h>
+
+RCS_ID("$Id$");
+
+// Times reading header-like lines from an ONSocketStream over a loopback TCP connection, both as strings and as bytes in place. Results are logged rather than asserted since they depend on the machine.
+
+@interface ONSocketStreamBenchmarks : XCTestCase
+@end
+
+@implementation ONSocketStreamBenchmarks
+
+static const NSUInteger ONSocketStreamBenchmarkLineCount = 500000;
+
+static NSData *_headerLines(void)
+{
+    static const char * const lines[] = {
+        "Date: Mon, 05 Oct 2026 17:12:43 GMT\r\n",
+        "Server: Apache/2.4.58 (Unix)\r\n",
+        "Content-Type: text/html; charset=UTF-8\r\n",
+        "Cache-Control: max-age=600\r\n",
+        "X-Request-Id: 6c1f0d3a-43f2-4b1e-9a0e-0f3b2d4c5e6f\r\n",
+        "\r\n",
+        "1f40\r\n",
+    };
+    NSMutableData *data = [NSMutableData data];
+    for (NSUInteger lineIndex = 0; lineIndex < ONSocketStreamBenchmarkLineCount; lineIndex++) {
+        const char *line = lines[lineIndex % (sizeof(lines) / sizeof(*lines))];
+        [data appendBytes:line length:strlen(line)];
+    }
+    return data;
+}
+
+// Connects a stream to a thread writing the given data over loopback.
+static ONSocketStream *_loopbackStream(NSData *data)
+{
+    ONTCPSocket *listener = [ONTCPSocket tcpSocket];
+    [listener setAddressFamily:AF_INET];
+    [listener startListeningOnAnyLocalPort];
+    unsigned short int port = [listener localAddressPort];
+
+    [NSThread detachNewThreadWithBlock:^{
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        ONTCPSocket *writer = [ONTCPSocket tcpSocket];
+        [writer setAddressFamily:AF_INET];
+        [writer connectToAddress:[ONHostAddress loopbackAddress] port:port];
+        [writer writeData:data];
+        [pool release]; // Closes the connection, which the reader sees as EOF
+    }];
+
+    return [ONSocketStream streamWithSocket:[listener acceptConnectionOnNewSocket]];
+}
+
+static void _logLineRate(NSString *title, NSUInteger lineCount, NSUInteger byteCount, CFAbsoluteTime elapsed)
+{
+    NSLog(@"%@: %lu lines (%lu bytes) in %.3fs, %.0f lines/s, %.1f MB/s", title, lineCount, byteCount, elapsed, elapsed > 0 ? lineCount / elapsed : 0.0, elapsed > 0 ? byteCount / elapsed / (1024.0 * 1024.0) : 0.0);
+}
+
+- (void)testReadLine;
+{
+    NSData *data = _headerLines();
+    ONSocketStream *stream = _loopbackStream(data);
+    NSUInteger lineCount = 0, byteCount = 0;
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (;;) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        NSString *line = [stream readLine];
+        if (line == nil) {
+            [pool release];
+            break;
+        }
+        lineCount++;
+        byteCount += [line length];
+        [pool release];
+    }
+    _logLineRate(@"-readLine", lineCount, [data length], CFAbsoluteTimeGetCurrent() - start);
+    XCTAssertEqual(lineCount, ONSocketStreamBenchmarkLineCount);
+}
+
+- (void)testReadLineBytes;
+{
+    NSData *data = _headerLines();
+    ONSocketStream *stream = _loopbackStream(data);
+    NSUInteger lineCount = 0, byteCount = 0;
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    size_t lineLength;
+    while ([stream readLineBytes:&lineLength] != NULL) {
+        lineCount++;
+        byteCount += lineLength;
+    }
+    _logLineRate(@"-readLineBytes:", lineCount, [data length], CFAbsoluteTimeGetCurrent() - start);
+    XCTAssertEqual(lineCount, ONSocketStreamBenchmarkLineCount);
+}
+
+@end
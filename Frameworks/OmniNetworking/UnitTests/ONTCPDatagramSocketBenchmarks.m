@@ -0,0 +1,166 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniNetworking/OmniNetworking.h>
+
+#import <Foundation/Foundation.h>
+#import <OmniBase/OmniBase.h>
+#import <XCTest/XCTest.h>
+#include <sys/uio.h>
+
+RCS_ID("$Id$");
+
+// Streams small packets one way over a loopback TCP connection and reports packets per second, for the old header-then-body framing done by hand, single packet writes and reads, explicit batches, and write buffering. Results are logged rather than asserted since they depend on the machine.
+
+@interface ONTCPDatagramSocketBenchmarks : XCTestCase
+{
+    ONTCPSocket *clientSocket;
+    ONTCPSocket *serverSocket;
+}
+@end
+
+@implementation ONTCPDatagramSocketBenchmarks
+
+static const NSUInteger ONTCPDatagramSocketBenchmarkPacketCount = 200000;
+static const NSUInteger ONTCPDatagramSocketBenchmarkPacketLength = 32;
+static const unsigned int ONTCPDatagramSocketBenchmarkBatchSize = 64;
+
+- (void)setUp;
+{
+    ONTCPSocket *listener = [ONTCPSocket tcpSocket];
+    [listener setAddressFamily:AF_INET];
+    [listener startListeningOnAnyLocalPort];
+
+    clientSocket = [[ONTCPSocket tcpSocket] retain];
+    [clientSocket connectToPortAddress:[[[ONPortAddress alloc] initWithHostAddress:[ONHostAddress loopbackAddress] portNumber:[listener localAddressPort]] autorelease]];
+    serverSocket = [[listener acceptConnectionOnNewSocket] retain];
+    [listener abortSocket];
+}
+
+- (void)tearDown;
+{
+    [clientSocket abortSocket];
+    [serverSocket abortSocket];
+    [clientSocket release];
+    [serverSocket release];
+    clientSocket = nil;
+    serverSocket = nil;
+}
+
+static void _logRate(NSString *title, CFAbsoluteTime elapsed)
+{
+    NSLog(@"%@: %lu packets of %lu bytes in %.3fs, %.0f packets/s", title, ONTCPDatagramSocketBenchmarkPacketCount, ONTCPDatagramSocketBenchmarkPacketLength, elapsed, elapsed > 0 ? ONTCPDatagramSocketBenchmarkPacketCount / elapsed : 0.0);
+}
+
+static void _readFully(ONSocket *socket, void *buffer, size_t length)
+{
+    size_t lengthRead = 0;
+    while (lengthRead < length) {
+        size_t bytesRead = [socket readBytes:length - lengthRead intoBuffer:buffer + lengthRead];
+        if (bytesRead == 0)
+            [NSException raise:NSGenericException format:@"Unexpected EOF"];
+        lengthRead += bytesRead;
+    }
+}
+
+// What ONTCPDatagramSocket used to do: a write for the header, another for the body, and a read for each.
+- (void)testSeparateHeaderAndBody;
+{
+    ONTCPSocket *writeSocket = clientSocket;
+    [NSThread detachNewThreadWithBlock:^{
+        char packet[ONTCPDatagramSocketBenchmarkPacketLength];
+        memset(packet, 'p', sizeof(packet));
+        uint32_t header = OSSwapHostToBigInt32((uint32_t)sizeof(packet));
+        for (NSUInteger packetIndex = 0; packetIndex < ONTCPDatagramSocketBenchmarkPacketCount; packetIndex++) {
+            [writeSocket writeBytes:sizeof(header) fromBuffer:&header];
+            [writeSocket writeBytes:sizeof(packet) fromBuffer:packet];
+        }
+    }];
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    char packet[ONTCPDatagramSocketBenchmarkPacketLength];
+    for (NSUInteger packetIndex = 0; packetIndex < ONTCPDatagramSocketBenchmarkPacketCount; packetIndex++) {
+        uint32_t header;
+        _readFully(serverSocket, &header, sizeof(header));
+        _readFully(serverSocket, packet, OSSwapBigToHostInt32(header));
+    }
+    _logRate(@"separate header and body", CFAbsoluteTimeGetCurrent() - start);
+}
+
+- (void)testSinglePackets;
+{
+    ONTCPDatagramSocket *sender = [[[ONTCPDatagramSocket alloc] initWithTCPSocket:clientSocket] autorelease];
+    ONTCPDatagramSocket *receiver = [[[ONTCPDatagramSocket alloc] initWithTCPSocket:serverSocket] autorelease];
+    [NSThread detachNewThreadWithBlock:^{
+        char packet[ONTCPDatagramSocketBenchmarkPacketLength];
+        memset(packet, 'p', sizeof(packet));
+        for (NSUInteger packetIndex = 0; packetIndex < ONTCPDatagramSocketBenchmarkPacketCount; packetIndex++)
+            [sender writeBytes:sizeof(packet) fromBuffer:packet];
+    }];
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    char packet[ONTCPDatagramSocketBenchmarkPacketLength];
+    for (NSUInteger packetIndex = 0; packetIndex < ONTCPDatagramSocketBenchmarkPacketCount; packetIndex++)
+        [receiver readBytes:sizeof(packet) intoBuffer:packet];
+    _logRate(@"-writeBytes:fromBuffer: / -readBytes:intoBuffer:", CFAbsoluteTimeGetCurrent() - start);
+}
+
+static void _readPacketBatches(ONTCPDatagramSocket *receiver)
+{
+    struct iovec packets[ONTCPDatagramSocketBenchmarkBatchSize];
+    NSUInteger packetCount = 0;
+    while (packetCount < ONTCPDatagramSocketBenchmarkPacketCount) {
+        unsigned int count = [receiver readPackets:packets maximumCount:ONTCPDatagramSocketBenchmarkBatchSize];
+        if (count == 0)
+            [NSException raise:NSGenericException format:@"Unexpected EOF"];
+        packetCount += count;
+    }
+}
+
+- (void)testBatches;
+{
+    ONTCPDatagramSocket *sender = [[[ONTCPDatagramSocket alloc] initWithTCPSocket:clientSocket] autorelease];
+    ONTCPDatagramSocket *receiver = [[[ONTCPDatagramSocket alloc] initWithTCPSocket:serverSocket] autorelease];
+    [NSThread detachNewThreadWithBlock:^{
+        char packet[ONTCPDatagramSocketBenchmarkPacketLength];
+        struct iovec packets[ONTCPDatagramSocketBenchmarkBatchSize];
+        memset(packet, 'p', sizeof(packet));
+        for (unsigned int packetIndex = 0; packetIndex < ONTCPDatagramSocketBenchmarkBatchSize; packetIndex++) {
+            packets[packetIndex].iov_base = packet;
+            packets[packetIndex].iov_len = sizeof(packet);
+        }
+        for (NSUInteger packetIndex = 0; packetIndex < ONTCPDatagramSocketBenchmarkPacketCount; packetIndex += ONTCPDatagramSocketBenchmarkBatchSize)
+            [sender writePackets:packets count:(unsigned int)MIN(ONTCPDatagramSocketBenchmarkBatchSize, ONTCPDatagramSocketBenchmarkPacketCount - packetIndex)];
+    }];
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    _readPacketBatches(receiver);
+    _logRate(@"-writePackets:count: / -readPackets:maximumCount:", CFAbsoluteTimeGetCurrent() - start);
+}
+
+- (void)testBuffering;
+{
+    ONTCPDatagramSocket *sender = [[[ONTCPDatagramSocket alloc] initWithTCPSocket:clientSocket] autorelease];
+    ONTCPDatagramSocket *receiver = [[[ONTCPDatagramSocket alloc] initWithTCPSocket:serverSocket] autorelease];
+    [NSThread detachNewThreadWithBlock:^{
+        char packet[ONTCPDatagramSocketBenchmarkPacketLength];
+        memset(packet, 'p', sizeof(packet));
+        for (NSUInteger packetIndex = 0; packetIndex < ONTCPDatagramSocketBenchmarkPacketCount; packetIndex++) {
+            if (packetIndex % ONTCPDatagramSocketBenchmarkBatchSize == 0)
+                [sender beginBuffering];
+            [sender writeBytes:sizeof(packet) fromBuffer:packet];
+            if (packetIndex % ONTCPDatagramSocketBenchmarkBatchSize == ONTCPDatagramSocketBenchmarkBatchSize - 1 || packetIndex == ONTCPDatagramSocketBenchmarkPacketCount - 1)
+                [sender endBuffering];
+        }
+    }];
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    _readPacketBatches(receiver);
+    _logRate(@"-beginBuffering / -readPackets:maximumCount:", CFAbsoluteTimeGetCurrent() - start);
+}
+
+@end
@@ -0,0 +1,185 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniNetworking/OmniNetworking.h>
+
+#import <Foundation/Foundation.h>
+#import <OmniBase/OmniBase.h>
+#import <XCTest/XCTest.h>
+#include <sys/uio.h>
+
+RCS_ID("$Id$");
+
+// Tests packet framing over a loopback TCP connection.
+
+@interface ONTCPDatagramSocketTests : XCTestCase
+{
+    ONTCPSocket *clientSocket;
+    ONTCPSocket *serverSocket;
+    ONTCPDatagramSocket *sender;
+    ONTCPDatagramSocket *receiver;
+}
+@end
+
+@implementation ONTCPDatagramSocketTests
+
+- (void)setUp;
+{
+    ONTCPSocket *listener = [ONTCPSocket tcpSocket];
+    [listener setAddressFamily:AF_INET];
+    [listener startListeningOnAnyLocalPort];
+
+    clientSocket = [[ONTCPSocket tcpSocket] retain];
+    [clientSocket connectToPortAddress:[[[ONPortAddress alloc] initWithHostAddress:[ONHostAddress loopbackAddress] portNumber:[listener localAddressPort]] autorelease]];
+    serverSocket = [[listener acceptConnectionOnNewSocket] retain];
+    [listener abortSocket];
+
+    sender = [[ONTCPDatagramSocket alloc] initWithTCPSocket:clientSocket];
+    receiver = [[ONTCPDatagramSocket alloc] initWithTCPSocket:serverSocket];
+}
+
+- (void)tearDown;
+{
+    [sender abortSocket];
+    [receiver abortSocket];
+    [sender release];
+    [receiver release];
+    [clientSocket release];
+    [serverSocket release];
+    sender = nil;
+    receiver = nil;
+    clientSocket = nil;
+    serverSocket = nil;
+}
+
+- (void)testPacketBoundariesArePreserved;
+{
+    [sender writeBytes:5 fromBuffer:"hello"];
+    [sender writeBytes:0 fromBuffer:""];
+    [sender writeBytes:6 fromBuffer:"world!"];
+
+    char buffer[16];
+    XCTAssertEqual([receiver readBytes:sizeof(buffer) intoBuffer:buffer], (size_t)5);
+    XCTAssertTrue(memcmp(buffer, "hello", 5) == 0);
+    XCTAssertEqual([receiver readBytes:sizeof(buffer) intoBuffer:buffer], (size_t)0);
+    XCTAssertEqual([receiver readBytes:sizeof(buffer) intoBuffer:buffer], (size_t)6);
+    XCTAssertTrue(memcmp(buffer, "world!", 6) == 0);
+}
+
+- (void)testFramingIsUnchanged;
+{
+    // Other implementations of the protocol expect a 4-byte big-endian length before each packet
+    [sender writeBytes:3 fromBuffer:"abc"];
+
+    unsigned char bytes[7];
+    size_t length = 0;
+    while (length < sizeof(bytes))
+        length += [serverSocket readBytes:sizeof(bytes) - length intoBuffer:bytes + length];
+    XCTAssertTrue(memcmp(bytes, "\0\0\0\3abc", 7) == 0);
+}
+
+- (void)testBatches;
+{
+    struct iovec packets[100];
+    char payloads[100][8];
+    for (unsigned int packetIndex = 0; packetIndex < 100; packetIndex++) {
+        snprintf(payloads[packetIndex], sizeof(payloads[packetIndex]), "p%u", packetIndex);
+        packets[packetIndex].iov_base = payloads[packetIndex];
+        packets[packetIndex].iov_len = strlen(payloads[packetIndex]);
+    }
+    XCTAssertEqual([sender writePackets:packets count:100], 100U);
+
+    struct iovec received[16];
+    unsigned int receivedCount = 0;
+    while (receivedCount < 100) {
+        unsigned int count = [receiver readPackets:received maximumCount:16];
+        XCTAssertGreaterThan(count, 0U);
+        XCTAssertLessThanOrEqual(count, 16U);
+        for (unsigned int packetIndex = 0; packetIndex < count; packetIndex++, receivedCount++) {
+            XCTAssertEqual(received[packetIndex].iov_len, packets[receivedCount].iov_len);
+            XCTAssertTrue(memcmp(received[packetIndex].iov_base, payloads[receivedCount], received[packetIndex].iov_len) == 0);
+        }
+    }
+}
+
+- (void)testBufferedPacketsGoOutTogether;
+{
+    [sender beginBuffering];
+    [sender writeBytes:3 fromBuffer:"one"];
+    [sender beginBuffering];
+    [sender writeBytes:3 fromBuffer:"two"];
+    [sender endBuffering];
+    XCTAssertFalse([receiver isReadable]);
+    [sender endBuffering];
+
+    struct iovec received[4];
+    unsigned int count = 0;
+    while (count < 2)
+        count += [receiver readPackets:received + count maximumCount:4 - count];
+    XCTAssertEqual(count, 2U);
+    XCTAssertTrue(memcmp(received[0].iov_base, "one", 3) == 0);
+    XCTAssertTrue(memcmp(received[1].iov_base, "two", 3) == 0);
+
+    XCTAssertThrows([sender endBuffering]);
+}
+
+- (void)testLargePacket;
+{
+    size_t length = 3 * 1024 * 1024;
+    char *bytes = malloc(length);
+    for (size_t byteIndex = 0; byteIndex < length; byteIndex++)
+        bytes[byteIndex] = (char)(byteIndex * 7);
+
+    [NSThread detachNewThreadWithBlock:^{
+        [sender writeBytes:length fromBuffer:bytes];
+        [sender writeBytes:4 fromBuffer:"tail"];
+    }];
+
+    char *readBytes = malloc(length);
+    XCTAssertEqual([receiver readBytes:length intoBuffer:readBytes], length);
+    XCTAssertTrue(memcmp(readBytes, bytes, length) == 0);
+    XCTAssertEqual([receiver readBytes:length intoBuffer:readBytes], (size_t)4);
+    XCTAssertTrue(memcmp(readBytes, "tail", 4) == 0);
+    free(readBytes);
+    free(bytes);
+}
+
+- (void)testSmallBufferLeavesPacketInPlace;
+{
+    [sender writeBytes:10 fromBuffer:"0123456789"];
+
+    char buffer[10];
+    XCTAssertThrowsSpecificNamed([receiver readBytes:4 intoBuffer:buffer], NSException, ONTCPDatagramSocketPacketTooLargeExceptionName);
+    XCTAssertEqual([receiver readBytes:sizeof(buffer) intoBuffer:buffer], (size_t)10);
+    XCTAssertTrue(memcmp(buffer, "0123456789", 10) == 0);
+}
+
+- (void)testOversizedHeaderRaisesBeforeTheBodyArrives;
+{
+    // Only the header is ever sent, so reading on into the body would block
+    unsigned char header[4] = {0xFF, 0xFF, 0xFF, 0xF0};
+    [clientSocket writeBytes:sizeof(header) fromBuffer:header];
+
+    char buffer[16];
+    XCTAssertThrowsSpecificNamed([receiver readBytes:sizeof(buffer) intoBuffer:buffer], NSException, ONTCPDatagramSocketPacketTooLargeExceptionName);
+    struct iovec packet;
+    XCTAssertThrowsSpecificNamed([receiver readPackets:&packet maximumCount:1], NSException, ONTCPDatagramSocketPacketTooLargeExceptionName);
+    XCTAssertThrowsSpecificNamed([receiver readBytes:sizeof(buffer) intoBuffer:buffer], NSException, ONTCPDatagramSocketPacketTooLargeExceptionName);
+}
+
+- (void)testEOF;
+{
+    [sender writeBytes:2 fromBuffer:"hi"];
+    [clientSocket abortSocket];
+
+    char buffer[4];
+    XCTAssertEqual([receiver readBytes:sizeof(buffer) intoBuffer:buffer], (size_t)2);
+    struct iovec packet;
+    XCTAssertEqual([receiver readPackets:&packet maximumCount:1], 0U);
+}
+
+@end
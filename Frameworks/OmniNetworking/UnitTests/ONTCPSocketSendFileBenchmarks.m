@@ -0,0 +1,133 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniNetworking/OmniNetworking.h>
+
+#import <Foundation/Foundation.h>
+#import <OmniBase/OmniBase.h>
+#import <XCTest/XCTest.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+RCS_ID("$Id$");
+
+// Sends a file over a loopback TCP connection several times, with -sendFile:offset:length: and by reading the file into a buffer and writing it out, and reports throughput and CPU time per gigabyte (for the whole process, so the receiving side is included in both). Results are logged rather than asserted since they depend on the machine.
+
+@interface ONTCPSocketSendFileBenchmarks : XCTestCase
+{
+    ONTCPSocket *clientSocket;
+    ONTCPSocket *serverSocket;
+    NSString *filePath;
+    int fileDescriptor;
+}
+@end
+
+@implementation ONTCPSocketSendFileBenchmarks
+
+static const size_t ONTCPSocketSendFileBenchmarkFileLength = 256 * 1024 * 1024;
+static const NSUInteger ONTCPSocketSendFileBenchmarkRepetitions = 8;
+static const size_t ONTCPSocketSendFileBenchmarkCopySize = 64 * 1024;
+
+- (void)setUp;
+{
+    ONTCPSocket *listener = [ONTCPSocket tcpSocket];
+    [listener setAddressFamily:AF_INET];
+    [listener startListeningOnAnyLocalPort];
+
+    clientSocket = [[ONTCPSocket tcpSocket] retain];
+    [clientSocket connectToPortAddress:[[[ONPortAddress alloc] initWithHostAddress:[ONHostAddress loopbackAddress] portNumber:[listener localAddressPort]] autorelease]];
+    serverSocket = [[listener acceptConnectionOnNewSocket] retain];
+    [listener abortSocket];
+
+    // Written once up front, so it's in the page cache for every run
+    filePath = [[NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]] retain];
+    NSMutableData *contents = [NSMutableData dataWithLength:ONTCPSocketSendFileBenchmarkFileLength];
+    memset([contents mutableBytes], 'f', ONTCPSocketSendFileBenchmarkFileLength);
+    [contents writeToFile:filePath atomically:NO];
+    fileDescriptor = open([filePath fileSystemRepresentation], O_RDONLY);
+}
+
+- (void)tearDown;
+{
+    close(fileDescriptor);
+    unlink([filePath fileSystemRepresentation]);
+    [filePath release];
+    filePath = nil;
+    [clientSocket abortSocket];
+    [serverSocket abortSocket];
+    [clientSocket release];
+    [serverSocket release];
+    clientSocket = nil;
+    serverSocket = nil;
+}
+
+static double _cpuTime(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+- (void)_timeSending:(NSString *)title block:(void (^)(void))sendFile;
+{
+    size_t totalLength = ONTCPSocketSendFileBenchmarkFileLength * ONTCPSocketSendFileBenchmarkRepetitions;
+    ONTCPSocket *readSocket = serverSocket;
+    dispatch_semaphore_t received = dispatch_semaphore_create(0);
+
+    [NSThread detachNewThreadWithBlock:^{
+        char *buffer = malloc(ONTCPSocketSendFileBenchmarkCopySize);
+        size_t lengthRead = 0;
+        while (lengthRead < totalLength) {
+            size_t bytesRead = [readSocket readBytes:ONTCPSocketSendFileBenchmarkCopySize intoBuffer:buffer];
+            if (bytesRead == 0)
+                break;
+            lengthRead += bytesRead;
+        }
+        free(buffer);
+        dispatch_semaphore_signal(received);
+    }];
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    double cpuStart = _cpuTime();
+    for (NSUInteger repetition = 0; repetition < ONTCPSocketSendFileBenchmarkRepetitions; repetition++)
+        sendFile();
+    dispatch_semaphore_wait(received, DISPATCH_TIME_FOREVER);
+    CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+    double cpu = _cpuTime() - cpuStart;
+    dispatch_release(received);
+
+    double gigabytes = totalLength / (1024.0 * 1024.0 * 1024.0);
+    NSLog(@"%@: %.2f GB in %.3fs, %.0f MB/s, %.3f CPU seconds per GB", title, gigabytes, elapsed, elapsed > 0 ? gigabytes * 1024.0 / elapsed : 0.0, cpu / gigabytes);
+}
+
+- (void)testSendFile;
+{
+    [self _timeSending:@"-sendFile:offset:length:" block:^{
+        [clientSocket sendFile:fileDescriptor offset:0 length:ONTCPSocketSendFileBenchmarkFileLength];
+    }];
+}
+
+- (void)testReadAndWrite;
+{
+    [self _timeSending:@"pread() and -writeBytes:fromBuffer:" block:^{
+        char *buffer = malloc(ONTCPSocketSendFileBenchmarkCopySize);
+        off_t offset = 0;
+        while (offset < (off_t)ONTCPSocketSendFileBenchmarkFileLength) {
+            ssize_t length = pread(fileDescriptor, buffer, ONTCPSocketSendFileBenchmarkCopySize, offset);
+            if (length <= 0)
+                break;
+            size_t written = 0;
+            while (written < (size_t)length)
+                written += [clientSocket writeBytes:length - written fromBuffer:buffer + written];
+            offset += length;
+        }
+        free(buffer);
+    }];
+}
+
+@end
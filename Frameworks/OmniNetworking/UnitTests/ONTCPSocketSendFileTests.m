@@ -0,0 +1,196 @@
+// Copyright 2026 Omni Development, Inc. All rights reserved.
+//
+// This software may only be used and reproduced according to the
+// terms in the file OmniSourceLicense.html, which should be
+// distributed with this project and can also be found at
+// <http://www.omnigroup.com/developer/sourcecode/sourcelicense/>.
+
+#import <OmniNetworking/OmniNetworking.h>
+
+#import <Foundation/Foundation.h>
+#import <OmniBase/OmniBase.h>
+#import <XCTest/XCTest.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+RCS_ID("$Id$");
+
+// Tests sending files over a loopback TCP connection.
+
+@interface ONTCPSocketSendFileTests : XCTestCase
+{
+    ONTCPSocket *clientSocket;
+    ONTCPSocket *serverSocket;
+    NSString *filePath;
+    int fileDescriptor;
+}
+@end
+
+@implementation ONTCPSocketSendFileTests
+
+static const size_t ONTCPSocketSendFileTestFileLength = 4 * 1024 * 1024 + 123;
+
+static char _fileByte(size_t position)
+{
+    return (char)((position * 31) ^ (position >> 8));
+}
+
+- (void)setUp;
+{
+    ONTCPSocket *listener = [ONTCPSocket tcpSocket];
+    [listener setAddressFamily:AF_INET];
+    [listener startListeningOnAnyLocalPort];
+
+    clientSocket = [[ONTCPSocket tcpSocket] retain];
+    [clientSocket connectToPortAddress:[[[ONPortAddress alloc] initWithHostAddress:[ONHostAddress loopbackAddress] portNumber:[listener localAddressPort]] autorelease]];
+    serverSocket = [[listener acceptConnectionOnNewSocket] retain];
+    [listener abortSocket];
+
+    filePath = [[NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]] retain];
+    NSMutableData *contents = [NSMutableData dataWithLength:ONTCPSocketSendFileTestFileLength];
+    char *bytes = [contents mutableBytes];
+    for (size_t position = 0; position < ONTCPSocketSendFileTestFileLength; position++)
+        bytes[position] = _fileByte(position);
+    XCTAssertTrue([contents writeToFile:filePath atomically:NO]);
+    fileDescriptor = open([filePath fileSystemRepresentation], O_RDONLY);
+    XCTAssertNotEqual(fileDescriptor, -1);
+}
+
+- (void)tearDown;
+{
+    close(fileDescriptor);
+    unlink([filePath fileSystemRepresentation]);
+    [filePath release];
+    filePath = nil;
+    [clientSocket abortSocket];
+    [serverSocket abortSocket];
+    [clientSocket release];
+    [serverSocket release];
+    clientSocket = nil;
+    serverSocket = nil;
+}
+
+- (NSData *)_readLength:(size_t)length;
+{
+    NSMutableData *data = [NSMutableData dataWithLength:length];
+    size_t lengthRead = 0;
+    while (lengthRead < length) {
+        size_t bytesRead = [serverSocket readBytes:length - lengthRead intoBuffer:[data mutableBytes] + lengthRead];
+        if (bytesRead == 0)
+            break;
+        lengthRead += bytesRead;
+    }
+    [data setLength:lengthRead];
+    return data;
+}
+
+- (BOOL)_data:(NSData *)data matchesFileAtOffset:(size_t)offset;
+{
+    const char *bytes = [data bytes];
+    for (size_t position = 0; position < [data length]; position++) {
+        if (bytes[position] != _fileByte(offset + position))
+            return NO;
+    }
+    return YES;
+}
+
+- (void)testWholeFile;
+{
+    __block off_t bytesSent = 0;
+    dispatch_semaphore_t sent = dispatch_semaphore_create(0);
+    [NSThread detachNewThreadWithBlock:^{
+        bytesSent = [clientSocket sendFile:fileDescriptor offset:0 length:ONTCPSocketSendFileTestFileLength];
+        dispatch_semaphore_signal(sent);
+    }];
+
+    NSData *data = [self _readLength:ONTCPSocketSendFileTestFileLength];
+    dispatch_semaphore_wait(sent, DISPATCH_TIME_FOREVER);
+    dispatch_release(sent);
+
+    XCTAssertEqual(bytesSent, (off_t)ONTCPSocketSendFileTestFileLength);
+    XCTAssertEqual([data length], ONTCPSocketSendFileTestFileLength);
+    XCTAssertTrue([self _data:data matchesFileAtOffset:0]);
+}
+
+- (void)testHeadersAndRange;
+{
+    struct iovec headers[2] = {{"HTTP/1.1 206 Partial Content\r\n", 31}, {"\r\n", 2}};
+    off_t bytesSent = [clientSocket sendHeaders:headers count:2 file:fileDescriptor offset:1000 length:5000];
+    XCTAssertEqual(bytesSent, (off_t)(33 + 5000));
+
+    NSData *data = [self _readLength:33 + 5000];
+    XCTAssertTrue(memcmp([data bytes], "HTTP/1.1 206 Partial Content\r\n\r\n", 33) == 0);
+    XCTAssertTrue([self _data:[data subdataWithRange:NSMakeRange(33, 5000)] matchesFileAtOffset:1000]);
+}
+
+- (void)testStopsAtEndOfFile;
+{
+    off_t bytesSent = [clientSocket sendFile:fileDescriptor offset:ONTCPSocketSendFileTestFileLength - 100 length:1000];
+    XCTAssertEqual(bytesSent, (off_t)100);
+
+    NSData *data = [self _readLength:100];
+    XCTAssertTrue([self _data:data matchesFileAtOffset:ONTCPSocketSendFileTestFileLength - 100]);
+}
+
+- (void)testFilesWhichCantBeSentDirectly;
+{
+    // Devices generally aren't something sendfile() will take
+    int zeroDescriptor = open("/dev/zero", O_RDONLY);
+    XCTAssertNotEqual(zeroDescriptor, -1);
+    struct iovec header = {"zeros:", 6};
+    off_t bytesSent = [clientSocket sendHeaders:&header count:1 file:zeroDescriptor offset:0 length:10000];
+    close(zeroDescriptor);
+    XCTAssertEqual(bytesSent, (off_t)10006);
+
+    NSData *data = [self _readLength:10006];
+    XCTAssertTrue(memcmp([data bytes], "zeros:", 6) == 0);
+    for (NSUInteger position = 6; position < [data length]; position++)
+        XCTAssertEqual(((const char *)[data bytes])[position], 0);
+}
+
+- (void)testNonBlockingProgress;
+{
+    struct iovec header = {"header", 6};
+    off_t offset = 0, length = ONTCPSocketSendFileTestFileLength;
+    BOOL headerSent = NO, sawWouldBlock = NO;
+
+    [clientSocket setNonBlocking:YES];
+
+    // Nobody is reading yet, so the socket fills up partway through
+    __block NSData *data = nil;
+    while (length > 0) {
+        off_t bytesSent;
+        BOOL sentAll = [clientSocket sendAvailableHeaders:(headerSent ? NULL : &header) count:(headerSent ? 0 : 1) file:fileDescriptor offset:offset length:length bytesSent:&bytesSent];
+        if (!headerSent) {
+            XCTAssertGreaterThanOrEqual(bytesSent, (off_t)6); // Loopback has room for a few bytes
+            headerSent = YES;
+            bytesSent -= 6;
+        }
+        offset += bytesSent;
+        length -= bytesSent;
+        if (!sentAll) {
+            if (!sawWouldBlock) {
+                sawWouldBlock = YES;
+                XCTAssertGreaterThan(offset, (off_t)0);
+                XCTAssertLessThan(offset, (off_t)ONTCPSocketSendFileTestFileLength);
+                [NSThread detachNewThreadWithBlock:^{
+                    data = [[self _readLength:6 + ONTCPSocketSendFileTestFileLength] retain];
+                }];
+            }
+            struct pollfd pollDescriptor = {[clientSocket socketFD], POLLOUT, 0};
+            poll(&pollDescriptor, 1, 1000);
+        }
+    }
+    XCTAssertTrue(sawWouldBlock);
+
+    while (data == nil)
+        usleep(1000);
+    XCTAssertEqual([data length], 6 + ONTCPSocketSendFileTestFileLength);
+    XCTAssertTrue(memcmp([data bytes], "header", 6) == 0);
+    XCTAssertTrue([self _data:[data subdataWithRange:NSMakeRange(6, ONTCPSocketSendFileTestFileLength)] matchesFileAtOffset:0]);
+    [data release];
+}
+
+@end
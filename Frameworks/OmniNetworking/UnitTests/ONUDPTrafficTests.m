@@ -12,6 +12,7 @@
 #import <XCTest/XCTest.h>
 #include <unistd.h>
 #include <sys/socket.h>
+#include <netinet/in.h>
 
 RCS_ID("$Id$");
 
@@ -169,6 +170,139 @@ const char *s4 = "Would you like another packet? It is WAFFER THIN!";
     }
 }
 
+static void _setDatagramAddress(ONDatagram *datagram, ONPortAddress *portAddress)
+{
+    const struct sockaddr *address = [portAddress portAddress];
+    memset(&datagram->address, 0, sizeof(datagram->address));
+    memcpy(&datagram->address, address, address->sa_family == AF_INET6 ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
+}
+
+- (void)testBatchedDatagrams
+{
+    ONDatagram datagrams[10];
+    char payloads[10][16];
+    unsigned int datagramIndex;
+
+    [dewie setLocalPortNumber];
+    ONPortAddress *addrD = [[[ONPortAddress alloc] initWithHostAddress:[self loopback] portNumber:[dewie localAddressPort]] autorelease];
+
+    for (datagramIndex = 0; datagramIndex < 10; datagramIndex++) {
+        snprintf(payloads[datagramIndex], sizeof(payloads[datagramIndex]), "datagram %u", datagramIndex);
+        datagrams[datagramIndex].buffer.iov_base = payloads[datagramIndex];
+        datagrams[datagramIndex].buffer.iov_len = strlen(payloads[datagramIndex]);
+        _setDatagramAddress(&datagrams[datagramIndex], addrD);
+    }
+    XCTAssertEqual([dewie writeDatagrams:datagrams count:10], 10U);
+
+    ONDatagram received[4];
+    char buffers[4][S3_LEN];
+    unsigned int receivedCount = 0;
+    while (receivedCount < 10) {
+        for (datagramIndex = 0; datagramIndex < 4; datagramIndex++) {
+            received[datagramIndex].buffer.iov_base = buffers[datagramIndex];
+            received[datagramIndex].buffer.iov_len = sizeof(buffers[datagramIndex]);
+        }
+        unsigned int count = [dewie readDatagrams:received maximumCount:4];
+        XCTAssertGreaterThan(count, 0U);
+        for (datagramIndex = 0; datagramIndex < count; datagramIndex++, receivedCount++) {
+            XCTAssertEqual(received[datagramIndex].length, strlen(payloads[receivedCount]));
+            XCTAssertTrue(memcmp(buffers[datagramIndex], payloads[receivedCount], received[datagramIndex].length) == 0);
+            XCTAssertFalse(received[datagramIndex].truncated);
+            XCTAssertEqual(received[datagramIndex].segmentSize, 0U);
+            XCTAssertTrue([addrD isEqualToSocketAddress:(struct sockaddr *)&received[datagramIndex].address]);
+        }
+    }
+
+    // Batch reads leave -remoteAddress alone
+    XCTAssertTrue([dewie remoteAddress] == nil);
+
+    // A datagram too big for its buffer is cut short
+    memset(s3, 'x', sizeof(s3));
+    [dewie writeBytes:sizeof(s3) fromBuffer:s3 toPortAddress:addrD];
+    received[0].buffer.iov_base = buffers[0];
+    received[0].buffer.iov_len = 100;
+    XCTAssertEqual([dewie readDatagrams:received maximumCount:1], 1U);
+    XCTAssertEqual(received[0].length, (size_t)100);
+    XCTAssertTrue(received[0].truncated);
+}
+
+// Packets per second through one loopback socket, in bursts small enough to sit in its receive buffer, one datagram per system call and then a burst per system call. Results are logged rather than asserted since they depend on the machine.
+
+#define BENCHMARK_DATAGRAM_COUNT (200000)
+#define BENCHMARK_BURST_SIZE (64)
+#define BENCHMARK_DATAGRAM_LENGTH (64)
+
+- (void)testPacketsPerSecond
+{
+    ONDatagram datagrams[BENCHMARK_BURST_SIZE];
+    char payload[BENCHMARK_DATAGRAM_LENGTH], buffers[BENCHMARK_BURST_SIZE][BENCHMARK_DATAGRAM_LENGTH];
+    unsigned int datagramIndex;
+    NSUInteger sentCount;
+    CFAbsoluteTime start, elapsed;
+
+    [dewie setLocalPortNumber];
+    ONPortAddress *addrD = [[[ONPortAddress alloc] initWithHostAddress:[self loopback] portNumber:[dewie localAddressPort]] autorelease];
+    memset(payload, 'p', sizeof(payload));
+
+    start = CFAbsoluteTimeGetCurrent();
+    for (sentCount = 0; sentCount < BENCHMARK_DATAGRAM_COUNT; sentCount += BENCHMARK_BURST_SIZE) {
+        for (datagramIndex = 0; datagramIndex < BENCHMARK_BURST_SIZE; datagramIndex++)
+            [dewie writeBytes:sizeof(payload) fromBuffer:payload toPortAddress:addrD];
+        for (datagramIndex = 0; datagramIndex < BENCHMARK_BURST_SIZE; datagramIndex++)
+            [dewie readBytes:sizeof(buffers[0]) intoBuffer:buffers[0]];
+    }
+    elapsed = CFAbsoluteTimeGetCurrent() - start;
+    NSLog(@"-writeBytes:fromBuffer:toPortAddress: / -readBytes:intoBuffer: %lu datagrams in %.3fs, %.0f packets/s", sentCount, elapsed, elapsed > 0 ? sentCount / elapsed : 0.0);
+
+    for (datagramIndex = 0; datagramIndex < BENCHMARK_BURST_SIZE; datagramIndex++) {
+        datagrams[datagramIndex].buffer.iov_base = payload;
+        datagrams[datagramIndex].buffer.iov_len = sizeof(payload);
+        _setDatagramAddress(&datagrams[datagramIndex], addrD);
+    }
+    ONDatagram received[BENCHMARK_BURST_SIZE];
+
+    start = CFAbsoluteTimeGetCurrent();
+    for (sentCount = 0; sentCount < BENCHMARK_DATAGRAM_COUNT; sentCount += BENCHMARK_BURST_SIZE) {
+        unsigned int writtenCount = 0, receivedCount = 0;
+        while (writtenCount < BENCHMARK_BURST_SIZE)
+            writtenCount += [dewie writeDatagrams:datagrams + writtenCount count:BENCHMARK_BURST_SIZE - writtenCount];
+        while (receivedCount < BENCHMARK_BURST_SIZE) {
+            for (datagramIndex = receivedCount; datagramIndex < BENCHMARK_BURST_SIZE; datagramIndex++) {
+                received[datagramIndex].buffer.iov_base = buffers[datagramIndex];
+                received[datagramIndex].buffer.iov_len = sizeof(buffers[datagramIndex]);
+            }
+            receivedCount += [dewie readDatagrams:received + receivedCount maximumCount:BENCHMARK_BURST_SIZE - receivedCount];
+        }
+    }
+    elapsed = CFAbsoluteTimeGetCurrent() - start;
+    NSLog(@"-writeDatagrams:count: / -readDatagrams:maximumCount: %lu datagrams in %.3fs, %.0f packets/s", sentCount, elapsed, elapsed > 0 ? sentCount / elapsed : 0.0);
+
+    // With segmentation offload a whole burst goes down as one buffer, and with receive offload it can come back up as one.
+    if ([dewie setSendSegmentSize:BENCHMARK_DATAGRAM_LENGTH] && [dewie setReceivesCoalescedDatagrams:YES]) {
+        char burst[BENCHMARK_BURST_SIZE * BENCHMARK_DATAGRAM_LENGTH], receivedBurst[sizeof(burst)];
+        ONDatagram burstDatagram;
+
+        memset(burst, 'p', sizeof(burst));
+        burstDatagram.buffer.iov_base = burst;
+        burstDatagram.buffer.iov_len = sizeof(burst);
+        _setDatagramAddress(&burstDatagram, addrD);
+
+        start = CFAbsoluteTimeGetCurrent();
+        for (sentCount = 0; sentCount < BENCHMARK_DATAGRAM_COUNT; sentCount += BENCHMARK_BURST_SIZE) {
+            size_t receivedLength = 0;
+            [dewie writeDatagrams:&burstDatagram count:1];
+            while (receivedLength < sizeof(burst)) {
+                received[0].buffer.iov_base = receivedBurst;
+                received[0].buffer.iov_len = sizeof(receivedBurst);
+                [dewie readDatagrams:received maximumCount:1];
+                receivedLength += received[0].length;
+            }
+        }
+        elapsed = CFAbsoluteTimeGetCurrent() - start;
+        NSLog(@"-setSendSegmentSize: / -setReceivesCoalescedDatagrams: %lu datagrams in %.3fs, %.0f packets/s", sentCount, elapsed, elapsed > 0 ? sentCount / elapsed : 0.0);
+    }
+}
+
 - (void)setAddressFamily:(int)af
 {
     addressFamily = af;
@@ -9,7 +9,7 @@
 
 #import <OmniFoundation/OFObject.h>
 
-@class NSArray, NSData, NSError;
+@class NSArray, NSData, NSError, NSLock, NSMutableArray, NSMutableDictionary;
 @class OSLPreparedStatement;
 
 typedef int (*OSLDatabaseCallback)(void *, int, char **, char **);
@@ -19,19 +19,54 @@ typedef int (*OSLDatabaseCallback)(void *, int, char **, char **);
     NSString *databasePath;
     void *sqliteDatabase;
     BOOL _autoRetry;
+    BOOL _readOnly;
+
+    // LRU cache of prepared statements, keyed by SQL text. The most recently used statement is at the end of _statementCacheOrder.
+    NSUInteger _statementCacheCapacity;
+    NSMutableDictionary *_statementCache;
+    NSMutableArray *_statementCacheOrder;
+
+    // Pool of read-only connections to the same file. Since the database is in WAL mode, these can run concurrently with the writer.
+    NSUInteger _readConnectionLimit;
+    NSUInteger _readConnectionCount;
+    NSMutableArray *_idleReadConnections;
+    NSLock *_readConnectionLock;
+    dispatch_semaphore_t _readConnectionSemaphore;
+    long long _memoryMapSize;
 }
 
 @property (assign, nonatomic) BOOL autoRetry;
+@property (readonly, nonatomic, getter=isReadOnly) BOOL readOnly;
+
+// Number of statements -cachedStatement:error: keeps prepared. Defaults to 32; zero disables the cache.
+@property (assign, nonatomic) NSUInteger statementCacheCapacity;
 
 - initWithDatabasePath:(NSString *)aPath error:(NSError **)outError;
+- initWithDatabasePath:(NSString *)aPath readConnectionLimit:(NSUInteger)readConnectionLimit error:(NSError **)outError;
+    // Read connections are opened lazily, up to readConnectionLimit of them. A limit of zero runs reads on the writer connection.
 - (NSString *)databasePath;
 
 - (void)deleteDatabase;
 
 - (BOOL)executeSQL:(NSString *)sql withCallback:(OSLDatabaseCallback)callbackFunction context:(void *)callbackContext error:(NSError **)outError;
 - (OSLPreparedStatement *)prepareStatement:(NSString *)sql error:(NSError **)outError;
+- (OSLPreparedStatement *)cachedStatement:(NSString *)sql error:(NSError **)outError;
+    // Returns a reset statement with no bindings from the LRU cache, preparing it if needed. If the cached statement for this SQL is still being stepped, a new uncached statement is returned instead. The statement is autoreleased, so it stays usable until the current autorelease pool drains even if later calls evict it from the cache. Cached statements belong to the controller and must not be kept past its lifetime.
 - (unsigned long long int)lastInsertRowID;
 
+// WAL tuning
+
+- (BOOL)setAutoCheckpointPageCount:(int)pageCount error:(NSError **)outError;
+    // Zero or a negative count turns off automatic checkpoints, in which case -checkpoint: should be called periodically.
+- (BOOL)setMemoryMapSize:(long long)size error:(NSError **)outError;
+    // Applies to the writer and any read connections (current and future).
+- (BOOL)checkpoint:(NSError **)outError;
+
+// Read pool
+
+- (BOOL)performReadWithBlock:(BOOL (^)(OSLDatabaseController *connection, NSError **outError))block error:(NSError **)outError;
+    // Checks out a read-only connection for the duration of the block, waiting if all of them are in use. Connections are not thread-safe, so the block must not let the connection (or statements from it) escape.
+
 // Convenience methods
 
 - (BOOL)beginTransaction;
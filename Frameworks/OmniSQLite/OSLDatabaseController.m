@@ -14,29 +14,55 @@
 
 #import <OmniSQLite/OSLPreparedStatement.h>
 #import "Errors.h"
+#import "sqlite3.h"
 
 RCS_ID("$Id$")
 
+@interface OSLPreparedStatement (Private)
+- (void)_dropDatabaseControllerReference;
+@end
+
 @interface OSLDatabaseController (Private)
+- (id)_initReadConnectionWithDatabasePath:(NSString *)aPath memoryMapSize:(long long)memoryMapSize error:(NSError **)outError;
 - (void *)_database;
 - (BOOL)_openDatabase:(NSError **)outError;
 - (void)_deleteDatabase;
 - (void)_closeDatabase;
 - (BOOL)_executeSQL:(NSString *)sql withCallback:(OSLDatabaseCallback)callbackFunction context:(void *)callbackContext error:(NSError **)outError;
 - (OSLPreparedStatement *)_prepareStatement:(NSString *)sql error:(NSError **)outError;
+- (OSLPreparedStatement *)_cachedStatement:(NSString *)sql error:(NSError **)outError;
+- (void)_flushStatementCache;
+- (OSLDatabaseController *)_checkOutReadConnection:(NSError **)outError;
+- (void)_checkInReadConnection:(OSLDatabaseController *)connection;
 - (unsigned long long int)_lastInsertRowID;
 @end
 
 @implementation OSLDatabaseController
 
+static const NSUInteger OSLDefaultStatementCacheCapacity = 32;
+
 @synthesize autoRetry = _autoRetry;
+@synthesize readOnly = _readOnly;
 
 - initWithDatabasePath:(NSString *)aPath error:(NSError **)outError;
+{
+    return [self initWithDatabasePath:aPath readConnectionLimit:0 error:outError];
+}
+
+- initWithDatabasePath:(NSString *)aPath readConnectionLimit:(NSUInteger)readConnectionLimit error:(NSError **)outError;
 {
     if (!(self = [super init]))
         return nil;
     
-    databasePath = [aPath retain];    
+    databasePath = [aPath retain];
+    _statementCacheCapacity = OSLDefaultStatementCacheCapacity;
+    _readConnectionLimit = readConnectionLimit;
+    if (_readConnectionLimit > 0) {
+        _idleReadConnections = [[NSMutableArray alloc] initWithCapacity:_readConnectionLimit];
+        _readConnectionLock = [[NSLock alloc] init];
+        _readConnectionSemaphore = dispatch_semaphore_create(_readConnectionLimit);
+    }
+
     if (![self _openDatabase:outError]) {
         [self release];
         return nil;
@@ -47,8 +73,15 @@ RCS_ID("$Id$")
 
 - (void)dealloc;
 {
+    OBASSERT([_idleReadConnections count] == _readConnectionCount); // All read connections should have been checked back in
+
     [self _closeDatabase];
     [databasePath release];
+
+    [_idleReadConnections release];
+    [_readConnectionLock release];
+    if (_readConnectionSemaphore != NULL)
+        dispatch_release(_readConnectionSemaphore);
     
     [super dealloc];
 }
@@ -58,6 +91,20 @@ RCS_ID("$Id$")
     return databasePath;
 }
 
+- (NSUInteger)statementCacheCapacity;
+{
+    return _statementCacheCapacity;
+}
+
+- (void)setStatementCacheCapacity:(NSUInteger)capacity;
+{
+    _statementCacheCapacity = capacity;
+    while ([_statementCacheOrder count] > _statementCacheCapacity) {
+        [_statementCache removeObjectForKey:[_statementCacheOrder objectAtIndex:0]];
+        [_statementCacheOrder removeObjectAtIndex:0];
+    }
+}
+
 - (void)deleteDatabase;
 {
     [self _deleteDatabase];
@@ -73,11 +120,79 @@ RCS_ID("$Id$")
     return [self _prepareStatement:sql error:outError];
 }
 
+- (OSLPreparedStatement *)cachedStatement:(NSString *)sql error:(NSError **)outError;
+{
+    return [self _cachedStatement:sql error:outError];
+}
+
 - (unsigned long long int)lastInsertRowID;
 {
     return [self _lastInsertRowID];
 }
 
+// WAL tuning
+
+- (BOOL)setAutoCheckpointPageCount:(int)pageCount error:(NSError **)outError;
+{
+    OBPRECONDITION(!_readOnly);
+    return [self executeSQL:[NSString stringWithFormat:@"PRAGMA wal_autocheckpoint = %d;\n", MAX(pageCount, 0)] withCallback:NULL context:NULL error:outError];
+}
+
+- (BOOL)setMemoryMapSize:(long long)size error:(NSError **)outError;
+{
+    OBPRECONDITION(size >= 0);
+
+    _memoryMapSize = size;
+    NSString *sql = [NSString stringWithFormat:@"PRAGMA mmap_size = %lld;\n", size];
+    if (![self executeSQL:sql withCallback:NULL context:NULL error:outError])
+        return NO;
+
+    // Idle read connections pick up the new size now; checked out ones will when they are next opened.
+    BOOL success = YES;
+    [_readConnectionLock lock];
+    for (OSLDatabaseController *connection in _idleReadConnections) {
+        connection->_memoryMapSize = size;
+        if (![connection executeSQL:sql withCallback:NULL context:NULL error:outError]) {
+            success = NO;
+            break;
+        }
+    }
+    [_readConnectionLock unlock];
+    return success;
+}
+
+- (BOOL)checkpoint:(NSError **)outError;
+{
+    OBPRECONDITION(!_readOnly);
+
+    int errorCode = sqlite3_wal_checkpoint_v2(sqliteDatabase, NULL, SQLITE_CHECKPOINT_PASSIVE, NULL, NULL);
+    if (errorCode != SQLITE_OK) {
+        OSLSQLError(outError, errorCode, sqliteDatabase);
+        return NO;
+    }
+    return YES;
+}
+
+// Read pool
+
+- (BOOL)performReadWithBlock:(BOOL (^)(OSLDatabaseController *connection, NSError **outError))block error:(NSError **)outError;
+{
+    if (_readConnectionLimit == 0)
+        return block(self, outError);
+
+    OSLDatabaseController *connection = [self _checkOutReadConnection:outError];
+    if (connection == nil)
+        return NO;
+
+    BOOL success;
+    @try {
+        success = block(connection, outError);
+    } @finally {
+        [self _checkInReadConnection:connection];
+    }
+    return success;
+}
+
 // Convenience methods
 
 - (BOOL)beginTransaction;
@@ -97,10 +212,27 @@ RCS_ID("$Id$")
 
 @end
 
-#import "sqlite3.h"
-
 @implementation OSLDatabaseController (Private)
 
+- (id)_initReadConnectionWithDatabasePath:(NSString *)aPath memoryMapSize:(long long)memoryMapSize error:(NSError **)outError;
+{
+    if (!(self = [super init]))
+        return nil;
+
+    databasePath = [aPath retain];
+    _readOnly = YES;
+    _autoRetry = YES; // Readers only see SQLITE_BUSY briefly, while the writer is resetting the WAL
+    _statementCacheCapacity = OSLDefaultStatementCacheCapacity;
+    _memoryMapSize = memoryMapSize;
+
+    if (![self _openDatabase:outError]) {
+        [self release];
+        return nil;
+    }
+
+    return self;
+}
+
 - (void *)_database;
 {
     return sqliteDatabase;
@@ -115,24 +247,36 @@ RCS_ID("$Id$")
 - (BOOL)_openDatabase:(NSError **)outError;
 {
     NSFileManager *fileManager = [NSFileManager defaultManager];
-    NSLog(@"Opening %@", databasePath);
-    if (![fileManager createPathToFile:databasePath attributes:nil error:outError])
+    DebugLog(@"Opening %@%@", databasePath, _readOnly ? @" (read-only)" : @"");
+    if (!_readOnly && ![fileManager createPathToFile:databasePath attributes:nil error:outError])
         return NO;
     
-    sqlite3 *db;
-    int errorCode = sqlite3_open([fileManager fileSystemRepresentationWithPath:databasePath], &db);
+    // The read pool hands each read connection to one thread at a time, so those can do without SQLite's connection mutex. The writer keeps it, since callers may share it between threads (and with no read pool, reads run on it too).
+    sqlite3 *db = NULL;
+    int openFlags = _readOnly ? (SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX) : (SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    int errorCode = sqlite3_open_v2([fileManager fileSystemRepresentationWithPath:databasePath], &db, openFlags, NULL);
     if (errorCode != SQLITE_OK) {
         NSLog(@"Failed to open %@: %d -- %@", databasePath, errorCode, [NSString stringWithUTF8String:sqlite3_errmsg(db)]);
+        OSLSQLError(outError, errorCode, db);
         sqlite3_close(db);
+        return NO;
     }
 
     sqliteDatabase = db;
 
+    if (_readOnly) {
+        if (_memoryMapSize > 0)
+            [self executeSQL:[NSString stringWithFormat:@"PRAGMA mmap_size = %lld;\n", _memoryMapSize] withCallback:NULL context:NULL error:NULL];
+        return YES;
+    }
+
     unsigned long long count;
     
     [self executeSQL:@"select count(*) from sqlite_master" withCallback:SingleUnsignedLongLongCallback context:&count error:NULL];
     DebugLog(@"sqlite_master count = %llu", count);
+    // WAL lets the read connections run while the writer is in a transaction, and turns most commits into sequential appends.
     [self executeSQL:
+	@"PRAGMA journal_mode = WAL;\n"
 	@"PRAGMA synchronous = OFF;\n"
 	@"PRAGMA temp_store = MEMORY;\n" 
 	withCallback:NULL context:NULL error:NULL];
@@ -142,14 +286,26 @@ RCS_ID("$Id$")
 - (void)_deleteDatabase;
 {
     NSString *journalPath = [databasePath stringByAppendingString:@"-journal"];
+    NSString *walPath = [databasePath stringByAppendingString:@"-wal"];
+    NSString *sharedMemoryPath = [databasePath stringByAppendingString:@"-shm"];
     
     [[NSFileManager defaultManager] removeItemAtPath:databasePath error:NULL];
     [[NSFileManager defaultManager] removeItemAtPath:journalPath error:NULL];
+    [[NSFileManager defaultManager] removeItemAtPath:walPath error:NULL];
+    [[NSFileManager defaultManager] removeItemAtPath:sharedMemoryPath error:NULL];
 }
 
 - (void)_closeDatabase;
 {
-    sqlite3_close(sqliteDatabase);
+    // Statements hold the connection open (sqlite3_close fails with SQLITE_BUSY) until they are finalized.
+    [self _flushStatementCache];
+    for (OSLDatabaseController *connection in _idleReadConnections)
+        [connection _closeDatabase];
+    [_idleReadConnections removeAllObjects];
+
+    // Any statements still retained elsewhere keep the connection alive (as a zombie) until they are finalized, rather than making the close fail.
+    sqlite3_close_v2(sqliteDatabase);
+    sqliteDatabase = NULL;
 }
 
 - (BOOL)_executeSQL:(NSString *)sql withCallback:(OSLDatabaseCallback)callbackFunction context:(void *)callbackContext error:(NSError **)outError;
@@ -203,6 +359,105 @@ RCS_ID("$Id$")
     return [[[OSLPreparedStatement alloc] initWithSQL:sql statement:statement databaseController:self] autorelease];
 }
 
+- (OSLPreparedStatement *)_cachedStatement:(NSString *)sql error:(NSError **)outError;
+{
+    if (_statementCacheCapacity == 0)
+        return [self _prepareStatement:sql error:outError];
+
+    OSLPreparedStatement *statement = [_statementCache objectForKey:sql];
+    if (statement != nil) {
+        if ([statement isBusy]) {
+            // Still being stepped by an outer caller; don't pull the rug out from under it.
+            return [self _prepareStatement:sql error:outError];
+        }
+
+        // Move it to the most recently used end
+        NSUInteger orderIndex = [_statementCacheOrder indexOfObject:sql];
+        OBASSERT(orderIndex != NSNotFound);
+        if (orderIndex != [_statementCacheOrder count] - 1) {
+            [sql retain];
+            [_statementCacheOrder removeObjectAtIndex:orderIndex];
+            [_statementCacheOrder addObject:sql];
+            [sql release];
+        }
+
+        [statement reset];
+        [statement clearBindings];
+        return [[statement retain] autorelease]; // The caller may cause it to be evicted while still using it
+    }
+
+    statement = [self _prepareStatement:sql error:outError];
+    if (statement == nil)
+        return nil;
+
+    if (_statementCache == nil) {
+        _statementCache = [[NSMutableDictionary alloc] initWithCapacity:_statementCacheCapacity];
+        _statementCacheOrder = [[NSMutableArray alloc] initWithCapacity:_statementCacheCapacity];
+    }
+    if ([_statementCacheOrder count] >= _statementCacheCapacity) {
+        [_statementCache removeObjectForKey:[_statementCacheOrder objectAtIndex:0]];
+        [_statementCacheOrder removeObjectAtIndex:0];
+    }
+
+    // The cache owns the statement, so it must not own us back.
+    [statement _dropDatabaseControllerReference];
+
+    NSString *key = [sql copy];
+    [_statementCache setObject:statement forKey:key];
+    [_statementCacheOrder addObject:key];
+    [key release];
+
+    return [[statement retain] autorelease];
+}
+
+- (void)_flushStatementCache;
+{
+    [_statementCache release];
+    _statementCache = nil;
+    [_statementCacheOrder release];
+    _statementCacheOrder = nil;
+}
+
+- (OSLDatabaseController *)_checkOutReadConnection:(NSError **)outError;
+{
+    OBPRECONDITION(_readConnectionLimit > 0);
+
+    // The semaphore counts connections that are either idle or not yet opened, so once we get past it there is guaranteed to be one for us.
+    dispatch_semaphore_wait(_readConnectionSemaphore, DISPATCH_TIME_FOREVER);
+
+    [_readConnectionLock lock];
+    OSLDatabaseController *connection = [[_idleReadConnections lastObject] retain];
+    if (connection != nil)
+        [_idleReadConnections removeLastObject];
+    else
+        _readConnectionCount++;
+    [_readConnectionLock unlock];
+
+    if (connection == nil) {
+        connection = [[OSLDatabaseController alloc] _initReadConnectionWithDatabasePath:databasePath memoryMapSize:_memoryMapSize error:outError];
+        if (connection == nil) {
+            [_readConnectionLock lock];
+            _readConnectionCount--;
+            [_readConnectionLock unlock];
+            dispatch_semaphore_signal(_readConnectionSemaphore);
+            return nil;
+        }
+    }
+
+    return [connection autorelease];
+}
+
+- (void)_checkInReadConnection:(OSLDatabaseController *)connection;
+{
+    OBPRECONDITION(connection->_readOnly);
+
+    [_readConnectionLock lock];
+    [_idleReadConnections addObject:connection];
+    [_readConnectionLock unlock];
+
+    dispatch_semaphore_signal(_readConnectionSemaphore);
+}
+
 - (unsigned long long int)_lastInsertRowID;
 {
     return sqlite3_last_insert_rowid(sqliteDatabase);
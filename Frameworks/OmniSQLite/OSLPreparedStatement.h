@@ -18,16 +18,33 @@
     void *statement;
     unsigned int bindIndex;
     OSLDatabaseController *databaseController;
+    BOOL _ownsDatabaseController;
 }
 
 - initWithSQL:(NSString *)someSQL statement:(void *)preparedStatement databaseController:(OSLDatabaseController *)aDatabaseController;
 - (void)reset;
+- (void)clearBindings;
+- (BOOL)isBusy;
+    // YES if the statement has been stepped but not run to completion or reset.
 - (NSDictionary *)step;
 
+// Row access without building a dictionary per row. After -stepRow returns YES, the column accessors read the current row directly; column indexes are zero-based and pointers are only valid until the next step or reset.
+
+- (BOOL)stepRow;
+- (int)columnCount;
+- (BOOL)isNullAtColumn:(int)columnIndex;
+- (int)intAtColumn:(int)columnIndex;
+- (long long)longLongIntAtColumn:(int)columnIndex;
+- (double)doubleAtColumn:(int)columnIndex;
+- (const void *)bytesAtColumn:(int)columnIndex length:(NSUInteger *)outLength;
+- (NSString *)stringAtColumn:(int)columnIndex;
+- (NSData *)dataAtColumn:(int)columnIndex;
+
 - (void)bindInt:(int)integer;
 - (void)bindString:(NSString *)string;
 - (void)bindBlob:(NSData *)data;
 - (void)bindLongLongInt:(long long)longLong;
+- (void)bindDouble:(double)value;
 - (void)bindNull;
 
 // Convenience method
@@ -16,10 +16,6 @@
 
 RCS_ID("$Id$")
 
-@interface OSLDatabaseController (Private)
-- (void *)_database;
-@end
-
 @implementation OSLPreparedStatement
 
 - initWithSQL:(NSString *)someSQL statement:(void *)preparedStatement databaseController:(OSLDatabaseController *)aDatabaseController;
@@ -30,6 +26,7 @@ RCS_ID("$Id$")
     sql = [someSQL retain];
     statement = preparedStatement;
     databaseController = [aDatabaseController retain];
+    _ownsDatabaseController = YES;
     
     return self;
 }
@@ -37,7 +34,9 @@ RCS_ID("$Id$")
 - (void)dealloc;
 {
     sqlite3_finalize(statement);
-    [databaseController release];
+    [sql release];
+    if (_ownsDatabaseController)
+        [databaseController release];
     [super dealloc];
 }
 
@@ -47,6 +46,17 @@ RCS_ID("$Id$")
     sqlite3_reset(statement);
 }
 
+- (void)clearBindings;
+{
+    bindIndex = 0;
+    sqlite3_clear_bindings(statement);
+}
+
+- (BOOL)isBusy;
+{
+    return sqlite3_stmt_busy(statement) != 0;
+}
+
 #if 0 && defined(DEBUG)
     #define DebugLog(format, ...) NSLog(format, ## __VA_ARGS__)
 #else
@@ -55,44 +65,101 @@ RCS_ID("$Id$")
 
 - (NSDictionary *)step;
 {
-    DebugLog(@"STEP %@", sql);
-    int errorCode = sqlite3_step(statement);
+    if (![self stepRow])
+        return nil;
+
+    NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
+    unsigned int columnIndex = sqlite3_data_count(statement);
+    id value;
     
-    if (errorCode == SQLITE_ROW) {
-        NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
-        unsigned int columnIndex = sqlite3_data_count(statement);
-        id value;
-        
-        while (columnIndex--) {
-            switch(sqlite3_column_type(statement, columnIndex)) {
-                case SQLITE_INTEGER:
-                    value = [NSNumber numberWithLongLong:sqlite3_column_int64(statement, columnIndex)];
-                    break;
-                case SQLITE_FLOAT:
-                    value = [NSNumber numberWithDouble:sqlite3_column_double(statement, columnIndex)];
-                    break;
-                case SQLITE_TEXT:
-                case SQLITE_BLOB:
-                    value = [NSData dataWithBytes:sqlite3_column_blob(statement, columnIndex) length:sqlite3_column_bytes(statement, columnIndex)];
-                    break;
-                case SQLITE_NULL:
-                default:
-                    continue;
-            }
-            NSString *key = [NSString stringWithUTF8String:sqlite3_column_name(statement, columnIndex)];
-            [dictionary setObject:value forKey:key];
+    while (columnIndex--) {
+        switch(sqlite3_column_type(statement, columnIndex)) {
+            case SQLITE_INTEGER:
+                value = [NSNumber numberWithLongLong:sqlite3_column_int64(statement, columnIndex)];
+                break;
+            case SQLITE_FLOAT:
+                value = [NSNumber numberWithDouble:sqlite3_column_double(statement, columnIndex)];
+                break;
+            case SQLITE_TEXT:
+            case SQLITE_BLOB:
+                value = [NSData dataWithBytes:sqlite3_column_blob(statement, columnIndex) length:sqlite3_column_bytes(statement, columnIndex)];
+                break;
+            case SQLITE_NULL:
+            default:
+                continue;
         }
+        NSString *key = [NSString stringWithUTF8String:sqlite3_column_name(statement, columnIndex)];
+        [dictionary setObject:value forKey:key];
+    }
 #ifdef DEBUG0
-	DebugLog(@"-> %@", dictionary);
+    DebugLog(@"-> %@", dictionary);
 #else
-        DebugLog(@"-> %u columns", sqlite3_data_count(statement));
+    DebugLog(@"-> %u columns", sqlite3_data_count(statement));
 #endif
-        return dictionary;
-    }
+    return dictionary;
+}
+
+- (BOOL)stepRow;
+{
+    DebugLog(@"STEP %@", sql);
+    int errorCode = sqlite3_step(statement);
+    if (errorCode == SQLITE_ROW)
+        return YES;
+
     if (errorCode != SQLITE_DONE)
-        NSLog(@"ERROR executing sql %@: %s (%d)", sql, sqlite3_errmsg([databaseController _database]), errorCode);
-    
-    return nil;
+        NSLog(@"ERROR executing sql %@: %s (%d)", sql, sqlite3_errmsg(sqlite3_db_handle(statement)), errorCode);
+    return NO;
+}
+
+- (int)columnCount;
+{
+    return sqlite3_data_count(statement);
+}
+
+- (BOOL)isNullAtColumn:(int)columnIndex;
+{
+    return sqlite3_column_type(statement, columnIndex) == SQLITE_NULL;
+}
+
+- (int)intAtColumn:(int)columnIndex;
+{
+    return sqlite3_column_int(statement, columnIndex);
+}
+
+- (long long)longLongIntAtColumn:(int)columnIndex;
+{
+    return sqlite3_column_int64(statement, columnIndex);
+}
+
+- (double)doubleAtColumn:(int)columnIndex;
+{
+    return sqlite3_column_double(statement, columnIndex);
+}
+
+- (const void *)bytesAtColumn:(int)columnIndex length:(NSUInteger *)outLength;
+{
+    // Per the SQLite docs, fetch the pointer before the length so any type conversion has already happened.
+    const void *bytes = sqlite3_column_blob(statement, columnIndex);
+    if (outLength != NULL)
+        *outLength = sqlite3_column_bytes(statement, columnIndex);
+    return bytes;
+}
+
+- (NSString *)stringAtColumn:(int)columnIndex;
+{
+    const unsigned char *text = sqlite3_column_text(statement, columnIndex);
+    if (text == NULL)
+        return nil;
+    return [[[NSString alloc] initWithBytes:text length:sqlite3_column_bytes(statement, columnIndex) encoding:NSUTF8StringEncoding] autorelease];
+}
+
+- (NSData *)dataAtColumn:(int)columnIndex;
+{
+    NSUInteger length;
+    const void *bytes = [self bytesAtColumn:columnIndex length:&length];
+    if (bytes == NULL)
+        return nil;
+    return [NSData dataWithBytes:bytes length:length];
 }
 
 - (void)bindInt:(int)integer;
@@ -120,6 +187,11 @@ RCS_ID("$Id$")
     sqlite3_bind_int64(statement, ++bindIndex, longLong);
 }
 
+- (void)bindDouble:(double)value;
+{
+    sqlite3_bind_double(statement, ++bindIndex, value);
+}
+
 - (void)bindNull;
 {
     sqlite3_bind_null(statement, ++bindIndex);
@@ -135,3 +207,15 @@ RCS_ID("$Id$")
 }
 
 @end
+
+@implementation OSLPreparedStatement (Private)
+
+- (void)_dropDatabaseControllerReference;
+{
+    if (_ownsDatabaseController) {
+        _ownsDatabaseController = NO;
+        [databaseController release];
+    }
+}
+
+@end